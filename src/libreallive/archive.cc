@@ -33,11 +33,15 @@
 
 #include <boost/algorithm/string.hpp>
 #include <boost/filesystem.hpp>
+#include <algorithm>
 #include <cstring>
+#include <ctime>
 #include <string>
+#include <utility>
 
 #include "libreallive/archive.h"
 #include "libreallive/compression.h"
+#include "utilities/hash.h"
 
 using boost::iends_with;
 using boost::istarts_with;
@@ -54,22 +58,25 @@ Archive::Archive(const fs::path& filepath, const std::string& regname)
   FindXorKey();
 }
 
-Archive::~Archive() {}
+Archive::~Archive() {
+  cancel_preload_ = true;
+  if (preload_thread_.joinable())
+    preload_thread_.join();
+}
 
 Scenario* Archive::GetScenario(int index) {
-  scenario_t::const_iterator at = scenario_.find(index);
-  if (at != scenario_.end())
-    return at->second.get();
-  else {  // make the scenario on demand
-    toc_t::const_iterator st = toc_.find(index);
-    if (st != toc_.end()) {
-      Scenario* scene =
-          new Scenario(st->second, index, regname_, second_level_xor_key_);
-      scenario_[index].reset(scene);
-      return scene;
-    }
-    return NULL;
+  {
+    std::lock_guard<std::mutex> lock(scenario_mutex_);
+    scenario_t::const_iterator at = scenario_.find(index);
+    if (at != scenario_.end())
+      return at->second.get();
   }
+
+  // make the scenario on demand
+  toc_t::const_iterator st = toc_.find(index);
+  if (st != toc_.end())
+    return PublishScenario(index, BuildScenario(index, st->second));
+  return NULL;
 }
 
 Scenario* Archive::GetFirstScenario() {
@@ -90,8 +97,152 @@ int Archive::GetProbableEncodingType() const {
   return 0;
 }
 
+bool Archive::UseScenarioCache(const fs::path& cache_path) {
+  const uint64_t stamp = ComputeCacheStamp();
+  cache_ = ScenarioCache::Open(cache_path, stamp,
+                               [this]() { return ComputeCacheKey(); });
+  if (cache_)
+    return true;
+
+  // Cold start: parse everything while recording the decompressed streams so
+  // the next launch doesn't have to.
+  std::map<int, ScriptIndex> indices;
+  ParseAllScenarios(0, &indices);
+  ScenarioCache::Write(cache_path, stamp, ComputeCacheKey(), indices);
+  return false;
+}
+
+void Archive::PreloadAllScenarios(int num_threads) {
+  ParseAllScenarios(num_threads, nullptr);
+}
+
+void Archive::ParseAllScenarios(int num_threads,
+                                std::map<int, ScriptIndex>* indices) {
+  if (num_threads <= 0)
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+  std::vector<std::pair<int, FilePos>> work(toc_.cbegin(), toc_.cend());
+  std::atomic<size_t> next_item(0);
+  std::mutex indices_mutex;
+
+  auto worker = [&]() {
+    size_t i;
+    while (!cancel_preload_ && (i = next_item++) < work.size()) {
+      const int index = work[i].first;
+      {
+        std::lock_guard<std::mutex> lock(scenario_mutex_);
+        if (scenario_.count(index))
+          continue;
+      }
+
+      ScriptIndex script_index;
+      try {
+        PublishScenario(index,
+                        BuildScenario(index, work[i].second,
+                                      indices ? &script_index : nullptr));
+      } catch (...) {
+        // Leave it to GetScenario() to report the error if the game ever
+        // actually uses this scenario, and leave it out of any cache.
+        continue;
+      }
+
+      if (indices) {
+        std::lock_guard<std::mutex> lock(indices_mutex);
+        indices->emplace(index, std::move(script_index));
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (int i = 1; i < num_threads; ++i)
+    threads.emplace_back(worker);
+  worker();
+  for (std::thread& thread : threads)
+    thread.join();
+}
+
+void Archive::PreloadAllScenariosInBackground(int num_threads) {
+  if (preload_thread_.joinable())
+    return;
+
+  preload_thread_ =
+      std::thread([this, num_threads]() { PreloadAllScenarios(num_threads); });
+}
+
+std::map<int, std::chrono::microseconds> Archive::GetScenarioParseTimes()
+    const {
+  std::lock_guard<std::mutex> lock(scenario_mutex_);
+  return parse_times_;
+}
+
+std::unique_ptr<Scenario> Archive::BuildScenario(int index,
+                                                 FilePos filepos,
+                                                 ScriptIndex* script_index) {
+  auto start = std::chrono::steady_clock::now();
+  const CachedScript* cached = cache_ ? cache_->Find(index) : nullptr;
+  std::unique_ptr<Scenario> scene(
+      cached ? new Scenario(filepos, index, *cached)
+             : new Scenario(filepos, index, regname_, second_level_xor_key_,
+                            script_index));
+  auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start);
+
+  std::lock_guard<std::mutex> lock(scenario_mutex_);
+  parse_times_[index] = elapsed;
+  return scene;
+}
+
+Scenario* Archive::PublishScenario(int index,
+                                   std::unique_ptr<Scenario> scene) {
+  std::lock_guard<std::mutex> lock(scenario_mutex_);
+  std::unique_ptr<Scenario>& slot = scenario_[index];
+  if (!slot)
+    slot = std::move(scene);
+  return slot.get();
+}
+
+uint64_t Archive::ComputeCacheStamp() const {
+  // Modification times only have a resolution of a second (two on FAT), so a
+  // file written within that window of now could be written again without
+  // its stamp changing. Like a file we can't stat, it makes the whole stamp
+  // untrustworthy, and the cache then falls back to hashing the contents.
+  const std::time_t racy_after = std::time(nullptr) - 2;
+
+  uint64_t hash = HashBytes(regname_);
+  for (const fs::path& source : sources_) {
+    boost::system::error_code ec;
+    const uint64_t size = fs::file_size(source, ec);
+    if (ec)
+      return ScenarioCache::kNoStamp;
+    const std::time_t mtime = fs::last_write_time(source, ec);
+    if (ec || mtime >= racy_after)
+      return ScenarioCache::kNoStamp;
+
+    std::string stamp = source.string();
+    append_i32(stamp, static_cast<uint32_t>(size));
+    append_i32(stamp, static_cast<uint32_t>(size >> 32));
+    append_i32(stamp, static_cast<uint32_t>(mtime));
+    append_i32(stamp, static_cast<uint32_t>(uint64_t(mtime) >> 32));
+    hash = HashBytes(stamp, hash);
+  }
+  return hash;
+}
+
+uint64_t Archive::ComputeCacheKey() const {
+  uint64_t hash = HashBytes(regname_);
+  for (auto const& entry : toc_) {
+    FilePos filepos = entry.second;
+    std::string index;
+    append_i32(index, entry.first);
+    hash = HashBytes(index, hash);
+    hash = HashBytes(filepos.Read(), hash);
+  }
+  return hash;
+}
+
 void Archive::ReadTOC(const fs::path& filepath) {
   std::shared_ptr<MappedFile> header = std::make_shared<MappedFile>(filepath);
+  sources_.push_back(filepath);
   static constexpr int TOC_COUNT = 10000;
   static constexpr std::size_t TOC_SIZE = 8;
 
@@ -126,6 +277,7 @@ void Archive::ReadOverrides(const fs::path& filepath) {
 
       int index = std::stoi(filename.substr(4, 4));
       toc_[index] = filepos;
+      sources_.push_back(it->path());
     }
   }
 }
@@ -34,15 +34,20 @@
 #ifndef SRC_LIBREALLIVE_ARCHIVE_H_
 #define SRC_LIBREALLIVE_ARCHIVE_H_
 
+#include <atomic>
+#include <chrono>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <vector>
 
 #include "libreallive/alldefs.h"
 #include "libreallive/filemap.h"
 #include "libreallive/scenario.h"
+#include "libreallive/scenario_cache.h"
 
 namespace libreallive {
 
@@ -61,7 +66,8 @@ class Archive {
   Archive(const fs::path& filename, const std::string& regname);
   ~Archive();
 
-  // Returns a specific scenario by |index| number or NULL if none exist.
+  // Returns a specific scenario by |index| number or NULL if none exist. Safe
+  // to call while scenarios are being preloaded on other threads.
   Scenario* GetScenario(int index);
 
   Scenario* GetFirstScenario();
@@ -70,10 +76,63 @@ class Archive {
   // with non-default encoding. This short circuits when it finds one.
   int GetProbableEncodingType() const;
 
+  // Builds scenarios from the on-disk cache at |cache_path| when it was
+  // written for this exact SEEN.TXT and regname. Only hashes the scenarios
+  // when the sizes or modification times of the files have changed.
+  // Otherwise, parses every scenario now, on one thread per core, and writes
+  // a fresh cache for the next launch. Must be called before any scenario is
+  // requested or preloaded. Returns true on a cache hit.
+  bool UseScenarioCache(const fs::path& cache_path);
+
+  // The cache UseScenarioCache() hit, or NULL.
+  const ScenarioCache* scenario_cache() const { return cache_.get(); }
+
+  // Decompresses and parses every scenario in the table of contents on
+  // |num_threads| worker threads (0 picks one per core), publishing each into
+  // the scenario table as it completes. Blocks until all workers are done.
+  // Scenarios which fail to parse are skipped here and will throw again when
+  // requested through GetScenario().
+  void PreloadAllScenarios(int num_threads = 0);
+
+  // Runs PreloadAllScenarios() on a background thread and returns
+  // immediately. The thread is joined (and cut short) on destruction.
+  void PreloadAllScenariosInBackground(int num_threads = 0);
+
+  // Returns how long each scenario built so far took to decompress and parse,
+  // keyed by scenario number.
+  std::map<int, std::chrono::microseconds> GetScenarioParseTimes() const;
+
  private:
   typedef std::map<int, FilePos> toc_t;
   typedef std::map<int, std::unique_ptr<Scenario>> scenario_t;
 
+  // Builds scenario |index| from the cache or its table of contents entry,
+  // recording how long the parse took and, when |script_index| is non-NULL,
+  // the data needed to cache it. Does not touch |scenario_|.
+  std::unique_ptr<Scenario> BuildScenario(int index,
+                                          FilePos filepos,
+                                          ScriptIndex* script_index = nullptr);
+
+  // Publishes |scene| as scenario |index| unless another thread beat us to it,
+  // and returns whichever one ended up in the table.
+  Scenario* PublishScenario(int index, std::unique_ptr<Scenario> scene);
+
+  // Parses every scenario not yet in |scenario_| on |num_threads| threads (0
+  // picks one per core). When |indices| is non-NULL, also fills it with the
+  // data needed to cache each scenario that parsed.
+  void ParseAllScenarios(int num_threads,
+                         std::map<int, ScriptIndex>* indices);
+
+  // Hashes the regname and the path, size and modification time of every
+  // file in |sources_|. Cheap enough to check on every launch. Returns
+  // ScenarioCache::kNoStamp when a file can't be stat()ed or was modified too
+  // recently for its time to tell later writes apart.
+  uint64_t ComputeCacheStamp() const;
+
+  // Hashes the regname and every table of contents entry; the key a
+  // ScenarioCache must match when its stamp doesn't.
+  uint64_t ComputeCacheKey() const;
+
   void ReadTOC(const fs::path& filepath);
 
   void ReadOverrides(const fs::path& filepath);
@@ -83,6 +142,24 @@ class Archive {
   toc_t toc_;
   scenario_t scenario_;
 
+  // SEEN.TXT and any SEENXXXX.TXT files overriding its entries.
+  std::vector<fs::path> sources_;
+
+  // Decompressed bytecode from a previous run, if UseScenarioCache() hit.
+  std::unique_ptr<ScenarioCache> cache_;
+
+  // Guards |scenario_| and |parse_times_|. |toc_| is immutable after
+  // construction and needs no locking.
+  mutable std::mutex scenario_mutex_;
+
+  std::map<int, std::chrono::microseconds> parse_times_;
+
+  // The thread started by PreloadAllScenariosInBackground(), if any.
+  std::thread preload_thread_;
+
+  // Set on destruction to make preload workers stop picking up new work.
+  std::atomic<bool> cancel_preload_{false};
+
   // Mappings to unarchived SEEN\d{4}.TXT files on disk.
   // std::vector<std::unique_ptr<Mapping>> maps_to_delete_;
 
@@ -72,30 +72,28 @@ void PrintParameterString(std::ostream& oss,
   oss << ")";
 }
 
-char entrypoint_marker = '@';
-
 // static
 BytecodeElement* BytecodeFactory::Read(const char* stream,
                                        const char* end,
                                        ConstructionData& cdata) {
   const char c = *stream;
   if (c == '!')
-    entrypoint_marker = '!';
+    cdata.entrypoint_marker = '!';
   switch (c) {
     case 0:
     case ',':
-      return new CommaElement;
+      return cdata.Create<CommaElement>();
     case '\n':
-      return new MetaElement(nullptr, stream);
+      return cdata.Create<MetaElement>(nullptr, stream);
     case '@':
     case '!':
-      return new MetaElement(&cdata, stream);
+      return cdata.Create<MetaElement>(&cdata, stream);
     case '$':
-      return new ExpressionElement(stream);
+      return cdata.Create<ExpressionElement>(stream);
     case '#':
       return FunctionFactory::ReadFunction(stream, cdata);
     default:
-      return TextoutFactory::Read(stream, end);
+      return TextoutFactory::Read(stream, end, cdata);
   }
 }
 
@@ -0,0 +1,64 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of libreallive, a dependency of RLVM.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (c) 2026 agent <agent@local>
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use, copy,
+// modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// -----------------------------------------------------------------------
+
+#include "libreallive/bytecode_arena.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace libreallive {
+
+BytecodeArena::BytecodeArena(size_t block_size) : block_size_(block_size) {}
+
+BytecodeArena::~BytecodeArena() {}
+
+void* BytecodeArena::Allocate(size_t size, size_t alignment) {
+  size_t padding =
+      -reinterpret_cast<uintptr_t>(current_) & (alignment - 1);
+  if (!current_ || padding + size > remaining_) {
+    // Oversized requests get a block of their own.
+    const size_t new_block = std::max(block_size_, size + alignment);
+    blocks_.emplace_back(new char[new_block]);
+    current_ = blocks_.back().get();
+    remaining_ = new_block;
+    padding = -reinterpret_cast<uintptr_t>(current_) & (alignment - 1);
+  }
+
+  char* result = current_ + padding;
+  current_ += padding + size;
+  remaining_ -= padding + size;
+  bytes_used_ += size;
+  return result;
+}
+
+}  // namespace libreallive
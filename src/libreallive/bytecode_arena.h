@@ -0,0 +1,75 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of libreallive, a dependency of RLVM.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (c) 2026 agent <agent@local>
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use, copy,
+// modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// -----------------------------------------------------------------------
+
+#ifndef SRC_LIBREALLIVE_BYTECODE_ARENA_H_
+#define SRC_LIBREALLIVE_BYTECODE_ARENA_H_
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace libreallive {
+
+// A bump allocator holding every BytecodeElement of a Script. Elements are
+// carved out of large blocks in bytecode order, so walking a scenario touches
+// contiguous memory instead of thousands of separate heap allocations.
+//
+// The arena only hands out and releases raw storage; its owner must run the
+// elements' destructors before the arena goes away.
+class BytecodeArena {
+ public:
+  explicit BytecodeArena(size_t block_size = 16 * 1024);
+  ~BytecodeArena();
+
+  BytecodeArena(const BytecodeArena&) = delete;
+  BytecodeArena& operator=(const BytecodeArena&) = delete;
+
+  // Returns |size| bytes aligned to |alignment|, which must be a power of two
+  // no larger than alignof(std::max_align_t).
+  void* Allocate(size_t size, size_t alignment);
+
+  // The number of underlying heap blocks and the bytes handed out from them.
+  size_t block_count() const { return blocks_.size(); }
+  size_t bytes_used() const { return bytes_used_; }
+
+ private:
+  std::vector<std::unique_ptr<char[]>> blocks_;
+  size_t block_size_;
+  char* current_ = nullptr;
+  size_t remaining_ = 0;
+  size_t bytes_used_ = 0;
+};
+
+}  // namespace libreallive
+
+#endif  // SRC_LIBREALLIVE_BYTECODE_ARENA_H_
@@ -29,16 +29,17 @@
 #ifndef SRC_LIBREALLIVE_BYTECODE_FWD_H_
 #define SRC_LIBREALLIVE_BYTECODE_FWD_H_
 
-#include <forward_list>
-#include <memory>
+#include <vector>
 
 namespace libreallive {
 
 // List definitions.
 class ExpressionPiece;
 class BytecodeElement;
-typedef std::forward_list<std::unique_ptr<BytecodeElement>> BytecodeList;
+// Elements live in their Script's BytecodeArena; the list only points at them.
+typedef std::vector<BytecodeElement*> BytecodeList;
 typedef BytecodeList::iterator pointer_t;
+class BytecodeArena;
 
 struct ConstructionData;
 class Pointers;
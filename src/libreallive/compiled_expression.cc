@@ -0,0 +1,476 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of libreallive, a dependency of RLVM.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (c) 2026 agent <agent@local>
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use, copy,
+// modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// -----------------------------------------------------------------------
+
+#include "libreallive/compiled_expression.h"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+
+#include "libreallive/intmemref.h"
+#include "machine/memory.h"
+#include "machine/reference.h"
+#include "machine/rlmachine.h"
+
+namespace libreallive {
+
+namespace {
+
+// The highest access type Memory can decode (16 bits at a time).
+const int kMaxAccessType = 5;
+
+// Splits |location| into the int that holds it and its position within that
+// int, for a bank read |access| bits at a time (0 meaning whole ints). Mirrors
+// Memory::GetIntValue(). Returns false when |location| is out of range.
+bool LocateInt(int access, int location, int* word, int* shift, int* mask) {
+  if (access == 0) {
+    if (static_cast<unsigned int>(location) >= 2000)
+      return false;
+    *word = location;
+    *shift = 0;
+    *mask = -1;
+    return true;
+  }
+
+  int factor = 1 << (access - 1);
+  int eltsize = 32 / factor;
+  if (static_cast<unsigned int>(location) >= (64000u / factor))
+    return false;
+  *word = location / eltsize;
+  *shift = (location % eltsize) * factor;
+  *mask = (1 << factor) - 1;
+  return true;
+}
+
+int ReadInt(Memory& memory, int bank, int word, int shift, int mask) {
+  return (memory.GetIntBank(bank)[word] >> shift) & mask;
+}
+
+void WriteInt(Memory& memory,
+              int bank,
+              int word,
+              int shift,
+              int mask,
+              int value) {
+  int* ints = memory.GetIntBankForWrite(bank, word);
+  ints[word] = (ints[word] & ~(mask << shift)) | (value & mask) << shift;
+}
+
+// Stands in for a parsed parameter, evaluating integers through |code_| and
+// deferring everything else to the original tree.
+class CompiledEx : public IExpression {
+ public:
+  CompiledEx(Expression tree, std::unique_ptr<CompiledExpression> code)
+      : tree_(std::move(tree)), code_(std::move(code)) {}
+
+  bool is_valid() const override { return tree_->is_valid(); }
+  bool IsMemoryReference() const override {
+    return tree_->IsMemoryReference();
+  }
+  bool IsComplexParameter() const override {
+    return tree_->IsComplexParameter();
+  }
+  bool IsSpecialParameter() const override {
+    return tree_->IsSpecialParameter();
+  }
+  ExpressionValueType GetExpressionValueType() const override {
+    return tree_->GetExpressionValueType();
+  }
+
+  void SetIntegerValue(RLMachine& machine, int rvalue) override {
+    tree_->SetIntegerValue(machine, rvalue);
+  }
+  int GetIntegerValue(RLMachine& machine) const override {
+    return code_->Evaluate(machine);
+  }
+  void SetStringValue(RLMachine& machine, const std::string& rvalue) override {
+    tree_->SetStringValue(machine, rvalue);
+  }
+  std::string GetStringValue(RLMachine& machine) const override {
+    return tree_->GetStringValue(machine);
+  }
+
+  IntReferenceIterator GetIntegerReferenceIterator(
+      RLMachine& machine) const override {
+    return tree_->GetIntegerReferenceIterator(machine);
+  }
+  StringReferenceIterator GetStringReferenceIterator(
+      RLMachine& machine) const override {
+    return tree_->GetStringReferenceIterator(machine);
+  }
+
+  std::string GetSerializedExpression(RLMachine& machine) const override {
+    return tree_->GetSerializedExpression(machine);
+  }
+  std::string GetDebugString() const override {
+    return tree_->GetDebugString();
+  }
+
+  void AddContainedPiece(Expression piece) override {
+    tree_->AddContainedPiece(piece);
+  }
+  const std::vector<Expression>& GetContainedPieces() const override {
+    return tree_->GetContainedPieces();
+  }
+  int GetOverloadTag() const override { return tree_->GetOverloadTag(); }
+
+  bool Compile(CompiledExpression& code) const override {
+    return tree_->Compile(code);
+  }
+  bool CompileAssignment(CompiledExpression& code,
+                         char operation,
+                         const IExpression& rhs) const override {
+    return tree_->CompileAssignment(code, operation, rhs);
+  }
+
+ private:
+  Expression tree_;
+  std::unique_ptr<CompiledExpression> code_;
+};
+
+}  // namespace
+
+// static
+std::unique_ptr<CompiledExpression> CompiledExpression::Compile(
+    const IExpression& expression) {
+  if (expression.GetExpressionValueType() != ExpressionValueType::Integer)
+    return nullptr;
+
+  std::unique_ptr<CompiledExpression> code(new CompiledExpression);
+  if (!expression.Compile(*code) || code->depth_ != 1 ||
+      code->max_depth_ > kMaxStackDepth)
+    return nullptr;
+
+  code->code_.shrink_to_fit();
+  return code;
+}
+
+// static
+Expression CompiledExpression::WithCompiledForm(const Expression& expression) {
+  if (!expression)
+    return expression;
+
+  std::unique_ptr<CompiledExpression> code = Compile(*expression);
+  // A lone constant is already as cheap as it gets in tree form.
+  if (!code || code->is_constant())
+    return expression;
+  return std::make_shared<CompiledEx>(expression, std::move(code));
+}
+
+bool CompiledExpression::is_constant() const {
+  return code_.size() == 1 && code_.front().opcode == kConstant;
+}
+
+int CompiledExpression::Evaluate(RLMachine& machine) const {
+  int stack[kMaxStackDepth];
+  int* top = stack - 1;
+  Memory& memory = machine.memory();
+
+  for (const Instruction& in : code_) {
+    switch (in.opcode) {
+      case kConstant:
+        *++top = in.operand;
+        break;
+      case kLoadStoreRegister:
+        *++top = machine.store_register();
+        break;
+      case kSetStoreRegister:
+        machine.set_store_register(*top);
+        break;
+      case kLoad:
+        *++top = ReadInt(memory, in.bank, in.operand, in.shift, in.mask);
+        break;
+      case kStore:
+        WriteInt(memory, in.bank, in.operand, in.shift, in.mask, *top);
+        break;
+      case kLoadIndexed: {
+        int word, shift, mask;
+        if (!LocateInt(in.access, *top, &word, &shift, &mask)) {
+          // Let Memory throw its usual error.
+          machine.GetIntValue(IntMemRef(in.bank, in.access, *top));
+        }
+        *top = ReadInt(memory, in.bank, word, shift, mask);
+        break;
+      }
+      case kStoreIndexed: {
+        int location = top[0];
+        int value = top[-1];
+        int word, shift, mask;
+        if (!LocateInt(in.access, location, &word, &shift, &mask)) {
+          machine.SetIntValue(IntMemRef(in.bank, in.access, location), value);
+        }
+        WriteInt(memory, in.bank, word, shift, mask, value);
+        *--top = value;
+        break;
+      }
+      case kNegate:
+        *top = -*top;
+        break;
+      case kAdd:
+        top[-1] = top[-1] + top[0];
+        --top;
+        break;
+      case kSubtract:
+        top[-1] = top[-1] - top[0];
+        --top;
+        break;
+      case kMultiply:
+        top[-1] = top[-1] * top[0];
+        --top;
+        break;
+      case kDivide:
+        if (top[0] != 0)
+          top[-1] = top[-1] / top[0];
+        --top;
+        break;
+      case kModulo:
+        if (top[0] != 0)
+          top[-1] = top[-1] % top[0];
+        --top;
+        break;
+      case kBitAnd:
+        top[-1] = top[-1] & top[0];
+        --top;
+        break;
+      case kBitOr:
+        top[-1] = top[-1] | top[0];
+        --top;
+        break;
+      case kBitXor:
+        top[-1] = top[-1] ^ top[0];
+        --top;
+        break;
+      case kShiftLeft:
+        top[-1] = top[-1] << top[0];
+        --top;
+        break;
+      case kShiftRight:
+        top[-1] = top[-1] >> top[0];
+        --top;
+        break;
+      case kEqual:
+        top[-1] = top[-1] == top[0];
+        --top;
+        break;
+      case kNotEqual:
+        top[-1] = top[-1] != top[0];
+        --top;
+        break;
+      case kLessOrEqual:
+        top[-1] = top[-1] <= top[0];
+        --top;
+        break;
+      case kLess:
+        top[-1] = top[-1] < top[0];
+        --top;
+        break;
+      case kGreaterOrEqual:
+        top[-1] = top[-1] >= top[0];
+        --top;
+        break;
+      case kGreater:
+        top[-1] = top[-1] > top[0];
+        --top;
+        break;
+      case kLogicalAnd:
+        top[-1] = top[-1] && top[0];
+        --top;
+        break;
+      case kLogicalOr:
+        top[-1] = top[-1] || top[0];
+        --top;
+        break;
+    }
+  }
+
+  return *top;
+}
+
+void CompiledExpression::EmitConstant(int value) {
+  Push({kConstant, 0, 0, 0, value, -1}, 1);
+}
+
+void CompiledExpression::EmitLoadStoreRegister() {
+  Push({kLoadStoreRegister, 0, 0, 0, 0, -1}, 1);
+}
+
+void CompiledExpression::EmitSetStoreRegister() {
+  Push({kSetStoreRegister, 0, 0, 0, 0, -1}, 0);
+}
+
+bool CompiledExpression::EmitLoad(int type, int location) {
+  IntMemRef ref(type, location);
+  int word, shift, mask;
+  if (ref.bank() < 0 || ref.bank() > INTL_LOCATION ||
+      ref.type() > kMaxAccessType ||
+      !LocateInt(ref.type(), location, &word, &shift, &mask))
+    return false;
+
+  Push({kLoad, static_cast<uint8_t>(ref.bank()),
+        static_cast<uint8_t>(ref.type()), static_cast<uint8_t>(shift), word,
+        mask},
+       1);
+  return true;
+}
+
+bool CompiledExpression::EmitStore(int type, int location) {
+  if (!EmitLoad(type, location))
+    return false;
+  code_.back().opcode = kStore;
+  depth_ -= 1;
+  return true;
+}
+
+bool CompiledExpression::EmitLoadIndexed(int type) {
+  return EmitIndexed(kLoadIndexed, type, 0);
+}
+
+bool CompiledExpression::EmitStoreIndexed(int type) {
+  return EmitIndexed(kStoreIndexed, type, -1);
+}
+
+bool CompiledExpression::EmitBinary(char operation) {
+  Opcode opcode;
+  switch (operation) {
+    case 0:
+    case 20:
+      opcode = kAdd;
+      break;
+    case 1:
+    case 21:
+      opcode = kSubtract;
+      break;
+    case 2:
+    case 22:
+      opcode = kMultiply;
+      break;
+    case 3:
+    case 23:
+      opcode = kDivide;
+      break;
+    case 4:
+    case 24:
+      opcode = kModulo;
+      break;
+    case 5:
+    case 25:
+      opcode = kBitAnd;
+      break;
+    case 6:
+    case 26:
+      opcode = kBitOr;
+      break;
+    case 7:
+    case 27:
+      opcode = kBitXor;
+      break;
+    case 8:
+    case 28:
+      opcode = kShiftLeft;
+      break;
+    case 9:
+    case 29:
+      opcode = kShiftRight;
+      break;
+    case 40:
+      opcode = kEqual;
+      break;
+    case 41:
+      opcode = kNotEqual;
+      break;
+    case 42:
+      opcode = kLessOrEqual;
+      break;
+    case 43:
+      opcode = kLess;
+      break;
+    case 44:
+      opcode = kGreaterOrEqual;
+      break;
+    case 45:
+      opcode = kGreater;
+      break;
+    case 60:
+      opcode = kLogicalAnd;
+      break;
+    case 61:
+      opcode = kLogicalOr;
+      break;
+    default:
+      return false;
+  }
+
+  size_t n = code_.size();
+  if (n >= 2 && code_[n - 2].opcode == kConstant &&
+      code_[n - 1].opcode == kConstant) {
+    code_[n - 2].operand = PerformBinaryOperationOn(
+        operation, code_[n - 2].operand, code_[n - 1].operand);
+    code_.pop_back();
+    depth_ -= 1;
+    return true;
+  }
+
+  Push({opcode, 0, 0, 0, 0, -1}, -1);
+  return true;
+}
+
+void CompiledExpression::EmitNegate() {
+  if (!code_.empty() && code_.back().opcode == kConstant) {
+    code_.back().operand = -code_.back().operand;
+    return;
+  }
+  Push({kNegate, 0, 0, 0, 0, -1}, 0);
+}
+
+void CompiledExpression::Push(const Instruction& instruction,
+                              int stack_effect) {
+  code_.push_back(instruction);
+  depth_ += stack_effect;
+  max_depth_ = std::max(max_depth_, depth_);
+}
+
+bool CompiledExpression::EmitIndexed(Opcode opcode,
+                                     int type,
+                                     int stack_effect) {
+  IntMemRef ref(type, 0);
+  if (ref.bank() < 0 || ref.bank() > INTL_LOCATION ||
+      ref.type() > kMaxAccessType)
+    return false;
+
+  Push({opcode, static_cast<uint8_t>(ref.bank()),
+        static_cast<uint8_t>(ref.type()), 0, 0, -1},
+       stack_effect);
+  return true;
+}
+
+}  // namespace libreallive
@@ -0,0 +1,165 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of libreallive, a dependency of RLVM.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (c) 2026 agent <agent@local>
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use, copy,
+// modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// -----------------------------------------------------------------------
+
+#ifndef SRC_LIBREALLIVE_COMPILED_EXPRESSION_H_
+#define SRC_LIBREALLIVE_COMPILED_EXPRESSION_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "libreallive/expression.h"
+
+class RLMachine;
+
+namespace libreallive {
+
+// An integer expression lowered from an IExpression tree into a flat array of
+// stack machine instructions. Constant subexpressions are folded, and memory
+// references have their bank, access width and (where the location is a
+// constant) bit position decoded ahead of time, so evaluation is one tight
+// loop with no virtual calls or IntMemRef decoding.
+//
+// Evaluation has the same results and side effects, in the same order, as
+// calling GetIntegerValue() on the tree it was compiled from; a compound
+// assignment to an indexed location evaluates the location twice, once to
+// read and once to write, just as the tree does. Anything the compiler
+// can't prove that for (string values, complex parameters, unusual memory
+// banks, out of range constant locations) makes Compile() fail, and the tree
+// is evaluated as before.
+class CompiledExpression {
+ public:
+  // Lowers |expression|. Returns nullptr if it can't be compiled.
+  static std::unique_ptr<CompiledExpression> Compile(
+      const IExpression& expression);
+
+  // Returns |expression| with GetIntegerValue() routed through its compiled
+  // form, or |expression| itself when compiling wouldn't help.
+  static Expression WithCompiledForm(const Expression& expression);
+
+  int Evaluate(RLMachine& machine) const;
+
+  // The number of instructions.
+  size_t size() const { return code_.size(); }
+
+  // Whether the expression folded down to a single constant.
+  bool is_constant() const;
+
+  // Code generation. These are called from IExpression::Compile() overrides
+  // and return false when the requested operation can't be compiled. |type|
+  // is a memory reference type as it appears in the bytecode.
+
+  // Pushes |value|.
+  void EmitConstant(int value);
+
+  // Pushes the store register, or sets it to the top of the stack.
+  void EmitLoadStoreRegister();
+  void EmitSetStoreRegister();
+
+  // Pushes the integer at a constant location, or sets it to the top of the
+  // stack.
+  bool EmitLoad(int type, int location);
+  bool EmitStore(int type, int location);
+
+  // Pops a location and pushes the integer there.
+  bool EmitLoadIndexed(int type);
+
+  // Pops a location and then a value and stores the value, leaving it on the
+  // stack.
+  bool EmitStoreIndexed(int type);
+
+  // Applies a RealLive binary operator (0-9, 20-29, 40-45, 60-61) or negation
+  // to the top of the stack.
+  bool EmitBinary(char operation);
+  void EmitNegate();
+
+ private:
+  enum Opcode : uint8_t {
+    kConstant,
+    kLoadStoreRegister,
+    kSetStoreRegister,
+    kLoad,
+    kStore,
+    kLoadIndexed,
+    kStoreIndexed,
+    kNegate,
+    kAdd,
+    kSubtract,
+    kMultiply,
+    kDivide,
+    kModulo,
+    kBitAnd,
+    kBitOr,
+    kBitXor,
+    kShiftLeft,
+    kShiftRight,
+    kEqual,
+    kNotEqual,
+    kLessOrEqual,
+    kLess,
+    kGreaterOrEqual,
+    kGreater,
+    kLogicalAnd,
+    kLogicalOr,
+  };
+
+  struct Instruction {
+    Opcode opcode;
+    uint8_t bank;
+    uint8_t access;
+    uint8_t shift;
+
+    // The constant, or the index into the bank of the int holding the value.
+    int operand;
+
+    // Mask of the value's bits once shifted down; -1 for full width ints.
+    int mask;
+  };
+
+  // The most stack slots an expression may use. Deeper expressions stay
+  // uncompiled.
+  static const int kMaxStackDepth = 32;
+
+  CompiledExpression() = default;
+
+  void Push(const Instruction& instruction, int stack_effect);
+  bool EmitIndexed(Opcode opcode, int type, int stack_effect);
+
+  std::vector<Instruction> code_;
+  int depth_ = 0;
+  int max_depth_ = 0;
+};
+
+}  // namespace libreallive
+
+#endif  // SRC_LIBREALLIVE_COMPILED_EXPRESSION_H_
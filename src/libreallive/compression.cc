@@ -33,14 +33,33 @@
 
 #include "libreallive/compression.h"
 
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <memory>
 #include <string>
 
+#include "utilities/cpu_dispatch.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if RLVM_HAVE_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 namespace libreallive {
 namespace compression {
 
 /* RealLive uses a rather basic XOR encryption scheme, to which this
  * is the key. */
-static char xor_mask[256] = {
+const char xor_mask[256] = {
     0x8b, 0xe5, 0x5d, 0xc3, 0xa1, 0xe0, 0x30, 0x44, 0x00, 0x85, 0xc0, 0x74,
     0x09, 0x5f, 0x5e, 0x33, 0xc0, 0x5b, 0x8b, 0xe5, 0x5d, 0xc3, 0x8b, 0x45,
     0x0c, 0x85, 0xc0, 0x75, 0x14, 0x8b, 0x55, 0xec, 0x83, 0xc2, 0x20, 0x52,
@@ -114,12 +133,230 @@ const XorKey kud_wafter_all_ages_xor_mask[] = {
 
 // -----------------------------------------------------------------------
 
+namespace {
+
+// XOR kernels: dst[i] = src[i] ^ key[i] for |n| bytes. The buffers may
+// alias exactly (dst == src) but must not otherwise overlap.
+typedef void (*XorKernel)(char* dst, const char* src, const char* key,
+                          size_t n);
+
+void XorScalar(char* dst, const char* src, const char* key, size_t n) {
+  for (size_t i = 0; i < n; ++i)
+    dst[i] = src[i] ^ key[i];
+}
+
+#if defined(__SSE2__)
+void XorSSE2(char* dst, const char* src, const char* key, size_t n) {
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(key + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_xor_si128(a, b));
+  }
+  XorScalar(dst + i, src + i, key + i, n - i);
+}
+#endif
+
+#if RLVM_HAVE_X86_KERNELS
+__attribute__((target("avx2"))) void XorAVX2(char* dst,
+                                             const char* src,
+                                             const char* key,
+                                             size_t n) {
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+    __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(key + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i),
+                        _mm256_xor_si256(a, b));
+  }
+  XorScalar(dst + i, src + i, key + i, n - i);
+}
+#endif
+
+#if defined(__ARM_NEON)
+void XorNEON(char* dst, const char* src, const char* key, size_t n) {
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    uint8x16_t a = vld1q_u8(reinterpret_cast<const uint8_t*>(src + i));
+    uint8x16_t b = vld1q_u8(reinterpret_cast<const uint8_t*>(key + i));
+    vst1q_u8(reinterpret_cast<uint8_t*>(dst + i), veorq_u8(a, b));
+  }
+  XorScalar(dst + i, src + i, key + i, n - i);
+}
+#endif
+
+struct KernelChoice {
+  XorKernel kernel;
+  const char* name;
+};
+
+KernelChoice SelectXorKernel() {
+#if RLVM_HAVE_X86_KERNELS
+  if (CpuHasAVX2())
+    return {XorAVX2, "avx2"};
+#endif
+#if defined(__SSE2__)
+  return {XorSSE2, "sse2"};
+#elif defined(__ARM_NEON)
+  return {XorNEON, "neon"};
+#else
+  return {XorScalar, "scalar"};
+#endif
+}
+
+const KernelChoice& CurrentKernel() {
+  static const KernelDispatch<KernelChoice> kernels(SelectXorKernel,
+                                                    {XorScalar, "scalar"});
+  return kernels.get();
+}
+
+// xor_mask twice over, so any 256 byte window of it is contiguous.
+const char* RepeatedXorMask() {
+  static const std::array<char, 512> mask = [] {
+    std::array<char, 512> m;
+    memcpy(m.data(), xor_mask, 256);
+    memcpy(m.data() + 256, xor_mask, 256);
+    return m;
+  }();
+  return mask.data();
+}
+
+// XORs |n| bytes of |src| starting at stream position |pos| against |key|,
+// which repeats every |period| bytes and is stored at least |period| + 256
+// bytes long.
+void XorWithRepeatingKey(XorKernel kernel,
+                         char* dst,
+                         const char* src,
+                         size_t n,
+                         const char* key,
+                         size_t period,
+                         size_t pos) {
+  size_t phase = pos % period;
+  for (size_t done = 0; done < n;) {
+    size_t chunk = std::min<size_t>(n - done, 256);
+    kernel(dst + done, src + done, key + phase, chunk);
+    done += chunk;
+    phase = (phase + chunk) % period;
+  }
+}
+
+// Copies a back reference |distance| bytes behind |dst|. Copies that do not
+// overlap their source go through memcpy(); short distances repeat a
+// pattern and have to be copied forward a byte at a time.
+inline void CopyMatch(char* dst, size_t distance, size_t count) {
+  const char* repeat = dst - distance;
+  if (distance >= count) {
+    memcpy(dst, repeat, count);
+  } else {
+    for (size_t i = 0; i < count; ++i)
+      dst[i] = repeat[i];
+  }
+}
+
+}  // namespace
+
+const char* XorKernelName() {
+  return CurrentKernel().name;
+}
+
 // Decompress an archived file.
+//
+// The whole input is unmasked up front with the vector XOR kernel. The
+// decoder then takes a fast path for every eight token group that is far
+// enough from both ends of the buffers to skip the per token bounds checks.
 void Decompress(const char* src,
                 size_t src_len,
                 char* dst,
                 size_t dst_len,
                 const XorKey* per_game_xor_key) {
+  const XorKernel kernel = CurrentKernel().kernel;
+
+  // The mask position advances with every byte read, starting at 8 for the
+  // byte at offset 8, so byte |i| of the input is always masked by
+  // xor_mask[i % 256].
+  const size_t in_len = src_len > 8 ? src_len - 8 : 0;
+  unsigned char stack_buffer[16 * 1024];
+  std::unique_ptr<unsigned char[]> heap_buffer;
+  unsigned char* plain = stack_buffer;
+  if (in_len > sizeof(stack_buffer)) {
+    heap_buffer.reset(new unsigned char[in_len]);
+    plain = heap_buffer.get();
+  }
+  XorWithRepeatingKey(kernel, reinterpret_cast<char*>(plain), src + 8, in_len,
+                      RepeatedXorMask(), 256, 8);
+
+  const unsigned char* in = plain;
+  const unsigned char* const inend = in + in_len;
+  char* const dststart = dst;
+  char* const dstend = dst + dst_len;
+
+  // A group is one flag byte followed by at most 16 bytes of tokens, and it
+  // writes at most 8 * 17 bytes.
+  const ptrdiff_t kMaxGroupInput = 1 + 16;
+  const ptrdiff_t kMaxGroupOutput = 8 * 17;
+
+  while (in < inend && dst < dstend) {
+    unsigned int flag = *in++;
+    if (inend - in >= kMaxGroupInput - 1 && dstend - dst >= kMaxGroupOutput) {
+      if (flag == 0xff) {
+        memcpy(dst, in, 8);
+        in += 8;
+        dst += 8;
+        continue;
+      }
+      for (int i = 0; i < 8; ++i, flag >>= 1) {
+        if (flag & 1) {
+          *dst++ = *in++;
+        } else {
+          size_t count = in[0] | (in[1] << 8);
+          in += 2;
+          size_t distance = count >> 4;
+          count = (count & 0x0f) + 2;
+          if (distance == 0 || distance > size_t(dst - dststart))
+            throw Error("corrupt data");
+          CopyMatch(dst, distance, count);
+          dst += count;
+        }
+      }
+    } else {
+      for (int i = 0; i < 8 && in < inend && dst < dstend; ++i, flag >>= 1) {
+        if (flag & 1) {
+          *dst++ = *in++;
+        } else {
+          if (inend - in < 2)
+            throw Error("corrupt data");
+          size_t count = in[0] | (in[1] << 8);
+          in += 2;
+          size_t distance = count >> 4;
+          count = std::min<size_t>((count & 0x0f) + 2, dstend - dst);
+          if (distance == 0 || distance > size_t(dst - dststart))
+            throw Error("corrupt data");
+          CopyMatch(dst, distance, count);
+          dst += count;
+        }
+      }
+    }
+  }
+
+  if (per_game_xor_key) {
+    char key[16 + 256];
+    for (; per_game_xor_key->xor_offset != -1; per_game_xor_key++) {
+      for (size_t i = 0; i < sizeof(key); i += 16)
+        memcpy(key + i, per_game_xor_key->xor_key, 16);
+      char* start = dststart + per_game_xor_key->xor_offset;
+      if (start >= dstend)
+        continue;
+      size_t n = std::min<size_t>(per_game_xor_key->xor_length, dstend - start);
+      XorWithRepeatingKey(kernel, start, start, n, key, 16, 0);
+    }
+  }
+}
+
+void DecompressReference(const char* src,
+                         size_t src_len,
+                         char* dst,
+                         size_t dst_len,
+                         const XorKey* per_game_xor_key) {
   int bit = 1;
   const char* srcend = src + src_len;
   char* dststart = dst;
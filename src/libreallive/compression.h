@@ -36,6 +36,10 @@
 namespace libreallive {
 namespace compression {
 
+// The key every scenario's compressed bytecode is XORed with. Byte |i| of the
+// compressed stream uses xor_mask[i % 256].
+extern const char xor_mask[256];
+
 // An individual xor key; some games use multiple ones.
 struct XorKey {
   char xor_key[16];
@@ -52,9 +56,22 @@ extern const XorKey snow_standard_edition_xor_mask[];
 extern const XorKey kud_wafter_xor_mask[];
 extern const XorKey kud_wafter_all_ages_xor_mask[];
 
+// Decompresses |src| into |dst|, then applies |per_game_xor_key| (which may
+// be NULL). Output past |dst_len| is dropped. Throws Error on a back
+// reference outside the output or on input that ends inside a token.
 void Decompress(const char* src, size_t src_len, char* dst, size_t dst_len,
                 const XorKey* per_game_xor_key);
 
+// The original bit at a time decoder, kept as the reference Decompress() is
+// tested and benchmarked against. Unlike Decompress(), it trusts its input to
+// end on a token boundary and |dst| to have room for the last back reference.
+void DecompressReference(const char* src, size_t src_len, char* dst,
+                         size_t dst_len, const XorKey* per_game_xor_key);
+
+// Name of the XOR kernel Decompress() uses on this CPU: "avx2", "sse2",
+// "neon" or "scalar".
+const char* XorKernelName();
+
 }  // namespace compression
 }  // namespace libreallive
 
@@ -29,6 +29,10 @@
 // -----------------------------------------------------------------------
 
 #include "libreallive/elements/bytecode.h"
+
+#include <algorithm>
+
+#include "libreallive/bytecode_arena.h"
 #include "machine/rlmachine.h"
 
 namespace libreallive{
@@ -37,11 +41,44 @@ namespace libreallive{
 // ConstructionData
 // -----------------------------------------------------------------------
 
+static bool StartsBefore(const std::pair<unsigned long, size_t>& entry,
+                         unsigned long offset) {
+  return entry.first < offset;
+}
+
 ConstructionData::ConstructionData(size_t kt, pointer_t pt)
     : kidoku_table(kt), null(pt) {}
 
 ConstructionData::~ConstructionData() {}
 
+void* ConstructionData::Allocate(size_t size, size_t alignment) {
+  if (arena)
+    return arena->Allocate(size, alignment);
+  return ::operator new(size);
+}
+
+void ConstructionData::AddOffset(unsigned long offset, size_t index) {
+  if (offsets.empty() || offsets.back().first < offset) {
+    offsets.emplace_back(offset, index);
+    return;
+  }
+
+  auto it = std::lower_bound(offsets.begin(), offsets.end(), offset,
+                             StartsBefore);
+  if (it != offsets.end() && it->first == offset)
+    it->second = index;
+  else
+    offsets.emplace(it, offset, index);
+}
+
+pointer_t ConstructionData::GetPointer(unsigned long offset) const {
+  auto it = std::lower_bound(offsets.begin(), offsets.end(), offset,
+                             StartsBefore);
+  if (!elements || it == offsets.end() || it->first != offset)
+    throw Error("Pointer to an offset with no bytecode element");
+  return elements->begin() + it->second;
+}
+
 // -----------------------------------------------------------------------
 // BytecodeElement
 // -----------------------------------------------------------------------
@@ -31,9 +31,10 @@
 #ifndef SRC_LIBREALLIVE_ELEMENTS_BYTECODE_H_
 #define SRC_LIBREALLIVE_ELEMENTS_BYTECODE_H_
 
+#include <new>
 #include <ostream>
 #include <string>
-#include <map>
+#include <utility>
 #include <vector>
 
 #include "libreallive/bytecode_fwd.h"
@@ -43,17 +44,52 @@ class RLMachine;
 namespace libreallive{
   class Script;
   
-  struct ConstructionData {
+struct ConstructionData {
   ConstructionData(size_t kt, pointer_t pt);
   ~ConstructionData();
 
+  // Returns storage for a new element. Comes from |arena| when one is set, in
+  // which case the Script owns the element; otherwise it comes from the heap
+  // and the caller must delete the element.
+  void* Allocate(size_t size, size_t alignment);
+
+  // Constructs a T in storage from Allocate().
+  template <typename T, typename... Args>
+  T* Create(Args&&... args) {
+    void* storage = Allocate(sizeof(T), alignof(T));
+    try {
+      return new (storage) T(std::forward<Args>(args)...);
+    } catch (...) {
+      if (!arena)
+        ::operator delete(storage);
+      throw;
+    }
+  }
+
+  // Records that the element starting at byte |offset| of the bytecode is
+  // element number |index| in |elements|.
+  void AddOffset(unsigned long offset, size_t index);
+
+  // Returns the element starting at byte |offset|. Only valid once every
+  // element has been read, since |elements| may still reallocate until then.
+  pointer_t GetPointer(unsigned long offset) const;
+
   std::vector<unsigned long> kidoku_table;
   pointer_t null;
-  typedef std::map<unsigned long, pointer_t> offsets_t;
-  offsets_t offsets;
+
+  BytecodeArena* arena = nullptr;
+  BytecodeList* elements = nullptr;
+
+  // (byte offset, element index) for every element read so far, sorted by
+  // offset. Elements arrive in bytecode order, so this is appended to and
+  // binary searched, and costs memory per element rather than per byte.
+  std::vector<std::pair<unsigned long, size_t>> offsets;
+
+  // The character that starts an entrypoint marker. Becomes '!' once this
+  // scenario has used one, after which a '!' also ends a run of text.
+  char entrypoint_marker = '@';
 };
 
-// Base classes for bytecode elements.
 class BytecodeElement {
  public:
   static const int kInvalidEntrypoint = -999;
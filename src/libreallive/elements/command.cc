@@ -32,6 +32,7 @@
 #include <vector>
 
 #include "libreallive/elements/command.h"
+#include "libreallive/compiled_expression.h"
 #include "machine/rlmachine.h"
 
 namespace libreallive {
@@ -47,12 +48,8 @@ Pointers::~Pointers() {}
 void Pointers::SetPointers(ConstructionData& cdata) {
   assert(target_ids.size() != 0);
   targets.reserve(target_ids.size());
-  for (unsigned int i = 0; i < target_ids.size(); ++i) {
-    ConstructionData::offsets_t::const_iterator it =
-        cdata.offsets.find(target_ids[i]);
-    assert(it != cdata.offsets.end());
-    targets.push_back(it->second);
-  }
+  for (unsigned int i = 0; i < target_ids.size(); ++i)
+    targets.push_back(cdata.GetPointer(target_ids[i]));
   target_ids.clear();
 }
 
@@ -79,6 +76,11 @@ bool CommandElement::AreParametersParsed() const {
 void CommandElement::SetParsedParameters(
     ExpressionPiecesVector parsedParameters) const {
   parsed_parameters_ = std::move(parsedParameters);
+
+  // Parameters are parsed once and then evaluated every time the command
+  // runs, so it's worth lowering the integer ones.
+  for (Expression& parameter : parsed_parameters_)
+    parameter = CompiledExpression::WithCompiledForm(parameter);
 }
 
 const ExpressionPiecesVector& CommandElement::GetParsedParameters() const {
@@ -120,14 +122,11 @@ void CommandElement::RunOnMachine(RLMachine& machine) const {
 
 SelectElement::SelectElement(const char* src)
     : CommandElement(src), uselessjunk(0) {
-  repr.assign(src, 8);
-
+  const char* start = src;
   src += 8;
-  if (*src == '(') {
-    const int elen = NextExpression(src);
-    repr.append(src, elen);
-    src += elen;
-  }
+  if (*src == '(')
+    src += NextExpression(src);
+  repr = std::string_view(start, src - start);
 
   if (*src++ != '{')
     throw Error("SelectElement(): expected `{'");
@@ -152,7 +151,7 @@ SelectElement::SelectElement(const char* src)
         Condition c;
         if (*src == '(') {
           int len = NextExpression(src);
-          c.condition = string(src, len);
+          c.condition = std::string_view(src, len);
           src += len;
         }
         bool seekarg = *src != '2' && *src != '3';
@@ -160,7 +159,7 @@ SelectElement::SelectElement(const char* src)
         ++src;
         if (seekarg && *src != ')' && (*src < '0' || *src > '9')) {
           int len = NextExpression(src);
-          c.effect_argument = string(src, len);
+          c.effect_argument = std::string_view(src, len);
           src += len;
         }
         cond_parsed.push_back(c);
@@ -202,7 +201,7 @@ SelectElement::~SelectElement() {}
 
 Expression SelectElement::GetWindowExpression() const {
   if (repr[8] == '(') {
-    const char* location = repr.c_str() + 9;
+    const char* location = repr.data() + 9;
     return GetExpression(location);
   }
   return ExpressionFactory::IntConstant(-1);
@@ -212,7 +211,7 @@ const size_t SelectElement::GetParamCount() const { return params.size(); }
 
 string SelectElement::GetParam(int i) const {
   string rv(params[i].cond_text);
-  rv.append(params[i].text);
+  rv.append(params[i].text.data(), params[i].text.size());
   return rv;
 }
 
@@ -230,9 +229,17 @@ const size_t SelectElement::GetBytecodeLength() const {
 
 // static
 CommandElement* FunctionFactory::BuildFunctionElement(const char* stream) {
+  ConstructionData cdata(0, pointer_t());
+  return BuildFunctionElement(stream, cdata);
+}
+
+// static
+CommandElement* FunctionFactory::BuildFunctionElement(
+    const char* stream,
+    ConstructionData& cdata) {
   const char* ptr = stream;
   ptr += 8;
-  std::vector<std::string> params;
+  std::vector<std::string_view> params;
   if (*ptr == '(') {
     const char* end = ptr + 1;
     while (*end != ')') {
@@ -243,11 +250,11 @@ CommandElement* FunctionFactory::BuildFunctionElement(const char* stream) {
   }
 
   if (params.size() == 0)
-    return new VoidFunctionElement(stream);
+    return cdata.Create<VoidFunctionElement>(stream);
   else if (params.size() == 1)
-    return new SingleArgFunctionElement(stream, params.front());
+    return cdata.Create<SingleArgFunctionElement>(stream, params.front());
   else
-    return new FunctionElement(stream, params);
+    return cdata.Create<FunctionElement>(stream, std::move(params));
 }
 
 BytecodeElement* FunctionFactory::ReadFunction(const char* stream,
@@ -262,7 +269,7 @@ BytecodeElement* FunctionFactory::ReadFunction(const char* stream,
     case 0x00050005:
     case 0x00060001:
     case 0x00060005:
-      return new GotoElement(stream, cdata);
+      return cdata.Create<GotoElement>(stream, cdata);
     case 0x00010001:
     case 0x00010002:
     case 0x00010006:
@@ -274,24 +281,24 @@ BytecodeElement* FunctionFactory::ReadFunction(const char* stream,
     case 0x00060002:
     case 0x00060006:
     case 0x00060007:
-      return new GotoIfElement(stream, cdata);
+      return cdata.Create<GotoIfElement>(stream, cdata);
     case 0x00010003:
     case 0x00010008:
     case 0x00050003:
     case 0x00050008:
     case 0x00060003:
     case 0x00060008:
-      return new GotoOnElement(stream, cdata);
+      return cdata.Create<GotoOnElement>(stream, cdata);
     case 0x00010004:
     case 0x00010009:
     case 0x00050004:
     case 0x00050009:
     case 0x00060004:
     case 0x00060009:
-      return new GotoCaseElement(stream, cdata);
+      return cdata.Create<GotoCaseElement>(stream, cdata);
     case 0x00010010:
     case 0x00060010:
-      return new GosubWithElement(stream, cdata);
+      return cdata.Create<GosubWithElement>(stream, cdata);
 
       // Select elements.
     case 0x00020000:
@@ -299,15 +306,15 @@ BytecodeElement* FunctionFactory::ReadFunction(const char* stream,
     case 0x00020002:
     case 0x00020003:
     case 0x00020010:
-      return new SelectElement(stream);
+      return cdata.Create<SelectElement>(stream);
   }
   // default:
-  return BuildFunctionElement(stream);
+  return BuildFunctionElement(stream, cdata);
 }
 
 FunctionElement::FunctionElement(const char* src,
-                                 const std::vector<string>& params)
-    : CommandElement(src), params(params) {}
+                                 std::vector<std::string_view> params)
+    : CommandElement(src), params(std::move(params)) {}
 
 FunctionElement::~FunctionElement() {}
 
@@ -318,19 +325,21 @@ const size_t FunctionElement::GetParamCount() const {
   // dropping the parameter will put the stream cursor in the wrong place), so
   // hack this here.
   if (!params.empty()) {
-    string final = params.back();
+    std::string_view final = params.back();
     if (final.size() == 3 && final[0] == '\n')
       return params.size() - 1;
   }
   return params.size();
 }
 
-string FunctionElement::GetParam(int i) const { return params[i]; }
+string FunctionElement::GetParam(int i) const {
+  return std::string(params[i]);
+}
 
 const size_t FunctionElement::GetBytecodeLength() const {
   if (params.size() > 0) {
     size_t rv(COMMAND_SIZE + 2);
-    for (std::string const& param : params)
+    for (std::string_view param : params)
       rv += param.size();
     return rv;
   } else {
@@ -344,8 +353,8 @@ std::string FunctionElement::GetSerializedCommand(RLMachine& machine) const {
     rv.push_back(command[i]);
   if (params.size() > 0) {
     rv.push_back('(');
-    for (string const& param : params) {
-      const char* data = param.c_str();
+    for (std::string_view param : params) {
+      const char* data = param.data();
       Expression expression(GetData(data));
       rv.append(expression->GetSerializedExpression(machine));
     }
@@ -384,7 +393,7 @@ std::string VoidFunctionElement::GetSerializedCommand(
 // -----------------------------------------------------------------------
 
 SingleArgFunctionElement::SingleArgFunctionElement(const char* src,
-                                                   const std::string& arg)
+                                                   std::string_view arg)
     : CommandElement(src), arg_(arg) {}
 
 SingleArgFunctionElement::~SingleArgFunctionElement() {}
@@ -392,7 +401,7 @@ SingleArgFunctionElement::~SingleArgFunctionElement() {}
 const size_t SingleArgFunctionElement::GetParamCount() const { return 1; }
 
 string SingleArgFunctionElement::GetParam(int i) const {
-  return i == 0 ? arg_ : std::string();
+  return i == 0 ? std::string(arg_) : std::string();
 }
 
 const size_t SingleArgFunctionElement::GetBytecodeLength() const {
@@ -405,7 +414,7 @@ std::string SingleArgFunctionElement::GetSerializedCommand(
   for (int i = 0; i < COMMAND_SIZE; ++i)
     rv.push_back(command[i]);
   rv.push_back('(');
-  const char* data = arg_.c_str();
+  const char* data = arg_.data();
   Expression expression(GetData(data));
   rv.append(expression->GetSerializedExpression(machine));
   rv.push_back(')');
@@ -458,9 +467,7 @@ pointer_t GotoElement::GetPointer(int i) const {
 const size_t GotoElement::GetBytecodeLength() const { return 12; }
 
 void GotoElement::SetPointers(ConstructionData& cdata) {
-  ConstructionData::offsets_t::const_iterator it = cdata.offsets.find(id_);
-  assert(it != cdata.offsets.end());
-  pointer_ = it->second;
+  pointer_ = cdata.GetPointer(id_);
 }
 
 // -----------------------------------------------------------------------
@@ -469,18 +476,15 @@ void GotoElement::SetPointers(ConstructionData& cdata) {
 
 GotoIfElement::GotoIfElement(const char* src, ConstructionData& cdata)
     : CommandElement(src) {
-  repr.assign(src, 8);
+  const char* start = src;
   src += 8;
 
   if (*src++ != '(')
     throw Error("GotoIfElement(): expected `('");
-  int expr = NextExpression(src);
-  repr.push_back('(');
-  repr.append(src, expr);
-  repr.push_back(')');
-  src += expr;
+  src += NextExpression(src);
   if (*src++ != ')')
     throw Error("GotoIfElement(): expected `)'");
+  repr = std::string_view(start, src - start);
 
   id_ = read_i32(src);
 }
@@ -494,7 +498,8 @@ const size_t GotoIfElement::GetParamCount() const {
 
 string GotoIfElement::GetParam(int i) const {
   return i == 0
-             ? (repr.size() == 8 ? string() : repr.substr(9, repr.size() - 10))
+             ? (repr.size() == 8 ? string()
+                                 : string(repr.substr(9, repr.size() - 10)))
              : string();
 }
 
@@ -510,9 +515,7 @@ const size_t GotoIfElement::GetBytecodeLength() const {
 }
 
 void GotoIfElement::SetPointers(ConstructionData& cdata) {
-  ConstructionData::offsets_t::const_iterator it = cdata.offsets.find(id_);
-  assert(it != cdata.offsets.end());
-  pointer_ = it->second;
+  pointer_ = cdata.GetPointer(id_);
 }
 
 // -----------------------------------------------------------------------
@@ -521,12 +524,11 @@ void GotoIfElement::SetPointers(ConstructionData& cdata) {
 
 GotoCaseElement::GotoCaseElement(const char* src, ConstructionData& cdata)
     : PointerElement(src) {
-  repr.assign(src, 8);
+  const char* start = src;
   src += 8;
   // Condition
-  const int expr = NextExpression(src);
-  repr.append(src, expr);
-  src += expr;
+  src += NextExpression(src);
+  repr = std::string_view(start, src - start);
   // Cases
   if (*src++ != '{')
     throw Error("GotoCaseElement(): expected `{'");
@@ -537,7 +539,7 @@ GotoCaseElement::GotoCaseElement(const char* src, ConstructionData& cdata)
     if (src[0] != '(')
       throw Error("GotoCaseElement(): expected `('");
     if (src[1] == ')') {
-      cases.push_back("()");
+      cases.emplace_back(src, 2);
       src += 2;
     } else {
       int cexpr = NextExpression(src + 1);
@@ -561,12 +563,12 @@ const size_t GotoCaseElement::GetParamCount() const {
 }
 
 string GotoCaseElement::GetParam(int i) const {
-  return i == 0 ? repr.substr(8, repr.size() - 8) : string();
+  return i == 0 ? string(repr.substr(8)) : string();
 }
 
 const size_t GotoCaseElement::GetCaseCount() const { return cases.size(); }
 
-const string GotoCaseElement::GetCase(int i) const { return cases[i]; }
+const string GotoCaseElement::GetCase(int i) const { return string(cases[i]); }
 
 const size_t GotoCaseElement::GetBytecodeLength() const {
   size_t rv = repr.size() + 2;
@@ -581,12 +583,11 @@ const size_t GotoCaseElement::GetBytecodeLength() const {
 
 GotoOnElement::GotoOnElement(const char* src, ConstructionData& cdata)
     : PointerElement(src) {
-  repr.assign(src, 8);
+  const char* start = src;
   src += 8;
   // Condition
-  const int expr = NextExpression(src);
-  repr.append(src, expr);
-  src += expr;
+  src += NextExpression(src);
+  repr = std::string_view(start, src - start);
   // Pointers
   if (*src++ != '{')
     throw Error("GotoOnElement(): expected `{'");
@@ -605,7 +606,7 @@ GotoOnElement::~GotoOnElement() {}
 const size_t GotoOnElement::GetParamCount() const { return 1; }
 
 string GotoOnElement::GetParam(int i) const {
-  return i == 0 ? repr.substr(8, repr.size() - 8) : string();
+  return i == 0 ? string(repr.substr(8)) : string();
 }
 
 const size_t GotoOnElement::GetBytecodeLength() const {
@@ -644,7 +645,9 @@ const size_t GosubWithElement::GetParamCount() const {
   return params.size();
 }
 
-string GosubWithElement::GetParam(int i) const { return params[i]; }
+string GosubWithElement::GetParam(int i) const {
+  return std::string(params[i]);
+}
 
 const size_t GosubWithElement::GetPointersCount() const { return 1; }
 
@@ -658,9 +661,7 @@ const size_t GosubWithElement::GetBytecodeLength() const {
 }
 
 void GosubWithElement::SetPointers(ConstructionData& cdata) {
-  ConstructionData::offsets_t::const_iterator it = cdata.offsets.find(id_);
-  assert(it != cdata.offsets.end());
-  pointer_ = it->second;
+  pointer_ = cdata.GetPointer(id_);
 }
 
 }  // namespace libreallive
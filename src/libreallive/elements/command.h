@@ -31,12 +31,17 @@
 #ifndef SRC_LIBREALLIVE_ELEMENTS_COMMAND_H_
 #define SRC_LIBREALLIVE_ELEMENTS_COMMAND_H_
 
+#include <cstdint>
 #include <ostream>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #include "libreallive/elements/bytecode.h"
 #include "libreallive/expression.h"
 
+class RLOperation;
+
 namespace libreallive {
 
 class Pointers {
@@ -81,10 +86,22 @@ class CommandElement : public BytecodeElement {
   // Whether the RLOperation has cached the parsed versions of the parameters.
   bool AreParametersParsed() const;
 
-  // Gets/Sets the cached parameters.
+  // Gets/Sets the cached parameters. Integer parameters are cached with their
+  // CompiledExpression attached.
   void SetParsedParameters(ExpressionPiecesVector p) const;
   const ExpressionPiecesVector& GetParsedParameters() const;
 
+  // The RLOperation this command resolved to the last time it was executed,
+  // if that was on the RLMachine whose module table is |generation|;
+  // otherwise NULL. See RLMachine::ExecuteCommand().
+  RLOperation* GetCachedOperation(uint64_t generation) const {
+    return generation == cached_generation_ ? cached_operation_ : nullptr;
+  }
+  void SetCachedOperation(uint64_t generation, RLOperation* op) const {
+    cached_generation_ = generation;
+    cached_operation_ = op;
+  }
+
   // Returns the number of parameters.
   virtual const size_t GetParamCount() const = 0;
   virtual std::string GetParam(int index) const = 0;
@@ -107,6 +124,9 @@ class CommandElement : public BytecodeElement {
   unsigned char command[COMMAND_SIZE];
 
   mutable std::vector<Expression> parsed_parameters_;
+
+  mutable uint64_t cached_generation_ = 0;
+  mutable RLOperation* cached_operation_ = nullptr;
 };
 
 class SelectElement : public CommandElement {
@@ -117,16 +137,17 @@ class SelectElement : public CommandElement {
   static const int OPTION_BLANK = 0x33;
   static const int OPTION_CURSOR = 0x34;
 
+  // The strings in Condition and Param point into the Script's bytecode.
   struct Condition {
-    std::string condition;
+    std::string_view condition;
     uint8_t effect;
-    std::string effect_argument;
+    std::string_view effect_argument;
   };
 
   struct Param {
     std::vector<Condition> cond_parsed;
-    std::string cond_text;
-    std::string text;
+    std::string_view cond_text;
+    std::string_view text;
     int line;
     Param() : cond_text(), text(), line(0) {}
     Param(const char* tsrc, const size_t tlen, const int lnum)
@@ -161,7 +182,7 @@ class SelectElement : public CommandElement {
   virtual const size_t GetBytecodeLength() const final;
 
  private:
-  std::string repr;
+  std::string_view repr;
   params_t params;
   int firstline;
   int uselessjunk;
@@ -169,7 +190,9 @@ class SelectElement : public CommandElement {
 
 class FunctionElement : public CommandElement {
  public:
-  FunctionElement(const char* src, const std::vector<std::string>& params);
+  // |params| point into the Script's bytecode buffer, which must outlive this
+  // element.
+  FunctionElement(const char* src, std::vector<std::string_view> params);
   virtual ~FunctionElement();
 
   // Overridden from CommandElement:
@@ -181,7 +204,7 @@ class FunctionElement : public CommandElement {
   virtual std::string GetSerializedCommand(RLMachine& machine) const final;
 
  private:
-  std::vector<std::string> params;
+  std::vector<std::string_view> params;
 };
 
 class VoidFunctionElement : public CommandElement {
@@ -200,7 +223,7 @@ class VoidFunctionElement : public CommandElement {
 
 class SingleArgFunctionElement : public CommandElement {
  public:
-  SingleArgFunctionElement(const char* src, const std::string& arg);
+  SingleArgFunctionElement(const char* src, std::string_view arg);
   virtual ~SingleArgFunctionElement();
 
   // Overridden from CommandElement:
@@ -212,7 +235,7 @@ class SingleArgFunctionElement : public CommandElement {
   virtual std::string GetSerializedCommand(RLMachine& machine) const final;
 
  private:
-  std::string arg_;
+  std::string_view arg_;
 };
 
 class FunctionFactory {
@@ -220,8 +243,13 @@ class FunctionFactory {
   static BytecodeElement* ReadFunction(const char* stream,
                                        ConstructionData& cdata);
 
-  // Returns a representation of the non-special cased function.
+  // Returns a representation of the non-special cased function. The returned
+  // element refers into |stream| and is owned by the caller.
   static CommandElement* BuildFunctionElement(const char* stream);
+
+  // As above, but allocates the element through |cdata|.
+  static CommandElement* BuildFunctionElement(const char* stream,
+                                              ConstructionData& cdata);
 };
 
 class PointerElement : public CommandElement {
@@ -278,7 +306,7 @@ class GotoIfElement : public CommandElement {
  private:
   unsigned long id_;
   pointer_t pointer_;
-  std::string repr;
+  std::string_view repr;
 };
 
 class GotoCaseElement : public PointerElement {
@@ -296,8 +324,8 @@ class GotoCaseElement : public PointerElement {
   virtual const size_t GetBytecodeLength() const final;
 
  private:
-  std::string repr;
-  std::vector<std::string> cases;
+  std::string_view repr;
+  std::vector<std::string_view> cases;
 };
 
 class GotoOnElement : public PointerElement {
@@ -313,7 +341,7 @@ class GotoOnElement : public PointerElement {
   virtual const size_t GetBytecodeLength() const final;
 
  private:
-  std::string repr;
+  std::string_view repr;
 };
 
 class GosubWithElement : public CommandElement {
@@ -335,7 +363,7 @@ class GosubWithElement : public CommandElement {
   unsigned long id_;
   pointer_t pointer_;
   int repr_size;
-  std::vector<std::string> params;
+  std::vector<std::string_view> params;
 };
 
 }  // namespace libreallive
@@ -40,6 +40,7 @@ namespace libreallive{
   const char* end = src;
   parsed_expression_ = GetAssignment(end);
   length_ = std::distance(src, end);
+  compiled_ = CompiledExpression::Compile(*parsed_expression_);
 }
 
 ExpressionElement::ExpressionElement(const long val)
@@ -49,7 +50,8 @@ ExpressionElement::ExpressionElement(const long val)
 
 ExpressionElement::ExpressionElement(const ExpressionElement& rhs)
     : length_(0),
-      parsed_expression_(rhs.parsed_expression_) {
+      parsed_expression_(rhs.parsed_expression_),
+      compiled_(rhs.compiled_) {
 }
 
 ExpressionElement::~ExpressionElement() {}
@@ -58,6 +60,12 @@ Expression ExpressionElement::ParsedExpression() const {
   return parsed_expression_;
 }
 
+int ExpressionElement::Evaluate(RLMachine& machine) const {
+  if (compiled_)
+    return compiled_->Evaluate(machine);
+  return parsed_expression_->GetIntegerValue(machine);
+}
+
 void ExpressionElement::PrintSourceRepresentation(RLMachine* machine,
                                                   std::ostream& oss) const {
   oss << ParsedExpression()->GetDebugString() << std::endl;
@@ -31,6 +31,9 @@
 #ifndef SRC_LIBREALLIVE_ELEMENTS_EXPRESSION_H_
 #define SRC_LIBREALLIVE_ELEMENTS_EXPRESSION_H_
 
+#include <memory>
+
+#include "libreallive/compiled_expression.h"
 #include "libreallive/elements/bytecode.h"
 #include "libreallive/expression.h"
 
@@ -49,6 +52,9 @@ class ExpressionElement : public BytecodeElement {
   // Returns an ExpressionPiece representing this expression.
   Expression ParsedExpression() const;
 
+  // Evaluates the expression, through its compiled form when it has one.
+  int Evaluate(RLMachine& machine) const;
+
   // Overridden from BytecodeElement:
   virtual void PrintSourceRepresentation(RLMachine* machine,
                                          std::ostream& oss) const final;
@@ -61,6 +67,10 @@ class ExpressionElement : public BytecodeElement {
   // Storage for the parsed expression so we only have to calculate
   // it once (and so we can return it by const reference)
   Expression parsed_expression_;
+
+  // |parsed_expression_| lowered for fast evaluation; null when it couldn't
+  // be compiled.
+  std::shared_ptr<const CompiledExpression> compiled_;
 };
   
 }
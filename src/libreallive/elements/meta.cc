@@ -63,13 +63,37 @@ const int MetaElement::GetEntrypoint() const {
   return type_ == Entrypoint_ ? entrypoint_index_ : kInvalidEntrypoint;
 }
 
+void MetaElement::Fuse(int lines, int last_line, const BytecodeElement* next) {
+  fused_lines_ = lines;
+  fused_last_line_ = last_line;
+  fused_next_ = next;
+}
+
 void MetaElement::RunOnMachine(RLMachine& machine) const {
-  if (type_ == Line_)
-    machine.SetLineNumber(value_);
-  else if (type_ == Kidoku_)
-    machine.SetKidokuMarker(value_);
+  if (!machine.CanRunFusedElements()) {
+    if (type_ == Line_)
+      machine.SetLineNumber(value_);
+    else if (type_ == Kidoku_)
+      machine.SetKidokuMarker(value_);
 
+    machine.AdvanceInstructionPointer();
+    return;
+  }
+
+  if (type_ == Line_) {
+    // Without line actions, only the last of a run of line markers is
+    // observable.
+    machine.SetLineNumber(fused_lines_ ? fused_last_line_ : value_);
+    for (int i = 0; i < fused_lines_; ++i)
+      machine.AdvanceInstructionPointer();
+  } else if (type_ == Kidoku_) {
+    machine.SetKidokuMarker(value_);
+  }
   machine.AdvanceInstructionPointer();
+
+  // The instruction pointer now rests on |fused_next_|.
+  if (fused_next_ && !machine.halted())
+    fused_next_->RunOnMachine(machine);
 }
   
 }
@@ -43,6 +43,18 @@ class MetaElement : public BytecodeElement {
   const int value() const { return value_; }
   void set_value(const int value) { value_ = value; }
 
+  bool is_line() const { return type_ == Line_; }
+  bool is_kidoku() const { return type_ == Kidoku_; }
+
+  // Makes this marker a superinstruction; see Script::FuseElements(). A line
+  // marker absorbs the |lines| line markers directly after it, the last of
+  // which sets |last_line|. Either kind of marker may then run |next|, the
+  // element straight after it (or after its line markers), in the same step.
+  void Fuse(int lines, int last_line, const BytecodeElement* next);
+  int fused_lines() const { return fused_lines_; }
+  int fused_last_line() const { return fused_last_line_; }
+  const BytecodeElement* fused_next() const { return fused_next_; }
+
   // Overridden from BytecodeElement:
   virtual void PrintSourceRepresentation(RLMachine* machine,
                                          std::ostream& oss) const final;
@@ -55,6 +67,10 @@ class MetaElement : public BytecodeElement {
   MetaElementType type_;
   int value_;
   int entrypoint_index_;
+
+  int fused_lines_ = 0;
+  int fused_last_line_ = 0;
+  const BytecodeElement* fused_next_ = nullptr;
 };
 
 }
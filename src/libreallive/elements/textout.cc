@@ -36,16 +36,15 @@ namespace libreallive {
 // TextoutElement
 // -----------------------------------------------------------------------
 
-TextoutElement::TextoutElement(const char* src, const char* end) {
-  repr.assign(src, end);
-}
+TextoutElement::TextoutElement(const char* src, const char* end)
+    : repr(src, end - src) {}
 
 TextoutElement::~TextoutElement() {}
 
 const string TextoutElement::GetText() const {
   string rv;
   bool quoted = false;
-  string::const_iterator it = repr.cbegin();
+  std::string_view::const_iterator it = repr.cbegin();
   while (it != repr.cend()) {
     if (*it == '"') {
       ++it;
@@ -83,10 +82,10 @@ void TextoutElement::RunOnMachine(RLMachine& machine) const {
 // TextoutFactory
 // -----------------------------------------------------------------------
 
-extern char entrypoint_marker;
-
 // static
-TextoutElement* TextoutFactory::Read(const char* src, const char* file_end) {
+TextoutElement* TextoutFactory::Read(const char* src,
+                                     const char* file_end,
+                                     ConstructionData& cdata) {
   const char* end = src;
   bool quoted = false;
   while (end < file_end) {
@@ -101,7 +100,7 @@ TextoutElement* TextoutFactory::Read(const char* src, const char* file_end) {
 
       // new element
       if (!*end || *end == '#' || *end == '$' || *end == '\n' || *end == '@' ||
-          *end == entrypoint_marker)
+          *end == cdata.entrypoint_marker)
         break;
     }
 
@@ -110,7 +109,7 @@ TextoutElement* TextoutFactory::Read(const char* src, const char* file_end) {
     else
       ++end;
   }
-  return new TextoutElement(src, end);
+  return cdata.Create<TextoutElement>(src, end);
 }
 
 }  // namespace libreallive
@@ -33,6 +33,7 @@
 
 #include <ostream>
 #include <string>
+#include <string_view>
 
 #include "libreallive/elements/bytecode.h"
 
@@ -44,6 +45,8 @@ class TextoutFactory;
 class TextoutElement : public BytecodeElement {
  private:
   friend TextoutFactory;
+  friend ConstructionData;
+  // Refers to [src, file_end) of the Script's bytecode buffer.
   TextoutElement(const char* src, const char* file_end);
 
  public:
@@ -58,12 +61,14 @@ class TextoutElement : public BytecodeElement {
   virtual void RunOnMachine(RLMachine& machine) const final;
 
  private:
-  std::string repr;
+  std::string_view repr;
 };
 
 class TextoutFactory {
  public:
-  static TextoutElement* Read(const char* src, const char* file_end);
+  static TextoutElement* Read(const char* src,
+                              const char* file_end,
+                              ConstructionData& cdata);
 };
 }  // namespace libreallive
 
@@ -43,6 +43,7 @@
 #include <string>
 
 #include "libreallive/alldefs.h"
+#include "libreallive/compiled_expression.h"
 #include "libreallive/intmemref.h"
 #include "machine/reference.h"
 #include "machine/rlmachine.h"
@@ -535,6 +536,14 @@ void IExpression::AddContainedPiece(Expression piece) {
   throw Error("Request to AddContainedPiece() invalid!");
 }
 
+bool IExpression::CompileAssignment(CompiledExpression& code,
+                                    char operation,
+                                    const IExpression& rhs) const {
+  if (operation == 30)
+    return rhs.Compile(code);
+  return Compile(code) && rhs.Compile(code) && code.EmitBinary(operation);
+}
+
 // ----------------------------------------------------------------------
 // Store Register
 // ----------------------------------------------------------------------
@@ -565,6 +574,20 @@ class StoreRegisterEx : public IExpression {
   std::string GetSerializedExpression(RLMachine& machine) const override {
     return IntToBytecode(machine.store_register());
   }
+
+  bool Compile(CompiledExpression& code) const override {
+    code.EmitLoadStoreRegister();
+    return true;
+  }
+
+  bool CompileAssignment(CompiledExpression& code,
+                         char operation,
+                         const IExpression& rhs) const override {
+    if (!IExpression::CompileAssignment(code, operation, rhs))
+      return false;
+    code.EmitSetStoreRegister();
+    return true;
+  }
 };
 
 // ----------------------------------------------------------------------
@@ -584,6 +607,11 @@ class IntConstantEx : public IExpression {
     return IntToBytecode(value_);
   }
 
+  bool Compile(CompiledExpression& code) const override {
+    code.EmitConstant(value_);
+    return true;
+  }
+
   std::string GetDebugString() const override { return std::to_string(value_); }
 
  private:
@@ -707,6 +735,24 @@ class MemoryReferenceEx : public IExpression {
       return IntToBytecode(GetIntegerValue(machine));
   }
 
+  bool Compile(CompiledExpression& code) const override {
+    return location_->Compile(code) && code.EmitLoadIndexed(type_);
+  }
+
+  bool CompileAssignment(CompiledExpression& code,
+                         char operation,
+                         const IExpression& rhs) const override {
+    if (operation == 30) {
+      return rhs.Compile(code) && location_->Compile(code) &&
+             code.EmitStoreIndexed(type_);
+    }
+    // The tree evaluates |location_| once to read and again to write, so
+    // compile it twice too.
+    return location_->Compile(code) && code.EmitLoadIndexed(type_) &&
+           rhs.Compile(code) && code.EmitBinary(operation) &&
+           location_->Compile(code) && code.EmitStoreIndexed(type_);
+  }
+
  private:
   int type_;
   Expression location_;
@@ -775,6 +821,17 @@ class SimpleMemRefEx : public IExpression {
     return GetMemoryDebugString(type_, std::to_string(location_));
   }
 
+  bool Compile(CompiledExpression& code) const override {
+    return code.EmitLoad(type_, location_);
+  }
+
+  bool CompileAssignment(CompiledExpression& code,
+                         char operation,
+                         const IExpression& rhs) const override {
+    return IExpression::CompileAssignment(code, operation, rhs) &&
+           code.EmitStore(type_, location_);
+  }
+
  private:
   int type_;
   int location_;
@@ -948,21 +1005,19 @@ class BinaryExpressionEx : public IExpression {
   bool is_valid() const override { return true; }
 
   int GetIntegerValue(RLMachine& machine) const override {
-    if (operation_ >= 20 && operation_ < 30) {
-      int value =
-          PerformBinaryOperationOn(operation_, left_->GetIntegerValue(machine),
-                                   right_->GetIntegerValue(machine));
-      left_->SetIntegerValue(machine, value);
-      return value;
-    } else if (operation_ == 30) {
+    if (operation_ == 30) {
       int value = right_->GetIntegerValue(machine);
       left_->SetIntegerValue(machine, value);
       return value;
-    } else {
-      return PerformBinaryOperationOn(operation_,
-                                      left_->GetIntegerValue(machine),
-                                      right_->GetIntegerValue(machine));
     }
+
+    // Operands are evaluated left to right, as the compiled form does.
+    const int lhs = left_->GetIntegerValue(machine);
+    const int rhs = right_->GetIntegerValue(machine);
+    int value = PerformBinaryOperationOn(operation_, lhs, rhs);
+    if (operation_ >= 20 && operation_ < 30)
+      left_->SetIntegerValue(machine, value);
+    return value;
   }
 
   std::string GetSerializedExpression(RLMachine& machine) const override {
@@ -974,6 +1029,13 @@ class BinaryExpressionEx : public IExpression {
                                 right_->GetDebugString());
   }
 
+  bool Compile(CompiledExpression& code) const override {
+    if (operation_ >= 20 && operation_ <= 30)
+      return left_->CompileAssignment(code, operation_, *right_);
+    return left_->Compile(code) && right_->Compile(code) &&
+           code.EmitBinary(operation_);
+  }
+
  private:
   char operation_;
   Expression left_;
@@ -1009,6 +1071,14 @@ class UniaryEx : public IExpression {
     return str.str();
   }
 
+  bool Compile(CompiledExpression& code) const override {
+    if (!operand_->Compile(code))
+      return false;
+    if (operation_ == 0x01)
+      code.EmitNegate();
+    return true;
+  }
+
  private:
   char operation_;
   Expression operand_;
@@ -1056,6 +1126,11 @@ class SimpleAssignEx : public IExpression {
         std::to_string(value_));
   }
 
+  bool Compile(CompiledExpression& code) const override {
+    code.EmitConstant(value_);
+    return code.EmitStore(type_, location_);
+  }
+
  private:
   int type_;
   int location_;
@@ -53,6 +53,7 @@ size_t NextString(const char* src);
 size_t NextData(const char* src);
 
 // Parse expression functions
+class CompiledExpression;
 class IExpression;
 class ExpressionPiece;
 using Expression = std::shared_ptr<IExpression>;
@@ -68,6 +69,9 @@ Expression GetComplexParam(const char*& src);
 
 std::string EvaluatePRINT(RLMachine& machine, const std::string& in);
 
+// Applies one of RealLive's binary operators to two integers.
+int PerformBinaryOperationOn(char operation, int lhs, int rhs);
+
 // Converts a parameter string (as read from the binary SEEN.TXT file)
 // into a human readable (and printable) format.
 std::string ParsableToPrintableString(const std::string& src);
@@ -159,6 +163,18 @@ class IExpression {
   virtual int GetOverloadTag() const {
     throw Error("Request to GetOverloadTag() invalid!");
   }
+
+  // Appends instructions that push this expression's integer value onto
+  // |code|'s stack. Returns false by default; pieces that can't be compiled
+  // leave the whole expression to be evaluated as a tree.
+  virtual bool Compile(CompiledExpression& code) const { return false; }
+
+  // Appends instructions for the assignment |this| |operation| |rhs|, where
+  // |operation| is 20-30. The default treats |this| like a piece whose
+  // SetIntegerValue() does nothing.
+  virtual bool CompileAssignment(CompiledExpression& code,
+                                 char operation,
+                                 const IExpression& rhs) const;
 };
 
 class ExpressionFactory {
@@ -39,6 +39,7 @@
 #include <string>
 
 #include "libreallive/compression.h"
+#include "libreallive/scenario_cache.h"
 #include "utilities/exception.h"
 #include "utilities/gettext.h"
 #include "utilities/string_utilities.h"
@@ -115,7 +116,8 @@ Script::Script(const Header& hdr,
                const size_t length,
                const std::string& regname,
                bool use_xor_2,
-               const compression::XorKey* second_level_xor_key) {
+               const compression::XorKey* second_level_xor_key,
+               ScriptIndex* index) {
   // Kidoku/entrypoint table
   const int kidoku_offs = read_i32(data + 0x08);
   const size_t kidoku_length = read_i32(data + 0x0c);
@@ -142,53 +144,166 @@ Script::Script(const Header& hdr,
     }
   }
 
-  char* uncompressed = new char[dlen];
+  owned_bytecode_.reset(new char[dlen]);
   compression::Decompress(data + read_i32(data + 0x20), read_i32(data + 0x28),
-                          uncompressed, dlen, key);
+                          owned_bytecode_.get(), dlen, key);
+  bytecode_ = std::string_view(owned_bytecode_.get(), dlen);
+
+  cdat.arena = &arena_;
+  cdat.elements = &elts_;
+  // Elements average well over 16 bytes, so this rarely regrows.
+  cdat.offsets.reserve(dlen / 16 + 1);
+
   // Read bytecode
-  const char* stream = uncompressed;
-  const char* end = uncompressed + dlen;
+  const char* stream = bytecode_.data();
+  const char* end = bytecode_.data() + dlen;
   size_t pos = 0;
-  pointer_t it = elts_.before_begin();
-  while (pos < dlen) {
-    // Read element
-    it = elts_.emplace_after(it, BytecodeFactory::Read(stream, end, cdat));
-    cdat.offsets[pos] = it;
-
-    // Keep track of the entrypoints
-    int entrypoint = (*it)->GetEntrypoint();
-    if (entrypoint != BytecodeElement::kInvalidEntrypoint)
-      entrypoint_associations_.emplace(entrypoint, it);
-
-    // Advance
-    size_t l = (*it)->GetBytecodeLength();
-    if (l <= 0)
-      l = 1;  // Failsafe: always advance at least one byte.
-    stream += l;
-    pos += l;
+  std::vector<std::pair<int, size_t>> entrypoints;
+  try {
+    while (pos < dlen) {
+      // Read element
+      elts_.push_back(nullptr);
+      elts_.back() = BytecodeFactory::Read(stream, end, cdat);
+      BytecodeElement* element = elts_.back();
+      cdat.AddOffset(pos, elts_.size() - 1);
+
+      // Keep track of the entrypoints
+      int entrypoint = element->GetEntrypoint();
+      if (entrypoint != BytecodeElement::kInvalidEntrypoint)
+        entrypoints.emplace_back(entrypoint, elts_.size() - 1);
+
+      if (index) {
+        index->element_offsets.push_back(pos);
+        index->element_kinds.push_back(*stream);
+      }
+
+      // Advance
+      size_t l = element->GetBytecodeLength();
+      if (l <= 0)
+        l = 1;  // Failsafe: always advance at least one byte.
+      stream += l;
+      pos += l;
+    }
+
+    // Resolve pointers, now that |elts_| will no longer reallocate.
+    for (auto& element : elts_) {
+      element->SetPointers(cdat);
+    }
+    FuseElements();
+  } catch (...) {
+    DestroyElements();
+    throw;
   }
 
-  // Resolve pointers
-  for (auto& element : elts_) {
-    element->SetPointers(cdat);
+  for (auto const& entrypoint : entrypoints) {
+    entrypoint_associations_.emplace(entrypoint.first,
+                                     elts_.begin() + entrypoint.second);
   }
 
-  delete[] uncompressed;
+  if (index) {
+    index->bytecode.assign(bytecode_.data(), dlen);
+    index->kidoku_table = cdat.kidoku_table;
+    index->entrypoints.assign(entrypoints.begin(), entrypoints.end());
+  }
 }
 
 Script::Script(const Header& hdr,
                const std::string_view& data,
                const std::string& regname,
                bool use_xor_2,
-               const compression::XorKey* second_level_xor_key)
+               const compression::XorKey* second_level_xor_key,
+               ScriptIndex* index)
     : Script(hdr,
              data.data(),
              data.length(),
              regname,
              use_xor_2,
-             second_level_xor_key) {}
+             second_level_xor_key,
+             index) {}
+
+Script::Script(const CachedScript& cached) {
+  ConstructionData cdat(cached.kidoku_count(), elts_.end());
+  for (size_t i = 0; i < cached.kidoku_count(); ++i)
+    cdat.kidoku_table[i] = cached.kidoku(i);
+
+  // The cache holds the bytecode already decompressed, so the elements point
+  // straight into its mapping.
+  mapped_bytecode_ = cached.file();
+  bytecode_ = cached.bytecode();
+  const size_t dlen = bytecode_.size();
+
+  cdat.arena = &arena_;
+  cdat.elements = &elts_;
+  cdat.offsets.reserve(cached.element_count());
+
+  // Element boundaries are already known, so each element is read straight
+  // from its recorded offset instead of walking GetBytecodeLength().
+  const char* end = bytecode_.data() + dlen;
+  elts_.reserve(cached.element_count());
+  try {
+    for (size_t i = 0; i < cached.element_count(); ++i) {
+      const uint32_t pos = cached.element_offset(i);
+      const char* stream = bytecode_.data() + pos;
+      if (pos >= dlen ||
+          static_cast<uint8_t>(*stream) != cached.element_kind(i))
+        throw Error("Scenario cache is inconsistent with its bytecode");
+
+      elts_.push_back(BytecodeFactory::Read(stream, end, cdat));
+      cdat.AddOffset(pos, i);
+    }
+
+    for (size_t i = 0; i < cached.entrypoint_count(); ++i) {
+      const uint32_t element = cached.entrypoint_element(i);
+      if (element >= elts_.size())
+        throw Error("Scenario cache has an invalid entrypoint");
+      entrypoint_associations_.emplace(cached.entrypoint(i),
+                                       elts_.begin() + element);
+    }
+
+    for (auto& element : elts_) {
+      element->SetPointers(cdat);
+    }
+    FuseElements();
+  } catch (...) {
+    DestroyElements();
+    throw;
+  }
+}
+
+Script::~Script() { DestroyElements(); }
+
+void Script::DestroyElements() {
+  for (BytecodeElement* element : elts_) {
+    if (element)
+      element->~BytecodeElement();
+  }
+  elts_.clear();
+}
 
-Script::~Script() {}
+void Script::FuseElements() {
+  // Walk backwards so each line marker can take over the run after it.
+  for (size_t i = elts_.size(); i-- > 0;) {
+    MetaElement* meta = dynamic_cast<MetaElement*>(elts_[i]);
+    if (!meta || (!meta->is_line() && !meta->is_kidoku()))
+      continue;
+
+    BytecodeElement* next = i + 1 < elts_.size() ? elts_[i + 1] : nullptr;
+    MetaElement* next_meta = dynamic_cast<MetaElement*>(next);
+    bool next_is_text = dynamic_cast<TextoutElement*>(next) != nullptr;
+    if (meta->is_line()) {
+      if (next_meta && next_meta->is_line()) {
+        meta->Fuse(next_meta->fused_lines() + 1,
+                   next_meta->fused_lines() ? next_meta->fused_last_line()
+                                            : next_meta->value(),
+                   next_meta->fused_next());
+      } else if (next_is_text || (next_meta && next_meta->is_kidoku())) {
+        meta->Fuse(0, 0, next);
+      }
+    } else if (next_is_text) {
+      meta->Fuse(0, 0, next);
+    }
+  }
+}
 
 const pointer_t Script::GetEntrypoint(int entrypoint) const {
   pointernumber::const_iterator it = entrypoint_associations_.find(entrypoint);
@@ -201,19 +316,36 @@ const pointer_t Script::GetEntrypoint(int entrypoint) const {
 Scenario::Scenario(const std::string_view& data,
                    int sn,
                    const std::string& regname,
-                   const compression::XorKey* second_level_xor_key)
+                   const compression::XorKey* second_level_xor_key,
+                   ScriptIndex* index)
     : header(data),
-      script(header, data, regname, header.use_xor_2_, second_level_xor_key),
+      script(header,
+             data,
+             regname,
+             header.use_xor_2_,
+             second_level_xor_key,
+             index),
       scenario_number_(sn) {}
 
 Scenario::Scenario(FilePos fp,
                    int sn,
                    const std::string& regname,
-                   const compression::XorKey* second_level_xor_key)
-    : Scenario(fp.Read(), sn, regname, second_level_xor_key) {}
+                   const compression::XorKey* second_level_xor_key,
+                   ScriptIndex* index)
+    : Scenario(fp.Read(), sn, regname, second_level_xor_key, index) {}
+
+Scenario::Scenario(FilePos fp, int sn, const CachedScript& cached)
+    : header(fp.Read()), script(cached), scenario_number_(sn) {}
 
 Scenario::~Scenario() {}
 
+size_t Scenario::GetHeapUsage() const {
+  size_t bytes = script.arena_.bytes_used();
+  if (script.owned_bytecode_)
+    bytes += script.bytecode_.size();
+  return bytes;
+}
+
 Scenario::const_iterator Scenario::FindEntrypoint(int entrypoint) const {
   return script.GetEntrypoint(entrypoint);
 }
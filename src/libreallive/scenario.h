@@ -34,11 +34,16 @@
 #ifndef SRC_LIBREALLIVE_SCENARIO_H_
 #define SRC_LIBREALLIVE_SCENARIO_H_
 
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <string_view>
+#include <utility>
+#include <vector>
 
 #include "libreallive/alldefs.h"
 #include "libreallive/bytecode.h"
+#include "libreallive/bytecode_arena.h"
 #include "libreallive/filemap.h"
 
 namespace libreallive {
@@ -47,6 +52,26 @@ namespace compression {
 struct XorKey;
 }  // namespace compression
 
+class CachedScript;
+
+// The decompressed bytecode of a Script along with the location of every
+// element in it; everything ScenarioCache needs to rebuild the Script later
+// without decompressing or rescanning the SEEN file.
+struct ScriptIndex {
+  std::string bytecode;
+
+  // Byte offset into |bytecode| of each element, in order.
+  std::vector<uint32_t> element_offsets;
+
+  // The leading byte of each element, which determines its kind.
+  std::vector<uint8_t> element_kinds;
+
+  std::vector<unsigned long> kidoku_table;
+
+  // (entrypoint number, index into |element_offsets|) pairs.
+  std::vector<std::pair<int, uint32_t>> entrypoints;
+};
+
 class Metadata {
  public:
   Metadata();
@@ -88,19 +113,49 @@ class Script {
  private:
   friend class Scenario;
 
+  // Decompresses and tokenizes |data|. When |index| is non-NULL, it is filled
+  // with the decompressed stream and element locations for caching.
   Script(const Header& hdr,
          const char* const data,
          const size_t length,
          const std::string& regname,
          bool use_xor_2,
-         const compression::XorKey* second_level_xor_key);
+         const compression::XorKey* second_level_xor_key,
+         ScriptIndex* index = nullptr);
   Script(const Header& hdr,
          const std::string_view& data,
          const std::string& regname,
          bool use_xor_2,
-         const compression::XorKey* second_level_xor_key);
+         const compression::XorKey* second_level_xor_key,
+         ScriptIndex* index = nullptr);
+
+  // Rebuilds the elements from a previously cached index.
+  explicit Script(const CachedScript& cached);
   ~Script();
 
+  Script(const Script&) = delete;
+  Script& operator=(const Script&) = delete;
+
+  // Runs the destructors of everything in |elts_|; their storage belongs to
+  // |arena_|.
+  void DestroyElements();
+
+  // Links runs of line markers, and kidoku markers followed by text, into
+  // superinstructions that RLMachine executes in a single step. Every
+  // element stays in |elts_| so jumps, entrypoints and saved instruction
+  // pointers still land on the same elements.
+  void FuseElements();
+
+  // The decompressed bytecode. Elements keep views into it, so it lives as
+  // long as the Script does. It is either decompressed into
+  // |owned_bytecode_| or borrowed from a mapped scenario cache, which
+  // |mapped_bytecode_| keeps open.
+  std::string_view bytecode_;
+  std::unique_ptr<char[]> owned_bytecode_;
+  std::shared_ptr<MappedFile> mapped_bytecode_;
+
+  BytecodeArena arena_;
+
   // A sequence of semi-parsed/tokenized bytecode elements, which are
   // the elements that RLMachine executes.
   BytecodeList elts_;
@@ -115,11 +170,17 @@ class Scenario {
   Scenario(const std::string_view& data,
            int scenarioNum,
            const std::string& regname,
-           const compression::XorKey* second_level_xor_key);
+           const compression::XorKey* second_level_xor_key,
+           ScriptIndex* index = nullptr);
   Scenario(FilePos fp,
            int scenarioNum,
            const std::string& regname,
-           const compression::XorKey* second_level_xor_key);
+           const compression::XorKey* second_level_xor_key,
+           ScriptIndex* index = nullptr);
+
+  // Builds the Scenario from |fp|'s header and the bytecode in |cached|,
+  // skipping decompression.
+  Scenario(FilePos fp, int scenarioNum, const CachedScript& cached);
   ~Scenario();
 
   // Get the scenario number
@@ -144,6 +205,13 @@ class Scenario {
   // Locate the entrypoint
   const_iterator FindEntrypoint(int entrypoint) const;
 
+  // The decompressed bytecode that every element's strings point into.
+  std::string_view bytecode() const { return script.bytecode_; }
+
+  // Bytes of heap held by the elements and the bytecode buffer. Bytecode
+  // borrowed from a mapped scenario cache is not counted.
+  size_t GetHeapUsage() const;
+
  private:
   Header header;
   Script script;
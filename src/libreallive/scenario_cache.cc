@@ -0,0 +1,237 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of libreallive, a dependency of RLVM.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (c) 2026 agent <agent@local>
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use, copy,
+// modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// -----------------------------------------------------------------------
+
+#include "libreallive/scenario_cache.h"
+
+#include <boost/filesystem/fstream.hpp>
+
+#include <cstring>
+#include <string>
+#include <utility>
+
+#include "libreallive/scenario.h"
+
+namespace libreallive {
+
+namespace {
+
+const char kMagic[8] = {'R', 'L', 'V', 'M', 'S', 'C', 'N', '\0'};
+const size_t kHeaderSize = 32;
+const size_t kDirectoryEntrySize = 24;
+
+size_t Align4(size_t n) { return (n + 3) & ~size_t(3); }
+
+void PadTo4(std::string& out) { out.resize(Align4(out.size()), '\0'); }
+
+uint64_t ReadU64(const char* data) {
+  return static_cast<uint32_t>(read_i32(data)) |
+         (uint64_t(static_cast<uint32_t>(read_i32(data + 4))) << 32);
+}
+
+void AppendU64(std::string& out, uint64_t value) {
+  append_i32(out, static_cast<uint32_t>(value));
+  append_i32(out, static_cast<uint32_t>(value >> 32));
+}
+
+// Writes |data| to a temporary file and moves it over |path|, so a crash
+// never leaves a truncated cache behind and a mapping of the old file stays
+// valid.
+bool WriteAtomically(const fs::path& path, std::string_view data) {
+  fs::path tmp_path = path;
+  tmp_path += ".tmp";
+  {
+    fs::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!file)
+      return false;
+    file.write(data.data(), data.size());
+    if (!file)
+      return false;
+  }
+
+  boost::system::error_code ec;
+  fs::rename(tmp_path, path, ec);
+  return !ec;
+}
+
+}  // namespace
+
+// -----------------------------------------------------------------------
+// CachedScript
+// -----------------------------------------------------------------------
+
+CachedScript::CachedScript(std::shared_ptr<MappedFile> file,
+                           std::string_view bytecode,
+                           const char* element_offsets,
+                           const char* element_kinds,
+                           size_t element_count,
+                           const char* kidoku_table,
+                           size_t kidoku_count,
+                           const char* entrypoints,
+                           size_t entrypoint_count)
+    : file_(std::move(file)),
+      bytecode_(bytecode),
+      element_offsets_(element_offsets),
+      element_kinds_(element_kinds),
+      element_count_(element_count),
+      kidoku_table_(kidoku_table),
+      kidoku_count_(kidoku_count),
+      entrypoints_(entrypoints),
+      entrypoint_count_(entrypoint_count) {}
+
+// -----------------------------------------------------------------------
+// ScenarioCache
+// -----------------------------------------------------------------------
+
+ScenarioCache::ScenarioCache() {}
+
+ScenarioCache::~ScenarioCache() {}
+
+// static
+std::unique_ptr<ScenarioCache> ScenarioCache::Open(
+    const fs::path& path,
+    uint64_t stamp,
+    const std::function<uint64_t()>& compute_key) {
+  boost::system::error_code ec;
+  if (!fs::exists(path, ec) || fs::file_size(path, ec) < kHeaderSize)
+    return nullptr;
+
+  std::unique_ptr<ScenarioCache> cache(new ScenarioCache);
+  try {
+    cache->file_ = std::make_shared<MappedFile>(path);
+  } catch (Error& e) {
+    return nullptr;
+  }
+
+  const size_t file_size = cache->file_->size();
+  const char* data = cache->file_->get();
+  if (memcmp(data, kMagic, sizeof(kMagic)) != 0 ||
+      static_cast<uint32_t>(read_i32(data + 8)) != kVersion) {
+    return nullptr;
+  }
+
+  if (stamp == kNoStamp || ReadU64(data + 24) != stamp) {
+    if (ReadU64(data + 16) != compute_key())
+      return nullptr;
+
+    // Same contents, touched files. Never write into the file we have mapped;
+    // failing to update the stamp only costs the next launch another hash.
+    if (stamp != kNoStamp) {
+      std::string new_stamp;
+      AppendU64(new_stamp, stamp);
+      std::string restamped(data, file_size);
+      restamped.replace(24, new_stamp.size(), new_stamp);
+      WriteAtomically(path, restamped);
+    }
+  }
+
+  const size_t count = static_cast<uint32_t>(read_i32(data + 12));
+  if (kHeaderSize + count * kDirectoryEntrySize > file_size)
+    return nullptr;
+
+  for (size_t i = 0; i < count; ++i) {
+    const char* dir = data + kHeaderSize + i * kDirectoryEntrySize;
+    const int scenario = read_i32(dir);
+    const size_t offset = static_cast<uint32_t>(read_i32(dir + 4));
+    const size_t bytecode_length = static_cast<uint32_t>(read_i32(dir + 8));
+    const size_t element_count = static_cast<uint32_t>(read_i32(dir + 12));
+    const size_t kidoku_count = static_cast<uint32_t>(read_i32(dir + 16));
+    const size_t entrypoint_count = static_cast<uint32_t>(read_i32(dir + 20));
+
+    const size_t offsets_pos = offset + Align4(bytecode_length);
+    const size_t kidoku_pos = offsets_pos + element_count * 4;
+    const size_t entrypoints_pos = kidoku_pos + kidoku_count * 4;
+    const size_t kinds_pos = entrypoints_pos + entrypoint_count * 8;
+    if (offset > file_size || kinds_pos + element_count > file_size)
+      return nullptr;
+
+    cache->entries_.emplace(
+        scenario,
+        CachedScript(cache->file_,
+                     std::string_view(data + offset, bytecode_length),
+                     data + offsets_pos, data + kinds_pos, element_count,
+                     data + kidoku_pos, kidoku_count, data + entrypoints_pos,
+                     entrypoint_count));
+  }
+
+  return cache;
+}
+
+// static
+bool ScenarioCache::Write(const fs::path& path,
+                          uint64_t stamp,
+                          uint64_t key,
+                          const std::map<int, ScriptIndex>& scripts) {
+  std::string out(kMagic, sizeof(kMagic));
+  append_i32(out, kVersion);
+  append_i32(out, scripts.size());
+  AppendU64(out, key);
+  AppendU64(out, stamp);
+
+  // Reserve the directory; each record's offset is patched in below.
+  const size_t directory_pos = out.size();
+  out.resize(directory_pos + scripts.size() * kDirectoryEntrySize, '\0');
+
+  int dpos = directory_pos;
+  for (auto const& entry : scripts) {
+    const ScriptIndex& script = entry.second;
+    insert_i32(out, dpos, entry.first);
+    insert_i32(out, dpos + 4, out.size());
+    insert_i32(out, dpos + 8, script.bytecode.size());
+    insert_i32(out, dpos + 12, script.element_offsets.size());
+    insert_i32(out, dpos + 16, script.kidoku_table.size());
+    insert_i32(out, dpos + 20, script.entrypoints.size());
+    dpos += kDirectoryEntrySize;
+
+    out.append(script.bytecode);
+    PadTo4(out);
+    for (uint32_t element_offset : script.element_offsets)
+      append_i32(out, element_offset);
+    for (unsigned long kidoku : script.kidoku_table)
+      append_i32(out, kidoku);
+    for (auto const& entrypoint : script.entrypoints) {
+      append_i32(out, entrypoint.first);
+      append_i32(out, entrypoint.second);
+    }
+    out.append(script.element_kinds.begin(), script.element_kinds.end());
+    PadTo4(out);
+  }
+
+  return WriteAtomically(path, out);
+}
+
+const CachedScript* ScenarioCache::Find(int index) const {
+  auto it = entries_.find(index);
+  return it != entries_.end() ? &it->second : nullptr;
+}
+
+}  // namespace libreallive
@@ -0,0 +1,163 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of libreallive, a dependency of RLVM.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (c) 2026 agent <agent@local>
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use, copy,
+// modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// -----------------------------------------------------------------------
+
+#ifndef SRC_LIBREALLIVE_SCENARIO_CACHE_H_
+#define SRC_LIBREALLIVE_SCENARIO_CACHE_H_
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string_view>
+
+#include "libreallive/alldefs.h"
+#include "libreallive/filemap.h"
+
+namespace libreallive {
+
+struct ScriptIndex;
+
+// A view of one scenario's entry in a ScenarioCache. All data points into the
+// cache's mapped file and is only valid while the ScenarioCache lives.
+class CachedScript {
+ public:
+  CachedScript(std::shared_ptr<MappedFile> file,
+               std::string_view bytecode,
+               const char* element_offsets,
+               const char* element_kinds,
+               size_t element_count,
+               const char* kidoku_table,
+               size_t kidoku_count,
+               const char* entrypoints,
+               size_t entrypoint_count);
+
+  // The mapped cache file that bytecode() and the tables point into.
+  const std::shared_ptr<MappedFile>& file() const { return file_; }
+  std::string_view bytecode() const { return bytecode_; }
+
+  size_t element_count() const { return element_count_; }
+  uint32_t element_offset(size_t i) const {
+    return read_i32(element_offsets_ + i * 4);
+  }
+  uint8_t element_kind(size_t i) const { return element_kinds_[i]; }
+
+  size_t kidoku_count() const { return kidoku_count_; }
+  unsigned long kidoku(size_t i) const {
+    return read_i32(kidoku_table_ + i * 4);
+  }
+
+  size_t entrypoint_count() const { return entrypoint_count_; }
+  int entrypoint(size_t i) const { return read_i32(entrypoints_ + i * 8); }
+  uint32_t entrypoint_element(size_t i) const {
+    return read_i32(entrypoints_ + i * 8 + 4);
+  }
+
+ private:
+  std::shared_ptr<MappedFile> file_;
+  std::string_view bytecode_;
+  const char* element_offsets_;
+  const char* element_kinds_;
+  size_t element_count_;
+  const char* kidoku_table_;
+  size_t kidoku_count_;
+  const char* entrypoints_;
+  size_t entrypoint_count_;
+};
+
+// A memory mapped file of already decompressed and indexed scenarios, so that
+// warm starts skip both the LZ decompression and the scan for element
+// boundaries. The file carries two keys: a cheap stamp of the sizes and
+// modification times of the source files, and a hash of their contents and
+// the game's regname. A matching stamp is trusted as is; otherwise the
+// contents are hashed, and the cache is rejected if that doesn't match
+// either.
+//
+// File layout (all integers little endian):
+//
+//   "RLVMSCN\0" | u32 version | u32 count | u32 key_lo | u32 key_hi
+//   | u32 stamp_lo | u32 stamp_hi
+//   count * { i32 scenario, u32 offset, u32 bytecode_length,
+//             u32 element_count, u32 kidoku_count, u32 entrypoint_count }
+//   count * { bytecode, padding to 4 bytes, u32 element_offsets[],
+//             u32 kidoku_table[], { i32 entrypoint, u32 element }[],
+//             u8 element_kinds[], padding to 4 bytes }
+class ScenarioCache {
+ public:
+  // Bumped whenever the file layout or the meaning of any field changes,
+  // and whenever parsing would split the same bytecode into different
+  // elements, since the recorded element offsets then no longer apply.
+  // Version 2: the '!' entrypoint marker is tracked per scenario instead of
+  // for the whole process.
+  static const uint32_t kVersion = 2;
+
+  // A stamp that is never trusted, for when the source files can't be
+  // stamped reliably. Open() always hashes the contents under it.
+  static const uint64_t kNoStamp = 0;
+
+  ~ScenarioCache();
+
+  // Maps the cache at |path|. Returns NULL when the file doesn't exist, is
+  // malformed or is from a different version of rlvm. When the file wasn't
+  // written under |stamp|, or |stamp| is kNoStamp, calls |compute_key| and
+  // returns NULL unless the result matches the stored key; on a match the
+  // file is replaced by a restamped copy so the next launch can skip the
+  // hash.
+  static std::unique_ptr<ScenarioCache> Open(
+      const fs::path& path,
+      uint64_t stamp,
+      const std::function<uint64_t()>& compute_key);
+
+  // Writes |scripts| to |path| under |stamp| and |key|, replacing any
+  // existing file. Returns false if the file couldn't be written.
+  static bool Write(const fs::path& path,
+                    uint64_t stamp,
+                    uint64_t key,
+                    const std::map<int, ScriptIndex>& scripts);
+
+  // Returns the cached entry for scenario |index| or NULL.
+  const CachedScript* Find(int index) const;
+
+  size_t size() const { return entries_.size(); }
+
+ private:
+  ScenarioCache();
+
+  // Shared with every Script built from this cache, which borrow their
+  // bytecode from the mapping instead of copying it.
+  std::shared_ptr<MappedFile> file_;
+  std::map<int, CachedScript> entries_;
+};
+
+}  // namespace libreallive
+
+#endif  // SRC_LIBREALLIVE_SCENARIO_CACHE_H_
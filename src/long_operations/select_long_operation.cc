@@ -68,7 +68,7 @@ SelectLongOperation::SelectLongOperation(RLMachine& machine,
     o.use_colour = false;
 
     std::string evaluated_native =
-        libreallive::EvaluatePRINT(machine, param.text);
+        libreallive::EvaluatePRINT(machine, std::string(param.text));
     o.str = cp932toUTF8(evaluated_native, machine.GetTextEncoding());
 
     for (auto const& condition : param.cond_parsed) {
@@ -77,8 +77,8 @@ SelectLongOperation::SelectLongOperation(RLMachine& machine,
         // for now, I've never seen anything other than hide.
         case SelectElement::OPTION_HIDE: {
           bool value = false;
-          if (condition.condition != "") {
-            const char* location = condition.condition.c_str();
+          if (!condition.condition.empty()) {
+            const char* location = condition.condition.data();
             libreallive::Expression condition(libreallive::GetExpression(location));
             value = !condition->GetIntegerValue(machine);
           }
@@ -88,16 +88,16 @@ SelectLongOperation::SelectLongOperation(RLMachine& machine,
         }
         case SelectElement::OPTION_TITLE: {
           bool enabled = false;
-          if (condition.condition != "") {
-            const char* location = condition.condition.c_str();
+          if (!condition.condition.empty()) {
+            const char* location = condition.condition.data();
             libreallive::Expression condition(libreallive::GetExpression(location));
             enabled = !condition->GetIntegerValue(machine);
           }
 
           bool use_colour = false;
           int colour_index = 0;
-          if (!enabled && condition.effect_argument != "") {
-            const char* location = condition.effect_argument.c_str();
+          if (!enabled && !condition.effect_argument.empty()) {
+            const char* location = condition.effect_argument.data();
             libreallive::Expression effect_argument(
                 libreallive::GetExpression(location));
             colour_index = !effect_argument->GetIntegerValue(machine);
@@ -112,10 +112,11 @@ SelectLongOperation::SelectLongOperation(RLMachine& machine,
         default:
           cerr << "Unsupported option in select statement "
                << "(condition: "
-               << libreallive::ParsableToPrintableString(condition.condition)
+               << libreallive::ParsableToPrintableString(
+                      std::string(condition.condition))
                << ", effect: " << condition.effect << ", effect_argument: "
                << libreallive::ParsableToPrintableString(
-                      condition.effect_argument) << ")" << endl;
+                      std::string(condition.effect_argument)) << ")" << endl;
           break;
       }
     }
@@ -156,6 +157,16 @@ std::vector<std::string> SelectLongOperation::GetOptions() const {
   return opt;
 }
 
+std::vector<int> SelectLongOperation::GetSelectableIndexes() const {
+  std::vector<int> indexes;
+  for (size_t i = 0; i < options_.size(); ++i) {
+    if (options_[i].shown && options_[i].enabled)
+      indexes.push_back(i);
+  }
+
+  return indexes;
+}
+
 bool SelectLongOperation::operator()(RLMachine& machine) {
   if (return_value_ != -1) {
     machine.set_store_register(return_value_);
@@ -78,6 +78,9 @@ class SelectLongOperation : public LongOperation {
   // Returns the underlying list of options.
   std::vector<std::string> GetOptions() const;
 
+  // Returns the indexes of the options that are both shown and enabled.
+  std::vector<int> GetSelectableIndexes() const;
+
   // Overridden from LongOperation:
   virtual bool operator()(RLMachine& machine) override;
 
@@ -125,7 +125,7 @@ bool WaitLongOperation::operator()(RLMachine& machine) {
     graphics.MarkScreenAsDirty(GUT_MOUSE_MOTION);
     mouse_moved_ = false;
   } else if (graphics.object_state_dirty()) {
-    graphics.MarkScreenAsDirty(GUT_DISPLAY_OBJ);
+    graphics.MarkScreenAsDirty(GUT_OBJECT_STATE);
   }
 
   if (break_on_clicks_) {
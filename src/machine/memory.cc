@@ -119,6 +119,22 @@ void Memory::ConnectIntVarPointers() {
   original_int_var[7] = NULL;
 }
 
+int* Memory::GetIntBank(int bank) {
+  if (bank == libreallive::INTL_LOCATION)
+    return machine_.CurrentIntLBank();
+  return int_var[bank];
+}
+
+int* Memory::GetIntBankForWrite(int bank, int slot) {
+  if (bank == libreallive::INTL_LOCATION)
+    return machine_.CurrentIntLBank();
+
+  std::map<int, int>* original = original_int_var[bank];
+  if (original && original->find(slot) == original->end())
+    original->emplace(slot, int_var[bank][slot]);
+  return int_var[bank];
+}
+
 const std::string& Memory::GetStringValue(int type, int location) {
   if (location > (SIZE_OF_MEM_BANK - 1))
     throw rlvm::Exception(
@@ -212,6 +212,13 @@ class Memory {
   // Sets the value of a certain memory location
   void SetIntValue(const libreallive::IntMemRef& ref, int value);
 
+  // Raw access to an integer bank for CompiledExpression, which decodes
+  // access types and checks bounds itself. |bank| is an IntMemRef::bank()
+  // value from 0 to INTL_LOCATION. GetIntBankForWrite() also logs the original
+  // value of |slot| for the next savepoint, like SetIntValue() does.
+  int* GetIntBank(int bank);
+  int* GetIntBankForWrite(int bank, int slot);
+
   // Returns the string value of a string memory bank
   const std::string& GetStringValue(int type, int location);
 
@@ -0,0 +1,89 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#include "machine/opcode_profile.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// -----------------------------------------------------------------------
+// OpcodeProfile
+// -----------------------------------------------------------------------
+OpcodeProfile::OpcodeProfile() {}
+OpcodeProfile::~OpcodeProfile() {}
+
+std::chrono::nanoseconds OpcodeProfile::TotalTime() const {
+  std::chrono::nanoseconds total{0};
+  for (auto const& entry : storage_)
+    total += entry.second.time;
+  return total;
+}
+
+std::ostream& operator<<(std::ostream& os, const OpcodeProfile& profile) {
+  if (!profile.size()) {
+    os << "No opcodes recorded!" << std::endl;
+    return os;
+  }
+
+  std::vector<const OpcodeProfile::Entry*> entries;
+  size_t name_len = 6;
+  for (auto const& entry : profile) {
+    entries.push_back(&entry.second);
+    name_len = std::max(name_len, entry.second.name.size());
+  }
+  std::sort(entries.begin(), entries.end(),
+            [](const OpcodeProfile::Entry* lhs,
+               const OpcodeProfile::Entry* rhs) {
+              return lhs->time > rhs->time;
+            });
+
+  const double total_ms =
+      std::chrono::duration<double, std::milli>(profile.TotalTime()).count();
+
+  os << std::setw(name_len) << std::left << "Module" << std::right
+     << std::setw(12) << "Calls" << std::setw(12) << "Total ms"
+     << std::setw(10) << "us/call" << std::setw(8) << "%" << std::endl;
+  os << std::string(name_len + 42, '-') << std::endl;
+
+  os << std::fixed;
+  for (const OpcodeProfile::Entry* entry : entries) {
+    const double ms =
+        std::chrono::duration<double, std::milli>(entry->time).count();
+    os << std::setw(name_len) << std::left << entry->name << std::right
+       << std::setw(12) << entry->calls << std::setw(12)
+       << std::setprecision(2) << ms << std::setw(10) << std::setprecision(2)
+       << (entry->calls ? ms * 1000.0 / entry->calls : 0.0) << std::setw(8)
+       << std::setprecision(1) << (total_ms > 0 ? ms * 100.0 / total_ms : 0.0)
+       << std::endl;
+  }
+  os.unsetf(std::ios_base::floatfield);
+
+  return os;
+}
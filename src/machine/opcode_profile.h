@@ -0,0 +1,80 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#ifndef SRC_MACHINE_OPCODE_PROFILE_H_
+#define SRC_MACHINE_OPCODE_PROFILE_H_
+
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <map>
+#include <string>
+
+// An optional component to an RLMachine that measures how much wall clock time
+// is spent inside each module's opcodes. Unlike OpcodeLog, this is keyed on
+// the module instead of the opcode name so that recording stays cheap enough
+// to leave on for a whole game.
+class OpcodeProfile {
+ public:
+  struct Entry {
+    // The module's name, as given to RLModule, or "modtype:module" when no
+    // module is attached under that number.
+    std::string name;
+
+    // How many commands were dispatched to the module.
+    int64_t calls = 0;
+
+    // Total time spent in those commands.
+    std::chrono::nanoseconds time{0};
+  };
+
+  // Keyed on the packed module number (see RLMachine::PackModuleNumber()).
+  typedef std::map<unsigned int, Entry> Storage;
+
+  OpcodeProfile();
+  ~OpcodeProfile();
+
+  // Returns the entry for |packed_module|, creating an empty one if needed.
+  Entry& GetEntry(unsigned int packed_module) {
+    return storage_[packed_module];
+  }
+
+  // Sum of the time recorded for every module.
+  std::chrono::nanoseconds TotalTime() const;
+
+  Storage::const_iterator begin() const { return storage_.begin(); }
+  Storage::const_iterator end() const { return storage_.end(); }
+  size_t size() const { return storage_.size(); }
+
+ private:
+  Storage storage_;
+};
+
+// Pretty prints the contents of an OpcodeProfile, most expensive module first.
+std::ostream& operator<<(std::ostream& os, const OpcodeProfile& profile);
+
+#endif  // SRC_MACHINE_OPCODE_PROFILE_H_
@@ -35,6 +35,9 @@
 #include <boost/filesystem/fstream.hpp>
 #include <boost/filesystem/path.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <functional>
 #include <iostream>
 #include <iterator>
@@ -53,11 +56,13 @@
 #include "machine/long_operation.h"
 #include "machine/memory.h"
 #include "machine/opcode_log.h"
+#include "machine/opcode_profile.h"
 #include "machine/reallive_dll.h"
 #include "machine/rlmodule.h"
 #include "machine/rloperation.h"
 #include "machine/serialization.h"
 #include "machine/stack_frame.h"
+#include "systems/base/event_system.h"
 #include "systems/base/graphics_system.h"
 #include "systems/base/system.h"
 #include "systems/base/system_error.h"
@@ -91,10 +96,14 @@ const char seen_end[] = {
 
 const std::string SeenEnd(seen_end, 14);
 
-bool IsNotLongOp(StackFrame& frame) {
+bool IsNotLongOp(const StackFrame& frame) {
   return frame.frame_type != StackFrame::TYPE_LONGOP;
 }
 
+// Source of RLMachine::dispatch_generation_. Zero is never handed out, so it
+// can't match a CommandElement that hasn't been dispatched yet.
+std::atomic<uint64_t> next_dispatch_generation(1);
+
 }  // namespace
 
 // -----------------------------------------------------------------------
@@ -103,6 +112,7 @@ bool IsNotLongOp(StackFrame& frame) {
 
 RLMachine::RLMachine(System& in_system, libreallive::Archive& in_archive)
     : memory_(new Memory(*this, in_system.gameexe())),
+      dispatch_generation_(next_dispatch_generation++),
       archive_(in_archive),
       system_(in_system) {
   // Search in the Gameexe for #SEEN_START and place us there
@@ -169,6 +179,12 @@ void RLMachine::AttachModule(RLModule* module) {
   }
 
   modules_.emplace(packed_module, std::unique_ptr<RLModule>(module));
+  module->set_machine(this);
+  InvalidateDispatchCache();
+}
+
+void RLMachine::InvalidateDispatchCache() {
+  dispatch_generation_ = next_dispatch_generation++;
 }
 
 int RLMachine::GetIntValue(const libreallive::IntMemRef& ref) {
@@ -243,73 +259,122 @@ bool RLMachine::ShouldSetSeentopSavepoint() const {
 
 void RLMachine::ExecuteNextInstruction() {
   // Do not execute any more instructions if the machine is halted.
-  if (halted() == true) {
+  if (halted() == true)
     return;
-  } else {
+
+  try {
+    RunNextInstruction();
+  } catch (...) {
+    HandleInstructionException();
+  }
+}
+
+int RLMachine::ExecuteBatch(const ExecutionBudget& budget) {
+  const unsigned int start_ticks =
+      budget.milliseconds ? system_.event().GetTicks() : 0;
+  const int clock_check_interval = std::max(budget.clock_check_interval, 1);
+  int executed = 0;
+
+  // Returns true when the batch should stop after the instruction that was
+  // just executed.
+  auto done = [&]() {
+    ++executed;
+    if (halted_ || system_.force_wait() || call_stack_.empty() ||
+        call_stack_.back().frame_type == StackFrame::TYPE_LONGOP)
+      return true;
+    if (budget.instructions && executed >= budget.instructions)
+      return true;
+    return budget.milliseconds && executed % clock_check_interval == 0 &&
+           system_.event().GetTicks() - start_ticks >= budget.milliseconds;
+  };
+
+  // The try block is only re-entered after an instruction throws, so the
+  // common path is a plain loop.
+  while (!halted_) {
     try {
-      if (call_stack_.back().frame_type == StackFrame::TYPE_LONGOP) {
-        delay_stack_modifications_ = true;
-        bool ret_val = (*call_stack_.back().long_op)(*this);
-        delay_stack_modifications_ = false;
-
-        if (ret_val)
-          PopStackFrame();
-
-        // Now we can perform the queued actions
-        for (auto const& action : delayed_modifications_) {
-          (action)();
-        }
-        delayed_modifications_.clear();
-      } else {
-        (*(call_stack_.back().ip))->RunOnMachine(*this);
-      }
-    } catch (rlvm::UnimplementedOpcode& e) {
-      AdvanceInstructionPointer();
+      do {
+        RunNextInstruction();
+      } while (!done());
+      return executed;
+    } catch (...) {
+      HandleInstructionException();
+      if (done())
+        return executed;
+    }
+  }
 
-      if (print_undefined_opcodes_) {
-        cout << "(SEEN" << call_stack_.back().scenario->scene_number()
-             << ")(Line " << line_ << "):  " << e.what() << endl;
-      }
+  return executed;
+}
 
-      if (undefined_log_)
-        undefined_log_->Increment(e.opcode_name());
-    } catch (rlvm::Exception& e) {
-      if (halt_on_exception_) {
-        halted_ = true;
-      } else {
-        // Advance the instruction pointer so as to prevent infinite
-        // loops where we throw an exception, and then try again.
-        AdvanceInstructionPointer();
-      }
+void RLMachine::RunNextInstruction() {
+  if (call_stack_.back().frame_type == StackFrame::TYPE_LONGOP) {
+    delay_stack_modifications_ = true;
+    bool ret_val = (*call_stack_.back().long_op)(*this);
+    delay_stack_modifications_ = false;
 
-      cout << "(SEEN" << call_stack_.back().scenario->scene_number()
-           << ")(Line " << line_ << ")";
+    if (ret_val)
+      PopStackFrame();
 
-      // We specialcase rlvm::Exception because we might have the name of the
-      // opcode.
-      if (e.operation()) {
-        cout << "[" << e.operation()->name() << "]";
-      }
+    // Now we can perform the queued actions
+    for (auto const& action : delayed_modifications_) {
+      (action)();
+    }
+    delayed_modifications_.clear();
+  } else {
+    (*(call_stack_.back().ip))->RunOnMachine(*this);
+  }
+}
 
-      cout << ":  " << e.what() << endl;
-    } catch (std::exception& e) {
-      if (halt_on_exception_) {
-        halted_ = true;
-      } else {
-        // Advance the instruction pointer so as to prevent infinite
-        // loops where we throw an exception, and then try again.
-        AdvanceInstructionPointer();
-      }
+void RLMachine::HandleInstructionException() {
+  try {
+    throw;
+  } catch (rlvm::UnimplementedOpcode& e) {
+    AdvanceInstructionPointer();
 
+    if (print_undefined_opcodes_) {
       cout << "(SEEN" << call_stack_.back().scenario->scene_number()
            << ")(Line " << line_ << "):  " << e.what() << endl;
     }
+
+    if (undefined_log_)
+      undefined_log_->Increment(e.opcode_name());
+  } catch (rlvm::Exception& e) {
+    if (halt_on_exception_) {
+      halted_ = true;
+    } else {
+      // Advance the instruction pointer so as to prevent infinite
+      // loops where we throw an exception, and then try again.
+      AdvanceInstructionPointer();
+    }
+
+    cout << "(SEEN" << call_stack_.back().scenario->scene_number()
+         << ")(Line " << line_ << ")";
+
+    // We specialcase rlvm::Exception because we might have the name of the
+    // opcode.
+    if (e.operation()) {
+      cout << "[" << e.operation()->name() << "]";
+    }
+
+    cout << ":  " << e.what() << endl;
+  } catch (std::exception& e) {
+    if (halt_on_exception_) {
+      halted_ = true;
+    } else {
+      // Advance the instruction pointer so as to prevent infinite
+      // loops where we throw an exception, and then try again.
+      AdvanceInstructionPointer();
+    }
+
+    cout << "(SEEN" << call_stack_.back().scenario->scene_number()
+         << ")(Line " << line_ << "):  " << e.what() << endl;
   }
 }
 
 void RLMachine::ExecuteUntilHalted() {
+  const ExecutionBudget unlimited;
   while (!halted()) {
-    ExecuteNextInstruction();
+    ExecuteBatch(unlimited);
   }
 }
 
@@ -336,13 +401,54 @@ std::string RLMachine::GetCommandName(const libreallive::CommandElement& f) {
 }
 
 void RLMachine::ExecuteCommand(const libreallive::CommandElement& f) {
-  ModuleMap::iterator it =
-      modules_.find(PackModuleNumber(f.modtype(), f.module()));
-  if (it != modules_.end()) {
-    it->second->DispatchFunction(*this, f);
-  } else {
-    throw rlvm::UnimplementedOpcode(*this, f);
+  // Hot loops hit the same elements over and over, so remember which
+  // RLOperation each one resolved to instead of doing two hash lookups.
+  RLOperation* op = f.GetCachedOperation(dispatch_generation_);
+  if (!op) {
+    ModuleMap::iterator it =
+        modules_.find(PackModuleNumber(f.modtype(), f.module()));
+    if (it == modules_.end())
+      throw rlvm::UnimplementedOpcode(*this, f);
+
+    op = it->second->GetOperation(f);
+    if (!op)
+      throw rlvm::UnimplementedOpcode(*this, f);
+    f.SetCachedOperation(dispatch_generation_, op);
   }
+
+  if (opcode_profile_)
+    DispatchAndProfile(f, *op);
+  else
+    RLModule::DispatchOperation(*this, *op, f);
+}
+
+void RLMachine::DispatchAndProfile(const libreallive::CommandElement& f,
+                                   RLOperation& op) {
+  const unsigned int packed_module = PackModuleNumber(f.modtype(), f.module());
+  OpcodeProfile::Entry& entry = opcode_profile_->GetEntry(packed_module);
+  if (entry.name.empty()) {
+    ModuleMap::const_iterator it = modules_.find(packed_module);
+    if (it != modules_.end()) {
+      entry.name = it->second->module_name();
+    } else {
+      std::ostringstream oss;
+      oss << f.modtype() << ":" << f.module();
+      entry.name = oss.str();
+    }
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  auto record = [&]() {
+    entry.calls++;
+    entry.time += std::chrono::steady_clock::now() - start;
+  };
+  try {
+    RLModule::DispatchOperation(*this, op, f);
+  } catch (...) {
+    record();
+    throw;
+  }
+  record();
 }
 
 void RLMachine::Jump(int scenario_num, int entrypoint) {
@@ -540,8 +646,14 @@ const libreallive::Scenario& RLMachine::Scenario() const {
   return *call_stack_.back().scenario;
 }
 
+libreallive::Scenario::const_iterator RLMachine::InstructionPointer() const {
+  std::vector<StackFrame>::const_reverse_iterator it =
+      find_if(call_stack_.rbegin(), call_stack_.rend(), IsNotLongOp);
+  return it != call_stack_.rend() ? it->ip : call_stack_.back().ip;
+}
+
 void RLMachine::ExecuteExpression(const libreallive::ExpressionElement& e) {
-  e.ParsedExpression()->GetIntegerValue(*this);
+  e.Evaluate(*this);
   AdvanceInstructionPointer();
 }
 
@@ -659,6 +771,10 @@ void RLMachine::RecordUndefinedOpcodeCounts() {
   undefined_log_.reset(new OpcodeLog);
 }
 
+void RLMachine::RecordOpcodeTimes() {
+  opcode_profile_.reset(new OpcodeProfile);
+}
+
 void RLMachine::Halt() { halted_ = true; }
 
 void RLMachine::SetHaltOnException(bool halt_on_exception) {
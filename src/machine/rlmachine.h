@@ -30,6 +30,7 @@
 
 #include <boost/serialization/split_member.hpp>
 
+#include <cstdint>
 #include <functional>
 #include <map>
 #include <memory>
@@ -49,7 +50,9 @@ class IntMemRef;
 class LongOperation;
 class Memory;
 class OpcodeLog;
+class OpcodeProfile;
 class RLModule;
+class RLOperation;
 class RealLiveDLL;
 class System;
 struct StackFrame;
@@ -59,6 +62,18 @@ struct StackFrame;
 // control, and other execution issues.
 class RLMachine {
  public:
+  // Limits on a single ExecuteBatch() call. Zero means unlimited.
+  struct ExecutionBudget {
+    // The most instructions to execute.
+    int instructions = 0;
+
+    // How long the batch may run, by the EventSystem's clock.
+    unsigned int milliseconds = 0;
+
+    // The clock is only read every this many instructions.
+    int clock_check_interval = 16;
+  };
+
   RLMachine(System& in_system, libreallive::Archive& in_archive);
   virtual ~RLMachine();
 
@@ -103,6 +118,10 @@ class RLMachine {
   // |module|.
   virtual void AttachModule(RLModule* module);
 
+  // Forgets the RLOperation each CommandElement resolved to under this
+  // machine. Called whenever the set of modules or their opcodes changes.
+  void InvalidateDispatchCache();
+
   // ------------------------------------- [ Implicit savepoint management ]
   // RealLive will save the latest savepoint for the topmost stack
   // frame. Savepoints can be manually set (with the "Savepoint" command), but
@@ -210,6 +229,10 @@ class RLMachine {
   // Returns the actual Scenario on the top top of the call stack.
   const libreallive::Scenario& Scenario() const;
 
+  // Returns the next element of Scenario() that will run once any
+  // LongOperations on top of the call stack finish.
+  libreallive::Scenario::const_iterator InstructionPointer() const;
+
   // ------------------------------------------------ [ Execution interface ]
   // Normally, execute_next_instruction will call RunOnMachine() on
   // whatever BytecodeElement is currently pointed to by the
@@ -218,6 +241,13 @@ class RLMachine {
   // Sets the current line number. This may trigger a line action.
   void SetLineNumber(const int i);
 
+  // Whether elements may run the superinstructions Script fused them into.
+  // Line actions need to see every line marker, and replaying the graphics
+  // stack doesn't move the instruction pointer, so both turn fusion off.
+  bool CanRunFusedElements() const {
+    return !on_line_actions_ && !replaying_graphics_stack_;
+  }
+
   // Where the current scenario was compiled with RLdev, returns the text
   // encoding used:
   //   0 -> CP932
@@ -271,7 +301,15 @@ class RLMachine {
   // Executes the next instruction in the bytecode in
   void ExecuteNextInstruction();
 
-  // Call executeNextInstruction() repeatedly until the RLMachine is
+  // Executes instructions until a LongOperation is on top of the call stack,
+  // the System sets force_wait(), the machine halts, or |budget| runs out.
+  // Always executes at least one instruction unless already halted. Errors
+  // are handled the same way as ExecuteNextInstruction() handles them, but
+  // outside the per instruction path. Returns the number of instructions
+  // executed.
+  int ExecuteBatch(const ExecutionBudget& budget);
+
+  // Call ExecuteBatch() repeatedly until the RLMachine is
   // halted. This function is used in unit testing, and would never be
   // called during real usage of an RLMachine instance since other
   // subsystems (graphics, sound, etc) would need to have a chance to
@@ -303,6 +341,13 @@ class RLMachine {
   // results to stderr on machine destruction.
   void RecordUndefinedOpcodeCounts();
 
+  // Starts timing every command, grouped by module. Costs a clock read on
+  // each side of every command, so this is only meant for profiling runs.
+  void RecordOpcodeTimes();
+
+  // The times recorded since RecordOpcodeTimes(), or nullptr.
+  const OpcodeProfile* opcode_profile() const { return opcode_profile_.get(); }
+
   // ---------------------------------------------------------------------
 
   // Force the machine to halt. This should terminate the execution of
@@ -351,6 +396,21 @@ class RLMachine {
   void AddLineAction(const int seen, const int line, std::function<void(void)>);
 
  private:
+  // Runs the current LongOperation or bytecode element, letting any
+  // exception escape.
+  void RunNextInstruction();
+
+  // Called from inside a catch block. Reports the exception in flight and
+  // moves past the instruction that threw it, or halts when
+  // |halt_on_exception_| is set. Rethrows exception types the machine
+  // doesn't handle.
+  void HandleInstructionException();
+
+  // Dispatches |op| and charges the time it took to its module in
+  // |opcode_profile_|.
+  void DispatchAndProfile(const libreallive::CommandElement& f,
+                          RLOperation& op);
+
   // The Reallive VM's integer and string memory
   std::unique_ptr<Memory> memory_;
 
@@ -362,6 +422,11 @@ class RLMachine {
   // Mapping between the module_type:module pair and the module implementation
   ModuleMap modules_;
 
+  // Identifies the current contents of |modules_| to the RLOperation cache on
+  // each CommandElement. Unique across all RLMachines, since several machines
+  // can run the same Archive.
+  uint64_t dispatch_generation_;
+
   // States whether the RLMachine is in the halted state (and thus won't
   // execute more instructions)
   bool halted_ = false;
@@ -393,6 +458,9 @@ class RLMachine {
   // undefined opcodes.
   std::unique_ptr<OpcodeLog> undefined_log_;
 
+  // Per module timings of commands, if the user asked for them.
+  std::unique_ptr<OpcodeProfile> opcode_profile_;
+
   // Override defaults
   bool mark_savepoints_ = true;
 
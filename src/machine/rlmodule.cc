@@ -36,6 +36,7 @@
 
 #include "libreallive/bytecode.h"
 #include "machine/general_operations.h"
+#include "machine/rlmachine.h"
 #include "machine/rloperation.h"
 #include "utilities/exception.h"
 
@@ -82,6 +83,9 @@ void RLModule::AddOpcode(int opcode,
   }
 #endif
   stored_operations_.emplace(packed_opcode, std::unique_ptr<RLOperation>(op));
+
+  if (machine_)
+    machine_->InvalidateDispatchCache();
 }
 
 void RLModule::AddUnsupportedOpcode(int opcode,
@@ -139,27 +143,41 @@ std::string RLModule::GetCommandName(RLMachine& machine,
 
 void RLModule::DispatchFunction(RLMachine& machine,
                                 const libreallive::CommandElement& f) {
+  RLOperation* op = GetOperation(f);
+  if (op) {
+    DispatchOperation(machine, *op, f);
+  } else {
+    throw rlvm::UnimplementedOpcode(machine, f);
+  }
+}
+
+RLOperation* RLModule::GetOperation(const libreallive::CommandElement& f) {
   OpcodeMap::iterator it =
       stored_operations_.find(PackOpcodeNumber(f.opcode(), f.overload()));
-  if (it != stored_operations_.end()) {
-    try {
-      if (machine.is_tracing_on()) {
-        std::cerr << "(SEEN" << std::setw(4) << std::setfill('0')
-                  << machine.SceneNumber()
-                  << ")(Line " << std::setw(4) << std::setfill('0')
-                  << machine.line_number() << "): " << it->second->name();
-        libreallive::PrintParameterString(std::cerr,
-                                          f.GetUnparsedParameters());
-        std::cerr << std::endl;
-      }
-      it->second->DispatchFunction(machine, f);
-    }
-    catch (rlvm::Exception& e) {
-      e.setOperation(it->second.get());
-      throw;
+  if (it != stored_operations_.end())
+    return it->second.get();
+  return nullptr;
+}
+
+// static
+void RLModule::DispatchOperation(RLMachine& machine,
+                                 RLOperation& op,
+                                 const libreallive::CommandElement& f) {
+  try {
+    if (machine.is_tracing_on()) {
+      std::cerr << "(SEEN" << std::setw(4) << std::setfill('0')
+                << machine.SceneNumber()
+                << ")(Line " << std::setw(4) << std::setfill('0')
+                << machine.line_number() << "): " << op.name();
+      libreallive::PrintParameterString(std::cerr,
+                                        f.GetUnparsedParameters());
+      std::cerr << std::endl;
     }
-  } else {
-    throw rlvm::UnimplementedOpcode(machine, f);
+    op.DispatchFunction(machine, f);
+  }
+  catch (rlvm::Exception& e) {
+    e.setOperation(&op);
+    throw;
   }
 }
 
@@ -122,6 +122,19 @@ class RLModule {
   void DispatchFunction(RLMachine& machine,
                         const libreallive::CommandElement& f);
 
+  // Returns the RLOperation in this module that implements |f|, or NULL.
+  RLOperation* GetOperation(const libreallive::CommandElement& f);
+
+  // Executes |f| with |op|, which was looked up with GetOperation(). Handles
+  // tracing and tags any rlvm::Exception with |op|.
+  static void DispatchOperation(RLMachine& machine,
+                                RLOperation& op,
+                                const libreallive::CommandElement& f);
+
+  // The machine this module was attached to. Adding opcodes after attachment
+  // invalidates the machine's dispatch cache.
+  void set_machine(RLMachine* machine) { machine_ = machine; }
+
   std::string GetCommandName(RLMachine& machine,
                              const libreallive::CommandElement& f);
 
@@ -152,6 +165,8 @@ class RLModule {
 
   // Store functions.
   OpcodeMap stored_operations_;
+
+  RLMachine* machine_ = nullptr;
 };
 
 std::ostream& operator<<(std::ostream&, const RLModule& module);
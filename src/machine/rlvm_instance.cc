@@ -41,7 +41,10 @@
 #include "platforms/gcn/gcn_platform.h"
 #include "systems/base/event_system.h"
 #include "systems/base/graphics_system.h"
+#include "systems/base/sound_system.h"
+#include "systems/base/surface_cache.h"
 #include "systems/base/system_error.h"
+#include "systems/base/voice_cache.h"
 #include "systems/sdl/sdl_system.h"
 #include "utf8cpp/utf8.h"
 #include "utilities/exception.h"
@@ -67,7 +70,17 @@ RLVMInstance::RLVMInstance()
       count_undefined_copcodes_(false),
       tracing_(false),
       load_save_(-1),
-      dump_seen_(-1) {
+      dump_seen_(-1),
+      preparse_(false),
+      scenario_cache_(false),
+      report_parse_times_(false),
+      image_cache_mb_(-1),
+      texture_cache_mb_(-1),
+      report_image_cache_(false),
+      report_voice_cache_(false),
+      image_disk_cache_(false),
+      show_screen_damage_(false),
+      full_screen_redraw_(false) {
   srand(time(NULL));
 }
 
@@ -92,6 +105,17 @@ void RLVMInstance::Run(const boost::filesystem::path& gamerootPath) {
     if (memory_)
       gameexe("MEMORY") = 1;
 
+    if (image_cache_mb_ != -1)
+      gameexe("IMAGE_CACHE_MB") = image_cache_mb_;
+    if (texture_cache_mb_ != -1)
+      gameexe("TEXTURE_CACHE_MB") = texture_cache_mb_;
+    if (image_disk_cache_)
+      gameexe("IMAGE_DISK_CACHE") = 1;
+    if (show_screen_damage_)
+      gameexe("SHOW_SCREEN_DAMAGE") = 1;
+    if (full_screen_redraw_)
+      gameexe("FULL_SCREEN_REDRAW") = 1;
+
     if (!custom_font_.empty()) {
       if (!fs::exists(custom_font_)) {
         throw rlvm::UserPresentableError(
@@ -105,6 +129,8 @@ void RLVMInstance::Run(const boost::filesystem::path& gamerootPath) {
 
     libreallive::Archive arc(seenPath.string(), gameexe("REGNAME"));
     SDLSystem sdlSystem(gameexe);
+    if (scenario_cache_)
+      arc.UseScenarioCache(sdlSystem.GameSaveDirectory() / "scenario.cache");
     RLMachine rlmachine(sdlSystem, arc);
     AddAllModules(rlmachine);
     AddGameHacks(rlmachine);
@@ -149,9 +175,16 @@ void RLVMInstance::Run(const boost::filesystem::path& gamerootPath) {
 
     rlmachine.SetHaltOnException(false);
 
+    // Parse the rest of the game while the first scene runs so that later
+    // jumps and farcalls don't stall on decompression.
+    if (preparse_)
+      arc.PreloadAllScenariosInBackground();
+
     if (load_save_ != -1)
       Sys_load()(rlmachine, load_save_);
 
+    RLMachine::ExecutionBudget time_slice;
+    time_slice.milliseconds = 10;
     while (!rlmachine.halted()) {
       // Give SDL a chance to respond to events, redraw the screen,
       // etc.
@@ -161,13 +194,8 @@ void RLVMInstance::Run(const boost::filesystem::path& gamerootPath) {
       // slice. Bail out if we switch to long operation mode, or if the screen
       // is marked as dirty.
       unsigned int start_ticks = sdlSystem.event().GetTicks();
-      unsigned int end_ticks = start_ticks;
-      do {
-        rlmachine.ExecuteNextInstruction();
-        end_ticks = sdlSystem.event().GetTicks();
-      } while (!rlmachine.CurrentLongOperation() &&
-               !sdlSystem.force_wait() &&
-               (end_ticks - start_ticks < 10));
+      rlmachine.ExecuteBatch(time_slice);
+      unsigned int end_ticks = sdlSystem.event().GetTicks();
 
       // Sleep to be nice to the processor and to give the GPU a chance to
       // catch up.
@@ -182,6 +210,20 @@ void RLVMInstance::Run(const boost::filesystem::path& gamerootPath) {
     }
 
     Serialization::saveGlobalMemory(rlmachine);
+
+    if (report_parse_times_) {
+      std::cerr << "SEEN parse times:" << std::endl;
+      for (auto const& entry : arc.GetScenarioParseTimes()) {
+        std::cerr << "  SEEN" << entry.first << ": " << entry.second.count()
+                  << "us" << std::endl;
+      }
+    }
+
+    if (report_image_cache_)
+      std::cerr << sdlSystem.graphics().image_cache();
+
+    if (report_voice_cache_)
+      std::cerr << sdlSystem.sound().voice_cache();
   }
   catch (rlvm::UserPresentableError& e) {
     ReportFatalError(e.message_text(), e.informative_text());
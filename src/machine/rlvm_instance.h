@@ -54,6 +54,19 @@ class RLVMInstance {
 
   void set_dump_seen(int in) { dump_seen_ = in; }
 
+  void set_preparse() { preparse_ = true; }
+  void set_scenario_cache() { scenario_cache_ = true; }
+  void set_report_parse_times() { report_parse_times_ = true; }
+
+  void set_image_cache_mb(int in) { image_cache_mb_ = in; }
+  void set_texture_cache_mb(int in) { texture_cache_mb_ = in; }
+  void set_report_image_cache() { report_image_cache_ = true; }
+  void set_report_voice_cache() { report_voice_cache_ = true; }
+  void set_image_disk_cache() { image_disk_cache_ = true; }
+
+  void set_show_screen_damage() { show_screen_damage_ = true; }
+  void set_full_screen_redraw() { full_screen_redraw_ = true; }
+
   // Optionally brings up a file selection dialog to get the game directory. In
   // case this isn't implemented or the user clicks cancel, returns an empty
   // path.
@@ -110,6 +123,38 @@ class RLVMInstance {
 
   // Dumps pseudo-kepago of the current seen to stdout and exit if not -1.
   int dump_seen_;
+
+  // Whether we should parse all SEEN files on background threads at startup
+  // instead of on first use.
+  bool preparse_;
+
+  // Whether we should keep decompressed SEEN files in the save directory to
+  // speed up the next launch.
+  bool scenario_cache_;
+
+  // Whether we should print how long each SEEN file took to parse on exit.
+  bool report_parse_times_;
+
+  // Overrides #IMAGE_CACHE_MB and #TEXTURE_CACHE_MB if not -1.
+  int image_cache_mb_;
+  int texture_cache_mb_;
+
+  // Whether we should print the image cache's hit and eviction counts on exit.
+  bool report_image_cache_;
+
+  // Whether we should print how many voices were prefetched in time on exit.
+  bool report_voice_cache_;
+
+  // Whether we should keep decoded images in the save directory to speed up
+  // the next launch.
+  bool image_disk_cache_;
+
+  // Whether we should outline the redrawn parts of the screen.
+  bool show_screen_damage_;
+
+  // Whether we should redraw the whole screen every frame instead of only the
+  // parts that changed.
+  bool full_screen_redraw_;
 };
 
 #endif  // SRC_MACHINE_RLVM_INSTANCE_H_
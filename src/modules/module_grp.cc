@@ -30,6 +30,7 @@
 #include <boost/algorithm/string.hpp>
 #include <functional>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -1446,11 +1447,12 @@ void ReplayGraphicsStackCommand(RLMachine& machine,
       if (command != "") {
         // Parse the string as a chunk of Reallive bytecode.
         libreallive::ConstructionData cdata(0, libreallive::pointer_t());
-        libreallive::BytecodeElement* element =
+        // Without an arena in |cdata|, the element is ours to delete.
+        std::unique_ptr<libreallive::BytecodeElement> element(
             libreallive::BytecodeFactory::Read(
-                command.c_str(), command.c_str() + command.size(), cdata);
+                command.c_str(), command.c_str() + command.size(), cdata));
         libreallive::CommandElement* command =
-            dynamic_cast<libreallive::CommandElement*>(element);
+            dynamic_cast<libreallive::CommandElement*>(element.get());
         if (command) {
           machine.ExecuteCommand(*command);
         }
@@ -98,7 +98,26 @@ int main(int argc, char* argv[]) {
       "undefined-opcodes", "Display a message on undefined opcodes")(
       "count-undefined",
       "On exit, present a summary table about how many times each undefined "
-      "opcode was called")("trace", "Prints opcodes as they are run)");
+      "opcode was called")("trace", "Prints opcodes as they are run)")(
+      "preparse", "Parse all SEEN files on background threads at startup")(
+      "cache-seen",
+      "Keep decompressed SEEN files in the save directory for faster starts")(
+      "parse-times", "On exit, print how long each SEEN file took to parse")(
+      "image-cache-mb", po::value<int>(),
+      "Megabytes of decoded images to keep (Sets #IMAGE_CACHE_MB)")(
+      "texture-cache-mb", po::value<int>(),
+      "Megabytes of textures to keep (Sets #TEXTURE_CACHE_MB)")(
+      "image-cache-stats", "On exit, print image cache hits and evictions")(
+      "voice-cache-stats",
+      "On exit, print how many voices were decoded ahead of being played")(
+      "cache-images",
+      "Keep decoded images in the save directory for faster loads (Sets "
+      "#IMAGE_DISK_CACHE=1)")(
+      "show-damage",
+      "Outline the parts of the screen redrawn each frame (Sets "
+      "#SHOW_SCREEN_DAMAGE=1)")(
+      "full-redraw",
+      "Redraw the whole screen every frame (Sets #FULL_SCREEN_REDRAW=1)");
 
   // Declare the final option to be game-root
   po::options_description hidden("Hidden");
@@ -210,6 +229,36 @@ int main(int argc, char* argv[]) {
   if (vm.count("trace"))
     instance.set_tracing();
 
+  if (vm.count("preparse"))
+    instance.set_preparse();
+
+  if (vm.count("cache-seen"))
+    instance.set_scenario_cache();
+
+  if (vm.count("parse-times"))
+    instance.set_report_parse_times();
+
+  if (vm.count("image-cache-mb"))
+    instance.set_image_cache_mb(vm["image-cache-mb"].as<int>());
+
+  if (vm.count("texture-cache-mb"))
+    instance.set_texture_cache_mb(vm["texture-cache-mb"].as<int>());
+
+  if (vm.count("image-cache-stats"))
+    instance.set_report_image_cache();
+
+  if (vm.count("voice-cache-stats"))
+    instance.set_report_voice_cache();
+
+  if (vm.count("cache-images"))
+    instance.set_image_disk_cache();
+
+  if (vm.count("show-damage"))
+    instance.set_show_screen_damage();
+
+  if (vm.count("full-redraw"))
+    instance.set_full_screen_redraw();
+
   if (vm.count("load-save"))
     instance.set_load_save(vm["load-save"].as<int>());
 
@@ -210,7 +210,8 @@ void AnmGraphicsObjectData::AdvanceFrame() {
     if (time_since_last_frame_change > frames[current_frame_].time) {
       time_since_last_frame_change -= frames[current_frame_].time;
       time_at_last_frame_change_ += frames[current_frame_].time;
-      system_.graphics().MarkScreenAsDirty(GUT_DISPLAY_OBJ);
+      MarkOwnerAsChanged();
+      system_.graphics().MarkScreenAsDirty(GUT_OBJECT_STATE);
 
       cur_frame_++;
       if (cur_frame_ == cur_frame_end_) {
@@ -259,7 +260,9 @@ void AnmGraphicsObjectData::PlaySet(int set) {
   cur_frame_end_ = framelist_.at(*cur_frame_set_).end();
   current_frame_ = *cur_frame_;
 
-  system_.graphics().MarkScreenAsDirty(GUT_DISPLAY_OBJ);
+  MarkOwnerAsChanged();
+
+  system_.graphics().MarkScreenAsDirty(GUT_OBJECT_STATE);
 }
 
 std::shared_ptr<const Surface> AnmGraphicsObjectData::CurrentSurface(
@@ -0,0 +1,542 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#include "systems/base/audio_mixer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "utilities/cpu_dispatch.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if RLVM_HAVE_NEON_KERNELS
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+// -----------------------------------------------------------------------
+// Mixing kernels
+// -----------------------------------------------------------------------
+
+struct MixerKernels {
+  // Adds |frames| stereo frames of |in| to |out|, with frame i scaled by
+  // gain + step * i.
+  void (*mix)(float* out,
+              const float* in,
+              size_t frames,
+              float gain,
+              float step);
+
+  // Adds |count| samples of |in|, scaled to 16 bits and rounded, to |out|,
+  // saturating.
+  void (*accumulate_s16)(int16_t* out, const float* in, size_t count);
+
+  const char* name;
+};
+
+void MixScalar(float* out,
+               const float* in,
+               size_t frames,
+               float gain,
+               float step) {
+  for (size_t i = 0; i < frames; ++i) {
+    float g = gain + step * static_cast<float>(i);
+    out[i * 2] += in[i * 2] * g;
+    out[i * 2 + 1] += in[i * 2 + 1] * g;
+  }
+}
+
+void AccumulateS16Scalar(int16_t* out, const float* in, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    float sample =
+        std::min(32767.0f, std::max(-32768.0f, in[i] * 32768.0f));
+    int sum = out[i] + static_cast<int>(std::lrint(sample));
+    out[i] = static_cast<int16_t>(std::min(32767, std::max(-32768, sum)));
+  }
+}
+
+#if defined(__SSE2__)
+// Four frames per iteration; each vector holds two frames, so the gain
+// offsets come in pairs.
+void MixSSE2(float* out,
+             const float* in,
+             size_t frames,
+             float gain,
+             float step) {
+  const __m128 base = _mm_set1_ps(gain);
+  const __m128 steps = _mm_set1_ps(step);
+  const __m128 advance = _mm_set1_ps(4.0f);
+  __m128 index_a = _mm_set_ps(1.0f, 1.0f, 0.0f, 0.0f);
+  __m128 index_b = _mm_set_ps(3.0f, 3.0f, 2.0f, 2.0f);
+  size_t i = 0;
+  for (; i + 4 <= frames; i += 4) {
+    __m128 gain_a = _mm_add_ps(base, _mm_mul_ps(steps, index_a));
+    __m128 gain_b = _mm_add_ps(base, _mm_mul_ps(steps, index_b));
+    __m128 out_a = _mm_loadu_ps(out + i * 2);
+    __m128 out_b = _mm_loadu_ps(out + i * 2 + 4);
+    out_a = _mm_add_ps(out_a, _mm_mul_ps(_mm_loadu_ps(in + i * 2), gain_a));
+    out_b =
+        _mm_add_ps(out_b, _mm_mul_ps(_mm_loadu_ps(in + i * 2 + 4), gain_b));
+    _mm_storeu_ps(out + i * 2, out_a);
+    _mm_storeu_ps(out + i * 2 + 4, out_b);
+    index_a = _mm_add_ps(index_a, advance);
+    index_b = _mm_add_ps(index_b, advance);
+  }
+  MixScalar(out + i * 2, in + i * 2, frames - i,
+            gain + step * static_cast<float>(i), step);
+}
+
+// _mm_cvtps_epi32 rounds to nearest even, as lrint does in the default
+// rounding mode, and _mm_packs_epi32 saturates.
+void AccumulateS16SSE2(int16_t* out, const float* in, size_t count) {
+  const __m128 scale = _mm_set1_ps(32768.0f);
+  const __m128 high = _mm_set1_ps(32767.0f);
+  const __m128 low = _mm_set1_ps(-32768.0f);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m128i* p = reinterpret_cast<__m128i*>(out + i);
+    __m128i existing = _mm_loadu_si128(p);
+    __m128i existing_a =
+        _mm_srai_epi32(_mm_unpacklo_epi16(existing, existing), 16);
+    __m128i existing_b =
+        _mm_srai_epi32(_mm_unpackhi_epi16(existing, existing), 16);
+    __m128 a = _mm_min_ps(
+        high, _mm_max_ps(low, _mm_mul_ps(_mm_loadu_ps(in + i), scale)));
+    __m128 b = _mm_min_ps(
+        high, _mm_max_ps(low, _mm_mul_ps(_mm_loadu_ps(in + i + 4), scale)));
+    __m128i sum_a = _mm_add_epi32(existing_a, _mm_cvtps_epi32(a));
+    __m128i sum_b = _mm_add_epi32(existing_b, _mm_cvtps_epi32(b));
+    _mm_storeu_si128(p, _mm_packs_epi32(sum_a, sum_b));
+  }
+  AccumulateS16Scalar(out + i, in + i, count - i);
+}
+#endif
+
+#if RLVM_HAVE_NEON_KERNELS
+void MixNEON(float* out,
+             const float* in,
+             size_t frames,
+             float gain,
+             float step) {
+  const float32x4_t base = vdupq_n_f32(gain);
+  const float32x4_t advance = vdupq_n_f32(4.0f);
+  const float offsets_a[4] = {0.0f, 0.0f, 1.0f, 1.0f};
+  const float offsets_b[4] = {2.0f, 2.0f, 3.0f, 3.0f};
+  float32x4_t index_a = vld1q_f32(offsets_a);
+  float32x4_t index_b = vld1q_f32(offsets_b);
+  size_t i = 0;
+  for (; i + 4 <= frames; i += 4) {
+    float32x4_t gain_a = vaddq_f32(base, vmulq_n_f32(index_a, step));
+    float32x4_t gain_b = vaddq_f32(base, vmulq_n_f32(index_b, step));
+    vst1q_f32(out + i * 2, vaddq_f32(vld1q_f32(out + i * 2),
+                                     vmulq_f32(vld1q_f32(in + i * 2),
+                                               gain_a)));
+    vst1q_f32(out + i * 2 + 4, vaddq_f32(vld1q_f32(out + i * 2 + 4),
+                                         vmulq_f32(vld1q_f32(in + i * 2 + 4),
+                                                   gain_b)));
+    index_a = vaddq_f32(index_a, advance);
+    index_b = vaddq_f32(index_b, advance);
+  }
+  MixScalar(out + i * 2, in + i * 2, frames - i,
+            gain + step * static_cast<float>(i), step);
+}
+
+void AccumulateS16NEON(int16_t* out, const float* in, size_t count) {
+  const float32x4_t high = vdupq_n_f32(32767.0f);
+  const float32x4_t low = vdupq_n_f32(-32768.0f);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    int16x8_t existing = vld1q_s16(out + i);
+    float32x4_t a = vminq_f32(
+        high, vmaxq_f32(low, vmulq_n_f32(vld1q_f32(in + i), 32768.0f)));
+    float32x4_t b = vminq_f32(
+        high, vmaxq_f32(low, vmulq_n_f32(vld1q_f32(in + i + 4), 32768.0f)));
+    int32x4_t sum_a =
+        vaddq_s32(vmovl_s16(vget_low_s16(existing)), vcvtnq_s32_f32(a));
+    int32x4_t sum_b =
+        vaddq_s32(vmovl_s16(vget_high_s16(existing)), vcvtnq_s32_f32(b));
+    vst1q_s16(out + i, vcombine_s16(vqmovn_s32(sum_a), vqmovn_s32(sum_b)));
+  }
+  AccumulateS16Scalar(out + i, in + i, count - i);
+}
+#endif
+
+MixerKernels SelectMixerKernels() {
+#if defined(__SSE2__)
+  return {MixSSE2, AccumulateS16SSE2, "sse2"};
+#elif RLVM_HAVE_NEON_KERNELS
+  return {MixNEON, AccumulateS16NEON, "neon"};
+#else
+  return {MixScalar, AccumulateS16Scalar, "scalar"};
+#endif
+}
+
+const MixerKernels& CurrentKernels() {
+  static const KernelDispatch<MixerKernels> kernels(
+      SelectMixerKernels, {MixScalar, AccumulateS16Scalar, "scalar"});
+  return kernels.get();
+}
+
+}  // namespace
+
+// -----------------------------------------------------------------------
+// AudioClip
+// -----------------------------------------------------------------------
+
+AudioClip::AudioClip(std::vector<float> samples)
+    : samples_(std::move(samples)) {
+  samples_.resize(samples_.size() & ~static_cast<size_t>(1));
+}
+
+AudioClip::~AudioClip() {}
+
+// static
+std::shared_ptr<AudioClip> AudioClip::FromPCM16(const int16_t* pcm,
+                                                size_t frames,
+                                                int channels) {
+  std::vector<float> samples;
+  if (channels > 0) {
+    samples.resize(frames * 2);
+    int right = channels > 1 ? 1 : 0;
+    for (size_t i = 0; i < frames; ++i) {
+      samples[i * 2] = pcm[i * channels] * (1.0f / 32768.0f);
+      samples[i * 2 + 1] = pcm[i * channels + right] * (1.0f / 32768.0f);
+    }
+  }
+  return std::make_shared<AudioClip>(std::move(samples));
+}
+
+// -----------------------------------------------------------------------
+// AudioMixer
+// -----------------------------------------------------------------------
+
+AudioMixer::AudioMixer(int rate, int channels)
+    : rate_(rate),
+      channel_count_(channels),
+      commands_(new Command[kCommandQueueSize]),
+      commands_read_(0),
+      commands_written_(0),
+      voices_(channels),
+      scratch_(kMaxBlockFrames * 2),
+      playing_(new std::atomic<bool>[channels]),
+      owned_(channels),
+      last_command_(channels, 0),
+      expect_playing_(channels, false),
+      dropped_commands_(0) {
+  for (int i = 0; i < channels; ++i) {
+    voices_[i] = {nullptr, 0, false, 1.0f, 1.0f, 1.0f, 0.0f, 0, false};
+    playing_[i] = false;
+  }
+}
+
+AudioMixer::~AudioMixer() {}
+
+void AudioMixer::Play(int channel,
+                      std::shared_ptr<const AudioClip> clip,
+                      bool loop,
+                      int fade_in_ms) {
+  if (channel < 0 || channel >= channel_count_)
+    return;
+
+  Command command = {PLAY, channel, clip.get(), loop, MsToFrames(fade_in_ms),
+                     0.0f};
+  size_t sequence = Push(command);
+  if (!sequence)
+    return;
+
+  Retire(std::move(owned_[channel]), sequence);
+  owned_[channel] = std::move(clip);
+  last_command_[channel] = sequence;
+  expect_playing_[channel] = owned_[channel] != nullptr;
+}
+
+void AudioMixer::Stop(int channel) {
+  if (channel < 0 || channel >= channel_count_)
+    return;
+
+  size_t sequence = Push({STOP, channel, nullptr, false, 0, 0.0f});
+  if (!sequence)
+    return;
+
+  Retire(std::move(owned_[channel]), sequence);
+  last_command_[channel] = sequence;
+  expect_playing_[channel] = false;
+}
+
+void AudioMixer::StopAll() {
+  size_t sequence = Push({STOP_ALL, 0, nullptr, false, 0, 0.0f});
+  if (!sequence)
+    return;
+
+  for (int i = 0; i < channel_count_; ++i) {
+    Retire(std::move(owned_[i]), sequence);
+    last_command_[i] = sequence;
+    expect_playing_[i] = false;
+  }
+}
+
+void AudioMixer::FadeOut(int channel, int ms) {
+  if (channel < 0 || channel >= channel_count_)
+    return;
+  if (ms <= 0) {
+    Stop(channel);
+    return;
+  }
+
+  bool playing = IsPlaying(channel);
+  size_t sequence = Push({FADE_OUT, channel, nullptr, false, MsToFrames(ms),
+                          0.0f});
+  if (!sequence)
+    return;
+
+  last_command_[channel] = sequence;
+  expect_playing_[channel] = playing;
+}
+
+void AudioMixer::SetVolume(int channel, float volume) {
+  if (channel < 0 || channel >= channel_count_)
+    return;
+
+  Push({SET_VOLUME, channel, nullptr, false, 0, volume});
+}
+
+bool AudioMixer::IsPlaying(int channel) const {
+  if (channel < 0 || channel >= channel_count_)
+    return false;
+
+  if (last_command_[channel] > commands_read_.load(std::memory_order_acquire))
+    return expect_playing_[channel];
+  return playing_[channel].load(std::memory_order_acquire);
+}
+
+void AudioMixer::CollectGarbage() {
+  size_t read = commands_read_.load(std::memory_order_acquire);
+  while (!retired_.empty() && retired_.front().first <= read)
+    retired_.pop_front();
+
+  // Once the audio thread has applied the last play and the sound has
+  // ended, nothing will point it at the clip again.
+  for (int i = 0; i < channel_count_; ++i) {
+    if (owned_[i] && last_command_[i] <= read &&
+        !playing_[i].load(std::memory_order_acquire)) {
+      owned_[i].reset();
+    }
+  }
+}
+
+void AudioMixer::Mix(float* out, int frames) {
+  DrainCommands();
+
+  std::fill(out, out + frames * 2, 0.0f);
+  for (int i = 0; i < channel_count_; ++i)
+    MixVoice(i, out, frames);
+}
+
+void AudioMixer::MixIntoS16(int16_t* out, int frames) {
+  while (frames > 0) {
+    int block = frames < kMaxBlockFrames ? frames : kMaxBlockFrames;
+    Mix(scratch_.data(), block);
+    CurrentKernels().accumulate_s16(out, scratch_.data(), block * 2);
+    out += block * 2;
+    frames -= block;
+  }
+}
+
+int AudioMixer::MsToFrames(int ms) const {
+  return static_cast<int>(static_cast<int64_t>(std::max(ms, 0)) * rate_ /
+                          1000);
+}
+
+size_t AudioMixer::Push(const Command& command) {
+  CollectGarbage();
+
+  size_t written = commands_written_.load(std::memory_order_relaxed);
+  size_t read = commands_read_.load(std::memory_order_acquire);
+  if (written - read >= kCommandQueueSize) {
+    ++dropped_commands_;
+    return 0;
+  }
+
+  commands_[written % kCommandQueueSize] = command;
+  commands_written_.store(written + 1, std::memory_order_release);
+  return written + 1;
+}
+
+void AudioMixer::Retire(std::shared_ptr<const AudioClip> clip,
+                        size_t sequence) {
+  if (clip)
+    retired_.emplace_back(sequence, std::move(clip));
+}
+
+void AudioMixer::Apply(const Command& command) {
+  switch (command.type) {
+    case PLAY: {
+      Voice& voice = voices_[command.channel];
+      if (!command.clip) {
+        StopVoice(command.channel);
+        break;
+      }
+      voice.clip = command.clip;
+      voice.position = 0;
+      voice.loop = command.loop;
+      voice.volume = voice.target_volume;
+      voice.envelope = command.frames > 0 ? 0.0f : 1.0f;
+      voice.envelope_step = command.frames > 0 ? 1.0f / command.frames : 0.0f;
+      voice.envelope_frames = command.frames;
+      voice.stop_after_envelope = false;
+      playing_[command.channel].store(true, std::memory_order_relaxed);
+      break;
+    }
+    case STOP:
+      StopVoice(command.channel);
+      break;
+    case STOP_ALL:
+      for (int i = 0; i < channel_count_; ++i)
+        StopVoice(i);
+      break;
+    case FADE_OUT: {
+      Voice& voice = voices_[command.channel];
+      if (voice.clip) {
+        voice.envelope_frames = std::max(command.frames, 1);
+        voice.envelope_step = -voice.envelope / voice.envelope_frames;
+        voice.stop_after_envelope = true;
+      }
+      break;
+    }
+    case SET_VOLUME: {
+      Voice& voice = voices_[command.channel];
+      voice.target_volume = command.volume;
+      if (!voice.clip)
+        voice.volume = command.volume;
+      break;
+    }
+  }
+}
+
+void AudioMixer::DrainCommands() {
+  size_t read = commands_read_.load(std::memory_order_relaxed);
+  size_t written = commands_written_.load(std::memory_order_acquire);
+  if (read == written)
+    return;
+
+  for (; read != written; ++read)
+    Apply(commands_[read % kCommandQueueSize]);
+
+  // Publishing the read position after applying means the game thread sees
+  // each command's effect on |playing_| as soon as it sees it consumed.
+  commands_read_.store(read, std::memory_order_release);
+}
+
+void AudioMixer::MixVoice(int channel, float* out, int frames) {
+  Voice& voice = voices_[channel];
+  const float start_volume = voice.volume;
+  const float end_volume = voice.target_volume;
+  voice.volume = voice.target_volume;
+  if (!voice.clip)
+    return;
+
+  // Gains are exact at segment ends and linear between them. Segments break
+  // at the end of the clip and of the fade envelope.
+  auto volume_at = [&](int frame) {
+    return start_volume +
+           (end_volume - start_volume) * (static_cast<float>(frame) / frames);
+  };
+
+  const MixerKernels& kernels = CurrentKernels();
+  const size_t length = voice.clip->frames();
+  int done = 0;
+  while (done < frames) {
+    if (voice.position == length) {
+      if (!voice.loop || length == 0) {
+        StopVoice(channel);
+        return;
+      }
+      voice.position = 0;
+    }
+
+    int count = static_cast<int>(
+        std::min<size_t>(frames - done, length - voice.position));
+    float end_envelope = voice.envelope;
+    if (voice.envelope_frames > 0) {
+      count = std::min(count, voice.envelope_frames);
+      end_envelope += voice.envelope_step * count;
+    }
+
+    float start_gain = volume_at(done) * voice.envelope;
+    float end_gain = volume_at(done + count) * end_envelope;
+    kernels.mix(out + done * 2, voice.clip->samples() + voice.position * 2,
+                count, start_gain, (end_gain - start_gain) / count);
+    voice.position += count;
+    done += count;
+
+    if (voice.envelope_frames > 0) {
+      voice.envelope_frames -= count;
+      voice.envelope = end_envelope;
+      if (voice.envelope_frames == 0) {
+        if (voice.stop_after_envelope) {
+          StopVoice(channel);
+          return;
+        }
+        voice.envelope = 1.0f;
+      }
+    }
+  }
+
+  if (voice.position == length && !voice.loop)
+    StopVoice(channel);
+}
+
+void AudioMixer::StopVoice(int channel) {
+  Voice& voice = voices_[channel];
+  voice.clip = nullptr;
+  voice.volume = voice.target_volume;
+  voice.envelope_frames = 0;
+  playing_[channel].store(false, std::memory_order_release);
+}
+
+// -----------------------------------------------------------------------
+// NullAudioSink
+// -----------------------------------------------------------------------
+
+NullAudioSink::NullAudioSink(AudioMixer& mixer) : mixer_(mixer) {}
+
+NullAudioSink::~NullAudioSink() {}
+
+void NullAudioSink::Render(int frames) {
+  size_t start = output_.size();
+  output_.resize(start + frames * 2);
+  mixer_.Mix(output_.data() + start, frames);
+}
+
+// -----------------------------------------------------------------------
+
+const char* AudioMixerKernelName() { return CurrentKernels().name; }
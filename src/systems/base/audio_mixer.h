@@ -0,0 +1,219 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#ifndef SRC_SYSTEMS_BASE_AUDIO_MIXER_H_
+#define SRC_SYSTEMS_BASE_AUDIO_MIXER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// A decoded sound, as interleaved stereo float frames already at the rate of
+// the AudioMixer it will play on. Clips are immutable once built, so one can
+// play on several channels at once.
+class AudioClip {
+ public:
+  explicit AudioClip(std::vector<float> samples);
+  ~AudioClip();
+
+  // Converts |frames| frames of interleaved 16-bit PCM with |channels|
+  // channels. Mono is played on both sides; channels past the second are
+  // dropped.
+  static std::shared_ptr<AudioClip> FromPCM16(const int16_t* pcm,
+                                              size_t frames,
+                                              int channels);
+
+  size_t frames() const { return samples_.size() / 2; }
+  const float* samples() const { return samples_.data(); }
+
+ private:
+  std::vector<float> samples_;
+};
+
+// Mixes the wav, se and koe channels into a float bus. The game thread only
+// queues commands; Mix() runs on the audio thread, applies them at the start
+// of the next block and does all the per-sample work, including fade
+// envelopes and volume ramps. Neither side takes a lock.
+//
+// Everything except Mix() and MixIntoS16() must be called from one game
+// thread.
+class AudioMixer {
+ public:
+  // Mix() handles any block size, but works through it this many frames at
+  // a time when it needs scratch space.
+  static const int kMaxBlockFrames = 4096;
+
+  AudioMixer(int rate, int channels);
+  ~AudioMixer();
+
+  int rate() const { return rate_; }
+  int channels() const { return channel_count_; }
+
+  // Starts |clip| on |channel|, replacing what played there. A positive
+  // |fade_in_ms| ramps it up from silence.
+  void Play(int channel,
+            std::shared_ptr<const AudioClip> clip,
+            bool loop,
+            int fade_in_ms = 0);
+
+  void Stop(int channel);
+  void StopAll();
+
+  // Ramps |channel| down to silence over |ms| and stops it.
+  void FadeOut(int channel, int ms);
+
+  // Sets the gain of |channel|, where 1.0 is full volume. A change while a
+  // sound plays is ramped over the next block so it doesn't click.
+  void SetVolume(int channel, float volume);
+
+  // Whether |channel| is playing, counting commands the audio thread hasn't
+  // picked up yet.
+  bool IsPlaying(int channel) const;
+
+  // Releases clips the audio thread has finished with. The command methods
+  // call this; callers only need to when they stop issuing commands for a
+  // while.
+  void CollectGarbage();
+
+  // Commands that didn't fit in the queue because the audio thread wasn't
+  // draining it.
+  int dropped_commands() const { return dropped_commands_; }
+
+  // Audio thread side: replaces |out| with the next |frames| interleaved
+  // stereo frames.
+  void Mix(float* out, int frames);
+
+  // Audio thread side: adds the next |frames| stereo frames to the 16-bit
+  // stream |out|, saturating, for devices that have already written music
+  // there.
+  void MixIntoS16(int16_t* out, int frames);
+
+ private:
+  enum CommandType { PLAY, STOP, STOP_ALL, FADE_OUT, SET_VOLUME };
+
+  struct Command {
+    CommandType type;
+    int channel;
+    const AudioClip* clip;
+    bool loop;
+    int frames;
+    float volume;
+  };
+
+  // Audio thread state for a channel.
+  struct Voice {
+    const AudioClip* clip;
+    size_t position;
+    bool loop;
+
+    // |volume| ramps to |target_volume| over one block.
+    float volume;
+    float target_volume;
+
+    // Fade envelope: |envelope| moves by |envelope_step| per frame for
+    // |envelope_frames| more frames, then stops the voice if
+    // |stop_after_envelope|.
+    float envelope;
+    float envelope_step;
+    int envelope_frames;
+    bool stop_after_envelope;
+  };
+
+  static const int kCommandQueueSize = 256;
+
+  int MsToFrames(int ms) const;
+
+  // Queues |command|, returning its sequence number, or 0 if the queue was
+  // full.
+  size_t Push(const Command& command);
+
+  // Keeps |clip| alive until the audio thread is past command |sequence|.
+  void Retire(std::shared_ptr<const AudioClip> clip, size_t sequence);
+
+  void Apply(const Command& command);
+  void DrainCommands();
+  void MixVoice(int channel, float* out, int frames);
+  void StopVoice(int channel);
+
+  const int rate_;
+  const int channel_count_;
+
+  // Single producer, single consumer queue of commands. A command's
+  // sequence number is |commands_written_| just after it was pushed, so
+  // |commands_read_| is also the last sequence number the audio thread has
+  // applied.
+  std::unique_ptr<Command[]> commands_;
+  std::atomic<size_t> commands_read_;
+  std::atomic<size_t> commands_written_;
+
+  // Audio thread only.
+  std::vector<Voice> voices_;
+  std::vector<float> scratch_;
+
+  // Written by the audio thread as channels start and stop.
+  std::unique_ptr<std::atomic<bool>[]> playing_;
+
+  // Game thread only: the clip last sent to each channel, the sequence
+  // number of the last command that changed whether it plays and what that
+  // command left it doing, and clips waiting for the audio thread to pass a
+  // command.
+  std::vector<std::shared_ptr<const AudioClip>> owned_;
+  std::vector<size_t> last_command_;
+  std::vector<bool> expect_playing_;
+  std::deque<std::pair<size_t, std::shared_ptr<const AudioClip>>> retired_;
+
+  std::atomic<int> dropped_commands_;
+};
+
+// Stands in for an audio device: pulls blocks out of an AudioMixer into
+// memory, so tests and benchmarks can run the mixer without SDL.
+class NullAudioSink {
+ public:
+  explicit NullAudioSink(AudioMixer& mixer);
+  ~NullAudioSink();
+
+  // Mixes |frames| more frames onto the end of output().
+  void Render(int frames);
+
+  // Everything rendered so far, as interleaved stereo frames.
+  const std::vector<float>& output() const { return output_; }
+  void Clear() { output_.clear(); }
+
+ private:
+  AudioMixer& mixer_;
+  std::vector<float> output_;
+};
+
+// Name of the kernels the mixer uses on this CPU: "sse2", "neon" or
+// "scalar".
+const char* AudioMixerKernelName();
+
+#endif  // SRC_SYSTEMS_BASE_AUDIO_MIXER_H_
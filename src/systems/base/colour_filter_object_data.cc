@@ -46,6 +46,13 @@ ColourFilterObjectData::ColourFilterObjectData(GraphicsSystem& system,
 
 ColourFilterObjectData::~ColourFilterObjectData() {}
 
+void ColourFilterObjectData::set_rect(const Rect& screen_rect) {
+  if (screen_rect_ != screen_rect) {
+    screen_rect_ = screen_rect;
+    MarkOwnerAsChanged();
+  }
+}
+
 ColourFilter* ColourFilterObjectData::GetColourFilter() {
   if (!colour_filer_)
     colour_filer_.reset(graphics_system_.BuildColourFiller());
@@ -65,6 +72,7 @@ void ColourFilterObjectData::Render(const GraphicsObject& go,
 
   RGBAColour colour = go.colour();
   GetColourFilter()->Fill(go, screen_rect_, colour);
+  graphics_system_.RecordScreenDraw(screen_rect_);
 
   if (tree) {
     *tree << "  ColourFilterObjectData" << std::endl
@@ -48,7 +48,7 @@ class ColourFilterObjectData : public GraphicsObjectData {
   // load_construct_data helper. Wish I could make this private.
   explicit ColourFilterObjectData(System& system);
 
-  void set_rect(const Rect& screen_rect) { screen_rect_ = screen_rect; }
+  void set_rect(const Rect& screen_rect);
 
   // Returns the colour filter, lazily creating it if necessary.
   ColourFilter* GetColourFilter();
@@ -0,0 +1,375 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#include "systems/base/colour_transform.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+
+#include "systems/base/colour.h"
+#include "systems/base/rect.h"
+#include "utilities/cpu_dispatch.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if RLVM_HAVE_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+#if RLVM_HAVE_NEON_KERNELS
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+const uint32_t kAlphaMask = 0xff000000;
+const uint32_t kColourMask = 0x00ffffff;
+
+// Each channel's replacement for every possible value of it. |shifted| holds
+// them moved into place in a pixel, |bytes| as they are.
+struct ChannelTables {
+  uint32_t shifted[3][256];
+  uint8_t bytes[3][256];
+
+  void Set(int channel, int value, uint8_t out) {
+    shifted[channel][value] = static_cast<uint32_t>(out) << (16 - channel * 8);
+    bytes[channel][value] = out;
+  }
+};
+
+// -----------------------------------------------------------------------
+// Pixel kernels
+// -----------------------------------------------------------------------
+
+struct ColourKernels {
+  void (*invert)(uint32_t* pixels, size_t count);
+  void (*mono)(uint32_t* pixels, size_t count);
+  void (*lookup)(uint32_t* pixels, size_t count, const ChannelTables& tables);
+  const char* name;
+};
+
+// MonoColourTransformer truncated 0.3 * r + 0.59 * g + 0.11 * b after
+// rounding it to a float, which is (30r + 59g + 11b) / 100 for every input.
+// The vector kernels divide by 100 as a multiply by 5243 and a shift by 19,
+// which is exact up to the largest sum of 25500.
+inline uint32_t MonoPixel(uint32_t p) {
+  uint32_t sum = ((p >> 16) & 0xff) * 30 + ((p >> 8) & 0xff) * 59 +
+                 (p & 0xff) * 11;
+  uint32_t grey = sum / 100;
+  return (p & kAlphaMask) | (grey << 16) | (grey << 8) | grey;
+}
+
+void InvertScalar(uint32_t* pixels, size_t count) {
+  for (size_t i = 0; i < count; ++i)
+    pixels[i] ^= kColourMask;
+}
+
+void MonoScalar(uint32_t* pixels, size_t count) {
+  for (size_t i = 0; i < count; ++i)
+    pixels[i] = MonoPixel(pixels[i]);
+}
+
+void LookupScalar(uint32_t* pixels, size_t count, const ChannelTables& tables) {
+  for (size_t i = 0; i < count; ++i) {
+    uint32_t p = pixels[i];
+    pixels[i] = (p & kAlphaMask) | tables.shifted[0][(p >> 16) & 0xff] |
+                tables.shifted[1][(p >> 8) & 0xff] |
+                tables.shifted[2][p & 0xff];
+  }
+}
+
+#if defined(__SSE2__)
+void InvertSSE2(uint32_t* pixels, size_t count) {
+  const __m128i mask = _mm_set1_epi32(kColourMask);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128i* p = reinterpret_cast<__m128i*>(pixels + i);
+    _mm_storeu_si128(p, _mm_xor_si128(_mm_loadu_si128(p), mask));
+  }
+  InvertScalar(pixels + i, count - i);
+}
+
+// Every value below stays under 65536, so the 16-bit multiplies see zeros in
+// the top half of each 32-bit lane.
+void MonoSSE2(uint32_t* pixels, size_t count) {
+  const __m128i byte = _mm_set1_epi32(0xff);
+  const __m128i alpha_bits = _mm_set1_epi32(kAlphaMask);
+  const __m128i red_weight = _mm_set1_epi32(30);
+  const __m128i green_weight = _mm_set1_epi32(59);
+  const __m128i blue_weight = _mm_set1_epi32(11);
+  const __m128i divide = _mm_set1_epi32(5243 << 3);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128i* p = reinterpret_cast<__m128i*>(pixels + i);
+    __m128i v = _mm_loadu_si128(p);
+    __m128i sum = _mm_add_epi16(
+        _mm_add_epi16(
+            _mm_mullo_epi16(_mm_and_si128(_mm_srli_epi32(v, 16), byte),
+                            red_weight),
+            _mm_mullo_epi16(_mm_and_si128(_mm_srli_epi32(v, 8), byte),
+                            green_weight)),
+        _mm_mullo_epi16(_mm_and_si128(v, byte), blue_weight));
+    __m128i grey = _mm_srli_epi32(_mm_mulhi_epu16(sum, divide), 6);
+    __m128i out = _mm_or_si128(
+        _mm_or_si128(grey, _mm_slli_epi32(grey, 8)),
+        _mm_or_si128(_mm_slli_epi32(grey, 16), _mm_and_si128(v, alpha_bits)));
+    _mm_storeu_si128(p, out);
+  }
+  MonoScalar(pixels + i, count - i);
+}
+#endif
+
+#if RLVM_HAVE_X86_KERNELS
+// GCC doesn't emit vzeroupper when leaving these through a function pointer,
+// so each kernel clears the upper halves before returning to SSE code.
+__attribute__((target("avx2"))) void InvertAVX2(uint32_t* pixels,
+                                               size_t count) {
+  const __m256i mask = _mm256_set1_epi32(kColourMask);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256i* p = reinterpret_cast<__m256i*>(pixels + i);
+    _mm256_storeu_si256(p, _mm256_xor_si256(_mm256_loadu_si256(p), mask));
+  }
+  _mm256_zeroupper();
+  InvertScalar(pixels + i, count - i);
+}
+
+__attribute__((target("avx2"))) void MonoAVX2(uint32_t* pixels,
+                                             size_t count) {
+  const __m256i byte = _mm256_set1_epi32(0xff);
+  const __m256i alpha_bits = _mm256_set1_epi32(kAlphaMask);
+  const __m256i red_weight = _mm256_set1_epi32(30);
+  const __m256i green_weight = _mm256_set1_epi32(59);
+  const __m256i blue_weight = _mm256_set1_epi32(11);
+  const __m256i divide = _mm256_set1_epi32(5243 << 3);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256i* p = reinterpret_cast<__m256i*>(pixels + i);
+    __m256i v = _mm256_loadu_si256(p);
+    __m256i sum = _mm256_add_epi16(
+        _mm256_add_epi16(
+            _mm256_mullo_epi16(
+                _mm256_and_si256(_mm256_srli_epi32(v, 16), byte), red_weight),
+            _mm256_mullo_epi16(_mm256_and_si256(_mm256_srli_epi32(v, 8), byte),
+                               green_weight)),
+        _mm256_mullo_epi16(_mm256_and_si256(v, byte), blue_weight));
+    __m256i grey = _mm256_srli_epi32(_mm256_mulhi_epu16(sum, divide), 6);
+    __m256i out = _mm256_or_si256(
+        _mm256_or_si256(grey, _mm256_slli_epi32(grey, 8)),
+        _mm256_or_si256(_mm256_slli_epi32(grey, 16),
+                        _mm256_and_si256(v, alpha_bits)));
+    _mm256_storeu_si256(p, out);
+  }
+  _mm256_zeroupper();
+  MonoScalar(pixels + i, count - i);
+}
+
+__attribute__((target("avx2"))) void LookupAVX2(uint32_t* pixels,
+                                               size_t count,
+                                               const ChannelTables& tables) {
+  const __m256i byte = _mm256_set1_epi32(0xff);
+  const __m256i alpha_bits = _mm256_set1_epi32(kAlphaMask);
+  const int* red = reinterpret_cast<const int*>(tables.shifted[0]);
+  const int* green = reinterpret_cast<const int*>(tables.shifted[1]);
+  const int* blue = reinterpret_cast<const int*>(tables.shifted[2]);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256i* p = reinterpret_cast<__m256i*>(pixels + i);
+    __m256i v = _mm256_loadu_si256(p);
+    __m256i r = _mm256_i32gather_epi32(
+        red, _mm256_and_si256(_mm256_srli_epi32(v, 16), byte), 4);
+    __m256i g = _mm256_i32gather_epi32(
+        green, _mm256_and_si256(_mm256_srli_epi32(v, 8), byte), 4);
+    __m256i b = _mm256_i32gather_epi32(blue, _mm256_and_si256(v, byte), 4);
+    _mm256_storeu_si256(
+        p, _mm256_or_si256(_mm256_or_si256(r, g),
+                           _mm256_or_si256(b, _mm256_and_si256(v, alpha_bits))));
+  }
+  _mm256_zeroupper();
+  LookupScalar(pixels + i, count - i, tables);
+}
+#endif
+
+#if RLVM_HAVE_NEON_KERNELS
+void InvertNEON(uint32_t* pixels, size_t count) {
+  const uint32x4_t mask = vdupq_n_u32(kColourMask);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4)
+    vst1q_u32(pixels + i, veorq_u32(vld1q_u32(pixels + i), mask));
+  InvertScalar(pixels + i, count - i);
+}
+
+void MonoNEON(uint32_t* pixels, size_t count) {
+  const uint32x4_t byte = vdupq_n_u32(0xff);
+  const uint32x4_t alpha_bits = vdupq_n_u32(kAlphaMask);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    uint32x4_t v = vld1q_u32(pixels + i);
+    uint32x4_t sum = vmulq_n_u32(vandq_u32(vshrq_n_u32(v, 16), byte), 30);
+    sum = vmlaq_n_u32(sum, vandq_u32(vshrq_n_u32(v, 8), byte), 59);
+    sum = vmlaq_n_u32(sum, vandq_u32(v, byte), 11);
+    uint32x4_t grey = vshrq_n_u32(vmulq_n_u32(sum, 5243), 19);
+    uint32x4_t out = vorrq_u32(vorrq_u32(grey, vshlq_n_u32(grey, 8)),
+                               vorrq_u32(vshlq_n_u32(grey, 16),
+                                         vandq_u32(v, alpha_bits)));
+    vst1q_u32(pixels + i, out);
+  }
+  MonoScalar(pixels + i, count - i);
+}
+
+// A 256 entry byte table is four 64 byte TBL lookups; indexes outside each
+// quarter read as zero.
+inline uint8x16_t LookupBytesNEON(const uint8_t* table, uint8x16_t index) {
+  const uint8x16_t quarter = vdupq_n_u8(64);
+  uint8x16_t out = vqtbl4q_u8(vld1q_u8_x4(table), index);
+  for (int q = 1; q < 4; ++q) {
+    index = vsubq_u8(index, quarter);
+    out = vorrq_u8(out, vqtbl4q_u8(vld1q_u8_x4(table + q * 64), index));
+  }
+  return out;
+}
+
+void LookupNEON(uint32_t* pixels, size_t count, const ChannelTables& tables) {
+  uint8_t* bytes = reinterpret_cast<uint8_t*>(pixels);
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    // Little endian pixels deinterleave into blue, green, red and alpha.
+    uint8x16x4_t v = vld4q_u8(bytes + i * 4);
+    v.val[0] = LookupBytesNEON(tables.bytes[2], v.val[0]);
+    v.val[1] = LookupBytesNEON(tables.bytes[1], v.val[1]);
+    v.val[2] = LookupBytesNEON(tables.bytes[0], v.val[2]);
+    vst4q_u8(bytes + i * 4, v);
+  }
+  LookupScalar(pixels + i, count - i, tables);
+}
+#endif
+
+ColourKernels SelectColourKernels() {
+#if RLVM_HAVE_X86_KERNELS
+  if (CpuHasAVX2())
+    return {InvertAVX2, MonoAVX2, LookupAVX2, "avx2"};
+#endif
+#if defined(__SSE2__)
+  // SSE2 has no gather or byte shuffle, so table lookups stay scalar.
+  return {InvertSSE2, MonoSSE2, LookupScalar, "sse2"};
+#elif RLVM_HAVE_NEON_KERNELS
+  return {InvertNEON, MonoNEON, LookupNEON, "neon"};
+#else
+  return {InvertScalar, MonoScalar, LookupScalar, "scalar"};
+#endif
+}
+
+const ColourKernels& CurrentKernels() {
+  static const KernelDispatch<ColourKernels> kernels(
+      SelectColourKernels,
+      {InvertScalar, MonoScalar, LookupScalar, "scalar"});
+  return kernels.get();
+}
+
+// -----------------------------------------------------------------------
+
+// Runs |kernel| over each row of the part of |area| inside |buffer|.
+void TransformRows(const PixelBuffer& buffer,
+                   const Rect& area,
+                   const std::function<void(uint32_t*, size_t)>& kernel) {
+  const Rect clipped =
+      area.Intersection(Rect(Point(0, 0), buffer.size));
+  if (clipped.width() <= 0 || clipped.height() <= 0)
+    return;
+
+  ForEachRowBand(clipped.height(), clipped.width(), [&](int begin, int end) {
+    for (int y = begin; y < end; ++y)
+      kernel(buffer.row(clipped.y() + y) + clipped.x(), clipped.width());
+  });
+}
+
+void LookupPixels(const PixelBuffer& buffer,
+                  const Rect& area,
+                  const ChannelTables& tables) {
+  const ColourKernels& kernels = CurrentKernels();
+  TransformRows(buffer, area, [&](uint32_t* pixels, size_t count) {
+    kernels.lookup(pixels, count, tables);
+  });
+}
+
+// ApplyColourTransformer's arithmetic for one channel, floats included.
+int ComposeChannel(int in_colour, int surface_colour) {
+  if (in_colour > 0) {
+    return 255 -
+           ((static_cast<float>((255 - in_colour) * (255 - surface_colour)) /
+             (255 * 255)) *
+            255);
+  } else if (in_colour < 0) {
+    return (static_cast<float>(abs(in_colour) * surface_colour) /
+            (255 * 255)) *
+           255;
+  } else {
+    return surface_colour;
+  }
+}
+
+}  // namespace
+
+void InvertPixels(const PixelBuffer& buffer, const Rect& area) {
+  TransformRows(buffer, area, CurrentKernels().invert);
+}
+
+void MonoPixels(const PixelBuffer& buffer, const Rect& area) {
+  TransformRows(buffer, area, CurrentKernels().mono);
+}
+
+void ToneCurvePixels(const PixelBuffer& buffer,
+                     const Rect& area,
+                     const ToneCurveRGBMap& curve) {
+  ChannelTables tables;
+  for (int channel = 0; channel < 3; ++channel) {
+    for (int value = 0; value < 256; ++value)
+      tables.Set(channel, value, curve[channel][value]);
+  }
+  LookupPixels(buffer, area, tables);
+}
+
+void ApplyColourPixels(const PixelBuffer& buffer,
+                       const Rect& area,
+                       const RGBColour& colour) {
+  const int components[] = {colour.r(), colour.g(), colour.b()};
+  ChannelTables tables;
+  for (int channel = 0; channel < 3; ++channel) {
+    for (int value = 0; value < 256; ++value) {
+      // Stored as a Uint8 in an SDL_Color, as the transformer did.
+      tables.Set(channel, value, static_cast<uint8_t>(ComposeChannel(
+                                     components[channel], value)));
+    }
+  }
+  LookupPixels(buffer, area, tables);
+}
+
+const char* ColourTransformKernelName() { return CurrentKernels().name; }
@@ -0,0 +1,63 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#ifndef SRC_SYSTEMS_BASE_COLOUR_TRANSFORM_H_
+#define SRC_SYSTEMS_BASE_COLOUR_TRANSFORM_H_
+
+#include "systems/base/pixel_blitter.h"
+#include "systems/base/tone_curve.h"
+
+class RGBColour;
+class Rect;
+
+// In place colour transforms over the part of |area| inside |buffer|. Each
+// leaves alpha alone and produces exactly what SDLSurface's per-pixel
+// ColourTransformers did. Large areas are split by rows across the
+// SetBlitThreadCount() threads.
+
+// Replaces each colour channel c with 255 - c.
+void InvertPixels(const PixelBuffer& buffer, const Rect& area);
+
+// Replaces each colour with its 0.3/0.59/0.11 weighted grey.
+void MonoPixels(const PixelBuffer& buffer, const Rect& area);
+
+// Maps each channel through its table in |curve|.
+void ToneCurvePixels(const PixelBuffer& buffer,
+                     const Rect& area,
+                     const ToneCurveRGBMap& curve);
+
+// Screens each channel towards 255 by a positive component of |colour| and
+// multiplies it towards 0 by a negative one.
+void ApplyColourPixels(const PixelBuffer& buffer,
+                       const Rect& area,
+                       const RGBColour& colour);
+
+// Name of the kernels the transforms use on this CPU: "avx2", "sse2",
+// "neon" or "scalar".
+const char* ColourTransformKernelName();
+
+#endif  // SRC_SYSTEMS_BASE_COLOUR_TRANSFORM_H_
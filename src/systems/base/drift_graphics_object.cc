@@ -188,7 +188,8 @@ void DriftGraphicsObject::Execute(RLMachine& machine) {
   // throttle to once every 100ms.
   int current_time = system_.event().GetTicks();
   if (current_time - last_rendered_time_ > 10) {
-    system_.graphics().MarkScreenAsDirty(GUT_DISPLAY_OBJ);
+    MarkOwnerAsChanged();
+    system_.graphics().MarkScreenAsDirty(GUT_OBJECT_STATE);
   }
 }
 
@@ -260,7 +260,8 @@ void GanGraphicsObjectData::Execute(RLMachine& machine) {
         EndAnimation();
       } else {
         time_at_last_frame_change_ = current_time;
-        system_.graphics().MarkScreenAsDirty(GUT_DISPLAY_OBJ);
+        MarkOwnerAsChanged();
+        system_.graphics().MarkScreenAsDirty(GUT_OBJECT_STATE);
       }
     }
   }
@@ -323,7 +324,8 @@ void GanGraphicsObjectData::PlaySet(int set) {
   current_set_ = set;
   current_frame_ = 0;
   time_at_last_frame_change_ = system_.event().GetTicks();
-  system_.graphics().MarkScreenAsDirty(GUT_DISPLAY_OBJ);
+  MarkOwnerAsChanged();
+  system_.graphics().MarkScreenAsDirty(GUT_OBJECT_STATE);
 }
 
 template <class Archive>
@@ -339,7 +341,8 @@ void GanGraphicsObjectData::load(Archive& ar, unsigned int version) {
   // suitable value.
   if (time_at_last_frame_change_ != 0) {
     time_at_last_frame_change_ = system_.event().GetTicks();
-    system_.graphics().MarkScreenAsDirty(GUT_DISPLAY_OBJ);
+    MarkOwnerAsChanged();
+    system_.graphics().MarkScreenAsDirty(GUT_OBJECT_STATE);
   }
 }
 
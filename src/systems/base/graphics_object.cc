@@ -40,6 +40,7 @@
 #include <numeric>
 #include <sstream>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "systems/base/graphics_object_data.h"
@@ -137,9 +138,18 @@ GraphicsObject::Impl::ButtonProperties::ButtonProperties()
 // -----------------------------------------------------------------------
 // GraphicsObject
 // -----------------------------------------------------------------------
-GraphicsObject::GraphicsObject() : impl_(s_empty_impl) {}
 
-GraphicsObject::GraphicsObject(const GraphicsObject& rhs) : impl_(rhs.impl_) {
+// Every change takes the next value, so a version is never reused, and a
+// parent layer can use the newest of its children's versions as its own.
+static uint64_t s_next_render_version = 1;
+
+static uint64_t s_render_order_version = 1;
+
+GraphicsObject::GraphicsObject()
+    : impl_(s_empty_impl), render_version_(s_next_render_version++) {}
+
+GraphicsObject::GraphicsObject(const GraphicsObject& rhs)
+    : impl_(rhs.impl_), render_version_(s_next_render_version++) {
   if (rhs.object_data_) {
     object_data_.reset(rhs.object_data_->Clone());
     object_data_->set_owned_by(*this);
@@ -149,13 +159,37 @@ GraphicsObject::GraphicsObject(const GraphicsObject& rhs) : impl_(rhs.impl_) {
 
   for (auto const& mutator : rhs.object_mutators_)
     object_mutators_.emplace_back(mutator->Clone());
+
+  if (is_drawn())
+    MarkRenderOrderChanged();
 }
 
-GraphicsObject::~GraphicsObject() { DeleteObjectMutators(); }
+GraphicsObject::GraphicsObject(GraphicsObject&& rhs)
+    : impl_(std::move(rhs.impl_)),
+      render_version_(s_next_render_version++),
+      object_mutators_(std::move(rhs.object_mutators_)) {
+  rhs.impl_ = s_empty_impl;
+  rhs.object_mutators_.clear();
+  object_data_.swap(rhs.object_data_);
+  if (object_data_)
+    object_data_->set_owned_by(*this);
+
+  if (is_drawn())
+    MarkRenderOrderChanged();
+}
+
+GraphicsObject::~GraphicsObject() {
+  if (is_drawn())
+    MarkRenderOrderChanged();
+  DeleteObjectMutators();
+}
 
 GraphicsObject& GraphicsObject::operator=(const GraphicsObject& obj) {
+  if (is_drawn() || obj.is_drawn())
+    MarkRenderOrderChanged();
   DeleteObjectMutators();
   impl_ = obj.impl_;
+  MarkRenderStateChanged();
 
   if (obj.object_data_) {
     object_data_.reset(obj.object_data_->Clone());
@@ -173,9 +207,13 @@ GraphicsObject& GraphicsObject::operator=(const GraphicsObject& obj) {
 void GraphicsObject::SetObjectData(GraphicsObjectData* obj) {
   object_data_.reset(obj);
   object_data_->set_owned_by(*this);
+  MarkRenderStateChanged();
+  MarkRenderOrderChanged();
 }
 
 void GraphicsObject::SetVisible(const int in) {
+  if (bool(in) != impl_->visible_)
+    MarkRenderOrderChanged();
   MakeImplUnique();
   impl_->visible_ = in;
 }
@@ -370,16 +408,22 @@ void GraphicsObject::SetScrollRateY(const int y) {
 }
 
 void GraphicsObject::SetZOrder(const int in) {
+  if (in != impl_->z_order_)
+    MarkRenderOrderChanged();
   MakeImplUnique();
   impl_->z_order_ = in;
 }
 
 void GraphicsObject::SetZLayer(const int in) {
+  if (in != impl_->z_layer_)
+    MarkRenderOrderChanged();
   MakeImplUnique();
   impl_->z_layer_ = in;
 }
 
 void GraphicsObject::SetZDepth(const int in) {
+  if (in != impl_->z_depth_)
+    MarkRenderOrderChanged();
   MakeImplUnique();
   impl_->z_depth_ = in;
 }
@@ -429,6 +473,32 @@ GraphicsObjectData& GraphicsObject::GetObjectData() {
   }
 }
 
+const GraphicsObjectData& GraphicsObject::GetObjectData() const {
+  if (object_data_) {
+    return *object_data_;
+  } else {
+    throw rlvm::Exception("null object data");
+  }
+}
+
+uint64_t GraphicsObject::render_version() const {
+  if (object_data_)
+    return std::max(render_version_, object_data_->ChildRenderVersion());
+  return render_version_;
+}
+
+void GraphicsObject::MarkRenderStateChanged() {
+  render_version_ = s_next_render_version++;
+}
+
+// static
+uint64_t GraphicsObject::render_order_version() {
+  return s_render_order_version;
+}
+
+// static
+void GraphicsObject::MarkRenderOrderChanged() { ++s_render_order_version; }
+
 void GraphicsObject::SetWipeCopy(const int wipe_copy) {
   MakeImplUnique();
   impl_->wipe_copy_ = wipe_copy;
@@ -853,6 +923,8 @@ std::vector<std::string> GraphicsObject::GetMutatorNames() const {
 }
 
 void GraphicsObject::MakeImplUnique() {
+  // Every parameter setter comes through here.
+  MarkRenderStateChanged();
   if (!impl_.unique()) {
     impl_.reset(new Impl(*impl_));
   }
@@ -875,19 +947,28 @@ void GraphicsObject::Render(int objNum,
 }
 
 void GraphicsObject::FreeObjectData() {
+  if (is_drawn())
+    MarkRenderOrderChanged();
   object_data_.reset();
   DeleteObjectMutators();
+  MarkRenderStateChanged();
 }
 
 void GraphicsObject::InitializeParams() {
+  if (is_drawn())
+    MarkRenderOrderChanged();
   impl_ = s_empty_impl;
   DeleteObjectMutators();
+  MarkRenderStateChanged();
 }
 
 void GraphicsObject::FreeDataAndInitializeParams() {
+  if (is_drawn())
+    MarkRenderOrderChanged();
   object_data_.reset();
   impl_ = s_empty_impl;
   DeleteObjectMutators();
+  MarkRenderStateChanged();
 }
 
 void GraphicsObject::Execute(RLMachine& machine) {
@@ -910,6 +991,9 @@ void GraphicsObject::Execute(RLMachine& machine) {
 template <class Archive>
 void GraphicsObject::serialize(Archive& ar, unsigned int version) {
   ar& impl_& object_data_;
+
+  // Loading replaces everything without going through the setters.
+  MarkRenderOrderChanged();
 }
 
 // -----------------------------------------------------------------------
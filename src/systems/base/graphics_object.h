@@ -33,6 +33,7 @@
 #include <boost/serialization/access.hpp>
 #include <boost/serialization/version.hpp>
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -55,6 +56,9 @@ class GraphicsObject {
  public:
   GraphicsObject();
   GraphicsObject(const GraphicsObject& obj);
+  // Takes |obj|'s data and mutators without cloning them, leaving |obj|
+  // cleared.
+  GraphicsObject(GraphicsObject&& obj);
   ~GraphicsObject();
   GraphicsObject& operator=(const GraphicsObject& obj);
 
@@ -189,9 +193,26 @@ class GraphicsObject {
 
   bool has_object_data() const { return object_data_.get(); }
 
+  // Getting the data doesn't count as a change for render_version(); the data
+  // calls GraphicsObjectData::MarkOwnerAsChanged() when it draws differently.
   GraphicsObjectData& GetObjectData();
+  const GraphicsObjectData& GetObjectData() const;
   void SetObjectData(GraphicsObjectData* obj);
 
+  // Changes whenever something that affects how this object, or one of its
+  // children, is drawn changes. GraphicsSystem compares it between frames to
+  // find the objects it has to redraw.
+  uint64_t render_version() const;
+
+  // Changes render_version() for state the object doesn't see being changed,
+  // such as its data advancing an animation frame.
+  void MarkRenderStateChanged();
+
+  // Changes whenever any object is shown, hidden, gets or loses its data, has
+  // a z value changed, or is overwritten or destroyed while drawn. RenderOrder
+  // only looks at the objects again when this moved.
+  static uint64_t render_order_version();
+
   // Render!
   void Render(int objNum, const GraphicsObject* parent, std::ostream* tree);
 
@@ -321,6 +342,12 @@ class GraphicsObject {
   // doesn't, a local copy is made.
   void MakeImplUnique();
 
+  // Whether Render() draws anything, and so whether the object has a place in
+  // a RenderOrder.
+  bool is_drawn() const { return impl_->visible_ && object_data_; }
+
+  static void MarkRenderOrderChanged();
+
   // Immediately delete all mutators; doesn't run their SetToEnd() method.
   void DeleteObjectMutators();
 
@@ -518,6 +545,9 @@ class GraphicsObject {
   // The actual data used to render the object
   boost::scoped_ptr<GraphicsObjectData> object_data_;
 
+  // See render_version(). Not saved; loaded objects get fresh versions.
+  uint64_t render_version_;
+
   // Tasks that run every tick. Used to mutate object parameters over time (and
   // how we check from a blocking LongOperation if the mutation is ongoing).
   //
@@ -276,8 +276,22 @@ int GraphicsObjectData::GetRenderingAlpha(const GraphicsObject& go,
   }
 }
 
+void GraphicsObjectData::set_is_currently_playing(bool in) {
+  if (currently_playing_ != in) {
+    currently_playing_ = in;
+    MarkOwnerAsChanged();
+  }
+}
+
 bool GraphicsObjectData::IsAnimation() const { return false; }
 
 void GraphicsObjectData::PlaySet(int set) {}
 
 bool GraphicsObjectData::IsParentLayer() const { return false; }
+
+uint64_t GraphicsObjectData::ChildRenderVersion() const { return 0; }
+
+void GraphicsObjectData::MarkOwnerAsChanged() {
+  if (owned_by_)
+    owned_by_->MarkRenderStateChanged();
+}
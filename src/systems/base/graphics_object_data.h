@@ -30,6 +30,7 @@
 
 #include <boost/serialization/access.hpp>
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
@@ -56,7 +57,7 @@ class GraphicsObjectData {
 
   void set_owned_by(GraphicsObject& godata) { owned_by_ = &godata; }
 
-  void set_is_currently_playing(bool in) { currently_playing_ = in; }
+  void set_is_currently_playing(bool in);
   bool is_currently_playing() const { return currently_playing_; }
 
   // Returns when an animation has completed. (This only returns true when
@@ -80,6 +81,10 @@ class GraphicsObjectData {
   // Whether this object data owns another layer of objects.
   virtual bool IsParentLayer() const;
 
+  // The newest GraphicsObject::render_version() of the objects this data
+  // owns, or 0 if it owns none.
+  virtual uint64_t ChildRenderVersion() const;
+
   // Returns the destination rectangle on the screen to draw srcRect()
   // to. Override to return custom rectangles in the case of a custom animation
   // format.
@@ -94,6 +99,10 @@ class GraphicsObjectData {
   // animation.
   void EndAnimation();
 
+  // Tells the owning object that it now draws differently, e.g. because we
+  // moved to another animation frame.
+  void MarkOwnerAsChanged();
+
   void PrintGraphicsObjectToTree(const GraphicsObject& go, std::ostream* tree);
 
   void PrintStringVector(const std::vector<std::string>& names,
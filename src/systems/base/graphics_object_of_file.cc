@@ -127,7 +127,8 @@ void GraphicsObjectOfFile::Execute(RLMachine& machine) {
 
       time_at_last_frame_change_ += frame_time_;
       time_since_last_frame_change = current_time - time_at_last_frame_change_;
-      system_.graphics().MarkScreenAsDirty(GUT_DISPLAY_OBJ);
+      MarkOwnerAsChanged();
+      system_.graphics().MarkScreenAsDirty(GUT_OBJECT_STATE);
     }
   }
 }
@@ -182,7 +183,8 @@ void GraphicsObjectOfFile::PlaySet(int frame_time) {
   }
 
   time_at_last_frame_change_ = system_.event().GetTicks();
-  system_.graphics().MarkScreenAsDirty(GUT_DISPLAY_OBJ);
+  MarkOwnerAsChanged();
+  system_.graphics().MarkScreenAsDirty(GUT_OBJECT_STATE);
 }
 
 // -----------------------------------------------------------------------
@@ -199,7 +201,8 @@ void GraphicsObjectOfFile::load(Archive& ar, unsigned int version) {
   // suitable value.
   if (time_at_last_frame_change_ != 0) {
     time_at_last_frame_change_ = system_.event().GetTicks();
-    system_.graphics().MarkScreenAsDirty(GUT_DISPLAY_OBJ);
+    MarkOwnerAsChanged();
+    system_.graphics().MarkScreenAsDirty(GUT_OBJECT_STATE);
   }
 }
 
@@ -61,10 +61,13 @@
 #include "systems/base/graphics_stack_frame.h"
 #include "systems/base/hik_renderer.h"
 #include "systems/base/hik_script.h"
+#include "systems/base/image_disk_cache.h"
+#include "systems/base/image_loader.h"
 #include "systems/base/mouse_cursor.h"
 #include "systems/base/object_mutator.h"
 #include "systems/base/object_settings.h"
 #include "systems/base/surface.h"
+#include "systems/base/surface_cache.h"
 #include "systems/base/system.h"
 #include "systems/base/system_error.h"
 #include "systems/base/text_system.h"
@@ -76,7 +79,6 @@ using std::cerr;
 using std::cout;
 using std::endl;
 using std::fill;
-using std::get;
 using std::for_each;
 using std::ostringstream;
 using std::vector;
@@ -223,6 +225,10 @@ GraphicsSystem::GraphicsSystem(System& system, Gameexe& gameexe)
     : screen_update_mode_(SCREENUPDATEMODE_AUTOMATIC),
       background_type_(BACKGROUND_DC0),
       screen_needs_refresh_(false),
+      redraw_damage_only_(!gameexe("FULL_SCREEN_REDRAW").ToInt(0)),
+      show_screen_damage_(gameexe("SHOW_SCREEN_DAMAGE").ToInt(0)),
+      is_refreshing_(false),
+      draw_bounds_(NULL),
       object_state_dirty_(false),
       is_responsible_for_update_(true),
       display_subtitle_(gameexe("SUBTITLE").ToInt(0)),
@@ -238,7 +244,12 @@ GraphicsSystem::GraphicsSystem(System& system, Gameexe& gameexe)
       system_(system),
       preloaded_hik_scripts_(32),
       preloaded_g00_(256),
-      image_cache_(10) {}
+      image_cache_(SurfaceCache::FromGameexe(gameexe)) {
+  if (gameexe("IMAGE_DISK_CACHE").ToInt(0)) {
+    image_disk_cache_.reset(
+        new ImageDiskCache(system.GameSaveDirectory() / "images"));
+  }
+}
 
 // -----------------------------------------------------------------------
 
@@ -246,7 +257,46 @@ GraphicsSystem::~GraphicsSystem() {}
 
 // -----------------------------------------------------------------------
 
+void GraphicsSystem::EnableBackgroundImageDecoding(int thread_count) {
+  image_loader_.reset(new ImageLoader(thread_count, image_disk_cache_.get()));
+}
+
+// -----------------------------------------------------------------------
+
 void GraphicsSystem::MarkScreenAsDirty(GraphicsUpdateType type) {
+  switch (type) {
+    case GUT_TEXTSYS:
+    case GUT_OBJECT_STATE:
+      // Refresh() compares objects against the last frame, and always redraws
+      // where the text was and is.
+    case GUT_MOUSE_MOTION:
+      // The cursor isn't part of the frame.
+      break;
+    default:
+      screen_damage_.AddAll();
+      break;
+  }
+
+  RefreshForUpdateMode();
+}
+
+// -----------------------------------------------------------------------
+
+void GraphicsSystem::MarkScreenAreaAsDirty(const Rect& area) {
+  screen_damage_.Add(area);
+  RefreshForUpdateMode();
+}
+
+// -----------------------------------------------------------------------
+
+void GraphicsSystem::RecordScreenDraw(const Rect& area) {
+  if (draw_bounds_)
+    *draw_bounds_ = draw_bounds_->RectUnion(area);
+}
+
+// -----------------------------------------------------------------------
+
+void GraphicsSystem::RefreshForUpdateMode() {
   switch (screen_update_mode()) {
     case SCREENUPDATEMODE_AUTOMATIC:
     case SCREENUPDATEMODE_SEMIAUTOMATIC: {
@@ -310,6 +360,7 @@ void GraphicsSystem::QueueShakeSpec(int spec) {
       }
     }
 
+    screen_damage_.AddAll();
     ForceRefresh();
     time_at_last_queue_change_ = system().event().GetTicks();
   }
@@ -415,6 +466,14 @@ void GraphicsSystem::ReplayGraphicsStack(RLMachine& machine) {
 
 // -----------------------------------------------------------------------
 
+void GraphicsSystem::set_graphics_background(GraphicsBackgroundType t) {
+  if (t != background_type_)
+    screen_damage_.AddAll();
+  background_type_ = t;
+}
+
+// -----------------------------------------------------------------------
+
 void GraphicsSystem::SetHikRenderer(HIKRenderer* renderer) {
   hik_renderer_.reset(renderer);
 }
@@ -429,6 +488,7 @@ void GraphicsSystem::AddRenderable(Renderable* renderable) {
 
 void GraphicsSystem::RemoveRenderable(Renderable* renderable) {
   final_renderers_.erase(renderable);
+  screen_damage_.AddAll();
 }
 
 // -----------------------------------------------------------------------
@@ -461,6 +521,7 @@ void GraphicsSystem::ToggleFullscreen() { SetScreenMode(screen_mode() ? 0 : 1);
 
 void GraphicsSystem::ToggleInterfaceHidden() {
   interface_hidden_ = !interface_hidden_;
+  screen_damage_.AddAll();
 }
 
 // -----------------------------------------------------------------------
@@ -473,8 +534,40 @@ const ObjectSettings& GraphicsSystem::GetObjectSettings(const int obj_num) {
 
 void GraphicsSystem::Refresh(std::ostream* tree) {
   BeginFrame();
-  DrawFrame(tree);
+  is_refreshing_ = true;
+
+  CollectObjectsToRender();
+  DamageChangedAreas();
+
+  bool drawn = false;
+  if (redraw_damage_only_ && !tree && CanRedrawDamageOnly() &&
+      background_type_ == BACKGROUND_DC0 && final_renderers_.empty() &&
+      GetScreenOrigin() == Point(0, 0)) {
+    drawn = DrawDamagedAreas();
+    if (!drawn)
+      BeginFrame();
+  }
+
+  if (!drawn) {
+    screen_damage_.AddAll();
+    for (const RenderOrder::Entry& entry : render_order_) {
+      RenderedObject& record = rendered_objects_[entry.slot];
+      record.changed = true;
+      record.bounds = Rect();
+    }
+    rendered_text_bounds_ = Rect();
+    DrawRefreshedFrame(NULL, tree);
+  }
+
+  for (RenderedObject& record : rendered_objects_) {
+    record.drawn = record.in_frame;
+    if (!record.drawn)
+      record.bounds = Rect();
+  }
+
   EndFrame();
+  is_refreshing_ = false;
+  screen_damage_.Clear();
 }
 
 std::shared_ptr<Surface> GraphicsSystem::RenderToSurface() {
@@ -484,6 +577,125 @@ std::shared_ptr<Surface> GraphicsSystem::RenderToSurface() {
 }
 
 void GraphicsSystem::DrawFrame(std::ostream* tree) {
+  DrawBackground(tree);
+  RenderObjects(tree);
+
+  // Render text
+  if (!is_interface_hidden())
+    system().text().Render(tree);
+}
+
+bool GraphicsSystem::CanRedrawDamageOnly() const { return false; }
+
+void GraphicsSystem::RestoreLastFrame() {}
+
+void GraphicsSystem::SetScreenClip(const Rect& area) {}
+
+void GraphicsSystem::ClearScreenClip() {}
+
+void GraphicsSystem::DamageChangedAreas() {
+  if (static_cast<int>(rendered_objects_.size()) < GetObjectLayerSize())
+    rendered_objects_.resize(GetObjectLayerSize());
+
+  for (RenderedObject& record : rendered_objects_) {
+    record.in_frame = false;
+    record.changed = false;
+  }
+
+  for (const RenderOrder::Entry& entry : render_order_) {
+    RenderedObject& record = rendered_objects_[entry.slot];
+    uint64_t version = entry.object->render_version();
+    record.in_frame = true;
+    if (!record.drawn || record.version != version) {
+      screen_damage_.Add(record.bounds);
+      record.version = version;
+      record.changed = true;
+    }
+  }
+
+  // Objects that went away, or were hidden.
+  for (RenderedObject& record : rendered_objects_) {
+    if (record.drawn && !record.in_frame)
+      screen_damage_.Add(record.bounds);
+  }
+
+  // Text windows are redrawn on every refresh; their contents change without
+  // telling us.
+  screen_damage_.Add(rendered_text_bounds_);
+}
+
+bool GraphicsSystem::DrawDamagedAreas() {
+  // Changed objects are drawn in every pass, since we only learn where they
+  // went by drawing them. If they landed somewhere that wasn't redrawn, that
+  // area is damaged too and we go again.
+  for (int attempt = 0; attempt < 2 && !screen_damage_.is_full(); ++attempt) {
+    for (RenderedObject& record : rendered_objects_) {
+      if (record.changed)
+        record.bounds = Rect();
+    }
+    rendered_text_bounds_ = Rect();
+
+    std::vector<Rect> areas = screen_damage_.rects();
+    if (areas.empty()) {
+      // Nothing is damaged yet, but new objects and text still need a
+      // (fully clipped) pass to find out where they are.
+      areas.push_back(Rect());
+    }
+
+    RestoreLastFrame();
+    for (const Rect& area : areas) {
+      SetScreenClip(area);
+      DrawRefreshedFrame(&area, NULL);
+    }
+    ClearScreenClip();
+
+    bool covered = screen_damage_.Covers(rendered_text_bounds_);
+    for (const RenderedObject& record : rendered_objects_) {
+      if (record.changed && !screen_damage_.Covers(record.bounds))
+        covered = false;
+    }
+    if (covered)
+      return true;
+
+    screen_damage_.Add(rendered_text_bounds_);
+    for (const RenderedObject& record : rendered_objects_) {
+      if (record.changed)
+        screen_damage_.Add(record.bounds);
+    }
+  }
+
+  return false;
+}
+
+void GraphicsSystem::DrawRefreshedFrame(const Rect* area, std::ostream* tree) {
+  // An empty |area| only measures where changed objects and text go.
+  if (!area || !area->is_empty())
+    DrawBackground(tree);
+
+  for (const RenderOrder::Entry& entry : render_order_) {
+    RenderedObject& record = rendered_objects_[entry.slot];
+    if (!record.changed) {
+      // An unchanged object looks exactly like it did last frame, so it only
+      // needs drawing where it overlaps what is being redrawn.
+      const Rect& bounds = record.bounds;
+      if (area && !(bounds.x() < area->x2() && area->x() < bounds.x2() &&
+                    bounds.y() < area->y2() && area->y() < bounds.y2()))
+        continue;
+    }
+
+    draw_bounds_ = record.changed ? &record.bounds : NULL;
+    entry.object->Render(entry.slot, NULL, tree);
+    draw_bounds_ = NULL;
+  }
+
+  if (!is_interface_hidden()) {
+    draw_bounds_ = &rendered_text_bounds_;
+    system().text().Render(tree);
+    draw_bounds_ = NULL;
+  }
+}
+
+void GraphicsSystem::DrawBackground(std::ostream* tree) {
   switch (background_type_) {
     case BACKGROUND_DC0: {
       // Display DC0
@@ -505,12 +717,6 @@ void GraphicsSystem::DrawFrame(std::ostream* tree) {
       }
     }
   }
-
-  RenderObjects(tree);
-
-  // Render text
-  if (!is_interface_hidden())
-    system().text().Render(tree);
 }
 
 // -----------------------------------------------------------------------
@@ -527,6 +733,11 @@ void GraphicsSystem::ExecuteGraphicsSystem(RLMachine& machine) {
   if (hik_renderer_ && background_type_ == BACKGROUND_HIK)
     hik_renderer_->Execute(machine);
 
+  if (image_loader_ && !machine.halted())
+    PrefetchUpcomingImages(machine);
+
+  image_cache_->Trim();
+
   // Possibly update the screen shaking state
   if (!screen_shake_queue_.empty()) {
     unsigned int now = system().event().GetTicks();
@@ -537,6 +748,7 @@ void GraphicsSystem::ExecuteGraphicsSystem(RLMachine& machine) {
       accumulated_ticks -= frame_ticks;
       time_at_last_queue_change_ += frame_ticks;
       screen_shake_queue_.pop();
+      screen_damage_.AddAll();
       ForceRefresh();
     }
   }
@@ -552,7 +764,12 @@ void GraphicsSystem::Reset() {
 
   preloaded_hik_scripts_.Clear();
   preloaded_g00_.Clear();
+  image_cache_->UnpinAll();
   hik_renderer_.reset();
+
+  if (image_loader_)
+    image_loader_->Clear();
+  image_lookahead_.Reset();
   background_type_ = BACKGROUND_DC0;
 
   // Reset the cursor
@@ -566,6 +783,10 @@ void GraphicsSystem::Reset() {
   background_type_ = BACKGROUND_DC0;
   subtitle_ = "";
   interface_hidden_ = false;
+
+  rendered_objects_.clear();
+  rendered_text_bounds_ = Rect();
+  screen_damage_.AddAll();
 }
 
 std::shared_ptr<const Surface> GraphicsSystem::GetEmojiSurface() {
@@ -616,22 +837,34 @@ std::shared_ptr<HIKScript> GraphicsSystem::GetHIKScript(
 }
 
 void GraphicsSystem::PreloadG00(int slot, const std::string& name) {
+  ClearPreloadedG00(slot);
+
   // We first check our implicit cache just in case so we don't load it twice.
-  std::shared_ptr<const Surface> surface = image_cache_.fetch(name);
-  if (!surface)
-    surface = LoadSurfaceFromFile(name);
+  std::shared_ptr<const Surface> surface = image_cache_->Fetch(name);
+  if (!surface) {
+    surface = LoadSurface(name);
+    image_cache_->Insert(name, surface);
+  }
 
   if (surface)
     surface->EnsureUploaded();
 
+  // Preloaded surfaces count against the cache's budgets, but stay until the
+  // script clears them.
+  image_cache_->Pin(name);
   preloaded_g00_[slot] = std::make_pair(name, surface);
 }
 
 void GraphicsSystem::ClearPreloadedG00(int slot) {
+  if (preloaded_g00_.exists(slot))
+    image_cache_->Unpin(preloaded_g00_[slot].first);
   preloaded_g00_[slot] = std::make_pair("", std::shared_ptr<const Surface>());
 }
 
-void GraphicsSystem::ClearAllPreloadedG00() { preloaded_g00_.Clear(); }
+void GraphicsSystem::ClearAllPreloadedG00() {
+  preloaded_g00_.Clear();
+  image_cache_->UnpinAll();
+}
 
 std::shared_ptr<const Surface> GraphicsSystem::GetPreloadedG00(
     const std::string& name) {
@@ -665,36 +898,89 @@ std::shared_ptr<const Surface> GraphicsSystem::GetSurfaceNamed(
     return cached_surface;
 
   // First check to see if this surface is already in our internal cache
-  cached_surface = image_cache_.fetch(short_filename);
+  cached_surface = image_cache_->Fetch(short_filename);
   if (cached_surface)
     return cached_surface;
 
-  std::shared_ptr<const Surface> surface_to_ret =
-      LoadSurfaceFromFile(short_filename);
-  image_cache_.insert(short_filename, surface_to_ret);
+  std::shared_ptr<const Surface> surface_to_ret = LoadSurface(short_filename);
+  image_cache_->Insert(short_filename, surface_to_ret);
   return surface_to_ret;
 }
 
+std::shared_future<std::shared_ptr<const DecodedImage>>
+GraphicsSystem::PrefetchSurfaceNamed(const std::string& short_filename) {
+  if (!image_loader_ || image_cache_->Contains(short_filename) ||
+      GetPreloadedG00(short_filename))
+    return ImageLoader::Future();
+
+  boost::filesystem::path path =
+      system().FindFile(short_filename, IMAGE_FILETYPES);
+  if (path.empty())
+    return ImageLoader::Future();
+
+  return image_loader_->Prefetch(short_filename, path);
+}
+
+std::shared_ptr<const Surface> GraphicsSystem::BuildSurfaceFromImage(
+    const std::string& short_filename,
+    const DecodedImage& image) {
+  return std::shared_ptr<const Surface>();
+}
+
+std::shared_ptr<const Surface> GraphicsSystem::LoadSurface(
+    const std::string& short_filename) {
+  if (image_loader_) {
+    ImageLoader::Future decode = image_loader_->Take(short_filename);
+    if (decode.valid()) {
+      try {
+        std::shared_ptr<const Surface> surface =
+            BuildSurfaceFromImage(short_filename, *decode.get());
+        if (surface)
+          return surface;
+      } catch (std::exception& e) {
+        // Load it again below, which reports the error the normal way.
+      }
+    }
+  }
+
+  return LoadSurfaceFromFile(short_filename);
+}
+
+void GraphicsSystem::PrefetchUpcomingImages(RLMachine& machine) {
+  image_lookahead_.Scan(
+      machine.Scenario(), machine.InstructionPointer(),
+      [&](const libreallive::CommandElement& f) {
+        for (const std::string& name : FindImageNames(machine, f))
+          PrefetchSurfaceNamed(name);
+      });
+}
+
 // -----------------------------------------------------------------------
 
 void GraphicsSystem::ClearAndPromoteObjects() {
-  typedef LazyArray<GraphicsObject>::full_iterator FullIterator;
-
-  FullIterator bg = graphics_object_impl_->background_objects.full_begin();
-  FullIterator bg_end = graphics_object_impl_->background_objects.full_end();
-  FullIterator fg = graphics_object_impl_->foreground_objects.full_begin();
-  FullIterator fg_end = graphics_object_impl_->foreground_objects.full_end();
-  for (; bg != bg_end && fg != fg_end; bg++, fg++) {
-    if (fg.valid() && !fg->wipe_copy()) {
+  typedef LazyArray<GraphicsObject>::alloc_iterator AllocIterator;
+
+  LazyArray<GraphicsObject>& bg_objects =
+      graphics_object_impl_->background_objects;
+  LazyArray<GraphicsObject>& fg_objects =
+      graphics_object_impl_->foreground_objects;
+  int size = std::min(bg_objects.size(), fg_objects.size());
+
+  for (AllocIterator fg = fg_objects.begin(); fg != fg_objects.end(); ++fg) {
+    if (static_cast<int>(fg.pos()) >= size)
+      break;
+    if (!fg->wipe_copy()) {
       fg->InitializeParams();
       fg->FreeObjectData();
     }
+  }
 
-    if (bg.valid()) {
-      *fg = *bg;
-      bg->InitializeParams();
-      bg->FreeObjectData();
-    }
+  for (AllocIterator bg = bg_objects.begin(); bg != bg_objects.end(); ++bg) {
+    if (static_cast<int>(bg.pos()) >= size)
+      break;
+    fg_objects[bg.pos()] = *bg;
+    bg->InitializeParams();
+    bg->FreeObjectData();
   }
 }
 
@@ -777,9 +1063,10 @@ LazyArray<GraphicsObject>& GraphicsSystem::GetForegroundObjects() {
 // -----------------------------------------------------------------------
 
 bool GraphicsSystem::AnimationsPlaying() const {
-  for (GraphicsObject& object : graphics_object_impl_->foreground_objects) {
+  for (const GraphicsObject& object :
+       graphics_object_impl_->foreground_objects) {
     if (object.has_object_data()) {
-      GraphicsObjectData& data = object.GetObjectData();
+      const GraphicsObjectData& data = object.GetObjectData();
       if (data.IsAnimation() && data.is_currently_playing())
         return true;
     }
@@ -809,35 +1096,37 @@ void GraphicsSystem::ClearAllDCs() {
 // -----------------------------------------------------------------------
 
 void GraphicsSystem::RenderObjects(std::ostream* tree) {
-  to_render_.clear();
+  CollectObjectsToRender();
 
-  // Collate all objects that we might want to render.
-  AllocatedLazyArrayIterator<GraphicsObject> it =
-      graphics_object_impl_->foreground_objects.begin();
-  AllocatedLazyArrayIterator<GraphicsObject> end =
-      graphics_object_impl_->foreground_objects.end();
-  for (; it != end; ++it) {
-    const ObjectSettings& settings = GetObjectSettings(it.pos());
+  for (const RenderOrder::Entry& entry : render_order_)
+    entry.object->Render(entry.slot, NULL, tree);
+}
+
+// -----------------------------------------------------------------------
+
+void GraphicsSystem::CollectObjectsToRender() {
+  int filter = (should_show_object1() ? 1 : 0) |
+               (should_show_object2() ? 2 : 0) |
+               (should_show_weather() ? 4 : 0) |
+               (is_interface_hidden() ? 8 : 0);
+  if (filter != render_order_filter_) {
+    render_order_filter_ = filter;
+    render_order_.Invalidate();
+  }
+
+  render_order_.Update(graphics_object_impl_->foreground_objects,
+                       [this](int slot) {
+    const ObjectSettings& settings = GetObjectSettings(slot);
     if (settings.obj_on_off == 1 && should_show_object1() == false)
-      continue;
+      return false;
     else if (settings.obj_on_off == 2 && should_show_object2() == false)
-      continue;
+      return false;
     else if (settings.weather_on_off && should_show_weather() == false)
-      continue;
+      return false;
     else if (settings.space_key && is_interface_hidden())
-      continue;
-
-    to_render_.emplace_back(
-        it->z_order(), it->z_layer(), it->z_depth(), it.pos(), &*it);
-  }
-
-  // Sort by all the ordering values.
-  std::sort(to_render_.begin(), to_render_.end());
-
-  for (ToRenderVec::iterator it = to_render_.begin(); it != to_render_.end();
-       ++it) {
-    get<4>(*it)->Render(get<3>(*it), NULL, tree);
-  }
+      return false;
+    return true;
+  });
 }
 
 // -----------------------------------------------------------------------
@@ -878,6 +1167,7 @@ std::shared_ptr<MouseCursor> GraphicsSystem::GetCurrentCursor() {
 void GraphicsSystem::SetScreenSize(const Size& size) {
   screen_size_ = size;
   screen_rect_ = Rect(Point(0, 0), size);
+  screen_damage_.SetScreen(screen_rect_);
 }
 
 // -----------------------------------------------------------------------
@@ -33,6 +33,9 @@
 #include <boost/serialization/split_member.hpp>
 #include <boost/serialization/version.hpp>
 
+#include <cstddef>
+#include <cstdint>
+#include <future>
 #include <iosfwd>
 #include <map>
 #include <memory>
@@ -45,13 +48,21 @@
 #include "systems/base/cgm_table.h"
 #include "systems/base/event_listener.h"
 #include "systems/base/rect.h"
+#include "systems/base/render_order.h"
+#include "systems/base/screen_damage.h"
+#include "systems/base/script_lookahead.h"
 #include "systems/base/tone_curve.h"
 
 #include "utilities/lazy_array.h"
-#include "lru_cache.hpp"
+
+namespace libreallive {
+class Scenario;
+}  // namespace libreallive
 
 class ColourFilter;
 class Gameexe;
+class ImageDiskCache;
+class ImageLoader;
 class GraphicsObject;
 class GraphicsObjectData;
 class GraphicsStackFrame;
@@ -63,7 +74,9 @@ class RGBAColour;
 class RLMachine;
 class Size;
 class Surface;
+class SurfaceCache;
 class System;
+struct DecodedImage;
 struct ObjectSettings;
 
 template <typename T>
@@ -114,7 +127,10 @@ enum GraphicsUpdateType {
   GUT_DRAW_HIK,
   GUT_DISPLAY_OBJ,
   GUT_TEXTSYS,
-  GUT_MOUSE_MOTION
+  GUT_MOUSE_MOTION,
+  // Object parameters or data changed. Refresh() works out which objects by
+  // itself, so this doesn't damage the whole screen like GUT_DISPLAY_OBJ.
+  GUT_OBJECT_STATE
 };
 
 // Which type of mutually exclusive background should we display?
@@ -179,9 +195,7 @@ class GraphicsSystem : public EventListener {
   DCScreenUpdateMode screen_update_mode() const { return screen_update_mode_; }
   virtual void SetScreenUpdateMode(DCScreenUpdateMode u);
 
-  void set_graphics_background(GraphicsBackgroundType t) {
-    background_type_ = t;
-  }
+  void set_graphics_background(GraphicsBackgroundType t);
 
   System& system() { return system_; }
 
@@ -317,6 +331,17 @@ class GraphicsSystem : public EventListener {
   // various modes.
   virtual void MarkScreenAsDirty(GraphicsUpdateType type);
 
+  // Like MarkScreenAsDirty(GUT_DRAW_DC0), but only |area| of DC0 was drawn
+  // to, so the next Refresh() can leave the rest of the last frame alone.
+  void MarkScreenAreaAsDirty(const Rect& area);
+
+  // The parts of the screen that changed since the last Refresh().
+  const ScreenDamage& screen_damage() const { return screen_damage_; }
+
+  // Called by surfaces with every screen area they draw to, so Refresh() can
+  // find where objects and text ended up.
+  void RecordScreenDraw(const Rect& area);
+
   // Forces a refresh of the screen the next time the graphics system
   // executes.
   virtual void ForceRefresh();
@@ -334,7 +359,8 @@ class GraphicsSystem : public EventListener {
   virtual void EndFrame() = 0;
   virtual std::shared_ptr<Surface> EndFrameToSurface() = 0;
 
-  // Performs a full redraw of the screen.
+  // Redraws the screen. Unless |tree| is set, only the parts of the screen
+  // that have changed since the last Refresh() are drawn if possible.
   void Refresh(std::ostream* tree);
 
   // Draws the screen (as if refresh() was called), but draw to the returned
@@ -367,6 +393,21 @@ class GraphicsSystem : public EventListener {
   std::shared_ptr<const Surface> GetSurfaceNamed(
       const std::string& short_filename);
 
+  // Starts decoding an image on a background thread so that a later
+  // GetSurfaceNamed() only has to build the surface. Returns an invalid future
+  // if the image is already loaded, can't be found, or this system doesn't
+  // decode in the background.
+  std::shared_future<std::shared_ptr<const DecodedImage>> PrefetchSurfaceNamed(
+      const std::string& short_filename);
+
+  // The cache GetSurfaceNamed() and PreloadG00() share.
+  const SurfaceCache& image_cache() const { return *image_cache_; }
+
+  // Decoded images kept between runs, or null unless #IMAGE_DISK_CACHE is set.
+  const ImageDiskCache* image_disk_cache() const {
+    return image_disk_cache_.get();
+  }
+
   virtual std::shared_ptr<Surface> GetHaikei() = 0;
 
   virtual std::shared_ptr<Surface> GetDC(int dc) = 0;
@@ -470,11 +511,70 @@ class GraphicsSystem : public EventListener {
 
   void DrawFrame(std::ostream* tree);
 
+  // Refresh() draws only the damaged parts of the screen when
+  // CanRedrawDamageOnly() says the last frame it drew is still available: it
+  // calls RestoreLastFrame() after BeginFrame(), then draws each damaged
+  // rectangle between SetScreenClip() and ClearScreenClip(). SetScreenClip()
+  // should also clear |area| as BeginFrame() would. The defaults always draw
+  // the whole screen.
+  virtual bool CanRedrawDamageOnly() const;
+  virtual void RestoreLastFrame();
+  virtual void SetScreenClip(const Rect& area);
+  virtual void ClearScreenClip();
+
+  // Whether the frame between BeginFrame() and EndFrame() is being drawn by
+  // Refresh(), rather than by an effect or RenderToSurface().
+  bool is_refreshing() const { return is_refreshing_; }
+
+  // Whether the areas Refresh() redraws should be outlined on screen. Set
+  // with #SHOW_SCREEN_DAMAGE.
+  bool show_screen_damage() const { return show_screen_damage_; }
+
+  // Starts |thread_count| image decoding threads, after which images named in
+  // upcoming Grp, Bgr and object opcodes are decoded ahead of time. Subclasses
+  // that call this must implement BuildSurfaceFromImage().
+  void EnableBackgroundImageDecoding(int thread_count);
+
  private:
   // Gets a platform appropriate surface loaded.
   virtual std::shared_ptr<const Surface> LoadSurfaceFromFile(
       const std::string& short_filename) = 0;
 
+  // Builds a platform surface out of pixels decoded on a background thread.
+  // Always called on the main thread. The default returns null, which makes
+  // the caller fall back to LoadSurfaceFromFile().
+  virtual std::shared_ptr<const Surface> BuildSurfaceFromImage(
+      const std::string& short_filename,
+      const DecodedImage& image);
+
+  // Loads |short_filename|, finishing a background decode if one is pending.
+  std::shared_ptr<const Surface> LoadSurface(const std::string& short_filename);
+
+  // Prefetches the images named in the bytecode |machine| is about to run.
+  void PrefetchUpcomingImages(RLMachine& machine);
+
+  // Sets |screen_needs_refresh_| if the screen update mode says a change to
+  // the screen should show right away.
+  void RefreshForUpdateMode();
+
+  // Draws DC0 or the HIK background.
+  void DrawBackground(std::ostream* tree);
+
+  // Brings |render_order_| up to date with the foreground objects.
+  void CollectObjectsToRender();
+
+  // Compares |render_order_| against |rendered_objects_| to find the objects
+  // that changed, and damages where those and the text were last drawn.
+  void DamageChangedAreas();
+
+  // Draws every damaged rectangle. Returns false if the whole screen has to be
+  // drawn instead.
+  bool DrawDamagedAreas();
+
+  // Draws the frame, skipping unchanged objects outside |area| if it is set,
+  // and records where the changed objects and the text were drawn.
+  void DrawRefreshedFrame(const Rect* area, std::ostream* tree);
+
   // Default grp name (used in grp* and rec* functions where filename
   // is '???')
   std::string default_grp_name_;
@@ -492,6 +592,40 @@ class GraphicsSystem : public EventListener {
   // Flag set to redraw the screen NOW
   bool screen_needs_refresh_;
 
+  // The parts of the screen changed since the last Refresh().
+  ScreenDamage screen_damage_;
+
+  // Whether Refresh() may draw only |screen_damage_|. Cleared by
+  // #FULL_SCREEN_REDRAW.
+  bool redraw_damage_only_;
+
+  // Set with #SHOW_SCREEN_DAMAGE.
+  bool show_screen_damage_;
+
+  // Set between BeginFrame() and EndFrame() in Refresh().
+  bool is_refreshing_;
+
+  // What Refresh() last drew of each foreground object.
+  struct RenderedObject {
+    // Whether the object was drawn in the last frame, and what it looked like
+    // and where it went if so.
+    bool drawn = false;
+    uint64_t version = 0;
+    Rect bounds;
+
+    // Per frame: whether the object is being drawn, and whether it differs
+    // from the last frame.
+    bool in_frame = false;
+    bool changed = false;
+  };
+  std::vector<RenderedObject> rendered_objects_;
+
+  // Where the text system drew in the last frame.
+  Rect rendered_text_bounds_;
+
+  // Where RecordScreenDraw() collects draws, or null when nothing is listening.
+  Rect* draw_bounds_;
+
   // Whether object state has been mutated since the last screen refresh.
   bool object_state_dirty_;
 
@@ -573,22 +707,30 @@ class GraphicsSystem : public EventListener {
   typedef LazyArray<G00ArrayItem> G00ScriptList;
   G00ScriptList preloaded_g00_;
 
-  // LRU cache filled with the last fifteen accessed images.
+  // Recently loaded images, including the preloaded G00s above, bounded by
+  // bytes of pixel and texture memory.
   //
   // This cache's contents are assumed to be immutable.
-  LRUCache<std::string, std::shared_ptr<const Surface>> image_cache_;
+  std::unique_ptr<SurfaceCache> image_cache_;
+
+  // Decoded images from previous runs. Declared before |image_loader_|, whose
+  // threads use it.
+  std::unique_ptr<ImageDiskCache> image_disk_cache_;
+
+  // Decodes images in the background; null unless a subclass enabled it.
+  std::unique_ptr<ImageLoader> image_loader_;
+
+  // How far ahead PrefetchUpcomingImages() has looked for image names.
+  ScriptLookahead image_lookahead_{64};
 
   // Possible background script which drives graphics to the screen.
   std::unique_ptr<HIKRenderer> hik_renderer_;
 
-  // Tuple used in RenderObjects(). Causes about a half megabyte of allocator
-  // churn per minute if we try to allocate it every time.
-  //
-  // The tuple is order, layer, depth, objid, GraphicsObject. Tuples are easy
-  // to sort.
-  typedef std::vector<std::tuple<int, int, int, int, GraphicsObject*>>
-      ToRenderVec;
-  ToRenderVec to_render_;
+  // The foreground objects to draw, in drawing order. Kept between frames.
+  RenderOrder render_order_;
+
+  // The show/hide settings |render_order_| was last filtered with.
+  int render_order_filter_ = -1;
 
   // boost::serialization support
   friend class boost::serialization::access;
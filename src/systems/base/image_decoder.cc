@@ -0,0 +1,746 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#include "systems/base/image_decoder.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "utilities/cpu_dispatch.h"
+#include "xclannad/endian.hpp"
+#include "xclannad/file.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if RLVM_HAVE_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+#if RLVM_HAVE_NEON_KERNELS
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+// -----------------------------------------------------------------------
+// Pixel kernels
+// -----------------------------------------------------------------------
+
+struct ImageKernels {
+  // Expands eight packed 3-byte pixels to 4 bytes each, with |alpha| as the
+  // fourth byte. Reads exactly 24 bytes and writes exactly 32.
+  void (*expand8)(char* dst, const char* src, uint8_t alpha);
+
+  // ORs mask byte |i| into the alpha byte of pixel |i| and returns whether
+  // every resulting pixel is fully opaque.
+  bool (*apply_mask)(char* pixels, const char* mask, size_t count);
+
+  // Whether the alpha byte of every pixel is 0xff.
+  bool (*all_opaque)(const char* pixels, size_t count);
+
+  // Writes palette[indices[i]] to pixel |i|.
+  void (*lookup)(char* dst,
+                 const unsigned char* indices,
+                 size_t count,
+                 const uint32_t* palette);
+
+  const char* name;
+};
+
+void Expand8Scalar(char* dst, const char* src, uint8_t alpha) {
+  for (int i = 0; i < 8; ++i) {
+    dst[0] = src[0];
+    dst[1] = src[1];
+    dst[2] = src[2];
+    dst[3] = alpha;
+    dst += 4;
+    src += 3;
+  }
+}
+
+bool ApplyMaskScalar(char* pixels, const char* mask, size_t count) {
+  unsigned char opaque = 0xff;
+  for (size_t i = 0; i < count; ++i) {
+    pixels[i * 4 + 3] |= mask[i];
+    opaque &= pixels[i * 4 + 3];
+  }
+  return opaque == 0xff;
+}
+
+bool AllOpaqueScalar(const char* pixels, size_t count) {
+  unsigned char opaque = 0xff;
+  for (size_t i = 0; i < count; ++i)
+    opaque &= pixels[i * 4 + 3];
+  return opaque == 0xff;
+}
+
+void LookupScalar(char* dst,
+                  const unsigned char* indices,
+                  size_t count,
+                  const uint32_t* palette) {
+  for (size_t i = 0; i < count; ++i)
+    memcpy(dst + i * 4, &palette[indices[i]], 4);
+}
+
+#if defined(__SSE2__)
+// SSE2 has no byte shuffle, so expand8 stays scalar until SSSE3.
+bool ApplyMaskSSE2(char* pixels, const char* mask, size_t count) {
+  const __m128i zero = _mm_setzero_si128();
+  __m128i opaque = _mm_set1_epi32(-1);
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mask + i));
+    __m128i lo = _mm_unpacklo_epi8(zero, m);
+    __m128i hi = _mm_unpackhi_epi8(zero, m);
+    __m128i alpha[4] = {_mm_unpacklo_epi16(zero, lo),
+                        _mm_unpackhi_epi16(zero, lo),
+                        _mm_unpacklo_epi16(zero, hi),
+                        _mm_unpackhi_epi16(zero, hi)};
+    for (int j = 0; j < 4; ++j) {
+      __m128i* p = reinterpret_cast<__m128i*>(pixels + (i + j * 4) * 4);
+      __m128i px = _mm_or_si128(_mm_loadu_si128(p), alpha[j]);
+      _mm_storeu_si128(p, px);
+      opaque = _mm_and_si128(opaque, px);
+    }
+  }
+
+  const __m128i alpha_bits = _mm_set1_epi32(static_cast<int>(0xff000000));
+  bool all = _mm_movemask_epi8(_mm_cmpeq_epi32(
+                 _mm_and_si128(opaque, alpha_bits), alpha_bits)) == 0xffff;
+  return ApplyMaskScalar(pixels + i * 4, mask + i, count - i) && all;
+}
+
+bool AllOpaqueSSE2(const char* pixels, size_t count) {
+  __m128i opaque = _mm_set1_epi32(-1);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    opaque = _mm_and_si128(
+        opaque,
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + i * 4)));
+  }
+
+  const __m128i alpha_bits = _mm_set1_epi32(static_cast<int>(0xff000000));
+  bool all = _mm_movemask_epi8(_mm_cmpeq_epi32(
+                 _mm_and_si128(opaque, alpha_bits), alpha_bits)) == 0xffff;
+  return AllOpaqueScalar(pixels + i * 4, count - i) && all;
+}
+#endif
+
+#if RLVM_HAVE_X86_KERNELS
+__attribute__((target("ssse3"))) void Expand8SSSE3(char* dst,
+                                                  const char* src,
+                                                  uint8_t alpha) {
+  // Pixels 0-3 are bytes 0-11 of the first load, pixels 4-7 bytes 4-15 of
+  // the second, so neither load reads past the 24 source bytes.
+  const __m128i first = _mm_setr_epi8(
+      0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+  const __m128i second = _mm_setr_epi8(
+      4, 5, 6, -1, 7, 8, 9, -1, 10, 11, 12, -1, 13, 14, 15, -1);
+  const __m128i alpha_bits = _mm_set1_epi32(static_cast<int>(alpha) << 24);
+  __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+  __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 8));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(dst),
+                   _mm_or_si128(_mm_shuffle_epi8(a, first), alpha_bits));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 16),
+                   _mm_or_si128(_mm_shuffle_epi8(b, second), alpha_bits));
+}
+
+// GCC does not emit vzeroupper when leaving a target("avx2") function that
+// is reached through a pointer from SSE code, so every AVX2 kernel clears the
+// upper halves itself. Expand8 is called once per eight pixels, where even
+// that cost shows, so the AVX2 set reuses the SSSE3 shuffle.
+__attribute__((target("avx2"))) bool OpaqueAVX2(__m256i opaque) {
+  const __m256i alpha_bits = _mm256_set1_epi32(static_cast<int>(0xff000000));
+  return _mm256_movemask_epi8(_mm256_cmpeq_epi32(
+             _mm256_and_si256(opaque, alpha_bits), alpha_bits)) == -1;
+}
+
+__attribute__((target("avx2"))) bool ApplyMaskAVX2(char* pixels,
+                                                  const char* mask,
+                                                  size_t count) {
+  __m256i opaque = _mm256_set1_epi32(-1);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256i alpha = _mm256_slli_epi32(
+        _mm256_cvtepu8_epi32(
+            _mm_loadl_epi64(reinterpret_cast<const __m128i*>(mask + i))),
+        24);
+    __m256i* p = reinterpret_cast<__m256i*>(pixels + i * 4);
+    __m256i px = _mm256_or_si256(_mm256_loadu_si256(p), alpha);
+    _mm256_storeu_si256(p, px);
+    opaque = _mm256_and_si256(opaque, px);
+  }
+  bool result = OpaqueAVX2(opaque);
+  _mm256_zeroupper();
+  return ApplyMaskScalar(pixels + i * 4, mask + i, count - i) && result;
+}
+
+__attribute__((target("avx2"))) bool AllOpaqueAVX2(const char* pixels,
+                                                  size_t count) {
+  __m256i opaque = _mm256_set1_epi32(-1);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    opaque = _mm256_and_si256(
+        opaque,
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pixels + i * 4)));
+  }
+  bool result = OpaqueAVX2(opaque);
+  _mm256_zeroupper();
+  return AllOpaqueScalar(pixels + i * 4, count - i) && result;
+}
+
+__attribute__((target("avx2"))) void LookupAVX2(char* dst,
+                                               const unsigned char* indices,
+                                               size_t count,
+                                               const uint32_t* palette) {
+  const int* table = reinterpret_cast<const int*>(palette);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256i index = _mm256_cvtepu8_epi32(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i*>(indices + i)));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 4),
+                        _mm256_i32gather_epi32(table, index, 4));
+  }
+  _mm256_zeroupper();
+  LookupScalar(dst + i * 4, indices + i, count - i, palette);
+}
+#endif
+
+#if RLVM_HAVE_NEON_KERNELS
+void Expand8NEON(char* dst, const char* src, uint8_t alpha) {
+  uint8x8x3_t rgb = vld3_u8(reinterpret_cast<const uint8_t*>(src));
+  uint8x8x4_t rgba = {{rgb.val[0], rgb.val[1], rgb.val[2], vdup_n_u8(alpha)}};
+  vst4_u8(reinterpret_cast<uint8_t*>(dst), rgba);
+}
+
+bool ApplyMaskNEON(char* pixels, const char* mask, size_t count) {
+  uint8x16_t opaque = vdupq_n_u8(0xff);
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    uint8_t* p = reinterpret_cast<uint8_t*>(pixels + i * 4);
+    uint8x16x4_t px = vld4q_u8(p);
+    px.val[3] =
+        vorrq_u8(px.val[3], vld1q_u8(reinterpret_cast<const uint8_t*>(mask + i)));
+    vst4q_u8(p, px);
+    opaque = vandq_u8(opaque, px.val[3]);
+  }
+  return ApplyMaskScalar(pixels + i * 4, mask + i, count - i) &&
+         vminvq_u8(opaque) == 0xff;
+}
+
+bool AllOpaqueNEON(const char* pixels, size_t count) {
+  uint8x16_t opaque = vdupq_n_u8(0xff);
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    uint8x16x4_t px =
+        vld4q_u8(reinterpret_cast<const uint8_t*>(pixels + i * 4));
+    opaque = vandq_u8(opaque, px.val[3]);
+  }
+  return AllOpaqueScalar(pixels + i * 4, count - i) &&
+         vminvq_u8(opaque) == 0xff;
+}
+#endif
+
+ImageKernels SelectImageKernels() {
+#if RLVM_HAVE_X86_KERNELS
+  if (CpuHasAVX2())
+    return {Expand8SSSE3, ApplyMaskAVX2, AllOpaqueAVX2, LookupAVX2, "avx2"};
+#if defined(__SSE2__)
+  if (CpuHasSSSE3())
+    return {Expand8SSSE3, ApplyMaskSSE2, AllOpaqueSSE2, LookupScalar, "ssse3"};
+#endif
+#endif
+#if defined(__SSE2__)
+  return {Expand8Scalar, ApplyMaskSSE2, AllOpaqueSSE2, LookupScalar, "sse2"};
+#elif RLVM_HAVE_NEON_KERNELS
+  return {Expand8NEON, ApplyMaskNEON, AllOpaqueNEON, LookupScalar, "neon"};
+#else
+  return {Expand8Scalar, ApplyMaskScalar, AllOpaqueScalar, LookupScalar,
+          "scalar"};
+#endif
+}
+
+const ImageKernels& CurrentKernels() {
+  static const KernelDispatch<ImageKernels> kernels(
+      SelectImageKernels,
+      {Expand8Scalar, ApplyMaskScalar, AllOpaqueScalar, LookupScalar,
+       "scalar"});
+  return kernels.get();
+}
+
+// -----------------------------------------------------------------------
+// LZ77
+// -----------------------------------------------------------------------
+
+// Copies a back reference |distance| bytes behind |dst|. A reference that
+// overlaps its own output repeats the last |distance| bytes, so it is copied
+// one period at a time.
+inline void CopyMatch(char* dst, size_t distance, size_t count) {
+  if (distance >= count) {
+    memcpy(dst, dst - distance, count);
+  } else if (distance == 1) {
+    memset(dst, dst[-1], count);
+  } else {
+    while (count) {
+      size_t n = std::min(distance, count);
+      memcpy(dst, dst - distance, n);
+      dst += n;
+      count -= n;
+    }
+  }
+}
+
+// Like CopyMatch(), but may write up to 15 bytes past |count|, which the
+// caller must have room for and will overwrite. Lets the common short
+// references compile down to a few fixed size moves.
+inline void CopyMatchFast(char* dst, size_t distance, size_t count) {
+  const char* repeat = dst - distance;
+  if (distance >= 16) {
+    for (size_t i = 0; i < count; i += 16)
+      memcpy(dst + i, repeat + i, 16);
+  } else if (distance >= 8) {
+    for (size_t i = 0; i < count; i += 8)
+      memcpy(dst + i, repeat + i, 8);
+  } else if (distance == 4) {
+    // One 32-bit pixel over and over.
+    char pattern[16];
+    for (int i = 0; i < 16; i += 4)
+      memcpy(pattern + i, repeat, 4);
+    for (size_t i = 0; i < count; i += 16)
+      memcpy(dst + i, pattern, 16);
+  } else {
+    for (size_t i = 0; i < count; ++i)
+      dst[i] = repeat[i];
+  }
+}
+
+// Every xclannad image format is LZ77 with a flag byte in front of each group
+// of eight tokens: a set bit is a literal, a clear bit a back reference. The
+// formats differ in bit order, literal size and how references are packed,
+// which the Format classes below describe. Distances and counts are in
+// output bytes.
+//
+// Stops at the end of either buffer, clipping the last reference to |dst_end|,
+// or at a reference to before |dst_begin|. Returns where output stopped.
+template <class Format>
+char* ExtractLZ(const Format& format,
+                const char* src,
+                const char* src_end,
+                char* dst_begin,
+                char* dst_end) {
+  char* dst = dst_begin;
+
+  // Groups that can't reach the end of either buffer skip the per-token
+  // checks, the way GRPCONV's decoder does.
+  const std::ptrdiff_t kGroupIn =
+      1 + 8 * std::max(Format::kLiteralIn, Format::kReferenceIn);
+  const std::ptrdiff_t kGroupOut =
+      8 * std::max(Format::kLiteralOut, Format::kMaxCount) + 16;
+  while (src_end - src >= kGroupIn && dst_end - dst >= kGroupOut) {
+    unsigned int flags = static_cast<unsigned char>(*src++);
+    if (flags == 0xff) {
+      format.Literals8(src, dst);
+      src += 8 * Format::kLiteralIn;
+      dst += 8 * Format::kLiteralOut;
+      continue;
+    }
+
+    for (int i = 0; i < 8; ++i) {
+      bool literal = Format::kLsbFirst ? (flags >> i) & 1 : (flags << i) & 0x80;
+      if (literal) {
+        format.Literal(src, dst);
+        src += Format::kLiteralIn;
+        dst += Format::kLiteralOut;
+      } else {
+        size_t distance, count;
+        format.Reference(src, &distance, &count);
+        src += Format::kReferenceIn;
+        if (distance == 0 || distance > static_cast<size_t>(dst - dst_begin))
+          return dst;
+        CopyMatchFast(dst, distance, count);
+        dst += count;
+      }
+    }
+  }
+
+  while (dst < dst_end && src < src_end) {
+    unsigned int flags = static_cast<unsigned char>(*src++);
+
+    if (flags == 0xff && src_end - src >= 8 * Format::kLiteralIn &&
+        dst_end - dst >= 8 * Format::kLiteralOut) {
+      format.Literals8(src, dst);
+      src += 8 * Format::kLiteralIn;
+      dst += 8 * Format::kLiteralOut;
+      continue;
+    }
+
+    for (int i = 0; i < 8 && dst < dst_end; ++i) {
+      bool literal = Format::kLsbFirst ? (flags >> i) & 1 : (flags << i) & 0x80;
+      if (literal) {
+        if (src_end - src < Format::kLiteralIn)
+          return dst;
+        format.Literal(src, dst);
+        src += Format::kLiteralIn;
+        dst += Format::kLiteralOut;
+      } else {
+        if (src_end - src < Format::kReferenceIn)
+          return dst;
+        size_t distance, count;
+        format.Reference(src, &distance, &count);
+        src += Format::kReferenceIn;
+        if (distance == 0 || distance > static_cast<size_t>(dst - dst_begin))
+          return dst;
+        count = std::min(count, static_cast<size_t>(dst_end - dst));
+        CopyMatch(dst, distance, count);
+        dst += count;
+      }
+    }
+  }
+  return dst;
+}
+
+// 3-byte literals expanded to 32-bit pixels, with 16-bit references of a
+// 12-bit distance and 4-bit count in pixels. G00 type 0 stores the flags
+// least significant bit first, counts distances from zero and makes every
+// pixel opaque; PDT10 is the other way round and leaves alpha at zero.
+template <bool kG00>
+class PixelFormat {
+ public:
+  static const bool kLsbFirst = kG00;
+  static const int kLiteralIn = 3;
+  static const int kLiteralOut = 4;
+  static const int kReferenceIn = 2;
+  static const int kMaxCount = 16 * 4;
+  static const uint8_t kAlpha = kG00 ? 0xff : 0;
+
+  explicit PixelFormat(const ImageKernels& kernels) : kernels_(kernels) {}
+
+  void Literal(const char* src, char* dst) const {
+    dst[0] = src[0];
+    dst[1] = src[1];
+    dst[2] = src[2];
+    dst[3] = kAlpha;
+  }
+  void Literals8(const char* src, char* dst) const {
+    kernels_.expand8(dst, src, kAlpha);
+  }
+  void Reference(const char* src, size_t* distance, size_t* count) const {
+    int d = read_little_endian_short(src);
+    *distance = ((d >> 4) + (kG00 ? 0 : 1)) * 4;
+    *count = ((d & 0x0f) + 1) * 4;
+  }
+
+ private:
+  const ImageKernels& kernels_;
+};
+
+// Byte literals; the formats only differ in how references are packed.
+class ByteFormat {
+ public:
+  static const int kLiteralIn = 1;
+  static const int kLiteralOut = 1;
+
+  void Literal(const char* src, char* dst) const { *dst = *src; }
+  void Literals8(const char* src, char* dst) const { memcpy(dst, src, 8); }
+};
+
+// G00 types 1 and 2.
+class Scn2kFormat : public ByteFormat {
+ public:
+  static const bool kLsbFirst = true;
+  static const int kReferenceIn = 2;
+  static const int kMaxCount = 17;
+
+  void Reference(const char* src, size_t* distance, size_t* count) const {
+    int d = read_little_endian_short(src);
+    *distance = d >> 4;
+    *count = (d & 0x0f) + 2;
+  }
+};
+
+// The alpha mask of a PDT.
+class MaskFormat : public ByteFormat {
+ public:
+  static const bool kLsbFirst = false;
+  static const int kReferenceIn = 2;
+  static const int kMaxCount = 257;
+
+  void Reference(const char* src, size_t* distance, size_t* count) const {
+    int d = read_little_endian_short(src);
+    *distance = (d >> 8) + 1;
+    *count = (d & 0xff) + 2;
+  }
+};
+
+// PDT11 palette indices, looked up as they are decompressed. References pick
+// one of sixteen distances from a table in the file header and, since equal
+// indices give equal pixels, are copied as whole pixels.
+class Pdt11Format {
+ public:
+  static const bool kLsbFirst = false;
+  static const int kLiteralIn = 1;
+  static const int kLiteralOut = 4;
+  static const int kReferenceIn = 1;
+  static const int kMaxCount = 17 * 4;
+
+  Pdt11Format(const ImageKernels& kernels,
+              const int* distances,
+              const uint32_t* palette)
+      : kernels_(kernels), distances_(distances), palette_(palette) {}
+
+  void Literal(const char* src, char* dst) const {
+    memcpy(dst, &palette_[static_cast<unsigned char>(*src)], 4);
+  }
+  void Literals8(const char* src, char* dst) const {
+    kernels_.lookup(dst, reinterpret_cast<const unsigned char*>(src), 8,
+                    palette_);
+  }
+  void Reference(const char* src, size_t* distance, size_t* count) const {
+    unsigned char d = *src;
+    *distance = static_cast<size_t>(std::max(distances_[d & 0x0f], 0)) * 4;
+    *count = ((d >> 4) + 2) * 4;
+  }
+
+ private:
+  const ImageKernels& kernels_;
+  const int* distances_;
+  const uint32_t* palette_;
+};
+
+// -----------------------------------------------------------------------
+// Formats
+// -----------------------------------------------------------------------
+
+// Zeroes whatever a truncated stream didn't reach.
+void ZeroRest(char* written_end, char* end) {
+  if (written_end < end)
+    memset(written_end, 0, end - written_end);
+}
+
+// Decodes an intermediate LZ stage into a new |size| byte buffer, zeroing
+// whatever a short stream doesn't reach.
+template <class Format>
+std::unique_ptr<char[]> ExtractToBuffer(const Format& format,
+                                        const char* src,
+                                        const char* src_end,
+                                        size_t size) {
+  std::unique_ptr<char[]> buffer(new char[size]);
+  ZeroRest(ExtractLZ(format, src, src_end, buffer.get(), buffer.get() + size),
+           buffer.get() + size);
+  return buffer;
+}
+
+void DecodeG00Type0(const ImageKernels& kernels,
+                    const GRPCONV& conv,
+                    char* image,
+                    size_t pixels) {
+  char* end = image + pixels * 4;
+  char* written = ExtractLZ(PixelFormat<true>(kernels),
+                            conv.data + 13,
+                            conv.data + conv.datalen,
+                            image,
+                            end);
+  ZeroRest(written, end);
+}
+
+void DecodeG00Type1(const ImageKernels& kernels,
+                    const GRPCONV& conv,
+                    char* image,
+                    size_t pixels) {
+  size_t size = static_cast<size_t>(read_little_endian_int(conv.data + 9)) + 1;
+  std::unique_ptr<char[]> buffer = ExtractToBuffer(
+      Scn2kFormat(), conv.data + 13, conv.data + conv.datalen, size);
+
+  uint32_t palette[256] = {0};
+  size_t entries = size >= 2 ? read_little_endian_short(buffer.get()) : 0;
+  size_t table_end = 2 + entries * 4;
+  // Only the entries that fit in both |palette| and the decompressed data.
+  const size_t in_buffer = size >= 2 ? (size - 2) / 4 : 0;
+  const size_t limit = std::min({entries, size_t(256), in_buffer});
+  for (size_t i = 0; i < limit; ++i)
+    palette[i] = read_little_endian_int(buffer.get() + 2 + i * 4);
+
+  size_t count =
+      table_end < size ? std::min(pixels, size - table_end) : 0;
+  kernels.lookup(image,
+                 reinterpret_cast<const unsigned char*>(buffer.get()) +
+                     table_end,
+                 count,
+                 palette);
+  ZeroRest(image + count * 4, image + pixels * 4);
+}
+
+bool DecodeG00Type2(const ImageKernels& kernels,
+                    const GRPCONV& conv,
+                    char* image,
+                    size_t pixels) {
+  memset(image, 0, pixels * 4);
+
+  const char* data_end = conv.data + conv.datalen;
+  int regions = read_little_endian_int(conv.data + 5);
+  if (regions < 0 || regions > (conv.datalen - 9) / 24 ||
+      conv.data + 9 + regions * 24 + 8 > data_end)
+    return true;
+  const char* head = conv.data + 9 + regions * 24;
+  size_t size = static_cast<size_t>(read_little_endian_int(head + 4));
+  std::unique_ptr<char[]> buffer =
+      ExtractToBuffer(Scn2kFormat(), head + 8, data_end, size);
+  const char* buf = buffer.get();
+
+  if (size >= 4)
+    regions = std::min(regions, read_little_endian_int(buf));
+  regions = std::min(regions, static_cast<int>(conv.region_table.size()));
+
+  for (int i = 0; i < regions && static_cast<size_t>(i) * 8 + 12 <= size;
+       ++i) {
+    const int offset = read_little_endian_int(buf + i * 8 + 4);
+    const int length = read_little_endian_int(buf + i * 8 + 8);
+    if (offset < 0 || length < 0x74 || static_cast<size_t>(offset) > size ||
+        static_cast<size_t>(length) > size - offset)
+      continue;
+
+    const char* src = buf + offset + 0x74;
+    const char* src_end = buf + offset + length;
+    while (src + 0x5c <= src_end) {
+      int x = read_little_endian_short(src) + conv.region_table[i].x1;
+      int y = read_little_endian_short(src + 2) + conv.region_table[i].y1;
+      int w = read_little_endian_short(src + 6);
+      int h = read_little_endian_short(src + 8);
+      src += 0x5c;
+      if (static_cast<size_t>(src_end - src) < static_cast<size_t>(w) * h * 4)
+        break;
+
+      // Clip to the image; well formed files never need it.
+      int left = std::max(x, 0);
+      int top = std::max(y, 0);
+      int right = std::min(x + w, conv.width);
+      int bottom = std::min(y + h, conv.height);
+      for (int row = top; row < bottom && left < right; ++row) {
+        memcpy(image + (static_cast<size_t>(row) * conv.width + left) * 4,
+               src + (static_cast<size_t>(row - y) * w + (left - x)) * 4,
+               (right - left) * 4);
+      }
+      src += static_cast<size_t>(w) * h * 4;
+    }
+  }
+
+  return !kernels.all_opaque(image, pixels);
+}
+
+void DecodePDT10(const ImageKernels& kernels,
+                 const GRPCONV& conv,
+                 const char* src_end,
+                 char* image,
+                 size_t pixels) {
+  char* end = image + pixels * 4;
+  char* written = ExtractLZ(
+      PixelFormat<false>(kernels), conv.data + 0x20, src_end, image, end);
+  ZeroRest(written, end);
+}
+
+void DecodePDT11(const ImageKernels& kernels,
+                 const GRPCONV& conv,
+                 const char* src_end,
+                 char* image,
+                 size_t pixels) {
+  int distances[16];
+  for (int i = 0; i < 16; ++i)
+    distances[i] = read_little_endian_int(conv.data + 0x420 + i * 4);
+  uint32_t palette[256];
+  for (int i = 0; i < 256; ++i)
+    palette[i] = read_little_endian_int(conv.data + 0x20 + i * 4);
+
+  char* end = image + pixels * 4;
+  char* written = ExtractLZ(Pdt11Format(kernels, distances, palette),
+                            conv.data + 0x460, src_end, image, end);
+  ZeroRest(written, end);
+}
+
+bool DecodePDT(const ImageKernels& kernels,
+               const GRPCONV& conv,
+               char* image,
+               size_t pixels) {
+  size_t mask_pt = read_little_endian_int(conv.data + 0x1c);
+  const char* data_end = conv.data + conv.datalen;
+  const char* src_end =
+      mask_pt && mask_pt < static_cast<size_t>(conv.datalen)
+          ? conv.data + mask_pt
+          : data_end;
+
+  if (strncmp(conv.data, "PDT10", 5) == 0)
+    DecodePDT10(kernels, conv, src_end, image, pixels);
+  else
+    DecodePDT11(kernels, conv, src_end, image, pixels);
+
+  if (!conv.is_mask)
+    return false;
+
+  const char* mask_start =
+      mask_pt < static_cast<size_t>(conv.datalen) ? conv.data + mask_pt
+                                                   : data_end;
+  std::unique_ptr<char[]> mask =
+      ExtractToBuffer(MaskFormat(), mask_start, data_end, pixels);
+  return !kernels.apply_mask(image, mask.get(), pixels);
+}
+
+}  // namespace
+
+// -----------------------------------------------------------------------
+
+bool DecodeGrpImage(const GRPCONV& conv, char* image, bool* has_alpha) {
+  if (!conv.data || conv.width <= 0 || conv.height <= 0)
+    return false;
+
+  const ImageKernels& kernels = CurrentKernels();
+  const size_t pixels = static_cast<size_t>(conv.width) * conv.height;
+  bool alpha = false;
+  if (strncmp(conv.data, "PDT10", 5) == 0 ||
+      strncmp(conv.data, "PDT11", 5) == 0) {
+    if (conv.datalen < 0x460 && conv.data[4] == '1')
+      return false;
+    alpha = DecodePDT(kernels, conv, image, pixels);
+  } else if (conv.data[0] == 0 && conv.datalen >= 13) {
+    DecodeG00Type0(kernels, conv, image, pixels);
+  } else if (conv.data[0] == 1 && conv.datalen >= 13) {
+    DecodeG00Type1(kernels, conv, image, pixels);
+  } else if (conv.data[0] == 2 && conv.datalen >= 9) {
+    alpha = DecodeG00Type2(kernels, conv, image, pixels);
+  } else {
+    return false;
+  }
+
+  *has_alpha = conv.is_mask && alpha;
+  return true;
+}
+
+const char* ImageKernelName() { return CurrentKernels().name; }
@@ -0,0 +1,55 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#ifndef SRC_SYSTEMS_BASE_IMAGE_DECODER_H_
+#define SRC_SYSTEMS_BASE_IMAGE_DECODER_H_
+
+class GRPCONV;
+
+// Decodes the pixels of a G00 or PDT file that |conv| has parsed the header
+// of. Writes width * height 32-bit pixels to |image| in the layout
+// GRPCONV::Read() produces, and for well formed files the same bytes. Unlike
+// GRPCONV::Read(), it never writes past the end of the image, and output that
+// a damaged file doesn't cover is zeroed instead of left uninitialized.
+//
+// G00 type 0, PDT10 and PDT11 are converted to 32-bit pixels as they are
+// decompressed, and a PDT mask is checked for transparency as it is applied.
+// G00 type 1 still decompresses to a temporary buffer first, since its
+// palette is part of the compressed stream, and G00 type 2 scans the finished
+// image for transparency, since its blocks may overlap or leave holes.
+// |*has_alpha| is set when the image has a mask and any pixel in it is less
+// than fully opaque.
+//
+// Returns false, without touching |image|, for the formats it doesn't handle
+// (BMP); the caller should fall back to GRPCONV::Read().
+bool DecodeGrpImage(const GRPCONV& conv, char* image, bool* has_alpha);
+
+// Name of the pixel kernels DecodeGrpImage() uses on this CPU: "avx2",
+// "ssse3", "sse2", "neon" or "scalar".
+const char* ImageKernelName();
+
+#endif  // SRC_SYSTEMS_BASE_IMAGE_DECODER_H_
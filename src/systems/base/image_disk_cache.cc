@@ -0,0 +1,211 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#include "systems/base/image_disk_cache.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "libreallive/alldefs.h"
+#include "libreallive/filemap.h"
+#include "systems/base/image_loader.h"
+#include "utilities/hash.h"
+
+namespace fs = boost::filesystem;
+
+using libreallive::append_i32;
+using libreallive::read_i32;
+
+namespace {
+
+const char kMagic[8] = {'R', 'L', 'V', 'M', 'I', 'M', 'G', '\0'};
+const size_t kHeaderSize = 52;
+const size_t kRegionSize = 24;
+
+// The only layout written so far: 32-bit pixels that read as 0xAARRGGBB,
+// which SDLSurface uploads as GL_BGRA / GL_UNSIGNED_INT_8_8_8_8_REV.
+const uint32_t kPixelFormatBGRA = 0x41524742;  // "BGRA"
+
+const uint32_t kFlagHasAlpha = 1;
+const uint32_t kFlagHasPixels = 2;
+
+size_t Align16(size_t n) { return (n + 15) & ~size_t(15); }
+
+uint32_t ReadU32(const char* src) { return static_cast<uint32_t>(read_i32(src)); }
+
+uint64_t ReadU64(const char* src) {
+  return ReadU32(src) | (uint64_t(ReadU32(src + 4)) << 32);
+}
+
+void AppendU64(std::string& out, uint64_t value) {
+  append_i32(out, static_cast<uint32_t>(value));
+  append_i32(out, static_cast<uint32_t>(value >> 32));
+}
+
+int64_t ModificationTime(const fs::path& path) {
+  boost::system::error_code ec;
+  std::time_t mtime = fs::last_write_time(path, ec);
+  return ec ? -1 : static_cast<int64_t>(mtime);
+}
+
+}  // namespace
+
+// -----------------------------------------------------------------------
+// ImageDiskCache
+// -----------------------------------------------------------------------
+
+ImageDiskCache::ImageDiskCache(const fs::path& directory)
+    : directory_(directory) {
+  boost::system::error_code ec;
+  fs::create_directories(directory_, ec);
+}
+
+ImageDiskCache::~ImageDiskCache() {}
+
+std::shared_ptr<const DecodedImage> ImageDiskCache::Find(
+    const fs::path& path,
+    std::string_view source) const {
+  fs::path entry = EntryPath(path);
+  boost::system::error_code ec;
+  if (!fs::exists(entry, ec) || fs::file_size(entry, ec) < kHeaderSize)
+    return nullptr;
+
+  std::shared_ptr<libreallive::MappedFile> file;
+  try {
+    file = std::make_shared<libreallive::MappedFile>(entry);
+  } catch (libreallive::Error& e) {
+    return nullptr;
+  }
+
+  // Cheapest checks first; the content hash is only worth computing once
+  // everything else agrees.
+  const char* data = file->get();
+  if (memcmp(data, kMagic, sizeof(kMagic)) != 0 ||
+      ReadU32(data + 8) != kVersion ||
+      ReadU32(data + 12) != kPixelFormatBGRA ||
+      ReadU32(data + 28) != source.size() ||
+      static_cast<int64_t>(ReadU64(data + 32)) != ModificationTime(path) ||
+      ReadU64(data + 40) != HashBytes(source)) {
+    return nullptr;
+  }
+
+  const uint64_t width = ReadU32(data + 16);
+  const uint64_t height = ReadU32(data + 20);
+  const uint32_t flags = ReadU32(data + 24);
+  const uint64_t region_count = ReadU32(data + 48);
+  const uint64_t pixels_pos =
+      Align16(kHeaderSize + region_count * kRegionSize);
+  const uint64_t pixels_size =
+      (flags & kFlagHasPixels) ? width * height * 4 : 0;
+  if (width > 0xffff || height > 0xffff || region_count > 0xffff ||
+      pixels_pos + pixels_size > file->size()) {
+    return nullptr;
+  }
+
+  std::shared_ptr<DecodedImage> image = std::make_shared<DecodedImage>();
+  image->size = Size(width, height);
+  image->has_alpha = flags & kFlagHasAlpha;
+  if (flags & kFlagHasPixels)
+    image->mapped_pixels = data + pixels_pos;
+  image->mapping = file;
+
+  const char* region = data + kHeaderSize;
+  for (uint64_t i = 0; i < region_count; ++i, region += kRegionSize) {
+    Surface::GrpRect rect;
+    rect.rect = Rect(Point(read_i32(region), read_i32(region + 4)),
+                     Point(read_i32(region + 8), read_i32(region + 12)));
+    rect.originX = read_i32(region + 16);
+    rect.originY = read_i32(region + 20);
+    image->region_table.push_back(rect);
+  }
+
+  return image;
+}
+
+bool ImageDiskCache::Store(const fs::path& path,
+                           std::string_view source,
+                           const DecodedImage& image) const {
+  const char* pixels = image.data();
+  std::string header(kMagic, sizeof(kMagic));
+  append_i32(header, kVersion);
+  append_i32(header, kPixelFormatBGRA);
+  append_i32(header, image.size.width());
+  append_i32(header, image.size.height());
+  append_i32(header, (image.has_alpha ? kFlagHasAlpha : 0) |
+                         (pixels ? kFlagHasPixels : 0));
+  append_i32(header, source.size());
+  AppendU64(header, ModificationTime(path));
+  AppendU64(header, HashBytes(source));
+  append_i32(header, image.region_table.size());
+  for (const Surface::GrpRect& rect : image.region_table) {
+    append_i32(header, rect.rect.x());
+    append_i32(header, rect.rect.y());
+    append_i32(header, rect.rect.x2());
+    append_i32(header, rect.rect.y2());
+    append_i32(header, rect.originX);
+    append_i32(header, rect.originY);
+  }
+  header.resize(Align16(header.size()), '\0');
+
+  // Decodes of the same file on two threads each get their own temporary
+  // file; whichever rename lands last wins, and both are complete.
+  boost::system::error_code ec;
+  fs::path tmp_path = directory_ / fs::unique_path("%%%%-%%%%-%%%%.tmp", ec);
+  if (ec)
+    return false;
+  {
+    fs::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!file)
+      return false;
+    file.write(header.data(), header.size());
+    if (pixels)
+      file.write(pixels, image.size.width() * image.size.height() * 4);
+    if (!file) {
+      file.close();
+      fs::remove(tmp_path, ec);
+      return false;
+    }
+  }
+
+  fs::rename(tmp_path, EntryPath(path), ec);
+  if (ec) {
+    fs::remove(tmp_path, ec);
+    return false;
+  }
+  return true;
+}
+
+fs::path ImageDiskCache::EntryPath(const fs::path& path) const {
+  char name[24];
+  snprintf(name, sizeof(name), "%016llx.img",
+           static_cast<unsigned long long>(HashBytes(path.string())));
+  return directory_ / name;
+}
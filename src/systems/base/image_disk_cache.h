@@ -0,0 +1,90 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#ifndef SRC_SYSTEMS_BASE_IMAGE_DISK_CACHE_H_
+#define SRC_SYSTEMS_BASE_IMAGE_DISK_CACHE_H_
+
+#include <boost/filesystem/path.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+struct DecodedImage;
+
+// A directory of already decoded G00 and PDT files, so that warm starts skip
+// decompression entirely. Entries hold the pixels in the byte order textures
+// are uploaded in (BGRA, which is also what the decoders produce), so a hit is
+// a memory mapping handed straight to the surface code.
+//
+// Entries are named after a hash of the source file's path and record the
+// source's size, modification time and a hash of its contents. An entry that
+// disagrees on any of them is ignored and overwritten by the next Store().
+//
+// File layout (all integers little endian):
+//
+//   "RLVMIMG\0" | u32 version | u32 pixel_format | u32 width | u32 height
+//   u32 flags | u32 region_count | u32 source_size | u32 source_mtime_lo
+//   u32 source_mtime_hi | u32 source_hash_lo | u32 source_hash_hi
+//   region_count * { i32 x1, i32 y1, i32 x2, i32 y2, i32 origin_x,
+//                    i32 origin_y }
+//   padding to 16 bytes | width * height * u32 pixels
+//
+// Safe to use from several threads at once; entries are written to a
+// temporary file and renamed into place.
+class ImageDiskCache {
+ public:
+  // Bumped whenever the file layout or the meaning of any field changes.
+  static const uint32_t kVersion = 1;
+
+  // Stores entries in |directory|, which is created if it doesn't exist.
+  explicit ImageDiskCache(const boost::filesystem::path& directory);
+  ~ImageDiskCache();
+
+  // Returns the cached decode of the file at |path|, whose contents are
+  // |source|, or null if there is no entry or it was written for a different
+  // version of the file. The returned image's pixels point into the mapped
+  // entry.
+  std::shared_ptr<const DecodedImage> Find(const boost::filesystem::path& path,
+                                           std::string_view source) const;
+
+  // Writes |image|, decoded from |source| at |path|, replacing any existing
+  // entry. Returns false if the entry couldn't be written.
+  bool Store(const boost::filesystem::path& path,
+             std::string_view source,
+             const DecodedImage& image) const;
+
+  // Where the entry for |path| lives.
+  boost::filesystem::path EntryPath(const boost::filesystem::path& path) const;
+
+  const boost::filesystem::path& directory() const { return directory_; }
+
+ private:
+  boost::filesystem::path directory_;
+};
+
+#endif  // SRC_SYSTEMS_BASE_IMAGE_DISK_CACHE_H_
@@ -0,0 +1,275 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#include "systems/base/image_loader.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "libreallive/elements/command.h"
+#include "libreallive/expression.h"
+#include "systems/base/image_decoder.h"
+#include "systems/base/image_disk_cache.h"
+#include "systems/base/system_error.h"
+#include "utilities/exception.h"
+#include "xclannad/file.h"
+
+namespace {
+
+// Prefetched images nobody asked for are dropped past this many.
+const size_t kMaxPendingImages = 24;
+
+// Whether |f| belongs to a module whose string arguments are image files:
+// Grp (1:33), Bgr (1:40) and the (child) object creation modules (1:71, 1:72,
+// 2:71, 2:72).
+bool IsImageLoadingCommand(const libreallive::CommandElement& f) {
+  switch (f.modtype()) {
+    case 1:
+      return f.module() == 33 || f.module() == 40 || f.module() == 71 ||
+             f.module() == 72;
+    case 2:
+      return f.module() == 71 || f.module() == 72;
+    default:
+      return false;
+  }
+}
+
+void AddStringConstants(RLMachine& machine,
+                        const libreallive::IExpression& expression,
+                        std::vector<std::string>& names) {
+  if (expression.IsComplexParameter() || expression.IsSpecialParameter()) {
+    for (auto const& piece : expression.GetContainedPieces())
+      AddStringConstants(machine, *piece, names);
+  } else if (!expression.IsMemoryReference() &&
+             expression.GetExpressionValueType() ==
+                 libreallive::ExpressionValueType::String) {
+    std::string name = expression.GetStringValue(machine);
+    if (!name.empty() && name != "???" &&
+        std::find(names.begin(), names.end(), name) == names.end())
+      names.push_back(name);
+  }
+}
+
+}  // namespace
+
+// -----------------------------------------------------------------------
+
+std::shared_ptr<const DecodedImage> DecodeImageFile(
+    const boost::filesystem::path& path,
+    const ImageDiskCache* disk_cache) {
+  FILE* file = fopen(path.string().c_str(), "rb");
+  if (!file) {
+    std::ostringstream oss;
+    oss << "Could not open file: " << path;
+    throw rlvm::Exception(oss.str());
+  }
+
+  fseek(file, 0, SEEK_END);
+  size_t size = ftell(file);
+  std::unique_ptr<char[]> d(new char[size + 1]);
+  fseek(file, 0, SEEK_SET);
+  fread(d.get(), size, 1, file);
+  fclose(file);
+
+  std::string_view source(d.get(), size);
+  if (disk_cache) {
+    std::shared_ptr<const DecodedImage> cached = disk_cache->Find(path, source);
+    if (cached)
+      return cached;
+  }
+
+  std::unique_ptr<GRPCONV> conv(
+      GRPCONV::AssignConverter(d.get(), size, "???"));
+  if (conv == 0)
+    throw SystemError("Failure in GRPCONV.");
+
+  std::shared_ptr<DecodedImage> image = std::make_shared<DecodedImage>();
+  image->size = Size(conv->Width(), conv->Height());
+
+  // The xclannad decoders write a little past the end of the image.
+  image->pixels.reset(new char[conv->Width() * conv->Height() * 4 + 1024]);
+  if (!DecodeGrpImage(*conv, image->pixels.get(), &image->has_alpha)) {
+    if (!conv->Read(image->pixels.get()))
+      image->pixels.reset();
+
+    if (image->pixels && conv->IsMask()) {
+      const unsigned int* pixel =
+          reinterpret_cast<const unsigned int*>(image->pixels.get());
+      const unsigned int* end = pixel + conv->Width() * conv->Height();
+      image->has_alpha = std::any_of(pixel, end, [](unsigned int p) {
+        return (p & 0xff000000) != 0xff000000;
+      });
+    }
+  }
+
+  // Grab the Type-2 information out of the converter or create one default
+  // region if none exist.
+  for (const GRPCONV::REGION& region : conv->region_table) {
+    Surface::GrpRect rect;
+    rect.rect =
+        Rect(Point(region.x1, region.y1), Point(region.x2 + 1, region.y2 + 1));
+    rect.originX = region.origin_x;
+    rect.originY = region.origin_y;
+    image->region_table.push_back(rect);
+  }
+  if (image->region_table.empty()) {
+    Surface::GrpRect rect;
+    rect.rect = Rect(Point(0, 0), image->size);
+    rect.originX = 0;
+    rect.originY = 0;
+    image->region_table.push_back(rect);
+  }
+
+  if (disk_cache)
+    disk_cache->Store(path, source, *image);
+
+  return image;
+}
+
+std::vector<std::string> FindImageNames(RLMachine& machine,
+                                        const libreallive::CommandElement& f) {
+  std::vector<std::string> names;
+  if (!IsImageLoadingCommand(f))
+    return names;
+
+  for (size_t i = 0; i < f.GetParamCount(); ++i) {
+    std::string param = f.GetParam(i);
+    const char* src = param.c_str();
+    try {
+      libreallive::Expression expression = libreallive::GetData(src);
+      AddStringConstants(machine, *expression, names);
+    } catch (libreallive::Error& e) {
+      // Not something we can read ahead of time; the opcode will complain
+      // when it actually runs.
+    }
+  }
+
+  return names;
+}
+
+// -----------------------------------------------------------------------
+// ImageLoader
+// -----------------------------------------------------------------------
+ImageLoader::ImageLoader(int thread_count, const ImageDiskCache* disk_cache)
+    : disk_cache_(disk_cache) {
+  for (int i = 0; i < std::max(thread_count, 1); ++i)
+    threads_.emplace_back(&ImageLoader::WorkerLoop, this);
+}
+
+ImageLoader::~ImageLoader() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutting_down_ = true;
+  }
+  jobs_available_.notify_all();
+  for (std::thread& thread : threads_)
+    thread.join();
+}
+
+ImageLoader::Future ImageLoader::Prefetch(
+    const std::string& name,
+    const boost::filesystem::path& path) {
+  auto it = pending_.find(name);
+  if (it != pending_.end())
+    return it->second;
+
+  std::promise<std::shared_ptr<const DecodedImage>> promise;
+  Future future = promise.get_future().share();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    jobs_.push_back(Job{name, path, std::move(promise)});
+  }
+  jobs_available_.notify_one();
+
+  pending_.emplace(name, future);
+  pending_order_.push_back(name);
+  while (pending_.size() > kMaxPendingImages) {
+    const std::string& evicted = pending_order_.front();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto job = std::find_if(jobs_.begin(), jobs_.end(),
+                              [&](const Job& j) { return j.name == evicted; });
+      if (job != jobs_.end())
+        jobs_.erase(job);
+    }
+    pending_.erase(evicted);
+    pending_order_.pop_front();
+  }
+
+  return future;
+}
+
+ImageLoader::Future ImageLoader::Take(const std::string& name) {
+  auto it = pending_.find(name);
+  if (it == pending_.end())
+    return Future();
+
+  Future future = it->second;
+  pending_.erase(it);
+  pending_order_.erase(
+      std::find(pending_order_.begin(), pending_order_.end(), name));
+  return future;
+}
+
+size_t ImageLoader::queued_size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return jobs_.size();
+}
+
+void ImageLoader::Clear() {
+  pending_.clear();
+  pending_order_.clear();
+
+  // Jobs still in the queue would only decode images nobody is waiting for.
+  std::lock_guard<std::mutex> lock(mutex_);
+  jobs_.clear();
+}
+
+void ImageLoader::WorkerLoop() {
+  while (true) {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      jobs_available_.wait(lock,
+                           [this]() { return shutting_down_ || !jobs_.empty(); });
+      if (shutting_down_)
+        return;
+      job = std::move(jobs_.front());
+      jobs_.pop_front();
+    }
+
+    try {
+      job.promise.set_value(DecodeImageFile(job.path, disk_cache_));
+    } catch (...) {
+      job.promise.set_exception(std::current_exception());
+    }
+  }
+}
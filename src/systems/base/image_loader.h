@@ -0,0 +1,153 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#ifndef SRC_SYSTEMS_BASE_IMAGE_LOADER_H_
+#define SRC_SYSTEMS_BASE_IMAGE_LOADER_H_
+
+#include <boost/filesystem/path.hpp>
+
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "systems/base/rect.h"
+#include "systems/base/surface.h"
+
+class ImageDiskCache;
+class RLMachine;
+
+namespace libreallive {
+class CommandElement;
+class MappedFile;
+}
+
+// The pixels of a G00 or PDT file, decoded but not yet turned into a
+// platform Surface.
+struct DecodedImage {
+  Size size;
+
+  // size.width() * size.height() 32-bit pixels, in the layout GRPCONV::Read()
+  // produces. Null if the decoder couldn't read the pixel data, or if the
+  // image came out of an ImageDiskCache.
+  std::unique_ptr<char[]> pixels;
+
+  // For images read from an ImageDiskCache: the mapped entry, and where in it
+  // the pixels are.
+  std::shared_ptr<libreallive::MappedFile> mapping;
+  const char* mapped_pixels = nullptr;
+
+  // Whether any pixel is less than fully opaque.
+  bool has_alpha = false;
+
+  // The G00 type 2 regions, or a single region covering the whole image.
+  std::vector<Surface::GrpRect> region_table;
+
+  // The pixels, wherever they live. Null if there aren't any.
+  const char* data() const { return pixels ? pixels.get() : mapped_pixels; }
+};
+
+// Reads and decodes the image at |path|. Touches no shared state, so it's safe
+// to call from any thread. Throws rlvm::Exception or SystemError on failure.
+//
+// With a |disk_cache|, a valid entry for |path| is returned instead of
+// decoding, and fresh decodes are written back to it.
+std::shared_ptr<const DecodedImage> DecodeImageFile(
+    const boost::filesystem::path& path,
+    const ImageDiskCache* disk_cache = nullptr);
+
+// The string constants passed to |f| if it's a Grp, Bgr or object creation
+// opcode, each listed once. These are the file names a script is about to
+// load.
+std::vector<std::string> FindImageNames(RLMachine& machine,
+                                        const libreallive::CommandElement& f);
+
+// A small pool of threads that decode image files before the interpreter asks
+// for them. Only the main thread may call Prefetch(), Take() and Clear(); the
+// workers only ever see the job queue.
+class ImageLoader {
+ public:
+  typedef std::shared_future<std::shared_ptr<const DecodedImage>> Future;
+
+  // |disk_cache| may be null. If not, it must outlive the loader.
+  ImageLoader(int thread_count, const ImageDiskCache* disk_cache = nullptr);
+  ~ImageLoader();
+
+  // Queues |path| to be decoded and remembered as |name|. Returns the existing
+  // future if |name| is already queued or decoded.
+  Future Prefetch(const std::string& name, const boost::filesystem::path& path);
+
+  // Whether |name| has been queued and not yet taken.
+  bool IsPending(const std::string& name) const {
+    return pending_.count(name) != 0;
+  }
+
+  // Hands over the decode of |name|, which may still be in progress. Returns
+  // an invalid future if |name| was never queued.
+  Future Take(const std::string& name);
+
+  // Forgets every queued and finished decode.
+  void Clear();
+
+  size_t pending_size() const { return pending_.size(); }
+
+  // Decodes queued and not yet started by a worker.
+  size_t queued_size() const;
+
+ private:
+  struct Job {
+    std::string name;
+    boost::filesystem::path path;
+    std::promise<std::shared_ptr<const DecodedImage>> promise;
+  };
+
+  void WorkerLoop();
+
+  const ImageDiskCache* disk_cache_;
+
+  // Guards |jobs_| and |shutting_down_|.
+  mutable std::mutex mutex_;
+  std::condition_variable jobs_available_;
+  std::deque<Job> jobs_;
+  bool shutting_down_ = false;
+
+  // Decodes that haven't been taken yet, and the order they were queued in
+  // so the oldest can be dropped when a script prefetches far more than it
+  // uses. Dropping one also drops its job if no worker has started it.
+  std::map<std::string, Future> pending_;
+  std::deque<std::string> pending_order_;
+
+  std::vector<std::thread> threads_;
+};
+
+#endif  // SRC_SYSTEMS_BASE_IMAGE_LOADER_H_
@@ -57,19 +57,17 @@
 
 #include "systems/base/koepac_voice_archive.h"
 
-#include <boost/filesystem/fstream.hpp>
 #include <boost/filesystem/path.hpp>
 
-#include <algorithm>
 #include <cstring>
-#include <fstream>
+#include <memory>
 #include <sstream>
-#include <vector>
+#include <string_view>
 
+#include "libreallive/filemap.h"
 #include "utilities/exception.h"
 #include "xclannad/endian.hpp"
 
-using std::ifstream;
 using std::ostringstream;
 namespace fs = boost::filesystem;
 
@@ -148,22 +146,22 @@ uint8_t koe_ad_trans_tbl[256] = {
 // -----------------------------------------------------------------------
 class KOEPACVoiceSample : public VoiceSample {
  public:
-  KOEPACVoiceSample(fs::path file, int offset, int length, int rate)
-      : stream_(std::fopen(file.native().c_str(), "rb")),
-        offset_(offset),
-        length_(length),
-        rate_(rate) {}
-
-  virtual ~KOEPACVoiceSample() {
-    if (stream_)
-      fclose(stream_);
-  }
+  // |data| runs from the start of the sample to the end of |file|, since the
+  // table only records the sample's length in blocks.
+  KOEPACVoiceSample(std::shared_ptr<libreallive::MappedFile> file,
+                    std::string_view data,
+                    int length,
+                    int rate)
+      : file_(file), data_(data), length_(length), rate_(rate) {}
+
+  virtual ~KOEPACVoiceSample() {}
 
   virtual char* Decode(int* size) override;
 
  private:
-  FILE* stream_;
-  int offset_;
+  // Keeps |data_| mapped.
+  std::shared_ptr<libreallive::MappedFile> file_;
+  std::string_view data_;
   int length_;
   int rate_;
 };
@@ -174,30 +172,29 @@ char* KOEPACVoiceSample::Decode(int* dest_len) {
   // new[]s, as the consumer of decode() will delete [] the returned pointer.
 
   // avg32 の声データ展開
-  std::unique_ptr<char[]> table(new char[length_ * 2]);
-  fseek(stream_, offset_, 0);
-  fread(table.get(), 2, length_, stream_);
+  if (data_.size() < static_cast<size_t>(length_) * 2)
+    throw rlvm::Exception("KOEPAC sample runs past the end of its archive");
+  const char* table = data_.data();
 
   int all_len = 0;
   for (int i = 0; i < length_; i++)
-    all_len += read_little_endian_short(table.get() + i * 2);
+    all_len += read_little_endian_short(table + i * 2);
 
   // データ読み込み
-  uint8_t* src_orig = new uint8_t[all_len];
+  if (data_.size() - length_ * 2 < static_cast<size_t>(all_len))
+    throw rlvm::Exception("KOEPAC sample runs past the end of its archive");
+  const uint8_t* src =
+      reinterpret_cast<const uint8_t*>(data_.data() + length_ * 2);
   uint16_t* dest_orig = new uint16_t[length_ * 0x1000 + 0x2c];
-
-  if (src_orig == NULL || dest_orig == NULL)
-    return NULL;
-  uint8_t* src = src_orig;
-  fread(src, 1, all_len, stream_);
   *dest_len = length_ * 0x400 * 4;
-  const char* header = MakeWavHeader(rate_, 2, 2, *dest_len);
-  memcpy(dest_orig, header, 0x2c);
-  uint16_t* dest = dest_orig + 0x2c;
+  memcpy(dest_orig, MakeWavHeader(rate_, 2, 2, *dest_len).data(),
+         WAV_HEADER_SIZE);
+  uint16_t* dest = reinterpret_cast<uint16_t*>(
+      reinterpret_cast<char*>(dest_orig) + WAV_HEADER_SIZE);
 
   // 展開
   for (int i = 0; i < length_; i++) {
-    int slen = read_little_endian_short(table.get() + i * 2);
+    int slen = read_little_endian_short(table + i * 2);
     if (slen == 0) {  // do nothing
       memset(dest, 0, 0x1000);
       dest += 0x800;
@@ -244,8 +241,6 @@ char* KOEPACVoiceSample::Decode(int* dest_len) {
       src += slen;
     }
   }
-  delete[] src_orig;
-
   return (char*)dest_orig;
 }
 
@@ -253,7 +248,7 @@ char* KOEPACVoiceSample::Decode(int* dest_len) {
 // KOEPACVoiceArchive
 // -----------------------------------------------------------------------
 KOEPACVoiceArchive::KOEPACVoiceArchive(fs::path file, int file_no)
-    : VoiceArchive(file_no), file_(file) {
+    : VoiceArchive(file, file_no) {
   ReadTable(file);
 }
 
@@ -264,11 +259,10 @@ KOEPACVoiceArchive::~KOEPACVoiceArchive() {}
 // -----------------------------------------------------------------------
 
 std::shared_ptr<VoiceSample> KOEPACVoiceArchive::FindSample(int sample_num) {
-  std::vector<Entry>::const_iterator it =
-      std::lower_bound(entries_.begin(), entries_.end(), sample_num);
-  if (it != entries_.end()) {
-    return std::shared_ptr<VoiceSample>(
-        new KOEPACVoiceSample(file_, it->offset, it->length, rate_));
+  const Entry* entry = FindEntry(sample_num);
+  if (entry) {
+    return std::shared_ptr<VoiceSample>(new KOEPACVoiceSample(
+        mapping(), SliceFrom(entry->offset), entry->length, rate_));
   }
 
   throw rlvm::Exception("Couldn't find sample in KOEPACVoiceArchive");
@@ -277,39 +271,35 @@ std::shared_ptr<VoiceSample> KOEPACVoiceArchive::FindSample(int sample_num) {
 // -----------------------------------------------------------------------
 
 void KOEPACVoiceArchive::ReadTable(boost::filesystem::path file) {
-  fs::ifstream ifs(file, ifstream::in | ifstream::binary);
-  if (!ifs) {
-    std::ostringstream oss;
-    oss << "Could not open file \"" << file << "\".";
-    throw rlvm::Exception(oss.str());
-  }
+  const std::shared_ptr<libreallive::MappedFile>& data = mapping();
 
   // Copied from koedec.cc
-  char head[0x20];
-  ifs.read(head, 0x20);
-  if (strncmp(head, "KOEPAC", 7) != 0) {
+  if (data->size() < 0x20 || strncmp(data->get(), "KOEPAC", 7) != 0) {
     std::ostringstream oss;
     oss << file << " does not appear to be in KOEPAC format";
     throw rlvm::Exception(oss.str());
   }
+  const char* head = data->get();
 
   int table_len = read_little_endian_int(head + 0x10);
-  entries_.reserve(table_len);
+  if (table_len < 0 ||
+      data->size() - 0x20 < static_cast<size_t>(table_len) * 8) {
+    std::ostringstream oss;
+    oss << "The table in " << file << " runs past the end of the file";
+    throw rlvm::Exception(oss.str());
+  }
 
   rate_ = read_little_endian_int(head + 0x18);
   if (rate_ == 0) {
     rate_ = 22050;
   }
 
-  char* buf = new char[table_len * 8];
-  ifs.read(buf, table_len * 8);
+  const char* buf = head + 0x20;
   for (int i = 0; i < table_len; i++) {
     int koe_num = read_little_endian_short(buf + i * 8);
     int length = read_little_endian_short(buf + i * 8 + 2);
     int offset = read_little_endian_int(buf + i * 8 + 4);
-    entries_.emplace_back(koe_num, length, offset);
+    AddEntry(koe_num, length, offset);
   }
-  sort(entries_.begin(), entries_.end());
-
-  delete[] buf;
+  SortEntries();
 }
@@ -28,7 +28,6 @@
 #define SRC_SYSTEMS_BASE_KOEPAC_VOICE_ARCHIVE_H_
 
 #include <boost/filesystem/path.hpp>
-#include <vector>
 
 #include "systems/base/voice_archive.h"
 
@@ -44,14 +43,8 @@ class KOEPACVoiceArchive : public VoiceArchive {
  private:
   void ReadTable(boost::filesystem::path file);
 
-  // The file to read from
-  boost::filesystem::path file_;
-
   // The rate of the samples in this file.
   int rate_;
-
-  // A list of samples in this archive
-  std::vector<Entry> entries_;
 };  // class KOEPACVoiceArchive
 
 #endif  // SRC_SYSTEMS_BASE_KOEPAC_VOICE_ARCHIVE_H_
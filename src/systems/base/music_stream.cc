@@ -0,0 +1,196 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#include "systems/base/music_stream.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include "xclannad/wavfile.h"
+
+namespace {
+
+// How long the decoder sleeps when the ring is full. The ring holds far more
+// than this, so the callback never gets near the end of it meanwhile.
+const std::chrono::milliseconds kFullWait(5);
+
+// How much Start() waits to have decoded before playback begins.
+const int kPrefillFrames = 8192;
+
+}  // namespace
+
+// -----------------------------------------------------------------------
+// PcmRingBuffer
+// -----------------------------------------------------------------------
+
+PcmRingBuffer::PcmRingBuffer(int frames)
+    : capacity_(frames),
+      buffer_(new char[frames * kFrameSize]),
+      read_count_(0),
+      write_count_(0) {}
+
+PcmRingBuffer::~PcmRingBuffer() {}
+
+int PcmRingBuffer::Write(const char* data, int frames) {
+  size_t write_count = write_count_.load(std::memory_order_relaxed);
+  size_t read_count = read_count_.load(std::memory_order_acquire);
+  frames = std::min(frames, capacity_ - static_cast<int>(write_count -
+                                                         read_count));
+
+  int pos = write_count % capacity_;
+  int first = std::min(frames, capacity_ - pos);
+  memcpy(buffer_.get() + pos * kFrameSize, data, first * kFrameSize);
+  memcpy(buffer_.get(),
+         data + first * kFrameSize,
+         (frames - first) * kFrameSize);
+
+  write_count_.store(write_count + frames, std::memory_order_release);
+  return frames;
+}
+
+int PcmRingBuffer::Read(char* data, int frames) {
+  size_t read_count = read_count_.load(std::memory_order_relaxed);
+  size_t write_count = write_count_.load(std::memory_order_acquire);
+  frames = std::min(frames, static_cast<int>(write_count - read_count));
+
+  int pos = read_count % capacity_;
+  int first = std::min(frames, capacity_ - pos);
+  memcpy(data, buffer_.get() + pos * kFrameSize, first * kFrameSize);
+  memcpy(data + first * kFrameSize,
+         buffer_.get(),
+         (frames - first) * kFrameSize);
+
+  read_count_.store(read_count + frames, std::memory_order_release);
+  return frames;
+}
+
+int PcmRingBuffer::readable() const {
+  return static_cast<int>(write_count_.load(std::memory_order_acquire) -
+                          read_count_.load(std::memory_order_acquire));
+}
+
+int PcmRingBuffer::writable() const { return capacity_ - readable(); }
+
+// -----------------------------------------------------------------------
+// MusicStream
+// -----------------------------------------------------------------------
+
+MusicStream::MusicStream(WAVFILE* file, int buffer_frames)
+    : file_(file),
+      ring_(buffer_frames),
+      loop_point_(kStopAtEnd),
+      decoder_done_(false),
+      underruns_(0),
+      stopping_(false) {}
+
+MusicStream::~MusicStream() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  wake_decoder_.notify_all();
+  if (decoder_.joinable())
+    decoder_.join();
+}
+
+void MusicStream::Start(int loop_point) {
+  loop_point_ = loop_point;
+  if (decoder_.joinable())
+    return;
+
+  decoder_ = std::thread(&MusicStream::DecodeLoop, this);
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  int prefill = std::min(kPrefillFrames, ring_.capacity());
+  prefilled_.wait(lock, [this, prefill]() {
+    return decoder_done_ || ring_.readable() >= prefill;
+  });
+}
+
+int MusicStream::Read(char* out, int frames) {
+  int count = ring_.Read(out, frames);
+  if (count < frames && !decoder_done_)
+    ++underruns_;
+  return count;
+}
+
+bool MusicStream::at_end() const {
+  return decoder_done_ && ring_.readable() == 0;
+}
+
+void MusicStream::DecodeLoop() {
+  std::unique_ptr<char[]> chunk(
+      new char[kChunkFrames * PcmRingBuffer::kFrameSize]);
+  int prefill = std::min(kPrefillFrames, ring_.capacity());
+  bool prefilled = false;
+  bool just_looped = false;
+  bool end = false;
+
+  while (!end) {
+    int decoded = std::max(
+        0, file_->Read(chunk.get(), PcmRingBuffer::kFrameSize, kChunkFrames));
+    if (decoded < kChunkFrames) {
+      // The end of the file. Carry on from the loop point with the next read,
+      // unless there's nothing to loop over.
+      int loop_point = loop_point_;
+      if (loop_point == kStopAtEnd || (decoded == 0 && just_looped)) {
+        end = true;
+      } else {
+        file_->Seek(loop_point);
+        just_looped = true;
+      }
+    } else {
+      just_looped = false;
+    }
+
+    // Hand the chunk over, waiting for the reader to make room.
+    int written = 0;
+    while (true) {
+      written += ring_.Write(chunk.get() + written * PcmRingBuffer::kFrameSize,
+                             decoded - written);
+
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (!prefilled && ring_.readable() >= prefill) {
+        prefilled = true;
+        prefilled_.notify_all();
+      }
+      if (stopping_)
+        return;
+      if (written == decoded)
+        break;
+      if (wake_decoder_.wait_for(
+              lock, kFullWait, [this]() { return stopping_; })) {
+        return;
+      }
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  decoder_done_ = true;
+  prefilled_.notify_all();
+}
@@ -0,0 +1,135 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#ifndef SRC_SYSTEMS_BASE_MUSIC_STREAM_H_
+#define SRC_SYSTEMS_BASE_MUSIC_STREAM_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+struct WAVFILE;
+
+// A fixed size ring of 16-bit stereo frames shared by exactly one writer and
+// one reader thread. Neither side ever blocks or takes a lock, so the reader
+// can be an audio callback.
+class PcmRingBuffer {
+ public:
+  static const int kFrameSize = 4;
+
+  explicit PcmRingBuffer(int frames);
+  ~PcmRingBuffer();
+
+  // Writer side: copies up to |frames| frames in, returning how many fit.
+  int Write(const char* data, int frames);
+
+  // Reader side: copies up to |frames| frames out, returning how many there
+  // were.
+  int Read(char* data, int frames);
+
+  // Frames waiting to be read, and free space to write into. Each is exact
+  // from its own side and a lower bound from the other.
+  int readable() const;
+  int writable() const;
+
+  int capacity() const { return capacity_; }
+
+ private:
+  const int capacity_;
+  std::unique_ptr<char[]> buffer_;
+
+  // Total frames ever read and written; the ring positions are these modulo
+  // |capacity_|.
+  std::atomic<size_t> read_count_;
+  std::atomic<size_t> write_count_;
+};
+
+// Decodes a music track ahead of playback on its own thread, so the audio
+// callback only has to copy frames out of a PcmRingBuffer. The decoder thread
+// owns the WAVFILE once Start() is called, and handles looping by seeking back
+// to the loop point as it reaches the end, so the frames come out exactly as
+// reading the file directly would produce them.
+class MusicStream {
+ public:
+  // Passed as the loop point to stop at the end of the file.
+  static const int kStopAtEnd = -1;
+
+  // Buffers a little over a second at 44.1kHz.
+  static const int kDefaultBufferFrames = 1 << 16;
+
+  // Takes ownership of |file|, which should already be at its start point and
+  // produce WAVFILE::freq 16-bit stereo frames.
+  explicit MusicStream(WAVFILE* file,
+                       int buffer_frames = kDefaultBufferFrames);
+
+  // Stops and joins the decoder thread, which can mean waiting for one read
+  // from the file to finish. Don't call it from the audio callback or while
+  // holding the audio lock.
+  ~MusicStream();
+
+  // Starts decoding, seeking to |loop_point| at the end of the file (or
+  // stopping there for kStopAtEnd), and waits until enough is decoded to
+  // start playback. Later calls only change the loop point.
+  void Start(int loop_point);
+
+  // Audio callback side: copies up to |frames| frames into |out| and returns
+  // how many were available. Returning fewer before at_end() is an underrun.
+  int Read(char* out, int frames);
+
+  // Whether the decoder reached the end of a non-looping track and every
+  // frame has been read.
+  bool at_end() const;
+
+  // How many Read() calls came up short while the track was still going.
+  int underruns() const { return underruns_; }
+
+ private:
+  // Frames decoded per read from the file.
+  static const int kChunkFrames = 2048;
+
+  void DecodeLoop();
+
+  std::unique_ptr<WAVFILE> file_;
+  PcmRingBuffer ring_;
+
+  std::atomic<int> loop_point_;
+  std::atomic<bool> decoder_done_;
+  std::atomic<int> underruns_;
+
+  // Guards |stopping_| and wakes the decoder early. Never touched by Read().
+  std::mutex mutex_;
+  std::condition_variable wake_decoder_;
+  std::condition_variable prefilled_;
+  bool stopping_;
+
+  std::thread decoder_;
+};
+
+#endif  // SRC_SYSTEMS_BASE_MUSIC_STREAM_H_
@@ -26,8 +26,10 @@
 
 #include "systems/base/nwk_voice_archive.h"
 
-#include <cstdio>
+#include <memory>
+#include <string_view>
 
+#include "libreallive/filemap.h"
 #include "utilities/exception.h"
 #include "xclannad/endian.hpp"
 #include "xclannad/wavfile.h"
@@ -40,50 +42,48 @@ namespace {
 // NWA files thrown together with
 class NWKVoiceSample : public VoiceSample {
  public:
-  NWKVoiceSample(boost::filesystem::path file, int offset, int length);
+  NWKVoiceSample(std::shared_ptr<libreallive::MappedFile> file,
+                 std::string_view data);
   virtual ~NWKVoiceSample();
 
   // Overridden from VoiceSample:
   virtual char* Decode(int* size) override;
 
  private:
-  FILE* stream_;
-  int offset_;
-  int length_;
+  // Keeps |data| mapped.
+  std::shared_ptr<libreallive::MappedFile> file_;
+  std::string_view data_;
 };
 
-NWKVoiceSample::NWKVoiceSample(boost::filesystem::path file,
-                               int offset,
-                               int length)
-    : stream_(std::fopen(file.native().c_str(), "rb")),
-      offset_(offset),
-      length_(length) {}
+NWKVoiceSample::NWKVoiceSample(std::shared_ptr<libreallive::MappedFile> file,
+                               std::string_view data)
+    : file_(file), data_(data) {}
 
-NWKVoiceSample::~NWKVoiceSample() {
-  if (stream_)
-    fclose(stream_);
-}
+NWKVoiceSample::~NWKVoiceSample() {}
 
 char* NWKVoiceSample::Decode(int* size) {
-  // Defined in nwatowav.cc
-  return decode_koe_nwa(stream_, offset_, length_, size);
+  // Defined in nwatowav.cc. Its length counts the header.
+  char* data = decode_koe_nwa(data_, size);
+  if (!data)
+    throw rlvm::Exception("Invalid NWA file in NWKVoiceArchive");
+  *size -= WAV_HEADER_SIZE;
+  return data;
 }
 
 }  // namespace
 
 NWKVoiceArchive::NWKVoiceArchive(fs::path file, int file_no)
-    : VoiceArchive(file_no), file_(file) {
-  ReadVisualArtsTable(file, 12, entries_);
+    : VoiceArchive(file, file_no) {
+  ReadVisualArtsTable(12);
 }
 
 NWKVoiceArchive::~NWKVoiceArchive() {}
 
 std::shared_ptr<VoiceSample> NWKVoiceArchive::FindSample(int sample_num) {
-  std::vector<Entry>::const_iterator it =
-      std::lower_bound(entries_.begin(), entries_.end(), sample_num);
-  if (it != entries_.end()) {
+  const Entry* entry = FindEntry(sample_num);
+  if (entry) {
     return std::shared_ptr<VoiceSample>(
-        new NWKVoiceSample(file_, it->offset, it->length));
+        new NWKVoiceSample(mapping(), Slice(*entry)));
   }
 
   throw rlvm::Exception("Couldn't find sample in NWKVoiceArchive");
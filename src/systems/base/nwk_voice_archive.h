@@ -29,8 +29,6 @@
 
 #include <boost/filesystem/path.hpp>
 
-#include <vector>
-
 #include "systems/base/voice_archive.h"
 
 // A VoiceArchive that reads VisualArts' NWK archives, which are collections of
@@ -41,12 +39,6 @@ class NWKVoiceArchive : public VoiceArchive {
   virtual ~NWKVoiceArchive();
 
   virtual std::shared_ptr<VoiceSample> FindSample(int sample_num) override;
-
- private:
-  // The file to read from
-  boost::filesystem::path file_;
-
-  std::vector<Entry> entries_;
 };
 
 #endif  // SRC_SYSTEMS_BASE_NWK_VOICE_ARCHIVE_H_
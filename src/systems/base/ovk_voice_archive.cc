@@ -58,17 +58,9 @@
 #include "systems/base/ovk_voice_archive.h"
 
 #include <boost/filesystem/path.hpp>
-#include <boost/filesystem/fstream.hpp>
-
-#include <algorithm>
-#include <fstream>
-#include <sstream>
-#include <string>
-#include <vector>
 
 #include "systems/base/ovk_voice_sample.h"
 #include "utilities/exception.h"
-#include "xclannad/endian.hpp"
 
 namespace fs = boost::filesystem;
 
@@ -76,8 +68,8 @@ namespace fs = boost::filesystem;
 // OVKVoiceArchive
 // -----------------------------------------------------------------------
 OVKVoiceArchive::OVKVoiceArchive(fs::path file, int file_no)
-    : VoiceArchive(file_no), file_(file) {
-  ReadVisualArtsTable(file, 16, entries_);
+    : VoiceArchive(file, file_no) {
+  ReadVisualArtsTable(16);
 }
 
 // -----------------------------------------------------------------------
@@ -87,11 +79,10 @@ OVKVoiceArchive::~OVKVoiceArchive() {}
 // -----------------------------------------------------------------------
 
 std::shared_ptr<VoiceSample> OVKVoiceArchive::FindSample(int sample_num) {
-  std::vector<Entry>::const_iterator it =
-      std::lower_bound(entries_.begin(), entries_.end(), sample_num);
-  if (it != entries_.end()) {
+  const Entry* entry = FindEntry(sample_num);
+  if (entry) {
     return std::shared_ptr<VoiceSample>(
-        new OVKVoiceSample(file_, it->offset, it->length));
+        new OVKVoiceSample(mapping(), Slice(*entry)));
   }
 
   throw rlvm::Exception("Couldn't find sample in OVKVoiceArchive");
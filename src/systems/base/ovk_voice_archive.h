@@ -29,8 +29,6 @@
 
 #include <boost/filesystem/path.hpp>
 
-#include <vector>
-
 #include "systems/base/voice_archive.h"
 
 // A VoiceArchive that reads the Ogg Vorbis archives (OVK files).
@@ -41,13 +39,6 @@ class OVKVoiceArchive : public VoiceArchive {
 
   // Overridden from VoiceArchive:
   virtual std::shared_ptr<VoiceSample> FindSample(int sample_num) override;
-
- private:
-  // The file to read from
-  boost::filesystem::path file_;
-
-  // A list of samples in this archive
-  std::vector<Entry> entries_;
 };  // class OVKVoiceArchive
 
 #endif  // SRC_SYSTEMS_BASE_OVK_VOICE_ARCHIVE_H_
@@ -64,6 +64,7 @@
 #include <string>
 #include <sstream>
 
+#include "libreallive/filemap.h"
 #include "utilities/exception.h"
 #include "xclannad/endian.hpp"
 
@@ -113,26 +114,26 @@ std::string oggErrorCodeToString(int code) {
 
 }  // namespace
 
-OVKVoiceSample::OVKVoiceSample(fs::path file)
-    : stream_(std::fopen(file.native().c_str(), "rb")), offset_(0), length_(0) {
-  std::fseek(stream_, 0, SEEK_END);
-  length_ = ftell(stream_);
-  std::fseek(stream_, 0, SEEK_SET);
+OVKVoiceSample::OVKVoiceSample(fs::path file) : position_(0) {
+  try {
+    file_ = std::make_shared<libreallive::MappedFile>(file);
+    data_ = file_->Read(0, file_->size());
+  } catch (std::exception& e) {
+    ostringstream oss;
+    oss << "Could not open file \"" << file << "\".";
+    throw rlvm::Exception(oss.str());
+  }
 }
 
-OVKVoiceSample::OVKVoiceSample(fs::path file, int offset, int length)
-    : stream_(std::fopen(file.native().c_str(), "rb")),
-      offset_(offset),
-      length_(length) {}
+OVKVoiceSample::OVKVoiceSample(std::shared_ptr<libreallive::MappedFile> file,
+                               std::string_view data)
+    : file_(file), data_(data), position_(0) {}
 
-OVKVoiceSample::~OVKVoiceSample() {
-  if (stream_)
-    fclose(stream_);
-}
+OVKVoiceSample::~OVKVoiceSample() {}
 
 char* OVKVoiceSample::Decode(int* size) {
   // This function has been mildly adapted from decode_koe_ogg in xclannad.
-  fseek(stream_, offset_, 0);
+  position_ = 0;
 
   ov_callbacks callback;
   callback.read_func = (size_t (*)(void*, size_t, size_t, void*))ogg_readfunc;
@@ -180,9 +181,9 @@ char* OVKVoiceSample::Decode(int* size) {
     } while (1);
     ov_clear(&vf);
 
-    *size = buffer_size;
-    const char* header = MakeWavHeader(rate, channels, 2, buffer_pos);
-    memcpy(buffer, header, WAV_HEADER_SIZE);
+    *size = buffer_pos - WAV_HEADER_SIZE;
+    memcpy(buffer, MakeWavHeader(rate, channels, 2, *size).data(),
+           WAV_HEADER_SIZE);
   }
   catch (...) {
     delete[] buffer;
@@ -196,29 +197,32 @@ size_t OVKVoiceSample::ogg_readfunc(void* ptr,
                                     size_t size,
                                     size_t nmemb,
                                     OVKVoiceSample* info) {
-  int pt = ftell(info->stream_) - info->offset_;
-  if (pt + size * nmemb > info->length_) {
-    nmemb = (info->length_ - pt) / size;
-  }
-  return fread(ptr, size, nmemb, info->stream_);
+  if (size == 0)
+    return 0;
+  size_t available = info->data_.size() - info->position_;
+  if (size * nmemb > available)
+    nmemb = available / size;
+  memcpy(ptr, info->data_.data() + info->position_, size * nmemb);
+  info->position_ += size * nmemb;
+  return nmemb;
 }
 
 int OVKVoiceSample::ogg_seekfunc(OVKVoiceSample* info,
                                  ogg_int64_t new_offset,
                                  int whence) {
-  int pt = 0;
+  ogg_int64_t pt = 0;
   if (whence == SEEK_SET)
-    pt = info->offset_ + new_offset;
+    pt = new_offset;
   else if (whence == SEEK_CUR)
-    pt = ftell(info->stream_) + new_offset;
+    pt = info->position_ + new_offset;
   else if (whence == SEEK_END)
-    pt = info->offset_ + info->length_ + new_offset;
-  return fseek(info->stream_, pt, 0);
+    pt = info->data_.size() + new_offset;
+  if (pt < 0 || pt > static_cast<ogg_int64_t>(info->data_.size()))
+    return -1;
+  info->position_ = pt;
+  return 0;
 }
 
 long OVKVoiceSample::ogg_tellfunc(OVKVoiceSample* info) {  // NOLINT
-  int pos = ftell(info->stream_);
-  if (pos == -1)
-    return -1;
-  return pos - info->offset_;
+  return info->position_;
 }
@@ -30,6 +30,9 @@
 #include <boost/filesystem/path.hpp>
 #include <vorbis/vorbisfile.h>
 
+#include <memory>
+#include <string_view>
+
 #include "systems/base/voice_archive.h"
 
 class OVKVoiceSample : public VoiceSample {
@@ -37,8 +40,9 @@ class OVKVoiceSample : public VoiceSample {
   // Creates a sample from a full .ogg |file|.
   explicit OVKVoiceSample(boost::filesystem::path file);
 
-  // Creates a sample from an ogg file embedded in the archive at |file|.
-  OVKVoiceSample(boost::filesystem::path file, int offset, int length);
+  // Creates a sample from the ogg file |data|, a slice of |file|.
+  OVKVoiceSample(std::shared_ptr<libreallive::MappedFile> file,
+                 std::string_view data);
   virtual ~OVKVoiceSample();
 
   // Overridden from VoiceSample:
@@ -54,9 +58,12 @@ class OVKVoiceSample : public VoiceSample {
                           int whence);
   static long ogg_tellfunc(OVKVoiceSample* datasource);  // NOLINT
 
-  FILE* stream_;
-  int offset_;
-  int length_;
+  // Keeps |data_| mapped.
+  std::shared_ptr<libreallive::MappedFile> file_;
+  std::string_view data_;
+
+  // The read position in |data_|.
+  size_t position_;
 };
 
 #endif  // SRC_SYSTEMS_BASE_OVK_VOICE_SAMPLE_H_
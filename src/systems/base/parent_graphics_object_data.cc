@@ -30,6 +30,8 @@
 
 #include "systems/base/parent_graphics_object_data.h"
 
+#include <algorithm>
+
 #include "systems/base/graphics_object.h"
 #include "utilities/exception.h"
 
@@ -93,6 +95,15 @@ void ParentGraphicsObjectData::Execute(RLMachine& machine) {
 
 bool ParentGraphicsObjectData::IsAnimation() const { return false; }
 
+uint64_t ParentGraphicsObjectData::ChildRenderVersion() const {
+  uint64_t version = 0;
+  for (int i = 0; i < objects_.size(); ++i) {
+    if (objects_.exists(i))
+      version = std::max(version, objects_[i].render_version());
+  }
+  return version;
+}
+
 void ParentGraphicsObjectData::PlaySet(int set) {
   // Deliberately empty.
 }
@@ -59,6 +59,7 @@ class ParentGraphicsObjectData : public GraphicsObjectData {
   virtual void PlaySet(int set) override;
 
   virtual bool IsParentLayer() const override { return true; }
+  virtual uint64_t ChildRenderVersion() const override;
 
  protected:
   virtual std::shared_ptr<const Surface> CurrentSurface(
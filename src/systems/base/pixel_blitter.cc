@@ -0,0 +1,739 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#include "systems/base/pixel_blitter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "utilities/cpu_dispatch.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if RLVM_HAVE_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+#if RLVM_HAVE_NEON_KERNELS
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+const uint32_t kAlphaMask = 0xff000000;
+
+// SDL blends red and blue together in one 32-bit lane and green in another.
+const uint32_t kRedBlueMask = 0x00ff00ff;
+const uint32_t kGreenMask = 0x0000ff00;
+
+// -----------------------------------------------------------------------
+// Pixel kernels
+// -----------------------------------------------------------------------
+
+struct BlitKernels {
+  // Writes src[i] | fill to dst[i].
+  void (*copy)(uint32_t* dst, const uint32_t* src, size_t count, uint32_t fill);
+
+  // Blends src[i] | fill onto dst[i] by its alpha, the way SDL 1.2's
+  // BlitRGBtoRGBPixelAlpha() does.
+  void (*blend)(uint32_t* dst, const uint32_t* src, size_t count, uint32_t fill);
+
+  // Blends src[i] onto dst[i] by |opacity|, the way SDL 1.2's
+  // BlitRGBtoRGBSurfaceAlpha() does.
+  void (*blend_constant)(uint32_t* dst,
+                         const uint32_t* src,
+                         size_t count,
+                         uint32_t opacity);
+
+  const char* name;
+};
+
+// SDL's arithmetic, including its wrap around in the red/blue lane, is what
+// the output has to match, so every kernel below does exactly this in 32-bit
+// lanes.
+inline uint32_t BlendChannels(uint32_t s, uint32_t d, uint32_t alpha,
+                              uint32_t mask) {
+  s &= mask;
+  d &= mask;
+  return (d + ((s - d) * alpha >> 8)) & mask;
+}
+
+inline uint32_t BlendPixel(uint32_t s, uint32_t d) {
+  uint32_t alpha = s >> 24;
+  if (alpha == 0xff)
+    return (s & ~kAlphaMask) | (d & kAlphaMask);
+  return BlendChannels(s, d, alpha, kRedBlueMask) |
+         BlendChannels(s, d, alpha, kGreenMask) | (d & kAlphaMask);
+}
+
+void CopyScalar(uint32_t* dst, const uint32_t* src, size_t count,
+                uint32_t fill) {
+  if (fill == 0) {
+    memcpy(dst, src, count * 4);
+  } else {
+    for (size_t i = 0; i < count; ++i)
+      dst[i] = src[i] | fill;
+  }
+}
+
+void BlendScalar(uint32_t* dst, const uint32_t* src, size_t count,
+                 uint32_t fill) {
+  for (size_t i = 0; i < count; ++i)
+    dst[i] = BlendPixel(src[i] | fill, dst[i]);
+}
+
+void BlendConstantScalar(uint32_t* dst, const uint32_t* src, size_t count,
+                         uint32_t opacity) {
+  if (opacity == 128) {
+    // SDL special cases half opacity as an average.
+    for (size_t i = 0; i < count; ++i) {
+      uint32_t s = src[i], d = dst[i];
+      dst[i] = ((((s & 0x00fefefe) + (d & 0x00fefefe)) >> 1) +
+                (s & d & 0x00010101)) |
+               kAlphaMask;
+    }
+  } else {
+    for (size_t i = 0; i < count; ++i) {
+      dst[i] = BlendChannels(src[i], dst[i], opacity, kRedBlueMask) |
+               BlendChannels(src[i], dst[i], opacity, kGreenMask) | kAlphaMask;
+    }
+  }
+}
+
+#if defined(__SSE2__)
+// SSE2 only multiplies 32-bit lanes in pairs, as 64-bit results.
+inline __m128i Mullo32SSE2(__m128i a, __m128i b) {
+  __m128i even = _mm_mul_epu32(a, b);
+  __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+  return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                            _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+inline __m128i BlendChannelsSSE2(__m128i s, __m128i d, __m128i alpha,
+                                 __m128i mask) {
+  s = _mm_and_si128(s, mask);
+  d = _mm_and_si128(d, mask);
+  return _mm_and_si128(
+      _mm_add_epi32(d,
+                    _mm_srli_epi32(Mullo32SSE2(_mm_sub_epi32(s, d), alpha), 8)),
+      mask);
+}
+
+void CopySSE2(uint32_t* dst, const uint32_t* src, size_t count,
+              uint32_t fill) {
+  if (fill == 0) {
+    memcpy(dst, src, count * 4);
+    return;
+  }
+  const __m128i fill_bits = _mm_set1_epi32(fill);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                     _mm_or_si128(s, fill_bits));
+  }
+  CopyScalar(dst + i, src + i, count - i, fill);
+}
+
+void BlendSSE2(uint32_t* dst, const uint32_t* src, size_t count,
+               uint32_t fill) {
+  const __m128i fill_bits = _mm_set1_epi32(fill);
+  const __m128i red_blue = _mm_set1_epi32(kRedBlueMask);
+  const __m128i green = _mm_set1_epi32(kGreenMask);
+  const __m128i alpha_bits = _mm_set1_epi32(kAlphaMask);
+  const __m128i opaque = _mm_set1_epi32(0xff);
+  const __m128i zero = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128i s = _mm_or_si128(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)), fill_bits);
+    __m128i alpha = _mm_srli_epi32(s, 24);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, zero)) == 0xffff)
+      continue;
+
+    __m128i* p = reinterpret_cast<__m128i*>(dst + i);
+    __m128i d = _mm_loadu_si128(p);
+    __m128i d_alpha = _mm_and_si128(d, alpha_bits);
+    __m128i blended =
+        _mm_or_si128(_mm_or_si128(BlendChannelsSSE2(s, d, alpha, red_blue),
+                                  BlendChannelsSSE2(s, d, alpha, green)),
+                     d_alpha);
+    __m128i copied = _mm_or_si128(_mm_andnot_si128(alpha_bits, s), d_alpha);
+    __m128i is_opaque = _mm_cmpeq_epi32(alpha, opaque);
+    _mm_storeu_si128(p, _mm_or_si128(_mm_and_si128(is_opaque, copied),
+                                     _mm_andnot_si128(is_opaque, blended)));
+  }
+  BlendScalar(dst + i, src + i, count - i, fill);
+}
+
+void BlendConstantSSE2(uint32_t* dst, const uint32_t* src, size_t count,
+                       uint32_t opacity) {
+  const __m128i red_blue = _mm_set1_epi32(kRedBlueMask);
+  const __m128i green = _mm_set1_epi32(kGreenMask);
+  const __m128i alpha_bits = _mm_set1_epi32(kAlphaMask);
+  const __m128i high_bits = _mm_set1_epi32(0x00fefefe);
+  const __m128i low_bits = _mm_set1_epi32(0x00010101);
+  const __m128i alpha = _mm_set1_epi32(opacity);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    __m128i* p = reinterpret_cast<__m128i*>(dst + i);
+    __m128i d = _mm_loadu_si128(p);
+    __m128i out;
+    if (opacity == 128) {
+      out = _mm_add_epi32(
+          _mm_srli_epi32(_mm_add_epi32(_mm_and_si128(s, high_bits),
+                                       _mm_and_si128(d, high_bits)),
+                         1),
+          _mm_and_si128(_mm_and_si128(s, d), low_bits));
+    } else {
+      out = _mm_or_si128(BlendChannelsSSE2(s, d, alpha, red_blue),
+                         BlendChannelsSSE2(s, d, alpha, green));
+    }
+    _mm_storeu_si128(p, _mm_or_si128(out, alpha_bits));
+  }
+  BlendConstantScalar(dst + i, src + i, count - i, opacity);
+}
+#endif
+
+#if RLVM_HAVE_X86_KERNELS
+// GCC doesn't emit vzeroupper when leaving these through a function pointer,
+// so each kernel clears the upper halves before returning to SSE code.
+__attribute__((target("avx2"))) inline __m256i BlendChannelsAVX2(
+    __m256i s,
+    __m256i d,
+    __m256i alpha,
+    __m256i mask) {
+  s = _mm256_and_si256(s, mask);
+  d = _mm256_and_si256(d, mask);
+  return _mm256_and_si256(
+      _mm256_add_epi32(
+          d,
+          _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_sub_epi32(s, d), alpha),
+                            8)),
+      mask);
+}
+
+__attribute__((target("avx2"))) void CopyAVX2(uint32_t* dst,
+                                             const uint32_t* src,
+                                             size_t count,
+                                             uint32_t fill) {
+  if (fill == 0) {
+    memcpy(dst, src, count * 4);
+    return;
+  }
+  const __m256i fill_bits = _mm256_set1_epi32(fill);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i),
+                        _mm256_or_si256(s, fill_bits));
+  }
+  _mm256_zeroupper();
+  CopyScalar(dst + i, src + i, count - i, fill);
+}
+
+__attribute__((target("avx2"))) void BlendAVX2(uint32_t* dst,
+                                              const uint32_t* src,
+                                              size_t count,
+                                              uint32_t fill) {
+  const __m256i fill_bits = _mm256_set1_epi32(fill);
+  const __m256i red_blue = _mm256_set1_epi32(kRedBlueMask);
+  const __m256i green = _mm256_set1_epi32(kGreenMask);
+  const __m256i alpha_bits = _mm256_set1_epi32(kAlphaMask);
+  const __m256i opaque = _mm256_set1_epi32(0xff);
+  const __m256i zero = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256i s = _mm256_or_si256(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i)),
+        fill_bits);
+    __m256i alpha = _mm256_srli_epi32(s, 24);
+    if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(alpha, zero)) == -1)
+      continue;
+
+    __m256i* p = reinterpret_cast<__m256i*>(dst + i);
+    __m256i d = _mm256_loadu_si256(p);
+    __m256i d_alpha = _mm256_and_si256(d, alpha_bits);
+    __m256i blended = _mm256_or_si256(
+        _mm256_or_si256(BlendChannelsAVX2(s, d, alpha, red_blue),
+                        BlendChannelsAVX2(s, d, alpha, green)),
+        d_alpha);
+    __m256i copied =
+        _mm256_or_si256(_mm256_andnot_si256(alpha_bits, s), d_alpha);
+    __m256i is_opaque = _mm256_cmpeq_epi32(alpha, opaque);
+    _mm256_storeu_si256(
+        p, _mm256_or_si256(_mm256_and_si256(is_opaque, copied),
+                           _mm256_andnot_si256(is_opaque, blended)));
+  }
+  _mm256_zeroupper();
+  BlendScalar(dst + i, src + i, count - i, fill);
+}
+
+__attribute__((target("avx2"))) void BlendConstantAVX2(uint32_t* dst,
+                                                      const uint32_t* src,
+                                                      size_t count,
+                                                      uint32_t opacity) {
+  const __m256i red_blue = _mm256_set1_epi32(kRedBlueMask);
+  const __m256i green = _mm256_set1_epi32(kGreenMask);
+  const __m256i alpha_bits = _mm256_set1_epi32(kAlphaMask);
+  const __m256i high_bits = _mm256_set1_epi32(0x00fefefe);
+  const __m256i low_bits = _mm256_set1_epi32(0x00010101);
+  const __m256i alpha = _mm256_set1_epi32(opacity);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+    __m256i* p = reinterpret_cast<__m256i*>(dst + i);
+    __m256i d = _mm256_loadu_si256(p);
+    __m256i out;
+    if (opacity == 128) {
+      out = _mm256_add_epi32(
+          _mm256_srli_epi32(_mm256_add_epi32(_mm256_and_si256(s, high_bits),
+                                             _mm256_and_si256(d, high_bits)),
+                            1),
+          _mm256_and_si256(_mm256_and_si256(s, d), low_bits));
+    } else {
+      out = _mm256_or_si256(BlendChannelsAVX2(s, d, alpha, red_blue),
+                            BlendChannelsAVX2(s, d, alpha, green));
+    }
+    _mm256_storeu_si256(p, _mm256_or_si256(out, alpha_bits));
+  }
+  _mm256_zeroupper();
+  BlendConstantScalar(dst + i, src + i, count - i, opacity);
+}
+#endif
+
+#if RLVM_HAVE_NEON_KERNELS
+inline uint32x4_t BlendChannelsNEON(uint32x4_t s, uint32x4_t d,
+                                    uint32x4_t alpha, uint32x4_t mask) {
+  s = vandq_u32(s, mask);
+  d = vandq_u32(d, mask);
+  return vandq_u32(
+      vaddq_u32(d, vshrq_n_u32(vmulq_u32(vsubq_u32(s, d), alpha), 8)), mask);
+}
+
+void CopyNEON(uint32_t* dst, const uint32_t* src, size_t count,
+              uint32_t fill) {
+  if (fill == 0) {
+    memcpy(dst, src, count * 4);
+    return;
+  }
+  const uint32x4_t fill_bits = vdupq_n_u32(fill);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4)
+    vst1q_u32(dst + i, vorrq_u32(vld1q_u32(src + i), fill_bits));
+  CopyScalar(dst + i, src + i, count - i, fill);
+}
+
+void BlendNEON(uint32_t* dst, const uint32_t* src, size_t count,
+               uint32_t fill) {
+  const uint32x4_t fill_bits = vdupq_n_u32(fill);
+  const uint32x4_t red_blue = vdupq_n_u32(kRedBlueMask);
+  const uint32x4_t green = vdupq_n_u32(kGreenMask);
+  const uint32x4_t alpha_bits = vdupq_n_u32(kAlphaMask);
+  const uint32x4_t opaque = vdupq_n_u32(0xff);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    uint32x4_t s = vorrq_u32(vld1q_u32(src + i), fill_bits);
+    uint32x4_t alpha = vshrq_n_u32(s, 24);
+    if (vmaxvq_u32(alpha) == 0)
+      continue;
+
+    uint32x4_t d = vld1q_u32(dst + i);
+    uint32x4_t d_alpha = vandq_u32(d, alpha_bits);
+    uint32x4_t blended =
+        vorrq_u32(vorrq_u32(BlendChannelsNEON(s, d, alpha, red_blue),
+                            BlendChannelsNEON(s, d, alpha, green)),
+                  d_alpha);
+    uint32x4_t copied = vorrq_u32(vbicq_u32(s, alpha_bits), d_alpha);
+    vst1q_u32(dst + i, vbslq_u32(vceqq_u32(alpha, opaque), copied, blended));
+  }
+  BlendScalar(dst + i, src + i, count - i, fill);
+}
+
+void BlendConstantNEON(uint32_t* dst, const uint32_t* src, size_t count,
+                       uint32_t opacity) {
+  if (opacity == 128) {
+    BlendConstantScalar(dst, src, count, opacity);
+    return;
+  }
+  const uint32x4_t red_blue = vdupq_n_u32(kRedBlueMask);
+  const uint32x4_t green = vdupq_n_u32(kGreenMask);
+  const uint32x4_t alpha_bits = vdupq_n_u32(kAlphaMask);
+  const uint32x4_t alpha = vdupq_n_u32(opacity);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    uint32x4_t s = vld1q_u32(src + i);
+    uint32x4_t d = vld1q_u32(dst + i);
+    vst1q_u32(dst + i,
+              vorrq_u32(vorrq_u32(BlendChannelsNEON(s, d, alpha, red_blue),
+                                  BlendChannelsNEON(s, d, alpha, green)),
+                        alpha_bits));
+  }
+  BlendConstantScalar(dst + i, src + i, count - i, opacity);
+}
+#endif
+
+BlitKernels SelectBlitKernels() {
+#if RLVM_HAVE_X86_KERNELS
+  if (CpuHasAVX2())
+    return {CopyAVX2, BlendAVX2, BlendConstantAVX2, "avx2"};
+#endif
+#if defined(__SSE2__)
+  return {CopySSE2, BlendSSE2, BlendConstantSSE2, "sse2"};
+#elif RLVM_HAVE_NEON_KERNELS
+  return {CopyNEON, BlendNEON, BlendConstantNEON, "neon"};
+#else
+  return {CopyScalar, BlendScalar, BlendConstantScalar, "scalar"};
+#endif
+}
+
+std::atomic<int> blit_thread_count(1);
+
+const BlitKernels& CurrentKernels() {
+  static const KernelDispatch<BlitKernels> kernels(
+      SelectBlitKernels,
+      {CopyScalar, BlendScalar, BlendConstantScalar, "scalar"});
+  return kernels.get();
+}
+
+// -----------------------------------------------------------------------
+// Row bands
+// -----------------------------------------------------------------------
+
+// Helper threads for ForEachRowBand(). They are started once and wait on a
+// condition variable between passes, since starting threads for every blit
+// costs about as much as the blit saves.
+class RowBandPool {
+ public:
+  ~RowBandPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      shutting_down_ = true;
+    }
+    work_available_.notify_all();
+    for (std::thread& thread : threads_)
+      thread.join();
+  }
+
+  // Starts helpers until there are at least |count|.
+  void Reserve(int count) {
+    std::lock_guard<std::mutex> run_lock(run_mutex_);
+    while (static_cast<int>(threads_.size()) < count)
+      threads_.emplace_back(&RowBandPool::WorkerLoop, this);
+  }
+
+  // Calls |draw_rows| on |bands| bands that together cover [0, rows). The
+  // calling thread draws bands too, and returns once all of them are done.
+  void Run(int rows,
+           int bands,
+           const std::function<void(int, int)>& draw_rows) {
+    std::lock_guard<std::mutex> run_lock(run_mutex_);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      draw_rows_ = &draw_rows;
+      rows_ = rows;
+      bands_ = bands;
+      next_band_ = 0;
+      unfinished_ = bands;
+    }
+    work_available_.notify_all();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (next_band_ < bands_)
+      DrawNextBand(lock);
+    work_done_.wait(lock, [this]() { return unfinished_ == 0; });
+    draw_rows_ = nullptr;
+  }
+
+ private:
+  // Claims the next band and draws it with |mutex_| released.
+  void DrawNextBand(std::unique_lock<std::mutex>& lock) {
+    const int band = next_band_++;
+    const std::function<void(int, int)>& draw_rows = *draw_rows_;
+    const int begin = rows_ * band / bands_;
+    const int end = rows_ * (band + 1) / bands_;
+    lock.unlock();
+    draw_rows(begin, end);
+    lock.lock();
+    if (--unfinished_ == 0)
+      work_done_.notify_one();
+  }
+
+  void WorkerLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      work_available_.wait(lock, [this]() {
+        return shutting_down_ || (draw_rows_ && next_band_ < bands_);
+      });
+      if (shutting_down_)
+        return;
+      DrawNextBand(lock);
+    }
+  }
+
+  // Held for a whole Run(), so passes from different threads take turns.
+  std::mutex run_mutex_;
+
+  // Guards everything below.
+  std::mutex mutex_;
+  std::condition_variable work_available_;
+  std::condition_variable work_done_;
+  const std::function<void(int, int)>* draw_rows_ = nullptr;
+  int rows_ = 0;
+  int bands_ = 0;
+  int next_band_ = 0;
+  int unfinished_ = 0;
+  bool shutting_down_ = false;
+
+  std::vector<std::thread> threads_;
+};
+
+RowBandPool& GetRowBandPool() {
+  static RowBandPool pool;
+  return pool;
+}
+
+// -----------------------------------------------------------------------
+// Blitting
+// -----------------------------------------------------------------------
+
+// Blits smaller than this many pixels per thread aren't worth splitting.
+const int kMinPixelsPerThread = 64 * 1024;
+
+// Pixels gathered from the source at a time when stretching.
+const int kStretchChunk = 256;
+
+// Everything needed to draw one row of a blit, worked out once up front.
+struct BlitPlan {
+  const BlitKernels* kernels;
+  const PixelBuffer* src;
+  const PixelBuffer* dst;
+  BlitOptions options;
+
+  // ORed into every source pixel; kAlphaMask for sources without alpha.
+  uint32_t fill;
+
+  // The destination pixels drawn: columns [dst_x, dst_x + width) of rows
+  // [dst_y, dst_y + height).
+  int dst_x, dst_y, width, height;
+
+  // Unstretched blits read from (src_x, src_y) onwards.
+  int src_x, src_y;
+
+  // Stretched blits read source column x_index[i] for destination column
+  // dst_x + i and source row y_index[j] for destination row dst_y + j. -1
+  // means the sample falls outside the source.
+  bool stretched;
+  std::vector<int> x_index, y_index;
+};
+
+void Draw(const BlitPlan& plan, uint32_t* dst, const uint32_t* src,
+          size_t count, uint32_t fill) {
+  switch (plan.options.mode) {
+    case BLIT_COPY:
+      plan.kernels->copy(dst, src, count, fill);
+      break;
+    case BLIT_ALPHA:
+      plan.kernels->blend(dst, src, count, fill);
+      break;
+    case BLIT_OPACITY:
+      plan.kernels->blend_constant(dst, src, count, plan.options.opacity);
+      break;
+  }
+}
+
+void DrawRows(const BlitPlan& plan, int begin, int end) {
+  for (int j = begin; j < end; ++j) {
+    uint32_t* dst = plan.dst->row(plan.dst_y + j) + plan.dst_x;
+    if (!plan.stretched) {
+      Draw(plan, dst, plan.src->row(plan.src_y + j) + plan.src_x, plan.width,
+           plan.fill);
+      continue;
+    }
+
+    // Gather each chunk of samples, applying |fill| here so that samples
+    // outside the source stay transparent black, as they were in the
+    // temporary surface pygame_stretch() read from.
+    const int y = plan.y_index[j];
+    const uint32_t* src_row = y >= 0 ? plan.src->row(y) : nullptr;
+    uint32_t samples[kStretchChunk];
+    for (int i = 0; i < plan.width; i += kStretchChunk) {
+      const int count = std::min(kStretchChunk, plan.width - i);
+      for (int k = 0; k < count; ++k) {
+        const int x = plan.x_index[i + k];
+        samples[k] = (src_row && x >= 0) ? (src_row[x] | plan.fill) : 0;
+      }
+      Draw(plan, dst + i, samples, count, 0);
+    }
+  }
+}
+
+// Which source row or column pygame_stretch() reads for each of |dst_extent|
+// destination ones, offset by |src_origin| and limited to [0, src_limit).
+// Only entries [begin, end) are filled in; pygame's error term has to be run
+// from the start regardless.
+std::vector<int> StretchIndices(int src_extent,
+                                int dst_extent,
+                                int src_origin,
+                                int src_limit,
+                                int begin,
+                                int end) {
+  std::vector<int> indices(end - begin);
+  const int src2 = src_extent * 2, dst2 = dst_extent * 2;
+  int error = src2 - dst2;
+  int index = 0;
+  for (int i = 0; i < end; ++i) {
+    if (i >= begin) {
+      const int position = src_origin + index;
+      indices[i - begin] =
+          (position >= 0 && position < src_limit) ? position : -1;
+    }
+    while (error >= 0) {
+      ++index;
+      error -= dst2;
+    }
+    error += src2;
+  }
+  return indices;
+}
+
+}  // namespace
+
+BlitOptions SurfaceBlitOptions(bool source_has_alpha,
+                               bool stretched,
+                               bool use_src_alpha,
+                               int alpha) {
+  BlitOptions options;
+  options.source_has_alpha = source_has_alpha;
+  if (!use_src_alpha) {
+    options.mode = BLIT_COPY;
+  } else if (source_has_alpha || stretched) {
+    options.mode = BLIT_ALPHA;
+  } else if (static_cast<uint8_t>(alpha) != 255) {
+    // SDL_SetAlpha() took the value as a Uint8.
+    options.mode = BLIT_OPACITY;
+    options.opacity = static_cast<uint8_t>(alpha);
+  }
+  return options;
+}
+
+void BlitPixels(const PixelBuffer& src,
+                const Rect& src_rect,
+                const PixelBuffer& dst,
+                const Rect& dst_rect,
+                const BlitOptions& options) {
+  if (src_rect.width() <= 0 || src_rect.height() <= 0 ||
+      dst_rect.width() <= 0 || dst_rect.height() <= 0)
+    return;
+
+  // Drawing a buffer onto itself reads from a snapshot, so overlapping
+  // rectangles don't read pixels this blit has already written.
+  if (src.pixels == dst.pixels && src_rect.Intersects(dst_rect)) {
+    std::vector<char> copy(src.pixels, src.pixels + src.pitch * src.size.height());
+    BlitPixels(PixelBuffer(copy.data(), src.size, src.pitch), src_rect, dst,
+               dst_rect, options);
+    return;
+  }
+
+  BlitPlan plan;
+  plan.kernels = &CurrentKernels();
+  plan.src = &src;
+  plan.dst = &dst;
+  plan.options = options;
+  plan.fill = options.source_has_alpha ? 0 : kAlphaMask;
+  plan.stretched = src_rect.size() != dst_rect.size();
+
+  int x_begin, x_end, y_begin, y_end;
+  if (!plan.stretched) {
+    // SDL_BlitSurface() clips against both surfaces.
+    x_begin = std::max({0, -src_rect.x(), -dst_rect.x()});
+    x_end = std::min({src_rect.width(), src.size.width() - src_rect.x(),
+                      dst.size.width() - dst_rect.x()});
+    y_begin = std::max({0, -src_rect.y(), -dst_rect.y()});
+    y_end = std::min({src_rect.height(), src.size.height() - src_rect.y(),
+                      dst.size.height() - dst_rect.y()});
+    plan.src_x = src_rect.x() + x_begin;
+    plan.src_y = src_rect.y() + y_begin;
+  } else {
+    // The stretched image is only clipped against the destination; the
+    // source is sampled, with misses reading as transparent.
+    x_begin = std::max(0, -dst_rect.x());
+    x_end = std::min(dst_rect.width(), dst.size.width() - dst_rect.x());
+    y_begin = std::max(0, -dst_rect.y());
+    y_end = std::min(dst_rect.height(), dst.size.height() - dst_rect.y());
+    if (x_begin < x_end && y_begin < y_end) {
+      plan.x_index =
+          StretchIndices(src_rect.width(), dst_rect.width(), src_rect.x(),
+                         src.size.width(), x_begin, x_end);
+      plan.y_index =
+          StretchIndices(src_rect.height(), dst_rect.height(), src_rect.y(),
+                         src.size.height(), y_begin, y_end);
+    }
+  }
+  if (x_begin >= x_end || y_begin >= y_end)
+    return;
+
+  plan.dst_x = dst_rect.x() + x_begin;
+  plan.dst_y = dst_rect.y() + y_begin;
+  plan.width = x_end - x_begin;
+  plan.height = y_end - y_begin;
+
+  // Rows are independent, so a big blit is cut into bands of rows.
+  ForEachRowBand(plan.height, plan.width,
+                 [&plan](int begin, int end) { DrawRows(plan, begin, end); });
+}
+
+void SetBlitThreadCount(int count) {
+  blit_thread_count = std::max(1, count);
+  GetRowBandPool().Reserve(blit_thread_count - 1);
+}
+
+void ForEachRowBand(int rows,
+                    int row_pixels,
+                    const std::function<void(int, int)>& draw_rows) {
+  const int bands = std::max(
+      1, std::min<int>({blit_thread_count, rows,
+                        rows * row_pixels / kMinPixelsPerThread}));
+  if (bands == 1) {
+    draw_rows(0, rows);
+    return;
+  }
+
+  GetRowBandPool().Run(rows, bands, draw_rows);
+}
+
+const char* BlitKernelName() { return CurrentKernels().name; }
@@ -0,0 +1,118 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#ifndef SRC_SYSTEMS_BASE_PIXEL_BLITTER_H_
+#define SRC_SYSTEMS_BASE_PIXEL_BLITTER_H_
+
+#include <cstdint>
+#include <functional>
+
+#include "systems/base/rect.h"
+
+// A block of 32-bit pixels that read as 0xAARRGGBB in native byte order, the
+// format every display context and loaded image is kept in.
+struct PixelBuffer {
+  PixelBuffer(char* pixels, const Size& size, int pitch)
+      : pixels(pixels), size(size), pitch(pitch) {}
+
+  uint32_t* row(int y) const {
+    return reinterpret_cast<uint32_t*>(pixels + y * pitch);
+  }
+
+  char* pixels;
+  Size size;
+
+  // Bytes from the start of one row to the next.
+  int pitch;
+};
+
+enum BlitMode {
+  // Replaces the destination pixels, alpha included.
+  BLIT_COPY,
+
+  // Blends each source pixel by its own alpha. The destination keeps its
+  // alpha.
+  BLIT_ALPHA,
+
+  // Blends every source pixel by BlitOptions::opacity, ignoring the source's
+  // alpha. The destination becomes opaque.
+  BLIT_OPACITY
+};
+
+struct BlitOptions {
+  BlitMode mode = BLIT_COPY;
+
+  // When false, the source's top byte isn't alpha and is ignored; its pixels
+  // count as fully opaque.
+  bool source_has_alpha = true;
+
+  // Only used by BLIT_OPACITY.
+  int opacity = 255;
+};
+
+// The options that reproduce what SDLSurface::BlitToSurface() got out of SDL
+// for a source with or without an alpha channel, given its |use_src_alpha|
+// and |alpha| arguments. SDL 1.2 ignores the per-surface alpha of surfaces
+// that have an alpha channel, and stretched blits always went through one.
+BlitOptions SurfaceBlitOptions(bool source_has_alpha,
+                               bool stretched,
+                               bool use_src_alpha,
+                               int alpha);
+
+// Draws |src_rect| of |src| into |dst_rect| of |dst|, stretching with nearest
+// neighbour sampling when the sizes differ. Both rectangles are clipped to
+// their buffers the way SDL_BlitSurface() clips; when stretching, the parts of
+// |src_rect| outside |src| read as transparent black.
+//
+// The output is bit for bit what SDLSurface used to get from
+// pygame_AlphaBlit(), pygame_stretch() and SDL 1.2's portable C blitters, in
+// one pass and without temporary surfaces. Large blits are split by rows
+// across SetBlitThreadCount() threads.
+void BlitPixels(const PixelBuffer& src,
+                const Rect& src_rect,
+                const PixelBuffer& dst,
+                const Rect& dst_rect,
+                const BlitOptions& options);
+
+// Sets how many threads a single large blit may be split across, including
+// the calling thread. Defaults to 1. The extra threads are started here and
+// wait for work between blits; lowering the count leaves them idle.
+void SetBlitThreadCount(int count);
+
+// Calls |draw_rows| with [begin, end) bands that together cover [0, rows),
+// one band per thread when |rows| rows of |row_pixels| pixels are enough
+// work to split across the SetBlitThreadCount() threads. For other passes
+// over pixels whose rows are independent.
+void ForEachRowBand(int rows,
+                    int row_pixels,
+                    const std::function<void(int, int)>& draw_rows);
+
+// Name of the pixel kernels BlitPixels() uses on this CPU: "avx2", "sse2",
+// "neon" or "scalar".
+const char* BlitKernelName();
+
+#endif  // SRC_SYSTEMS_BASE_PIXEL_BLITTER_H_
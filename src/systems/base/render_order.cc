@@ -0,0 +1,136 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#include "systems/base/render_order.h"
+
+#include <algorithm>
+#include <tuple>
+
+#include "systems/base/graphics_object.h"
+#include "utilities/lazy_array.h"
+
+namespace {
+
+// When more than one in this many of the listed objects are added at once,
+// sorting the whole list beats inserting them one by one.
+const int kResortDivisor = 8;
+
+bool SameEntry(const RenderOrder::Entry& a, const RenderOrder::Entry& b) {
+  return a.object == b.object && a.z_order == b.z_order &&
+         a.z_layer == b.z_layer && a.z_depth == b.z_depth;
+}
+
+}  // namespace
+
+// -----------------------------------------------------------------------
+// RenderOrder::Entry
+// -----------------------------------------------------------------------
+
+bool RenderOrder::Entry::operator<(const Entry& rhs) const {
+  return std::tie(z_order, z_layer, z_depth, slot) <
+         std::tie(rhs.z_order, rhs.z_layer, rhs.z_depth, rhs.slot);
+}
+
+// -----------------------------------------------------------------------
+// RenderOrder
+// -----------------------------------------------------------------------
+
+RenderOrder::RenderOrder() : version_(0), valid_(false), rebuilds_(0) {}
+
+RenderOrder::~RenderOrder() {}
+
+void RenderOrder::Update(LazyArray<GraphicsObject>& objects,
+                         const SlotFilter& shown) {
+  uint64_t version = GraphicsObject::render_order_version();
+  int size = objects.size();
+  if (valid_ && version == version_ && size == static_cast<int>(slots_.size()))
+    return;
+
+  version_ = version;
+  valid_ = true;
+  ++rebuilds_;
+
+  if (size != static_cast<int>(slots_.size())) {
+    slots_.assign(size, Entry());
+    entries_.clear();
+    entries_.reserve(size);
+    added_.reserve(size);
+  }
+
+  added_.clear();
+  bool removed = false;
+  for (int i = 0; i < size; ++i) {
+    Entry entry = Entry();
+    entry.slot = i;
+    if (objects.exists(i)) {
+      GraphicsObject& object = objects[i];
+      if (object.visible() && object.has_object_data() && shown(i)) {
+        entry.z_order = object.z_order();
+        entry.z_layer = object.z_layer();
+        entry.z_depth = object.z_depth();
+        entry.object = &object;
+      }
+    }
+
+    Entry& listed = slots_[i];
+    if (SameEntry(listed, entry))
+      continue;
+
+    if (listed.object)
+      removed = true;
+    listed = entry;
+    if (entry.object)
+      added_.push_back(entry);
+  }
+
+  // Drop the entries that no longer match their slot; the ones that moved
+  // are added back below.
+  if (removed) {
+    entries_.erase(std::remove_if(entries_.begin(),
+                                  entries_.end(),
+                                  [this](const Entry& entry) {
+                                    return !SameEntry(slots_[entry.slot],
+                                                      entry);
+                                  }),
+                   entries_.end());
+  }
+
+  if (added_.empty())
+    return;
+
+  if (added_.size() * kResortDivisor > entries_.size()) {
+    entries_.insert(entries_.end(), added_.begin(), added_.end());
+    std::sort(entries_.begin(), entries_.end());
+  } else {
+    for (const Entry& entry : added_) {
+      entries_.insert(
+          std::upper_bound(entries_.begin(), entries_.end(), entry), entry);
+    }
+  }
+}
+
+void RenderOrder::Invalidate() { valid_ = false; }
@@ -0,0 +1,98 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#ifndef SRC_SYSTEMS_BASE_RENDER_ORDER_H_
+#define SRC_SYSTEMS_BASE_RENDER_ORDER_H_
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+class GraphicsObject;
+template <typename T>
+class LazyArray;
+
+// The objects of a layer that get drawn, in the order they are drawn: by
+// z_order(), z_layer(), z_depth() and then object number. The order is kept
+// between frames and only the objects whose place in it changed are moved, so
+// a frame where no object was shown, hidden, created, destroyed or had its z
+// values changed costs one comparison.
+class RenderOrder {
+ public:
+  struct Entry {
+    int z_order;
+    int z_layer;
+    int z_depth;
+    int slot;
+    GraphicsObject* object;
+
+    bool operator<(const Entry& rhs) const;
+  };
+
+  typedef std::vector<Entry>::const_iterator const_iterator;
+
+  // Says whether the game's settings allow drawing the object in a slot.
+  typedef std::function<bool(int)> SlotFilter;
+
+  RenderOrder();
+  ~RenderOrder();
+
+  // Brings the order up to date with |objects|. An object is listed when it
+  // is visible, has data to draw and |shown| accepts its slot. The objects are
+  // only looked at when one of them changed in a way that matters here since
+  // the last Update(), or after Invalidate().
+  void Update(LazyArray<GraphicsObject>& objects, const SlotFilter& shown);
+
+  // Makes the next Update() look at every object again, for when what the
+  // filter accepts has changed.
+  void Invalidate();
+
+  const_iterator begin() const { return entries_.begin(); }
+  const_iterator end() const { return entries_.end(); }
+  int size() const { return entries_.size(); }
+
+  // The number of Update() calls that had to look at the objects.
+  int rebuilds() const { return rebuilds_; }
+
+ private:
+  // GraphicsObject::render_order_version() at the last Update().
+  uint64_t version_;
+  bool valid_;
+
+  // The listed objects, sorted.
+  std::vector<Entry> entries_;
+
+  // What each slot was listed with; a null object when it isn't listed.
+  std::vector<Entry> slots_;
+
+  // Scratch space for the entries an Update() adds.
+  std::vector<Entry> added_;
+
+  int rebuilds_;
+};
+
+#endif  // SRC_SYSTEMS_BASE_RENDER_ORDER_H_
@@ -0,0 +1,120 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#include "systems/base/screen_damage.h"
+
+#include <cstdint>
+
+namespace {
+
+// A partial redraw first puts the whole last frame back, so past this share
+// of the screen drawing everything is cheaper.
+const int kFullDamagePercent = 50;
+
+int64_t Area(const Rect& rect) {
+  return static_cast<int64_t>(rect.width()) * rect.height();
+}
+
+}  // namespace
+
+ScreenDamage::ScreenDamage() : full_(true) {}
+
+ScreenDamage::~ScreenDamage() {}
+
+void ScreenDamage::SetScreen(const Rect& screen) {
+  screen_ = screen;
+  AddAll();
+}
+
+void ScreenDamage::Add(const Rect& area) {
+  if (full_ || area.width() <= 0 || area.height() <= 0 ||
+      !area.Intersects(screen_))
+    return;
+  Rect merged = area.Intersection(screen_);
+  if (merged.width() <= 0 || merged.height() <= 0)
+    return;
+
+  // Absorbing one rectangle can make the result touch another, so keep going
+  // until nothing left touches it.
+  bool absorbed = true;
+  while (absorbed) {
+    absorbed = false;
+    for (auto it = rects_.begin(); it != rects_.end(); ++it) {
+      if (it->Intersects(merged)) {
+        merged = merged.RectUnion(*it);
+        rects_.erase(it);
+        absorbed = true;
+        break;
+      }
+    }
+  }
+  rects_.push_back(merged);
+
+  if (static_cast<int>(rects_.size()) > kMaxRects) {
+    Rect bounds = rects_.front();
+    for (const Rect& rect : rects_)
+      bounds = bounds.RectUnion(rect);
+    rects_.assign(1, bounds);
+  }
+
+  int64_t damaged = 0;
+  for (const Rect& rect : rects_)
+    damaged += Area(rect);
+  if (damaged * 100 >= Area(screen_) * kFullDamagePercent)
+    AddAll();
+}
+
+void ScreenDamage::AddAll() {
+  full_ = true;
+  rects_.clear();
+}
+
+void ScreenDamage::Clear() {
+  full_ = false;
+  rects_.clear();
+}
+
+std::vector<Rect> ScreenDamage::rects() const {
+  if (full_)
+    return std::vector<Rect>(1, screen_);
+  return rects_;
+}
+
+bool ScreenDamage::Covers(const Rect& area) const {
+  if (full_ || area.width() <= 0 || area.height() <= 0 ||
+      !area.Intersects(screen_))
+    return true;
+  Rect visible = area.Intersection(screen_);
+  if (visible.width() <= 0 || visible.height() <= 0)
+    return true;
+  for (const Rect& rect : rects_) {
+    if (rect.x() <= visible.x() && rect.y() <= visible.y() &&
+        rect.x2() >= visible.x2() && rect.y2() >= visible.y2())
+      return true;
+  }
+  return false;
+}
@@ -0,0 +1,71 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#ifndef SRC_SYSTEMS_BASE_SCREEN_DAMAGE_H_
+#define SRC_SYSTEMS_BASE_SCREEN_DAMAGE_H_
+
+#include <vector>
+
+#include "systems/base/rect.h"
+
+// The parts of the screen that have to be drawn again because something on
+// them changed since the last frame. Kept as a few disjoint rectangles: ones
+// that touch are merged, and once there are too many of them, or they cover
+// enough of the screen that redrawing only them stops paying off, the whole
+// screen is considered damaged.
+class ScreenDamage {
+ public:
+  ScreenDamage();
+  ~ScreenDamage();
+
+  // Damage is clipped to |screen|. Changing it damages all of it.
+  void SetScreen(const Rect& screen);
+  const Rect& screen() const { return screen_; }
+
+  void Add(const Rect& area);
+  void AddAll();
+  void Clear();
+
+  bool is_full() const { return full_; }
+  bool empty() const { return !full_ && rects_.empty(); }
+
+  // The damaged rectangles; just screen() when is_full().
+  std::vector<Rect> rects() const;
+
+  // Whether all of |area| that's on screen is inside one damaged rectangle.
+  bool Covers(const Rect& area) const;
+
+  // More rectangles than this are collapsed into their bounding box.
+  static const int kMaxRects = 8;
+
+ private:
+  Rect screen_;
+  bool full_;
+  std::vector<Rect> rects_;
+};
+
+#endif  // SRC_SYSTEMS_BASE_SCREEN_DAMAGE_H_
@@ -0,0 +1,63 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#include "systems/base/script_lookahead.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include "libreallive/elements/command.h"
+
+ScriptLookahead::ScriptLookahead(std::ptrdiff_t window) : window_(window) {}
+
+void ScriptLookahead::Scan(const libreallive::Scenario& scenario,
+                           libreallive::Scenario::const_iterator ip,
+                           const Visitor& visit) {
+  const std::ptrdiff_t position = std::distance(scenario.begin(), ip);
+
+  // Only look again once the script has run through half of what we've
+  // already scanned, or has jumped somewhere else.
+  std::ptrdiff_t scan_from = position;
+  if (&scenario == scenario_ && position >= start_ && position <= horizon_) {
+    if (position + window_ / 2 < horizon_)
+      return;
+    scan_from = horizon_;
+  }
+
+  const std::ptrdiff_t size = std::distance(scenario.begin(), scenario.end());
+  const std::ptrdiff_t scan_to = std::min(position + window_, size);
+  const libreallive::Scenario::const_iterator end = scenario.begin() + scan_to;
+  for (auto it = scenario.begin() + scan_from; it < end; ++it) {
+    if (auto* command = dynamic_cast<const libreallive::CommandElement*>(*it))
+      visit(*command);
+  }
+
+  scenario_ = &scenario;
+  start_ = position;
+  horizon_ = scan_to;
+}
+
+void ScriptLookahead::Reset() { scenario_ = nullptr; }
@@ -0,0 +1,70 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#ifndef SRC_SYSTEMS_BASE_SCRIPT_LOOKAHEAD_H_
+#define SRC_SYSTEMS_BASE_SCRIPT_LOOKAHEAD_H_
+
+#include <cstddef>
+#include <functional>
+
+#include "libreallive/scenario.h"
+
+namespace libreallive {
+class CommandElement;
+}  // namespace libreallive
+
+// Walks the commands a little ahead of the instruction pointer for the
+// prefetchers, so each system can start loading what the script is about to
+// use. Remembers how far it has already looked, so that as the script runs
+// forward each command is only visited once; jumping elsewhere starts over.
+class ScriptLookahead {
+ public:
+  typedef std::function<void(const libreallive::CommandElement&)> Visitor;
+
+  // Looks |window| elements past the instruction pointer.
+  explicit ScriptLookahead(std::ptrdiff_t window);
+
+  // Calls |visit| on each command within the window after |ip| in |scenario|
+  // that an earlier call hasn't already visited. Does nothing until the
+  // script has run through half of what was visited, unless it jumped.
+  void Scan(const libreallive::Scenario& scenario,
+            libreallive::Scenario::const_iterator ip,
+            const Visitor& visit);
+
+  // Forgets what was visited, for when the scenarios are reloaded.
+  void Reset();
+
+ private:
+  const std::ptrdiff_t window_;
+
+  // The element range of |scenario_| that has been visited, from where the
+  // instruction pointer was to where the window ended.
+  const libreallive::Scenario* scenario_ = nullptr;
+  std::ptrdiff_t start_ = 0;
+  std::ptrdiff_t horizon_ = 0;
+};
+
+#endif  // SRC_SYSTEMS_BASE_SCRIPT_LOOKAHEAD_H_
@@ -32,12 +32,14 @@
 
 #include <boost/algorithm/string.hpp>
 
+#include <algorithm>
 #include <map>
 #include <sstream>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "machine/rlmachine.h"
 #include "machine/serialization.h"
 #include "systems/base/event_system.h"
 #include "systems/base/system.h"
@@ -227,6 +229,19 @@ void SoundSystem::ExecuteSoundSystem() {
   }
 }
 
+void SoundSystem::PrefetchUpcomingVoices(RLMachine& machine) {
+  // Voices aren't played while skipping, so don't decode them either.
+  if (!is_koe_enabled() || machine.halted() || system().ShouldFastForward())
+    return;
+
+  voice_lookahead_.Scan(machine.Scenario(), machine.InstructionPointer(),
+                        [&](const libreallive::CommandElement& f) {
+                          int id;
+                          if (FindVoiceId(f, &id))
+                            voice_cache_.Prefetch(id);
+                        });
+}
+
 void SoundSystem::SetSoundQuality(const int quality) {
   globals_.sound_quality = quality;
 }
@@ -36,9 +36,11 @@
 #include <string>
 #include <utility>
 
+#include "systems/base/script_lookahead.h"
 #include "systems/base/voice_cache.h"
 
 class Gameexe;
+class RLMachine;
 class System;
 
 const int NUM_BASE_CHANNELS = 16;
@@ -195,6 +197,10 @@ class SoundSystem {
   // it to handle volume adjustment tasks.
   virtual void ExecuteSoundSystem();
 
+  // Starts decoding the voices that the bytecode |machine| is about to run
+  // plays, so koePlay() doesn't stall on the archive and the codec.
+  void PrefetchUpcomingVoices(RLMachine& machine);
+
   // ---------------------------------------------------------------------
 
   // Sets how much sound hertz.
@@ -356,6 +362,9 @@ class SoundSystem {
 
   System& system() { return system_; }
 
+  // Where voices are decoded ahead of being played.
+  const VoiceCache& voice_cache() const { return voice_cache_; }
+
  protected:
   SeTable& se_table() { return se_table_; }
   const DSTable& ds_table() { return ds_tracks_; }
@@ -405,6 +414,9 @@ class SoundSystem {
 
   std::unique_ptr<VolumeAdjustTask> bgm_adjustment_task_;
 
+  // How far ahead PrefetchUpcomingVoices() has looked for voice ids.
+  ScriptLookahead voice_lookahead_{64};
+
   // ---------------------------------------------------------------------
 
   // @name Interface sound effect data
@@ -39,6 +39,13 @@ Surface::~Surface() {}
 
 // -----------------------------------------------------------------------
 
+size_t Surface::GetMemoryUsage() const {
+  Size size = GetSize();
+  return static_cast<size_t>(size.width()) * size.height() * 4;
+}
+
+// -----------------------------------------------------------------------
+
 Rect Surface::GetRect() const { return Rect(Point(0, 0), GetSize()); }
 
 // -----------------------------------------------------------------------
@@ -28,6 +28,7 @@
 #ifndef SRC_SYSTEMS_BASE_SURFACE_H_
 #define SRC_SYSTEMS_BASE_SURFACE_H_
 
+#include <cstddef>
 #include <memory>
 
 #include "systems/base/rect.h"
@@ -58,6 +59,15 @@ class Surface : public std::enable_shared_from_this<Surface> {
   // uploading.
   virtual void EnsureUploaded() const {}
 
+  // Bytes of pixel data held in main memory. Defaults to 32 bits per pixel.
+  virtual size_t GetMemoryUsage() const;
+
+  // Bytes of texture memory currently held on the graphics card.
+  virtual size_t GetTextureMemoryUsage() const { return 0; }
+
+  // Frees any textures. They're rebuilt the next time the surface is drawn.
+  virtual void UnloadTextures() const {}
+
   // ------------------------------------------------- [ Drawing functions ]
 
   // Fills the surface with |colour|.
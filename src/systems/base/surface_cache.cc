@@ -0,0 +1,177 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#include "systems/base/surface_cache.h"
+
+#include <ostream>
+
+#include "libreallive/gameexe.h"
+#include "systems/base/surface.h"
+
+namespace {
+
+const size_t kBytesPerMB = 1024 * 1024;
+
+}  // namespace
+
+SurfaceCache::SurfaceCache(size_t memory_budget, size_t texture_budget)
+    : memory_budget_(memory_budget), texture_budget_(texture_budget) {}
+
+SurfaceCache::~SurfaceCache() {}
+
+// static
+std::unique_ptr<SurfaceCache> SurfaceCache::FromGameexe(Gameexe& gameexe) {
+  int memory_mb = gameexe("IMAGE_CACHE_MB").ToInt(kDefaultMemoryBudgetMB);
+  int texture_mb = gameexe("TEXTURE_CACHE_MB").ToInt(kDefaultTextureBudgetMB);
+  if (memory_mb < 0)
+    memory_mb = 0;
+  if (texture_mb < 0)
+    texture_mb = 0;
+
+  return std::unique_ptr<SurfaceCache>(
+      new SurfaceCache(memory_mb * kBytesPerMB, texture_mb * kBytesPerMB));
+}
+
+std::shared_ptr<const Surface> SurfaceCache::Fetch(const std::string& name) {
+  auto it = index_.find(name);
+  if (it == index_.end()) {
+    stats_.misses++;
+    return std::shared_ptr<const Surface>();
+  }
+
+  stats_.hits++;
+  entries_.splice(entries_.begin(), entries_, it->second);
+  return it->second->surface;
+}
+
+bool SurfaceCache::Contains(const std::string& name) const {
+  return index_.count(name) != 0;
+}
+
+void SurfaceCache::Insert(const std::string& name,
+                          const std::shared_ptr<const Surface>& surface) {
+  int pins = 0;
+  auto it = index_.find(name);
+  if (it != index_.end()) {
+    pins = it->second->pins;
+    Erase(it->second);
+  }
+
+  if (!surface)
+    return;
+
+  size_t bytes = surface->GetMemoryUsage();
+  entries_.push_front(Entry{name, surface, bytes, pins});
+  index_[name] = entries_.begin();
+  memory_usage_ += bytes;
+
+  Trim();
+}
+
+void SurfaceCache::Pin(const std::string& name) {
+  auto it = index_.find(name);
+  if (it != index_.end())
+    it->second->pins++;
+}
+
+void SurfaceCache::Unpin(const std::string& name) {
+  auto it = index_.find(name);
+  if (it != index_.end() && it->second->pins > 0)
+    it->second->pins--;
+}
+
+void SurfaceCache::UnpinAll() {
+  for (Entry& entry : entries_)
+    entry.pins = 0;
+}
+
+void SurfaceCache::Trim() {
+  texture_usage_ = 0;
+  for (const Entry& entry : entries_)
+    texture_usage_ += entry.surface->GetTextureMemoryUsage();
+
+  // Textures first, least recently used first. Losing one only costs an
+  // upload the next time the surface is drawn.
+  for (auto it = entries_.rbegin();
+       it != entries_.rend() && texture_usage_ > texture_budget_;
+       ++it) {
+    if (it->pins || InUse(*it))
+      continue;
+
+    size_t bytes = it->surface->GetTextureMemoryUsage();
+    if (bytes == 0)
+      continue;
+
+    it->surface->UnloadTextures();
+    texture_usage_ -= bytes;
+    stats_.texture_evictions++;
+  }
+
+  // Then whole surfaces.
+  auto it = entries_.end();
+  while (it != entries_.begin() && memory_usage_ > memory_budget_) {
+    --it;
+    if (it->pins || InUse(*it))
+      continue;
+
+    texture_usage_ -= it->surface->GetTextureMemoryUsage();
+    it = Erase(it);
+    stats_.evictions++;
+  }
+}
+
+void SurfaceCache::Clear() {
+  entries_.clear();
+  index_.clear();
+  memory_usage_ = 0;
+  texture_usage_ = 0;
+}
+
+// static
+bool SurfaceCache::InUse(const Entry& entry) {
+  return entry.surface.use_count() > 1;
+}
+
+SurfaceCache::EntryList::iterator SurfaceCache::Erase(
+    EntryList::iterator it) {
+  memory_usage_ -= it->memory_usage;
+  index_.erase(it->name);
+  return entries_.erase(it);
+}
+
+std::ostream& operator<<(std::ostream& os, const SurfaceCache& cache) {
+  const SurfaceCache::Stats& stats = cache.stats();
+  os << "Image cache: " << cache.size() << " surfaces, "
+     << cache.memory_usage() / kBytesPerMB << "/"
+     << cache.memory_budget() / kBytesPerMB << " MB pixels, "
+     << cache.texture_usage() / kBytesPerMB << "/"
+     << cache.texture_budget() / kBytesPerMB << " MB textures" << std::endl
+     << "  " << stats.hits << " hits, " << stats.misses << " misses, "
+     << stats.evictions << " evictions, " << stats.texture_evictions
+     << " texture evictions" << std::endl;
+  return os;
+}
@@ -0,0 +1,135 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#ifndef SRC_SYSTEMS_BASE_SURFACE_CACHE_H_
+#define SRC_SYSTEMS_BASE_SURFACE_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+
+class Gameexe;
+class Surface;
+
+// Keeps recently loaded image files around, bounded by how many bytes of pixel
+// data and texture memory they hold rather than by how many files there are.
+// A single CG can be larger than fifty sprites, so a count doesn't say much.
+//
+// The two budgets are enforced separately. Going over the texture budget only
+// frees textures, which are rebuilt from the pixels the next time the surface
+// is drawn; going over the memory budget drops whole surfaces, which then have
+// to be decoded again. Surfaces that are still in use somewhere else are never
+// touched, since dropping our reference wouldn't free anything.
+class SurfaceCache {
+ public:
+  struct Stats {
+    int64_t hits = 0;
+    int64_t misses = 0;
+
+    // Surfaces dropped to get back under the memory budget.
+    int64_t evictions = 0;
+
+    // Surfaces whose textures were freed to get back under the texture budget.
+    int64_t texture_evictions = 0;
+  };
+
+  SurfaceCache(size_t memory_budget, size_t texture_budget);
+  ~SurfaceCache();
+
+  // Reads the budgets, in megabytes, from #IMAGE_CACHE_MB and
+  // #TEXTURE_CACHE_MB, falling back to the defaults below.
+  static std::unique_ptr<SurfaceCache> FromGameexe(Gameexe& gameexe);
+
+  static const int kDefaultMemoryBudgetMB = 256;
+  static const int kDefaultTextureBudgetMB = 128;
+
+  // Returns the surface cached as |name| and marks it as the most recently
+  // used, or null (and counts a miss) if there isn't one.
+  std::shared_ptr<const Surface> Fetch(const std::string& name);
+
+  // Whether |name| is cached. Doesn't count as a use.
+  bool Contains(const std::string& name) const;
+
+  // Caches |surface| as |name|, replacing any earlier entry, and then evicts
+  // whatever is needed to get back under budget.
+  void Insert(const std::string& name,
+              const std::shared_ptr<const Surface>& surface);
+
+  // Pinned entries count against the budgets but are never evicted. Used for
+  // the surfaces scripts preload with grpPreload. Pins nest.
+  void Pin(const std::string& name);
+  void Unpin(const std::string& name);
+  void UnpinAll();
+
+  // Remeasures texture memory and evicts down to the budgets. Surfaces upload
+  // their textures lazily when drawn, so this should run once per frame.
+  void Trim();
+
+  // Drops every entry, pinned or not. Stats are kept.
+  void Clear();
+
+  size_t size() const { return entries_.size(); }
+  size_t memory_usage() const { return memory_usage_; }
+  size_t texture_usage() const { return texture_usage_; }
+  size_t memory_budget() const { return memory_budget_; }
+  size_t texture_budget() const { return texture_budget_; }
+  const Stats& stats() const { return stats_; }
+
+ private:
+  struct Entry {
+    std::string name;
+    std::shared_ptr<const Surface> surface;
+    size_t memory_usage;
+    int pins;
+  };
+  typedef std::list<Entry> EntryList;
+
+  // Whether anything other than this cache holds |entry|'s surface.
+  static bool InUse(const Entry& entry);
+
+  // Removes |it| and returns the entry after it.
+  EntryList::iterator Erase(EntryList::iterator it);
+
+  size_t memory_budget_;
+  size_t texture_budget_;
+  size_t memory_usage_ = 0;
+  size_t texture_usage_ = 0;
+
+  // Most recently used first.
+  EntryList entries_;
+  std::map<std::string, EntryList::iterator> index_;
+
+  Stats stats_;
+};
+
+std::ostream& operator<<(std::ostream& os, const SurfaceCache& cache);
+
+#endif  // SRC_SYSTEMS_BASE_SURFACE_CACHE_H_
@@ -26,13 +26,10 @@
 
 #include "systems/base/voice_archive.h"
 
-#include <boost/filesystem/fstream.hpp>
-
 #include <algorithm>
-#include <cstring>
-#include <fstream>
 #include <sstream>
 
+#include "libreallive/filemap.h"
 #include "utilities/exception.h"
 #include "xclannad/endian.hpp"
 
@@ -53,7 +50,7 @@ unsigned char orig_header[0x2c] = {
     0x04, 0x00,             /* +20 BlockAlign = channels*BytesPerSample */
     0x10, 0x00,             /* +22 BitsPerSample */
     0x64, 0x61, 0x74, 0x61, /* +24 "data" */
-    0x00, 0x00, 0x00, 0x00  /* +28 filesize - 0x2c */
+    0x00, 0x00, 0x00, 0x00  /* +28 data size */
 };
 
 }  // namespace
@@ -64,13 +61,13 @@ unsigned char orig_header[0x2c] = {
 VoiceSample::~VoiceSample() {}
 
 // static
-const char* VoiceSample::MakeWavHeader(int rate, int ch, int bps, int size) {
-  static char header[0x2c];
-  memcpy(header, (const char*)orig_header, 0x2c);
-  write_little_endian_int(header + 0x04, size - 8);
-  write_little_endian_int(header + 0x28, size - 0x2c);
-  write_little_endian_int(header + 0x18, rate);
-  write_little_endian_int(header + 0x1c, rate * ch * bps);
+std::string VoiceSample::MakeWavHeader(int rate, int ch, int bps, int size) {
+  std::string header(reinterpret_cast<const char*>(orig_header),
+                     WAV_HEADER_SIZE);
+  write_little_endian_int(&header[0x04], size + WAV_HEADER_SIZE - 8);
+  write_little_endian_int(&header[0x28], size);
+  write_little_endian_int(&header[0x18], rate);
+  write_little_endian_int(&header[0x1c], rate * ch * bps);
   header[0x16] = ch;
   header[0x20] = ch * bps;
   header[0x22] = bps * 8;
@@ -80,35 +77,76 @@ const char* VoiceSample::MakeWavHeader(int rate, int ch, int bps, int size) {
 // -----------------------------------------------------------------------
 // VoiceArchive
 // -----------------------------------------------------------------------
-VoiceArchive::VoiceArchive(int file_number) : file_number_(file_number) {}
-
-VoiceArchive::~VoiceArchive() {}
-
-void VoiceArchive::ReadVisualArtsTable(boost::filesystem::path file,
-                                       int entry_length,
-                                       std::vector<Entry>& entries) {
-  fs::ifstream ifs(file, fs::ifstream::in | fs::ifstream::binary);
-  if (!ifs) {
+VoiceArchive::VoiceArchive(boost::filesystem::path file, int file_number)
+    : file_number_(file_number) {
+  try {
+    mapping_ = std::make_shared<libreallive::MappedFile>(file);
+  } catch (std::exception& e) {
     std::ostringstream oss;
     oss << "Could not open file \"" << file << "\".";
     throw rlvm::Exception(oss.str());
   }
+}
+
+VoiceArchive::~VoiceArchive() {}
+
+void VoiceArchive::ReadVisualArtsTable(int entry_length) {
+  try {
+    // Copied from koedec.
+    const char* head = mapping_->Read(0, 4).data();
+    int table_len = read_little_endian_int(head);
+    if (table_len < 0)
+      throw libreallive::Error("Negative table length");
+    // Checked before reserving, so a corrupt length can't ask for gigabytes.
+    const size_t table_size = static_cast<size_t>(table_len) * entry_length;
+    if (table_size > mapping_->size() - 4)
+      throw libreallive::Error("Table larger than the file");
+    const char* table = mapping_->Read(4, table_size).data();
+    entries_.reserve(table_len);
+
+    for (int i = 0; i < table_len; ++i, table += entry_length) {
+      int length = read_little_endian_int(table);
+      int offset = read_little_endian_int(table + 4);
+      int koe_num = read_little_endian_int(table + 8);
+      AddEntry(koe_num, length, offset);
+    }
+  } catch (libreallive::Error& e) {
+    throw rlvm::Exception("Voice archive table runs past the end of the file");
+  }
 
-  // Copied from koedec.
-  char head[0x20];
-  ifs.read(head, 4);
-  int table_len = read_little_endian_int(head);
-  entries.reserve(table_len);
-
-  for (int i = 0; i < table_len; ++i) {
-    ifs.read(head, entry_length);
-    int length = read_little_endian_int(head);
-    int offset = read_little_endian_int(head + 4);
-    int koe_num = read_little_endian_int(head + 8);
-    entries.emplace_back(koe_num, length, offset);
+  SortEntries();
+}
+
+void VoiceArchive::AddEntry(int koe_num, int length, int offset) {
+  entries_.emplace_back(koe_num, length, offset);
+}
+
+void VoiceArchive::SortEntries() {
+  std::sort(entries_.begin(), entries_.end());
+}
+
+const VoiceArchive::Entry* VoiceArchive::FindEntry(int sample_num) const {
+  std::vector<Entry>::const_iterator it =
+      std::lower_bound(entries_.begin(), entries_.end(), sample_num);
+  if (it == entries_.end() || it->koe_num != sample_num)
+    return nullptr;
+  return &*it;
+}
+
+std::string_view VoiceArchive::Slice(const Entry& entry) const {
+  if (entry.offset < 0 || entry.length < 0)
+    throw rlvm::Exception("Voice sample runs past the end of its archive");
+  try {
+    return mapping_->Read(entry.offset, entry.length);
+  } catch (libreallive::Error& e) {
+    throw rlvm::Exception("Voice sample runs past the end of its archive");
   }
+}
 
-  std::sort(entries.begin(), entries.end());
+std::string_view VoiceArchive::SliceFrom(int offset) const {
+  if (offset < 0 || static_cast<size_t>(offset) > mapping_->size())
+    throw rlvm::Exception("Voice sample starts past the end of its archive");
+  return mapping_->Read(offset, mapping_->size() - offset);
 }
 
 VoiceArchive::Entry::Entry(int ikoe_num, int ilength, int ioffset)
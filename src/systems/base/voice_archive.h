@@ -30,8 +30,14 @@
 #include <boost/filesystem/path.hpp>
 
 #include <memory>
+#include <string>
+#include <string_view>
 #include <vector>
 
+namespace libreallive {
+class MappedFile;
+}  // namespace libreallive
+
 class VoiceArchive;
 
 const int WAV_HEADER_SIZE = 0x2c;
@@ -42,17 +48,21 @@ class VoiceSample {
  public:
   virtual ~VoiceSample();
 
-  // Returns waveform data, putting the size of the buffer in |size|.
+  // Returns a WAV_HEADER_SIZE byte WAV header followed by the samples, putting
+  // the size of the samples, without the header, in |size|. Caller takes
+  // ownership of the return value.
   virtual char* Decode(int* size) = 0;
 
-  static const char* MakeWavHeader(int rate, int ch, int bps, int size);
+  // The WAV header for |size| bytes of samples, with |bps| bytes per sample.
+  static std::string MakeWavHeader(int rate, int ch, int bps, int size);
 };
 
 // Abstract representation of an archive on disk with a bunch of voice samples
-// in it.
+// in it. The archive is mapped into memory once; its samples decode straight
+// from slices of that mapping, which they keep alive.
 class VoiceArchive : public std::enable_shared_from_this<VoiceArchive> {
  public:
-  explicit VoiceArchive(int file_number);
+  VoiceArchive(boost::filesystem::path file, int file_number);
   virtual ~VoiceArchive();
 
   int file_number() const { return file_number_; }
@@ -73,14 +83,35 @@ class VoiceArchive : public std::enable_shared_from_this<VoiceArchive> {
     bool operator<(int rhs) const { return koe_num < rhs; }
   };
 
-  // Reads and parses' VisualArt's simple audio table format into a
-  // vector<Entry>.
-  void ReadVisualArtsTable(boost::filesystem::path file,
-                           int entry_length,
-                           std::vector<Entry>& entries);
+  // Reads and parses' VisualArt's simple audio table format from the start of
+  // the archive.
+  void ReadVisualArtsTable(int entry_length);
+
+  // Adds a sample to the index; call SortEntries() once they're all in.
+  void AddEntry(int koe_num, int length, int offset);
+  void SortEntries();
+
+  // The entry for |sample_num|, or null if the archive doesn't have it.
+  const Entry* FindEntry(int sample_num) const;
+
+  // The bytes of the archive that |entry| points to.
+  std::string_view Slice(const Entry& entry) const;
+
+  // The bytes of the archive from |offset| to its end.
+  std::string_view SliceFrom(int offset) const;
+
+  const std::shared_ptr<libreallive::MappedFile>& mapping() const {
+    return mapping_;
+  }
 
  private:
   int file_number_;
+
+  // The samples in this archive, sorted by koe_num so lookups are a binary
+  // search of one contiguous array.
+  std::vector<Entry> entries_;
+
+  std::shared_ptr<libreallive::MappedFile> mapping_;
 };  // end of class VoiceArchive
 
 #endif  // SRC_SYSTEMS_BASE_VOICE_ARCHIVE_H_
@@ -28,10 +28,16 @@
 
 #include <boost/algorithm/string.hpp>
 #include <boost/filesystem/path.hpp>
+#include <algorithm>
 #include <iomanip>
 #include <sstream>
+#include <stdexcept>
 #include <string>
+#include <utility>
 
+#include "libreallive/alldefs.h"
+#include "libreallive/elements/command.h"
+#include "systems/base/audio_mixer.h"
 #include "systems/base/koepac_voice_archive.h"
 #include "systems/base/nwk_voice_archive.h"
 #include "systems/base/ovk_voice_archive.h"
@@ -48,76 +54,353 @@ using std::string;
 
 namespace fs = boost::filesystem;
 
+namespace {
+
+// Voice clips waiting to be played are kept up to this many bytes; a second
+// of 48kHz stereo float samples is 384KB.
+const size_t kMaxDecodedVoiceBytes = 8 * 1024 * 1024;
+
+// Archives are only mapped, so keeping plenty of them open costs little more
+// than a descriptor each and saves rereading their tables.
+const int kMaxOpenArchives = 64;
+
+// Voices waiting to be decoded past this many are dropped, oldest first.
+const size_t kMaxQueuedVoices = 16;
+
+// Whether |f| is one of the Koe (1:23) opcodes whose first argument is a voice
+// id: koePlay, koePlayEx, koePlayExC, koeDoPlay, koeDoPlayEx and koeDoPlayExC.
+bool IsVoicePlayingCommand(const libreallive::CommandElement& f) {
+  if (f.modtype() != 1 || f.module() != 23)
+    return false;
+
+  switch (f.opcode()) {
+    case 0:
+    case 1:
+    case 7:
+    case 8:
+    case 9:
+    case 10:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Reads |param| as an integer constant, which the bytecode stores as '$',
+// 0xff and a little endian int32.
+bool ReadIntConstant(const std::string& param, int* value) {
+  if (param.size() != 6 || param[0] != '$' ||
+      static_cast<unsigned char>(param[1]) != 0xff)
+    return false;
+
+  *value = libreallive::read_i32(param, 2);
+  return true;
+}
+
+// Turns |data|, a VoiceSample::Decode() result of |length|, into a clip and
+// frees it.
+std::shared_ptr<AudioClip> LoadDecodedVoice(
+    const VoiceCache::ClipLoader& loader,
+    char* data,
+    int length) {
+  std::unique_ptr<char[]> owned(data);
+  return loader(data, length + WAV_HEADER_SIZE);
+}
+
+size_t ClipBytes(const AudioClip& clip) {
+  return clip.frames() * 2 * sizeof(float);
+}
+
+}  // namespace
+
+bool FindVoiceId(const libreallive::CommandElement& f, int* id) {
+  if (!IsVoicePlayingCommand(f) || f.GetParamCount() == 0)
+    return false;
+
+  // Ids computed from variables aren't known until the opcode runs.
+  return ReadIntConstant(f.GetParam(0), id) && *id >= 0;
+}
+
+// -----------------------------------------------------------------------
+// DecodedVoiceCache
+// -----------------------------------------------------------------------
+DecodedVoiceCache::DecodedVoiceCache(size_t max_bytes)
+    : max_bytes_(max_bytes), bytes_(0) {}
+
+DecodedVoiceCache::~DecodedVoiceCache() {}
+
+void DecodedVoiceCache::Insert(int id, std::shared_ptr<AudioClip> clip) {
+  Remove(id);
+
+  bytes_ += ClipBytes(*clip);
+  clips_[id] = std::move(clip);
+  order_.push_back(id);
+  ++stats_.stored;
+
+  while (bytes_ > max_bytes_ && order_.size() > 1) {
+    Remove(order_.front());
+    ++stats_.evicted;
+  }
+}
+
+std::shared_ptr<AudioClip> DecodedVoiceCache::Take(int id) {
+  auto it = clips_.find(id);
+  if (it == clips_.end())
+    return nullptr;
+
+  std::shared_ptr<AudioClip> clip = it->second;
+  Remove(id);
+  ++stats_.hits;
+  return clip;
+}
+
+void DecodedVoiceCache::Remove(int id) {
+  auto it = clips_.find(id);
+  if (it == clips_.end())
+    return;
+
+  bytes_ -= ClipBytes(*it->second);
+  clips_.erase(it);
+  order_.erase(std::find(order_.begin(), order_.end(), id));
+}
+
+// -----------------------------------------------------------------------
+// VoiceCache
+// -----------------------------------------------------------------------
 VoiceCache::VoiceCache(SoundSystem& sound_system)
-    : sound_system_(sound_system), file_cache_(7) {}
+    : sound_system_(sound_system),
+      file_cache_(kMaxOpenArchives),
+      decoded_(kMaxDecodedVoiceBytes),
+      in_progress_(-1),
+      shutting_down_(false) {}
 
-VoiceCache::~VoiceCache() {}
+VoiceCache::~VoiceCache() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutting_down_ = true;
+  }
+  jobs_available_.notify_all();
+  if (worker_.joinable())
+    worker_.join();
+}
 
 std::shared_ptr<VoiceSample> VoiceCache::Find(int id) {
   int file_no = id / ID_RADIX;
   int index = id % ID_RADIX;
 
-  std::shared_ptr<VoiceArchive> archive = file_cache_.fetch(file_no);
-  if (archive) {
+  std::shared_ptr<VoiceArchive> archive;
+  {
+    std::lock_guard<std::mutex> lock(file_cache_mutex_);
+    archive = file_cache_.fetch(file_no);
+  }
+  if (archive)
     return archive->FindSample(index);
-  } else {
-    archive = FindArchive(file_no);
-    if (archive) {
-      // Cache for later use.
-      file_cache_.insert(file_no, archive);
+
+  fs::path archive_file = FindArchiveFile(file_no);
+  if (!archive_file.empty()) {
+    archive = GetArchive(file_no, archive_file);
+    if (archive)
       return archive->FindSample(index);
-    } else {
-      // There aren't any archives with |file_no|. Look for an individual file
-      // instead.
-      std::shared_ptr<VoiceSample> sample =
-          FindUnpackedSample(file_no, index);
-      if (sample) {
-        return sample;
-      } else {
-        throw rlvm::Exception("No such voice archive or sample");
-      }
-    }
+  } else {
+    // There aren't any archives with |file_no|. Look for an individual file
+    // instead.
+    std::shared_ptr<VoiceSample> sample =
+        OpenUnpackedSample(FindUnpackedFile(file_no, index));
+    if (sample)
+      return sample;
   }
+
+  throw rlvm::Exception("No such voice archive or sample");
 }
 
-std::shared_ptr<VoiceArchive> VoiceCache::FindArchive(int file_no) const {
-  std::ostringstream oss;
-  oss << "z" << std::setw(4) << std::setfill('0') << file_no;
+void VoiceCache::SetClipLoader(ClipLoader loader) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  loader_ = std::move(loader);
+}
 
-  fs::path file =
-      sound_system_.system().FindFile(oss.str(), KOE_ARCHIVE_FILETYPES);
-  if (file.empty()) {
-    return std::shared_ptr<VoiceArchive>();
+char* VoiceCache::Decode(int id, int* length) {
+  std::shared_ptr<VoiceSample> sample = Find(id);
+  if (!sample) {
+    std::ostringstream oss;
+    oss << "No sample for " << id;
+    throw std::runtime_error(oss.str());
   }
 
-  string file_str = file.string();
-  if (iends_with(file_str, "ovk")) {
-    return std::shared_ptr<VoiceArchive>(new OVKVoiceArchive(file, file_no));
-  } else if (iends_with(file_str, "nwk")) {
-    return std::shared_ptr<VoiceArchive>(new NWKVoiceArchive(file, file_no));
-  } else if (iends_with(file_str, "koe")) {
-    return std::shared_ptr<VoiceArchive>(
-        new KOEPACVoiceArchive(file, file_no));
+  return sample->Decode(length);
+}
+
+std::shared_ptr<AudioClip> VoiceCache::LoadClip(int id) {
+  ClipLoader loader;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!loader_)
+      return nullptr;
+
+    job_finished_.wait(lock, [&] { return in_progress_ != id; });
+    std::shared_ptr<AudioClip> clip = decoded_.Take(id);
+    if (clip)
+      return clip;
+
+    // The worker hasn't got to it yet; it's quicker to decode it here than to
+    // wait behind the rest of the queue.
+    jobs_.erase(std::remove_if(jobs_.begin(), jobs_.end(),
+                               [&](const Job& job) { return job.id == id; }),
+                jobs_.end());
+    decoded_.RecordMiss();
+    loader = loader_;
+  }
+
+  int length = 0;
+  char* data = Decode(id, &length);
+  return LoadDecodedVoice(loader, data, length);
+}
+
+void VoiceCache::Prefetch(int id) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!loader_ || in_progress_ == id || decoded_.Contains(id) ||
+        std::any_of(jobs_.begin(), jobs_.end(),
+                    [&](const Job& job) { return job.id == id; }))
+      return;
+  }
+
+  // System::FindFile() isn't safe to call from the worker, so look up where
+  // the voice lives here.
+  Job job;
+  job.id = id;
+  job.archive = FindArchiveFile(id / ID_RADIX);
+  if (job.archive.empty()) {
+    job.loose = FindUnpackedFile(id / ID_RADIX, id % ID_RADIX);
+    if (job.loose.empty())
+      return;
   }
 
-  return std::shared_ptr<VoiceArchive>();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    jobs_.push_back(std::move(job));
+    while (jobs_.size() > kMaxQueuedVoices)
+      jobs_.pop_front();
+
+    if (!worker_.joinable())
+      worker_ = std::thread(&VoiceCache::WorkerLoop, this);
+  }
+  jobs_available_.notify_one();
+}
+
+DecodedVoiceCache::Stats VoiceCache::prefetch_stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return decoded_.stats();
 }
 
-std::shared_ptr<VoiceSample> VoiceCache::FindUnpackedSample(int file_no,
-                                                              int index) const {
+fs::path VoiceCache::FindArchiveFile(int file_no) const {
+  std::ostringstream oss;
+  oss << "z" << std::setw(4) << std::setfill('0') << file_no;
+
+  return sound_system_.system().FindFile(oss.str(), KOE_ARCHIVE_FILETYPES);
+}
+
+fs::path VoiceCache::FindUnpackedFile(int file_no, int index) const {
   // Loose voice files are packed into directories, like:
   // /KOE/0008/z000800073.ogg. We only need to search for the filename though.
   std::ostringstream oss;
   oss << "z" << std::setw(4) << std::setfill('0') << file_no << std::setw(5)
       << std::setfill('0') << index;
 
-  fs::path file =
-      sound_system_.system().FindFile(oss.str(), KOE_LOOSE_FILETYPES);
+  return sound_system_.system().FindFile(oss.str(), KOE_LOOSE_FILETYPES);
+}
+
+std::shared_ptr<VoiceArchive> VoiceCache::GetArchive(int file_no,
+                                                     const fs::path& file) {
+  {
+    std::lock_guard<std::mutex> lock(file_cache_mutex_);
+    std::shared_ptr<VoiceArchive> archive = file_cache_.fetch(file_no);
+    if (archive)
+      return archive;
+  }
+
+  // Reading the archive's table happens outside the lock so the main thread
+  // isn't held up behind the worker opening a different archive.
+  std::shared_ptr<VoiceArchive> archive;
   string file_str = file.string();
+  if (iends_with(file_str, "ovk")) {
+    archive.reset(new OVKVoiceArchive(file, file_no));
+  } else if (iends_with(file_str, "nwk")) {
+    archive.reset(new NWKVoiceArchive(file, file_no));
+  } else if (iends_with(file_str, "koe")) {
+    archive.reset(new KOEPACVoiceArchive(file, file_no));
+  }
 
+  if (archive) {
+    // Cache for later use.
+    std::lock_guard<std::mutex> lock(file_cache_mutex_);
+    file_cache_.insert(file_no, archive);
+  }
+  return archive;
+}
+
+std::shared_ptr<VoiceSample> VoiceCache::OpenUnpackedSample(
+    const fs::path& file) const {
+  string file_str = file.string();
   if (iends_with(file_str, "ogg")) {
     return std::shared_ptr<VoiceSample>(new OVKVoiceSample(file));
   }
 
   return std::shared_ptr<VoiceSample>();
 }
+
+void VoiceCache::WorkerLoop() {
+  while (true) {
+    Job job;
+    ClipLoader loader;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      jobs_available_.wait(lock,
+                           [this] { return shutting_down_ || !jobs_.empty(); });
+      if (shutting_down_)
+        return;
+
+      job = std::move(jobs_.front());
+      jobs_.pop_front();
+      in_progress_ = job.id;
+      loader = loader_;
+    }
+
+    std::shared_ptr<AudioClip> clip;
+    try {
+      std::shared_ptr<VoiceSample> sample;
+      if (!job.archive.empty()) {
+        std::shared_ptr<VoiceArchive> archive =
+            GetArchive(job.id / ID_RADIX, job.archive);
+        if (archive)
+          sample = archive->FindSample(job.id % ID_RADIX);
+      } else {
+        sample = OpenUnpackedSample(job.loose);
+      }
+
+      if (sample) {
+        int length = 0;
+        char* data = sample->Decode(&length);
+        clip = LoadDecodedVoice(loader, data, length);
+      }
+    } catch (std::exception& e) {
+      // Leave it for LoadClip(), which reports the problem if the script
+      // really plays this voice.
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (clip)
+        decoded_.Insert(job.id, std::move(clip));
+      in_progress_ = -1;
+    }
+    job_finished_.notify_all();
+  }
+}
+
+std::ostream& operator<<(std::ostream& os, const VoiceCache& cache) {
+  const DecodedVoiceCache::Stats stats = cache.prefetch_stats();
+  os << "Voice prefetch: " << stats.hits << " hits, " << stats.misses
+     << " misses, " << stats.stored << " stored, " << stats.evicted
+     << " evicted" << std::endl;
+  return os;
+}
@@ -27,33 +27,161 @@
 #ifndef SRC_SYSTEMS_BASE_VOICE_CACHE_H_
 #define SRC_SYSTEMS_BASE_VOICE_CACHE_H_
 
+#include <boost/filesystem/path.hpp>
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
 
 #include "lru_cache.hpp"
 
+class AudioClip;
 class SoundSystem;
 class VoiceArchive;
 class VoiceSample;
 
+namespace libreallive {
+class CommandElement;
+}  // namespace libreallive
+
+// Sets |id| and returns true when |f| is one of the koePlay family of opcodes
+// and is passed its id as a constant. These are the voices a script is about
+// to play.
+bool FindVoiceId(const libreallive::CommandElement& f, int* id);
+
+// Voice clips decoded ahead of being played, bounded by their total size.
+// Each clip is handed over once; when the budget is exceeded the oldest are
+// thrown away.
+class DecodedVoiceCache {
+ public:
+  struct Stats {
+    // Voices played from a prefetched clip.
+    int hits = 0;
+
+    // Voices that had to be decoded when played.
+    int misses = 0;
+
+    // Clips stored, and clips thrown away unplayed.
+    int stored = 0;
+    int evicted = 0;
+  };
+
+  explicit DecodedVoiceCache(size_t max_bytes);
+  ~DecodedVoiceCache();
+
+  bool Contains(int id) const { return clips_.count(id) != 0; }
+
+  // Keeps |clip| for |id|.
+  void Insert(int id, std::shared_ptr<AudioClip> clip);
+
+  // Hands over the clip for |id|, or returns null if there isn't one.
+  std::shared_ptr<AudioClip> Take(int id);
+
+  // Counts a voice that was played without being prefetched.
+  void RecordMiss() { ++stats_.misses; }
+
+  size_t bytes() const { return bytes_; }
+  const Stats& stats() const { return stats_; }
+
+ private:
+  void Remove(int id);
+
+  size_t max_bytes_;
+  size_t bytes_;
+
+  std::map<int, std::shared_ptr<AudioClip>> clips_;
+
+  // Ids in |clips_|, oldest first.
+  std::deque<int> order_;
+
+  Stats stats_;
+};
+
 class VoiceCache {
  public:
   explicit VoiceCache(SoundSystem& sound_system);
   ~VoiceCache();
 
+  // Turns the first |size| bytes of WAV data in |data| into a clip ready for
+  // the mixer, or returns null if it can't.
+  typedef std::function<std::shared_ptr<AudioClip>(const char* data,
+                                                   size_t size)> ClipLoader;
+
   std::shared_ptr<VoiceSample> Find(int id);
 
+  // Sets how decoded voices become clips. The background thread calls
+  // |loader| too, so it mustn't touch anything the game thread changes.
+  // Until this is called nothing is prefetched and LoadClip() returns null.
+  void SetClipLoader(ClipLoader loader);
+
+  // Returns the WAV data of voice |id| as VoiceSample::Decode() does. Throws
+  // if there's no such voice.
+  char* Decode(int id, int* length);
+
+  // Returns voice |id| ready to play, taking it from the prefetched clips
+  // when it's there. Throws if there's no such voice.
+  std::shared_ptr<AudioClip> LoadClip(int id);
+
+  // Queues |id| to be decoded and loaded on a background thread so a later
+  // LoadClip() doesn't have to wait on the disk, the codec or the resampler.
+  void Prefetch(int id);
+
+  DecodedVoiceCache::Stats prefetch_stats() const;
+
  private:
+  // A voice to decode, and the files it might be in; searching for those
+  // stays on the main thread.
+  struct Job {
+    int id;
+    boost::filesystem::path archive;
+    boost::filesystem::path loose;
+  };
+
   // Searches for a file archive of voices.
-  std::shared_ptr<VoiceArchive> FindArchive(int file_no) const;
+  boost::filesystem::path FindArchiveFile(int file_no) const;
 
   // Searches for an unarchived ogg or mp3 file.
-  std::shared_ptr<VoiceSample> FindUnpackedSample(int file_no,
-                                                    int index) const;
+  boost::filesystem::path FindUnpackedFile(int file_no, int index) const;
+
+  // Returns the archive for |file_no|, opening |file| if it isn't cached.
+  std::shared_ptr<VoiceArchive> GetArchive(int file_no,
+                                           const boost::filesystem::path& file);
+  std::shared_ptr<VoiceSample> OpenUnpackedSample(
+      const boost::filesystem::path& file) const;
+
+  void WorkerLoop();
 
   SoundSystem& sound_system_;
 
+  // Guards |file_cache_|, which the worker also uses.
+  std::mutex file_cache_mutex_;
+
   // A mapping between a file id number and the underlying file object.
   LRUCache<int, std::shared_ptr<VoiceArchive>> file_cache_;
+
+  // Guards everything below.
+  mutable std::mutex mutex_;
+  std::condition_variable jobs_available_;
+  std::condition_variable job_finished_;
+  std::deque<Job> jobs_;
+  DecodedVoiceCache decoded_;
+  ClipLoader loader_;
+
+  // The id the worker is decoding, or -1.
+  int in_progress_;
+  bool shutting_down_;
+
+  // Started on the first Prefetch().
+  std::thread worker_;
 };  // class VoiceCache
 
+std::ostream& operator<<(std::ostream& os, const VoiceCache& cache);
+
 #endif  // SRC_SYSTEMS_BASE_VOICE_CACHE_H_
@@ -25,63 +25,86 @@
 //
 // -----------------------------------------------------------------------
 //
-// Every library that I've seen that isn't tied to some sort of mixer library
-// in itself seems to either require you to do conversions, bring in its own
-// preferred file reading code, and/or pass in raw file descriptors for
-// input/output.
-//
-// If I had any idea about audio programming (and wasn't facing a hard one
-// week deadline), I could do a better job of this, but since I don't, write
-// and read from tempfiles. This file is glue code to zresample.
-//
-// Patches welcome.
+// Glue between the WAV data the voice decoders and sound files hold and the
+// AudioMixer. Voice lines used to be written to a temp file, run through
+// zresample and read back; now LoadWavClip() hands every sound's samples to
+// zita-resampler in memory, and leaves ones already at the output rate alone.
 
 #include "systems/sdl/resample.h"
 
-#include <stdlib.h>
-#include <unistd.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
+#include <vector>
 
+#include "systems/base/audio_mixer.h"
 #include "systems/sdl/zresample.h"
-#include "vendor/xclannad/wavfile.h"
+#include "xclannad/endian.hpp"
 
-char* EnsureDataIsCorrectBitrate(char* incoming_data, int* length) {
-  // TODO(erg): Fast path by just returning incoming_data if the bitrate is the
-  // same as the desired rate.
+std::shared_ptr<AudioClip> LoadWavClip(const char* data,
+                                       size_t size,
+                                       int out_rate) {
+  if (size < 12 || memcmp(data, "RIFF", 4) || memcmp(data + 8, "WAVE", 4))
+    return nullptr;
 
-  // Write |incoming_data| to a file.
-  char dir_template[] = "/tmp/rlvm-temp-XXXXXX";
-  char* tmp_dirname = mkdtemp(dir_template);
-  if (tmp_dirname == nullptr) {
-    std::cerr << "Warning! Failed to make temp dir for audio conversion."
-              << std::endl;
-    return incoming_data;
+  int format = 0, channels = 0, in_rate = 0, bits = 0;
+  const char* samples = nullptr;
+  size_t sample_bytes = 0;
+  for (size_t pos = 12; pos + 8 <= size;) {
+    const char* chunk = data + pos;
+    size_t length = static_cast<uint32_t>(read_little_endian_int(chunk + 4));
+    size_t available = std::min(length, size - pos - 8);
+    if (!memcmp(chunk, "fmt ", 4) && available >= 16) {
+      format = read_little_endian_short(chunk + 8);
+      channels = read_little_endian_short(chunk + 10);
+      in_rate = read_little_endian_int(chunk + 12);
+      bits = read_little_endian_short(chunk + 22);
+    } else if (!memcmp(chunk, "data", 4)) {
+      samples = chunk + 8;
+      sample_bytes = available;
+      break;
+    }
+    pos += 8 + length + (length & 1);
   }
 
-  std::string infile_name = tmp_dirname;
-  infile_name += "/input.wav";
-  std::string outfile_name = tmp_dirname;
-  outfile_name += "/output.wav";
-
-  FILE* infile = fopen(infile_name.c_str(), "wb");
-  fwrite(incoming_data, *length, 1, infile);
-  fclose(infile);
-
-  zresample_main(infile_name.c_str(), outfile_name.c_str(), WAVFILE::freq);
-
-  FILE* f = fopen(outfile_name.c_str(), "rb");
-  fseek(f, 0, SEEK_END);
-  long fsize = ftell(f);
-  *length = fsize;
-  fseek(f, 0, SEEK_SET);
+  if (format != 1 || channels <= 0 || in_rate <= 0 || !samples ||
+      (bits != 8 && bits != 16)) {
+    return nullptr;
+  }
 
-  char* outdata = new char[fsize];
-  fread(outdata, fsize, 1, f);
-  fclose(f);
+  size_t frames = sample_bytes / (channels * (bits / 8));
+  std::vector<float> input(frames * channels);
+  for (size_t i = 0; i < input.size(); ++i) {
+    if (bits == 16) {
+      int16_t sample =
+          static_cast<int16_t>(read_little_endian_short(samples + i * 2));
+      input[i] = sample * (1.0f / 32768.0f);
+    } else {
+      input[i] = (static_cast<uint8_t>(samples[i]) - 128) * (1.0f / 128.0f);
+    }
+  }
 
-  unlink(infile_name.c_str());
-  unlink(outfile_name.c_str());
-  rmdir(tmp_dirname);
+  // Stay in float from here on, so the samples are only quantized once, by
+  // the mixer's output.
+  std::vector<float> resampled;
+  if (in_rate != out_rate) {
+    if (zresample_buffer(
+            input.data(), frames, channels, in_rate, out_rate, &resampled)) {
+      std::cerr << "Warning! Can't resample from " << in_rate << " to "
+                << out_rate << "." << std::endl;
+      resampled.swap(input);
+    }
+  } else {
+    resampled.swap(input);
+  }
 
-  return outdata;
+  size_t out_frames = resampled.size() / channels;
+  int right = channels > 1 ? 1 : 0;
+  std::vector<float> stereo(out_frames * 2);
+  for (size_t i = 0; i < out_frames; ++i) {
+    stereo[i * 2] = resampled[i * channels];
+    stereo[i * 2 + 1] = resampled[i * channels + right];
+  }
+  return std::make_shared<AudioClip>(std::move(stereo));
 }
@@ -29,16 +29,16 @@
 #define SRC_SYSTEMS_SDL_RESAMPLE_H_
 
 #include <cstddef>
+#include <memory>
 
-// Ensures that the wav file with PCM data |incoming_data| is of the same
-// bitrate as our output device. This function takes ownership of
-// |incoming_data|. |length| is modified to refer to the size of the return
-// value.
-//
-// Caller takes ownership of return value.
-//
-// TODO(erg): Hopefully, this is a temporary hack. See comments in
-// sdl_sound_system.cc.
-char* EnsureDataIsCorrectBitrate(char* incoming_data, int* length);
+class AudioClip;
+
+// Builds a clip for the AudioMixer from the 8 or 16-bit PCM WAV in the first
+// |size| bytes of |data|, converting it to |out_rate|. This is the one place
+// wav, se and koe samples are resampled, at load time, so the mixer only ever
+// sees clips at its own rate. Returns null if |data| isn't PCM WAV.
+std::shared_ptr<AudioClip> LoadWavClip(const char* data,
+                                       size_t size,
+                                       int out_rate);
 
 #endif  // SRC_SYSTEMS_SDL_RESAMPLE_H_
@@ -32,14 +32,17 @@
 #include "systems/base/graphics_object.h"
 #include "systems/sdl/sdl_utils.h"
 #include "systems/sdl/shaders.h"
+#include "systems/sdl/sprite_batch.h"
 #include "systems/sdl/texture.h"
 
 SDLColourFilter::SDLColourFilter()
     : texture_width_(0), texture_height_(0), back_texture_id_(0) {}
 
 SDLColourFilter::~SDLColourFilter() {
-  if (back_texture_id_)
+  if (back_texture_id_) {
+    SpriteBatch::Get().FlushIfUsing(back_texture_id_);
     glDeleteTextures(1, &back_texture_id_);
+  }
 }
 
 void SDLColourFilter::Fill(const GraphicsObject& go,
@@ -68,7 +71,11 @@ void SDLColourFilter::Fill(const GraphicsObject& go,
     }
 
     // Copy the current value of the region where we're going to render
-    // to a texture for input to the shader
+    // to a texture for input to the shader. Everything queued so far has to
+    // be on screen for that.
+    SpriteBatch& batch = SpriteBatch::Get();
+    batch.Flush();
+
     glBindTexture(GL_TEXTURE_2D, back_texture_id_);
     int ystart =
         int(Texture::ScreenHeight() - screen_rect.y() - screen_rect.height());
@@ -77,34 +84,28 @@ void SDLColourFilter::Fill(const GraphicsObject& go,
         GL_TEXTURE_2D, 0, 0, 0, idx1, ystart, texture_width_, texture_height_);
     DebugShowGLErrors();
 
-    // Set up shader
-    glUseProgramObjectARB(Shaders::GetObjectProgram());
-    glUniform1iARB(Shaders::GetObjectUniformImage(), 0);
-    glUniform1fARB(Shaders::GetObjectUniformAlpha(),
-                   (go.GetComputedAlpha() / 255.0f));
-    Shaders::loadObjectUniformFromGraphicsObject(go);
-
     float thisx1 = 0;
     float thisy1 = 0;
     float thisx2 = float(screen_rect.width()) / texture_width_;
     float thisy2 = float(screen_rect.height()) / texture_height_;
 
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glBegin(GL_QUADS);
-    {
-      glTexCoord2f(thisx1, thisy2);
-      glVertex2f(screen_rect.x(), screen_rect.y());
-      glTexCoord2f(thisx1, thisy1);
-      glVertex2f(screen_rect.x(), screen_rect.y() + screen_rect.height());
-      glTexCoord2f(thisx2, thisy1);
-      glVertex2f(screen_rect.x() + screen_rect.width(),
-                 screen_rect.y() + screen_rect.height());
-      glTexCoord2f(thisx2, thisy2);
-      glVertex2f(screen_rect.x() + screen_rect.width(), screen_rect.y());
-    }
-    glEnd();
-    glBlendFunc(GL_ONE, GL_ZERO);
+    SpriteBatch::State state = {Shaders::GetObjectProgram(),
+                                back_texture_id_,
+                                0,
+                                SpriteBatch::BLEND_ALPHA};
+    SpriteBatch::Vertex* quad = batch.AddQuad(state);
 
-    glUseProgramObjectARB(0);
+    // The copy of the screen is upside down.
+    SpriteBatch::SetRect(quad,
+                         screen_rect.x(),
+                         screen_rect.y(),
+                         screen_rect.x2(),
+                         screen_rect.y2(),
+                         thisx1,
+                         thisy2,
+                         thisx2,
+                         thisy1);
+    SpriteBatch::SetColour(quad, 255, 255, 255, 255);
+    Shaders::SetObjectAttributes(go, go.GetComputedAlpha(), quad);
   }
 }
@@ -44,6 +44,7 @@
 #include <set>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "base/notification_source.h"
@@ -53,7 +54,9 @@
 #include "systems/base/colour.h"
 #include "systems/base/event_system.h"
 #include "systems/base/graphics_object.h"
+#include "systems/base/image_loader.h"
 #include "systems/base/mouse_cursor.h"
+#include "systems/base/pixel_blitter.h"
 #include "systems/base/renderable.h"
 #include "systems/base/system.h"
 #include "systems/base/system_error.h"
@@ -65,12 +68,13 @@
 #include "systems/sdl/sdl_surface.h"
 #include "systems/sdl/sdl_utils.h"
 #include "systems/sdl/shaders.h"
+#include "systems/sdl/sprite_batch.h"
 #include "systems/sdl/texture.h"
+#include "systems/sdl/texture_atlas.h"
 #include "utilities/exception.h"
 #include "utilities/graphics.h"
 #include "utilities/lazy_array.h"
 #include "utilities/string_utilities.h"
-#include "xclannad/file.h"
 
 // -----------------------------------------------------------------------
 // Private Interface
@@ -83,6 +87,8 @@ void SDLGraphicsSystem::SetCursor(int cursor) {
 }
 
 void SDLGraphicsSystem::BeginFrame() {
+  SpriteBatch::Get().Flush();
+
   glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
   DebugShowGLErrors();
@@ -120,13 +126,19 @@ void SDLGraphicsSystem::MarkScreenAsDirty(GraphicsUpdateType type) {
 }
 
 void SDLGraphicsSystem::EndFrame() {
+  // The final renderers draw with GL directly.
+  SpriteBatch& batch = SpriteBatch::Get();
+  batch.Flush();
+
   FinalRenderers::iterator it = renderer_begin();
   FinalRenderers::iterator end = renderer_end();
   for (; it != end; ++it) {
     (*it)->Render(NULL);
   }
 
-  if (screen_update_mode() == SCREENUPDATEMODE_MANUAL) {
+  batch.Flush();
+
+  if (is_refreshing() || screen_update_mode() == SCREENUPDATEMODE_MANUAL) {
     // Copy the area behind the cursor to the temporary buffer (drivers differ:
     // the contents of the back buffer is undefined after SDL_GL_SwapBuffers()
     // and I've just been lucky that the Intel i810 and whatever my Mac machine
@@ -144,8 +156,13 @@ void SDLGraphicsSystem::EndFrame() {
   } else {
     screen_contents_texture_valid_ = false;
   }
+  screen_contents_texture_refreshed_ = is_refreshing();
+
+  if (is_refreshing() && show_screen_damage())
+    DrawScreenDamage();
 
   DrawCursor();
+  batch.Flush();
 
   // Swap the buffers
   glFlush();
@@ -160,30 +177,10 @@ void SDLGraphicsSystem::RedrawLastFrame() {
   // DrawManual() mode.
   if (screen_contents_texture_valid_) {
     // Redraw the screen
-    glBindTexture(GL_TEXTURE_2D, screen_contents_texture_);
-    glBegin(GL_QUADS);
-    {
-      int dx1 = 0;
-      int dx2 = screen_size().width();
-      int dy1 = 0;
-      int dy2 = screen_size().height();
-
-      float x_cord = dx2 / float(screen_tex_width_);
-      float y_cord = dy2 / float(screen_tex_height_);
-
-      glColor4ub(255, 255, 255, 255);
-      glTexCoord2f(0, y_cord);
-      glVertex2i(dx1, dy1);
-      glTexCoord2f(x_cord, y_cord);
-      glVertex2i(dx2, dy1);
-      glTexCoord2f(x_cord, 0);
-      glVertex2i(dx2, dy2);
-      glTexCoord2f(0, 0);
-      glVertex2i(dx1, dy2);
-    }
-    glEnd();
+    DrawLastFrameTexture();
 
     DrawCursor();
+    SpriteBatch::Get().Flush();
 
     glFlush();
 
@@ -193,6 +190,67 @@ void SDLGraphicsSystem::RedrawLastFrame() {
   }
 }
 
+void SDLGraphicsSystem::DrawLastFrameTexture() {
+  int dx2 = screen_size().width();
+  int dy2 = screen_size().height();
+
+  float x_cord = dx2 / float(screen_tex_width_);
+  float y_cord = dy2 / float(screen_tex_height_);
+
+  SpriteBatch::State state = {
+      0, screen_contents_texture_, 0, SpriteBatch::BLEND_REPLACE};
+  SpriteBatch::Vertex* quad = SpriteBatch::Get().AddQuad(state);
+  SpriteBatch::SetRect(quad, 0, 0, dx2, dy2, 0, y_cord, x_cord, 0);
+  SpriteBatch::SetColour(quad, 255, 255, 255, 255);
+}
+
+bool SDLGraphicsSystem::CanRedrawDamageOnly() const {
+  return screen_contents_texture_refreshed_;
+}
+
+void SDLGraphicsSystem::RestoreLastFrame() { DrawLastFrameTexture(); }
+
+void SDLGraphicsSystem::SetScreenClip(const Rect& area) {
+  SpriteBatch::Get().Flush();
+
+  // GL counts rows from the bottom of the screen.
+  glEnable(GL_SCISSOR_TEST);
+  glScissor(area.x(),
+            screen_size().height() - area.y2(),
+            area.width(),
+            area.height());
+
+  // What's under |area| is redrawn from scratch, like BeginFrame() would.
+  glClear(GL_COLOR_BUFFER_BIT);
+}
+
+void SDLGraphicsSystem::ClearScreenClip() {
+  SpriteBatch::Get().Flush();
+  glDisable(GL_SCISSOR_TEST);
+}
+
+void SDLGraphicsSystem::DrawScreenDamage() {
+  // Outlines each damaged rectangle with four one pixel wide quads, queued
+  // behind everything else drawn this frame. Texture 0 is never complete, so
+  // the fixed function pipeline draws them in their flat vertex colour.
+  SpriteBatch& batch = SpriteBatch::Get();
+  SpriteBatch::State state = {0, 0, 0, SpriteBatch::BLEND_REPLACE};
+  for (const Rect& rect : screen_damage().rects()) {
+    const GLfloat x1 = rect.x(), y1 = rect.y();
+    const GLfloat x2 = rect.x2(), y2 = rect.y2();
+    const GLfloat edges[4][4] = {{x1, y1, x2, y1 + 1},
+                                 {x1, y2 - 1, x2, y2},
+                                 {x1, y1 + 1, x1 + 1, y2 - 1},
+                                 {x2 - 1, y1 + 1, x2, y2 - 1}};
+    for (const GLfloat* edge : edges) {
+      SpriteBatch::Vertex* quad = batch.AddQuad(state);
+      SpriteBatch::SetRect(
+          quad, edge[0], edge[1], edge[2], edge[3], 0, 0, 0, 0);
+      SpriteBatch::SetColour(quad, 255, 0, 0, 255);
+    }
+  }
+}
+
 void SDLGraphicsSystem::DrawCursor() {
   if (ShouldUseCustomCursor()) {
     std::shared_ptr<MouseCursor> cursor;
@@ -222,6 +280,7 @@ SDLGraphicsSystem::SDLGraphicsSystem(System& system, Gameexe& gameexe)
       last_seen_number_(0),
       last_line_number_(0),
       screen_contents_texture_valid_(false),
+      screen_contents_texture_refreshed_(false),
       screen_tex_width_(0),
       screen_tex_height_(0) {
   haikei_.reset(new SDLSurface(this));
@@ -245,6 +304,15 @@ SDLGraphicsSystem::SDLGraphicsSystem(System& system, Gameexe& gameexe)
 
   SetWindowTitle();
 
+  // Decode images named by upcoming opcodes off the interpreter thread. One
+  // core is left for the interpreter itself.
+  EnableBackgroundImageDecoding(
+      std::max(1, std::min(4, int(std::thread::hardware_concurrency()) - 1)));
+
+  // Full screen DC blits are large enough to be worth splitting by rows.
+  SetBlitThreadCount(
+      std::max(1, std::min(4, int(std::thread::hardware_concurrency()))));
+
 #if !defined(__APPLE__) && !defined(_WIN32)
   // We only set the icon on Linux because OSX will use the icns file
   // automatically and this doesn't look too awesome.
@@ -355,6 +423,8 @@ void SDLGraphicsSystem::SetupVideo() {
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
   screen_tex_width_ = SafeSize(screen_size().width());
   screen_tex_height_ = SafeSize(screen_size().height());
+  screen_contents_texture_valid_ = false;
+  screen_contents_texture_refreshed_ = false;
   glTexImage2D(GL_TEXTURE_2D,
                0,
                GL_RGBA,
@@ -424,6 +494,8 @@ void SDLGraphicsSystem::Observe(NotificationType type,
                                 const NotificationSource& source,
                                 const NotificationDetails& details) {
   Shaders::Reset();
+  SpriteBatch::Get().Reset();
+  TextureAtlas::Get().Reset();
 }
 
 void SDLGraphicsSystem::SetWindowSubtitle(const std::string& cp932str,
@@ -526,10 +598,12 @@ typedef enum { NO_MASK, ALPHA_MASK, COLOR_MASK } MaskType;
 
 static SDL_Surface* newSurfaceFromRGBAData(int w,
                                            int h,
-                                           char* data,
+                                           const char* data,
                                            MaskType with_mask) {
   int amask = (with_mask == ALPHA_MASK) ? DefaultAmask : 0;
-  SDL_Surface* tmp = SDL_CreateRGBSurfaceFrom(data,
+  // |tmp| is only ever read from by SDL_ConvertSurface() below, so it's fine
+  // for |data| to be a read only mapping.
+  SDL_Surface* tmp = SDL_CreateRGBSurfaceFrom(const_cast<char*>(data),
                                               w,
                                               h,
                                               DefaultBpp,
@@ -558,17 +632,6 @@ static SDL_Surface* newSurfaceFromRGBAData(int w,
   return surf;
 }
 
-// Helper function for load_surface_from_file; invoked in a stl loop.
-static SDLSurface::GrpRect xclannadRegionToGrpRect(
-    const GRPCONV::REGION& region) {
-  SDLSurface::GrpRect rect;
-  rect.rect =
-      Rect(Point(region.x1, region.y1), Point(region.x2 + 1, region.y2 + 1));
-  rect.originX = region.origin_x;
-  rect.originY = region.origin_y;
-  return rect;
-}
-
 std::shared_ptr<const Surface> SDLGraphicsSystem::LoadSurfaceFromFile(
     const std::string& short_filename) {
   boost::filesystem::path filename =
@@ -579,67 +642,23 @@ std::shared_ptr<const Surface> SDLGraphicsSystem::LoadSurfaceFromFile(
     throw rlvm::Exception(oss.str());
   }
 
-  // Glue code to allow my stuff to work with Jagarl's loader
-  FILE* file = fopen(filename.string().c_str(), "rb");
-  if (!file) {
-    std::ostringstream oss;
-    oss << "Could not open file: " << filename;
-    throw rlvm::Exception(oss.str());
-  }
+  return BuildSurfaceFromImage(short_filename,
+                               *DecodeImageFile(filename, image_disk_cache()));
+}
 
-  fseek(file, 0, SEEK_END);
-  size_t size = ftell(file);
-  std::unique_ptr<char[]> d(new char[size + 1]);
-  fseek(file, 0, SEEK_SET);
-  fread(d.get(), size, 1, file);
-  fclose(file);
-
-  std::unique_ptr<GRPCONV> conv(
-      GRPCONV::AssignConverter(d.get(), size, "???"));
-  if (conv == 0) {
-    throw SystemError("Failure in GRPCONV.");
-  }
-  // do not free until SDL_FreeSurface() is called on the surface using it
-  char* mem = (char*)malloc(conv->Width() * conv->Height() * 4 + 1024);
+std::shared_ptr<const Surface> SDLGraphicsSystem::BuildSurfaceFromImage(
+    const std::string& short_filename,
+    const DecodedImage& image) {
   SDL_Surface* s = 0;
-  if (conv->Read(mem)) {
-    MaskType is_mask = conv->IsMask() ? ALPHA_MASK : NO_MASK;
-    if (is_mask == ALPHA_MASK) {
-      int len = conv->Width() * conv->Height();
-      unsigned int* d = (unsigned int*)mem;
-      int i;
-      for (i = 0; i < len; i++) {
-        if ((*d & 0xff000000) != 0xff000000)
-          break;
-        d++;
-      }
-      if (i == len) {
-        is_mask = NO_MASK;
-      }
-    }
-
-    s = newSurfaceFromRGBAData(conv->Width(), conv->Height(), mem, is_mask);
-  }
-  free(mem);
-
-  // Grab the Type-2 information out of the converter or create one
-  // default region if none exist
-  std::vector<SDLSurface::GrpRect> region_table;
-  if (conv->region_table.size()) {
-    std::transform(conv->region_table.begin(),
-                   conv->region_table.end(),
-                   std::back_inserter(region_table),
-                   xclannadRegionToGrpRect);
-  } else {
-    SDLSurface::GrpRect rect;
-    rect.rect = Rect(Point(0, 0), Size(conv->Width(), conv->Height()));
-    rect.originX = 0;
-    rect.originY = 0;
-    region_table.push_back(rect);
+  if (image.data()) {
+    s = newSurfaceFromRGBAData(image.size.width(),
+                               image.size.height(),
+                               image.data(),
+                               image.has_alpha ? ALPHA_MASK : NO_MASK);
   }
 
   std::shared_ptr<Surface> surface_to_ret(
-      new SDLSurface(this, s, region_table));
+      new SDLSurface(this, s, image.region_table));
   // handle tone curve effect loading
   if (short_filename.find("?") != short_filename.npos) {
     std::string effect_no_str =
@@ -655,7 +674,7 @@ std::shared_ptr<const Surface> SDLGraphicsSystem::LoadSurfaceFromFile(
     }
     surface_to_ret.get()->ToneCurve(
         globals().tone_curves.GetEffect(effect_no / 10 - 1),
-        Rect(Point(0, 0), Size(conv->Width(), conv->Height())));
+        Rect(Point(0, 0), image.size));
   }
 
   return surface_to_ret;
@@ -81,6 +81,9 @@ class SDLGraphicsSystem : public GraphicsSystem, public NotificationObserver {
 
   virtual std::shared_ptr<const Surface> LoadSurfaceFromFile(
       const std::string& short_filename) override;
+  virtual std::shared_ptr<const Surface> BuildSurfaceFromImage(
+      const std::string& short_filename,
+      const DecodedImage& image) override;
 
   virtual std::shared_ptr<Surface> GetHaikei() override;
   virtual std::shared_ptr<Surface> GetDC(int dc) override;
@@ -99,9 +102,22 @@ class SDLGraphicsSystem : public GraphicsSystem, public NotificationObserver {
   // game.
   virtual void Reset() override;
 
+ protected:
+  // GraphicsSystem:
+  virtual bool CanRedrawDamageOnly() const override;
+  virtual void RestoreLastFrame() override;
+  virtual void SetScreenClip(const Rect& area) override;
+  virtual void ClearScreenClip() override;
+
  private:
   void SetupVideo();
 
+  // Draws |screen_contents_texture_| over the whole screen.
+  void DrawLastFrameTexture();
+
+  // Outlines the areas the frame being finished redrew.
+  void DrawScreenDamage();
+
   // Makes sure that a passed in dc number is valid.
   //
   // @exception Error Throws when dc is greater then the maximum.
@@ -146,14 +162,20 @@ class SDLGraphicsSystem : public GraphicsSystem, public NotificationObserver {
   // memory leak in PulseAudio.
   std::string currently_set_title_;
 
-  // Texture used to store the contents of the screen while in DrawManual()
-  // mode. The stored image is then used if we need to redraw in the
-  // intervening time (expose events, mouse cursor moves, etc).
+  // Texture used to store the contents of the screen after each Refresh(),
+  // and after every frame while in DrawManual() mode. Refresh() draws only
+  // what changed on top of it, and in DrawManual() mode it's used if we need
+  // to redraw in the intervening time (expose events, mouse cursor moves,
+  // etc).
   GLuint screen_contents_texture_;
 
   // Whether |screen_contents_texture_| is valid to use.
   bool screen_contents_texture_valid_;
 
+  // Whether |screen_contents_texture_| holds the last frame Refresh() drew, as
+  // opposed to an effect's frame or nothing at all.
+  bool screen_contents_texture_refreshed_;
+
   // The size of |screen_contents_texture_|. This can be different
   // from |screen_size_| because textures need to be powers of two on
   // OpenGL v1.x drivers.
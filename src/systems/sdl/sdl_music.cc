@@ -50,6 +50,7 @@ const int STOP_NOW = -2;
 const int DEFAULT_FADE_MS = 10;
 
 std::shared_ptr<SDLMusic> SDLMusic::s_currently_playing;
+std::shared_ptr<SDLMusic> SDLMusic::s_finished_playing;
 bool SDLMusic::s_bgm_enabled = true;
 int SDLMusic::s_computed_bgm_vol = 128;
 
@@ -58,22 +59,27 @@ int SDLMusic::s_computed_bgm_vol = 128;
 // -----------------------------------------------------------------------
 
 SDLMusic::SDLMusic(const SoundSystem::DSTrack& track, WAVFILE* wav)
-    : file_(wav),
-      track_(track),
+    : track_(track),
       fadetime_total_(0),
       fade_in_ms_(0),
+      loop_point_(STOP_AT_END),
       music_paused_(false) {
   // Advance the audio stream to the starting point
   if (track.from > 0)
     wav->Seek(track.from);
+
+  stream_.reset(new MusicStream(wav));
 }
 
 SDLMusic::~SDLMusic() {
-  SDLAudioLocker locker;
-  delete file_;
+  {
+    SDLAudioLocker locker;
+    if (s_currently_playing.get() == this)
+      s_currently_playing.reset();
+  }
 
-  if (s_currently_playing.get() == this)
-    s_currently_playing.reset();
+  // Joins the decoder thread, so never with the audio callback locked out.
+  stream_.reset();
 }
 
 bool SDLMusic::IsLooping() const {
@@ -89,12 +95,21 @@ bool SDLMusic::IsFading() const {
 void SDLMusic::Play(bool loop) { FadeIn(loop, DEFAULT_FADE_MS); }
 
 void SDLMusic::Stop() {
-  SDLAudioLocker locker;
-  if (s_currently_playing.get() == this)
-    s_currently_playing.reset();
+  std::shared_ptr<SDLMusic> stopped;
+  {
+    SDLAudioLocker locker;
+    if (s_currently_playing.get() == this)
+      stopped.swap(s_currently_playing);
+  }
 }
 
 void SDLMusic::FadeIn(bool loop, int fade_in_ms) {
+  // Outside the lock: this waits for the start of the track to be decoded.
+  stream_->Start(loop ? track_.loop : MusicStream::kStopAtEnd);
+
+  // Swapped with whatever was playing, which is then released after the lock
+  // since that may join its decoder thread.
+  std::shared_ptr<SDLMusic> previous = shared_from_this();
   SDLAudioLocker locker;
 
   if (loop)
@@ -104,7 +119,7 @@ void SDLMusic::FadeIn(bool loop, int fade_in_ms) {
 
   fade_count_ = 0;
   fade_in_ms_ = fade_in_ms;
-  s_currently_playing = shared_from_this();
+  s_currently_playing.swap(previous);
 }
 
 void SDLMusic::FadeOut(int fade_out_ms) {
@@ -146,53 +161,65 @@ void SDLMusic::MixMusic(void* udata, Uint8* stream, int len) {
   // Inside an SDL_LockAudio() section set up by SDL_Mixer! Don't lock here!
   SDLMusic* music = s_currently_playing.get();
 
-  int count;
   if (!s_bgm_enabled || !music || music->music_paused_) {
     memset(stream, 0, len);
     return;
   }
-  count = music->file_->Read((char*)stream, 4, len / 4);
 
-  if (count != len / 4) {
+  // Loop points are handled by the decoder thread, so a short read is either
+  // the end of the track or an underrun.
+  int frames = len / 4;
+  int count = music->stream_->Read(reinterpret_cast<char*>(stream), frames);
+  if (count != frames)
     memset(stream + count * 4, 0, len - count * 4);
-    if (music->loop_point_ == STOP_AT_END) {
-      music->loop_point_ = STOP_NOW;
-      s_currently_playing.reset();
-    } else {
-      music->file_->Seek(music->loop_point_);
-      music->file_->Read((char*)(stream + count * 4), 4, len / 4 - count);
-    }
+
+  if (!music->ApplyVolume(stream, count) || music->stream_->at_end()) {
+    music->loop_point_ = STOP_NOW;
+    // This may be the last reference, so hand the track to the game thread
+    // instead of dropping it here. If the last one hasn't been collected yet,
+    // keep playing silence and try again next callback.
+    if (!s_finished_playing)
+      s_finished_playing = std::move(s_currently_playing);
   }
+}
 
-  int cur_vol = s_computed_bgm_vol;
-  // Compute in fadetime results.
-  if (music->fade_in_ms_) {
-    int count_total = music->fade_in_ms_ * (WAVFILE::freq / 1000);
-    if (music->fade_count_ > count_total) {
-      music->fade_in_ms_ = 0;
-    } else {
-      cur_vol = cur_vol * (music->fade_count_) / count_total;
-      music->fade_count_ += len / 4;
-    }
-  } else if (music->fadetime_total_) {
-    int count_total = music->fadetime_total_ * (WAVFILE::freq / 1000);
-    if (music->fade_count_ > count_total) {
-      music->loop_point_ = STOP_NOW;
-      s_currently_playing.reset();
-      memset(stream, 0, len);
-      return;
+// static
+void SDLMusic::ReleaseFinishedMusic() {
+  std::shared_ptr<SDLMusic> finished;
+  {
+    SDLAudioLocker locker;
+    finished.swap(s_finished_playing);
+  }
+}
+
+bool SDLMusic::ApplyVolume(Uint8* stream, int frames) {
+  int volume = s_computed_bgm_vol;
+  int fade_ms = fade_in_ms_ ? fade_in_ms_ : fadetime_total_;
+  if (!fade_ms && volume == SDL_MIX_MAXVOLUME)
+    return true;
+
+  int count_total = fade_ms * (WAVFILE::freq / 1000);
+  Sint16* samples = reinterpret_cast<Sint16*>(stream);
+  for (int i = 0; i < frames; ++i) {
+    int cur_vol = volume;
+    if (fade_in_ms_) {
+      if (fade_count_ > count_total)
+        fade_in_ms_ = 0;
+      else
+        cur_vol = volume * fade_count_++ / count_total;
+    } else if (fadetime_total_) {
+      if (fade_count_ > count_total) {
+        memset(samples + i * 2, 0, (frames - i) * 4);
+        return false;
+      }
+      cur_vol = volume * (count_total - fade_count_++) / count_total;
     }
 
-    cur_vol = cur_vol * (count_total - music->fade_count_) / count_total;
-    music->fade_count_ += len / 4;
+    samples[i * 2] = samples[i * 2] * cur_vol / SDL_MIX_MAXVOLUME;
+    samples[i * 2 + 1] = samples[i * 2 + 1] * cur_vol / SDL_MIX_MAXVOLUME;
   }
 
-  if (cur_vol != SDL_MIX_MAXVOLUME) {
-    char stream_dup[len];  // NOLINT
-    memcpy(stream_dup, stream, len);
-    memset(stream, 0, len);
-    SDL_MixAudio(stream, (Uint8*)stream_dup, len, cur_vol);
-  }
+  return true;
 }
 
 template <typename TYPE>
@@ -33,6 +33,7 @@
 #include <memory>
 #include <string>
 
+#include "systems/base/music_stream.h"
 #include "systems/base/sound_system.h"
 #include "xclannad/wavfile.h"
 
@@ -90,6 +91,10 @@ class SDLMusic : public std::enable_shared_from_this<SDLMusic> {
   // Whether music is currently playing.
   static bool IsCurrentlyPlaying() { return s_currently_playing.get(); }
 
+  // Drops the track that finished on the audio thread. Called from the game
+  // thread, since destroying a track joins its decoder thread.
+  static void ReleaseFinishedMusic();
+
   // Whether we should output music.
   static void SetBgmEnabled(const int in) { s_bgm_enabled = in; }
 
@@ -104,20 +109,26 @@ class SDLMusic : public std::enable_shared_from_this<SDLMusic> {
 
   // Callback function to Mix_HookMusic.
   //
-  // This function was ripped off almost verbatim from xclannad! Specifically
-  // the static method WavChunk::callback in music2/music.cc.
+  // This function started out as xclannad's WavChunk::callback in
+  // music2/music.cc. It no longer decodes anything: it copies frames |stream_|
+  // decoded ahead and applies the volume and fades.
   static void MixMusic(void* udata, Uint8* stream, int len);
 
+  // Scales the |frames| frames in |stream| by the volume, fading in or out one
+  // frame at a time. Returns false once a fade out has finished.
+  bool ApplyVolume(Uint8* stream, int frames);
+
   // Strongly coupled because of access to SDLMusic::MixMusic.
   friend class SDLSoundSystem;
 
-  // Underlying data stream. (These classes stolen from xclannad.)
-  WAVFILE* file_;
+  // Underlying data stream, decoded on its own thread. (The decoders are
+  // stolen from xclannad.)
+  std::unique_ptr<MusicStream> stream_;
 
   // The underlying track information
   const SoundSystem::DSTrack& track_;
 
-  // No idea.
+  // Frames played since the current fade started.
   int fade_count_;
 
   // Number of milliseconds left to fade out the
@@ -135,6 +146,10 @@ class SDLMusic : public std::enable_shared_from_this<SDLMusic> {
   // The currently playing track.
   static std::shared_ptr<SDLMusic> s_currently_playing;
 
+  // A track MixMusic() took out of |s_currently_playing| when it ended,
+  // waiting for ReleaseFinishedMusic().
+  static std::shared_ptr<SDLMusic> s_finished_playing;
+
   // Whether we should even be playing music.
   static bool s_bgm_enabled;
 
@@ -31,16 +31,23 @@
 #include <SDL/SDL_mixer.h>
 #include <boost/algorithm/string/case_conv.hpp>
 #include <boost/algorithm/string/predicate.hpp>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iterator>
 #include <sstream>
 #include <string>
+#include <vector>
 
+#include "systems/base/audio_mixer.h"
+#include "systems/base/ovk_voice_sample.h"
 #include "systems/base/system.h"
 #include "systems/base/system_error.h"
 #include "systems/base/voice_archive.h"
 #include "systems/sdl/resample.h"
 #include "systems/sdl/sdl_music.h"
-#include "systems/sdl/sdl_sound_chunk.h"
 #include "utilities/exception.h"
+#include "xclannad/wavfile.h"
 
 namespace fs = boost::filesystem;
 
@@ -65,14 +72,40 @@ static RealLiveSoundQualities s_real_live_sound_qualities[] = {
     {48000, AUDIO_S16}   // 48 h_kz, 16 bit stereo
 };
 
+// Changes an incoming RealLive volume (0-256) to the mixer's gain.
+static float RealLiveVolumeToGain(int in_vol) { return in_vol / 256.0f; }
+
+// Adds |sample| to the device sample at |out|, saturating.
+static void AddToDeviceSample(Uint16 format, Uint8* out, float sample) {
+  switch (format) {
+    case AUDIO_S16SYS: {
+      Sint16* p = reinterpret_cast<Sint16*>(out);
+      long sum = *p + std::lrint(sample * 32768.0f);
+      *p = static_cast<Sint16>(std::min(32767L, std::max(-32768L, sum)));
+      break;
+    }
+    case AUDIO_S8: {
+      Sint8* p = reinterpret_cast<Sint8*>(out);
+      long sum = *p + std::lrint(sample * 128.0f);
+      *p = static_cast<Sint8>(std::min(127L, std::max(-128L, sum)));
+      break;
+    }
+    case AUDIO_U8: {
+      long sum = *out + std::lrint(sample * 128.0f);
+      *out = static_cast<Uint8>(std::min(255L, std::max(0L, sum)));
+      break;
+    }
+  }
+}
+
 // -----------------------------------------------------------------------
 // SDLSoundSystem (private)
 // -----------------------------------------------------------------------
-SDLSoundSystem::SDLSoundChunkPtr SDLSoundSystem::GetSoundChunk(
+SDLSoundSystem::AudioClipPtr SDLSoundSystem::GetClip(
     const std::string& file_name,
-    SoundChunkCache& cache) {
-  SDLSoundChunkPtr sample = cache.fetch(file_name);
-  if (sample == NULL) {
+    ClipCache& cache) {
+  AudioClipPtr clip = cache.fetch(file_name);
+  if (clip == NULL) {
     fs::path file_path = system().FindFile(file_name, SOUND_FILETYPES);
     if (file_path.empty()) {
       std::ostringstream oss;
@@ -80,33 +113,111 @@ SDLSoundSystem::SDLSoundChunkPtr SDLSoundSystem::GetSoundChunk(
       throw rlvm::Exception(oss.str());
     }
 
-    sample.reset(new SDLSoundChunk(file_path));
-    cache.insert(file_name, sample);
+    clip = LoadClip(file_path);
+    cache.insert(file_name, clip);
+  }
+
+  return clip;
+}
+
+SDLSoundSystem::AudioClipPtr SDLSoundSystem::LoadClip(const fs::path& path) {
+  std::string extension = boost::to_lower_copy(path.extension().string());
+  std::shared_ptr<AudioClip> clip;
+  if (extension == ".nwa") {
+    FILE* f = fopen(path.native().c_str(), "rb");
+    if (f) {
+      int size = 0;
+      std::unique_ptr<char[]> data(NWAFILE::ReadAll(f, size));
+      fclose(f);
+      if (data)
+        clip = LoadWavClip(data.get(), size, mixer_->rate());
+    }
+  } else if (extension == ".ogg") {
+    int size = 0;
+    std::unique_ptr<char[]> data(OVKVoiceSample(path).Decode(&size));
+    if (data)
+      clip = LoadWavClip(data.get(), size + WAV_HEADER_SIZE, mixer_->rate());
+  } else {
+    std::ifstream file(path.native().c_str(), std::ios::binary);
+    std::vector<char> data((std::istreambuf_iterator<char>(file)),
+                           std::istreambuf_iterator<char>());
+    clip = LoadWavClip(data.data(), data.size(), mixer_->rate());
+  }
+
+  // Anything else SDL_mixer can read (compressed WAVs, VOC, AIFF) comes back
+  // already converted to the device format.
+  Mix_Chunk* chunk = clip ? NULL : Mix_LoadWAV(path.native().c_str());
+  if (chunk) {
+    int sample_size = (device_format_ & 0xff) / 8;
+    int frames = chunk->alen / (sample_size * device_channels_);
+    std::vector<int16_t> pcm(frames * device_channels_);
+    for (size_t i = 0; i < pcm.size(); ++i) {
+      if (device_format_ == AUDIO_S16SYS)
+        pcm[i] = reinterpret_cast<const Sint16*>(chunk->abuf)[i];
+      else if (device_format_ == AUDIO_S8)
+        pcm[i] = reinterpret_cast<const Sint8*>(chunk->abuf)[i] * 256;
+      else
+        pcm[i] = (chunk->abuf[i] - 128) * 256;
+    }
+    Mix_FreeChunk(chunk);
+    clip = AudioClip::FromPCM16(pcm.data(), frames, device_channels_);
   }
 
-  return sample;
+  if (!clip) {
+    std::ostringstream oss;
+    oss << "Could not decode sound file \"" << path.string() << "\".";
+    throw rlvm::Exception(oss.str());
+  }
+  return clip;
 }
 
-SDLSoundSystem::SDLSoundChunkPtr SDLSoundSystem::BuildKoeChunk(char* data,
-                                                               int length) {
-  return SDLSoundChunkPtr(new SDLSoundChunk(data, length));
+// static
+void SDLSoundSystem::MixChannels(void* udata, Uint8* stream, int len) {
+  SDLSoundSystem* sound_system = static_cast<SDLSoundSystem*>(udata);
+  AudioMixer& mixer = *sound_system->mixer_;
+  const Uint16 format = sound_system->device_format_;
+  const int channels = sound_system->device_channels_;
+
+  if (format == AUDIO_S16SYS && channels == 2) {
+    mixer.MixIntoS16(reinterpret_cast<int16_t*>(stream), len / 4);
+    return;
+  }
+
+  // Other devices go through the float bus a block at a time.
+  const int sample_size = (format & 0xff) / 8;
+  int frames = len / (sample_size * channels);
+  float* bus = sound_system->mix_buffer_.data();
+  while (frames > 0) {
+    int block = frames < AudioMixer::kMaxBlockFrames
+                    ? frames
+                    : AudioMixer::kMaxBlockFrames;
+    mixer.Mix(bus, block);
+    for (int i = 0; i < block; ++i) {
+      for (int c = 0; c < channels; ++c) {
+        float sample = channels == 1 ? (bus[i * 2] + bus[i * 2 + 1]) * 0.5f
+                                     : c < 2 ? bus[i * 2 + c] : 0.0f;
+        AddToDeviceSample(format, stream, sample);
+        stream += sample_size;
+      }
+    }
+    frames -= block;
+  }
 }
 
 void SDLSoundSystem::WavPlayImpl(const std::string& wav_file,
                                  const int channel,
                                  bool loop) {
   if (is_pcm_enabled()) {
-    SDLSoundChunkPtr sample = GetSoundChunk(wav_file, wav_cache_);
+    AudioClipPtr clip = GetClip(wav_file, wav_cache_);
     SetChannelVolumeImpl(channel);
-    int loop_num = loop ? -1 : 0;
-    sample->PlayChunkOn(channel, loop_num);
+    mixer_->Play(channel, clip, loop);
   }
 }
 
 void SDLSoundSystem::SetChannelVolumeImpl(int channel) {
   int base = channel == KOE_CHANNEL ? GetKoeVolume_mod() : pcm_volume_mod();
   int adjusted = compute_channel_volume(GetChannelVolume(channel), base);
-  Mix_Volume(channel, realLiveVolumeToSDLMixerVolume(adjusted));
+  mixer_->SetVolume(channel, RealLiveVolumeToGain(adjusted));
 }
 
 std::shared_ptr<SDLMusic> SDLSoundSystem::LoadMusic(
@@ -152,22 +263,34 @@ SDLSoundSystem::SDLSoundSystem(System& system)
   }
 
   // Jagarl's sound system wants information on the audio settings.
-  int freq, channels;
-  Uint16 format;
+  int freq = audio_rate, channels = audio_channels;
+  Uint16 format = audio_format;
   if (Mix_QuerySpec(&freq, &format, &channels)) {
     WAVFILE::freq = freq;
     WAVFILE::format = format;
     WAVFILE::channels = channels;
   }
 
-  Mix_AllocateChannels(NUM_TOTAL_CHANNELS);
-
-  Mix_ChannelFinished(&SDLSoundChunk::SoundChunkFinishedPlayback);
+  // SDL_mixer's own channels go unused; everything but music goes through
+  // our mixer, which runs after the music hook.
+  Mix_AllocateChannels(0);
+  mixer_.reset(new AudioMixer(freq, NUM_TOTAL_CHANNELS));
+  device_format_ = format;
+  device_channels_ = channels;
+  mix_buffer_.resize(AudioMixer::kMaxBlockFrames * 2);
+  Mix_SetPostMix(&SDLSoundSystem::MixChannels, this);
+
+  // Voices are resampled to the mixer's rate when prefetched, on the voice
+  // cache's thread; the loader mustn't reach back into |this|.
+  voice_cache_.SetClipLoader([freq](const char* data, size_t size) {
+    return LoadWavClip(data, size, freq);
+  });
 
   SetMusicHook(NULL);
 }
 
 SDLSoundSystem::~SDLSoundSystem() {
+  Mix_SetPostMix(NULL, NULL);
   Mix_HookMusic(NULL, NULL);
 
   Mix_CloseAudio();
@@ -176,6 +299,8 @@ SDLSoundSystem::~SDLSoundSystem() {
 
 void SDLSoundSystem::ExecuteSoundSystem() {
   SoundSystem::ExecuteSoundSystem();
+  mixer_->CollectGarbage();
+  SDLMusic::ReleaseFinishedMusic();
 
   if (queued_music_ && !SDLMusic::IsCurrentlyPlaying()) {
     queued_music_->FadeIn(queued_music_loop_, queued_music_fadein_);
@@ -209,7 +334,15 @@ void SDLSoundSystem::SetChannelVolume(const int channel, const int level) {
 }
 
 void SDLSoundSystem::WavPlay(const std::string& wav_file, bool loop) {
-  int channel_number = SDLSoundChunk::FindNextFreeExtraChannel();
+  int channel_number = -1;
+  for (int i = NUM_BASE_CHANNELS;
+       i < NUM_BASE_CHANNELS + NUM_EXTRA_WAVPLAY_CHANNELS;
+       ++i) {
+    if (!mixer_->IsPlaying(i)) {
+      channel_number = i;
+      break;
+    }
+  }
   if (channel_number == -1) {
     std::ostringstream oss;
     oss << "Couldn't find a free channel for wavPlay()";
@@ -233,30 +366,28 @@ void SDLSoundSystem::WavPlay(const std::string& wav_file,
   CheckChannel(channel, "SDLSoundSystem::wav_play");
 
   if (is_pcm_enabled()) {
-    SDLSoundChunkPtr sample = GetSoundChunk(wav_file, wav_cache_);
+    AudioClipPtr clip = GetClip(wav_file, wav_cache_);
     SetChannelVolumeImpl(channel);
-
-    int loop_num = loop ? -1 : 0;
-    sample->FadeInChunkOn(channel, loop_num, fadein_ms);
+    mixer_->Play(channel, clip, loop, fadein_ms);
   }
 }
 
 bool SDLSoundSystem::WavPlaying(const int channel) {
   CheckChannel(channel, "SDLSoundSystem::wav_playing");
-  return Mix_Playing(channel);
+  return mixer_->IsPlaying(channel);
 }
 
 void SDLSoundSystem::WavStop(const int channel) {
   CheckChannel(channel, "SDLSoundSystem::wav_stop");
 
   if (is_pcm_enabled()) {
-    SDLSoundChunk::StopChannel(channel);
+    mixer_->Stop(channel);
   }
 }
 
 void SDLSoundSystem::WavStopAll() {
   if (is_pcm_enabled()) {
-    SDLSoundChunk::StopAllChannels();
+    mixer_->StopAll();
   }
 }
 
@@ -264,7 +395,7 @@ void SDLSoundSystem::WavFadeOut(const int channel, const int fadetime) {
   CheckChannel(channel, "SDLSoundSystem::wav_fade_out");
 
   if (is_pcm_enabled())
-    SDLSoundChunk::FadeOut(channel, fadetime);
+    mixer_->FadeOut(channel, fadetime);
 }
 
 void SDLSoundSystem::PlaySe(const int se_num) {
@@ -279,19 +410,18 @@ void SDLSoundSystem::PlaySe(const int se_num) {
     const std::string& file_name = it->second.first;
     int channel = it->second.second;
 
-    // Make sure there isn't anything playing on the current channel
-    Mix_HaltChannel(channel);
-
     if (file_name == "") {
       // Just stop a channel in case of an empty file name.
+      mixer_->Stop(channel);
       return;
     }
 
-    SDLSoundChunkPtr sample = GetSoundChunk(file_name, wav_cache_);
+    AudioClipPtr clip = GetClip(file_name, wav_cache_);
 
-    // SE chunks have no volume other than the modifier.
-    Mix_Volume(channel, realLiveVolumeToSDLMixerVolume(se_volume_mod()));
-    sample->PlayChunkOn(channel, 0);
+    // SE clips have no volume other than the modifier. Playing replaces
+    // whatever was on the channel.
+    mixer_->SetVolume(channel, RealLiveVolumeToGain(se_volume_mod()));
+    mixer_->Play(channel, clip, false);
   }
 }
 
@@ -378,40 +508,26 @@ bool SDLSoundSystem::BgmLooping() const {
     return false;
 }
 
-bool SDLSoundSystem::KoePlaying() const { return Mix_Playing(KOE_CHANNEL); }
+bool SDLSoundSystem::KoePlaying() const {
+  return mixer_->IsPlaying(KOE_CHANNEL);
+}
 
-void SDLSoundSystem::KoeStop() { SDLSoundChunk::StopChannel(KOE_CHANNEL); }
+void SDLSoundSystem::KoeStop() { mixer_->Stop(KOE_CHANNEL); }
 
 void SDLSoundSystem::KoePlayImpl(int id) {
   if (!is_koe_enabled()) {
     return;
   }
 
-  // Get the VoiceSample.
-  std::shared_ptr<VoiceSample> sample = voice_cache_.Find(id);
-  if (!sample) {
+  AudioClipPtr koe = voice_cache_.LoadClip(id);
+  if (!koe) {
     std::ostringstream oss;
     oss << "No sample for " << id;
     throw std::runtime_error(oss.str());
   }
 
-  int length;
-  char* data = sample->Decode(&length);
-
-  // TODO(erg): SDL is supposed to have a real resampler, but doesn't, so for
-  // example, 48k -> 41k is at best tone shifted, and at worst, is a pure
-  // static. So we have to do our own manual resampling.
-  //
-  // The correct way to deal with this is to move off SDL's audio subsystem
-  // entirely or to contribute upstream to SDL so that its default behaviour is
-  // sane. There's no time left to do either of those, as there's a fairly
-  // hard deadline of 9/11 for the birthday release, and this is the last
-  // blocker.
-  data = EnsureDataIsCorrectBitrate(data, &length);
-
-  SDLSoundChunkPtr koe = BuildKoeChunk(data, length);
   SetChannelVolumeImpl(KOE_CHANNEL);
-  koe->PlayChunkOn(KOE_CHANNEL, 0);
+  mixer_->Play(KOE_CHANNEL, koe, false);
 }
 
 void SDLSoundSystem::Reset() {
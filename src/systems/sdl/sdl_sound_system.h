@@ -33,11 +33,13 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "systems/base/sound_system.h"
 #include "lru_cache.hpp"
 
-class SDLSoundChunk;
+class AudioClip;
+class AudioMixer;
 class SDLMusic;
 
 class SDLSoundSystem : public SoundSystem {
@@ -93,21 +95,23 @@ class SDLSoundSystem : public SoundSystem {
   void SetMusicHook(void (*mix_func)(void* udata, Uint8* stream, int len));
 
  private:
-  typedef std::shared_ptr<SDLSoundChunk> SDLSoundChunkPtr;
+  typedef std::shared_ptr<const AudioClip> AudioClipPtr;
   typedef std::shared_ptr<SDLMusic> SDLMusicPtr;
-  typedef LRUCache<std::string, SDLSoundChunkPtr> SoundChunkCache;
+  typedef LRUCache<std::string, AudioClipPtr> ClipCache;
 
   virtual void KoePlayImpl(int id) override;
 
-  // Retrieves a sound chunk from the passed in cache (or loads it if
-  // it's not in the cache and then stuffs it into the cache.)
-  SDLSoundChunkPtr GetSoundChunk(const std::string& file_name,
-                                 SoundChunkCache& cache);
+  // Retrieves a clip from the passed in cache (or loads it if it's not in the
+  // cache and then stuffs it into the cache.)
+  AudioClipPtr GetClip(const std::string& file_name, ClipCache& cache);
 
-  // Builds a SoundChunk from a piece of memory. This is used for playing
-  // voice. These chunks are not put in a SoundChunkCache since there's no
-  // string to cache on.
-  static SDLSoundChunkPtr BuildKoeChunk(char* data, int length);
+  // Loads |path| as a clip at the device's rate. Throws if it can't be
+  // decoded.
+  AudioClipPtr LoadClip(const boost::filesystem::path& path);
+
+  // SDL_mixer post mix callback: adds |mixer_|'s channels on top of the
+  // music SDL_mixer has already written to |stream|.
+  static void MixChannels(void* udata, Uint8* stream, int len);
 
   // Implementation to play a wave file. Two wavPlay() versions use this
   // underlying implementation, which is split out so the one that takes a raw
@@ -117,15 +121,25 @@ class SDLSoundSystem : public SoundSystem {
   // |channel|.
   void WavPlayImpl(const std::string& wav_file, const int channel, bool loop);
 
-  // Computes and passes a volume to SDL_mixer for |channel|.
+  // Computes and passes a volume to the mixer for |channel|.
   void SetChannelVolumeImpl(int channel);
 
   // Creates an SDLMusic object from a name. Throws if the bgm isn't
   // found.
   std::shared_ptr<SDLMusic> LoadMusic(const std::string& bgm_name);
 
-  SoundChunkCache se_cache_;
-  SoundChunkCache wav_cache_;
+  // Mixes the wav, se and koe channels; SDL_mixer only drives the device
+  // and the music hook.
+  std::unique_ptr<AudioMixer> mixer_;
+
+  // The device's sample format and channel count, and float scratch space
+  // for devices MixIntoS16() can't write to directly.
+  Uint16 device_format_;
+  int device_channels_;
+  std::vector<float> mix_buffer_;
+
+  ClipCache se_cache_;
+  ClipCache wav_cache_;
 
   // The music to play next as soon as the current track finishes.
   SDLMusicPtr queued_music_;
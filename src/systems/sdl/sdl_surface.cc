@@ -35,14 +35,44 @@
 #include "base/notification_source.h"
 #include "pygame/alphablit.h"
 #include "systems/base/colour.h"
+#include "systems/base/colour_transform.h"
 #include "systems/base/graphics_object.h"
 #include "systems/base/graphics_object_data.h"
+#include "systems/base/pixel_blitter.h"
 #include "systems/base/system_error.h"
 #include "systems/sdl/sdl_graphics_system.h"
 #include "systems/sdl/sdl_utils.h"
 #include "systems/sdl/texture.h"
 #include "utilities/graphics.h"
 
+// Note to self: These describe the byte order IN THE RAW G00 DATA!
+// These should NOT be switched to native byte order.
+#define DefaultRmask 0xff0000
+#define DefaultGmask 0xff00
+#define DefaultBmask 0xff
+#define DefaultAmask 0xff000000
+#define DefaultBpp 32
+
+// Whether |surface| is laid out the way BlitPixels() and the colour
+// transforms expect: 32-bit ARGB,
+// with or without the alpha channel, directly addressable and without a
+// colour key.
+static bool canBlitNatively(const SDL_Surface* surface) {
+  const SDL_PixelFormat* format = surface->format;
+  return format->BytesPerPixel == 4 && format->Rmask == DefaultRmask &&
+         format->Gmask == DefaultGmask && format->Bmask == DefaultBmask &&
+         (format->Amask == DefaultAmask || format->Amask == 0) &&
+         !(surface->flags & SDL_SRCCOLORKEY) && !SDL_MUSTLOCK(surface);
+}
+
+static PixelBuffer toPixelBuffer(SDL_Surface* surface) {
+  return PixelBuffer(static_cast<char*>(surface->pixels),
+                     Size(surface->w, surface->h),
+                     surface->pitch);
+}
+
+// -----------------------------------------------------------------------
+
 namespace {
 
 // An interface to TransformSurface that maps one color to another.
@@ -50,6 +80,11 @@ class ColourTransformer {
  public:
   virtual ~ColourTransformer() {}
   virtual SDL_Color operator()(const SDL_Color& colour) const = 0;
+
+  // Does the same to every pixel of |area| at once, on surfaces in the
+  // native format.
+  virtual void TransformPixels(const PixelBuffer& buffer,
+                               const Rect& area) const = 0;
 };
 
 class ToneCurveColourTransformer : public ColourTransformer {
@@ -61,6 +96,11 @@ class ToneCurveColourTransformer : public ColourTransformer {
     return out;
   }
 
+  virtual void TransformPixels(const PixelBuffer& buffer,
+                               const Rect& area) const {
+    ToneCurvePixels(buffer, area, colormap);
+  }
+
  private:
   ToneCurveRGBMap colormap;
 };
@@ -71,6 +111,11 @@ class InvertColourTransformer : public ColourTransformer {
     SDL_Color out = {255 - colour.r, 255 - colour.g, 255 - colour.b, 0};
     return out;
   }
+
+  virtual void TransformPixels(const PixelBuffer& buffer,
+                               const Rect& area) const {
+    InvertPixels(buffer, area);
+  }
 };
 
 class MonoColourTransformer : public ColourTransformer {
@@ -81,6 +126,11 @@ class MonoColourTransformer : public ColourTransformer {
     SDL_Color out = {grayscale, grayscale, grayscale, 0};
     return out;
   }
+
+  virtual void TransformPixels(const PixelBuffer& buffer,
+                               const Rect& area) const {
+    MonoPixels(buffer, area);
+  }
 };
 
 class ApplyColourTransformer : public ColourTransformer {
@@ -109,6 +159,11 @@ class ApplyColourTransformer : public ColourTransformer {
     return out;
   }
 
+  virtual void TransformPixels(const PixelBuffer& buffer,
+                               const Rect& area) const {
+    ApplyColourPixels(buffer, area, colour_);
+  }
+
  private:
   RGBColour colour_;
 };
@@ -118,6 +173,12 @@ void TransformSurface(SDLSurface* our_surface,
                       const Rect& area,
                       const ColourTransformer& transformer) {
   SDL_Surface* surface = our_surface->rawSurface();
+  if (canBlitNatively(surface)) {
+    transformer.TransformPixels(toPixelBuffer(surface), area);
+    our_surface->markWrittenTo(our_surface->GetRect());
+    return;
+  }
+
   SDL_Color colour;
   Uint32 col = 0;
 
@@ -166,14 +227,6 @@ void TransformSurface(SDLSurface* our_surface,
 
 // -----------------------------------------------------------------------
 
-// Note to self: These describe the byte order IN THE RAW G00 DATA!
-// These should NOT be switched to native byte order.
-#define DefaultRmask 0xff0000
-#define DefaultGmask 0xff00
-#define DefaultBmask 0xff
-#define DefaultAmask 0xff000000
-#define DefaultBpp 32
-
 SDL_Surface* buildNewSurface(const Size& size) {
   // Create an empty surface
   SDL_Surface* tmp = SDL_CreateRGBSurface(SDL_SWSURFACE | SDL_SRCALPHA,
@@ -250,6 +303,12 @@ void SDLSurface::TextureRecord::reupload(SDL_Surface* surface,
 
 void SDLSurface::TextureRecord::forceUnload() { texture.reset(); }
 
+// -----------------------------------------------------------------------
+
+size_t SDLSurface::TextureRecord::memoryUsage() const {
+  return texture ? static_cast<size_t>(w_) * h_ * bytes_per_pixel_ : 0;
+}
+
 // -----------------------------------------------------------------------
 // SDLSurface
 // -----------------------------------------------------------------------
@@ -312,6 +371,32 @@ void SDLSurface::EnsureUploaded() const {
 
 // -----------------------------------------------------------------------
 
+size_t SDLSurface::GetMemoryUsage() const {
+  return surface_ ? static_cast<size_t>(surface_->pitch) * surface_->h : 0;
+}
+
+// -----------------------------------------------------------------------
+
+size_t SDLSurface::GetTextureMemoryUsage() const {
+  size_t bytes = 0;
+  for (const TextureRecord& record : textures_)
+    bytes += record.memoryUsage();
+  return bytes;
+}
+
+// -----------------------------------------------------------------------
+
+void SDLSurface::UnloadTextures() const {
+  for (TextureRecord& record : textures_)
+    record.forceUnload();
+
+  if (surface_)
+    dirty_rectangle_ = GetRect();
+  texture_is_valid_ = false;
+}
+
+// -----------------------------------------------------------------------
+
 void SDLSurface::registerForNotification(GraphicsSystem* system) {
   registrar_.Add(this,
                  NotificationType::FULLSCREEN_STATE_CHANGED,
@@ -389,6 +474,23 @@ void SDLSurface::BlitToSurface(Surface& dest_surface,
                                int alpha,
                                bool use_src_alpha) const {
   SDLSurface& sdl_dest_surface = dynamic_cast<SDLSurface&>(dest_surface);
+  SDL_Surface* dest = sdl_dest_surface.surface();
+
+  // Every surface we build ourselves takes this path; it produces the same
+  // pixels as the SDL/pygame blits below without the temporary surfaces.
+  if (canBlitNatively(surface_) && canBlitNatively(dest) &&
+      dest->format->Amask) {
+    BlitPixels(toPixelBuffer(surface_),
+               src,
+               toPixelBuffer(dest),
+               dst,
+               SurfaceBlitOptions(surface_->format->Amask != 0,
+                                  src.size() != dst.size(),
+                                  use_src_alpha,
+                                  alpha));
+    sdl_dest_surface.markWrittenTo(dst);
+    return;
+  }
 
   SDL_Rect src_rect, dest_rect;
   RectToSDLRect(src, &src_rect);
@@ -580,6 +682,9 @@ void SDLSurface::RenderToScreen(const Rect& src,
        ++it) {
     it->texture->RenderToScreen(src, dst, alpha);
   }
+
+  if (graphics_system_)
+    graphics_system_->RecordScreenDraw(dst);
 }
 
 // -----------------------------------------------------------------------
@@ -595,6 +700,9 @@ void SDLSurface::RenderToScreenAsColorMask(const Rect& src,
        ++it) {
     it->texture->RenderToScreenAsColorMask(src, dst, rgba, filter);
   }
+
+  if (graphics_system_)
+    graphics_system_->RecordScreenDraw(dst);
 }
 
 // -----------------------------------------------------------------------
@@ -609,6 +717,9 @@ void SDLSurface::RenderToScreen(const Rect& src,
        ++it) {
     it->texture->RenderToScreen(src, dst, opacity);
   }
+
+  if (graphics_system_)
+    graphics_system_->RecordScreenDraw(dst);
 }
 
 // -----------------------------------------------------------------------
@@ -624,6 +735,12 @@ void SDLSurface::RenderToScreenAsObject(const GraphicsObject& rp,
        ++it) {
     it->texture->RenderToScreenAsObject(rp, *this, src, dst, alpha);
   }
+
+  if (graphics_system_) {
+    // A rotated object can reach anywhere.
+    graphics_system_->RecordScreenDraw(
+        rp.rotation() ? graphics_system_->screen_rect() : dst);
+  }
 }
 
 // -----------------------------------------------------------------------
@@ -815,9 +932,10 @@ std::shared_ptr<Surface> SDLSurface::ClipAsColorMask(const Rect& clip_rect,
 // -----------------------------------------------------------------------
 
 void SDLSurface::markWrittenTo(const Rect& written_rect) {
-  // If we are marked as dc0, alert the SDLGraphicsSystem.
+  // If we are marked as dc0, alert the SDLGraphicsSystem. DC0 is drawn 1:1
+  // onto the screen, so only the written part of the screen changes.
   if (is_dc0_ && graphics_system_) {
-    graphics_system_->MarkScreenAsDirty(GUT_DRAW_DC0);
+    graphics_system_->MarkScreenAreaAsDirty(written_rect);
   }
 
   // Mark that the texture needs reuploading
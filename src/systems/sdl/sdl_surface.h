@@ -68,6 +68,9 @@ class SDLSurface : public Surface, public NotificationObserver {
   ~SDLSurface();
 
   virtual void EnsureUploaded() const override;
+  virtual size_t GetMemoryUsage() const override;
+  virtual size_t GetTextureMemoryUsage() const override;
+  virtual void UnloadTextures() const override;
 
   void registerForNotification(GraphicsSystem* system);
 
@@ -180,6 +183,9 @@ class SDLSurface : public Surface, public NotificationObserver {
     // fullscreen mode, so that we aren't holding stale references.
     void forceUnload();
 
+    // Bytes of texture memory this record holds; 0 when unloaded.
+    size_t memoryUsage() const;
+
     // The actual texture.
     std::shared_ptr<Texture> texture;
 
@@ -90,6 +90,7 @@ void SDLSystem::Run(RLMachine& machine) {
   event_system_->ExecuteEventSystem(machine);
   text_system_->ExecuteTextSystem();
   sound_system_->ExecuteSoundSystem();
+  sound_system_->PrefetchUpcomingVoices(machine);
   graphics_system_->ExecuteGraphicsSystem(machine);
 
   if (platform())
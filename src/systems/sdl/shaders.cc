@@ -26,6 +26,8 @@
 
 #include "GL/glew.h"
 
+#include <string>
+
 #ifndef NDEBUG
 #include <iostream>
 #endif
@@ -51,12 +53,6 @@ const char kColorMaskShader[] =
 
 const char kObjectShader[] =
     "uniform sampler2D image;\n"
-    "uniform vec4 colour;\n"
-    "uniform float mono;\n"
-    "uniform float invert;\n"
-    "uniform float light;\n"
-    "uniform vec3 tint;\n"
-    "uniform float alpha;\n"
     "\n"
     "void tinter(in float pixel_val, in float tint_val, out float mixed) {\n"
     "  if (tint_val > 0.0) {\n"
@@ -69,6 +65,14 @@ const char kObjectShader[] =
     "}\n"
     "\n"
     "void main() {\n"
+    "  // Per object settings; see Shaders::SetObjectAttributes().\n"
+    "  vec4 colour = gl_TexCoord[1];\n"
+    "  vec3 tint = gl_TexCoord[2].rgb;\n"
+    "  float light = gl_TexCoord[2].a;\n"
+    "  float mono = gl_TexCoord[3].r;\n"
+    "  float invert = gl_TexCoord[3].g;\n"
+    "  float alpha = gl_TexCoord[3].b;\n"
+    "\n"
     "  vec4 pixel = texture2D(image, gl_TexCoord[0].st);\n"
     "\n"
     "  // The colour is blended directly with the incoming pixel value.\n"
@@ -107,17 +111,7 @@ const char kObjectShader[] =
 }  // namespace
 
 GLuint Shaders::color_mask_program_object_id_ = 0;
-GLint Shaders::color_mask_current_values_ = 0;
-GLint Shaders::color_mask_mask_ = 0;
-
 GLuint Shaders::object_program_object_id_ = 0;
-GLint Shaders::object_image_ = 0;
-GLint Shaders::object_colour_ = 0;
-GLint Shaders::object_tint_ = 0;
-GLint Shaders::object_light_ = 0;
-GLint Shaders::object_alpha_ = 0;
-GLint Shaders::object_mono_ = 0;
-GLint Shaders::object_invert_ = 0;
 
 // static
 void Shaders::Reset() {
@@ -126,8 +120,6 @@ void Shaders::Reset() {
     DebugShowGLErrors();
 
     color_mask_program_object_id_ = 0;
-    color_mask_current_values_ = 0;
-    color_mask_mask_ = 0;
   }
 
   if (object_program_object_id_) {
@@ -135,13 +127,6 @@ void Shaders::Reset() {
     DebugShowGLErrors();
 
     object_program_object_id_ = 0;
-    object_image_ = 0;
-    object_colour_ = 0;
-    object_tint_ = 0;
-    object_light_ = 0;
-    object_alpha_ = 0;
-    object_mono_ = 0;
-    object_invert_ = 0;
   }
 }
 
@@ -149,129 +134,58 @@ void Shaders::Reset() {
 GLuint Shaders::getColorMaskProgram() {
   if (color_mask_program_object_id_ == 0) {
     buildShader(kColorMaskShader, &color_mask_program_object_id_);
+    bindSampler(color_mask_program_object_id_, "current_values", 0);
+    bindSampler(color_mask_program_object_id_, "mask", 1);
   }
 
   return color_mask_program_object_id_;
 }
 
-GLint Shaders::getColorMaskUniformCurrentValues() {
-  if (color_mask_current_values_ == 0) {
-    color_mask_current_values_ =
-        glGetUniformLocationARB(getColorMaskProgram(), "current_values");
-    if (color_mask_current_values_ == -1)
-      throw SystemError("Bad uniform value: current_values");
-  }
-
-  return color_mask_current_values_;
-}
-
-GLint Shaders::getColorMaskUniformMask() {
-  if (color_mask_mask_ == 0) {
-    color_mask_mask_ = glGetUniformLocationARB(getColorMaskProgram(), "mask");
-    if (color_mask_mask_ == -1)
-      throw SystemError("Bad uniform value: mask");
-  }
-
-  return color_mask_mask_;
-}
-
 GLuint Shaders::GetObjectProgram() {
   if (object_program_object_id_ == 0) {
     buildShader(kObjectShader, &object_program_object_id_);
+    bindSampler(object_program_object_id_, "image", 0);
   }
 
   return object_program_object_id_;
 }
 
-GLint Shaders::GetObjectUniformImage() {
-  if (object_image_ == 0) {
-    object_image_ = glGetUniformLocationARB(GetObjectProgram(), "image");
-    if (object_image_ == -1)
-      throw SystemError("Bad uniform value: image");
-  }
-
-  return object_image_;
-}
-
-void Shaders::loadObjectUniformFromGraphicsObject(const GraphicsObject& go) {
+void Shaders::SetObjectAttributes(const GraphicsObject& go,
+                                  int alpha,
+                                  SpriteBatch::Vertex* quad) {
   RGBAColour colour = go.colour();
-  glUniform4fARB(Shaders::GetObjectUniformColour(),
-                 colour.r_float(),
-                 colour.g_float(),
-                 colour.b_float(),
-                 colour.a_float());
-
   RGBColour tint = go.tint();
-  glUniform3fARB(Shaders::GetObjectUniformTint(),
-                 tint.r_float(),
-                 tint.g_float(),
-                 tint.b_float());
-
-  glUniform1fARB(Shaders::GetObjectUniformLight(), go.light() / 255.0f);
-
-  glUniform1fARB(Shaders::GetObjectUniformMono(), go.mono() / 255.0f);
-
-  glUniform1fARB(Shaders::GetObjectUniformInvert(), go.invert() / 255.0f);
-}
-
-GLint Shaders::GetObjectUniformColour() {
-  if (object_colour_ == 0) {
-    object_colour_ = glGetUniformLocationARB(GetObjectProgram(), "colour");
-    if (object_colour_ == -1)
-      throw SystemError("Bad uniform value: colour");
+  for (int i = 0; i < 4; ++i) {
+    GLfloat* attributes = quad[i].attributes[0];
+    attributes[0] = colour.r_float();
+    attributes[1] = colour.g_float();
+    attributes[2] = colour.b_float();
+    attributes[3] = colour.a_float();
+
+    attributes = quad[i].attributes[1];
+    attributes[0] = tint.r_float();
+    attributes[1] = tint.g_float();
+    attributes[2] = tint.b_float();
+    attributes[3] = go.light() / 255.0f;
+
+    attributes = quad[i].attributes[2];
+    attributes[0] = go.mono() / 255.0f;
+    attributes[1] = go.invert() / 255.0f;
+    attributes[2] = alpha / 255.0f;
+    attributes[3] = 0.0f;
   }
-
-  return object_colour_;
-}
-
-GLint Shaders::GetObjectUniformTint() {
-  if (object_tint_ == 0) {
-    object_tint_ = glGetUniformLocationARB(GetObjectProgram(), "tint");
-    if (object_tint_ == -1)
-      throw SystemError("Bad uniform value: tint");
-  }
-
-  return object_tint_;
 }
 
-GLint Shaders::GetObjectUniformLight() {
-  if (object_light_ == 0) {
-    object_light_ = glGetUniformLocationARB(GetObjectProgram(), "light");
-    if (object_light_ == -1)
-      throw SystemError("Bad uniform value: light");
-  }
-
-  return object_light_;
-}
-
-GLint Shaders::GetObjectUniformAlpha() {
-  if (object_alpha_ == 0) {
-    object_alpha_ = glGetUniformLocationARB(GetObjectProgram(), "alpha");
-    if (object_alpha_ == -1)
-      throw SystemError("Bad uniform value: alpha");
-  }
-
-  return object_alpha_;
-}
-
-GLint Shaders::GetObjectUniformMono() {
-  if (object_mono_ == 0) {
-    object_mono_ = glGetUniformLocationARB(GetObjectProgram(), "mono");
-    if (object_mono_ == -1)
-      throw SystemError("Bad uniform value: mono");
-  }
-
-  return object_mono_;
-}
-
-GLint Shaders::GetObjectUniformInvert() {
-  if (object_invert_ == 0) {
-    object_invert_ = glGetUniformLocationARB(GetObjectProgram(), "invert");
-    if (object_invert_ == -1)
-      throw SystemError("Bad uniform value: invert");
-  }
-
-  return object_invert_;
+// static
+void Shaders::bindSampler(GLuint program, const char* name, int unit) {
+  GLint location = glGetUniformLocationARB(program, name);
+  if (location == -1)
+    throw SystemError(std::string("Bad uniform value: ") + name);
+
+  glUseProgramObjectARB(program);
+  glUniform1iARB(location, unit);
+  glUseProgramObjectARB(0);
+  DebugShowGLErrors();
 }
 
 // static
@@ -29,6 +29,8 @@
 
 #include <SDL/SDL_opengl.h>
 
+#include "systems/sdl/sprite_batch.h"
+
 class GraphicsObject;
 
 // Static state about shaders. We just leak them.
@@ -37,48 +39,33 @@ class Shaders {
   // Immediately frees all OpenGL resources associated with shaders.
   static void Reset();
 
-  // Returns the shader for the subtractive color mask used in text boxes.
+  // Returns the shader for the subtractive color mask used in text boxes. It
+  // samples what's already on screen from texture unit 0 and the mask from
+  // unit 1, at the coordinates in the first vertex attribute.
   static GLuint getColorMaskProgram();
 
-  // Returns the parameters for the color mask program.
-  static GLint getColorMaskUniformCurrentValues();
-  static GLint getColorMaskUniformMask();
-
-  // Returns the shader that implements tint/light/colour on objects.
+  // Returns the shader that implements tint/light/colour on objects. Its
+  // settings come from the vertex attributes filled in by
+  // SetObjectAttributes() so that objects with different settings can still
+  // be drawn in one batch.
   static GLuint GetObjectProgram();
 
-  // Returns the parameters to the object program.
-  static GLint GetObjectUniformImage();
-  static GLint GetObjectUniformAlpha();
-
-  // Set the colour/tint/light/mono/invert properties from |go|. (Individual
-  // setters also exposed.)
-  static void loadObjectUniformFromGraphicsObject(const GraphicsObject& go);
-  static GLint GetObjectUniformColour();
-  static GLint GetObjectUniformTint();
-  static GLint GetObjectUniformLight();
-  static GLint GetObjectUniformMono();
-  static GLint GetObjectUniformInvert();
+  // Sets the colour/tint/light/mono/invert properties of |go| and |alpha| on
+  // all four corners of |quad|.
+  static void SetObjectAttributes(const GraphicsObject& go,
+                                  int alpha,
+                                  SpriteBatch::Vertex* quad);
 
  private:
   // Compiles and links the text program in |shader| into a shader and program
   // object.
   static void buildShader(const char* shader, GLuint* program_object);
 
-  static GLuint color_mask_program_object_id_;
-  static GLuint color_mask_shader_object_id_;
-  static GLint color_mask_current_values_;
-  static GLint color_mask_mask_;
+  // Points the sampler uniform |name| in |program| at texture unit |unit|.
+  static void bindSampler(GLuint program, const char* name, int unit);
 
+  static GLuint color_mask_program_object_id_;
   static GLuint object_program_object_id_;
-  static GLuint object_shader_object_id_;
-  static GLint object_image_;
-  static GLint object_colour_;
-  static GLint object_tint_;
-  static GLint object_light_;
-  static GLint object_alpha_;
-  static GLint object_mono_;
-  static GLint object_invert_;
 };
 
 #endif  // SRC_SYSTEMS_SDL_SHADERS_H_
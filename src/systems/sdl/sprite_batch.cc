@@ -0,0 +1,372 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#include "GL/glew.h"
+
+#include "systems/sdl/sprite_batch.h"
+
+#include <algorithm>
+#include <cstddef>
+
+#include "systems/sdl/sdl_utils.h"
+
+namespace {
+
+// How many batches back a quad may be moved to join one with the same state.
+// Searching further finds little in real scenes and makes Flush() quadratic.
+const int kMaxLookBack = 32;
+
+const int kIndicesPerQuad = 6;
+
+}  // namespace
+
+SpriteBatch::SpriteBatch()
+    : vertex_buffer_(0),
+      index_buffer_(0),
+      index_buffer_quads_(0),
+      buffers_initialized_(false) {
+  ResetStats();
+}
+
+// static
+SpriteBatch& SpriteBatch::Get() {
+  static SpriteBatch* batch = new SpriteBatch;
+  return *batch;
+}
+
+void SpriteBatch::Reset() {
+  states_.clear();
+  vertices_.clear();
+
+  if (vertex_buffer_)
+    glDeleteBuffersARB(1, &vertex_buffer_);
+  if (index_buffer_)
+    glDeleteBuffersARB(1, &index_buffer_);
+  DebugShowGLErrors();
+
+  vertex_buffer_ = 0;
+  index_buffer_ = 0;
+  index_buffer_quads_ = 0;
+  indices_.clear();
+  buffers_initialized_ = false;
+}
+
+SpriteBatch::Vertex* SpriteBatch::AddQuad(const State& state) {
+  states_.push_back(state);
+  vertices_.resize(vertices_.size() + 4);
+  stats_.quads++;
+  return &vertices_[vertices_.size() - 4];
+}
+
+void SpriteBatch::Flush() {
+  if (states_.empty())
+    return;
+
+  if (!buffers_initialized_) {
+    if (GLEW_ARB_vertex_buffer_object) {
+      glGenBuffersARB(1, &vertex_buffer_);
+      glGenBuffersARB(1, &index_buffer_);
+    }
+    buffers_initialized_ = true;
+  }
+
+  BuildBatches();
+  EnsureIndices(states_.size());
+
+  // With buffer objects, the pointers below are offsets into them.
+  const char* vertex_base = NULL;
+  const GLuint* index_base = NULL;
+  if (vertex_buffer_) {
+    glBindBufferARB(GL_ARRAY_BUFFER_ARB, vertex_buffer_);
+    glBufferDataARB(GL_ARRAY_BUFFER_ARB,
+                    sorted_vertices_.size() * sizeof(Vertex),
+                    sorted_vertices_.data(),
+                    GL_STREAM_DRAW_ARB);
+    glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, index_buffer_);
+  } else {
+    vertex_base = reinterpret_cast<const char*>(sorted_vertices_.data());
+    index_base = indices_.data();
+  }
+
+  const bool multitexture = GLEW_ARB_multitexture;
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glVertexPointer(
+      2, GL_FLOAT, sizeof(Vertex), vertex_base + offsetof(Vertex, x));
+  glEnableClientState(GL_COLOR_ARRAY);
+  glColorPointer(4,
+                 GL_UNSIGNED_BYTE,
+                 sizeof(Vertex),
+                 vertex_base + offsetof(Vertex, colour));
+  if (multitexture)
+    glClientActiveTextureARB(GL_TEXTURE0_ARB);
+  glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+  glTexCoordPointer(
+      2, GL_FLOAT, sizeof(Vertex), vertex_base + offsetof(Vertex, s));
+  if (multitexture) {
+    for (int i = 0; i < 3; ++i) {
+      glClientActiveTextureARB(GL_TEXTURE1_ARB + i);
+      glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+      glTexCoordPointer(4,
+                        GL_FLOAT,
+                        sizeof(Vertex),
+                        vertex_base + offsetof(Vertex, attributes) +
+                            i * sizeof(Vertex::attributes[0]));
+    }
+  }
+
+  const State* previous = NULL;
+  for (const Batch& batch : batches_) {
+    ApplyState(batch.state, previous);
+    glDrawElements(GL_TRIANGLES,
+                   batch.quad_count * kIndicesPerQuad,
+                   GL_UNSIGNED_INT,
+                   index_base + batch.first_quad * kIndicesPerQuad);
+    stats_.draw_calls++;
+    previous = &batch.state;
+  }
+
+  // Put everything back the way the immediate mode code expects it.
+  if (multitexture) {
+    for (int i = 2; i >= 0; --i) {
+      glClientActiveTextureARB(GL_TEXTURE1_ARB + i);
+      glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    }
+    glClientActiveTextureARB(GL_TEXTURE0_ARB);
+  }
+  glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+  glDisableClientState(GL_COLOR_ARRAY);
+  glDisableClientState(GL_VERTEX_ARRAY);
+
+  if (vertex_buffer_) {
+    glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+    glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, 0);
+  }
+
+  glUseProgramObjectARB(0);
+  glBlendEquation(GL_FUNC_ADD);
+  glBlendFunc(GL_ONE, GL_ZERO);
+  DebugShowGLErrors();
+
+  states_.clear();
+  vertices_.clear();
+  stats_.flushes++;
+}
+
+void SpriteBatch::FlushIfUsing(GLuint texture) {
+  for (const State& state : states_) {
+    if (state.texture == texture || state.mask_texture == texture) {
+      Flush();
+      return;
+    }
+  }
+}
+
+void SpriteBatch::ResetStats() {
+  stats_.quads = 0;
+  stats_.flushes = 0;
+  stats_.draw_calls = 0;
+}
+
+// static
+void SpriteBatch::SetColour(Vertex* quad,
+                            GLubyte r,
+                            GLubyte g,
+                            GLubyte b,
+                            GLubyte a) {
+  for (int i = 0; i < 4; ++i) {
+    quad[i].colour[0] = r;
+    quad[i].colour[1] = g;
+    quad[i].colour[2] = b;
+    quad[i].colour[3] = a;
+  }
+}
+
+// static
+void SpriteBatch::SetRect(Vertex* quad,
+                          GLfloat x1,
+                          GLfloat y1,
+                          GLfloat x2,
+                          GLfloat y2,
+                          GLfloat s1,
+                          GLfloat t1,
+                          GLfloat s2,
+                          GLfloat t2) {
+  quad[0].x = x1;
+  quad[0].y = y1;
+  quad[0].s = s1;
+  quad[0].t = t1;
+
+  quad[1].x = x2;
+  quad[1].y = y1;
+  quad[1].s = s2;
+  quad[1].t = t1;
+
+  quad[2].x = x2;
+  quad[2].y = y2;
+  quad[2].s = s2;
+  quad[2].t = t2;
+
+  quad[3].x = x1;
+  quad[3].y = y2;
+  quad[3].s = s1;
+  quad[3].t = t2;
+}
+
+void SpriteBatch::BuildBatches() {
+  const int quad_count = states_.size();
+  batches_.clear();
+  quad_batch_.resize(quad_count);
+
+  for (int quad = 0; quad < quad_count; ++quad) {
+    const Vertex* corners = &vertices_[quad * 4];
+    GLfloat x1 = corners[0].x, x2 = corners[0].x;
+    GLfloat y1 = corners[0].y, y2 = corners[0].y;
+    for (int i = 1; i < 4; ++i) {
+      x1 = std::min(x1, corners[i].x);
+      x2 = std::max(x2, corners[i].x);
+      y1 = std::min(y1, corners[i].y);
+      y2 = std::max(y2, corners[i].y);
+    }
+
+    // Walk back over the batches that will be drawn after any earlier batch
+    // we join. We may only jump past the ones we don't overlap.
+    int target = -1;
+    const int lowest =
+        std::max(0, static_cast<int>(batches_.size()) - kMaxLookBack);
+    for (int i = static_cast<int>(batches_.size()) - 1; i >= lowest; --i) {
+      const Batch& batch = batches_[i];
+      if (batch.state == states_[quad]) {
+        target = i;
+        break;
+      }
+      if (x1 < batch.x2 && batch.x1 < x2 && y1 < batch.y2 && batch.y1 < y2)
+        break;
+    }
+
+    if (target == -1) {
+      Batch batch = {states_[quad], x1, y1, x2, y2, 0, 0};
+      batches_.push_back(batch);
+      target = batches_.size() - 1;
+    } else {
+      Batch& batch = batches_[target];
+      batch.x1 = std::min(batch.x1, x1);
+      batch.y1 = std::min(batch.y1, y1);
+      batch.x2 = std::max(batch.x2, x2);
+      batch.y2 = std::max(batch.y2, y2);
+    }
+
+    batches_[target].quad_count++;
+    quad_batch_[quad] = target;
+  }
+
+  // Lay the quads out batch by batch, keeping their order inside each batch.
+  int first = 0;
+  for (Batch& batch : batches_) {
+    batch.first_quad = first;
+    first += batch.quad_count;
+    batch.quad_count = 0;
+  }
+
+  sorted_vertices_.resize(vertices_.size());
+  for (int quad = 0; quad < quad_count; ++quad) {
+    Batch& batch = batches_[quad_batch_[quad]];
+    int slot = batch.first_quad + batch.quad_count++;
+    std::copy(vertices_.begin() + quad * 4,
+              vertices_.begin() + quad * 4 + 4,
+              sorted_vertices_.begin() + slot * 4);
+  }
+}
+
+void SpriteBatch::EnsureIndices(int quad_count) {
+  if (quad_count <= index_buffer_quads_)
+    return;
+
+  index_buffer_quads_ =
+      std::max(256, std::max(quad_count, index_buffer_quads_ * 2));
+  indices_.resize(index_buffer_quads_ * kIndicesPerQuad);
+  for (int quad = 0; quad < index_buffer_quads_; ++quad) {
+    GLuint* index = &indices_[quad * kIndicesPerQuad];
+    GLuint corner = quad * 4;
+    index[0] = corner;
+    index[1] = corner + 1;
+    index[2] = corner + 2;
+    index[3] = corner;
+    index[4] = corner + 2;
+    index[5] = corner + 3;
+  }
+
+  if (index_buffer_) {
+    glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, index_buffer_);
+    glBufferDataARB(GL_ELEMENT_ARRAY_BUFFER_ARB,
+                    indices_.size() * sizeof(GLuint),
+                    indices_.data(),
+                    GL_STATIC_DRAW_ARB);
+  }
+}
+
+void SpriteBatch::ApplyState(const State& state, const State* previous) {
+  if (!previous || previous->program != state.program)
+    glUseProgramObjectARB(state.program);
+
+  if (!previous || previous->texture != state.texture)
+    glBindTexture(GL_TEXTURE_2D, state.texture);
+
+  if (state.mask_texture &&
+      (!previous || previous->mask_texture != state.mask_texture)) {
+    glActiveTextureARB(GL_TEXTURE1_ARB);
+    glBindTexture(GL_TEXTURE_2D, state.mask_texture);
+    glActiveTextureARB(GL_TEXTURE0_ARB);
+  }
+
+  if (!previous || previous->blend != state.blend) {
+    switch (state.blend) {
+      case BLEND_REPLACE:
+        glBlendEquation(GL_FUNC_ADD);
+        glBlendFunc(GL_ONE, GL_ZERO);
+        break;
+      case BLEND_ALPHA:
+        glBlendEquation(GL_FUNC_ADD);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        break;
+      case BLEND_ADD:
+        glBlendEquation(GL_FUNC_ADD);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+        break;
+      case BLEND_SUBTRACT:
+        glBlendEquation(GL_FUNC_REVERSE_SUBTRACT);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+        break;
+      case BLEND_SATURATE:
+        /// SERIOUS WTF: gl_blend_func_separate causes a segmentation fault
+        /// under the current i810 driver for linux, so this only shades by
+        /// the alpha channel.
+        glBlendEquation(GL_FUNC_ADD);
+        glBlendFunc(GL_SRC_ALPHA_SATURATE, GL_ONE_MINUS_SRC_ALPHA);
+        break;
+    }
+  }
+}
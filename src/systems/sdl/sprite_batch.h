@@ -0,0 +1,171 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#ifndef SRC_SYSTEMS_SDL_SPRITE_BATCH_H_
+#define SRC_SYSTEMS_SDL_SPRITE_BATCH_H_
+
+#include <SDL/SDL_opengl.h>
+
+#include <vector>
+
+// Collects the textured quads drawn during a frame and hands them to OpenGL
+// in as few draw calls as possible. Every quad is written into one vertex
+// buffer; quads that share a texture, shader program and blend mode are drawn
+// together, even when other quads were queued between them, as long as
+// nothing they jump over overlaps them on screen.
+//
+// Anything that touches the framebuffer outside of the batch (reading it back
+// into a texture, clearing, scissoring, swapping) must call Flush() first.
+// Like Shaders, this is process wide state tied to the current GL context.
+class SpriteBatch {
+ public:
+  enum Blend {
+    // Overwrite the destination (glBlendFunc(GL_ONE, GL_ZERO)).
+    BLEND_REPLACE,
+    // Normal alpha blending.
+    BLEND_ALPHA,
+    // composite_mode 1: additive.
+    BLEND_ADD,
+    // composite_mode 2: subtractive.
+    BLEND_SUBTRACT,
+    // The fixed function fallback for subtractive colour masks.
+    BLEND_SATURATE
+  };
+
+  // Everything that has to be the same for two quads to share a draw call.
+  struct State {
+    // The fragment program, or 0 for the fixed function pipeline.
+    GLuint program;
+
+    // Bound to texture unit 0.
+    GLuint texture;
+
+    // Bound to texture unit 1 for programs that sample two textures; 0
+    // otherwise.
+    GLuint mask_texture;
+
+    Blend blend;
+
+    bool operator==(const State& rhs) const {
+      return program == rhs.program && texture == rhs.texture &&
+             mask_texture == rhs.mask_texture && blend == rhs.blend;
+    }
+    bool operator!=(const State& rhs) const { return !(*this == rhs); }
+  };
+
+  // One corner of a quad. |attributes| are fed to texture coordinate sets 1-3
+  // and are only read by fragment programs; see Shaders for their meaning.
+  struct Vertex {
+    GLfloat x, y;
+    GLfloat s, t;
+    GLfloat attributes[3][4];
+    GLubyte colour[4];
+  };
+
+  // Counters for the draws since the last ResetStats().
+  struct Stats {
+    int quads;
+    int flushes;
+    int draw_calls;
+  };
+
+  SpriteBatch();
+
+  // The batch all Textures draw into.
+  static SpriteBatch& Get();
+
+  // Forgets all OpenGL objects, for when the context is recreated. Pending
+  // quads are dropped.
+  void Reset();
+
+  // Queues a quad and returns its four corners (clockwise from the top left
+  // on screen) for the caller to fill in. The pointer is only valid until the
+  // next call into the batch.
+  Vertex* AddQuad(const State& state);
+
+  // Draws everything queued so far and leaves GL in the state the rest of
+  // the SDL backend expects: no program, blending with (GL_ONE, GL_ZERO).
+  void Flush();
+
+  // Flushes if any queued quad samples |texture|. Call before changing or
+  // deleting a texture's contents.
+  void FlushIfUsing(GLuint texture);
+
+  bool empty() const { return states_.empty(); }
+
+  const Stats& stats() const { return stats_; }
+  void ResetStats();
+
+  // Fills |quad|'s colour with |r|, |g|, |b|, |a| on every corner.
+  static void SetColour(Vertex* quad, GLubyte r, GLubyte g, GLubyte b,
+                        GLubyte a);
+
+  // Lays |quad| out over the screen rectangle (x1, y1)-(x2, y2) sampling
+  // (s1, t1)-(s2, t2).
+  static void SetRect(Vertex* quad,
+                      GLfloat x1, GLfloat y1, GLfloat x2, GLfloat y2,
+                      GLfloat s1, GLfloat t1, GLfloat s2, GLfloat t2);
+
+ private:
+  // A run of quads drawn with one call.
+  struct Batch {
+    State state;
+    GLfloat x1, y1, x2, y2;
+    int first_quad;
+    int quad_count;
+  };
+
+  // Sorts |states_| into |batches_| and writes the vertices in draw order to
+  // |sorted_vertices_|.
+  void BuildBatches();
+
+  // Makes sure the index buffer can describe |quad_count| quads.
+  void EnsureIndices(int quad_count);
+
+  void ApplyState(const State& state, const State* previous);
+
+  // Queued quads, in the order they were added.
+  std::vector<State> states_;
+  std::vector<Vertex> vertices_;
+
+  // Scratch space reused between flushes.
+  std::vector<int> quad_batch_;
+  std::vector<Batch> batches_;
+  std::vector<Vertex> sorted_vertices_;
+  std::vector<GLuint> indices_;
+
+  // Buffer objects; 0 when GL doesn't have them, in which case we draw from
+  // client memory.
+  GLuint vertex_buffer_;
+  GLuint index_buffer_;
+  int index_buffer_quads_;
+  bool buffers_initialized_;
+
+  Stats stats_;
+};
+
+#endif  // SRC_SYSTEMS_SDL_SPRITE_BATCH_H_
@@ -48,6 +48,7 @@
 #include "systems/sdl/sdl_surface.h"
 #include "systems/sdl/sdl_utils.h"
 #include "systems/sdl/shaders.h"
+#include "systems/sdl/sprite_batch.h"
 #include "systems/sdl/texture.h"
 
 unsigned int Texture::s_screen_width = 0;
@@ -84,60 +85,27 @@ Texture::Texture(SDL_Surface* surface,
       total_height_(surface->h),
       texture_width_(SafeSize(logical_width_)),
       texture_height_(SafeSize(logical_height_)),
+      atlas_x_(0),
+      atlas_y_(0),
       back_texture_id_(0),
       is_upside_down_(false) {
-  glGenTextures(1, &texture_id_);
-  glBindTexture(GL_TEXTURE_2D, texture_id_);
-  DebugShowGLErrors();
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_R, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-  if (w == total_width_ && h == total_height_) {
-    SDL_LockSurface(surface);
-    glTexImage2D(GL_TEXTURE_2D,
-                 0,
-                 bytes_per_pixel,
-                 texture_width_,
-                 texture_height_,
-                 0,
-                 byte_order,
-                 byte_type,
-                 NULL);
-    DebugShowGLErrors();
-
-    glTexSubImage2D(GL_TEXTURE_2D,
-                    0,
-                    0,
-                    0,
-                    surface->w,
-                    surface->h,
-                    byte_order,
-                    byte_type,
-                    surface->pixels);
-    DebugShowGLErrors();
-
-    SDL_UnlockSurface(surface);
+  // Masks are uploaded as alpha only textures and can't share an RGBA page.
+  TextureAtlas::Allocation slot;
+  if (bytes_per_pixel == 4 && TextureAtlas::Get().Allocate(w, h, &slot)) {
+    atlas_page_ = slot.page;
+    atlas_x_ = slot.x;
+    atlas_y_ = slot.y;
+    texture_id_ = atlas_page_->texture_id();
+    texture_width_ = texture_height_ = atlas_page_->size();
+    glBindTexture(GL_TEXTURE_2D, texture_id_);
   } else {
-    // Cut out the current piece
-    char* pixel_data = uploadBuffer(surface->format->BytesPerPixel * w * h);
-    char* cur_dst_ptr = pixel_data;
-
-    SDL_LockSurface(surface);
-    {
-      char* cur_src_ptr = (char*)surface->pixels;
-      cur_src_ptr += surface->pitch * y;
-
-      int row_start = surface->format->BytesPerPixel * x;
-      int subrow_size = surface->format->BytesPerPixel * w;
-      for (int current_row = 0; current_row < h; ++current_row) {
-        memcpy(cur_dst_ptr, cur_src_ptr + row_start, subrow_size);
-        cur_dst_ptr += subrow_size;
-        cur_src_ptr += surface->pitch;
-      }
-    }
-    SDL_UnlockSurface(surface);
+    glGenTextures(1, &texture_id_);
+    glBindTexture(GL_TEXTURE_2D, texture_id_);
+    DebugShowGLErrors();
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_R, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
     glTexImage2D(GL_TEXTURE_2D,
                  0,
@@ -149,11 +117,9 @@ Texture::Texture(SDL_Surface* surface,
                  byte_type,
                  NULL);
     DebugShowGLErrors();
-
-    glTexSubImage2D(
-        GL_TEXTURE_2D, 0, 0, 0, w, h, byte_order, byte_type, pixel_data);
-    DebugShowGLErrors();
   }
+
+  upload(surface, 0, 0, x, y, w, h, byte_order, byte_type);
 }
 
 // -----------------------------------------------------------------------
@@ -168,8 +134,13 @@ Texture::Texture(render_to_texture, int width, int height)
       texture_width_(0),
       texture_height_(0),
       texture_id_(0),
+      atlas_x_(0),
+      atlas_y_(0),
       back_texture_id_(0),
       is_upside_down_(true) {
+  // We copy whatever is on screen, so it has to be there first.
+  SpriteBatch::Get().Flush();
+
   glGenTextures(1, &texture_id_);
   glBindTexture(GL_TEXTURE_2D, texture_id_);
   DebugShowGLErrors();
@@ -201,10 +172,17 @@ Texture::Texture(render_to_texture, int width, int height)
 // -----------------------------------------------------------------------
 
 Texture::~Texture() {
-  glDeleteTextures(1, &texture_id_);
-
-  if (back_texture_id_)
+  SpriteBatch& batch = SpriteBatch::Get();
+  batch.FlushIfUsing(texture_id_);
+  if (atlas_page_)
+    atlas_page_->Free(atlas_x_, atlas_y_, logical_width_, logical_height_);
+  else
+    glDeleteTextures(1, &texture_id_);
+
+  if (back_texture_id_) {
+    batch.FlushIfUsing(back_texture_id_);
     glDeleteTextures(1, &back_texture_id_);
+  }
 
   DebugShowGLErrors();
 }
@@ -232,15 +210,31 @@ void Texture::reupload(SDL_Surface* surface,
                        unsigned int bytes_per_pixel,
                        int byte_order,
                        int byte_type) {
+  // Quads already queued must see the old pixels.
+  SpriteBatch::Get().FlushIfUsing(texture_id_);
+
   glBindTexture(GL_TEXTURE_2D, texture_id_);
+  upload(surface, offset_x, offset_y, x, y, w, h, byte_order, byte_type);
+}
 
+// -----------------------------------------------------------------------
+
+void Texture::upload(SDL_Surface* surface,
+                     int offset_x,
+                     int offset_y,
+                     int x,
+                     int y,
+                     int w,
+                     int h,
+                     int byte_order,
+                     int byte_type) {
   if (w == total_width_ && h == total_height_) {
     SDL_LockSurface(surface);
 
     glTexSubImage2D(GL_TEXTURE_2D,
                     0,
-                    0,
-                    0,
+                    atlas_x_,
+                    atlas_y_,
                     surface->w,
                     surface->h,
                     byte_order,
@@ -271,8 +265,8 @@ void Texture::reupload(SDL_Surface* surface,
 
     glTexSubImage2D(GL_TEXTURE_2D,
                     0,
-                    offset_x,
-                    offset_y,
+                    atlas_x_ + offset_x,
+                    atlas_y_ + offset_y,
                     w,
                     h,
                     byte_order,
@@ -312,33 +306,21 @@ void Texture::RenderToScreen(const Rect& src, const Rect& dst, int opacity) {
 
   // For the time being, we are dumb and assume that it's one texture
 
-  float thisx1 = float(x1) / texture_width_;
-  float thisy1 = float(y1) / texture_height_;
-  float thisx2 = float(x2) / texture_width_;
-  float thisy2 = float(y2) / texture_height_;
+  float thisx1 = TexX(x1);
+  float thisy1 = TexY(y1);
+  float thisx2 = TexX(x2);
+  float thisy2 = TexY(y2);
 
   if (is_upside_down_) {
     thisy1 = float(logical_height_ - y1) / texture_height_;
     thisy2 = float(logical_height_ - y2) / texture_height_;
   }
 
-  glBindTexture(GL_TEXTURE_2D, texture_id_);
-
-  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-  glBegin(GL_QUADS);
-  {
-    glColor4ub(255, 255, 255, opacity);
-    glTexCoord2f(thisx1, thisy1);
-    glVertex2i(fdx1, fdy1);
-    glTexCoord2f(thisx2, thisy1);
-    glVertex2i(fdx2, fdy1);
-    glTexCoord2f(thisx2, thisy2);
-    glVertex2i(fdx2, fdy2);
-    glTexCoord2f(thisx1, thisy2);
-    glVertex2i(fdx1, fdy2);
-  }
-  glEnd();
-  glBlendFunc(GL_ONE, GL_ZERO);
+  SpriteBatch::State state = {0, texture_id_, 0, SpriteBatch::BLEND_ALPHA};
+  SpriteBatch::Vertex* quad = SpriteBatch::Get().AddQuad(state);
+  SpriteBatch::SetRect(
+      quad, fdx1, fdy1, fdx2, fdy2, thisx1, thisy1, thisx2, thisy2);
+  SpriteBatch::SetColour(quad, 255, 255, 255, opacity);
 }
 
 // -----------------------------------------------------------------------
@@ -371,14 +353,24 @@ void Texture::render_to_screen_as_colour_mask_subtractive_glsl(
   if (!filterCoords(x1, y1, x2, y2, fdx1, fdy1, fdx2, fdy2))
     return;
 
-  float thisx1 = float(x1) / texture_width_;
-  float thisy1 = float(y1) / texture_height_;
-  float thisx2 = float(x2) / texture_width_;
-  float thisy2 = float(y2) / texture_height_;
+  // The back texture is sized to our image, not to the atlas page we may be
+  // sitting in, so it gets its own coordinates.
+  const int back_width = SafeSize(logical_width_);
+  const int back_height = SafeSize(logical_height_);
+
+  float backx1 = float(x1) / back_width;
+  float backy1 = float(y1) / back_height;
+  float backx2 = float(x2) / back_width;
+  float backy2 = float(y2) / back_height;
+
+  float thisx1 = TexX(x1);
+  float thisy1 = TexY(y1);
+  float thisx2 = TexX(x2);
+  float thisy2 = TexY(y2);
 
   if (is_upside_down_) {
-    thisy1 = float(logical_height_ - y1) / texture_height_;
-    thisy2 = float(logical_height_ - y2) / texture_height_;
+    backy1 = thisy1 = float(logical_height_ - y1) / texture_height_;
+    backy2 = thisy2 = float(logical_height_ - y2) / texture_height_;
   }
 
   // If we haven't already, allocate video memory for the back
@@ -396,8 +388,8 @@ void Texture::render_to_screen_as_colour_mask_subtractive_glsl(
     glTexImage2D(GL_TEXTURE_2D,
                  0,
                  GL_RGBA,
-                 texture_width_,
-                 texture_height_,
+                 back_width,
+                 back_height,
                  0,
                  GL_RGB,
                  GL_UNSIGNED_BYTE,
@@ -406,57 +398,40 @@ void Texture::render_to_screen_as_colour_mask_subtractive_glsl(
   }
 
   // Copy the current value of the region where we're going to render
-  // to a texture for input to the shader
+  // to a texture for input to the shader. Everything queued so far has to
+  // be on screen for that.
+  SpriteBatch& batch = SpriteBatch::Get();
+  batch.Flush();
+
   glBindTexture(GL_TEXTURE_2D, back_texture_id_);
   int ystart = int(s_screen_height - fdy1 - (fdy2 - fdy1));
   int idx1 = int(fdx1);
   glCopyTexSubImage2D(
-      GL_TEXTURE_2D, 0, 0, 0, idx1, ystart, texture_width_, texture_height_);
+      GL_TEXTURE_2D, 0, 0, 0, idx1, ystart, back_width, back_height);
   DebugShowGLErrors();
 
-  glUseProgramObjectARB(Shaders::getColorMaskProgram());
-
-  // Put the back_texture in texture slot zero and set this to be the
-  // texture "current_values" in the above shader program.
-  glActiveTextureARB(GL_TEXTURE0_ARB);
-  glEnable(GL_TEXTURE_2D);
-  glBindTexture(GL_TEXTURE_2D, back_texture_id_);
-  glUniform1iARB(Shaders::getColorMaskUniformCurrentValues(), 0);
-
-  // Put the mask in texture slot one and set this to be the
-  // texture "mask" in the above shader program.
-  glActiveTextureARB(GL_TEXTURE1_ARB);
-  glEnable(GL_TEXTURE_2D);
-  glBindTexture(GL_TEXTURE_2D, texture_id_);
-  glUniform1iARB(Shaders::getColorMaskUniformMask(), 1);
-
-  glDisable(GL_BLEND);
-
-  glBegin(GL_QUADS);
-  {
-    glColorRGBA(rgba);
-    glMultiTexCoord2fARB(GL_TEXTURE0_ARB, thisx1, thisy2);
-    glMultiTexCoord2fARB(GL_TEXTURE1_ARB, thisx1, thisy1);
-    glVertex2i(fdx1, fdy1);
-    glMultiTexCoord2fARB(GL_TEXTURE0_ARB, thisx2, thisy2);
-    glMultiTexCoord2fARB(GL_TEXTURE1_ARB, thisx2, thisy1);
-    glVertex2i(fdx2, fdy1);
-    glMultiTexCoord2fARB(GL_TEXTURE0_ARB, thisx2, thisy1);
-    glMultiTexCoord2fARB(GL_TEXTURE1_ARB, thisx2, thisy2);
-    glVertex2i(fdx2, fdy2);
-    glMultiTexCoord2fARB(GL_TEXTURE0_ARB, thisx1, thisy1);
-    glMultiTexCoord2fARB(GL_TEXTURE1_ARB, thisx1, thisy2);
-    glVertex2i(fdx1, fdy2);
+  // The back_texture goes in texture slot zero as "current_values" and the
+  // mask in slot one as "mask". The shader does the blending itself.
+  SpriteBatch::State state = {Shaders::getColorMaskProgram(),
+                              back_texture_id_,
+                              texture_id_,
+                              SpriteBatch::BLEND_REPLACE};
+  SpriteBatch::Vertex* quad = batch.AddQuad(state);
+
+  // The copy of the screen is upside down.
+  SpriteBatch::SetRect(
+      quad, fdx1, fdy1, fdx2, fdy2, backx1, backy2, backx2, backy1);
+  SpriteBatch::SetColour(quad, rgba.r(), rgba.g(), rgba.b(), rgba.a());
+
+  const float mask[4][2] = {{thisx1, thisy1},
+                            {thisx2, thisy1},
+                            {thisx2, thisy2},
+                            {thisx1, thisy2}};
+  for (int i = 0; i < 4; ++i) {
+    quad[i].attributes[0][0] = mask[i][0];
+    quad[i].attributes[0][1] = mask[i][1];
+    quad[i].attributes[0][3] = 1.0f;
   }
-  glEnd();
-
-  glActiveTextureARB(GL_TEXTURE1_ARB);
-  glDisable(GL_TEXTURE_2D);
-  glActiveTextureARB(GL_TEXTURE0_ARB);
-
-  glUseProgramObjectARB(0);
-  glEnable(GL_BLEND);
-  glBlendFunc(GL_ONE, GL_ZERO);
 }
 
 // -----------------------------------------------------------------------
@@ -476,40 +451,21 @@ void Texture::render_to_screen_as_colour_mask_subtractive_fallback(
   if (!filterCoords(x1, y1, x2, y2, fdx1, fdy1, fdx2, fdy2))
     return;
 
-  float thisx1 = float(x1) / texture_width_;
-  float thisy1 = float(y1) / texture_height_;
-  float thisx2 = float(x2) / texture_width_;
-  float thisy2 = float(y2) / texture_height_;
+  float thisx1 = TexX(x1);
+  float thisy1 = TexY(y1);
+  float thisx2 = TexX(x2);
+  float thisy2 = TexY(y2);
 
   if (is_upside_down_) {
     thisy1 = float(logical_height_ - y1) / texture_height_;
     thisy2 = float(logical_height_ - y2) / texture_height_;
   }
 
-  // First draw the mask
-  glBindTexture(GL_TEXTURE_2D, texture_id_);
-
-  /// SERIOUS WTF: gl_blend_func_separate causes a segmentation fault
-  /// under the current i810 driver for linux.
-  //  glBlendFuncSeparate(GL_SRC_ALPHA_SATURATE, GL_ONE_MINUS_SRC_ALPHA,
-  //                      GL_SRC_COLOR, GL_ONE_MINUS_SRC_ALPHA);
-  glBlendFunc(GL_SRC_ALPHA_SATURATE, GL_ONE_MINUS_SRC_ALPHA);
-
-  glBegin(GL_QUADS);
-  {
-    glColorRGBA(rgba);
-    glTexCoord2f(thisx1, thisy1);
-    glVertex2i(fdx1, fdy1);
-    glTexCoord2f(thisx2, thisy1);
-    glVertex2i(fdx2, fdy1);
-    glTexCoord2f(thisx2, thisy2);
-    glVertex2i(fdx2, fdy2);
-    glTexCoord2f(thisx1, thisy2);
-    glVertex2i(fdx1, fdy2);
-  }
-  glEnd();
-
-  glBlendFunc(GL_ONE, GL_ZERO);
+  SpriteBatch::State state = {0, texture_id_, 0, SpriteBatch::BLEND_SATURATE};
+  SpriteBatch::Vertex* quad = SpriteBatch::Get().AddQuad(state);
+  SpriteBatch::SetRect(
+      quad, fdx1, fdy1, fdx2, fdy2, thisx1, thisy1, thisx2, thisy2);
+  SpriteBatch::SetColour(quad, rgba.r(), rgba.g(), rgba.b(), rgba.a());
 }
 
 // -----------------------------------------------------------------------
@@ -522,35 +478,30 @@ void Texture::render_to_screen_as_colour_mask_additive(const Rect& src,
   if (!filterCoords(x1, y1, x2, y2, fdx1, fdy1, fdx2, fdy2))
     return;
 
-  float thisx1 = float(x1) / texture_width_;
-  float thisy1 = float(y1) / texture_height_;
-  float thisx2 = float(x2) / texture_width_;
-  float thisy2 = float(y2) / texture_height_;
+  float thisx1 = TexX(x1);
+  float thisy1 = TexY(y1);
+  float thisx2 = TexX(x2);
+  float thisy2 = TexY(y2);
 
   if (is_upside_down_) {
     thisy1 = float(logical_height_ - y1) / texture_height_;
     thisy2 = float(logical_height_ - y2) / texture_height_;
   }
 
-  // First draw the mask
-  glBindTexture(GL_TEXTURE_2D, texture_id_);
-  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-  glBegin(GL_QUADS);
-  {
-    glColorRGBA(rgba);
-    glTexCoord2i(thisx1, thisy1);
-    glVertex2f(fdx1, fdy1);
-    glTexCoord2i(thisx2, thisy1);
-    glVertex2f(fdx2, fdy1);
-    glTexCoord2i(thisx2, thisy2);
-    glVertex2f(fdx2, fdy2);
-    glTexCoord2i(thisx1, thisy2);
-    glVertex2f(fdx1, fdy2);
-  }
-  glEnd();
-
-  glBlendFunc(GL_ONE, GL_ZERO);
+  // This has always passed its texture coordinates through glTexCoord2i(),
+  // which truncates them; keep drawing the same thing.
+  SpriteBatch::State state = {0, texture_id_, 0, SpriteBatch::BLEND_ALPHA};
+  SpriteBatch::Vertex* quad = SpriteBatch::Get().AddQuad(state);
+  SpriteBatch::SetRect(quad,
+                       fdx1,
+                       fdy1,
+                       fdx2,
+                       fdy2,
+                       int(thisx1),
+                       int(thisy1),
+                       int(thisx2),
+                       int(thisy2));
+  SpriteBatch::SetColour(quad, rgba.r(), rgba.g(), rgba.b(), rgba.a());
 }
 
 // -----------------------------------------------------------------------
@@ -564,36 +515,25 @@ void Texture::RenderToScreen(const Rect& src,
   if (!filterCoords(x1, y1, x2, y2, fdx1, fdy1, fdx2, fdy2))
     return;
 
-  float thisx1 = float(x1) / texture_width_;
-  float thisy1 = float(y1) / texture_height_;
-  float thisx2 = float(x2) / texture_width_;
-  float thisy2 = float(y2) / texture_height_;
-
-  glBindTexture(GL_TEXTURE_2D, texture_id_);
+  float thisx1 = TexX(x1);
+  float thisy1 = TexY(y1);
+  float thisx2 = TexX(x2);
+  float thisy2 = TexY(y2);
 
   // Blend when we have less opacity
+  SpriteBatch::State state = {0, texture_id_, 0, SpriteBatch::BLEND_REPLACE};
   if (std::find_if(opacity, opacity + 4, [](int o) { return o < 255; }) !=
       opacity + 4) {
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    state.blend = SpriteBatch::BLEND_ALPHA;
   }
 
-  glBegin(GL_QUADS);
-  {
-    glColor4ub(255, 255, 255, opacity[0]);
-    glTexCoord2f(thisx1, thisy1);
-    glVertex2i(fdx1, fdy1);
-    glColor4ub(255, 255, 255, opacity[1]);
-    glTexCoord2f(thisx2, thisy1);
-    glVertex2i(fdx2, fdy1);
-    glColor4ub(255, 255, 255, opacity[2]);
-    glTexCoord2f(thisx2, thisy2);
-    glVertex2i(fdx2, fdy2);
-    glColor4ub(255, 255, 255, opacity[3]);
-    glTexCoord2f(thisx1, thisy2);
-    glVertex2i(fdx1, fdy2);
+  SpriteBatch::Vertex* quad = SpriteBatch::Get().AddQuad(state);
+  SpriteBatch::SetRect(
+      quad, fdx1, fdy1, fdx2, fdy2, thisx1, thisy1, thisx2, thisy2);
+  for (int i = 0; i < 4; ++i) {
+    quad[i].colour[0] = quad[i].colour[1] = quad[i].colour[2] = 255;
+    quad[i].colour[3] = opacity[i];
   }
-  glEnd();
-  glBlendFunc(GL_ONE, GL_ZERO);
 }
 
 // -----------------------------------------------------------------------
@@ -620,101 +560,72 @@ void Texture::RenderToScreenAsObject(const GraphicsObject& go,
   }
 
   // Convert the pixel coordinates into [0,1) texture coordinates
-  float thisx1 = float(xSrc1) / texture_width_;
-  float thisy1 = float(ySrc1) / texture_height_;
-  float thisx2 = float(xSrc2) / texture_width_;
-  float thisy2 = float(ySrc2) / texture_height_;
-
-  glBindTexture(GL_TEXTURE_2D, texture_id_);
-
-  glPushMatrix();
-  {
-    // Translate to where the object starts.
-    glTranslatef(fdx1, fdy1, 0);
-
-    int width = fdx2 - fdx1;
-    int height = fdy2 - fdy1;
-
-    // Rotate the texture around the point (origin + position + reporigin)
-    float x_rep = (width / 2.0f) + go.rep_origin_x();
-    float y_rep = (height / 2.0f) + go.rep_origin_y();
-
-    glTranslatef(x_rep, y_rep, 0);
-    glRotatef(float(go.rotation()) / 10, 0, 0, 1);
-    glTranslatef(-x_rep, -y_rep, 0);
-
-    // RealLive has its own complex shading/tinting system which we implement
-    // in a shader if available. It's costly enough that we make sure we need
-    // to use it.
-    bool using_shader = false;
-    if ((go.light() || go.tint() != RGBColour::Black() ||
-         go.colour() != RGBAColour::Clear() || go.mono() || go.invert()) &&
-        GLEW_ARB_fragment_shader && GLEW_ARB_multitexture) {
-      // Image
-      glActiveTexture(GL_TEXTURE0_ARB);
-      glEnable(GL_TEXTURE_2D);
-      glBindTexture(GL_TEXTURE_2D, texture_id_);
-      glUseProgramObjectARB(Shaders::GetObjectProgram());
-      glUniform1iARB(Shaders::GetObjectUniformImage(), 0);
-
-      // Colour/Tint/Etc.
-      Shaders::loadObjectUniformFromGraphicsObject(go);
-
-      // Alpha.
-      glUniform1fARB(Shaders::GetObjectUniformAlpha(), alpha / 255.0f);
-
-      // Our final blending color has to be all white here.
-      using_shader = true;
-    } else {
-      // The shader takes care of the alpha for us, so we need to specify when
-      // not using it.
-      glColor4ub(255, 255, 255, alpha);
-    }
-
-    // Make this so that when we have composite 1, we're doing a pure
-    // additive blend, (ignoring the alpha channel?)
-    switch (go.composite_mode()) {
-      case 0:
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        break;
-      case 1:
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE);
-        break;
-      case 2: {
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE);
-        glBlendEquation(GL_FUNC_REVERSE_SUBTRACT);
-        break;
-      }
-      default: {
-        std::ostringstream oss;
-        oss << "Invalid composite_mode in render: " << go.composite_mode();
-        throw SystemError(oss.str());
-      }
+  float thisx1 = TexX(xSrc1);
+  float thisy1 = TexY(ySrc1);
+  float thisx2 = TexX(xSrc2);
+  float thisy2 = TexY(ySrc2);
+
+  SpriteBatch::State state = {0, texture_id_, 0, SpriteBatch::BLEND_ALPHA};
+
+  // Make this so that when we have composite 1, we're doing a pure
+  // additive blend, (ignoring the alpha channel?)
+  switch (go.composite_mode()) {
+    case 0:
+      state.blend = SpriteBatch::BLEND_ALPHA;
+      break;
+    case 1:
+      state.blend = SpriteBatch::BLEND_ADD;
+      break;
+    case 2:
+      state.blend = SpriteBatch::BLEND_SUBTRACT;
+      break;
+    default: {
+      std::ostringstream oss;
+      oss << "Invalid composite_mode in render: " << go.composite_mode();
+      throw SystemError(oss.str());
     }
+  }
 
-    glBegin(GL_QUADS);
-    {
-      glTexCoord2f(thisx1, thisy1);
-      glVertex2i(0, 0);
-      glTexCoord2f(thisx2, thisy1);
-      glVertex2i(width, 0);
-      glTexCoord2f(thisx2, thisy2);
-      glVertex2i(width, height);
-      glTexCoord2f(thisx1, thisy2);
-      glVertex2i(0, height);
-    }
-    glEnd();
+  // RealLive has its own complex shading/tinting system which we implement
+  // in a shader if available. It's costly enough that we make sure we need
+  // to use it.
+  bool using_shader = false;
+  if ((go.light() || go.tint() != RGBColour::Black() ||
+       go.colour() != RGBAColour::Clear() || go.mono() || go.invert()) &&
+      GLEW_ARB_fragment_shader && GLEW_ARB_multitexture) {
+    state.program = Shaders::GetObjectProgram();
+    using_shader = true;
+  }
 
-    if (using_shader) {
-      glUseProgramObjectARB(0);
-    }
+  SpriteBatch::Vertex* quad = SpriteBatch::Get().AddQuad(state);
+  SpriteBatch::SetRect(
+      quad, fdx1, fdy1, fdx2, fdy2, thisx1, thisy1, thisx2, thisy2);
 
-    glBlendEquation(GL_FUNC_ADD);
-    glBlendFunc(GL_ONE, GL_ZERO);
+  if (using_shader) {
+    // The shader takes care of the alpha for us, so our final blending
+    // color has to be all white here.
+    Shaders::SetObjectAttributes(go, alpha, quad);
+    SpriteBatch::SetColour(quad, 255, 255, 255, 255);
+  } else {
+    SpriteBatch::SetColour(quad, 255, 255, 255, alpha);
   }
-  glPopMatrix();
 
-  DebugShowGLErrors();
+  if (go.rotation()) {
+    // Rotate the quad around the point (origin + position + reporigin).
+    float x_rep = fdx1 + ((fdx2 - fdx1) / 2.0f) + go.rep_origin_x();
+    float y_rep = fdy1 + ((fdy2 - fdy1) / 2.0f) + go.rep_origin_y();
+
+    // rotation() is in tenths of a degree.
+    float radians = (go.rotation() / 10.0f) * (3.14159265f / 180.0f);
+    float cos_r = std::cos(radians);
+    float sin_r = std::sin(radians);
+    for (int i = 0; i < 4; ++i) {
+      float x = quad[i].x - x_rep;
+      float y = quad[i].y - y_rep;
+      quad[i].x = x_rep + (x * cos_r) - (y * sin_r);
+      quad[i].y = y_rep + (x * sin_r) + (y * cos_r);
+    }
+  }
 }
 
 // -----------------------------------------------------------------------
@@ -33,6 +33,8 @@
 #include <memory>
 #include <string>
 
+#include "systems/sdl/texture_atlas.h"
+
 struct SDL_Surface;
 class SDLSurface;
 class GraphicsObject;
@@ -40,7 +42,9 @@ class GraphicsObject;
 struct render_to_texture {};
 
 // Contains one or more OpenGL textures, representing a single image,
-// and provides a logical interface to working with them.
+// and provides a logical interface to working with them. Small images are
+// placed in a shared TextureAtlas page. Drawing goes through SpriteBatch, so
+// nothing reaches the screen until the batch is flushed.
 
 // TODO(erg): The entire Texture class's internals need to be transitioned
 // to the Point and Rect classes.
@@ -114,6 +118,27 @@ class Texture {
                                                 const Rect& dst,
                                                 const RGBAColour& rgba);
 
+  // Converts pixel positions in this image to texture coordinates,
+  // accounting for where the image sits in an atlas page.
+  float TexX(int x) const {
+    return float(atlas_x_ + x) / texture_width_;
+  }
+  float TexY(int y) const {
+    return float(atlas_y_ + y) / texture_height_;
+  }
+
+  // Uploads the |w| x |h| piece of |surface| at (x, y) to (offset_x,
+  // offset_y) in our image.
+  void upload(SDL_Surface* surface,
+              int offset_x,
+              int offset_y,
+              int x,
+              int y,
+              int w,
+              int h,
+              int byte_order,
+              int byte_type);
+
   bool filterCoords(int& x1,
                     int& y1,
                     int& x2,
@@ -132,11 +157,19 @@ class Texture {
   int total_width_;
   int total_height_;
 
+  // The size of the GL texture we live in; an atlas page's size when
+  // |atlas_page_| is set.
   unsigned int texture_width_;
   unsigned int texture_height_;
 
   GLuint texture_id_;
 
+  // The atlas page holding our pixels, and where in it they start. NULL
+  // when we have a texture to ourselves.
+  std::shared_ptr<TextureAtlas::Page> atlas_page_;
+  int atlas_x_;
+  int atlas_y_;
+
   GLuint back_texture_id_;
 
   // Is this texture upside down? (Because it's a screenshot, etc.)
@@ -0,0 +1,231 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#include "GL/glew.h"
+
+#include "systems/sdl/texture_atlas.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "systems/sdl/sdl_utils.h"
+#include "systems/sdl/sprite_batch.h"
+
+namespace {
+
+// Shelf heights are rounded up to this so that images of similar heights
+// share shelves.
+const int kShelfGranularity = 8;
+
+}  // namespace
+
+// -----------------------------------------------------------------------
+// TextureAtlas::Page
+// -----------------------------------------------------------------------
+
+TextureAtlas::Page::Page(int size)
+    : texture_id_(0), size_(size), next_shelf_y_(0), live_images_(0) {
+  glGenTextures(1, &texture_id_);
+  glBindTexture(GL_TEXTURE_2D, texture_id_);
+  DebugShowGLErrors();
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexImage2D(GL_TEXTURE_2D,
+               0,
+               GL_RGBA,
+               size_,
+               size_,
+               0,
+               GL_RGBA,
+               GL_UNSIGNED_BYTE,
+               NULL);
+  DebugShowGLErrors();
+}
+
+TextureAtlas::Page::~Page() {
+  glDeleteTextures(1, &texture_id_);
+  DebugShowGLErrors();
+}
+
+bool TextureAtlas::Page::Allocate(int width, int height, int* x, int* y) {
+  const int padded_width = width + 2;
+  const int padded_height =
+      (height + 2 + kShelfGranularity - 1) / kShelfGranularity *
+      kShelfGranularity;
+
+  // Use the lowest shelf the image fits on, in its narrowest gap or else at
+  // its end, or open a new one.
+  Shelf* best = NULL;
+  int best_gap = -1;
+  for (Shelf& shelf : shelves_) {
+    if (shelf.height < padded_height || (best && shelf.height >= best->height))
+      continue;
+
+    int gap = -1;
+    for (size_t i = 0; i < shelf.gaps.size(); ++i) {
+      if (shelf.gaps[i].width >= padded_width &&
+          (gap == -1 || shelf.gaps[i].width < shelf.gaps[gap].width)) {
+        gap = i;
+      }
+    }
+
+    if (gap != -1 || size_ - shelf.used_width >= padded_width) {
+      best = &shelf;
+      best_gap = gap;
+    }
+  }
+
+  if (!best) {
+    if (size_ - next_shelf_y_ < padded_height)
+      return false;
+
+    Shelf shelf = {next_shelf_y_, padded_height, 0};
+    shelves_.push_back(shelf);
+    next_shelf_y_ += padded_height;
+    best = &shelves_.back();
+  }
+
+  int slot_x;
+  if (best_gap != -1) {
+    Gap& gap = best->gaps[best_gap];
+    slot_x = gap.x;
+    gap.x += padded_width;
+    gap.width -= padded_width;
+    if (gap.width == 0)
+      best->gaps.erase(best->gaps.begin() + best_gap);
+  } else {
+    slot_x = best->used_width;
+    best->used_width += padded_width;
+  }
+  int slot_y = best->y;
+  live_images_++;
+
+  // Whatever was here before may still be queued for drawing.
+  SpriteBatch::Get().FlushIfUsing(texture_id_);
+
+  // Clear the slot so the gutter is transparent.
+  static std::vector<GLubyte> zeros;
+  zeros.resize(padded_width * (height + 2) * 4);
+  glBindTexture(GL_TEXTURE_2D, texture_id_);
+  glTexSubImage2D(GL_TEXTURE_2D,
+                  0,
+                  slot_x,
+                  slot_y,
+                  padded_width,
+                  height + 2,
+                  GL_RGBA,
+                  GL_UNSIGNED_BYTE,
+                  zeros.data());
+  DebugShowGLErrors();
+
+  *x = slot_x + 1;
+  *y = slot_y + 1;
+  return true;
+}
+
+void TextureAtlas::Page::Free(int x, int y, int width, int height) {
+  if (--live_images_ == 0) {
+    shelves_.clear();
+    next_shelf_y_ = 0;
+    return;
+  }
+
+  const int slot_y = y - 1;
+  auto shelf = std::find_if(shelves_.begin(),
+                            shelves_.end(),
+                            [&](const Shelf& s) { return s.y == slot_y; });
+  if (shelf == shelves_.end())
+    return;
+
+  // Put the slot back as a gap, merged with the gaps on either side.
+  Gap freed = {x - 1, width + 2};
+  std::vector<Gap>& gaps = shelf->gaps;
+  auto next = std::find_if(gaps.begin(), gaps.end(), [&](const Gap& gap) {
+    return gap.x > freed.x;
+  });
+  if (next != gaps.end() && freed.x + freed.width == next->x) {
+    freed.width += next->width;
+    next = gaps.erase(next);
+  }
+  if (next != gaps.begin()) {
+    auto previous = next - 1;
+    if (previous->x + previous->width == freed.x) {
+      freed.x = previous->x;
+      freed.width += previous->width;
+      next = gaps.erase(previous);
+    }
+  }
+
+  if (freed.x + freed.width == shelf->used_width)
+    shelf->used_width = freed.x;
+  else
+    gaps.insert(next, freed);
+
+  while (!shelves_.empty() && shelves_.back().used_width == 0) {
+    next_shelf_y_ = shelves_.back().y;
+    shelves_.pop_back();
+  }
+}
+
+// -----------------------------------------------------------------------
+// TextureAtlas
+// -----------------------------------------------------------------------
+
+TextureAtlas::TextureAtlas() {}
+
+// static
+TextureAtlas& TextureAtlas::Get() {
+  static TextureAtlas* atlas = new TextureAtlas;
+  return *atlas;
+}
+
+void TextureAtlas::Reset() { pages_.clear(); }
+
+bool TextureAtlas::Allocate(int width, int height, Allocation* out) {
+  if (width <= 0 || height <= 0 || width > kMaxImageSize ||
+      height > kMaxImageSize)
+    return false;
+
+  for (const std::shared_ptr<Page>& page : pages_) {
+    if (page->Allocate(width, height, &out->x, &out->y)) {
+      out->page = page;
+      return true;
+    }
+  }
+
+  if (pages_.size() >= kMaxPages)
+    return false;
+
+  pages_.emplace_back(new Page(kPageSize));
+  if (!pages_.back()->Allocate(width, height, &out->x, &out->y))
+    return false;
+
+  out->page = pages_.back();
+  return true;
+}
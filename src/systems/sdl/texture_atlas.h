@@ -0,0 +1,122 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#ifndef SRC_SYSTEMS_SDL_TEXTURE_ATLAS_H_
+#define SRC_SYSTEMS_SDL_TEXTURE_ATLAS_H_
+
+#include <SDL/SDL_opengl.h>
+
+#include <memory>
+#include <vector>
+
+// Packs small RGBA images (buttons, glyph strips, cursors, little sprites)
+// into a few large shared textures. Quads drawn from the same page share a
+// texture binding, so SpriteBatch can draw them with a single call.
+//
+// Pages are filled with a simple shelf packer. A freed image leaves a gap in
+// its shelf that later images of the shelf's height or less can reuse; gaps
+// at the end of a shelf are given back to the shelf, and empty shelves at the
+// top of the page to the page.
+class TextureAtlas {
+ public:
+  // One shared texture.
+  class Page {
+   public:
+    explicit Page(int size);
+    ~Page();
+
+    GLuint texture_id() const { return texture_id_; }
+    int size() const { return size_; }
+    bool empty() const { return live_images_ == 0; }
+
+    // Finds room for a |width| x |height| image, surrounded by a transparent
+    // one pixel gutter so filtering doesn't pick up the neighbours. Returns
+    // false if the page is full.
+    bool Allocate(int width, int height, int* x, int* y);
+
+    // Releases the |width| x |height| image Allocate() placed at (|x|, |y|).
+    void Free(int x, int y, int width, int height);
+
+   private:
+    // A run of unused columns between images on a shelf.
+    struct Gap {
+      int x;
+      int width;
+    };
+
+    struct Shelf {
+      int y;
+      int height;
+      int used_width;
+
+      // Sorted by x, never adjacent to each other or to |used_width|.
+      std::vector<Gap> gaps;
+    };
+
+    GLuint texture_id_;
+    int size_;
+
+    std::vector<Shelf> shelves_;
+    int next_shelf_y_;
+    int live_images_;
+  };
+
+  // Where an image landed.
+  struct Allocation {
+    std::shared_ptr<Page> page;
+    int x;
+    int y;
+  };
+
+  // Images larger than this in either dimension get their own texture.
+  static const int kMaxImageSize = 128;
+
+  static const int kPageSize = 1024;
+
+  // Past this many pages, new images get their own texture instead.
+  static const int kMaxPages = 4;
+
+  TextureAtlas();
+
+  // The atlas Textures allocate from.
+  static TextureAtlas& Get();
+
+  // Forgets all pages, for when the GL context is recreated. Textures still
+  // holding a page keep it alive until they're freed.
+  void Reset();
+
+  // Finds room for an image. Returns false when the image is too large or
+  // every page is full; the caller should then use a texture of its own.
+  bool Allocate(int width, int height, Allocation* out);
+
+  int page_count() const { return pages_.size(); }
+
+ private:
+  std::vector<std::shared_ptr<Page>> pages_;
+};
+
+#endif  // SRC_SYSTEMS_SDL_TEXTURE_ATLAS_H_
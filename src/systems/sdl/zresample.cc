@@ -18,13 +18,15 @@
 // ----------------------------------------------------------------------------
 //
 // This is a modified version of zresample, with getopt() and command line
-// parsing removed so it can be called from within rlvm.
+// parsing removed so it can be called from within rlvm. zresample_buffer() is
+// the same loop reading from and writing to memory.
 
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include <math.h>
 #include <zita-resampler/resampler.h>
+#include <vector>
 #include "audiofile.h"
 
 
@@ -164,3 +166,59 @@ int zresample_main(const char* infile, const char* outfile, unsigned int rout) {
 
     return 0;
 }
+
+int zresample_buffer(const float* input, unsigned int frames, unsigned int chan,
+                     unsigned int rinp, unsigned int rout,
+                     std::vector<float>* output) {
+    Resampler     R;
+    unsigned int  z1, z2, start, used, room;
+
+    if (rout == rinp)
+    {
+        output->insert(output->end(), input, input + frames * chan);
+        return 0;
+    }
+    if ((rinp < 8000) || (rinp > 192000) || (rout < 8000) || (rout > 192000))
+    {
+        fprintf (stderr, "Sample rate %d -> %d is out of range.\n", rinp, rout);
+        return 1;
+    }
+    if (R.setup (rinp, rout, chan, FILTSIZE))
+    {
+        fprintf (stderr, "Sample rate ratio %d/%d is not supported.\n", rout, rinp);
+        return 1;
+    }
+
+    z1 = R.inpsize () / 2 - 1;
+    z2 = R.inpsize () / 2;
+
+    // Size the output for the whole conversion up front, so the resampler
+    // writes straight into it; the slack is trimmed off at the end.
+    start = output->size ();
+    used = 0;
+    room = (unsigned int)((double)(frames + z1 + z2) * rout / rinp) + 2;
+    output->resize (start + room * chan);
+
+    // Zero samples at the start, the input in one go, then zero samples at
+    // the end to flush the filter.
+    for (int stage = 0; stage < 3; stage++)
+    {
+        R.inp_count = (stage == 0) ? z1 : (stage == 1) ? frames : z2;
+        R.inp_data = (stage == 1) ? const_cast<float*>(input) : 0;
+        while (R.inp_count)
+        {
+            if (used == room)
+            {
+                room += room / 2 + 1;
+                output->resize (start + room * chan);
+            }
+            R.out_count = room - used;
+            R.out_data = output->data () + start + used * chan;
+            R.process ();
+            used = room - R.out_count;
+        }
+    }
+
+    output->resize (start + used * chan);
+    return 0;
+}
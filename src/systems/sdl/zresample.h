@@ -28,7 +28,19 @@
 #ifndef SRC_SYSTEMS_SDL_ZRESAMPLE_H_
 #define SRC_SYSTEMS_SDL_ZRESAMPLE_H_
 
+#include <vector>
+
 // The main zresample() function.
 int zresample_main(const char* infile, const char* outfile, unsigned int rout);
 
+// zresample() on memory instead of files: converts |frames| frames of
+// interleaved |chan| channel samples at |rinp| to |rout| and appends them to
+// |output|. Returns 0 on success, like zresample_main().
+int zresample_buffer(const float* input,
+                     unsigned int frames,
+                     unsigned int chan,
+                     unsigned int rinp,
+                     unsigned int rout,
+                     std::vector<float>* output);
+
 #endif  // SRC_SYSTEMS_SDL_ZRESAMPLE_H_
@@ -0,0 +1,62 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#include "utilities/cpu_dispatch.h"
+
+#include <atomic>
+
+namespace {
+
+std::atomic<bool> force_scalar(false);
+
+}  // namespace
+
+bool CpuHasAVX2() {
+#if RLVM_HAVE_X86_KERNELS
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+#else
+  return false;
+#endif
+}
+
+bool CpuHasSSSE3() {
+#if RLVM_HAVE_X86_KERNELS
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("ssse3");
+#else
+  return false;
+#endif
+}
+
+bool ScalarKernelsForced() {
+  return force_scalar.load(std::memory_order_relaxed);
+}
+
+ScopedScalarKernels::ScopedScalarKernels(bool force)
+    : previous_(force_scalar.exchange(force)) {}
+
+ScopedScalarKernels::~ScopedScalarKernels() { force_scalar = previous_; }
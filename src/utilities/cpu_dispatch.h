@@ -0,0 +1,83 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#ifndef SRC_UTILITIES_CPU_DISPATCH_H_
+#define SRC_UTILITIES_CPU_DISPATCH_H_
+
+// x86 kernels past the SSE2 baseline are compiled with per-function target
+// attributes and only called after a runtime check.
+#if (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define RLVM_HAVE_X86_KERNELS 1
+#else
+#define RLVM_HAVE_X86_KERNELS 0
+#endif
+
+// Every aarch64 CPU has NEON, so those kernels need no runtime check.
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#define RLVM_HAVE_NEON_KERNELS 1
+#else
+#define RLVM_HAVE_NEON_KERNELS 0
+#endif
+
+// Whether the CPU we're running on has these x86 extensions. Always false
+// when RLVM_HAVE_X86_KERNELS is 0.
+bool CpuHasAVX2();
+bool CpuHasSSSE3();
+
+// Whether a ScopedScalarKernels is alive.
+bool ScalarKernelsForced();
+
+// The vector kernels for one module, picked by |select| the first time
+// they're needed, and the portable scalar kernels they must agree with.
+// |Kernels| is a struct of function pointers.
+template <typename Kernels>
+class KernelDispatch {
+ public:
+  KernelDispatch(Kernels (*select)(), const Kernels& scalar)
+      : best_(select()), scalar_(scalar) {}
+
+  const Kernels& get() const {
+    return ScalarKernelsForced() ? scalar_ : best_;
+  }
+
+ private:
+  const Kernels best_;
+  const Kernels scalar_;
+};
+
+// For tests and benchmarks only: every KernelDispatch hands out its scalar
+// kernels while one of these lives with |force| set.
+class ScopedScalarKernels {
+ public:
+  explicit ScopedScalarKernels(bool force = true);
+  ~ScopedScalarKernels();
+
+ private:
+  bool previous_;
+};
+
+#endif  // SRC_UTILITIES_CPU_DISPATCH_H_
@@ -0,0 +1,58 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#include "utilities/hash.h"
+
+#include <cstring>
+
+uint64_t HashBytes(std::string_view data, uint64_t seed) {
+  // Eight bytes at a time in four independent lanes, several times faster
+  // than a byte at a time hash such as FNV-1a on a whole SEEN.TXT.
+  const uint64_t kMultiplier = 0x9e3779b97f4a7c15ULL;
+  uint64_t lanes[4] = {data.size() ^ seed, 1, 2, 3};
+  auto mix = [&](const char* block) {
+    for (int lane = 0; lane < 4; ++lane) {
+      uint64_t word;
+      memcpy(&word, block + lane * 8, 8);
+      lanes[lane] = (lanes[lane] ^ word) * kMultiplier;
+      lanes[lane] ^= lanes[lane] >> 29;
+    }
+  };
+
+  size_t i = 0;
+  for (; i + 32 <= data.size(); i += 32)
+    mix(data.data() + i);
+  char tail[32] = {0};
+  memcpy(tail, data.data() + i, data.size() - i);
+  mix(tail);
+
+  uint64_t hash = 0;
+  for (uint64_t lane : lanes) {
+    hash = (hash ^ lane) * kMultiplier;
+    hash ^= hash >> 32;
+  }
+  return hash;
+}
@@ -23,14 +23,16 @@
 #ifndef SRC_UTILITIES_LAZY_ARRAY_H_
 #define SRC_UTILITIES_LAZY_ARRAY_H_
 
-#include <boost/checked_delete.hpp>
 #include <boost/iterator/iterator_facade.hpp>
 #include <boost/serialization/split_member.hpp>
 
-#include <algorithm>
+#include <cstdint>
 #include <memory>
+#include <new>
 #include <ostream>
 #include <stdexcept>
+#include <utility>
+#include <vector>
 
 // Forward declaration
 template <typename T>
@@ -50,7 +52,12 @@ class FullLazyArrayIterator;
 // foreground layer at exit. Planetarian leaves 3 objects
 // allocated. Kanon leaves 10.
 //
-// TODO(erg): Think about caching firstEntry for the iterators...
+// Which slots are allocated is kept in a bitmap, with a second bitmap saying
+// which words of the first have any bits set, so walking the allocated items
+// skips empty stretches a word at a time instead of a slot at a time. The
+// items themselves live in chunks of kChunkSize slots, each allocated the
+// first time one of its slots is used; neighbouring items sit next to each
+// other in memory and never move.
 template <typename T>
 class LazyArray {
  public:
@@ -68,7 +75,9 @@ class LazyArray {
   // Returns the size of the array.
   int size() const { return size_; }
 
-  bool exists(int index) const { return array_[index] != NULL; }
+  bool exists(int index) const {
+    return (words_[index / kWordBits] >> (index % kWordBits)) & 1;
+  }
 
   // Deletes an object at |index| if it exists.
   void DeleteAt(int index);
@@ -100,8 +109,24 @@ class LazyArray {
   }
 
  private:
+  static const int kWordBits = 64;
+  static const int kChunkSize = kWordBits;
+
+  struct ChunkDeleter {
+    void operator()(void* chunk) const { ::operator delete(chunk); }
+  };
+  typedef std::unique_ptr<void, ChunkDeleter> Chunk;
+
   int size_;
-  mutable std::unique_ptr<T*[]> array_;
+
+  // One bit per slot, set when the slot holds an item.
+  mutable std::vector<uint64_t> words_;
+
+  // One bit per word of |words_|, set when that word isn't zero.
+  mutable std::vector<uint64_t> summary_;
+
+  // Storage for the items, one chunk per word of |words_|.
+  mutable std::vector<Chunk> chunks_;
 
   template <class>
   friend class FullLazyArrayIterator;
@@ -109,18 +134,43 @@ class LazyArray {
   friend class AllocatedLazyArrayIterator;
 
   T* rawDeref(int pos);
+  const T* rawDeref(int pos) const;
+
+  // Where the item in |pos| lives, allocating its chunk if needed.
+  T* Slot(int pos) const;
+
+  // Marks |pos| as holding an item or not.
+  void SetBit(int pos) const;
+  void ClearBit(int pos);
+
+  // Returns the index of the lowest set bit in |bits|, which can't be zero.
+  static int LowestSetBit(uint64_t bits);
+
+  // Returns the first allocated slot at or after |pos|, or size() if none.
+  int FindNext(int pos) const;
+
+  // Destroys every item and resizes the array to |size| empty slots.
+  void Reset(int size);
 
   friend class boost::serialization::access;
 
   // boost::serialization loading
   template <class Archive>
   void load(Archive& ar, unsigned int version) {
-    // Allocate our new array
-    ar& size_;
-    array_.reset(new T* [size_]);
+    int size;
+    ar& size;
+    Reset(size);
 
+    // Items are stored as pointers, as they were when each one had its own
+    // heap allocation; move what was loaded into its slot.
     for (int i = 0; i < size_; ++i) {
-      ar& array_[i];
+      T* entry = NULL;
+      ar& entry;
+      if (entry) {
+        std::unique_ptr<T> loaded(entry);
+        new (Slot(i)) T(std::move(*loaded));
+        SetBit(i);
+      }
     }
   }
 
@@ -131,7 +181,8 @@ class LazyArray {
     ar& size_;
 
     for (int i = 0; i < size_; ++i) {
-      ar& array_[i];
+      T* const entry = const_cast<T*>(rawDeref(i));
+      ar& entry;
     }
   }
 
@@ -216,10 +267,7 @@ class AllocatedLazyArrayIterator
   }
 
   void increment() {
-    current_position_++;
-    while (current_position_ < array_->size() &&
-           array_->rawDeref(current_position_) == NULL)
-      current_position_++;
+    current_position_ = array_->FindNext(current_position_ + 1);
   }
 
   Value& dereference() const { return *(array_->rawDeref(current_position_)); }
@@ -234,20 +282,102 @@ class AllocatedLazyArrayIterator
 
 template <typename T>
 LazyArray<T>::LazyArray(int size)
-    : size_(size), array_(new T* [size]) {
-  for (int i = 0; i < size_; ++i)
-    array_[i] = NULL;
+    : size_(0) {
+  Reset(size);
 }
 
 template <typename T>
 LazyArray<T>::~LazyArray() {
-  std::for_each(
-      array_.get(), array_.get() + size_, std::default_delete<T>());
+  Clear();
 }
 
 template <typename T>
 T* LazyArray<T>::rawDeref(int pos) {
-  return array_[pos];
+  return exists(pos) ? Slot(pos) : NULL;
+}
+
+template <typename T>
+const T* LazyArray<T>::rawDeref(int pos) const {
+  return exists(pos) ? Slot(pos) : NULL;
+}
+
+template <typename T>
+T* LazyArray<T>::Slot(int pos) const {
+  Chunk& chunk = chunks_[pos / kChunkSize];
+  if (!chunk)
+    chunk.reset(::operator new(kChunkSize * sizeof(T)));
+
+  return static_cast<T*>(chunk.get()) + pos % kChunkSize;
+}
+
+template <typename T>
+void LazyArray<T>::SetBit(int pos) const {
+  int word = pos / kWordBits;
+  words_[word] |= uint64_t(1) << (pos % kWordBits);
+  summary_[word / kWordBits] |= uint64_t(1) << (word % kWordBits);
+}
+
+template <typename T>
+void LazyArray<T>::ClearBit(int pos) {
+  int word = pos / kWordBits;
+  words_[word] &= ~(uint64_t(1) << (pos % kWordBits));
+  if (words_[word] == 0)
+    summary_[word / kWordBits] &= ~(uint64_t(1) << (word % kWordBits));
+}
+
+template <typename T>
+int LazyArray<T>::LowestSetBit(uint64_t bits) {
+#if defined(__GNUC__)
+  return __builtin_ctzll(bits);
+#else
+  int index = 0;
+  for (int shift = kWordBits / 2; shift; shift /= 2) {
+    if (!(bits & ((uint64_t(1) << shift) - 1))) {
+      bits >>= shift;
+      index += shift;
+    }
+  }
+  return index;
+#endif
+}
+
+template <typename T>
+int LazyArray<T>::FindNext(int pos) const {
+  if (pos >= size_)
+    return size_;
+
+  int word = pos / kWordBits;
+  uint64_t bits = words_[word] & (~uint64_t(0) << (pos % kWordBits));
+  if (bits)
+    return word * kWordBits + LowestSetBit(bits);
+
+  // Find the next word with anything in it.
+  ++word;
+  int summary_index = word / kWordBits;
+  if (summary_index >= static_cast<int>(summary_.size()))
+    return size_;
+  uint64_t summary_bits =
+      summary_[summary_index] & (~uint64_t(0) << (word % kWordBits));
+  while (!summary_bits) {
+    if (++summary_index == static_cast<int>(summary_.size()))
+      return size_;
+    summary_bits = summary_[summary_index];
+  }
+
+  word = summary_index * kWordBits + LowestSetBit(summary_bits);
+  return word * kWordBits + LowestSetBit(words_[word]);
+}
+
+template <typename T>
+void LazyArray<T>::Reset(int size) {
+  Clear();
+
+  size_ = size;
+  int words = (size + kWordBits - 1) / kWordBits;
+  words_.assign(words, 0);
+  summary_.assign((words + kWordBits - 1) / kWordBits, 0);
+  chunks_.clear();
+  chunks_.resize(words);
 }
 
 template <typename T>
@@ -255,11 +385,13 @@ T& LazyArray<T>::operator[](int pos) {
   if (pos < 0 || pos >= size_)
     throw std::out_of_range("LazyArray::operator[]");
 
-  if (array_[pos] == NULL) {
-    array_[pos] = new T();
+  T* slot = Slot(pos);
+  if (!exists(pos)) {
+    new (slot) T();
+    SetBit(pos);
   }
 
-  return *(array_[pos]);
+  return *slot;
 }
 
 template <typename T>
@@ -267,25 +399,28 @@ const T& LazyArray<T>::operator[](int pos) const {
   if (pos < 0 || pos >= size_)
     throw std::out_of_range("LazyArray::operator[]");
 
-  if (array_[pos] == NULL) {
-    array_[pos] = new T();
+  T* slot = Slot(pos);
+  if (!exists(pos)) {
+    new (slot) T();
+    SetBit(pos);
   }
 
-  return *(array_[pos]);
+  return *slot;
 }
 
 template <typename T>
 void LazyArray<T>::DeleteAt(int i) {
-  boost::checked_delete<T>(array_[i]);
-  array_[i] = NULL;
+  if (exists(i)) {
+    // Clear the bit first so the item isn't listed while it's destroyed.
+    ClearBit(i);
+    Slot(i)->~T();
+  }
 }
 
 template <typename T>
 void LazyArray<T>::Clear() {
-  for (int i = 0; i < size_; ++i) {
-    boost::checked_delete<T>(array_[i]);
-    array_[i] = NULL;
-  }
+  for (int i = FindNext(0); i < size_; i = FindNext(i + 1))
+    DeleteAt(i);
 }
 
 template <typename T>
@@ -294,30 +429,37 @@ void LazyArray<T>::CopyTo(LazyArray<T>& otherArray) {
     throw std::runtime_error(
         "Not enough space in target array in LazyArray::copyTo");
 
+  // Slots past our size are dropped from the target.
+  for (int i = otherArray.FindNext(size_); i < otherArray.size_;
+       i = otherArray.FindNext(i + 1)) {
+    otherArray.DeleteAt(i);
+  }
   otherArray.size_ = size_;
-  for (int i = 0; i < size_; ++i) {
-    T* srcEntry = rawDeref(i);
-    T* dstEntry = otherArray.rawDeref(i);
-
-    if (srcEntry && !dstEntry) {
-      otherArray.array_[i] = new T(*srcEntry);
-    } else if (!srcEntry && dstEntry) {
-      boost::checked_delete<T>(otherArray.array_[i]);
-      otherArray.array_[i] = NULL;
-    } else if (srcEntry && dstEntry) {
-      *dstEntry = *srcEntry;
+
+  // Only the words where either array has an item need looking at.
+  for (int word = 0; word < static_cast<int>(words_.size()); ++word) {
+    uint64_t bits = words_[word] | otherArray.words_[word];
+    while (bits) {
+      int i = word * kWordBits + LowestSetBit(bits);
+      bits &= bits - 1;
+
+      T* srcEntry = rawDeref(i);
+      T* dstEntry = otherArray.rawDeref(i);
+      if (srcEntry && !dstEntry) {
+        new (otherArray.Slot(i)) T(*srcEntry);
+        otherArray.SetBit(i);
+      } else if (!srcEntry && dstEntry) {
+        otherArray.DeleteAt(i);
+      } else {
+        *dstEntry = *srcEntry;
+      }
     }
   }
 }
 
 template <typename T>
 AllocatedLazyArrayIterator<T> LazyArray<T>::begin() {
-  // Find the first
-  int firstEntry = 0;
-  while (firstEntry < size_ && array_[firstEntry] == NULL)
-    firstEntry++;
-
-  return AllocatedLazyArrayIterator<T>(firstEntry, this);
+  return AllocatedLazyArrayIterator<T>(FindNext(0), this);
 }
 
 #endif  // SRC_UTILITIES_LAZY_ARRAY_H_
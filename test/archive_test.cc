@@ -0,0 +1,293 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#include "gtest/gtest.h"
+
+#include <boost/filesystem.hpp>
+
+#include <ctime>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "libreallive/archive.h"
+#include "libreallive/bytecode.h"
+#include "libreallive/intmemref.h"
+#include "libreallive/scenario_cache.h"
+#include "machine/rlmachine.h"
+#include "modules/module_jmp.h"
+#include "test_system/test_system.h"
+
+#include "test_utils.h"
+
+namespace fs = boost::filesystem;
+
+using libreallive::Archive;
+using libreallive::IntMemRef;
+using libreallive::Scenario;
+using libreallive::ScenarioCache;
+
+// Preloading should parse every scenario in the archive and hand back the same
+// objects that a later lazy lookup returns.
+TEST(ArchiveTest, PreloadAllScenarios) {
+  Archive arc(locateTestCase("Module_Jmp_SEEN/farcallTest_0.TXT"));
+  EXPECT_TRUE(arc.GetScenarioParseTimes().empty());
+
+  arc.PreloadAllScenarios(4);
+
+  auto times = arc.GetScenarioParseTimes();
+  ASSERT_EQ(2u, times.size());
+  EXPECT_EQ(1u, times.count(1));
+  EXPECT_EQ(1u, times.count(2));
+
+  Scenario* first = arc.GetScenario(1);
+  ASSERT_NE(nullptr, first);
+  EXPECT_EQ(1, first->scene_number());
+  EXPECT_EQ(first, arc.GetScenario(1));
+  EXPECT_EQ(nullptr, arc.GetScenario(3));
+
+  // Nothing should have been reparsed.
+  EXPECT_EQ(2u, arc.GetScenarioParseTimes().size());
+}
+
+// Seeing a '!' entrypoint changes how text is split, but only within the
+// scenario being parsed, so parallel preloading can't leak it into another.
+TEST(ArchiveTest, EntrypointMarkerIsPerScenario) {
+  using libreallive::BytecodeElement;
+  using libreallive::BytecodeFactory;
+  using libreallive::ConstructionData;
+
+  const std::string entrypoint("!\0\0", 3);
+  const std::string text = "ab!cd";
+
+  ConstructionData with_entrypoints(1, libreallive::pointer_t());
+  with_entrypoints.kidoku_table[0] = 1000000;
+  std::unique_ptr<BytecodeElement> marker(BytecodeFactory::Read(
+      entrypoint.data(), entrypoint.data() + entrypoint.size(),
+      with_entrypoints));
+  EXPECT_EQ(0, marker->GetEntrypoint());
+  std::unique_ptr<BytecodeElement> split(BytecodeFactory::Read(
+      text.data(), text.data() + text.size(), with_entrypoints));
+  EXPECT_EQ(2u, split->GetBytecodeLength());
+
+  ConstructionData without_entrypoints(0, libreallive::pointer_t());
+  std::unique_ptr<BytecodeElement> whole(BytecodeFactory::Read(
+      text.data(), text.data() + text.size(), without_entrypoints));
+  EXPECT_EQ(text.size(), whole->GetBytecodeLength());
+}
+
+// A machine must be able to run while the archive is still being parsed in the
+// background.
+TEST(ArchiveTest, RunsDuringBackgroundPreload) {
+  for (int i = 0; i < 10; ++i) {
+    Archive arc(locateTestCase("Module_Jmp_SEEN/farcallTest_0.TXT"));
+    arc.PreloadAllScenariosInBackground(2);
+    TestSystem system;
+    RLMachine rlmachine(system, arc);
+    rlmachine.AttachModule(new JmpModule);
+    rlmachine.SetIntValue(IntMemRef('B', 0), 1);
+    rlmachine.ExecuteUntilHalted();
+
+    EXPECT_EQ(1, rlmachine.GetIntValue(IntMemRef('A', 0)));
+    EXPECT_EQ(1, rlmachine.GetIntValue(IntMemRef('A', 2)));
+  }
+}
+
+class ScenarioCacheTest : public ::testing::Test {
+ protected:
+  ScenarioCacheTest()
+      : dir_(fs::temp_directory_path() / fs::unique_path()),
+        cache_(dir_ / "scenario.cache") {
+    fs::create_directories(dir_);
+  }
+  ~ScenarioCacheTest() { fs::remove_all(dir_); }
+
+  fs::path dir_;
+  fs::path cache_;
+};
+
+// The first open writes the cache; the second must be served from it and
+// still run the farcall between the two scenarios correctly.
+TEST_F(ScenarioCacheTest, WarmStartUsesCache) {
+  {
+    Archive arc(locateTestCase("Module_Jmp_SEEN/farcallTest_0.TXT"));
+    EXPECT_FALSE(arc.UseScenarioCache(cache_));
+    EXPECT_TRUE(fs::exists(cache_));
+  }
+
+  for (int i = 1; i < 4; ++i) {
+    Archive arc(locateTestCase("Module_Jmp_SEEN/farcallTest_0.TXT"));
+    EXPECT_TRUE(arc.UseScenarioCache(cache_));
+    TestSystem system;
+    RLMachine rlmachine(system, arc);
+    rlmachine.AttachModule(new JmpModule);
+    rlmachine.SetIntValue(IntMemRef('B', 0), i);
+    rlmachine.ExecuteUntilHalted();
+
+    EXPECT_EQ(1, rlmachine.GetIntValue(IntMemRef('A', 0)));
+    EXPECT_EQ(i, rlmachine.GetIntValue(IntMemRef('A', 1)));
+    EXPECT_EQ(1, rlmachine.GetIntValue(IntMemRef('A', 2)));
+  }
+}
+
+// A cache written for a different SEEN.TXT must be ignored and replaced.
+TEST_F(ScenarioCacheTest, RejectsCacheForOtherArchive) {
+  {
+    Archive arc(locateTestCase("Module_Jmp_SEEN/fibonacci.TXT"));
+    EXPECT_FALSE(arc.UseScenarioCache(cache_));
+  }
+
+  Archive arc(locateTestCase("Module_Jmp_SEEN/farcallTest_0.TXT"));
+  EXPECT_FALSE(arc.UseScenarioCache(cache_));
+
+  Archive again(locateTestCase("Module_Jmp_SEEN/farcallTest_0.TXT"));
+  EXPECT_TRUE(again.UseScenarioCache(cache_));
+}
+
+// A newer modification time alone only costs a rehash of the contents; new
+// contents under a new time are rejected.
+TEST_F(ScenarioCacheTest, TouchedArchiveIsRehashed) {
+  const fs::path seen = dir_ / "SEEN.TXT";
+  const std::time_t written = std::time(nullptr) - 3600;
+  fs::copy_file(locateTestCase("Module_Jmp_SEEN/farcallTest_0.TXT"), seen);
+  fs::last_write_time(seen, written);
+  {
+    Archive arc(seen.string());
+    EXPECT_FALSE(arc.UseScenarioCache(cache_));
+  }
+
+  fs::last_write_time(seen, written + 60);
+  {
+    Archive arc(seen.string());
+    EXPECT_TRUE(arc.UseScenarioCache(cache_));
+  }
+
+  fs::copy_file(locateTestCase("Module_Jmp_SEEN/fibonacci.TXT"), seen,
+                fs::copy_option::overwrite_if_exists);
+  fs::last_write_time(seen, written + 120);
+  {
+    Archive arc(seen.string());
+    EXPECT_FALSE(arc.UseScenarioCache(cache_));
+  }
+
+  Archive arc(seen.string());
+  EXPECT_TRUE(arc.UseScenarioCache(cache_));
+}
+
+// A file modified within the resolution of its modification time can change
+// again without its stamp changing, so its contents are always rehashed.
+TEST_F(ScenarioCacheTest, RecentlyWrittenArchiveIsAlwaysRehashed) {
+  const fs::path seen = dir_ / "SEEN.TXT";
+  const std::time_t written = std::time(nullptr);
+  fs::copy_file(locateTestCase("Module_Jmp_SEEN/farcallTest_0.TXT"), seen);
+  fs::last_write_time(seen, written);
+  {
+    Archive arc(seen.string());
+    EXPECT_FALSE(arc.UseScenarioCache(cache_));
+  }
+
+  // Same size, same modification time, different last byte.
+  {
+    std::fstream file(seen.string(),
+                      std::ios::binary | std::ios::in | std::ios::out);
+    file.seekg(-1, std::ios::end);
+    const char last = static_cast<char>(file.get());
+    file.seekp(-1, std::ios::end);
+    file.put(static_cast<char>(last ^ 0xff));
+  }
+  fs::last_write_time(seen, written);
+
+  Archive arc(seen.string());
+  EXPECT_FALSE(arc.UseScenarioCache(cache_));
+}
+
+// A stamp mismatch with matching contents replaces the file with a restamped
+// copy, so only the first launch after a touch pays for the hash.
+TEST_F(ScenarioCacheTest, RestampsAfterMatchingHash) {
+  ASSERT_TRUE(ScenarioCache::Write(cache_, 1, 7, {}));
+
+  int hashes = 0;
+  auto compute_key = [&hashes]() {
+    ++hashes;
+    return uint64_t(7);
+  };
+  {
+    std::unique_ptr<ScenarioCache> cache =
+        ScenarioCache::Open(cache_, 2, compute_key);
+    EXPECT_TRUE(cache);
+    EXPECT_EQ(1, hashes);
+  }
+
+  EXPECT_TRUE(ScenarioCache::Open(cache_, 2, compute_key));
+  EXPECT_EQ(1, hashes);
+
+  // kNoStamp is never trusted, nor written back.
+  EXPECT_TRUE(ScenarioCache::Open(cache_, ScenarioCache::kNoStamp,
+                                  compute_key));
+  EXPECT_TRUE(ScenarioCache::Open(cache_, ScenarioCache::kNoStamp,
+                                  compute_key));
+  EXPECT_EQ(3, hashes);
+  EXPECT_TRUE(ScenarioCache::Open(cache_, 2, compute_key));
+  EXPECT_EQ(3, hashes);
+
+  EXPECT_FALSE(ScenarioCache::Open(cache_, 3, []() { return uint64_t(8); }));
+}
+
+// Scenarios built from the cache point into its mapping rather than copying
+// the bytecode out.
+TEST_F(ScenarioCacheTest, WarmScenariosBorrowCachedBytecode) {
+  std::string bytecode;
+  {
+    Archive arc(locateTestCase("Module_Jmp_SEEN/goto_case_0.TXT"));
+    EXPECT_FALSE(arc.UseScenarioCache(cache_));
+    EXPECT_FALSE(arc.scenario_cache());
+    bytecode = std::string(arc.GetFirstScenario()->bytecode());
+  }
+
+  for (int i = 0; i < 3; ++i) {
+    Archive arc(locateTestCase("Module_Jmp_SEEN/goto_case_0.TXT"));
+    EXPECT_TRUE(arc.UseScenarioCache(cache_));
+    Scenario* scenario = arc.GetFirstScenario();
+    EXPECT_EQ(bytecode, scenario->bytecode());
+
+    const libreallive::CachedScript* cached =
+        arc.scenario_cache()->Find(scenario->scene_number());
+    ASSERT_TRUE(cached);
+    const char* mapping = cached->file()->get();
+    const char* data = scenario->bytecode().data();
+    EXPECT_GE(data, mapping);
+    EXPECT_LE(data + bytecode.size(), mapping + cached->file()->size());
+
+    // It still runs, reading its case labels out of the mapping.
+    TestSystem system;
+    RLMachine rlmachine(system, arc);
+    rlmachine.AttachModule(new JmpModule);
+    rlmachine.SetIntValue(IntMemRef('B', 0), i);
+    rlmachine.ExecuteUntilHalted();
+    EXPECT_EQ(i, rlmachine.GetIntValue(IntMemRef('A', 0)));
+  }
+}
@@ -0,0 +1,310 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "systems/base/audio_mixer.h"
+#include "utilities/cpu_dispatch.h"
+
+namespace {
+
+const int kRate = 1000;
+
+// A clip holding |frames| frames of |left| and |right|.
+std::shared_ptr<AudioClip> ConstantClip(size_t frames,
+                                        float left,
+                                        float right) {
+  std::vector<float> samples;
+  for (size_t i = 0; i < frames; ++i) {
+    samples.push_back(left);
+    samples.push_back(right);
+  }
+  return std::make_shared<AudioClip>(std::move(samples));
+}
+
+// A clip whose frame i is (i, -i) / |frames|.
+std::shared_ptr<AudioClip> RampClip(size_t frames) {
+  std::vector<float> samples;
+  for (size_t i = 0; i < frames; ++i) {
+    samples.push_back(static_cast<float>(i) / frames);
+    samples.push_back(-static_cast<float>(i) / frames);
+  }
+  return std::make_shared<AudioClip>(std::move(samples));
+}
+
+}  // namespace
+
+TEST(AudioClipTest, ConvertsPCM16) {
+  const int16_t stereo[] = {16384, -32768, 0, 8192};
+  std::shared_ptr<AudioClip> clip = AudioClip::FromPCM16(stereo, 2, 2);
+  ASSERT_EQ(2u, clip->frames());
+  EXPECT_FLOAT_EQ(0.5f, clip->samples()[0]);
+  EXPECT_FLOAT_EQ(-1.0f, clip->samples()[1]);
+  EXPECT_FLOAT_EQ(0.25f, clip->samples()[3]);
+
+  // Mono plays on both sides.
+  const int16_t mono[] = {16384, -8192};
+  clip = AudioClip::FromPCM16(mono, 2, 1);
+  ASSERT_EQ(2u, clip->frames());
+  EXPECT_FLOAT_EQ(0.5f, clip->samples()[0]);
+  EXPECT_FLOAT_EQ(0.5f, clip->samples()[1]);
+  EXPECT_FLOAT_EQ(-0.25f, clip->samples()[3]);
+}
+
+TEST(AudioMixerTest, PlaysClipAtFullVolume) {
+  AudioMixer mixer(kRate, 4);
+  NullAudioSink sink(mixer);
+  std::shared_ptr<AudioClip> clip = RampClip(100);
+
+  mixer.Play(1, clip, false);
+  sink.Render(100);
+  ASSERT_EQ(200u, sink.output().size());
+  for (size_t i = 0; i < 200; ++i)
+    EXPECT_FLOAT_EQ(clip->samples()[i], sink.output()[i]) << i;
+}
+
+TEST(AudioMixerTest, SumsChannels) {
+  AudioMixer mixer(kRate, 4);
+  NullAudioSink sink(mixer);
+
+  mixer.Play(0, ConstantClip(64, 0.25f, 0.5f), false);
+  mixer.Play(3, ConstantClip(64, 0.125f, -0.25f), false);
+  sink.Render(64);
+  for (size_t i = 0; i < 64; ++i) {
+    EXPECT_FLOAT_EQ(0.375f, sink.output()[i * 2]);
+    EXPECT_FLOAT_EQ(0.25f, sink.output()[i * 2 + 1]);
+  }
+}
+
+TEST(AudioMixerTest, PlayingTracksQueuedCommandsAndClipEnd) {
+  AudioMixer mixer(kRate, 2);
+  NullAudioSink sink(mixer);
+
+  // Playing as soon as it's queued, before the audio thread sees it.
+  mixer.Play(0, ConstantClip(50, 1.0f, 1.0f), false);
+  EXPECT_TRUE(mixer.IsPlaying(0));
+  EXPECT_FALSE(mixer.IsPlaying(1));
+
+  sink.Render(32);
+  EXPECT_TRUE(mixer.IsPlaying(0));
+  sink.Render(32);
+  EXPECT_FALSE(mixer.IsPlaying(0));
+
+  // The rest of the block after the clip ended is silence.
+  EXPECT_FLOAT_EQ(1.0f, sink.output()[49 * 2]);
+  EXPECT_FLOAT_EQ(0.0f, sink.output()[50 * 2]);
+
+  mixer.Play(1, ConstantClip(50, 1.0f, 1.0f), true);
+  mixer.Stop(1);
+  EXPECT_FALSE(mixer.IsPlaying(1));
+  sink.Render(8);
+  EXPECT_FALSE(mixer.IsPlaying(1));
+}
+
+TEST(AudioMixerTest, LoopsUntilStopped) {
+  AudioMixer mixer(kRate, 1);
+  NullAudioSink sink(mixer);
+  std::shared_ptr<AudioClip> clip = RampClip(30);
+
+  mixer.Play(0, clip, true);
+  sink.Render(100);
+  EXPECT_TRUE(mixer.IsPlaying(0));
+  for (size_t i = 0; i < 100; ++i)
+    EXPECT_FLOAT_EQ(clip->samples()[(i % 30) * 2], sink.output()[i * 2]) << i;
+
+  mixer.Stop(0);
+  sink.Render(10);
+  EXPECT_FALSE(mixer.IsPlaying(0));
+  EXPECT_FLOAT_EQ(0.0f, sink.output()[105 * 2 + 1]);
+}
+
+TEST(AudioMixerTest, FadesInOverEnvelope) {
+  AudioMixer mixer(kRate, 1);
+  NullAudioSink sink(mixer);
+
+  // 100ms at 1000Hz is 100 frames.
+  mixer.Play(0, ConstantClip(400, 1.0f, 1.0f), false, 100);
+  sink.Render(200);
+  const std::vector<float>& out = sink.output();
+  EXPECT_FLOAT_EQ(0.0f, out[0]);
+  EXPECT_NEAR(0.5f, out[50 * 2], 1e-5);
+  for (size_t i = 1; i < 100; ++i)
+    EXPECT_GT(out[i * 2], out[(i - 1) * 2]) << i;
+  for (size_t i = 100; i < 200; ++i)
+    EXPECT_FLOAT_EQ(1.0f, out[i * 2]) << i;
+}
+
+TEST(AudioMixerTest, FadesOutAndStops) {
+  AudioMixer mixer(kRate, 1);
+  NullAudioSink sink(mixer);
+
+  mixer.Play(0, ConstantClip(400, 1.0f, 1.0f), true);
+  sink.Render(10);
+  mixer.FadeOut(0, 40);
+  EXPECT_TRUE(mixer.IsPlaying(0));
+  sink.Render(20);
+  EXPECT_TRUE(mixer.IsPlaying(0));
+  sink.Render(30);
+  EXPECT_FALSE(mixer.IsPlaying(0));
+
+  const std::vector<float>& out = sink.output();
+  EXPECT_FLOAT_EQ(1.0f, out[10 * 2]);
+  EXPECT_NEAR(0.5f, out[30 * 2], 1e-5);
+  for (size_t i = 11; i < 50; ++i)
+    EXPECT_LT(out[i * 2], out[(i - 1) * 2]) << i;
+  for (size_t i = 50; i < 60; ++i)
+    EXPECT_FLOAT_EQ(0.0f, out[i * 2]) << i;
+}
+
+TEST(AudioMixerTest, RampsVolumeChangesOverOneBlock) {
+  AudioMixer mixer(kRate, 1);
+  NullAudioSink sink(mixer);
+
+  // Set before playing, the volume applies immediately.
+  mixer.SetVolume(0, 0.5f);
+  mixer.Play(0, ConstantClip(400, 1.0f, 1.0f), false);
+  sink.Render(64);
+  EXPECT_FLOAT_EQ(0.5f, sink.output()[0]);
+  EXPECT_FLOAT_EQ(0.5f, sink.output()[63 * 2]);
+
+  mixer.SetVolume(0, 0.25f);
+  sink.Render(64);
+  const std::vector<float>& out = sink.output();
+  EXPECT_FLOAT_EQ(0.5f, out[64 * 2]);
+  EXPECT_NEAR(0.25f + 0.25f / 64, out[127 * 2], 1e-5);
+  for (size_t i = 65; i < 128; ++i)
+    EXPECT_LT(out[i * 2], out[(i - 1) * 2]) << i;
+
+  sink.Render(16);
+  EXPECT_FLOAT_EQ(0.25f, sink.output()[140 * 2]);
+}
+
+TEST(AudioMixerTest, StopAllStopsEveryChannel) {
+  AudioMixer mixer(kRate, 3);
+  NullAudioSink sink(mixer);
+  for (int i = 0; i < 3; ++i)
+    mixer.Play(i, ConstantClip(100, 0.1f, 0.1f), true);
+  sink.Render(10);
+
+  mixer.StopAll();
+  for (int i = 0; i < 3; ++i)
+    EXPECT_FALSE(mixer.IsPlaying(i));
+  sink.Render(10);
+  EXPECT_FLOAT_EQ(0.0f, sink.output()[15 * 2]);
+}
+
+TEST(AudioMixerTest, ReleasesClipsOnceTheAudioThreadIsDone) {
+  AudioMixer mixer(kRate, 2);
+  NullAudioSink sink(mixer);
+  std::shared_ptr<AudioClip> first = ConstantClip(100, 1.0f, 1.0f);
+  std::shared_ptr<AudioClip> second = ConstantClip(10, 1.0f, 1.0f);
+  std::weak_ptr<AudioClip> first_ref = first, second_ref = second;
+
+  mixer.Play(0, std::move(first), true);
+  mixer.Play(1, std::move(second), false);
+  sink.Render(8);
+
+  // Replacing the clip keeps the old one alive until the audio thread has
+  // moved on from it.
+  mixer.Play(0, ConstantClip(10, 0.0f, 0.0f), false);
+  mixer.CollectGarbage();
+  EXPECT_FALSE(first_ref.expired());
+
+  sink.Render(16);
+  mixer.CollectGarbage();
+  EXPECT_TRUE(first_ref.expired());
+  EXPECT_TRUE(second_ref.expired());
+}
+
+TEST(AudioMixerTest, DropsCommandsWhenNothingDrainsTheQueue) {
+  AudioMixer mixer(kRate, 1);
+  for (int i = 0; i < 1000; ++i)
+    mixer.SetVolume(0, 1.0f);
+  EXPECT_GT(mixer.dropped_commands(), 0);
+
+  // Once the audio thread runs again, commands go through.
+  NullAudioSink sink(mixer);
+  sink.Render(1);
+  mixer.Play(0, ConstantClip(10, 1.0f, 1.0f), false);
+  sink.Render(1);
+  EXPECT_FLOAT_EQ(1.0f, sink.output()[2]);
+}
+
+TEST(AudioMixerTest, MixesIntoS16WithSaturation) {
+  AudioMixer mixer(kRate, 2);
+  mixer.Play(0, ConstantClip(20, 0.5f, -0.5f), false);
+  mixer.Play(1, ConstantClip(20, 0.25f, -0.25f), false);
+
+  std::vector<int16_t> stream(40, 0);
+  stream[0] = 30000;
+  stream[1] = -30000;
+  mixer.MixIntoS16(stream.data(), 20);
+
+  EXPECT_EQ(32767, stream[0]);
+  EXPECT_EQ(-32768, stream[1]);
+  for (size_t i = 1; i < 20; ++i) {
+    EXPECT_EQ(24576, stream[i * 2]) << i;
+    EXPECT_EQ(-24576, stream[i * 2 + 1]) << i;
+  }
+}
+
+TEST(AudioMixerTest, VectorKernelsMatchScalar) {
+  std::mt19937 rng(25);
+  std::uniform_real_distribution<float> sample(-1.0f, 1.0f);
+  std::vector<std::shared_ptr<AudioClip>> clips;
+  for (int i = 0; i < 6; ++i) {
+    std::vector<float> samples(2 * (97 + i * 31));
+    for (float& s : samples)
+      s = sample(rng);
+    clips.push_back(std::make_shared<AudioClip>(std::move(samples)));
+  }
+
+  auto render = [&](bool scalar) {
+    ScopedScalarKernels kernels(scalar);
+    AudioMixer mixer(kRate, 6);
+    for (int i = 0; i < 6; ++i) {
+      mixer.SetVolume(i, 0.2f + 0.1f * i);
+      mixer.Play(i, clips[i], i % 2 == 0, i * 7);
+    }
+    std::vector<int16_t> stream(2 * 333, 0);
+    mixer.MixIntoS16(stream.data(), 111);
+    mixer.FadeOut(0, 50);
+    mixer.SetVolume(3, 0.9f);
+    mixer.MixIntoS16(stream.data() + 2 * 111, 222);
+    return stream;
+  };
+
+  std::vector<int16_t> scalar = render(true);
+  std::vector<int16_t> vector = render(false);
+  ASSERT_EQ(scalar.size(), vector.size());
+  for (size_t i = 0; i < scalar.size(); ++i)
+    EXPECT_NEAR(scalar[i], vector[i], 1) << i;
+}
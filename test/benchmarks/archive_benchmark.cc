@@ -0,0 +1,111 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#include "gtest/gtest.h"
+
+#include <boost/filesystem.hpp>
+
+#include <string>
+#include <vector>
+
+#include "benchmarks/benchmark_utils.h"
+#include "libreallive/archive.h"
+#include "libreallive/scenario.h"
+#include "test_utils.h"
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+const std::vector<std::string> kArchives = {
+    "ExpressionTest_SEEN/basicOperators.TXT",
+    "ExpressionTest_SEEN/comparisonOperators.TXT",
+    "Module_Jmp_SEEN/farcallTest_0.TXT",
+    "Module_Jmp_SEEN/fibonacci.TXT",
+    "Module_Str_SEEN/strcpy_0.TXT",
+};
+
+// Opens |seen| and builds every scenario in it, optionally through the cache.
+void OpenAndParse(const std::string& seen, const fs::path* cache) {
+  libreallive::Archive arc(seen);
+  if (cache)
+    arc.UseScenarioCache(*cache);
+  for (int i = 0; i < 10000; ++i)
+    arc.GetScenario(i);
+}
+
+}  // namespace
+
+// Compares a cold Archive open, which decompresses and tokenizes every
+// scenario, with a warm open that rebuilds them from the scenario cache.
+TEST(ArchiveBenchmark, ColdVersusWarmOpen) {
+  const fs::path dir = fs::temp_directory_path() / fs::unique_path();
+  fs::create_directories(dir);
+
+  for (const std::string& name : kArchives) {
+    const std::string seen = locateTestCase(name);
+    const fs::path cache = dir / (fs::path(name).stem().string() + ".cache");
+
+    // Prime the cache once so every warm iteration is a hit.
+    OpenAndParse(seen, &cache);
+    ASSERT_TRUE(fs::exists(cache));
+
+    double cold = RunBenchmark(name + " (cold)", 200,
+                               [&]() { OpenAndParse(seen, nullptr); });
+    double warm = RunBenchmark(name + " (warm)", 200,
+                               [&]() { OpenAndParse(seen, &cache); });
+    ReportBenchmarkValue(name + " speedup", cold / warm, "x");
+  }
+
+  fs::remove_all(dir);
+}
+
+// Reports the heap held by every scenario of each archive after a cold open,
+// which owns its decompressed bytecode, and after a warm one, which borrows
+// it from the mapped cache.
+TEST(ArchiveBenchmark, ScenarioHeapUsage) {
+  const fs::path dir = fs::temp_directory_path() / fs::unique_path();
+  fs::create_directories(dir);
+
+  for (const std::string& name : kArchives) {
+    const std::string seen = locateTestCase(name);
+    const fs::path cache = dir / (fs::path(name).stem().string() + ".cache");
+
+    size_t usage[2] = {0, 0};
+    for (int warm = 0; warm < 2; ++warm) {
+      libreallive::Archive arc(seen);
+      arc.UseScenarioCache(cache);
+      for (int i = 0; i < 10000; ++i) {
+        if (libreallive::Scenario* scenario = arc.GetScenario(i))
+          usage[warm] += scenario->GetHeapUsage();
+      }
+    }
+    ReportBenchmarkValue(name + " heap (cold)", usage[0], "bytes");
+    ReportBenchmarkValue(name + " heap (warm)", usage[1], "bytes");
+  }
+
+  fs::remove_all(dir);
+}
@@ -0,0 +1,105 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "benchmarks/benchmark_utils.h"
+#include "systems/base/audio_mixer.h"
+#include "utilities/cpu_dispatch.h"
+
+// Cost of mixing one 1024 frame block with 32 looping channels at 48kHz, into
+// the float bus and into a 16-bit device stream, with scalar and vector
+// kernels, steady and with every channel fading.
+TEST(AudioMixerBenchmark, MixBlock) {
+  const int kRate = 48000;
+  const int kChannels = 32;
+  const int kBlockFrames = 1024;
+  const int kIterations = 2000;
+
+  std::mt19937 rng(25);
+  std::uniform_real_distribution<float> sample(-0.03f, 0.03f);
+  std::vector<std::shared_ptr<AudioClip>> clips;
+  for (int i = 0; i < kChannels; ++i) {
+    // Two seconds, with lengths that don't share block boundaries.
+    std::vector<float> samples(2 * (kRate * 2 + i * 37));
+    for (float& s : samples)
+      s = sample(rng);
+    clips.push_back(std::make_shared<AudioClip>(std::move(samples)));
+  }
+
+  const double block_us = kBlockFrames * 1e6 / kRate;
+  for (bool scalar : {true, false}) {
+    ScopedScalarKernels force_scalar(scalar);
+    const std::string kernels = AudioMixerKernelName();
+
+    AudioMixer mixer(kRate, kChannels);
+    NullAudioSink sink(mixer);
+    for (int i = 0; i < kChannels; ++i) {
+      mixer.SetVolume(i, 0.5f + i / 64.0f);
+      mixer.Play(i, clips[i], true);
+    }
+
+    std::vector<float> bus(kBlockFrames * 2);
+    double steady = RunBenchmark(
+        "mix 32 channels, float (" + kernels + ")", kIterations,
+        [&]() { mixer.Mix(bus.data(), kBlockFrames); });
+
+    std::vector<int16_t> stream(kBlockFrames * 2);
+    double device = RunBenchmark(
+        "mix 32 channels, s16 (" + kernels + ")", kIterations,
+        [&]() { mixer.MixIntoS16(stream.data(), kBlockFrames); });
+
+    // Every channel in a long fade and a volume ramp, so each block goes
+    // through the envelope path.
+    for (int i = 0; i < kChannels; ++i) {
+      mixer.FadeOut(i, 60000);
+      mixer.SetVolume(i, 0.25f);
+    }
+    double fading = RunBenchmark(
+        "mix 32 channels fading, float (" + kernels + ")", kIterations,
+        [&]() { mixer.Mix(bus.data(), kBlockFrames); });
+
+    // Keep the null sink honest: the same mixer renders to memory.
+    sink.Render(kBlockFrames);
+    EXPECT_EQ(static_cast<size_t>(kBlockFrames * 2), sink.output().size());
+    for (int i = 0; i < kChannels; ++i)
+      EXPECT_TRUE(mixer.IsPlaying(i));
+
+    ReportBenchmarkValue("float block (" + kernels + ") per channel",
+                         steady * 1000 / kChannels, "ns");
+    ReportBenchmarkValue("float block (" + kernels + ") realtime share",
+                         steady * 100 / block_us, "%");
+    ReportBenchmarkValue("s16 block (" + kernels + ") realtime share",
+                         device * 100 / block_us, "%");
+    ReportBenchmarkValue("fading block (" + kernels + ") realtime share",
+                         fading * 100 / block_us, "%");
+  }
+}
@@ -0,0 +1,63 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#ifndef TEST_BENCHMARKS_BENCHMARK_UTILS_H_
+#define TEST_BENCHMARKS_BENCHMARK_UTILS_H_
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+// Runs |fn| |iterations| times, prints the mean wall time per iteration under
+// |name| and returns it in microseconds. Benchmarks are ordinary gtest cases
+// linked into rlvm_benchmarks, so they can use the same fixtures and null
+// systems as the unit tests.
+template <typename Function>
+double RunBenchmark(const std::string& name, int iterations, Function fn) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i)
+    fn();
+  std::chrono::duration<double, std::micro> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  double per_iteration = elapsed.count() / iterations;
+  std::cout << "[ BENCH    ] " << std::left << std::setw(48) << name
+            << std::right << std::fixed << std::setprecision(2)
+            << std::setw(12) << per_iteration << " us/iter" << std::endl;
+  return per_iteration;
+}
+
+// Prints an extra measurement (throughput, counts, etc) alongside the timings.
+inline void ReportBenchmarkValue(const std::string& name,
+                                 double value,
+                                 const std::string& unit) {
+  std::cout << "[ BENCH    ] " << std::left << std::setw(48) << name
+            << std::right << std::fixed << std::setprecision(2)
+            << std::setw(12) << value << " " << unit << std::endl;
+}
+
+#endif  // TEST_BENCHMARKS_BENCHMARK_UTILS_H_
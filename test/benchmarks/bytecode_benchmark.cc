@@ -0,0 +1,154 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#include "gtest/gtest.h"
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "benchmarks/allocation_counter.h"
+#include "benchmarks/benchmark_utils.h"
+#include "libreallive/archive.h"
+#include "libreallive/intmemref.h"
+#include "libreallive/scenario.h"
+#include "machine/rlmachine.h"
+#include "modules/module_jmp.h"
+#include "modules/module_str.h"
+#include "test_system/test_system.h"
+#include "test_utils.h"
+
+using libreallive::Archive;
+using libreallive::IntMemRef;
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+const std::vector<std::string> kArchives = {
+    "ExpressionTest_SEEN/basicOperators.TXT",
+    "Module_Jmp_SEEN/fibonacci.TXT",
+    "Module_Jmp_SEEN/gosub_case_0.TXT",
+    "Module_Str_SEEN/strcpy_0.TXT",
+};
+
+// The SEEN directories the large_*_test suites run.
+const std::vector<std::string> kLargeTestSuites = {
+    "Module_Jmp_SEEN", "Module_Mem_SEEN", "Module_Str_SEEN",
+    "Module_Sys_SEEN",
+};
+
+std::vector<std::string> LargeTestSuiteArchives() {
+  const fs::path root =
+      fs::path(locateTestCase("Module_Jmp_SEEN/fibonacci.TXT"))
+          .parent_path()
+          .parent_path();
+  std::vector<std::string> archives;
+  for (const std::string& suite : kLargeTestSuites) {
+    for (fs::directory_iterator it(root / suite), end; it != end; ++it) {
+      if (it->path().extension() == ".TXT")
+        archives.push_back(it->path().string());
+    }
+  }
+  std::sort(archives.begin(), archives.end());
+  return archives;
+}
+
+}  // namespace
+
+// Tokenizing a scenario should cost a handful of arena blocks rather than one
+// heap allocation per bytecode element.
+TEST(BytecodeBenchmark, ParseAllocations) {
+  for (const std::string& name : kArchives) {
+    const std::string seen = locateTestCase(name);
+    size_t elements = 0;
+    size_t allocations = 0;
+    RunBenchmark(name + " (open + parse)", 200, [&]() {
+      Archive arc(seen);
+      size_t before = GetAllocationCount();
+      libreallive::Scenario* scenario = arc.GetFirstScenario();
+      allocations = GetAllocationCount() - before;
+      elements = std::distance(scenario->begin(), scenario->end());
+    });
+    ReportBenchmarkValue(name + " elements", elements, "");
+    ReportBenchmarkValue(name + " allocations", allocations, "");
+  }
+}
+
+// Parses every scenario of every archive the large_*_test suites use, and
+// reports the heap traffic of parsing relative to the bytecode it covers.
+// The transient offset table used to resolve pointers is part of that.
+TEST(BytecodeBenchmark, ParseLargeTestSuites) {
+  const std::vector<std::string> archives = LargeTestSuiteArchives();
+  size_t scenarios = 0;
+  size_t elements = 0;
+  size_t bytecode = 0;
+  size_t allocations = 0;
+  size_t allocated = 0;
+  RunBenchmark(
+      std::to_string(archives.size()) + " archives (open + parse)", 20, [&]() {
+        scenarios = elements = bytecode = 0;
+        const size_t count_before = GetAllocationCount();
+        const size_t bytes_before = GetAllocatedBytes();
+        for (const std::string& seen : archives) {
+          Archive arc(seen);
+          arc.PreloadAllScenarios(1);
+          for (auto const& entry : arc.GetScenarioParseTimes()) {
+            libreallive::Scenario* scenario = arc.GetScenario(entry.first);
+            ++scenarios;
+            elements += std::distance(scenario->begin(), scenario->end());
+            bytecode += scenario->bytecode().size();
+          }
+        }
+        allocations = GetAllocationCount() - count_before;
+        allocated = GetAllocatedBytes() - bytes_before;
+      });
+  ReportBenchmarkValue("scenarios", scenarios, "");
+  ReportBenchmarkValue("elements", elements, "");
+  ReportBenchmarkValue("bytecode", bytecode / 1024.0, "KiB");
+  ReportBenchmarkValue("allocations", allocations, "");
+  ReportBenchmarkValue("allocated per bytecode byte",
+                       static_cast<double>(allocated) / bytecode, "B");
+}
+
+// Measures the interpreter loop walking the element list, using the deeply
+// recursive fibonacci test scenario. The large_*_test scenarios each run for
+// only a few instructions, so timing them would measure RLMachine setup
+// rather than the loop.
+TEST(BytecodeBenchmark, ExecuteFibonacci) {
+  Archive arc(locateTestCase("Module_Jmp_SEEN/fibonacci.TXT"));
+  TestSystem system;
+  RunBenchmark("fibonacci(15)", 20, [&]() {
+    RLMachine rlmachine(system, arc);
+    rlmachine.AttachModule(new JmpModule);
+    rlmachine.AttachModule(new StrModule);
+    rlmachine.SetIntValue(IntMemRef('D', 0), 15);
+    rlmachine.ExecuteUntilHalted();
+    EXPECT_EQ(610, rlmachine.GetIntValue(IntMemRef('E', 0)));
+  });
+}
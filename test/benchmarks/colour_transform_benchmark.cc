@@ -0,0 +1,140 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "benchmarks/benchmark_utils.h"
+#include "systems/base/colour.h"
+#include "systems/base/colour_transform.h"
+#include "systems/base/pixel_blitter.h"
+#include "systems/base/rect.h"
+#include "utilities/cpu_dispatch.h"
+
+namespace {
+
+struct Channels {
+  uint8_t r, g, b;
+};
+
+// The shape of the old per-pixel path, minus SDL: unpack each pixel, make a
+// virtual call and repack it.
+class PixelTransformer {
+ public:
+  virtual ~PixelTransformer() {}
+  virtual Channels operator()(const Channels& colour) const = 0;
+};
+
+class InvertTransformer : public PixelTransformer {
+ public:
+  Channels operator()(const Channels& colour) const override {
+    Channels out = {static_cast<uint8_t>(255 - colour.r),
+                    static_cast<uint8_t>(255 - colour.g),
+                    static_cast<uint8_t>(255 - colour.b)};
+    return out;
+  }
+};
+
+void TransformPerPixel(const PixelBuffer& buffer,
+                       const PixelTransformer& transformer) {
+  for (int y = 0; y < buffer.size.height(); ++y) {
+    uint32_t* row = buffer.row(y);
+    for (int x = 0; x < buffer.size.width(); ++x) {
+      Channels in = {static_cast<uint8_t>(row[x] >> 16),
+                     static_cast<uint8_t>(row[x] >> 8),
+                     static_cast<uint8_t>(row[x])};
+      Channels out = transformer(in);
+      row[x] = (row[x] & 0xff000000) | (out.r << 16) | (out.g << 8) | out.b;
+    }
+  }
+}
+
+}  // namespace
+
+// Each transform over a whole 1280x720 display context, in megapixels per
+// second, with scalar kernels, vector kernels and a four way row split.
+TEST(ColourTransformBenchmark, Throughput) {
+  const int kWidth = 1280, kHeight = 720;
+  const double megapixels = kWidth * kHeight / 1e6;
+  const Rect screen = Rect::REC(0, 0, kWidth, kHeight);
+
+  std::vector<uint32_t> pixels(kWidth * kHeight);
+  std::mt19937 rng(16);
+  for (uint32_t& p : pixels)
+    p = rng();
+  PixelBuffer buffer(reinterpret_cast<char*>(pixels.data()),
+                     Size(kWidth, kHeight), kWidth * 4);
+
+  ToneCurveRGBMap curve;
+  for (ToneCurveColorMap& map : curve) {
+    for (unsigned char& value : map)
+      value = rng();
+  }
+
+  const int kIterations = 20;
+  InvertTransformer inverter;
+  double reference = RunBenchmark("invert (per pixel virtual call)",
+                                  kIterations,
+                                  [&]() { TransformPerPixel(buffer, inverter); });
+  ReportBenchmarkValue("invert (per pixel virtual call) throughput",
+                       megapixels * 1e6 / reference, "Mpx/s");
+
+  const std::pair<std::string, std::function<void()>> transforms[] = {
+      {"invert", [&]() { InvertPixels(buffer, screen); }},
+      {"mono", [&]() { MonoPixels(buffer, screen); }},
+      {"tone curve", [&]() { ToneCurvePixels(buffer, screen, curve); }},
+      {"apply colour",
+       [&]() { ApplyColourPixels(buffer, screen, RGBColour(90, -40, 0)); }},
+  };
+  for (auto const& transform : transforms) {
+    const std::string& name = transform.first;
+    double scalar;
+    {
+      ScopedScalarKernels force_scalar;
+      scalar = RunBenchmark(name + " (scalar)", kIterations, transform.second);
+    }
+    double vector = RunBenchmark(
+        name + " (" + ColourTransformKernelName() + ")", kIterations,
+        transform.second);
+    SetBlitThreadCount(4);
+    double threaded = RunBenchmark(
+        name + " (" + ColourTransformKernelName() + ", 4 threads)",
+        kIterations, transform.second);
+    SetBlitThreadCount(1);
+
+    // RunBenchmark() reports microseconds per iteration.
+    ReportBenchmarkValue(name + " (scalar) throughput",
+                         megapixels * 1e6 / scalar, "Mpx/s");
+    ReportBenchmarkValue(name + " throughput", megapixels * 1e6 / vector,
+                         "Mpx/s");
+    ReportBenchmarkValue(name + " (4 threads) throughput",
+                         megapixels * 1e6 / threaded, "Mpx/s");
+  }
+}
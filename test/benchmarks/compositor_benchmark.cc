@@ -0,0 +1,188 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+
+#include "gtest/gtest.h"
+
+#include <memory>
+#include <ostream>
+#include <random>
+#include <vector>
+
+#include "benchmarks/benchmark_utils.h"
+#include "systems/base/graphics_object.h"
+#include "systems/base/graphics_object_data.h"
+#include "systems/base/pixel_blitter.h"
+#include "systems/base/rect.h"
+#include "systems/base/surface.h"
+#include "test_system/test_graphics_system.h"
+#include "test_system/test_system.h"
+
+namespace {
+
+const Size kScreenSize(1280, 720);
+
+// An image in main memory.
+struct Image {
+  Image(const Size& size, std::mt19937& rng)
+      : pixels(size.width() * size.height() * 4),
+        buffer(pixels.data(), size, size.width() * 4) {
+    for (char& c : pixels)
+      c = rng();
+  }
+
+  std::vector<char> pixels;
+  PixelBuffer buffer;
+};
+
+// A GraphicsSystem that composites in main memory with BlitPixels(). The
+// frame buffer outlives each frame, so the last frame is always there to draw
+// over. (SDLGraphicsSystem has to put it back from a texture, which is GPU
+// work this doesn't measure.)
+class SoftwareGraphicsSystem : public TestGraphicsSystem {
+ public:
+  SoftwareGraphicsSystem(System& system, Gameexe& gameexe, std::mt19937& rng)
+      : TestGraphicsSystem(system, gameexe),
+        frame_(kScreenSize, rng),
+        clip_(Point(0, 0), kScreenSize) {
+    SetScreenSize(kScreenSize);
+  }
+
+  bool redraw_damage_only = true;
+
+  // Draws |image| at |dst|, inside the current clip.
+  void Draw(const PixelBuffer& image, const Point& dst, BlitMode mode) {
+    Rect dst_rect(dst, image.size);
+    RecordScreenDraw(dst_rect);
+
+    Rect clipped = dst_rect.Intersection(clip_);
+    if (clipped.width() <= 0 || clipped.height() <= 0)
+      return;
+    Rect src_rect(Point(clipped.x() - dst.x(), clipped.y() - dst.y()),
+                  clipped.size());
+    BlitOptions options;
+    options.mode = mode;
+    BlitPixels(image, src_rect, frame_.buffer, clipped, options);
+  }
+
+ protected:
+  virtual bool CanRedrawDamageOnly() const override {
+    return redraw_damage_only;
+  }
+  virtual void SetScreenClip(const Rect& area) override { clip_ = area; }
+  virtual void ClearScreenClip() override {
+    clip_ = Rect(Point(0, 0), kScreenSize);
+  }
+
+ private:
+  Image frame_;
+  Rect clip_;
+};
+
+// An object that draws an image in main memory.
+class ImageObjectData : public GraphicsObjectData {
+ public:
+  ImageObjectData(SoftwareGraphicsSystem& graphics,
+                  std::shared_ptr<Image> image,
+                  BlitMode mode)
+      : graphics_(graphics), image_(image), mode_(mode) {}
+
+  virtual void Render(const GraphicsObject& go,
+                      const GraphicsObject* parent,
+                      std::ostream* tree) override {
+    graphics_.Draw(image_->buffer, Point(go.x(), go.y()), mode_);
+  }
+
+  virtual int PixelWidth(const GraphicsObject& go) override {
+    return image_->buffer.size.width();
+  }
+  virtual int PixelHeight(const GraphicsObject& go) override {
+    return image_->buffer.size.height();
+  }
+  virtual GraphicsObjectData* Clone() const override {
+    return new ImageObjectData(graphics_, image_, mode_);
+  }
+  virtual void Execute(RLMachine& machine) override {}
+
+ protected:
+  virtual std::shared_ptr<const Surface> CurrentSurface(
+      const GraphicsObject& go) override {
+    return std::shared_ptr<const Surface>();
+  }
+  virtual void ObjectInfo(std::ostream& tree) override {}
+
+ private:
+  SoftwareGraphicsSystem& graphics_;
+  std::shared_ptr<Image> image_;
+  BlitMode mode_;
+};
+
+}  // namespace
+
+// A dialogue scene at 1280x720: a background, two character sprites and a
+// text window whose contents change every frame as text is typed out. Each
+// frame is drawn in main memory with BlitPixels(), redrawing the whole screen
+// versus only what changed on top of the last frame.
+TEST(CompositorBenchmark, DialogueScene) {
+  std::mt19937 rng(17);
+  TestSystem system;
+  SoftwareGraphicsSystem graphics(system, system.gameexe(), rng);
+
+  struct SceneObject {
+    Size size;
+    Point position;
+    BlitMode mode;
+  };
+  const SceneObject scene[] = {
+      {kScreenSize, Point(0, 0), BLIT_COPY},
+      {Size(400, 600), Point(120, 120), BLIT_ALPHA},
+      {Size(400, 600), Point(760, 120), BLIT_ALPHA},
+      {Size(1200, 200), Point(40, 500), BLIT_ALPHA},
+  };
+  for (int i = 0; i < 4; ++i) {
+    GraphicsObject& obj = graphics.GetObject(OBJ_FG, i);
+    obj.SetObjectData(new ImageObjectData(
+        graphics, std::make_shared<Image>(scene[i].size, rng), scene[i].mode));
+    obj.SetVisible(1);
+    obj.SetX(scene[i].position.x());
+    obj.SetY(scene[i].position.y());
+  }
+  GraphicsObject& text_window = graphics.GetObject(OBJ_FG, 3);
+
+  auto frame = [&]() {
+    text_window.MarkRenderStateChanged();
+    graphics.Refresh(NULL);
+  };
+
+  const int kIterations = 60;
+  graphics.redraw_damage_only = false;
+  graphics.Refresh(NULL);
+  double full = RunBenchmark("full redraw", kIterations, frame);
+
+  graphics.redraw_damage_only = true;
+  graphics.Refresh(NULL);
+  double damage = RunBenchmark("damaged areas only", kIterations, frame);
+
+  ReportBenchmarkValue("speedup", full / damage, "x");
+}
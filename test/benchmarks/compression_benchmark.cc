@@ -0,0 +1,95 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "benchmarks/benchmark_utils.h"
+#include "libreallive/compression.h"
+#include "test_utils.h"
+#include "utilities/cpu_dispatch.h"
+
+using libreallive::compression::Decompress;
+using libreallive::compression::DecompressReference;
+
+namespace {
+
+typedef void (*Decompressor)(const char*, size_t, char*, size_t,
+                             const libreallive::compression::XorKey*);
+
+// Decompresses every scenario once.
+void DecompressAll(const std::vector<CompressedScenario>& scenarios,
+                   std::vector<char>& out,
+                   Decompressor decompress) {
+  for (const CompressedScenario& scenario : scenarios) {
+    decompress(scenario.data.data() + scenario.compressed_offset,
+               scenario.compressed_length, out.data(),
+               scenario.decompressed_length,
+               libreallive::compression::little_busters_xor_mask);
+  }
+}
+
+}  // namespace
+
+// Throughput of the old and new decoders over every scenario in the test
+// SEEN files, in decompressed megabytes per second.
+TEST(CompressionBenchmark, Throughput) {
+  std::vector<CompressedScenario> scenarios = loadAllTestScenarios();
+  size_t total = 0, largest = 0;
+  for (const CompressedScenario& scenario : scenarios) {
+    total += scenario.decompressed_length;
+    largest = std::max(largest, scenario.decompressed_length);
+  }
+  ASSERT_GT(total, 0u);
+  // Room for the reference decoder's overrun on the last back reference.
+  std::vector<char> out(largest + 32);
+
+  const int kIterations = 200;
+  double reference = RunBenchmark("DecompressReference", kIterations, [&]() {
+    DecompressAll(scenarios, out, DecompressReference);
+  });
+  double scalar;
+  {
+    ScopedScalarKernels force_scalar;
+    scalar = RunBenchmark("Decompress (scalar)", kIterations, [&]() {
+      DecompressAll(scenarios, out, Decompress);
+    });
+  }
+  double vector = RunBenchmark(
+      std::string("Decompress (") +
+          libreallive::compression::XorKernelName() + ")",
+      kIterations, [&]() { DecompressAll(scenarios, out, Decompress); });
+
+  // RunBenchmark() reports microseconds per iteration.
+  ReportBenchmarkValue("DecompressReference throughput", total / reference,
+                       "MB/s");
+  ReportBenchmarkValue("Decompress (scalar) throughput", total / scalar,
+                       "MB/s");
+  ReportBenchmarkValue("Decompress throughput", total / vector, "MB/s");
+  ReportBenchmarkValue("Decompress speedup", reference / vector, "x");
+}
@@ -0,0 +1,200 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#include "gtest/gtest.h"
+
+#include <boost/filesystem.hpp>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "benchmarks/benchmark_utils.h"
+#include "libreallive/archive.h"
+#include "libreallive/elements/command.h"
+#include "libreallive/intmemref.h"
+#include "machine/memory.h"
+#include "machine/rlmachine.h"
+#include "machine/rlmodule.h"
+#include "machine/rloperation.h"
+#include "modules/module_jmp.h"
+#include "modules/module_str.h"
+#include "systems/base/event_system.h"
+#include "test_system/test_system.h"
+#include "test_utils.h"
+
+using libreallive::IntMemRef;
+
+namespace {
+
+struct NopOpcode : public RLOpcode<> {
+  virtual void operator()(RLMachine& machine) override {}
+  virtual bool AdvanceInstructionPointer() override { return false; }
+};
+
+class NopModule : public RLModule {
+ public:
+  NopModule() : RLModule("Nop", 1, 250) { AddOpcode(0, 0, "nop", new NopOpcode); }
+};
+
+const int kIterations = 1000000;
+
+}  // namespace
+
+// Times RLMachine::ExecuteCommand() on a single element, with the cached
+// RLOperation and with the module and opcode lookups done every time.
+TEST(DispatchBenchmark, CachedVersusLookup) {
+  libreallive::Archive arc(locateTestCase("Module_Jmp_SEEN/fibonacci.TXT"));
+  TestSystem system;
+  RLMachine rlmachine(system, arc);
+  rlmachine.AttachModule(new NopModule);
+  // Give the lookup some company, as in a real game.
+  rlmachine.AttachModule(new JmpModule);
+  rlmachine.AttachModule(new StrModule);
+
+  std::string repr(8, 0);
+  repr[0] = '#';
+  repr[1] = 1;
+  repr[2] = static_cast<char>(250);
+  repr += "()";
+  std::unique_ptr<libreallive::CommandElement> f(
+      libreallive::FunctionFactory::BuildFunctionElement(repr.c_str()));
+
+  double lookup = RunBenchmark("ExecuteCommand (lookup)", kIterations, [&]() {
+    rlmachine.InvalidateDispatchCache();
+    rlmachine.ExecuteCommand(*f);
+  });
+  double cached = RunBenchmark("ExecuteCommand (cached)", kIterations,
+                               [&]() { rlmachine.ExecuteCommand(*f); });
+  ReportBenchmarkValue("ExecuteCommand speedup", lookup / cached, "x");
+}
+
+// Replays the gosub heavy fibonacci scenario, where nearly every instruction
+// is a command.
+TEST(DispatchBenchmark, ReplayFibonacci) {
+  libreallive::Archive arc(locateTestCase("Module_Jmp_SEEN/fibonacci.TXT"));
+  TestSystem system;
+  RunBenchmark("fibonacci(12) replay", 50, [&]() {
+    RLMachine rlmachine(system, arc);
+    rlmachine.AttachModule(new JmpModule);
+    rlmachine.AttachModule(new StrModule);
+    rlmachine.SetIntValue(IntMemRef('D', 0), 12);
+    rlmachine.ExecuteUntilHalted();
+    EXPECT_EQ(144, rlmachine.GetIntValue(IntMemRef('E', 0)));
+  });
+}
+
+// Runs fibonacci in 10ms slices the way the main loop does: once with the
+// old loop that read the clock after every instruction, and once with
+// ExecuteBatch, which only checks it every few instructions.
+TEST(DispatchBenchmark, TimeSlicedExecution) {
+  libreallive::Archive arc(locateTestCase("Module_Jmp_SEEN/fibonacci.TXT"));
+  TestSystem system;
+  auto run = [&](bool batched) {
+    RLMachine rlmachine(system, arc);
+    rlmachine.AttachModule(new JmpModule);
+    rlmachine.AttachModule(new StrModule);
+    rlmachine.SetIntValue(IntMemRef('D', 0), 12);
+    RLMachine::ExecutionBudget time_slice;
+    time_slice.milliseconds = 10;
+    while (!rlmachine.halted()) {
+      if (batched) {
+        rlmachine.ExecuteBatch(time_slice);
+      } else {
+        unsigned int start = system.event().GetTicks();
+        do {
+          rlmachine.ExecuteNextInstruction();
+        } while (!rlmachine.halted() &&
+                 system.event().GetTicks() - start < 10);
+      }
+    }
+    EXPECT_EQ(144, rlmachine.GetIntValue(IntMemRef('E', 0)));
+  };
+
+  double stepped =
+      RunBenchmark("fibonacci(12), per instruction", 50, [&]() { run(false); });
+  double batched =
+      RunBenchmark("fibonacci(12), ExecuteBatch", 50, [&]() { run(true); });
+  ReportBenchmarkValue("time sliced speedup", stepped / batched, "x");
+}
+
+// Skips through already read text: line markers, kidoku markers and
+// textouts, the bulk of any visual novel. Registering a line action turns
+// off superinstruction fusion, which gives the unfused baseline. The two
+// modes alternate so that drift in machine load hits both equally.
+TEST(DispatchBenchmark, FastForwardReadText) {
+  namespace fs = boost::filesystem;
+  const fs::path dir = fs::temp_directory_path() / fs::unique_path();
+  fs::create_directories(dir);
+  const std::string seen = (dir / "SEEN.TXT").string();
+
+  const int kBlocks = 2000;
+  std::string bytecode;
+  std::vector<int> kidoku_table;
+  for (int i = 0; i < kBlocks; ++i) {
+    const int line = 10 + i * 2;
+    bytecode += {'\n', char(line & 0xff), char(line >> 8)};
+    bytecode += {'\n', char((line + 1) & 0xff), char((line + 1) >> 8)};
+    bytecode += {'@', char(i & 0xff), char(i >> 8)};
+    kidoku_table.push_back(i);
+    bytecode += "Text";
+  }
+  writeTestSeen(seen, 1, bytecode, kidoku_table);
+
+  libreallive::Archive arc(seen);
+  const int kIterations = 30;
+  std::chrono::duration<double, std::micro> elapsed[2] = {};
+  int steps[2] = {0, 0};
+  for (int i = 0; i < kIterations * 2; ++i) {
+    const bool fused = i % 2;
+    TestSystem system(locateTestCase("Gameexe_data/Gameexe.ini"));
+    system.set_force_fast_forward();
+    RLMachine rlmachine(system, arc);
+    for (int k = 0; k < kBlocks; ++k)
+      rlmachine.memory().RecordKidoku(1, k);
+    if (!fused)
+      rlmachine.AddLineAction(9999, 0, []() {});
+
+    steps[fused] = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (!rlmachine.halted()) {
+      rlmachine.ExecuteNextInstruction();
+      steps[fused]++;
+    }
+    elapsed[fused] += std::chrono::steady_clock::now() - start;
+  }
+
+  const double unfused = elapsed[0].count() / kIterations;
+  const double fused = elapsed[1].count() / kIterations;
+  ReportBenchmarkValue("fast forward (unfused)", unfused, "us/iter");
+  ReportBenchmarkValue("fast forward (fused)", fused, "us/iter");
+  ReportBenchmarkValue("fast forward speedup", unfused / fused, "x");
+  ReportBenchmarkValue("instructions (unfused)", steps[0], "steps");
+  ReportBenchmarkValue("instructions (fused)", steps[1], "steps");
+
+  fs::remove_all(dir);
+}
@@ -0,0 +1,99 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#include "gtest/gtest.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "benchmarks/benchmark_utils.h"
+#include "libreallive/archive.h"
+#include "libreallive/compiled_expression.h"
+#include "libreallive/expression.h"
+#include "machine/rlmachine.h"
+#include "test_system/test_system.h"
+#include "test_utils.h"
+
+using libreallive::CompiledExpression;
+using libreallive::Expression;
+
+namespace {
+
+struct Case {
+  const char* name;
+  const char* printable;
+};
+
+const Case kCases[] = {
+    // intA[3] += 2
+    {"compound assignment",
+     "$ 00 [ $ ff 03 00 00 00 ] 5c 14 $ ff 02 00 00 00"},
+    // intB[intA[0] + 1] = intC[2] * 3 - intD[4] / 2
+    {"indexed arithmetic",
+     "$ 01 [ $ 00 [ $ ff 00 00 00 00 ] 5c 00 $ ff 01 00 00 00 ] 5c 1e "
+     "$ 02 [ $ ff 02 00 00 00 ] 5c 02 $ ff 03 00 00 00 5c 01 "
+     "$ 03 [ $ ff 04 00 00 00 ] 5c 03 $ ff 02 00 00 00"},
+    // store = intA[1] > 2 && intA4b[intL[0]] != 0 || intZ[5] == -1
+    {"condition",
+     "$ c8 5c 1e $ 00 [ $ ff 01 00 00 00 ] 5c 2d $ ff 02 00 00 00 5c 3c "
+     "$ 4e [ $ 0b [ $ ff 00 00 00 00 ] ] 5c 29 $ ff 00 00 00 00 5c 3d "
+     "$ 19 [ $ ff 05 00 00 00 ] 5c 28 5c 01 $ ff 01 00 00 00"},
+};
+
+const int kIterations = 1000000;
+
+}  // namespace
+
+// Compares walking an expression tree with running its CompiledExpression.
+TEST(ExpressionBenchmark, TreeVersusCompiled) {
+  libreallive::Archive arc(
+      locateTestCase("ExpressionTest_SEEN/basicOperators.TXT"));
+  TestSystem system;
+  RLMachine rlmachine(system, arc);
+
+  for (const Case& c : kCases) {
+    std::string parsable = libreallive::PrintableToParsableString(c.printable);
+    const char* src = parsable.c_str();
+    Expression tree = libreallive::GetAssignment(src);
+    std::unique_ptr<CompiledExpression> code =
+        CompiledExpression::Compile(*tree);
+    ASSERT_TRUE(code) << c.name;
+
+    int sink = 0;
+    double tree_time = RunBenchmark(
+        std::string(c.name) + " (tree)", kIterations,
+        [&]() { sink += tree->GetIntegerValue(rlmachine); });
+    double compiled_time = RunBenchmark(
+        std::string(c.name) + " (compiled)", kIterations,
+        [&]() { sink += code->Evaluate(rlmachine); });
+    ReportBenchmarkValue(std::string(c.name) + " speedup",
+                         tree_time / compiled_time, "x");
+    ReportBenchmarkValue(std::string(c.name) + " instructions", code->size(),
+                         "");
+    EXPECT_NE(-1, sink);
+  }
+}
@@ -0,0 +1,164 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+
+#include "gtest/gtest.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "benchmarks/benchmark_utils.h"
+#include "systems/base/image_decoder.h"
+#include "systems/base/image_disk_cache.h"
+#include "systems/base/image_loader.h"
+#include "test_utils.h"
+#include "utilities/cpu_dispatch.h"
+#include "xclannad/file.h"
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+struct BenchmarkImage {
+  const char* name;
+  std::string file;
+  std::unique_ptr<GRPCONV> conv;
+};
+
+}  // namespace
+
+// Decode throughput of GRPCONV::Read() against DecodeGrpImage() on a
+// 1024x768 image of each format, in megabytes of decoded pixels per second.
+TEST(ImageDecoderBenchmark, Throughput) {
+  const int kWidth = 1024, kHeight = 768;
+  const double megabytes = kWidth * kHeight * 4 / 1e6;
+
+  BenchmarkImage images[] = {
+      {"G00 type 0", makeTestImage(TEST_G00_TYPE0, kWidth, kHeight, 1, false)},
+      {"G00 type 1", makeTestImage(TEST_G00_TYPE1, kWidth, kHeight, 1, false)},
+      {"G00 type 2", makeTestImage(TEST_G00_TYPE2, kWidth, kHeight, 1, true)},
+      {"PDT10 + mask", makeTestImage(TEST_PDT10, kWidth, kHeight, 1, true)},
+      {"PDT11 + mask", makeTestImage(TEST_PDT11, kWidth, kHeight, 1, true)},
+  };
+  std::vector<char> out(kWidth * kHeight * 4 + 4096);
+
+  const int kIterations = 20;
+  for (BenchmarkImage& image : images) {
+    image.conv.reset(GRPCONV::AssignConverter(
+        image.file.data(), image.file.size(), image.name));
+    ASSERT_TRUE(image.conv);
+    const std::string name = image.name;
+
+    // Untimed passes so whichever decoder runs first doesn't pay for
+    // faulting in |out| and warming the caches.
+    bool has_alpha;
+    for (int i = 0; i < 3; ++i) {
+      image.conv->Read(out.data());
+      DecodeGrpImage(*image.conv, out.data(), &has_alpha);
+    }
+
+    // The reference includes the separate alpha scan DecodeImageFile() did
+    // after GRPCONV::Read().
+    double reference =
+        RunBenchmark(name + ": GRPCONV::Read", kIterations, [&]() {
+          image.conv->Read(out.data());
+          const unsigned int* pixel =
+              reinterpret_cast<const unsigned int*>(out.data());
+          has_alpha = image.conv->IsMask() &&
+                      std::any_of(pixel, pixel + kWidth * kHeight,
+                                  [](unsigned int p) {
+                                    return (p & 0xff000000) != 0xff000000;
+                                  });
+        });
+    double scalar;
+    {
+      ScopedScalarKernels force_scalar;
+      scalar = RunBenchmark(
+          name + ": DecodeGrpImage (scalar)", kIterations,
+          [&]() { DecodeGrpImage(*image.conv, out.data(), &has_alpha); });
+    }
+    double vector = RunBenchmark(
+        name + ": DecodeGrpImage (" + ImageKernelName() + ")", kIterations,
+        [&]() { DecodeGrpImage(*image.conv, out.data(), &has_alpha); });
+
+    // RunBenchmark() reports microseconds per iteration.
+    ReportBenchmarkValue(name + ": GRPCONV::Read throughput",
+                         megabytes * 1e6 / reference, "MB/s");
+    ReportBenchmarkValue(name + ": DecodeGrpImage (scalar) throughput",
+                         megabytes * 1e6 / scalar, "MB/s");
+    ReportBenchmarkValue(name + ": DecodeGrpImage throughput",
+                         megabytes * 1e6 / vector, "MB/s");
+  }
+}
+
+// Loading a 1024x768 image from disk with and without an ImageDiskCache
+// entry for it.
+TEST(ImageDecoderBenchmark, DiskCacheHit) {
+  const int kWidth = 1024, kHeight = 768;
+  fs::path dir = fs::temp_directory_path() / fs::unique_path();
+  fs::create_directories(dir);
+  ImageDiskCache cache(dir / "cache");
+
+  const std::pair<const char*, TestImageFormat> formats[] = {
+      {"G00 type 0", TEST_G00_TYPE0},
+      {"G00 type 2", TEST_G00_TYPE2},
+      {"PDT10 + mask", TEST_PDT10},
+  };
+  const int kIterations = 20;
+  for (auto const& format : formats) {
+    const std::string name = format.first;
+    fs::path path = dir / (name + ".img");
+    {
+      std::string file = makeTestImage(format.second, kWidth, kHeight, 1, true);
+      fs::ofstream out(path, std::ios::binary);
+      out.write(file.data(), file.size());
+    }
+    DecodeImageFile(path, &cache);
+    ASSERT_TRUE(DecodeImageFile(path, &cache)->mapping);
+
+    // Both copy the pixels out, as building the SDL surface does, so the
+    // cache hit pays for faulting in its mapping.
+    std::vector<char> surface(kWidth * kHeight * 4);
+    double decode = RunBenchmark(name + ": DecodeImageFile", kIterations, [&]() {
+      std::shared_ptr<const DecodedImage> image = DecodeImageFile(path);
+      memcpy(surface.data(), image->data(), surface.size());
+    });
+    double hit = RunBenchmark(
+        name + ": DecodeImageFile (disk cache hit)", kIterations, [&]() {
+          std::shared_ptr<const DecodedImage> image =
+              DecodeImageFile(path, &cache);
+          memcpy(surface.data(), image->data(), surface.size());
+        });
+    ReportBenchmarkValue(name + ": disk cache speedup", decode / hit, "x");
+  }
+
+  fs::remove_all(dir);
+}
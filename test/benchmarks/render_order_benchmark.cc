@@ -0,0 +1,139 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <memory>
+#include <ostream>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "benchmarks/allocation_counter.h"
+#include "benchmarks/benchmark_utils.h"
+#include "systems/base/graphics_object.h"
+#include "systems/base/graphics_object_data.h"
+#include "systems/base/render_order.h"
+#include "systems/base/surface.h"
+#include "utilities/lazy_array.h"
+
+namespace {
+
+// Object data that draws nothing; it only has to be there.
+class EmptyObjectData : public GraphicsObjectData {
+ public:
+  virtual int PixelWidth(const GraphicsObject& go) override { return 0; }
+  virtual int PixelHeight(const GraphicsObject& go) override { return 0; }
+  virtual GraphicsObjectData* Clone() const override {
+    return new EmptyObjectData;
+  }
+  virtual void Execute(RLMachine& machine) override {}
+
+ protected:
+  virtual std::shared_ptr<const Surface> CurrentSurface(
+      const GraphicsObject& go) override {
+    return std::shared_ptr<const Surface>();
+  }
+  virtual void ObjectInfo(std::ostream& tree) override {}
+};
+
+// How GraphicsSystem used to order the objects on every frame: collect all the
+// allocated ones that pass the filter and sort them.
+class CollectAndSort {
+ public:
+  template <typename Filter>
+  void Update(LazyArray<GraphicsObject>& objects, const Filter& shown) {
+    to_render_.clear();
+    for (AllocatedLazyArrayIterator<GraphicsObject> it = objects.begin();
+         it != objects.end();
+         ++it) {
+      if (!shown(it.pos()))
+        continue;
+      to_render_.emplace_back(
+          it->z_order(), it->z_layer(), it->z_depth(), it.pos(), &*it);
+    }
+    std::sort(to_render_.begin(), to_render_.end());
+  }
+
+ private:
+  std::vector<std::tuple<int, int, int, int, GraphicsObject*>> to_render_;
+};
+
+}  // namespace
+
+// Ordering the foreground objects for a frame, as the layer grows. Most frames
+// change nothing about the order; some move one object in front of the rest.
+TEST(RenderOrderBenchmark, PerFrameCost) {
+  const int kIterations = 2000;
+  for (int count : {64, 256, 1024, 4096}) {
+    std::mt19937 rng(count);
+    LazyArray<GraphicsObject> objects(count);
+    for (int i = 0; i < count; ++i) {
+      // Some slots are allocated but empty, as in games.
+      if (i % 5 == 4)
+        continue;
+      GraphicsObject& obj = objects[i];
+      obj.SetObjectData(new EmptyObjectData);
+      obj.SetVisible(rng() % 8 != 0);
+      obj.SetZOrder(rng() % 16);
+      obj.SetZLayer(rng() % 4);
+    }
+
+    // Stands in for the #OBJECT settings lookups.
+    std::vector<char> settings(count);
+    for (char& setting : settings)
+      setting = rng() % 32 != 0;
+    auto shown = [&settings](int slot) { return settings[slot] != 0; };
+
+    std::string suffix = ", " + std::to_string(count) + " objects";
+    CollectAndSort collect;
+    collect.Update(objects, shown);
+    double before = RunBenchmark("collect and sort" + suffix,
+                                 kIterations,
+                                 [&]() { collect.Update(objects, shown); });
+
+    RenderOrder order;
+    order.Update(objects, shown);
+    size_t allocations = GetAllocationCount();
+    double after = RunBenchmark("incremental, unchanged" + suffix,
+                                kIterations,
+                                [&]() { order.Update(objects, shown); });
+    allocations = GetAllocationCount() - allocations;
+
+    int frame = 0;
+    GraphicsObject& mover = objects[0];
+    double moved =
+        RunBenchmark("incremental, one z change" + suffix, kIterations, [&]() {
+          mover.SetZOrder(++frame % 16);
+          order.Update(objects, shown);
+        });
+
+    ReportBenchmarkValue("unchanged speedup" + suffix, before / after, "x");
+    ReportBenchmarkValue("one change speedup" + suffix, before / moved, "x");
+    EXPECT_EQ(0u, allocations);
+  }
+}
@@ -0,0 +1,142 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+
+#include "gtest/gtest.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "benchmarks/benchmark_utils.h"
+#include "systems/base/audio_mixer.h"
+#include "systems/base/voice_archive.h"
+#include "systems/sdl/resample.h"
+#include "systems/sdl/zresample.h"
+#include "xclannad/endian.hpp"
+
+namespace {
+
+const int kOutputRate = 48000;
+const int kVoiceSeconds = 4;
+
+// A voice line as the decoders hand it over: a WAV header and a tone, with
+// |length| set to the size of the tone.
+char* MakeVoiceLine(int rate, int channels, int* length) {
+  int frames = rate * kVoiceSeconds;
+  *length = frames * channels * 2;
+  char* data = new char[WAV_HEADER_SIZE + *length];
+  memcpy(data,
+         VoiceSample::MakeWavHeader(rate, channels, 2, *length).data(),
+         WAV_HEADER_SIZE);
+  for (int i = 0; i < frames * channels; ++i) {
+    double t = static_cast<double>(i / channels) / rate;
+    int16_t sample = static_cast<int16_t>(8000 * sin(2 * M_PI * 440 * t));
+    write_little_endian_short(data + WAV_HEADER_SIZE + i * 2, sample);
+  }
+  return data;
+}
+
+// What KoePlayImpl() used to do to every voice line: write it to a temp file,
+// run zresample from file to file and read the result back.
+char* ResampleThroughTempFiles(char* incoming_data, int* length) {
+  char dir_template[] = "/tmp/rlvm-temp-XXXXXX";
+  char* tmp_dirname = mkdtemp(dir_template);
+  if (tmp_dirname == nullptr)
+    return incoming_data;
+
+  std::string infile_name = std::string(tmp_dirname) + "/input.wav";
+  std::string outfile_name = std::string(tmp_dirname) + "/output.wav";
+
+  FILE* infile = fopen(infile_name.c_str(), "wb");
+  fwrite(incoming_data, WAV_HEADER_SIZE + *length, 1, infile);
+  fclose(infile);
+
+  zresample_main(infile_name.c_str(), outfile_name.c_str(), kOutputRate);
+
+  FILE* f = fopen(outfile_name.c_str(), "rb");
+  fseek(f, 0, SEEK_END);
+  long fsize = ftell(f);
+  *length = fsize - WAV_HEADER_SIZE;
+  fseek(f, 0, SEEK_SET);
+
+  char* outdata = new char[fsize];
+  fread(outdata, fsize, 1, f);
+  fclose(f);
+
+  unlink(infile_name.c_str());
+  unlink(outfile_name.c_str());
+  rmdir(tmp_dirname);
+
+  delete[] incoming_data;
+  return outdata;
+}
+
+}  // namespace
+
+// Time from a voice line being decoded to it being ready to hand to the mixer,
+// which is all of the koe trigger to first sample latency that resampling
+// adds. The in memory path is LoadWavClip(), as KoePlayImpl() uses now, which
+// also builds the mixer's clip; the temp file path would still have that to
+// do. Neither path streams: the whole line is converted before its first
+// sample can play. The correctness tests are in test/resample_test.cc.
+TEST(ResampleBenchmark, VoiceLineLatency) {
+  const int kIterations = 20;
+  struct Case {
+    const char* name;
+    int rate;
+    int channels;
+  } cases[] = {{"22050Hz mono", 22050, 1},
+               {"44100Hz stereo", 44100, 2},
+               {"48000Hz stereo", 48000, 2}};
+
+  for (const Case& c : cases) {
+    int length;
+    std::string suffix = std::string(", ") + c.name;
+
+    double before = RunBenchmark("temp files" + suffix, kIterations, [&]() {
+      char* data = MakeVoiceLine(c.rate, c.channels, &length);
+      delete[] ResampleThroughTempFiles(data, &length);
+    });
+    double after = RunBenchmark("in memory" + suffix, kIterations, [&]() {
+      std::unique_ptr<char[]> data(MakeVoiceLine(c.rate, c.channels, &length));
+      LoadWavClip(data.get(), WAV_HEADER_SIZE + length, kOutputRate);
+    });
+    double baseline = RunBenchmark("decode only" + suffix, kIterations, [&]() {
+      delete[] MakeVoiceLine(c.rate, c.channels, &length);
+    });
+
+    ReportBenchmarkValue(
+        "temp file latency" + suffix, (before - baseline) / 1000, "ms");
+    ReportBenchmarkValue(
+        "in memory latency" + suffix, (after - baseline) / 1000, "ms");
+  }
+}
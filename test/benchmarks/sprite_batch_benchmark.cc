@@ -0,0 +1,489 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+
+#include "GL/glew.h"
+
+#include "gtest/gtest.h"
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "benchmarks/benchmark_utils.h"
+#include "systems/base/colour.h"
+#include "systems/base/graphics_object.h"
+#include "systems/sdl/shaders.h"
+#include "systems/sdl/sprite_batch.h"
+#include "systems/sdl/texture_atlas.h"
+
+namespace {
+
+const int kScreenWidth = 1280;
+const int kScreenHeight = 720;
+const int kObjectCount = 256;
+
+// An offscreen OpenGL context that needs neither a window nor a GPU: Mesa's
+// surfaceless EGL platform falls back to llvmpipe.
+class HeadlessContext {
+ public:
+  HeadlessContext()
+      : display_(EGL_NO_DISPLAY),
+        surface_(EGL_NO_SURFACE),
+        context_(EGL_NO_CONTEXT) {}
+
+  ~HeadlessContext() {
+    if (display_ != EGL_NO_DISPLAY) {
+      eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+      if (context_ != EGL_NO_CONTEXT)
+        eglDestroyContext(display_, context_);
+      if (surface_ != EGL_NO_SURFACE)
+        eglDestroySurface(display_, surface_);
+      eglTerminate(display_);
+    }
+  }
+
+  // Returns an empty string on success, or why there's no context.
+  std::string Initialize() {
+    display_ = eglGetPlatformDisplay(
+        EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    if (display_ == EGL_NO_DISPLAY)
+      display_ = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (display_ == EGL_NO_DISPLAY || !eglInitialize(display_, NULL, NULL))
+      return "no EGL display";
+    if (!eglBindAPI(EGL_OPENGL_API))
+      return "EGL can't create desktop GL contexts";
+
+    const EGLint config_attributes[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8,
+        EGL_GREEN_SIZE, 8,
+        EGL_BLUE_SIZE, 8,
+        EGL_ALPHA_SIZE, 8,
+        EGL_NONE};
+    EGLConfig config;
+    EGLint config_count = 0;
+    if (!eglChooseConfig(
+            display_, config_attributes, &config, 1, &config_count) ||
+        config_count == 0)
+      return "no RGBA pbuffer config";
+
+    const EGLint surface_attributes[] = {
+        EGL_WIDTH, kScreenWidth, EGL_HEIGHT, kScreenHeight, EGL_NONE};
+    surface_ = eglCreatePbufferSurface(display_, config, surface_attributes);
+    context_ = eglCreateContext(display_, config, EGL_NO_CONTEXT, NULL);
+    if (surface_ == EGL_NO_SURFACE || context_ == EGL_NO_CONTEXT ||
+        !eglMakeCurrent(display_, surface_, surface_, context_))
+      return "couldn't make a GL context current";
+
+    if (glewInit() != GLEW_OK)
+      return "GLEW failed to initialize";
+    if (!GLEW_ARB_fragment_shader || !GLEW_ARB_multitexture)
+      return "GL lacks fragment shaders";
+
+    return std::string();
+  }
+
+  std::string Renderer() const {
+    return reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+  }
+
+ private:
+  EGLDisplay display_;
+  EGLSurface surface_;
+  EGLContext context_;
+};
+
+// An image uploaded both to a texture of its own, the way textures were drawn
+// before batching, and into the shared atlas.
+struct Sprite {
+  int width;
+  int height;
+
+  GLuint own_texture;
+  unsigned int own_texture_size;
+
+  TextureAtlas::Allocation slot;
+};
+
+Sprite MakeSprite(int width, int height, std::mt19937& rng) {
+  std::vector<GLubyte> pixels(width * height * 4);
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      GLubyte* pixel = &pixels[(y * width + x) * 4];
+      pixel[0] = rng();
+      pixel[1] = rng();
+      pixel[2] = rng();
+      // Opaque in the middle, fading out towards the edges.
+      pixel[3] = (x > 4 && y > 4 && x < width - 4 && y < height - 4) ? 255
+                                                                       : 96;
+    }
+  }
+
+  Sprite sprite;
+  sprite.width = width;
+  sprite.height = height;
+
+  // Texture::Texture() rounds sizes up to powers of two.
+  sprite.own_texture_size = 1;
+  while (sprite.own_texture_size < unsigned(std::max(width, height)))
+    sprite.own_texture_size *= 2;
+  glGenTextures(1, &sprite.own_texture);
+  glBindTexture(GL_TEXTURE_2D, sprite.own_texture);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexImage2D(GL_TEXTURE_2D,
+               0,
+               GL_RGBA,
+               sprite.own_texture_size,
+               sprite.own_texture_size,
+               0,
+               GL_RGBA,
+               GL_UNSIGNED_BYTE,
+               NULL);
+  glTexSubImage2D(GL_TEXTURE_2D,
+                  0,
+                  0,
+                  0,
+                  width,
+                  height,
+                  GL_RGBA,
+                  GL_UNSIGNED_BYTE,
+                  pixels.data());
+
+  if (TextureAtlas::Get().Allocate(width, height, &sprite.slot)) {
+    glBindTexture(GL_TEXTURE_2D, sprite.slot.page->texture_id());
+    glTexSubImage2D(GL_TEXTURE_2D,
+                    0,
+                    sprite.slot.x,
+                    sprite.slot.y,
+                    width,
+                    height,
+                    GL_RGBA,
+                    GL_UNSIGNED_BYTE,
+                    pixels.data());
+  }
+
+  return sprite;
+}
+
+struct SceneObject {
+  const Sprite* sprite;
+  GraphicsObject go;
+};
+
+bool NeedsShader(const GraphicsObject& go) {
+  return go.light() || go.tint() != RGBColour::Black() ||
+         go.colour() != RGBAColour::Clear() || go.mono() || go.invert();
+}
+
+// Draws |object| the way Texture::RenderToScreenAsObject() did before
+// batching: immediate mode, with all state set and reset around each quad.
+void DrawImmediate(const SceneObject& object) {
+  const Sprite& sprite = *object.sprite;
+  const GraphicsObject& go = object.go;
+  float s2 = float(sprite.width) / sprite.own_texture_size;
+  float t2 = float(sprite.height) / sprite.own_texture_size;
+
+  glBindTexture(GL_TEXTURE_2D, sprite.own_texture);
+  glPushMatrix();
+  glTranslatef(go.x(), go.y(), 0);
+  float x_rep = sprite.width / 2.0f;
+  float y_rep = sprite.height / 2.0f;
+  glTranslatef(x_rep, y_rep, 0);
+  glRotatef(float(go.rotation()) / 10, 0, 0, 1);
+  glTranslatef(-x_rep, -y_rep, 0);
+
+  SpriteBatch::Vertex attributes[4];
+  bool using_shader = NeedsShader(go);
+  if (using_shader) {
+    glUseProgramObjectARB(Shaders::GetObjectProgram());
+    Shaders::SetObjectAttributes(go, go.GetComputedAlpha(), attributes);
+    glColor4ub(255, 255, 255, 255);
+  } else {
+    glColor4ub(255, 255, 255, go.GetComputedAlpha());
+  }
+
+  if (go.composite_mode() == 1) {
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+  } else {
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  }
+
+  const float corners[4][4] = {{0, 0, 0, 0},
+                               {float(sprite.width), 0, s2, 0},
+                               {float(sprite.width), float(sprite.height), s2,
+                                t2},
+                               {0, float(sprite.height), 0, t2}};
+  glBegin(GL_QUADS);
+  for (int i = 0; i < 4; ++i) {
+    if (using_shader) {
+      for (int set = 0; set < 3; ++set)
+        glMultiTexCoord4fvARB(GL_TEXTURE1_ARB + set,
+                              attributes[0].attributes[set]);
+    }
+    glTexCoord2f(corners[i][2], corners[i][3]);
+    glVertex2f(corners[i][0], corners[i][1]);
+  }
+  glEnd();
+
+  if (using_shader)
+    glUseProgramObjectARB(0);
+  glBlendFunc(GL_ONE, GL_ZERO);
+  glPopMatrix();
+}
+
+// Queues |object| the way Texture::RenderToScreenAsObject() does now.
+void DrawBatched(const SceneObject& object, SpriteBatch& batch) {
+  const Sprite& sprite = *object.sprite;
+  const GraphicsObject& go = object.go;
+
+  SpriteBatch::State state = {0, 0, 0, SpriteBatch::BLEND_ALPHA};
+  float s1, t1, s2, t2;
+  if (sprite.slot.page) {
+    state.texture = sprite.slot.page->texture_id();
+    float size = sprite.slot.page->size();
+    s1 = sprite.slot.x / size;
+    t1 = sprite.slot.y / size;
+    s2 = (sprite.slot.x + sprite.width) / size;
+    t2 = (sprite.slot.y + sprite.height) / size;
+  } else {
+    state.texture = sprite.own_texture;
+    s1 = t1 = 0;
+    s2 = float(sprite.width) / sprite.own_texture_size;
+    t2 = float(sprite.height) / sprite.own_texture_size;
+  }
+  if (go.composite_mode() == 1)
+    state.blend = SpriteBatch::BLEND_ADD;
+
+  bool using_shader = NeedsShader(go);
+  if (using_shader)
+    state.program = Shaders::GetObjectProgram();
+
+  SpriteBatch::Vertex* quad = batch.AddQuad(state);
+  SpriteBatch::SetRect(quad,
+                       go.x(),
+                       go.y(),
+                       go.x() + sprite.width,
+                       go.y() + sprite.height,
+                       s1,
+                       t1,
+                       s2,
+                       t2);
+  if (using_shader) {
+    Shaders::SetObjectAttributes(go, go.GetComputedAlpha(), quad);
+    SpriteBatch::SetColour(quad, 255, 255, 255, 255);
+  } else {
+    SpriteBatch::SetColour(quad, 255, 255, 255, go.GetComputedAlpha());
+  }
+
+  if (go.rotation()) {
+    float x_rep = go.x() + sprite.width / 2.0f;
+    float y_rep = go.y() + sprite.height / 2.0f;
+    float radians = (go.rotation() / 10.0f) * (3.14159265f / 180.0f);
+    float cos_r = std::cos(radians);
+    float sin_r = std::sin(radians);
+    for (int i = 0; i < 4; ++i) {
+      float x = quad[i].x - x_rep;
+      float y = quad[i].y - y_rep;
+      quad[i].x = x_rep + (x * cos_r) - (y * sin_r);
+      quad[i].y = y_rep + (x * sin_r) + (y * cos_r);
+    }
+  }
+}
+
+void BeginFrame() {
+  glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+  glClear(GL_COLOR_BUFFER_BIT);
+}
+
+std::vector<GLubyte> ReadScreen() {
+  std::vector<GLubyte> pixels(kScreenWidth * kScreenHeight * 4);
+  glReadPixels(0,
+               0,
+               kScreenWidth,
+               kScreenHeight,
+               GL_RGBA,
+               GL_UNSIGNED_BYTE,
+               pixels.data());
+  return pixels;
+}
+
+}  // namespace
+
+// 256 objects on a 1280x720 screen: mostly small sprites sharing a handful of
+// images, some tinted or coloured through the object shader, some additive,
+// some rotated, and a few large images that don't fit in the atlas. Each frame
+// is drawn the old way, one immediate mode quad per object, and through
+// SpriteBatch, and finished with glFinish() so the time includes the
+// rasterizer's work.
+TEST(SpriteBatchBenchmark, ObjectScene) {
+  HeadlessContext context;
+  std::string error = context.Initialize();
+  if (!error.empty()) {
+    std::cout << "[ SKIPPED  ] No OpenGL: " << error << std::endl;
+    return;
+  }
+  std::cout << "[ BENCH    ] renderer: " << context.Renderer() << std::endl;
+
+  glViewport(0, 0, kScreenWidth, kScreenHeight);
+  glMatrixMode(GL_PROJECTION);
+  glLoadIdentity();
+  glOrtho(0.0, kScreenWidth, kScreenHeight, 0.0, 0.0, 1.0);
+  glMatrixMode(GL_MODELVIEW);
+  glLoadIdentity();
+  glEnable(GL_TEXTURE_2D);
+  glEnable(GL_BLEND);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+  std::mt19937 rng(18);
+  std::vector<Sprite> sprites;
+  for (int i = 0; i < 16; ++i)
+    sprites.push_back(MakeSprite(32 + (i % 4) * 24, 32 + (i / 4) * 24, rng));
+  for (int i = 0; i < 4; ++i)
+    sprites.push_back(MakeSprite(320, 240, rng));
+
+  std::vector<SceneObject> scene(kObjectCount);
+  for (int i = 0; i < kObjectCount; ++i) {
+    SceneObject& object = scene[i];
+    object.sprite = (i % 32 == 0) ? &sprites[16 + (i / 32) % 4]
+                                  : &sprites[(i * 7) % 16];
+    GraphicsObject& go = object.go;
+    go.SetX(rng() % (kScreenWidth - object.sprite->width));
+    go.SetY(rng() % (kScreenHeight - object.sprite->height));
+    if (i % 5 == 0)
+      go.SetTint(RGBColour(40, 0, 80));
+    if (i % 11 == 0)
+      go.SetColour(RGBAColour(255, 0, 0, 128));
+    if (i % 16 == 3)
+      go.SetCompositeMode(1);
+    if (i % 4 == 1)
+      go.SetAlpha(192);
+  }
+
+  SpriteBatch batch;
+  auto immediate_frame = [&]() {
+    BeginFrame();
+    for (const SceneObject& object : scene)
+      DrawImmediate(object);
+    glFinish();
+  };
+  auto batched_frame = [&]() {
+    BeginFrame();
+    for (const SceneObject& object : scene)
+      DrawBatched(object, batch);
+    batch.Flush();
+    glFinish();
+  };
+
+  // Both must draw the same picture. This is checked before anything is
+  // rotated: a rotated quad at 1:1 scale sits right on the switch between
+  // the minification and magnification filters, and which one the rasterizer
+  // picks is at the mercy of rounding.
+  immediate_frame();
+  std::vector<GLubyte> immediate_pixels = ReadScreen();
+  batched_frame();
+  std::vector<GLubyte> batched_pixels = ReadScreen();
+  int differing_pixels = 0;
+  for (size_t i = 0; i < immediate_pixels.size(); i += 4) {
+    for (int channel = 0; channel < 3; ++channel) {
+      if (std::abs(immediate_pixels[i + channel] -
+                   batched_pixels[i + channel]) > 2) {
+        differing_pixels++;
+        break;
+      }
+    }
+  }
+  EXPECT_EQ(0, differing_pixels);
+
+  for (int i = 0; i < kObjectCount; i += 9)
+    scene[i].go.SetRotation(150);
+
+  const int kIterations = 30;
+  double immediate = RunBenchmark("immediate mode, 256 objects",
+                                  kIterations, immediate_frame);
+
+  batch.ResetStats();
+  double batched =
+      RunBenchmark("sprite batch, 256 objects", kIterations, batched_frame);
+  const SpriteBatch::Stats& stats = batch.stats();
+
+  ReportBenchmarkValue("immediate mode draw calls", kObjectCount, "/frame");
+  ReportBenchmarkValue(
+      "sprite batch draw calls", double(stats.draw_calls) / kIterations,
+      "/frame");
+  ReportBenchmarkValue("speedup", immediate / batched, "x");
+
+  EXPECT_LT(stats.draw_calls / kIterations, kObjectCount / 4);
+
+  for (Sprite& sprite : sprites)
+    glDeleteTextures(1, &sprite.own_texture);
+  TextureAtlas::Get().Reset();
+  Shaders::Reset();
+}
+
+// Freeing images in the middle of a full page must make room for new ones
+// without the page emptying out first.
+TEST(SpriteBatchBenchmark, AtlasReusesFreedSlots) {
+  HeadlessContext context;
+  std::string error = context.Initialize();
+  if (!error.empty()) {
+    std::cout << "[ SKIPPED  ] No OpenGL: " << error << std::endl;
+    return;
+  }
+
+  TextureAtlas atlas;
+  std::vector<TextureAtlas::Allocation> slots;
+  TextureAtlas::Allocation slot;
+  while (atlas.Allocate(60, 60, &slot))
+    slots.push_back(slot);
+  const int max_pages = TextureAtlas::kMaxPages;
+  ASSERT_EQ(max_pages, atlas.page_count());
+
+  // Free every other image, so no page is ever empty.
+  int freed = 0;
+  for (size_t i = 0; i < slots.size(); i += 2) {
+    slots[i].page->Free(slots[i].x, slots[i].y, 60, 60);
+    slots[i].page.reset();
+    freed++;
+  }
+
+  // Each gap fits one image of the same size, or two narrower ones.
+  for (int i = 0; i < freed; ++i)
+    EXPECT_TRUE(atlas.Allocate(60, 60, &slot)) << "image " << i;
+  EXPECT_FALSE(atlas.Allocate(60, 60, &slot));
+
+  for (size_t i = 1; i < slots.size(); i += 2)
+    slots[i].page->Free(slots[i].x, slots[i].y, 60, 60);
+  for (int i = 0; i < freed * 2; ++i)
+    EXPECT_TRUE(atlas.Allocate(28, 60, &slot)) << "image " << i;
+}
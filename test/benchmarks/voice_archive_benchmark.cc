@@ -0,0 +1,115 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+
+#include "gtest/gtest.h"
+
+#include <boost/filesystem.hpp>
+
+#include <iomanip>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "benchmarks/benchmark_utils.h"
+#include "libreallive/gameexe.h"
+#include "systems/base/nwk_voice_archive.h"
+#include "systems/base/voice_cache.h"
+#include "test_system/test_system.h"
+#include "test_utils.h"
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+// Sixteen archives of 64 tenth of a second lines; more archives than the old
+// seven entry archive cache held.
+const int kArchives = 16;
+const int kSamplesPerArchive = 64;
+const int kFrames = 2205;
+const int kRate = 22050;
+const int kPlays = 1000;
+
+fs::path ArchivePath(const fs::path& koe_dir, int file_no) {
+  std::ostringstream oss;
+  oss << "z" << std::setw(4) << std::setfill('0') << file_no << ".nwk";
+  return koe_dir / oss.str();
+}
+
+}  // namespace
+
+// Plays 1000 random voice ids through VoiceCache, which maps each archive once
+// and decodes from slices of the mapping, and compares that with opening the
+// archive afresh for every line as happened whenever the cache missed.
+TEST(VoiceArchiveBenchmark, RandomVoiceIds) {
+  const fs::path dir = fs::temp_directory_path() / fs::unique_path();
+  const fs::path koe_dir = dir / "KOE";
+  fs::create_directories(koe_dir);
+
+  std::vector<int> koe_nums;
+  for (int i = 0; i < kSamplesPerArchive; ++i)
+    koe_nums.push_back(i * 3);
+  for (int file_no = 1; file_no <= kArchives; ++file_no)
+    writeTestNWK(ArchivePath(koe_dir, file_no).string(), koe_nums, kFrames,
+                 kRate);
+
+  std::mt19937 rng(23);
+  std::uniform_int_distribution<int> archive(1, kArchives);
+  std::uniform_int_distribution<int> sample(0, kSamplesPerArchive - 1);
+  std::vector<int> ids;
+  for (int i = 0; i < kPlays; ++i)
+    ids.push_back(archive(rng) * 100000 + koe_nums[sample(rng)]);
+
+  TestSystem system;
+  system.gameexe()("__GAMEPATH") = dir.string() + "/";
+  system.gameexe()("FOLDNAME.KOE") = "KOE";
+  VoiceCache cache(system.sound());
+
+  long long checksum = 0;
+  double mapped = RunBenchmark("VoiceCache, 1000 random ids", 10, [&]() {
+    for (int id : ids) {
+      int length = 0;
+      std::unique_ptr<char[]> data(cache.Decode(id, &length));
+      checksum += data[WAV_HEADER_SIZE + length - 1];
+    }
+  });
+  double reopened = RunBenchmark("Reopening the archive per id", 10, [&]() {
+    for (int id : ids) {
+      NWKVoiceArchive archive(ArchivePath(koe_dir, id / 100000), id / 100000);
+      int length = 0;
+      std::unique_ptr<char[]> data(
+          archive.FindSample(id % 100000)->Decode(&length));
+      checksum += data[WAV_HEADER_SIZE + length - 1];
+    }
+  });
+  ReportBenchmarkValue("Per voice (VoiceCache)", mapped / kPlays, "us");
+  ReportBenchmarkValue("Per voice (reopened)", reopened / kPlays, "us");
+  EXPECT_NE(0, checksum);
+
+  fs::remove_all(dir);
+}
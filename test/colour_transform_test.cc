@@ -0,0 +1,216 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <vector>
+
+#include "systems/base/colour.h"
+#include "systems/base/colour_transform.h"
+#include "systems/base/pixel_blitter.h"
+#include "systems/base/rect.h"
+#include "utilities/graphics.h"
+#include "test_utils.h"
+
+namespace {
+
+struct Channels {
+  uint8_t r, g, b;
+};
+
+// -----------------------------------------------------------------------
+// The old ColourTransformers from sdl_surface.cc, with SDL_Color swapped
+// for Channels.
+// -----------------------------------------------------------------------
+
+Channels OldInvert(const Channels& colour) {
+  Channels out = {static_cast<uint8_t>(255 - colour.r),
+                  static_cast<uint8_t>(255 - colour.g),
+                  static_cast<uint8_t>(255 - colour.b)};
+  return out;
+}
+
+Channels OldMono(const Channels& colour) {
+  float grayscale = 0.3 * colour.r + 0.59 * colour.g + 0.11 * colour.b;
+  Clamp(grayscale, 0, 255);
+  uint8_t grey = grayscale;
+  Channels out = {grey, grey, grey};
+  return out;
+}
+
+int OldCompose(int in_colour, int surface_colour) {
+  if (in_colour > 0) {
+    return 255 -
+           ((static_cast<float>((255 - in_colour) * (255 - surface_colour)) /
+             (255 * 255)) *
+            255);
+  } else if (in_colour < 0) {
+    return (static_cast<float>(abs(in_colour) * surface_colour) /
+            (255 * 255)) *
+           255;
+  } else {
+    return surface_colour;
+  }
+}
+
+// What TransformSurface() did to each pixel of |area|: split it with
+// SDL_GetRGBA(), transform and repack, keeping alpha.
+void OldTransform(std::vector<uint32_t>& pixels, int w, const Rect& area,
+                  const std::function<Channels(const Channels&)>& transform) {
+  for (int y = area.y(); y < area.y2(); ++y) {
+    for (int x = area.x(); x < area.x2(); ++x) {
+      uint32_t& p = pixels[y * w + x];
+      Channels in = {static_cast<uint8_t>(p >> 16),
+                     static_cast<uint8_t>(p >> 8), static_cast<uint8_t>(p)};
+      Channels out = transform(in);
+      p = (p & 0xff000000) | (out.r << 16) | (out.g << 8) | out.b;
+    }
+  }
+}
+
+std::vector<uint32_t> RandomPixels(std::mt19937& rng, int count) {
+  std::vector<uint32_t> pixels(count);
+  for (uint32_t& p : pixels)
+    p = rng();
+  return pixels;
+}
+
+PixelBuffer BufferFor(std::vector<uint32_t>& pixels, int w, int h) {
+  return PixelBuffer(reinterpret_cast<char*>(pixels.data()), Size(w, h),
+                     w * 4);
+}
+
+// Runs |transform| and |old_transform| over random rectangles of random
+// images, with widths that leave tails after every vector width, on both
+// kernel sets.
+void ExpectMatchesOld(
+    const std::function<void(const PixelBuffer&, const Rect&)>& transform,
+    const std::function<Channels(const Channels&)>& old_transform) {
+  forEachKernelSet([&] {
+    std::mt19937 rng(16);
+    for (int i = 0; i < 50; ++i) {
+      const int w = 1 + rng() % 90, h = 1 + rng() % 20;
+      const int x = rng() % w, y = rng() % h;
+      const Rect area =
+          Rect::REC(x, y, 1 + rng() % (w - x), 1 + rng() % (h - y));
+      std::vector<uint32_t> expected = RandomPixels(rng, w * h);
+      std::vector<uint32_t> actual = expected;
+
+      OldTransform(expected, w, area, old_transform);
+      transform(BufferFor(actual, w, h), area);
+      ASSERT_EQ(expected, actual) << "case " << i;
+    }
+  });
+}
+
+}  // namespace
+
+TEST(ColourTransform, InvertMatchesOldTransformer) {
+  ExpectMatchesOld(InvertPixels, OldInvert);
+}
+
+TEST(ColourTransform, MonoMatchesOldTransformer) {
+  ExpectMatchesOld(MonoPixels, OldMono);
+}
+
+// The vector kernels' integer grey has to agree with the float formula on
+// every colour, not just random ones.
+TEST(ColourTransform, MonoMatchesOldTransformerOnEveryColour) {
+  forEachKernelSet([] {
+    std::vector<uint32_t> pixels(256 * 256);
+    for (int b = 0; b < 256; ++b) {
+      for (int i = 0; i < 256 * 256; ++i)
+        pixels[i] = 0x80000000 | (i << 8) | b;
+      std::vector<uint32_t> expected = pixels;
+      OldTransform(expected, 256, Rect::REC(0, 0, 256, 256), OldMono);
+      MonoPixels(BufferFor(pixels, 256, 256), Rect::REC(0, 0, 256, 256));
+      ASSERT_EQ(expected, pixels) << "blue " << b;
+    }
+  });
+}
+
+TEST(ColourTransform, ToneCurveMatchesOldTransformer) {
+  std::mt19937 rng(17);
+  ToneCurveRGBMap curve;
+  for (ToneCurveColorMap& map : curve) {
+    for (unsigned char& value : map)
+      value = rng();
+  }
+  ExpectMatchesOld(
+      [&](const PixelBuffer& buffer, const Rect& area) {
+        ToneCurvePixels(buffer, area, curve);
+      },
+      [&](const Channels& colour) {
+        Channels out = {curve[0][colour.r], curve[1][colour.g],
+                        curve[2][colour.b]};
+        return out;
+      });
+}
+
+TEST(ColourTransform, ApplyColourMatchesOldTransformer) {
+  const RGBColour colours[] = {RGBColour(0, 0, 0), RGBColour(255, -255, 0),
+                               RGBColour(100, -37, 12),
+                               RGBColour(-300, 400, -1)};
+  for (const RGBColour& colour : colours) {
+    ExpectMatchesOld(
+        [&](const PixelBuffer& buffer, const Rect& area) {
+          ApplyColourPixels(buffer, area, colour);
+        },
+        [&](const Channels& in) {
+          Channels out = {static_cast<uint8_t>(OldCompose(colour.r(), in.r)),
+                          static_cast<uint8_t>(OldCompose(colour.g(), in.g)),
+                          static_cast<uint8_t>(OldCompose(colour.b(), in.b))};
+          return out;
+        });
+  }
+}
+
+TEST(ColourTransform, ClipsToTheBuffer) {
+  std::vector<uint32_t> pixels(4 * 4, 0xff000000);
+  InvertPixels(BufferFor(pixels, 4, 4), Rect::REC(2, -1, 10, 2));
+  for (int y = 0; y < 4; ++y) {
+    for (int x = 0; x < 4; ++x) {
+      EXPECT_EQ((x >= 2 && y == 0) ? 0xffffffffu : 0xff000000u,
+                pixels[y * 4 + x]);
+    }
+  }
+}
+
+TEST(ColourTransform, ThreadsSplitRowsWithoutChangingOutput) {
+  const int w = 1280, h = 720;
+  std::mt19937 rng(18);
+  const std::vector<uint32_t> pixels = RandomPixels(rng, w * h);
+  const Rect area = Rect::REC(3, 5, 1270, 700);
+
+  expectSameOnFourBlitThreads([&] {
+    std::vector<uint32_t> actual = pixels;
+    MonoPixels(BufferFor(actual, w, h), area);
+    return actual;
+  });
+}
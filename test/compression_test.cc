@@ -0,0 +1,167 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+
+#include "gtest/gtest.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "libreallive/alldefs.h"
+#include "libreallive/compression.h"
+#include "test_utils.h"
+
+using libreallive::compression::Decompress;
+using libreallive::compression::DecompressReference;
+using libreallive::compression::XorKey;
+
+namespace {
+
+const XorKey* const kKeys[] = {
+    nullptr,
+    libreallive::compression::little_busters_xor_mask,
+    libreallive::compression::little_busters_ex_xor_mask,
+    libreallive::compression::clannad_full_voice_xor_mask,
+};
+
+// DecompressReference() writes whole back references past |dst_len|, so it
+// gets some slack.
+const size_t kSlack = 32;
+
+// Runs both decoders over |src| and expects the same output, or an Error
+// from both.
+void ExpectSameOutput(const std::string& name,
+                      const char* src,
+                      size_t src_len,
+                      size_t dst_len,
+                      const XorKey* key) {
+  std::vector<char> expected(dst_len + kSlack);
+  bool expected_throws = false;
+  try {
+    DecompressReference(src, src_len, expected.data(), dst_len, key);
+  } catch (libreallive::Error&) {
+    expected_throws = true;
+  }
+
+  forEachKernelSet([&] {
+    std::vector<char> actual(dst_len);
+    bool actual_throws = false;
+    try {
+      Decompress(src, src_len, actual.data(), dst_len, key);
+    } catch (libreallive::Error&) {
+      actual_throws = true;
+    }
+
+    ASSERT_EQ(expected_throws, actual_throws) << name;
+    if (!expected_throws) {
+      ASSERT_TRUE(std::equal(actual.begin(), actual.end(), expected.begin()))
+          << name;
+    }
+  });
+}
+
+// Builds a masked stream of random literals and back references that
+// decompresses to |out_len| bytes. With |corrupt|, one back reference
+// points before the start of the output.
+std::string MakeRandomStream(std::mt19937& rng, size_t out_len, bool corrupt) {
+  std::string plain(8, '\0');
+  size_t produced = 0;
+  size_t corrupt_at = corrupt ? rng() % (out_len + 1) : out_len + 1;
+  // Mostly short distances, so overlapping copies get exercised.
+  std::uniform_int_distribution<int> short_distance(1, 20);
+  while (produced < out_len) {
+    size_t flag_pos = plain.size();
+    plain.push_back(0);
+    unsigned char flag = 0;
+    for (int bit = 0; bit < 8 && produced < out_len; ++bit) {
+      if (produced == 0 || rng() % 3 == 0) {
+        flag |= 1 << bit;
+        plain.push_back(static_cast<char>(rng()));
+        produced++;
+      } else {
+        size_t max_distance = std::min<size_t>(produced, 0xfff);
+        size_t distance = rng() % 2 ? std::min<size_t>(short_distance(rng),
+                                                       max_distance)
+                                    : 1 + rng() % max_distance;
+        if (produced >= corrupt_at) {
+          distance = produced + 1;
+          corrupt_at = out_len + 1;
+        }
+        size_t count = rng() % 16;
+        int token = (distance << 4) | count;
+        plain.push_back(token & 0xff);
+        plain.push_back((token >> 8) & 0xff);
+        produced += count + 2;
+      }
+    }
+    plain[flag_pos] = flag;
+  }
+
+  for (size_t i = 8; i < plain.size(); ++i)
+    plain[i] ^= libreallive::compression::xor_mask[i % 256];
+  return plain;
+}
+
+}  // namespace
+
+TEST(CompressionTest, MatchesReferenceOnTestScenarios) {
+  std::vector<CompressedScenario> scenarios = loadAllTestScenarios();
+  ASSERT_FALSE(scenarios.empty());
+  for (const CompressedScenario& scenario : scenarios) {
+    for (const XorKey* key : kKeys) {
+      ExpectSameOutput(scenario.name,
+                       scenario.data.data() + scenario.compressed_offset,
+                       scenario.compressed_length,
+                       scenario.decompressed_length, key);
+    }
+  }
+}
+
+TEST(CompressionTest, MatchesReferenceOnRandomStreams) {
+  std::mt19937 rng(20260101);
+  for (int i = 0; i < 2000; ++i) {
+    const size_t out_len = rng() % 3000;
+    const bool corrupt = rng() % 8 == 0;
+    std::string stream = MakeRandomStream(rng, out_len, corrupt);
+    // Sometimes give the decoder less room than the stream fills.
+    const size_t dst_len = rng() % 4 == 0 ? rng() % (out_len + 1) : out_len;
+    // Keep the reference decoder's reads of a trailing token in bounds.
+    stream.append(2, '\0');
+    ExpectSameOutput("random stream " + std::to_string(i), stream.data(),
+                     stream.size() - 2, dst_len, kKeys[i % 4]);
+  }
+}
+
+TEST(CompressionTest, RejectsBackReferenceBeforeStart) {
+  // One flag byte announcing a back reference with nothing to refer to.
+  std::string stream(8, '\0');
+  stream.push_back(0 ^ libreallive::compression::xor_mask[8]);
+  stream.push_back(0x13 ^ libreallive::compression::xor_mask[9]);
+  stream.push_back(0x00 ^ libreallive::compression::xor_mask[10]);
+  char out[16];
+  EXPECT_THROW(Decompress(stream.data(), stream.size(), out, sizeof(out),
+                          nullptr),
+               libreallive::Error);
+}
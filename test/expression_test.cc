@@ -28,8 +28,12 @@
 #include "gtest/gtest.h"
 
 #include "libreallive/archive.h"
+#include "libreallive/compiled_expression.h"
+#include "libreallive/elements/command.h"
+#include "libreallive/elements/expression.h"
 #include "libreallive/expression.h"
 #include "libreallive/intmemref.h"
+#include "libreallive/scenario.h"
 #include "machine/rlmachine.h"
 #include "modules/module_jmp.h"
 #include "test_system/test_system.h"
@@ -39,6 +43,66 @@
 using namespace std;
 using namespace libreallive;
 
+namespace {
+
+const char kIntBanks[] = "ABCDEFGZ";
+
+// Fills the start of every integer bank with small values, positive and
+// negative, so indexed references exercise both valid and invalid locations.
+void SeedIntMemory(RLMachine& machine) {
+  for (const char* bank = kIntBanks; *bank; ++bank) {
+    for (int i = 0; i < 40; ++i)
+      machine.SetIntValue(IntMemRef(*bank, i), (i * 7 + *bank) % 23 - 3);
+  }
+  for (int i = 0; i < 40; ++i)
+    machine.SetIntValue(IntMemRef('L', i), i % 5);
+  machine.set_store_register(3);
+}
+
+void ExpectSameIntMemory(RLMachine& expected, RLMachine& actual) {
+  for (const char* bank = kIntBanks; *bank; ++bank) {
+    for (int i = 0; i < 2000; ++i) {
+      ASSERT_EQ(expected.GetIntValue(IntMemRef(*bank, i)),
+                actual.GetIntValue(IntMemRef(*bank, i)))
+          << "int" << *bank << "[" << i << "]";
+    }
+  }
+  for (int i = 0; i < 40; ++i) {
+    ASSERT_EQ(expected.GetIntValue(IntMemRef('L', i)),
+              actual.GetIntValue(IntMemRef('L', i)))
+        << "intL[" << i << "]";
+  }
+  EXPECT_EQ(expected.store_register(), actual.store_register());
+}
+
+// Evaluates |tree| on |tree_machine| and its compiled form on
+// |compiled_machine|, expecting the same value, errors and memory writes.
+void ExpectSameEvaluation(const Expression& tree,
+                          RLMachine& tree_machine,
+                          RLMachine& compiled_machine) {
+  std::unique_ptr<CompiledExpression> code = CompiledExpression::Compile(*tree);
+  ASSERT_TRUE(code) << tree->GetDebugString();
+
+  int expected = 0, actual = 0;
+  bool tree_threw = false, compiled_threw = false;
+  try {
+    expected = tree->GetIntegerValue(tree_machine);
+  } catch (std::exception& e) {
+    tree_threw = true;
+  }
+  try {
+    actual = code->Evaluate(compiled_machine);
+  } catch (std::exception& e) {
+    compiled_threw = true;
+  }
+
+  EXPECT_EQ(tree_threw, compiled_threw) << tree->GetDebugString();
+  EXPECT_EQ(expected, actual) << tree->GetDebugString();
+  ExpectSameIntMemory(tree_machine, compiled_machine);
+}
+
+}  // namespace
+
 TEST(ExpressionTest, BasicArithmatic) {
   TestSystem system;
   libreallive::Archive arc(
@@ -148,3 +212,152 @@ TEST(ExpressionTest, ParseQuotedEnglishString) {
 
   ASSERT_EQ(16, libreallive::NextString(s.c_str()));
 }
+
+// Every integer expression and parameter in the ExpressionTest corpus must
+// evaluate the same through CompiledExpression as it does as a tree.
+TEST(ExpressionTest, CompiledMatchesTreeOnCorpus) {
+  const char* const kCorpus[] = {
+      "ExpressionTest_SEEN/basicOperators.TXT",
+      "ExpressionTest_SEEN/comparisonOperators.TXT",
+      "ExpressionTest_SEEN/logicalOperators.TXT",
+      "ExpressionTest_SEEN/previousErrors.TXT",
+  };
+
+  for (const char* name : kCorpus) {
+    libreallive::Archive arc(locateTestCase(name));
+    TestSystem tree_system, compiled_system;
+    RLMachine tree_machine(tree_system, arc);
+    RLMachine compiled_machine(compiled_system, arc);
+    SeedIntMemory(tree_machine);
+    SeedIntMemory(compiled_machine);
+
+    int compiled = 0;
+    Scenario* scenario = arc.GetFirstScenario();
+    for (auto it = scenario->begin(); it != scenario->end(); ++it) {
+      std::vector<Expression> expressions;
+      if (auto* element = dynamic_cast<const ExpressionElement*>(*it)) {
+        expressions.push_back(element->ParsedExpression());
+      } else if (auto* command = dynamic_cast<const CommandElement*>(*it)) {
+        for (const std::string& param : command->GetUnparsedParameters()) {
+          const char* src = param.c_str();
+          try {
+            expressions.push_back(GetData(src));
+          } catch (libreallive::Error& e) {
+            // Not every parameter is an expression.
+          }
+        }
+      }
+
+      for (const Expression& expression : expressions) {
+        if (!CompiledExpression::Compile(*expression))
+          continue;
+        ++compiled;
+        ExpectSameEvaluation(expression, tree_machine, compiled_machine);
+      }
+    }
+
+    EXPECT_GT(compiled, 0) << name;
+  }
+}
+
+// Covers the pieces of the compiler the corpus doesn't: indexed and bit-wide
+// memory access, the store register, division by zero and invalid locations.
+TEST(ExpressionTest, CompiledMatchesTreeOnEdgeCases) {
+  const char* const kExpressions[] = {
+      // intA[3] += 2
+      "$ 00 [ $ ff 03 00 00 00 ] 5c 14 $ ff 02 00 00 00",
+      // intB[intA[0]] = 7
+      "$ 01 [ $ 00 [ $ ff 00 00 00 00 ] ] 5c 1e $ ff 07 00 00 00",
+      // intC[intL[2]] *= intD[1] - 4
+      "$ 02 [ $ 0b [ $ ff 02 00 00 00 ] ] 5c 16 $ 03 [ $ ff 01 00 00 00 ] "
+      "5c 01 $ ff 04 00 00 00",
+      // intAb[5] = 1
+      "$ 1a [ $ ff 05 00 00 00 ] 5c 1e $ ff 01 00 00 00",
+      // intA4b[intA[1]] |= 9
+      "$ 4e [ $ 00 [ $ ff 01 00 00 00 ] ] 5c 1a $ ff 09 00 00 00",
+      // intZ8b[3] = intG2b[7] + 300
+      "$ 81 [ $ ff 03 00 00 00 ] 5c 1e $ 3a [ $ ff 07 00 00 00 ] "
+      "5c 00 $ ff 2c 01 00 00",
+      // intA[0] /= 0
+      "$ 00 [ $ ff 00 00 00 00 ] 5c 17 $ ff 00 00 00 00",
+      // store %= intE[2]
+      "$ c8 5c 18 $ 04 [ $ ff 02 00 00 00 ]",
+      // intF[intF[0]] = 1, where intF[0] is negative
+      "$ 05 [ $ 05 [ $ ff 00 00 00 00 ] ] 5c 1e $ ff 01 00 00 00",
+      // store = intA[-(intB[2] << 3)] > 2 && intC[1] != 0
+      "$ c8 5c 1e $ 00 [ 5c 01 ( $ 01 [ $ ff 02 00 00 00 ] 5c 08 "
+      "$ ff 03 00 00 00 ) ] 5c 2d $ ff 02 00 00 00 5c 3c "
+      "$ 02 [ $ ff 01 00 00 00 ] 5c 29 $ ff 00 00 00 00",
+  };
+
+  libreallive::Archive arc(
+      locateTestCase("ExpressionTest_SEEN/basicOperators.TXT"));
+  TestSystem tree_system, compiled_system;
+  RLMachine tree_machine(tree_system, arc);
+  RLMachine compiled_machine(compiled_system, arc);
+  SeedIntMemory(tree_machine);
+  SeedIntMemory(compiled_machine);
+
+  for (const char* printable : kExpressions) {
+    std::string parsable = PrintableToParsableString(printable);
+    const char* src = parsable.c_str();
+    Expression expression = GetAssignment(src);
+    ExpectSameEvaluation(expression, tree_machine, compiled_machine);
+  }
+}
+
+// The parser never nests assignments, but a tree built by hand can. A
+// compound assignment evaluates its indexed location once to read and again
+// to write, so here the read and the write land on different elements.
+TEST(ExpressionTest, CompiledMatchesTreeOnSideEffectingLocation) {
+  // intA[intB[0] += 1] += 5
+  Expression location = ExpressionFactory::BinaryExpression(
+      20,
+      ExpressionFactory::MemoryReference(1, ExpressionFactory::IntConstant(0)),
+      ExpressionFactory::IntConstant(1));
+  Expression expression = ExpressionFactory::BinaryExpression(
+      20, ExpressionFactory::MemoryReference(0, location),
+      ExpressionFactory::IntConstant(5));
+
+  libreallive::Archive arc(
+      locateTestCase("ExpressionTest_SEEN/basicOperators.TXT"));
+  TestSystem tree_system, compiled_system;
+  RLMachine tree_machine(tree_system, arc);
+  RLMachine compiled_machine(compiled_system, arc);
+  SeedIntMemory(tree_machine);
+  SeedIntMemory(compiled_machine);
+  tree_machine.SetIntValue(IntMemRef('B', 0), 4);
+  compiled_machine.SetIntValue(IntMemRef('B', 0), 4);
+  const int read = tree_machine.GetIntValue(IntMemRef('A', 5));
+
+  ExpectSameEvaluation(expression, tree_machine, compiled_machine);
+  EXPECT_EQ(6, compiled_machine.GetIntValue(IntMemRef('B', 0)));
+  EXPECT_EQ(read + 5, compiled_machine.GetIntValue(IntMemRef('A', 6)));
+}
+
+TEST(ExpressionTest, CompilerFoldsConstants) {
+  // -5 + 1 * 2; the parser only folds constant pairs, leaving the negation.
+  std::string parsable = PrintableToParsableString(
+      "5c 01 $ ff 05 00 00 00 5c 00 $ ff 01 00 00 00 5c 02 $ ff 02 00 00 00");
+  const char* src = parsable.c_str();
+  Expression expression = GetExpression(src);
+
+  std::unique_ptr<CompiledExpression> code =
+      CompiledExpression::Compile(*expression);
+  ASSERT_TRUE(code);
+  EXPECT_TRUE(code->is_constant());
+
+  TestSystem system;
+  libreallive::Archive arc(
+      locateTestCase("ExpressionTest_SEEN/basicOperators.TXT"));
+  RLMachine rlmachine(system, arc);
+  EXPECT_EQ(-3, code->Evaluate(rlmachine));
+}
+
+// String expressions are left to the tree evaluator.
+TEST(ExpressionTest, CompilerRejectsStrings) {
+  std::string parsable = PrintableToParsableString("$ 12 [ $ ff 00 00 00 00 ]");
+  const char* src = parsable.c_str();
+  Expression expression = GetExpression(src);
+  EXPECT_FALSE(CompiledExpression::Compile(*expression));
+}
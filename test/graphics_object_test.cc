@@ -264,6 +264,21 @@ TEST_F(GraphicsObjectTest, GetObjectData) {
   EXPECT_EQ(data, &obj.GetObjectData());
 }
 
+// Moving hands over the object data itself instead of a clone, and leaves the
+// source cleared.
+TEST_F(GraphicsObjectTest, MoveTakesObjectData) {
+  GraphicsObject obj;
+  obj.SetX(50);
+  MockGraphicsObjectData* data = new MockGraphicsObjectData;
+  obj.SetObjectData(data);
+
+  GraphicsObject moved(std::move(obj));
+  EXPECT_EQ(data, &moved.GetObjectData());
+  EXPECT_EQ(50, moved.x());
+  EXPECT_FALSE(obj.has_object_data());
+  EXPECT_TRUE(obj.is_cleared());
+}
+
 // TODO: Use the above mock to test more of the insides of GraphicsObject...
 
 TEST_F(GraphicsObjectTest, TestColourFilter) {
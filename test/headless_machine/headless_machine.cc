@@ -0,0 +1,80 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#include "headless_machine/headless_machine.h"
+
+#include <boost/core/demangle.hpp>
+
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+#include "long_operations/button_object_select_long_operation.h"
+#include "long_operations/select_long_operation.h"
+#include "machine/long_operation.h"
+
+// -----------------------------------------------------------------------
+// HeadlessMachine
+// -----------------------------------------------------------------------
+HeadlessMachine::HeadlessMachine(System& in_system,
+                                 libreallive::Archive& in_archive,
+                                 SelectionPolicy policy,
+                                 unsigned int seed)
+    : RLMachine(in_system, in_archive), policy_(policy), random_(seed) {}
+
+HeadlessMachine::~HeadlessMachine() {}
+
+void HeadlessMachine::PushLongOperation(LongOperation* long_operation) {
+  long_operation_counts_[boost::core::demangle(
+      typeid(*long_operation).name())]++;
+
+  if (SelectLongOperation* sel =
+          dynamic_cast<SelectLongOperation*>(long_operation)) {
+    std::vector<int> indexes = sel->GetSelectableIndexes();
+    if (!indexes.empty()) {
+      int choice = indexes.front();
+      if (policy_ == SELECT_LAST) {
+        choice = indexes.back();
+      } else if (policy_ == SELECT_RANDOM) {
+        std::uniform_int_distribution<size_t> dist(0, indexes.size() - 1);
+        choice = indexes[dist(random_)];
+      }
+      sel->SelectByIndex(choice);
+      selections_++;
+    }
+  } else if (ButtonObjectSelectLongOperation* sel =
+                 dynamic_cast<ButtonObjectSelectLongOperation*>(
+                     long_operation)) {
+    // Like lua_rlvm, answer button selections with the first button instead
+    // of trying to click on graphics objects that are never drawn.
+    set_store_register(1);
+    selections_++;
+    delete sel;
+    return;
+  }
+
+  RLMachine::PushLongOperation(long_operation);
+}
@@ -0,0 +1,71 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#ifndef TEST_HEADLESS_MACHINE_HEADLESS_MACHINE_H_
+#define TEST_HEADLESS_MACHINE_HEADLESS_MACHINE_H_
+
+#include <map>
+#include <random>
+#include <string>
+
+#include "machine/rlmachine.h"
+
+// An RLMachine used by headless_rlvm, which answers every selection by
+// itself according to a fixed policy and counts the LongOperations a game
+// pushes.
+class HeadlessMachine : public RLMachine {
+ public:
+  enum SelectionPolicy { SELECT_FIRST, SELECT_LAST, SELECT_RANDOM };
+
+  HeadlessMachine(System& in_system,
+                  libreallive::Archive& in_archive,
+                  SelectionPolicy policy,
+                  unsigned int seed);
+  virtual ~HeadlessMachine();
+
+  // Number of times each kind of LongOperation was pushed, by class name.
+  const std::map<std::string, int>& long_operation_counts() const {
+    return long_operation_counts_;
+  }
+
+  // Number of selections answered by |policy_|.
+  int selections() const { return selections_; }
+
+  // Overloaded from RLMachine:
+  virtual void PushLongOperation(LongOperation* long_operation) override;
+
+ private:
+  SelectionPolicy policy_;
+
+  // Drives SELECT_RANDOM; seeded so that runs are reproducible.
+  std::mt19937 random_;
+
+  std::map<std::string, int> long_operation_counts_;
+
+  int selections_ = 0;
+};  // end of class HeadlessMachine
+
+#endif  // TEST_HEADLESS_MACHINE_HEADLESS_MACHINE_H_
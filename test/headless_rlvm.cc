@@ -0,0 +1,245 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+// Runs a game's SEEN.TXT as fast as possible on top of the null systems used
+// by the unit tests: text is fast forwarded, selections are answered by a
+// policy and the loop never sleeps. Reports instruction throughput, how many
+// LongOperations were pushed and, optionally, where opcode time went. Meant
+// for replaying whole games to catch interpreter performance regressions.
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/program_options.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "headless_machine/headless_machine.h"
+#include "libreallive/archive.h"
+#include "libreallive/gameexe.h"
+#include "machine/game_hacks.h"
+#include "machine/opcode_profile.h"
+#include "modules/modules.h"
+#include "systems/base/graphics_system.h"
+#include "systems/base/surface_cache.h"
+#include "systems/base/system_error.h"
+#include "test_system/test_system.h"
+#include "utilities/exception.h"
+#include "utilities/file.h"
+
+using namespace std;
+
+namespace po = boost::program_options;
+namespace fs = boost::filesystem;
+
+// -----------------------------------------------------------------------
+
+void printUsage(const string& name, po::options_description& opts) {
+  cout << "Usage: " << name << " [options] <game root>" << endl
+       << opts << endl;
+}
+
+// -----------------------------------------------------------------------
+
+int main(int argc, char* argv[]) {
+  po::options_description opts("Options");
+  opts.add_options()("help", "Produce help message")(
+      "start-seen", po::value<int>(),
+      "Jump to the start of this scenario instead of #SEEN_START")(
+      "select", po::value<string>()->default_value("first"),
+      "How to answer selections: first, last or random")(
+      "seed", po::value<unsigned int>()->default_value(0),
+      "Random seed for --select=random")(
+      "max-instructions", po::value<int64_t>(),
+      "Stop after this many instructions")(
+      "batch-size", po::value<int>()->default_value(4096),
+      "Instructions per RLMachine::ExecuteBatch() call")(
+      "profile-opcodes", "Report the time spent in each module's opcodes")(
+      "image-cache-stats", "Report image cache hits and evictions")(
+      "undefined-opcodes", "Display a message on undefined opcodes")(
+      "count-undefined",
+      "On exit, present a summary table about how many times each undefined "
+      "opcode was called")(
+      "memory", "Forces debug mode (Sets #MEMORY=1 in the Gameexe.ini file)");
+
+  po::options_description hidden("Hidden");
+  hidden.add_options()("game-root", po::value<string>(),
+                       "Location of game root");
+
+  po::positional_options_description p;
+  p.add("game-root", 1);
+
+  po::options_description commandLineOpts;
+  commandLineOpts.add(opts).add(hidden);
+
+  po::variables_map vm;
+  try {
+    po::store(po::basic_command_line_parser<char>(argc, argv)
+                  .options(commandLineOpts)
+                  .positional(p)
+                  .run(),
+              vm);
+    po::notify(vm);
+  } catch (po::error& e) {
+    cerr << "ERROR: " << e.what() << endl;
+    return -1;
+  }
+
+  if (vm.count("help") || !vm.count("game-root")) {
+    printUsage(argv[0], opts);
+    return vm.count("help") ? 0 : -1;
+  }
+
+  HeadlessMachine::SelectionPolicy policy;
+  const string select = vm["select"].as<string>();
+  if (select == "first") {
+    policy = HeadlessMachine::SELECT_FIRST;
+  } else if (select == "last") {
+    policy = HeadlessMachine::SELECT_LAST;
+  } else if (select == "random") {
+    policy = HeadlessMachine::SELECT_RANDOM;
+  } else {
+    cerr << "ERROR: Unknown selection policy '" << select << "'." << endl;
+    return -1;
+  }
+
+  fs::path gamerootPath = vm["game-root"].as<string>();
+  if (!fs::is_directory(gamerootPath)) {
+    cerr << "ERROR: Path '" << gamerootPath << "' is not a directory." << endl;
+    return -1;
+  }
+
+  // Some games hide data in a lower subdirectory.
+  if (CorrectPathCase(gamerootPath / "Gameexe.ini").empty()) {
+    if (!CorrectPathCase(gamerootPath / "KINETICDATA" / "Gameexe.ini")
+             .empty()) {
+      gamerootPath /= "KINETICDATA/";
+    } else if (!CorrectPathCase(gamerootPath / "REALLIVEDATA" / "Gameexe.ini")
+                    .empty()) {
+      gamerootPath /= "REALLIVEDATA/";
+    }
+  }
+
+  try {
+    const fs::path gameexePath = CorrectPathCase(gamerootPath / "Gameexe.ini");
+    const fs::path seenPath = CorrectPathCase(gamerootPath / "Seen.txt");
+    if (gameexePath.empty() || seenPath.empty()) {
+      cerr << "ERROR: Path '" << gamerootPath << "' does not contain a "
+           << "RealLive game." << endl;
+      return -1;
+    }
+
+    TestSystem system(gameexePath.string());
+    Gameexe& gameexe = system.gameexe();
+    gameexe("__GAMEPATH") = gamerootPath.string();
+    if (vm.count("memory"))
+      gameexe("MEMORY") = 1;
+
+    libreallive::Archive arc(seenPath.string(),
+                             gameexe("REGNAME").ToString(""));
+    HeadlessMachine rlmachine(system, arc, policy,
+                              vm["seed"].as<unsigned int>());
+    AddAllModules(rlmachine);
+    AddGameHacks(rlmachine);
+    rlmachine.SetHaltOnException(false);
+
+    // Skip every pause; nobody is reading.
+    system.set_force_fast_forward();
+
+    if (vm.count("undefined-opcodes"))
+      rlmachine.SetPrintUndefinedOpcodes(true);
+    if (vm.count("count-undefined"))
+      rlmachine.RecordUndefinedOpcodeCounts();
+    if (vm.count("profile-opcodes"))
+      rlmachine.RecordOpcodeTimes();
+
+    if (vm.count("start-seen"))
+      rlmachine.Jump(vm["start-seen"].as<int>(), 0);
+
+    const int64_t max_instructions =
+        vm.count("max-instructions") ? vm["max-instructions"].as<int64_t>()
+                                     : 0;
+    RLMachine::ExecutionBudget batch;
+    int64_t instructions = 0;
+
+    const auto start = chrono::steady_clock::now();
+    while (!rlmachine.halted()) {
+      batch.instructions = vm["batch-size"].as<int>();
+      if (max_instructions) {
+        if (instructions >= max_instructions)
+          break;
+        batch.instructions = static_cast<int>(min<int64_t>(
+            batch.instructions, max_instructions - instructions));
+      }
+
+      system.Run(rlmachine);
+      instructions += rlmachine.ExecuteBatch(batch);
+      system.set_force_wait(false);
+    }
+    const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+    int long_operations = 0;
+    for (auto const& entry : rlmachine.long_operation_counts())
+      long_operations += entry.second;
+
+    cout << "Instructions:      " << instructions << endl
+         << "Elapsed:           " << fixed << setprecision(3)
+         << elapsed.count() << " s" << endl
+         << "Instructions/sec:  " << setprecision(0)
+         << (elapsed.count() > 0 ? instructions / elapsed.count() : 0.0)
+         << endl
+         << "Selections made:   " << rlmachine.selections() << endl
+         << "Long operations:   " << long_operations << endl;
+    for (auto const& entry : rlmachine.long_operation_counts())
+      cout << "  " << setw(10) << entry.second << "  " << entry.first << endl;
+
+    if (rlmachine.opcode_profile())
+      cout << endl << *rlmachine.opcode_profile();
+
+    if (vm.count("image-cache-stats"))
+      cout << endl << system.graphics().image_cache();
+  }
+  catch (rlvm::Exception& e) {
+    cerr << "Fatal RLVM error: " << e.what() << endl;
+    return 1;
+  }
+  catch (libreallive::Error& e) {
+    cerr << "Fatal libreallive error: " << e.what() << endl;
+    return 1;
+  }
+  catch (SystemError& e) {
+    cerr << "Fatal local system error: " << e.what() << endl;
+    return 1;
+  }
+  catch (std::exception& e) {
+    cerr << "Uncaught exception: " << e.what() << endl;
+    return 1;
+  }
+
+  return 0;
+}
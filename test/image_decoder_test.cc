@@ -0,0 +1,187 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "systems/base/image_decoder.h"
+#include "test_utils.h"
+#include "xclannad/file.h"
+
+namespace {
+
+struct DecodeCase {
+  TestImageFormat format;
+  bool with_alpha;
+};
+
+const DecodeCase kCases[] = {
+    {TEST_G00_TYPE0, false}, {TEST_G00_TYPE1, false},
+    {TEST_G00_TYPE2, false}, {TEST_G00_TYPE2, true},
+    {TEST_PDT10, false},     {TEST_PDT10, true},
+    {TEST_PDT11, false},     {TEST_PDT11, true},
+};
+
+// Sizes around the eight and sixteen pixel kernel widths, plus a larger one
+// with long back references.
+const int kSizes[][2] = {{1, 1}, {7, 3}, {16, 2}, {33, 17}, {203, 77}};
+
+// What GRPCONV::Read() makes of |file|, and whether it has alpha the way
+// DecodeImageFile() used to decide.
+std::vector<char> ReferenceDecode(const std::string& file, bool* has_alpha) {
+  std::unique_ptr<GRPCONV> conv(
+      GRPCONV::AssignConverter(file.data(), file.size(), "test"));
+  EXPECT_TRUE(conv);
+  const size_t pixels = conv->Width() * conv->Height();
+  std::vector<char> image(pixels * 4 + 4096);
+  EXPECT_TRUE(conv->Read(image.data()));
+  image.resize(pixels * 4);
+
+  *has_alpha = false;
+  for (size_t i = 0; conv->IsMask() && i < pixels; ++i)
+    *has_alpha |= static_cast<unsigned char>(image[i * 4 + 3]) != 0xff;
+  return image;
+}
+
+std::vector<char> FastDecode(const std::string& file, bool* has_alpha) {
+  std::unique_ptr<GRPCONV> conv(
+      GRPCONV::AssignConverter(file.data(), file.size(), "test"));
+  EXPECT_TRUE(conv);
+  // Fill with junk so any pixel the decoder skips shows up.
+  std::vector<char> image(conv->Width() * conv->Height() * 4, '\xcd');
+  *has_alpha = false;
+  EXPECT_TRUE(DecodeGrpImage(*conv, image.data(), has_alpha));
+  return image;
+}
+
+void ExpectSameAsReference() {
+  for (const DecodeCase& test : kCases) {
+    for (const auto& size : kSizes) {
+      for (unsigned int seed = 1; seed <= 3; ++seed) {
+        SCOPED_TRACE(::testing::Message()
+                     << "format " << test.format << " alpha "
+                     << test.with_alpha << " " << size[0] << "x" << size[1]
+                     << " seed " << seed);
+        std::string file = makeTestImage(
+            test.format, size[0], size[1], seed, test.with_alpha);
+        bool reference_alpha, fast_alpha;
+        std::vector<char> reference = ReferenceDecode(file, &reference_alpha);
+        std::vector<char> fast = FastDecode(file, &fast_alpha);
+        ASSERT_EQ(reference.size(), fast.size());
+        EXPECT_TRUE(reference == fast);
+        EXPECT_EQ(reference_alpha, fast_alpha);
+      }
+    }
+  }
+}
+
+TEST(ImageDecoderTest, MatchesReferenceDecoder) {
+  SCOPED_TRACE(ImageKernelName());
+  forEachKernelSet(ExpectSameAsReference);
+}
+
+TEST(ImageDecoderTest, AlphaFollowsTheMask) {
+  bool has_alpha = true;
+  FastDecode(makeTestImage(TEST_G00_TYPE2, 40, 40, 1, false), &has_alpha);
+  EXPECT_FALSE(has_alpha);
+  FastDecode(makeTestImage(TEST_G00_TYPE2, 40, 40, 1, true), &has_alpha);
+  EXPECT_TRUE(has_alpha);
+  FastDecode(makeTestImage(TEST_PDT10, 40, 40, 1, true), &has_alpha);
+  EXPECT_TRUE(has_alpha);
+
+  // Without a mask the alpha bytes are meaningless, even when they're zero.
+  FastDecode(makeTestImage(TEST_PDT10, 40, 40, 1, false), &has_alpha);
+  EXPECT_FALSE(has_alpha);
+}
+
+TEST(ImageDecoderTest, SurvivesDamagedStreams) {
+  for (const DecodeCase& test : kCases) {
+    std::string file = makeTestImage(test.format, 64, 48, 7, test.with_alpha);
+    for (unsigned int seed = 0; seed < 50; ++seed) {
+      std::string damaged = file;
+      // Leave the headers alone so GRPCONV still accepts the file.
+      for (int i = 0; i < 8; ++i) {
+        size_t pos = 0x460 + (seed * 7919 + i * 104729) %
+                                 (damaged.size() > 0x460 ? damaged.size() - 0x460
+                                                         : 1);
+        if (pos < damaged.size())
+          damaged[pos] ^= static_cast<char>(seed * 31 + i + 1);
+      }
+      bool has_alpha;
+      FastDecode(damaged, &has_alpha);
+    }
+  }
+
+  // A G00 type 2 index whose signed offset and length point outside the
+  // stream draws nothing instead of reading past it.
+  const int32_t kStreamSize = 12 + 0x74 + 0x5c + 8 * 4 * 4;
+  bool has_alpha;
+  std::vector<char> image =
+      FastDecode(makeG00Type2WithIndexEntry(8, 4, 12, kStreamSize - 12),
+                 &has_alpha);
+  EXPECT_EQ(std::vector<char>(image.size(), '\xff'), image);
+  EXPECT_FALSE(has_alpha);
+
+  const int32_t kBadEntries[][2] = {
+      {-1, 0x74},
+      {12, -1},
+      {-0x10000, 0x10000 + kStreamSize},
+      {12, kStreamSize},
+      {kStreamSize + 1, 0x74},
+      {0x7fffffff, 0x7fffffff},
+  };
+  for (const auto& entry : kBadEntries) {
+    SCOPED_TRACE(::testing::Message() << entry[0] << ", " << entry[1]);
+    image = FastDecode(makeG00Type2WithIndexEntry(8, 4, entry[0], entry[1]),
+                       &has_alpha);
+    EXPECT_EQ(std::vector<char>(image.size(), '\0'), image);
+    EXPECT_TRUE(has_alpha);
+  }
+}
+
+TEST(ImageDecoderTest, LeavesBitmapsToGrpconv) {
+  std::string bmp(0x36 + 4 * 4, '\0');
+  bmp[0] = 'B';
+  bmp[1] = 'M';
+  bmp[10] = 0x36;
+  bmp[14] = 0x28;
+  bmp[0x12] = 2;
+  bmp[0x16] = 2;
+  bmp[0x1c] = 32;
+  std::unique_ptr<GRPCONV> conv(
+      GRPCONV::AssignConverter(bmp.data(), bmp.size(), "test"));
+  ASSERT_TRUE(conv);
+  std::vector<char> image(16, '\xcd');
+  bool has_alpha = false;
+  EXPECT_FALSE(DecodeGrpImage(*conv, image.data(), &has_alpha));
+  EXPECT_EQ(std::vector<char>(16, '\xcd'), image);
+}
+
+}  // namespace
@@ -0,0 +1,136 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+
+#include "gtest/gtest.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "systems/base/image_disk_cache.h"
+#include "systems/base/image_loader.h"
+#include "test_utils.h"
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+class ImageDiskCacheTest : public ::testing::Test {
+ protected:
+  ImageDiskCacheTest()
+      : dir_(fs::temp_directory_path() / fs::unique_path()),
+        cache_(dir_ / "cache") {
+    fs::create_directories(dir_);
+  }
+  ~ImageDiskCacheTest() { fs::remove_all(dir_); }
+
+  fs::path WriteImage(const std::string& name, const std::string& contents) {
+    fs::path path = dir_ / name;
+    fs::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(contents.data(), contents.size());
+    return path;
+  }
+
+  void ExpectSameImage(const DecodedImage& a, const DecodedImage& b) {
+    ASSERT_EQ(a.size, b.size);
+    EXPECT_EQ(a.has_alpha, b.has_alpha);
+    ASSERT_TRUE(a.data());
+    ASSERT_TRUE(b.data());
+    EXPECT_EQ(0, memcmp(a.data(), b.data(),
+                        a.size.width() * a.size.height() * 4));
+    ASSERT_EQ(a.region_table.size(), b.region_table.size());
+    for (size_t i = 0; i < a.region_table.size(); ++i) {
+      EXPECT_EQ(a.region_table[i].rect, b.region_table[i].rect);
+      EXPECT_EQ(a.region_table[i].originX, b.region_table[i].originX);
+      EXPECT_EQ(a.region_table[i].originY, b.region_table[i].originY);
+    }
+  }
+
+  fs::path dir_;
+  ImageDiskCache cache_;
+};
+
+}  // namespace
+
+TEST_F(ImageDiskCacheTest, SecondDecodeComesFromTheCache) {
+  fs::path path =
+      WriteImage("PARTS.g00", makeTestImage(TEST_G00_TYPE2, 96, 64, 3, true));
+
+  std::shared_ptr<const DecodedImage> decoded = DecodeImageFile(path, &cache_);
+  EXPECT_TRUE(decoded->pixels);
+  EXPECT_FALSE(decoded->mapping);
+  EXPECT_TRUE(fs::exists(cache_.EntryPath(path)));
+
+  std::shared_ptr<const DecodedImage> cached = DecodeImageFile(path, &cache_);
+  EXPECT_FALSE(cached->pixels);
+  EXPECT_TRUE(cached->mapping);
+  ExpectSameImage(*decoded, *cached);
+  EXPECT_GT(cached->region_table.size(), 1u);
+}
+
+TEST_F(ImageDiskCacheTest, EntriesAreTiedToTheSourceFile) {
+  const std::string original = makeTestImage(TEST_PDT10, 40, 30, 1, true);
+  fs::path path = WriteImage("BG01.pdt", original);
+  std::shared_ptr<const DecodedImage> decoded = DecodeImageFile(path, &cache_);
+  EXPECT_TRUE(cache_.Find(path, original));
+
+  // Same size and modification time, different contents.
+  std::time_t mtime = fs::last_write_time(path);
+  std::string edited = original;
+  edited[edited.size() / 2] ^= 0x55;
+  WriteImage("BG01.pdt", edited);
+  fs::last_write_time(path, mtime);
+  EXPECT_FALSE(cache_.Find(path, edited));
+
+  // Same contents, touched.
+  WriteImage("BG01.pdt", original);
+  fs::last_write_time(path, mtime + 10);
+  EXPECT_FALSE(cache_.Find(path, original));
+
+  // A different file at another path never sees this entry.
+  fs::path other = WriteImage("BG02.pdt", original);
+  EXPECT_FALSE(cache_.Find(other, original));
+}
+
+TEST_F(ImageDiskCacheTest, IgnoresDamagedEntries) {
+  const std::string contents = makeTestImage(TEST_G00_TYPE0, 64, 48, 2, false);
+  fs::path path = WriteImage("CG01.g00", contents);
+  std::shared_ptr<const DecodedImage> decoded = DecodeImageFile(path, &cache_);
+
+  fs::path entry = cache_.EntryPath(path);
+  fs::resize_file(entry, fs::file_size(entry) - 100);
+  EXPECT_FALSE(cache_.Find(path, contents));
+  fs::resize_file(entry, 10);
+  EXPECT_FALSE(cache_.Find(path, contents));
+
+  // Decoding again replaces the damaged entry.
+  ExpectSameImage(*decoded, *DecodeImageFile(path, &cache_));
+  std::shared_ptr<const DecodedImage> cached = cache_.Find(path, contents);
+  ASSERT_TRUE(cached);
+  ExpectSameImage(*decoded, *cached);
+}
@@ -0,0 +1,189 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#include "gtest/gtest.h"
+
+#include <boost/filesystem.hpp>
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "libreallive/archive.h"
+#include "libreallive/elements/command.h"
+#include "libreallive/scenario.h"
+#include "machine/rlmachine.h"
+#include "systems/base/image_loader.h"
+#include "test_system/test_system.h"
+#include "test_utils.h"
+#include "utilities/exception.h"
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+class ImageLoaderTest : public ::testing::Test {
+ protected:
+  ImageLoaderTest() : dir_(fs::temp_directory_path() / fs::unique_path()) {
+    fs::create_directories(dir_);
+  }
+  ~ImageLoaderTest() { fs::remove_all(dir_); }
+
+  fs::path WriteG00(const std::string& name, int width, int height) {
+    fs::path path = dir_ / (name + ".g00");
+    writeTestG00(path.string(), width, height);
+    return path;
+  }
+
+  fs::path dir_;
+};
+
+// Bytecode for a command with the given parameters.
+std::string Command(int modtype, int module, int opcode,
+                    const std::vector<std::string>& params) {
+  std::string repr(8, 0);
+  repr[0] = '#';
+  repr[1] = modtype;
+  repr[2] = module;
+  repr[3] = opcode & 0xff;
+  repr[4] = opcode >> 8;
+  repr[5] = params.size();
+  repr += "(";
+  for (size_t i = 0; i < params.size(); ++i)
+    repr += (i ? "," : "") + params[i];
+  return repr + ")";
+}
+
+}  // namespace
+
+TEST_F(ImageLoaderTest, DecodesG00) {
+  std::shared_ptr<const DecodedImage> image =
+      DecodeImageFile(WriteG00("BG01", 13, 7));
+  ASSERT_TRUE(image->pixels);
+  EXPECT_EQ(Size(13, 7), image->size);
+  EXPECT_FALSE(image->has_alpha);
+  ASSERT_EQ(1u, image->region_table.size());
+  EXPECT_EQ(Rect(Point(0, 0), Size(13, 7)), image->region_table[0].rect);
+
+  const uint32_t* pixels =
+      reinterpret_cast<const uint32_t*>(image->pixels.get());
+  for (int y = 0; y < 7; ++y) {
+    for (int x = 0; x < 13; ++x)
+      EXPECT_EQ(testG00Pixel(x, y), pixels[y * 13 + x] & 0xffffff);
+  }
+}
+
+TEST_F(ImageLoaderTest, PrefetchMatchesSynchronousDecode) {
+  ImageLoader loader(2);
+  std::vector<fs::path> paths;
+  for (int i = 0; i < 6; ++i) {
+    paths.push_back(WriteG00("IMG" + std::to_string(i), 40 + i, 30));
+    loader.Prefetch("IMG" + std::to_string(i), paths.back());
+  }
+  EXPECT_EQ(6u, loader.pending_size());
+
+  for (int i = 0; i < 6; ++i) {
+    ImageLoader::Future future = loader.Take("IMG" + std::to_string(i));
+    ASSERT_TRUE(future.valid());
+    std::shared_ptr<const DecodedImage> async = future.get();
+    std::shared_ptr<const DecodedImage> sync = DecodeImageFile(paths[i]);
+    ASSERT_EQ(sync->size, async->size);
+    EXPECT_EQ(0, memcmp(sync->pixels.get(), async->pixels.get(),
+                        sync->size.width() * sync->size.height() * 4));
+  }
+  EXPECT_EQ(0u, loader.pending_size());
+}
+
+TEST_F(ImageLoaderTest, TakeHandsOverOnce) {
+  ImageLoader loader(1);
+  fs::path path = WriteG00("BG01", 8, 8);
+  ImageLoader::Future first = loader.Prefetch("BG01", path);
+  EXPECT_TRUE(loader.IsPending("BG01"));
+
+  // Asking again doesn't queue a second decode.
+  ImageLoader::Future second = loader.Prefetch("BG01", path);
+  EXPECT_EQ(1u, loader.pending_size());
+
+  EXPECT_TRUE(loader.Take("BG01").valid());
+  EXPECT_FALSE(loader.IsPending("BG01"));
+  EXPECT_FALSE(loader.Take("BG01").valid());
+  EXPECT_EQ(first.get(), second.get());
+}
+
+// Prefetches pushed out of the pending set take their queued decode with them,
+// so a busy worker only ever has work somebody can still take.
+TEST_F(ImageLoaderTest, EvictedPrefetchesLeaveTheQueue) {
+  ImageLoader loader(1);
+  loader.Prefetch("BIG", WriteG00("BIG", 1024, 1024));
+  const fs::path small = WriteG00("SMALL", 4, 4);
+  for (int i = 0; i < 64; ++i) {
+    loader.Prefetch("IMG" + std::to_string(i), small);
+    EXPECT_LE(loader.queued_size(), loader.pending_size());
+  }
+  EXPECT_FALSE(loader.IsPending("IMG0"));
+  EXPECT_TRUE(loader.IsPending("IMG63"));
+}
+
+TEST_F(ImageLoaderTest, DecodeErrorsReachTheTaker) {
+  ImageLoader loader(1);
+  loader.Prefetch("MISSING", dir_ / "MISSING.g00");
+  ImageLoader::Future future = loader.Take("MISSING");
+  ASSERT_TRUE(future.valid());
+  EXPECT_THROW(future.get(), rlvm::Exception);
+}
+
+TEST_F(ImageLoaderTest, FindsImageNamesInImageCommands) {
+  const std::string int_five = std::string("$\xff\x05\0\0\0", 6);
+  const std::string str_s0 = std::string("$\x12[$\xff\0\0\0\0]", 10);
+  std::string bytecode =
+      // grpLoad-like Grp command with a bare and a quoted name.
+      Command(1, 33, 73, {"BG01", "\"cg 02\""}) +
+      // A module that doesn't load images.
+      Command(1, 250, 0, {"NOTIMAGE"}) +
+      // objOfFile with an integer and a name.
+      Command(1, 71, 1000, {int_five, "OBJ1"}) +
+      // Names held in string memory can't be known ahead of time, "???" is
+      // the default grp name and duplicates in one command are only reported
+      // once.
+      Command(1, 33, 73, {str_s0, "???", "BG01", "BG01"});
+  const fs::path seen = dir_ / "SEEN.TXT";
+  writeTestSeen(seen.string(), 1, bytecode, {});
+
+  libreallive::Archive arc(seen.string());
+  TestSystem system;
+  RLMachine rlmachine(system, arc);
+  const libreallive::Scenario& scenario = rlmachine.Scenario();
+
+  std::vector<std::vector<std::string>> names;
+  for (auto it = scenario.begin(); it != scenario.end(); ++it) {
+    if (auto* command = dynamic_cast<const libreallive::CommandElement*>(*it))
+      names.push_back(FindImageNames(rlmachine, *command));
+  }
+  EXPECT_EQ((std::vector<std::vector<std::string>>{
+                {"BG01", "cg 02"}, {}, {"OBJ1"}, {"BG01"}}),
+            names);
+}
@@ -38,6 +38,7 @@
 
 #include <iostream>
 #include <algorithm>
+#include <vector>
 using namespace std;
 
 const int SIZE = 10;
@@ -181,3 +182,70 @@ TEST_F(LazyArrayTest, Serialization) {
     checkArray(newArray);
   }
 }
+
+TEST_F(LazyArrayTest, IteratesSparseLargeArray) {
+  // Allocated slots spread across many words of the allocation bitmap,
+  // including whole runs of empty words.
+  const int kLarge = 64 * 64 * 2 + 17;
+  const std::vector<int> slots = {0, 1, 63, 64, 200, 4095, 4096, 8000, 8208};
+
+  LazyArray<int> lazyArray(kLarge);
+  for (int slot : slots)
+    lazyArray[slot] = slot;
+
+  std::vector<int> seen;
+  for (AllocatedLazyArrayIterator<int> it = lazyArray.begin();
+       it != lazyArray.end();
+       ++it) {
+    EXPECT_EQ(static_cast<int>(it.pos()), *it);
+    seen.push_back(it.pos());
+  }
+  EXPECT_EQ(slots, seen);
+
+  lazyArray.DeleteAt(4095);
+  lazyArray.DeleteAt(4096);
+  lazyArray.DeleteAt(8208);
+  EXPECT_FALSE(lazyArray.exists(4096));
+  seen.clear();
+  for (AllocatedLazyArrayIterator<int> it = lazyArray.begin();
+       it != lazyArray.end();
+       ++it) {
+    seen.push_back(it.pos());
+  }
+  EXPECT_EQ(std::vector<int>({0, 1, 63, 64, 200, 8000}), seen);
+
+  lazyArray.Clear();
+  EXPECT_TRUE(lazyArray.begin() == lazyArray.end());
+}
+
+TEST_F(LazyArrayTest, ItemsKeepTheirAddress) {
+  LazyArray<int> lazyArray(256);
+  int* first = &lazyArray[3];
+  for (int i = 0; i < 256; ++i)
+    lazyArray[i] = i;
+
+  EXPECT_EQ(first, &lazyArray[3]);
+  EXPECT_EQ(first + 1, &lazyArray[4]);
+}
+
+TEST_F(LazyArrayTest, CopyToMatchesSource) {
+  LazyArray<int> source(SIZE);
+  populateIntArray(source);
+
+  // The target has items where the source doesn't, and items past the
+  // source's size.
+  LazyArray<int> target(SIZE * 2);
+  for (int i = 1; i < SIZE * 2; i += 3)
+    target[i] = -1;
+
+  source.CopyTo(target);
+  EXPECT_EQ(SIZE, target.size());
+  checkArray(target);
+
+  int count = 0;
+  for (AllocatedLazyArrayIterator<int> it = target.begin(); it != target.end();
+       ++it) {
+    ++count;
+  }
+  EXPECT_EQ(SIZE / 2, count);
+}
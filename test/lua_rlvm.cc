@@ -248,6 +248,8 @@ int main(int argc, char* argv[]) {
       Sys_load()(rlmachine, vm["load-save"].as<int>());
     }
 
+    RLMachine::ExecutionBudget time_slice;
+    time_slice.milliseconds = 10;
     while (!rlmachine.halted()) {
       // Give SDL a chance to respond to events, redraw the screen,
       // etc.
@@ -256,14 +258,7 @@ int main(int argc, char* argv[]) {
       // Run the rlmachine through as many instructions as we can in a 10ms time
       // slice. Bail out if we switch to long operation mode, or if the screen
       // is marked as dirty.
-      unsigned int start_ticks = sdlSystem.event().GetTicks();
-      unsigned int end_ticks = start_ticks;
-      do {
-        rlmachine.ExecuteNextInstruction();
-        end_ticks = sdlSystem.event().GetTicks();
-      } while (!rlmachine.CurrentLongOperation() &&
-               !sdlSystem.force_wait() &&
-               (end_ticks - start_ticks < 10));
+      rlmachine.ExecuteBatch(time_slice);
 
       sdlSystem.set_force_wait(false);
     }
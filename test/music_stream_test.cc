@@ -0,0 +1,190 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "systems/base/music_stream.h"
+#include "xclannad/wavfile.h"
+
+namespace {
+
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+
+// A track whose frames hold their own position, optionally taking its time
+// to decode like a slow disk or a heavy codec would.
+class CountingFile : public WAVFILE {
+ public:
+  CountingFile(int frames, int stall_every = 0, int stall_ms = 0)
+      : frames_(frames),
+        position_(0),
+        reads_(0),
+        stall_every_(stall_every),
+        stall_ms_(stall_ms),
+        random_(7) {}
+
+  virtual int Read(char* buf, int blksize, int blklen) override {
+    if (stall_every_) {
+      int delay = ++reads_ % stall_every_ == 0 ? stall_ms_ : random_() % 2;
+      std::this_thread::sleep_for(milliseconds(delay));
+    }
+
+    int count = std::min(blklen, frames_ - position_);
+    for (int i = 0; i < count; ++i) {
+      int32_t frame = position_++;
+      memcpy(buf + i * blksize, &frame, sizeof(frame));
+    }
+    return count;
+  }
+
+  virtual void Seek(int count) override { position_ = count; }
+
+ private:
+  int frames_;
+  int position_;
+  int reads_;
+  int stall_every_;
+  int stall_ms_;
+  std::mt19937 random_;
+};
+
+// Reads |frames| frames, waiting for the decoder as needed.
+std::vector<int32_t> ReadFrames(MusicStream& stream, int frames) {
+  std::vector<int32_t> out(frames);
+  int read = 0;
+  while (read < frames && !stream.at_end()) {
+    read += stream.Read(reinterpret_cast<char*>(out.data() + read),
+                        std::min(1000, frames - read));
+  }
+  out.resize(read);
+  return out;
+}
+
+}  // namespace
+
+TEST(PcmRingBufferTest, WrapsAround) {
+  PcmRingBuffer ring(5);
+  int32_t in[4] = {1, 2, 3, 4};
+  int32_t out[4] = {0};
+
+  EXPECT_EQ(4, ring.Write(reinterpret_cast<char*>(in), 4));
+  EXPECT_EQ(1, ring.writable());
+  EXPECT_EQ(3, ring.Read(reinterpret_cast<char*>(out), 3));
+  EXPECT_EQ(3, out[2]);
+
+  // Only four more fit, across the end of the buffer.
+  EXPECT_EQ(4, ring.Write(reinterpret_cast<char*>(in), 4));
+  EXPECT_EQ(0, ring.Write(reinterpret_cast<char*>(in), 4));
+  EXPECT_EQ(5, ring.readable());
+
+  int32_t all[5] = {0};
+  EXPECT_EQ(5, ring.Read(reinterpret_cast<char*>(all), 5));
+  EXPECT_EQ(4, all[0]);
+  EXPECT_EQ(1, all[1]);
+  EXPECT_EQ(4, all[4]);
+  EXPECT_EQ(0, ring.Read(reinterpret_cast<char*>(all), 1));
+}
+
+TEST(MusicStreamTest, StopsAtEnd) {
+  MusicStream stream(new CountingFile(10000), 4096);
+  stream.Start(MusicStream::kStopAtEnd);
+
+  std::vector<int32_t> frames = ReadFrames(stream, 20000);
+  ASSERT_EQ(10000u, frames.size());
+  for (int i = 0; i < 10000; ++i)
+    ASSERT_EQ(i, frames[i]);
+  EXPECT_TRUE(stream.at_end());
+}
+
+TEST(MusicStreamTest, LoopsOnTheExactFrame) {
+  const int kLength = 10000;
+  const int kLoop = 3217;
+  MusicStream stream(new CountingFile(kLength), 4096);
+  stream.Start(kLoop);
+
+  std::vector<int32_t> frames = ReadFrames(stream, kLength * 4);
+  ASSERT_EQ(kLength * 4u, frames.size());
+  int expected = 0;
+  for (int i = 0; i < kLength * 4; ++i) {
+    ASSERT_EQ(expected, frames[i]) << "frame " << i;
+    if (++expected == kLength)
+      expected = kLoop;
+  }
+  EXPECT_FALSE(stream.at_end());
+}
+
+// Plays a track with decode stalls longer than an audio callback period, once
+// decoding in the callback as SDLMusic used to and once through a
+// MusicStream, and counts the callbacks that couldn't be filled in time.
+TEST(MusicStreamTest, DecodeStallsDoNotUnderrun) {
+  const int kCallbackFrames = 1024;
+  const int kRate = 48000;
+  const milliseconds kPeriod(kCallbackFrames * 1000 / kRate);
+  const int kCallbacks = 50;
+  const int kStallEvery = 8;
+  const int kStallMs = 60;
+
+  std::vector<char> buffer(kCallbackFrames * PcmRingBuffer::kFrameSize);
+
+  int direct_underruns = 0;
+  {
+    CountingFile file(kRate * 60, kStallEvery, kStallMs);
+    for (int i = 0; i < kCallbacks; ++i) {
+      auto start = steady_clock::now();
+      file.Read(buffer.data(), PcmRingBuffer::kFrameSize, kCallbackFrames);
+      if (steady_clock::now() - start > kPeriod)
+        ++direct_underruns;
+    }
+  }
+
+  MusicStream stream(new CountingFile(kRate * 60, kStallEvery, kStallMs));
+  stream.Start(MusicStream::kStopAtEnd);
+  auto deadline = steady_clock::now();
+  int expected = 0;
+  for (int i = 0; i < kCallbacks; ++i) {
+    deadline += kPeriod;
+    std::this_thread::sleep_until(deadline);
+    int count = stream.Read(buffer.data(), kCallbackFrames);
+    for (int j = 0; j < count; ++j) {
+      int32_t frame;
+      memcpy(&frame, buffer.data() + j * PcmRingBuffer::kFrameSize, 4);
+      ASSERT_EQ(expected++, frame);
+    }
+  }
+
+  // Every stall is sure to miss a callback when decoding in it. How many the
+  // decoder thread misses depends on how the machine schedules it, so only
+  // require that it does better.
+  EXPECT_GT(direct_underruns, 0);
+  EXPECT_LT(stream.underruns(), direct_underruns);
+}
@@ -0,0 +1,324 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "systems/base/pixel_blitter.h"
+#include "systems/base/rect.h"
+#include "test_utils.h"
+
+namespace {
+
+// Stands in for an SDL_Surface in the display context format.
+struct TestSurface {
+  TestSurface(int w, int h, bool has_alpha)
+      : w(w), h(h), has_alpha(has_alpha), pixels(w * h, 0) {}
+
+  uint32_t& at(int x, int y) { return pixels[y * w + x]; }
+  uint32_t at(int x, int y) const { return pixels[y * w + x]; }
+
+  PixelBuffer buffer() {
+    return PixelBuffer(reinterpret_cast<char*>(pixels.data()), Size(w, h),
+                       w * 4);
+  }
+
+  int w, h;
+  bool has_alpha;
+  std::vector<uint32_t> pixels;
+};
+
+// -----------------------------------------------------------------------
+// The old SDLSurface::BlitToSurface() path, transcribed from SDL 1.2 and
+// pygame so it can run without either.
+// -----------------------------------------------------------------------
+
+// SDL_UpperBlit()'s clipping followed by the C blitter SDL picks for these
+// formats. |srcalpha| and |alpha| are the source's SDL_SetAlpha() state.
+void SDLBlit(const TestSurface& src, const Rect& srcrect, TestSurface& dst,
+             const Point& dstpt, bool srcalpha, uint8_t alpha) {
+  int srcx = srcrect.x(), srcy = srcrect.y();
+  int w = srcrect.width(), h = srcrect.height();
+  int dx = dstpt.x(), dy = dstpt.y();
+  if (srcx < 0) {
+    w += srcx;
+    dx -= srcx;
+    srcx = 0;
+  }
+  w = std::min(w, src.w - srcx);
+  if (srcy < 0) {
+    h += srcy;
+    dy -= srcy;
+    srcy = 0;
+  }
+  h = std::min(h, src.h - srcy);
+  if (dx < 0) {
+    w += dx;
+    srcx -= dx;
+    dx = 0;
+  }
+  w = std::min(w, dst.w - dx);
+  if (dy < 0) {
+    h += dy;
+    srcy -= dy;
+    dy = 0;
+  }
+  h = std::min(h, dst.h - dy);
+  if (w <= 0 || h <= 0)
+    return;
+
+  const bool blend = srcalpha && (src.has_alpha || alpha != 255);
+  for (int y = 0; y < h; ++y) {
+    for (int x = 0; x < w; ++x) {
+      uint32_t s = src.at(srcx + x, srcy + y);
+      uint32_t& dstp = dst.at(dx + x, dy + y);
+      if (!blend) {
+        dstp = src.has_alpha ? s : s | 0xff000000;
+      } else if (src.has_alpha) {
+        // BlitRGBtoRGBPixelAlpha
+        uint32_t a = s >> 24;
+        if (a) {
+          if (a == 0xff) {
+            dstp = (s & 0x00ffffff) | (dstp & 0xff000000);
+          } else {
+            uint32_t d = dstp;
+            uint32_t dalpha = d & 0xff000000;
+            uint32_t s1 = s & 0xff00ff;
+            uint32_t d1 = d & 0xff00ff;
+            d1 = (d1 + ((s1 - d1) * a >> 8)) & 0xff00ff;
+            s &= 0xff00;
+            d &= 0xff00;
+            d = (d + ((s - d) * a >> 8)) & 0xff00;
+            dstp = d1 | d | dalpha;
+          }
+        }
+      } else if (alpha == 128) {
+        // BlitRGBtoRGBSurfaceAlpha128
+        uint32_t d = dstp;
+        dstp = ((((s & 0x00fefefe) + (d & 0x00fefefe)) >> 1) +
+                (s & d & 0x00010101)) |
+               0xff000000;
+      } else {
+        // BlitRGBtoRGBSurfaceAlpha
+        uint32_t d = dstp;
+        uint32_t s1 = s & 0xff00ff;
+        uint32_t d1 = d & 0xff00ff;
+        d1 = (d1 + ((s1 - d1) * alpha >> 8)) & 0xff00ff;
+        s &= 0xff00;
+        d &= 0xff00;
+        d = (d + ((s - d) * alpha >> 8)) & 0xff00;
+        dstp = d1 | d | 0xff000000;
+      }
+    }
+  }
+}
+
+// pygame_AlphaBlit() of |srcrect| to the origin of |dst|, with the source
+// in the state SDLSurface creates it in.
+void PygameAlphaBlit(const TestSurface& src, const Rect& srcrect,
+                     TestSurface& dst) {
+  int srcx = srcrect.x(), srcy = srcrect.y();
+  int w = srcrect.width(), h = srcrect.height();
+  int dx = 0, dy = 0;
+  if (srcx < 0) {
+    w += srcx;
+    dx -= srcx;
+    srcx = 0;
+  }
+  w = std::min(w, src.w - srcx);
+  if (srcy < 0) {
+    h += srcy;
+    dy -= srcy;
+    srcy = 0;
+  }
+  h = std::min(h, src.h - srcy);
+  w = std::min(w, dst.w - dx);
+  h = std::min(h, dst.h - dy);
+
+  for (int y = 0; y < h; ++y) {
+    for (int x = 0; x < w; ++x) {
+      uint32_t s = src.at(srcx + x, srcy + y);
+      uint32_t& d = dst.at(dx + x, dy + y);
+      int sR = (s >> 16) & 0xff, sG = (s >> 8) & 0xff, sB = s & 0xff;
+      // alphablit_alpha for surfaces with an alpha channel, alphablit_solid
+      // with the default per-surface alpha for those without.
+      int sA = src.has_alpha ? s >> 24 : 255;
+      int dR = (d >> 16) & 0xff, dG = (d >> 8) & 0xff, dB = d & 0xff,
+          dA = d >> 24;
+      if (dA) {
+        dR = ((dR << 8) + (sR - dR) * sA + sR) >> 8;
+        dG = ((dG << 8) + (sG - dG) * sA + sG) >> 8;
+        dB = ((dB << 8) + (sB - dB) * sA + sB) >> 8;
+        dA = sA + dA - ((sA * dA) / 255);
+      } else {
+        dR = sR;
+        dG = sG;
+        dB = sB;
+        dA = sA;
+      }
+      d = (dA << 24) | (dR << 16) | (dG << 8) | dB;
+    }
+  }
+}
+
+void PygameStretch(const TestSurface& src, TestSurface& dst) {
+  int h_err = src.h * 2 - dst.h * 2;
+  int src_y = 0;
+  for (int y = 0; y < dst.h; ++y) {
+    int w_err = src.w * 2 - dst.w * 2;
+    int src_x = 0;
+    for (int x = 0; x < dst.w; ++x) {
+      dst.at(x, y) = src.at(src_x, src_y);
+      while (w_err >= 0) {
+        ++src_x;
+        w_err -= dst.w * 2;
+      }
+      w_err += src.w * 2;
+    }
+    while (h_err >= 0) {
+      ++src_y;
+      h_err -= dst.h * 2;
+    }
+    h_err += src.h * 2;
+  }
+}
+
+void OldBlitToSurface(const TestSurface& src, const Rect& src_rect,
+                      TestSurface& dst, const Rect& dst_rect, int alpha,
+                      bool use_src_alpha) {
+  if (src_rect.size() != dst_rect.size()) {
+    TestSurface src_image(src_rect.width(), src_rect.height(), true);
+    PygameAlphaBlit(src, src_rect, src_image);
+    TestSurface tmp(dst_rect.width(), dst_rect.height(), true);
+    PygameStretch(src_image, tmp);
+    SDLBlit(tmp, Rect(Point(0, 0), dst_rect.size()), dst, dst_rect.origin(),
+            use_src_alpha, use_src_alpha ? alpha : 255);
+  } else {
+    SDLBlit(src, src_rect, dst, dst_rect.origin(), use_src_alpha,
+            use_src_alpha ? alpha : 255);
+  }
+}
+
+// -----------------------------------------------------------------------
+
+void FillRandomly(TestSurface& surface, std::mt19937& rng) {
+  for (uint32_t& pixel : surface.pixels) {
+    pixel = rng();
+    // Fully transparent and fully opaque pixels take their own paths.
+    switch (rng() % 3) {
+      case 0:
+        pixel &= 0x00ffffff;
+        break;
+      case 1:
+        pixel |= 0xff000000;
+        break;
+    }
+  }
+}
+
+Rect RandomRect(std::mt19937& rng, int w, int h) {
+  return Rect::REC(int(rng() % (w + 30)) - 20, int(rng() % (h + 30)) - 20,
+                   1 + rng() % 70, 1 + rng() % 50);
+}
+
+void NewBlitToSurface(TestSurface& src, const Rect& src_rect,
+                      TestSurface& dst, const Rect& dst_rect, int alpha,
+                      bool use_src_alpha) {
+  BlitPixels(src.buffer(), src_rect, dst.buffer(), dst_rect,
+             SurfaceBlitOptions(src.has_alpha, src_rect.size() != dst_rect.size(),
+                                use_src_alpha, alpha));
+}
+
+void ExpectMatchesOldPath() {
+  std::mt19937 rng(7);
+  const int kAlphas[] = {0, 1, 127, 128, 200, 255};
+  for (int i = 0; i < 600; ++i) {
+    TestSurface src(53, 41, i % 2 == 0);
+    FillRandomly(src, rng);
+    TestSurface expected(67, 45, true);
+    FillRandomly(expected, rng);
+    TestSurface actual = expected;
+
+    Rect src_rect = RandomRect(rng, src.w, src.h);
+    Rect dst_rect = (i % 4 < 2)
+                        ? Rect(RandomRect(rng, expected.w, expected.h).origin(),
+                               src_rect.size())
+                        : RandomRect(rng, expected.w, expected.h);
+    int alpha = kAlphas[rng() % 6];
+    bool use_src_alpha = rng() % 4 != 0;
+
+    OldBlitToSurface(src, src_rect, expected, dst_rect, alpha, use_src_alpha);
+    NewBlitToSurface(src, src_rect, actual, dst_rect, alpha, use_src_alpha);
+    ASSERT_EQ(expected.pixels, actual.pixels)
+        << "blit " << i << ": " << src_rect << " -> " << dst_rect
+        << " alpha " << alpha << " use_src_alpha " << use_src_alpha
+        << " source alpha channel " << src.has_alpha;
+  }
+}
+
+}  // namespace
+
+TEST(PixelBlitterTest, MatchesOldSurfaceBlits) {
+  SCOPED_TRACE(BlitKernelName());
+  forEachKernelSet(ExpectMatchesOldPath);
+}
+
+TEST(PixelBlitterTest, ThreadsSplitRowsWithoutChangingOutput) {
+  std::mt19937 rng(3);
+  TestSurface src(640, 480, true);
+  FillRandomly(src, rng);
+  TestSurface dst(800, 600, true);
+  FillRandomly(dst, rng);
+
+  const Rect src_rect = Rect::REC(-5, 3, 640, 480);
+  const Rect dst_rects[] = {Rect::REC(100, 40, 640, 480),
+                            Rect::REC(-7, -9, 800, 611)};
+  for (const Rect& dst_rect : dst_rects) {
+    SCOPED_TRACE(dst_rect);
+    expectSameOnFourBlitThreads([&] {
+      TestSurface actual = dst;
+      NewBlitToSurface(src, src_rect, actual, dst_rect, 255, true);
+      return actual.pixels;
+    });
+  }
+}
+
+TEST(PixelBlitterTest, OverlappingBlitsReadTheOriginalPixels) {
+  std::mt19937 rng(4);
+  TestSurface surface(64, 64, true);
+  FillRandomly(surface, rng);
+  TestSurface original = surface;
+  TestSurface expected = surface;
+
+  const Rect src_rect = Rect::REC(0, 0, 40, 40);
+  const Rect dst_rect = Rect::REC(3, 2, 40, 40);
+  NewBlitToSurface(original, src_rect, expected, dst_rect, 255, true);
+  NewBlitToSurface(surface, src_rect, surface, dst_rect, 255, true);
+  EXPECT_EQ(expected.pixels, surface.pixels);
+}
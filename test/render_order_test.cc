@@ -0,0 +1,235 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <memory>
+#include <ostream>
+#include <random>
+#include <tuple>
+#include <vector>
+
+#include "systems/base/graphics_object.h"
+#include "systems/base/graphics_object_data.h"
+#include "systems/base/render_order.h"
+#include "systems/base/surface.h"
+#include "utilities/lazy_array.h"
+
+namespace {
+
+const int kSlots = 32;
+
+// Object data that draws nothing; it only has to be there.
+class EmptyObjectData : public GraphicsObjectData {
+ public:
+  virtual int PixelWidth(const GraphicsObject& go) override { return 0; }
+  virtual int PixelHeight(const GraphicsObject& go) override { return 0; }
+  virtual GraphicsObjectData* Clone() const override {
+    return new EmptyObjectData;
+  }
+  virtual void Execute(RLMachine& machine) override {}
+
+ protected:
+  virtual std::shared_ptr<const Surface> CurrentSurface(
+      const GraphicsObject& go) override {
+    return std::shared_ptr<const Surface>();
+  }
+  virtual void ObjectInfo(std::ostream& tree) override {}
+};
+
+bool ShowAll(int slot) { return true; }
+
+class RenderOrderTest : public ::testing::Test {
+ protected:
+  RenderOrderTest() : objects_(kSlots) {}
+
+  GraphicsObject& Show(int slot, int z_order = 0) {
+    GraphicsObject& obj = objects_[slot];
+    obj.SetObjectData(new EmptyObjectData);
+    obj.SetVisible(1);
+    obj.SetZOrder(z_order);
+    return obj;
+  }
+
+  // The listed slots, in order.
+  std::vector<int> Slots() {
+    order_.Update(objects_, ShowAll);
+    std::vector<int> slots;
+    for (const RenderOrder::Entry& entry : order_)
+      slots.push_back(entry.slot);
+    return slots;
+  }
+
+  // What sorting the objects from scratch gives.
+  std::vector<int> SortedSlots() {
+    std::vector<std::tuple<int, int, int, int>> keys;
+    for (AllocatedLazyArrayIterator<GraphicsObject> it = objects_.begin();
+         it != objects_.end();
+         ++it) {
+      if (it->visible() && it->has_object_data()) {
+        keys.emplace_back(
+            it->z_order(), it->z_layer(), it->z_depth(), it.pos());
+      }
+    }
+    std::sort(keys.begin(), keys.end());
+
+    std::vector<int> slots;
+    for (const auto& key : keys)
+      slots.push_back(std::get<3>(key));
+    return slots;
+  }
+
+  LazyArray<GraphicsObject> objects_;
+  RenderOrder order_;
+};
+
+}  // namespace
+
+TEST_F(RenderOrderTest, SortsByZValuesThenSlot) {
+  Show(0, 5);
+  Show(1, 2).SetZLayer(3);
+  Show(2, 2).SetZLayer(1);
+  Show(3, 2).SetZLayer(1);
+  Show(4, 2).SetZDepth(-1);
+  objects_[3].SetZDepth(4);
+
+  EXPECT_EQ(std::vector<int>({4, 2, 3, 1, 0}), Slots());
+}
+
+TEST_F(RenderOrderTest, ListsOnlyVisibleObjectsWithData) {
+  Show(0);
+  Show(1).SetVisible(0);
+  objects_[2].SetVisible(1);
+  Show(3);
+
+  EXPECT_EQ(std::vector<int>({0, 3}), Slots());
+
+  objects_[1].SetVisible(1);
+  objects_[3].FreeObjectData();
+  EXPECT_EQ(std::vector<int>({0, 1}), Slots());
+}
+
+TEST_F(RenderOrderTest, UnchangedFramesDoNotLookAtObjects) {
+  for (int i = 0; i < kSlots; ++i)
+    Show(i, kSlots - i);
+  std::vector<int> slots = Slots();
+  int rebuilds = order_.rebuilds();
+
+  // Nor does anything that can't change the order.
+  objects_[3].SetX(100);
+  objects_[4].SetAlpha(20);
+  objects_[5].SetZOrder(objects_[5].z_order());
+  objects_[6].SetVisible(1);
+  objects_[1].GetObjectData();
+  EXPECT_EQ(slots, Slots());
+  EXPECT_EQ(slots, Slots());
+  EXPECT_EQ(rebuilds, order_.rebuilds());
+
+  objects_[7].SetVisible(0);
+  objects_[7].SetVisible(1);
+  EXPECT_EQ(slots, Slots());
+  EXPECT_EQ(rebuilds + 1, order_.rebuilds());
+}
+
+TEST_F(RenderOrderTest, MovesObjectsWhoseZValuesChange) {
+  for (int i = 0; i < 8; ++i)
+    Show(i, i);
+  Slots();
+
+  objects_[0].SetZOrder(10);
+  objects_[6].SetZDepth(-1);
+  EXPECT_EQ(std::vector<int>({1, 2, 3, 4, 5, 6, 7, 0}), Slots());
+
+  objects_[6].SetZOrder(0);
+  EXPECT_EQ(std::vector<int>({6, 1, 2, 3, 4, 5, 7, 0}), Slots());
+}
+
+TEST_F(RenderOrderTest, FollowsObjectsComingAndGoing) {
+  Show(0, 1);
+  Show(1, 2);
+  Slots();
+
+  objects_.DeleteAt(0);
+  EXPECT_EQ(std::vector<int>({1}), Slots());
+
+  // Overwritten by a copy of a drawn object.
+  LazyArray<GraphicsObject> other(kSlots);
+  other[5] = objects_[1];
+  other[5].SetZOrder(0);
+  other.CopyTo(objects_);
+  EXPECT_EQ(std::vector<int>({5}), Slots());
+
+  objects_.Clear();
+  EXPECT_TRUE(Slots().empty());
+}
+
+TEST_F(RenderOrderTest, InvalidateRefilters) {
+  Show(0);
+  Show(1);
+  Show(2);
+  EXPECT_EQ(3u, Slots().size());
+
+  auto odd_only = [](int slot) { return slot % 2 == 1; };
+  order_.Update(objects_, odd_only);
+  EXPECT_EQ(3, order_.size());
+
+  order_.Invalidate();
+  order_.Update(objects_, odd_only);
+  ASSERT_EQ(1, order_.size());
+  EXPECT_EQ(1, order_.begin()->slot);
+}
+
+TEST_F(RenderOrderTest, MatchesSortingFromScratch) {
+  std::mt19937 random(19);
+  for (int step = 0; step < 500; ++step) {
+    int slot = random() % kSlots;
+    switch (random() % 6) {
+      case 0:
+        Show(slot, random() % 4);
+        break;
+      case 1:
+        objects_[slot].SetVisible(random() % 2);
+        break;
+      case 2:
+        objects_[slot].SetZLayer(random() % 3);
+        break;
+      case 3:
+        objects_[slot].SetZDepth(random() % 3);
+        break;
+      case 4:
+        objects_.DeleteAt(slot);
+        break;
+      case 5:
+        objects_[slot] = objects_[random() % kSlots];
+        break;
+    }
+
+    // Several changes may pile up between frames.
+    if (random() % 3 == 0) {
+      ASSERT_EQ(SortedSlots(), Slots()) << "after step " << step;
+    }
+  }
+}
@@ -0,0 +1,94 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "systems/base/audio_mixer.h"
+#include "systems/base/voice_archive.h"
+#include "systems/sdl/resample.h"
+#include "xclannad/endian.hpp"
+
+namespace {
+
+const int kOutputRate = 48000;
+const int kVoiceSeconds = 4;
+
+// A voice line as the decoders hand it over: a WAV header and a tone.
+std::string MakeVoiceLine(int rate, int channels) {
+  int frames = rate * kVoiceSeconds;
+  std::string data =
+      VoiceSample::MakeWavHeader(rate, channels, 2, frames * channels * 2);
+  data.resize(WAV_HEADER_SIZE + frames * channels * 2);
+  for (int i = 0; i < frames * channels; ++i) {
+    double t = static_cast<double>(i / channels) / rate;
+    int16_t sample = static_cast<int16_t>(8000 * sin(2 * M_PI * 440 * t));
+    write_little_endian_short(&data[WAV_HEADER_SIZE + i * 2], sample);
+  }
+  return data;
+}
+
+}  // namespace
+
+TEST(ResampleTest, PassesMatchingRatesThrough) {
+  std::string line = MakeVoiceLine(kOutputRate, 2);
+  std::shared_ptr<AudioClip> clip =
+      LoadWavClip(line.data(), line.size(), kOutputRate);
+  ASSERT_TRUE(clip);
+  ASSERT_EQ(static_cast<size_t>(kOutputRate * kVoiceSeconds), clip->frames());
+
+  for (size_t i = 0; i < clip->frames() * 2; ++i) {
+    int16_t sample = static_cast<int16_t>(
+        read_little_endian_short(line.data() + WAV_HEADER_SIZE + i * 2));
+    ASSERT_EQ(sample * (1.0f / 32768.0f), clip->samples()[i]) << "at " << i;
+  }
+}
+
+TEST(ResampleTest, ConvertsRate) {
+  for (int channels : {1, 2}) {
+    std::string line = MakeVoiceLine(22050, channels);
+    std::shared_ptr<AudioClip> clip =
+        LoadWavClip(line.data(), line.size(), kOutputRate);
+    ASSERT_TRUE(clip);
+
+    // The filter adds a few frames of ramp at either end.
+    int frames = clip->frames();
+    EXPECT_NEAR(kOutputRate * kVoiceSeconds, frames, 200);
+
+    // Still the same tone on both sides: the middle of the line keeps its
+    // amplitude.
+    for (int side = 0; side < 2; ++side) {
+      float peak = 0;
+      for (int i = frames / 2; i < frames / 2 + kOutputRate / 100; ++i)
+        peak = std::max(peak, std::fabs(clip->samples()[i * 2 + side]));
+      EXPECT_NEAR(8000, peak * 32768, 200) << channels << " channels";
+    }
+  }
+}
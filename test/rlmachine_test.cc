@@ -27,17 +27,26 @@
 
 #include "gtest/gtest.h"
 
+#include <boost/filesystem.hpp>
+
 #include <iostream>
 #include <utility>
 #include <string>
 #include <vector>
 
+#include "machine/long_operation.h"
 #include "machine/memory.h"
+#include "machine/opcode_profile.h"
 #include "machine/rlmachine.h"
+#include "machine/rlmodule.h"
+#include "machine/rloperation.h"
 #include "machine/serialization.h"
 #include "modules/module_str.h"
 #include "utilities/exception.h"
+#include "libreallive/archive.h"
+#include "libreallive/elements/command.h"
 #include "libreallive/intmemref.h"
+#include "test_system/test_text_window.h"
 #include "test_utils.h"
 
 using namespace std;
@@ -93,6 +102,91 @@ TEST_F(RLMachineTest, RejectsDoubleAttachs) {
   EXPECT_THROW({ rlmachine.AttachModule(new StrModule); }, rlvm::Exception);
 }
 
+namespace {
+
+struct CountingOpcode : public RLOpcode<> {
+  explicit CountingOpcode(int* count) : count_(count) {}
+  virtual void operator()(RLMachine& machine) override { ++*count_; }
+  virtual bool AdvanceInstructionPointer() override { return false; }
+  int* count_;
+};
+
+class CountingModule : public RLModule {
+ public:
+  explicit CountingModule(int* count) : RLModule("Counting", 1, 250) {
+    AddOpcode(0, 0, "count", new CountingOpcode(count));
+  }
+};
+
+// Bytecode for a call to opcode 0 of CountingModule with no arguments.
+std::string CountingCommand(unsigned char overload) {
+  std::string repr(8, 0);
+  repr[0] = '#';
+  repr[1] = 1;
+  repr[2] = static_cast<char>(250);
+  repr[7] = overload;
+  return repr + "()";
+}
+
+}  // namespace
+
+// CommandElements cache the RLOperation they resolve to, but two machines
+// running the same element must still reach their own modules.
+TEST_F(RLMachineTest, DispatchCacheIsPerMachine) {
+  int first = 0, second = 0;
+  rlmachine.AttachModule(new CountingModule(&first));
+  TestMachine other(system, arc);
+  other.AttachModule(new CountingModule(&second));
+
+  std::string repr = CountingCommand(0);
+  std::unique_ptr<CommandElement> f(
+      FunctionFactory::BuildFunctionElement(repr.c_str()));
+  rlmachine.ExecuteCommand(*f);
+  other.ExecuteCommand(*f);
+  rlmachine.ExecuteCommand(*f);
+
+  EXPECT_EQ(2, first);
+  EXPECT_EQ(1, second);
+}
+
+// Opcodes added to a module after it's attached are picked up.
+TEST_F(RLMachineTest, DispatchCacheSeesNewOpcodes) {
+  int count = 0;
+  CountingModule* module = new CountingModule(&count);
+  rlmachine.AttachModule(module);
+
+  std::string repr = CountingCommand(1);
+  std::unique_ptr<CommandElement> f(
+      FunctionFactory::BuildFunctionElement(repr.c_str()));
+  EXPECT_THROW(rlmachine.ExecuteCommand(*f), rlvm::UnimplementedOpcode);
+
+  module->AddOpcode(0, 1, "count", new CountingOpcode(&count));
+  rlmachine.ExecuteCommand(*f);
+  EXPECT_EQ(1, count);
+}
+
+TEST_F(RLMachineTest, RecordOpcodeTimesChargesModule) {
+  int count = 0;
+  rlmachine.AttachModule(new CountingModule(&count));
+  EXPECT_FALSE(rlmachine.opcode_profile());
+  rlmachine.RecordOpcodeTimes();
+
+  std::string repr = CountingCommand(0);
+  std::unique_ptr<CommandElement> f(
+      FunctionFactory::BuildFunctionElement(repr.c_str()));
+  rlmachine.ExecuteCommand(*f);
+  rlmachine.ExecuteCommand(*f);
+  EXPECT_EQ(2, count);
+
+  const OpcodeProfile* profile = rlmachine.opcode_profile();
+  ASSERT_TRUE(profile);
+  ASSERT_EQ(1u, profile->size());
+  const OpcodeProfile::Entry& entry = profile->begin()->second;
+  EXPECT_EQ("Counting", entry.name);
+  EXPECT_EQ(2, entry.calls);
+  EXPECT_EQ(entry.time, profile->TotalTime());
+}
+
 TEST_F(RLMachineTest, ReturnFromFarcallMismatch) {
   EXPECT_THROW({ rlmachine.ReturnFromFarcall(); }, rlvm::Exception);
 }
@@ -276,3 +370,180 @@ TEST_F(RLMachineTest, SerializationOfSavepointValues) {
     verifyStrMemoryCountingFrom(loadMachine, STRS_LOCATION, 0);
   }
 }
+
+// -----------------------------------------------------------------------
+
+namespace {
+
+void AppendMarker(std::string& out, char marker, int value) {
+  out.push_back(marker);
+  out.push_back(value & 0xff);
+  out.push_back((value >> 8) & 0xff);
+}
+
+// |blocks| repetitions of two line markers, a kidoku marker and some text,
+// which is the shape of most of a visual novel's script.
+std::string MarkedTextBytecode(int blocks, std::vector<int>* kidoku_table) {
+  std::string bytecode;
+  for (int i = 0; i < blocks; ++i) {
+    AppendMarker(bytecode, '\n', 10 + i * 2);
+    AppendMarker(bytecode, '\n', 11 + i * 2);
+    AppendMarker(bytecode, '@', i);
+    kidoku_table->push_back(i);
+    bytecode += "Text";
+  }
+  return bytecode;
+}
+
+struct FusionResult {
+  int steps = 0;
+  int line = 0;
+  int lines_seen = 0;
+  std::vector<bool> kidoku_read;
+  std::string text;
+};
+
+FusionResult RunMarkedText(const std::string& seen, int blocks,
+                           bool with_line_actions) {
+  libreallive::Archive arc(seen);
+  TestSystem system(locateTestCase("Gameexe_data/Gameexe.ini"));
+  RLMachine rlmachine(system, arc);
+  system.set_force_fast_forward();
+
+  FusionResult result;
+  if (with_line_actions) {
+    for (int line = 10; line < 10 + blocks * 2; ++line)
+      rlmachine.AddLineAction(1, line, [&]() { result.lines_seen++; });
+  }
+  while (!rlmachine.halted()) {
+    rlmachine.ExecuteNextInstruction();
+    result.steps++;
+  }
+
+  result.line = rlmachine.line_number();
+  result.text = static_cast<TestTextWindow&>(
+                    *system.text().GetCurrentWindow()).current_contents();
+  for (int i = 0; i < blocks; ++i)
+    result.kidoku_read.push_back(rlmachine.memory().HasBeenRead(1, i));
+  return result;
+}
+
+}  // namespace
+
+// Runs of markers and text are fused into superinstructions, which must
+// take fewer steps to get through without changing what the script does.
+// Line actions need every line marker, so they turn fusion off.
+TEST(RLMachineFusionTest, FusedMarkersMatchUnfused) {
+  namespace fs = boost::filesystem;
+  const fs::path dir = fs::temp_directory_path() / fs::unique_path();
+  fs::create_directories(dir);
+  const std::string seen = (dir / "SEEN.TXT").string();
+
+  const int kBlocks = 20;
+  std::vector<int> kidoku_table;
+  writeTestSeen(seen, 1, MarkedTextBytecode(kBlocks, &kidoku_table),
+                kidoku_table);
+
+  FusionResult fused = RunMarkedText(seen, kBlocks, false);
+  FusionResult unfused = RunMarkedText(seen, kBlocks, true);
+
+  EXPECT_EQ(kBlocks * 2, unfused.lines_seen);
+  EXPECT_EQ(kBlocks * 4, unfused.steps);
+  EXPECT_EQ(kBlocks, fused.steps);
+  EXPECT_EQ(9 + kBlocks * 2, fused.line);
+  EXPECT_EQ(unfused.line, fused.line);
+  EXPECT_EQ(std::vector<bool>(kBlocks, true), fused.kidoku_read);
+  EXPECT_EQ(unfused.kidoku_read, fused.kidoku_read);
+  EXPECT_FALSE(fused.text.empty());
+  EXPECT_EQ(unfused.text, fused.text);
+
+  fs::remove_all(dir);
+}
+
+// -----------------------------------------------------------------------
+
+namespace {
+
+struct StepOpcode : public RLOpcode<> {
+  explicit StepOpcode(int* count) : count_(count) {}
+  virtual void operator()(RLMachine& machine) override { ++*count_; }
+  int* count_;
+};
+
+// A LongOperation that finishes the first time it runs.
+struct OneShotLongOperation : public LongOperation {
+  virtual bool operator()(RLMachine& machine) override { return true; }
+};
+
+struct WaitOpcode : public RLOpcode<> {
+  virtual void operator()(RLMachine& machine) override {
+    machine.PushLongOperation(new OneShotLongOperation);
+  }
+};
+
+struct ThrowOpcode : public RLOpcode<> {
+  virtual void operator()(RLMachine& machine) override {
+    throw rlvm::Exception("thrown on purpose");
+  }
+};
+
+class BatchModule : public RLModule {
+ public:
+  explicit BatchModule(int* steps) : RLModule("Batch", 1, 251) {
+    AddOpcode(0, 0, "step", new StepOpcode(steps));
+    AddOpcode(1, 0, "wait", new WaitOpcode);
+    AddOpcode(2, 0, "throw", new ThrowOpcode);
+  }
+};
+
+std::string BatchCommand(int opcode) {
+  std::string repr(8, 0);
+  repr[0] = '#';
+  repr[1] = 1;
+  repr[2] = static_cast<char>(251);
+  repr[3] = opcode;
+  return repr;
+}
+
+}  // namespace
+
+TEST(RLMachineBatchTest, StopsForBudgetsWaitsAndLongOperations) {
+  namespace fs = boost::filesystem;
+  const fs::path dir = fs::temp_directory_path() / fs::unique_path();
+  fs::create_directories(dir);
+  const std::string seen = (dir / "SEEN.TXT").string();
+  writeTestSeen(seen, 1,
+                BatchCommand(0) + BatchCommand(0) + BatchCommand(0) +
+                    BatchCommand(1) + BatchCommand(0) + BatchCommand(2) +
+                    BatchCommand(0),
+                {});
+
+  libreallive::Archive arc(seen);
+  TestSystem system(locateTestCase("Gameexe_data/Gameexe.ini"));
+  RLMachine rlmachine(system, arc);
+  rlmachine.SetHaltOnException(false);
+  int steps = 0;
+  rlmachine.AttachModule(new BatchModule(&steps));
+
+  RLMachine::ExecutionBudget one;
+  one.instructions = 1;
+  EXPECT_EQ(1, rlmachine.ExecuteBatch(one));
+  EXPECT_EQ(1, steps);
+
+  system.set_force_wait(true);
+  EXPECT_EQ(1, rlmachine.ExecuteBatch(RLMachine::ExecutionBudget()));
+  EXPECT_EQ(2, steps);
+  system.set_force_wait(false);
+
+  // Stops as soon as the wait pushes its LongOperation...
+  EXPECT_EQ(2, rlmachine.ExecuteBatch(RLMachine::ExecutionBudget()));
+  EXPECT_EQ(3, steps);
+  EXPECT_TRUE(rlmachine.CurrentLongOperation());
+
+  // ...and then runs it, steps past the throwing opcode and halts.
+  EXPECT_EQ(4, rlmachine.ExecuteBatch(RLMachine::ExecutionBudget()));
+  EXPECT_EQ(5, steps);
+  EXPECT_TRUE(rlmachine.halted());
+
+  fs::remove_all(dir);
+}
@@ -0,0 +1,364 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#include "gtest/gtest.h"
+
+#include <memory>
+#include <ostream>
+#include <vector>
+
+#include "systems/base/graphics_object.h"
+#include "systems/base/graphics_object_data.h"
+#include "systems/base/parent_graphics_object_data.h"
+#include "systems/base/screen_damage.h"
+#include "systems/base/surface.h"
+#include "test_system/test_graphics_system.h"
+#include "test_system/test_system.h"
+
+namespace {
+
+const Rect kScreen = Rect::REC(0, 0, 640, 480);
+
+// Object data that draws a |size| box at the object's position, and counts
+// how often it's drawn.
+class BoxObjectData : public GraphicsObjectData {
+ public:
+  BoxObjectData(GraphicsSystem& graphics, const Size& size, int* renders)
+      : graphics_(graphics), size_(size), renders_(renders) {}
+
+  virtual void Render(const GraphicsObject& go,
+                      const GraphicsObject* parent,
+                      std::ostream* tree) override {
+    ++*renders_;
+    graphics_.RecordScreenDraw(Rect(Point(go.x(), go.y()), size_));
+  }
+
+  virtual int PixelWidth(const GraphicsObject& go) override {
+    return size_.width();
+  }
+  virtual int PixelHeight(const GraphicsObject& go) override {
+    return size_.height();
+  }
+  virtual GraphicsObjectData* Clone() const override {
+    return new BoxObjectData(graphics_, size_, renders_);
+  }
+  virtual void Execute(RLMachine& machine) override {}
+
+ protected:
+  virtual std::shared_ptr<const Surface> CurrentSurface(
+      const GraphicsObject& go) override {
+    return std::shared_ptr<const Surface>();
+  }
+  virtual void ObjectInfo(std::ostream& tree) override {}
+
+ private:
+  GraphicsSystem& graphics_;
+  Size size_;
+  int* renders_;
+};
+
+// Keeps every frame it draws, and logs how Refresh() redraws.
+class DamageGraphicsSystem : public TestGraphicsSystem {
+ public:
+  DamageGraphicsSystem(System& system, Gameexe& gameexe)
+      : TestGraphicsSystem(system, gameexe) {}
+
+  bool keep_frames = true;
+  int restores = 0;
+  std::vector<Rect> clips;
+
+  void ClearLog() {
+    restores = 0;
+    clips.clear();
+  }
+
+ protected:
+  virtual bool CanRedrawDamageOnly() const override { return keep_frames; }
+  virtual void RestoreLastFrame() override {
+    ++restores;
+    clips.clear();
+  }
+  virtual void SetScreenClip(const Rect& area) override {
+    clips.push_back(area);
+  }
+};
+
+class RefreshTest : public ::testing::Test {
+ protected:
+  RefreshTest() : graphics_(system_, system_.gameexe()) {}
+
+  // Puts a visible |size| box at (x, y) in foreground slot |slot|.
+  GraphicsObject& AddBox(int slot, int x, int y, const Size& size) {
+    GraphicsObject& obj = graphics_.GetObject(OBJ_FG, slot);
+    obj.SetObjectData(new BoxObjectData(graphics_, size, &renders_[slot]));
+    obj.SetVisible(1);
+    obj.SetX(x);
+    obj.SetY(y);
+    return obj;
+  }
+
+  void Refresh() {
+    graphics_.ClearLog();
+    renders_[0] = renders_[1] = 0;
+    graphics_.Refresh(NULL);
+  }
+
+  TestSystem system_;
+  DamageGraphicsSystem graphics_;
+  int renders_[2] = {0, 0};
+};
+
+}  // namespace
+
+// -----------------------------------------------------------------------
+// ScreenDamage
+// -----------------------------------------------------------------------
+
+TEST(ScreenDamageTest, StartsFull) {
+  ScreenDamage damage;
+  damage.SetScreen(kScreen);
+  EXPECT_TRUE(damage.is_full());
+  EXPECT_EQ(std::vector<Rect>(1, kScreen), damage.rects());
+
+  damage.Clear();
+  EXPECT_TRUE(damage.empty());
+  EXPECT_TRUE(damage.rects().empty());
+}
+
+TEST(ScreenDamageTest, KeepsSeparateAreasApart) {
+  ScreenDamage damage;
+  damage.SetScreen(kScreen);
+  damage.Clear();
+
+  damage.Add(Rect::REC(10, 10, 20, 20));
+  damage.Add(Rect::REC(300, 300, 20, 20));
+  ASSERT_EQ(2u, damage.rects().size());
+  EXPECT_EQ(Rect::REC(10, 10, 20, 20), damage.rects()[0]);
+  EXPECT_EQ(Rect::REC(300, 300, 20, 20), damage.rects()[1]);
+}
+
+TEST(ScreenDamageTest, MergesTouchingAreas) {
+  ScreenDamage damage;
+  damage.SetScreen(kScreen);
+  damage.Clear();
+
+  damage.Add(Rect::REC(10, 10, 20, 20));
+  damage.Add(Rect::REC(100, 10, 20, 20));
+  // Bridges the two above.
+  damage.Add(Rect::REC(30, 10, 70, 5));
+  EXPECT_EQ(std::vector<Rect>(1, Rect::GRP(10, 10, 120, 30)), damage.rects());
+}
+
+TEST(ScreenDamageTest, ClipsToScreen) {
+  ScreenDamage damage;
+  damage.SetScreen(kScreen);
+  damage.Clear();
+
+  damage.Add(Rect::REC(-10, -10, 30, 30));
+  damage.Add(Rect::REC(1000, 1000, 30, 30));
+  damage.Add(Rect());
+  EXPECT_EQ(std::vector<Rect>(1, Rect::REC(0, 0, 20, 20)), damage.rects());
+}
+
+TEST(ScreenDamageTest, CollapsesManyAreasIntoTheirBounds) {
+  ScreenDamage damage;
+  damage.SetScreen(kScreen);
+  damage.Clear();
+
+  for (int i = 0; i <= ScreenDamage::kMaxRects; ++i)
+    damage.Add(Rect::REC(i * 20, i * 10, 5, 5));
+  int last = ScreenDamage::kMaxRects;
+  EXPECT_EQ(std::vector<Rect>(1, Rect::GRP(0, 0, last * 20 + 5, last * 10 + 5)),
+            damage.rects());
+  EXPECT_FALSE(damage.is_full());
+}
+
+TEST(ScreenDamageTest, HalfTheScreenIsFull) {
+  ScreenDamage damage;
+  damage.SetScreen(kScreen);
+  damage.Clear();
+
+  damage.Add(Rect::REC(0, 0, 640, 239));
+  EXPECT_FALSE(damage.is_full());
+  damage.Add(Rect::REC(0, 400, 640, 1));
+  EXPECT_TRUE(damage.is_full());
+}
+
+TEST(ScreenDamageTest, Covers) {
+  ScreenDamage damage;
+  damage.SetScreen(kScreen);
+  damage.Clear();
+
+  damage.Add(Rect::REC(10, 10, 100, 100));
+  damage.Add(Rect::REC(200, 10, 100, 100));
+  EXPECT_TRUE(damage.Covers(Rect::REC(20, 20, 50, 50)));
+  EXPECT_FALSE(damage.Covers(Rect::REC(100, 20, 50, 50)));
+  EXPECT_TRUE(damage.Covers(Rect()));
+  // Only what's on screen counts.
+  damage.Add(Rect::REC(600, 400, 40, 80));
+  EXPECT_TRUE(damage.Covers(Rect::REC(600, 400, 100, 100)));
+
+  damage.AddAll();
+  EXPECT_TRUE(damage.Covers(Rect::REC(100, 20, 50, 50)));
+}
+
+// -----------------------------------------------------------------------
+// GraphicsObject::render_version()
+// -----------------------------------------------------------------------
+
+TEST(RenderVersionTest, ChangesWithParameters) {
+  GraphicsObject obj;
+  uint64_t version = obj.render_version();
+  EXPECT_EQ(version, obj.render_version());
+
+  obj.SetX(10);
+  EXPECT_NE(version, obj.render_version());
+
+  version = obj.render_version();
+  GraphicsObject copy(obj);
+  EXPECT_NE(version, copy.render_version());
+}
+
+TEST(RenderVersionTest, ParentLayersFollowTheirChildren) {
+  GraphicsObject parent;
+  parent.SetObjectData(new ParentGraphicsObjectData(8));
+  ParentGraphicsObjectData& data =
+      static_cast<ParentGraphicsObjectData&>(parent.GetObjectData());
+  uint64_t version = parent.render_version();
+  data.GetObject(3).SetAlpha(128);
+  EXPECT_NE(version, parent.render_version());
+}
+
+// Polling an object's data, as animation waits do every frame, must not make
+// it look changed; changing the data must.
+TEST(RenderVersionTest, ReadingObjectDataIsNotAChange) {
+  GraphicsObject obj;
+  obj.SetObjectData(new ParentGraphicsObjectData(8));
+  uint64_t version = obj.render_version();
+  GraphicsObjectData& data = obj.GetObjectData();
+  data.is_currently_playing();
+  EXPECT_EQ(version, obj.render_version());
+
+  data.set_is_currently_playing(!data.is_currently_playing());
+  EXPECT_NE(version, obj.render_version());
+}
+
+// -----------------------------------------------------------------------
+// GraphicsSystem::Refresh()
+// -----------------------------------------------------------------------
+
+TEST_F(RefreshTest, FirstFrameDrawsEverything) {
+  AddBox(0, 10, 10, Size(50, 50));
+  Refresh();
+  EXPECT_EQ(0, graphics_.restores);
+  EXPECT_EQ(1, renders_[0]);
+}
+
+TEST_F(RefreshTest, UnchangedFrameDrawsNothing) {
+  AddBox(0, 10, 10, Size(50, 50));
+  Refresh();
+
+  Refresh();
+  EXPECT_EQ(1, graphics_.restores);
+  EXPECT_EQ(std::vector<Rect>(1, Rect()), graphics_.clips);
+  EXPECT_EQ(0, renders_[0]);
+}
+
+TEST_F(RefreshTest, ChangedObjectRedrawsOnlyItsArea) {
+  GraphicsObject& changed = AddBox(0, 10, 10, Size(50, 50));
+  AddBox(1, 300, 300, Size(50, 50));
+  Refresh();
+
+  changed.SetAlpha(128);
+  Refresh();
+  EXPECT_EQ(1, graphics_.restores);
+  EXPECT_EQ(std::vector<Rect>(1, Rect::REC(10, 10, 50, 50)), graphics_.clips);
+  EXPECT_EQ(1, renders_[0]);
+  EXPECT_EQ(0, renders_[1]);
+}
+
+TEST_F(RefreshTest, MovedObjectRedrawsWhereItWasAndIs) {
+  GraphicsObject& moved = AddBox(0, 10, 10, Size(50, 50));
+  Refresh();
+
+  moved.SetX(300);
+  Refresh();
+  // The first pass only knew about where it was.
+  EXPECT_EQ(2, graphics_.restores);
+  ASSERT_EQ(2u, graphics_.clips.size());
+  EXPECT_EQ(Rect::REC(10, 10, 50, 50), graphics_.clips[0]);
+  EXPECT_EQ(Rect::REC(300, 10, 50, 50), graphics_.clips[1]);
+}
+
+TEST_F(RefreshTest, OverlappedObjectsAreRedrawn) {
+  GraphicsObject& changed = AddBox(0, 10, 10, Size(50, 50));
+  AddBox(1, 40, 40, Size(50, 50));
+  Refresh();
+
+  changed.SetAlpha(128);
+  Refresh();
+  EXPECT_EQ(1, renders_[0]);
+  EXPECT_EQ(1, renders_[1]);
+}
+
+TEST_F(RefreshTest, FreedObjectRedrawsWhereItWas) {
+  GraphicsObject& freed = AddBox(0, 10, 10, Size(50, 50));
+  Refresh();
+
+  freed.FreeObjectData();
+  Refresh();
+  EXPECT_EQ(std::vector<Rect>(1, Rect::REC(10, 10, 50, 50)), graphics_.clips);
+}
+
+TEST_F(RefreshTest, DC0WritesRedrawTheWrittenArea) {
+  AddBox(0, 300, 300, Size(50, 50));
+  Refresh();
+
+  graphics_.MarkScreenAreaAsDirty(Rect::REC(0, 0, 100, 20));
+  Refresh();
+  EXPECT_EQ(std::vector<Rect>(1, Rect::REC(0, 0, 100, 20)), graphics_.clips);
+  EXPECT_EQ(0, renders_[0]);
+}
+
+TEST_F(RefreshTest, FullDamageDrawsEverything) {
+  AddBox(0, 300, 300, Size(50, 50));
+  Refresh();
+
+  graphics_.MarkScreenAsDirty(GUT_DISPLAY_OBJ);
+  Refresh();
+  EXPECT_EQ(0, graphics_.restores);
+  EXPECT_EQ(1, renders_[0]);
+}
+
+TEST_F(RefreshTest, NeedsTheLastFrame) {
+  AddBox(0, 300, 300, Size(50, 50));
+  Refresh();
+
+  graphics_.keep_frames = false;
+  Refresh();
+  EXPECT_EQ(0, graphics_.restores);
+  EXPECT_EQ(1, renders_[0]);
+}
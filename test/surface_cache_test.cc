@@ -0,0 +1,189 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+
+#include "gtest/gtest.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+
+#include <memory>
+#include <string>
+
+#include "systems/base/graphics_system.h"
+#include "systems/base/surface_cache.h"
+#include "test_system/mock_surface.h"
+#include "test_system/test_graphics_system.h"
+#include "test_system/test_system.h"
+#include "test_utils.h"
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+// A 50x50 surface takes 10000 bytes at 32 bits per pixel.
+const size_t kSurfaceBytes = 50 * 50 * 4;
+
+std::shared_ptr<const Surface> MakeSurface(const std::string& name) {
+  return std::shared_ptr<const Surface>(MockSurface::Create(name, Size(50, 50)));
+}
+
+// A surface that pretends to have uploaded a texture the size of its pixels.
+class TexturedSurface : public MockSurface {
+ public:
+  explicit TexturedSurface(const std::string& name)
+      : MockSurface(name, Size(50, 50)) {}
+
+  virtual size_t GetTextureMemoryUsage() const override {
+    return uploaded_ ? kSurfaceBytes : 0;
+  }
+  virtual void UnloadTextures() const override { uploaded_ = false; }
+
+  bool uploaded() const { return uploaded_; }
+
+ private:
+  mutable bool uploaded_ = true;
+};
+
+TEST(SurfaceCacheTest, EvictsLeastRecentlyUsedByBytes) {
+  SurfaceCache cache(kSurfaceBytes * 5 / 2, kSurfaceBytes);
+  cache.Insert("a", MakeSurface("a"));
+  cache.Insert("b", MakeSurface("b"));
+  EXPECT_EQ(2 * kSurfaceBytes, cache.memory_usage());
+
+  // Touching "a" makes "b" the oldest entry.
+  EXPECT_TRUE(cache.Fetch("a"));
+  cache.Insert("c", MakeSurface("c"));
+
+  EXPECT_TRUE(cache.Contains("a"));
+  EXPECT_FALSE(cache.Contains("b"));
+  EXPECT_TRUE(cache.Contains("c"));
+  EXPECT_EQ(2 * kSurfaceBytes, cache.memory_usage());
+
+  EXPECT_FALSE(cache.Fetch("b"));
+  EXPECT_EQ(1, cache.stats().hits);
+  EXPECT_EQ(1, cache.stats().misses);
+  EXPECT_EQ(1, cache.stats().evictions);
+}
+
+TEST(SurfaceCacheTest, KeepsSurfacesInUseElsewhere) {
+  SurfaceCache cache(kSurfaceBytes, kSurfaceBytes);
+  std::shared_ptr<const Surface> on_screen = MakeSurface("a");
+  cache.Insert("a", on_screen);
+  cache.Insert("b", MakeSurface("b"));
+  cache.Trim();
+
+  // Dropping "a" wouldn't free its pixels, so the unused "b" goes instead.
+  EXPECT_TRUE(cache.Contains("a"));
+  EXPECT_FALSE(cache.Contains("b"));
+
+  on_screen.reset();
+  cache.Insert("c", MakeSurface("c"));
+  EXPECT_FALSE(cache.Contains("a"));
+  EXPECT_TRUE(cache.Contains("c"));
+}
+
+TEST(SurfaceCacheTest, PinnedSurfacesStayUntilUnpinned) {
+  SurfaceCache cache(0, 0);
+  std::shared_ptr<const Surface> surface = MakeSurface("a");
+  cache.Insert("a", surface);
+  cache.Pin("a");
+  cache.Pin("a");
+  surface.reset();
+
+  cache.Trim();
+  EXPECT_TRUE(cache.Contains("a"));
+  EXPECT_EQ(kSurfaceBytes, cache.memory_usage());
+
+  cache.Unpin("a");
+  cache.Trim();
+  EXPECT_TRUE(cache.Contains("a"));
+
+  cache.Unpin("a");
+  cache.Trim();
+  EXPECT_FALSE(cache.Contains("a"));
+  EXPECT_EQ(0u, cache.memory_usage());
+}
+
+TEST(SurfaceCacheTest, UnloadsTexturesBeforeDroppingPixels) {
+  SurfaceCache cache(kSurfaceBytes * 10, kSurfaceBytes * 3 / 2);
+  std::shared_ptr<TexturedSurface> old_surface(new TexturedSurface("old"));
+  std::shared_ptr<TexturedSurface> new_surface(new TexturedSurface("new"));
+  cache.Insert("old", old_surface);
+  cache.Insert("new", new_surface);
+
+  // Both are still referenced here, so neither can be touched yet.
+  EXPECT_EQ(2 * kSurfaceBytes, cache.texture_usage());
+  EXPECT_EQ(0, cache.stats().texture_evictions);
+
+  std::weak_ptr<TexturedSurface> old_weak = old_surface;
+  old_surface.reset();
+  new_surface.reset();
+  cache.Trim();
+
+  EXPECT_TRUE(cache.Contains("old"));
+  EXPECT_TRUE(cache.Contains("new"));
+  EXPECT_FALSE(old_weak.lock()->uploaded());
+  EXPECT_EQ(kSurfaceBytes, cache.texture_usage());
+  EXPECT_EQ(1, cache.stats().texture_evictions);
+  EXPECT_EQ(0, cache.stats().evictions);
+}
+
+TEST(SurfaceCacheTest, GraphicsSystemPinsPreloadedG00s) {
+  fs::path dir = fs::temp_directory_path() / fs::unique_path();
+  fs::create_directories(dir);
+  fs::path gameexe_path = dir / "Gameexe.ini";
+  fs::copy_file(locateTestCase("Gameexe_data/Gameexe.ini"), gameexe_path);
+  {
+    fs::ofstream out(gameexe_path, std::ios::app);
+    out << "#IMAGE_CACHE_MB=0" << std::endl
+        << "#TEXTURE_CACHE_MB=0" << std::endl;
+  }
+
+  {
+    TestSystem system(gameexe_path.string());
+    GraphicsSystem& graphics = system.graphics();
+    EXPECT_EQ(0u, graphics.image_cache().memory_budget());
+
+    graphics.PreloadG00(3, "preloaded");
+    graphics.GetSurfaceNamed("other");
+    graphics.GetSurfaceNamed("another");
+
+    // Nothing fits in a zero byte budget except what a script asked to keep,
+    // and the surface that was just handed out, which is trimmed next frame.
+    EXPECT_TRUE(graphics.image_cache().Contains("preloaded"));
+    EXPECT_FALSE(graphics.image_cache().Contains("other"));
+    EXPECT_TRUE(graphics.image_cache().Contains("another"));
+
+    graphics.ClearPreloadedG00(3);
+    graphics.GetSurfaceNamed("other");
+    EXPECT_FALSE(graphics.image_cache().Contains("preloaded"));
+    EXPECT_FALSE(graphics.image_cache().Contains("another"));
+    EXPECT_EQ(kSurfaceBytes, graphics.image_cache().memory_usage());
+  }
+
+  fs::remove_all(dir);
+}
+
+}  // namespace
@@ -28,9 +28,21 @@
 #include "test_utils.h"
 #include <vector>
 #include <boost/filesystem/operations.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <random>
 #include <stdexcept>
 #include <sstream>
 #include <string>
+#include <utility>
+
+#include "libreallive/alldefs.h"
+#include "libreallive/compression.h"
+#include "systems/base/pixel_blitter.h"
+#include "utilities/cpu_dispatch.h"
 
 using std::string;
 using std::vector;
@@ -56,6 +68,671 @@ string locateTestCase(const string& baseName) {
   throw std::runtime_error(oss.str());
 }
 
+std::vector<CompressedScenario> loadAllTestScenarios() {
+  const fs::path root =
+      fs::path(locateTestCase("Module_Jmp_SEEN/fibonacci.TXT"))
+          .parent_path()
+          .parent_path();
+
+  vector<fs::path> seens;
+  for (fs::directory_iterator dir(root), end; dir != end; ++dir) {
+    const string dirname = dir->path().filename().string();
+    if (!fs::is_directory(dir->path()) || dirname.size() < 5 ||
+        dirname.compare(dirname.size() - 5, 5, "_SEEN") != 0)
+      continue;
+    for (fs::directory_iterator it(dir->path()); it != end; ++it) {
+      if (it->path().extension() == ".TXT")
+        seens.push_back(it->path());
+    }
+  }
+  std::sort(seens.begin(), seens.end());
+
+  vector<CompressedScenario> scenarios;
+  for (const fs::path& seen : seens) {
+    std::ifstream file(seen.string(), std::ios::binary);
+    const string contents((std::istreambuf_iterator<char>(file)),
+                          std::istreambuf_iterator<char>());
+    for (size_t i = 0; i < 10000 && (i + 1) * 8 <= contents.size(); ++i) {
+      const size_t offset = libreallive::read_i32(contents, i * 8);
+      const size_t length = libreallive::read_i32(contents, i * 8 + 4);
+      if (!offset || offset + length > contents.size() || length < 0x30)
+        continue;
+
+      CompressedScenario scenario;
+      scenario.name = seen.parent_path().filename().string() + "/" +
+                      seen.filename().string() + ":" + std::to_string(i);
+      scenario.data = contents.substr(offset, length);
+      scenario.compressed_offset = libreallive::read_i32(scenario.data, 0x20);
+      scenario.compressed_length = libreallive::read_i32(scenario.data, 0x28);
+      scenario.decompressed_length =
+          libreallive::read_i32(scenario.data, 0x24);
+      if (scenario.compressed_offset + scenario.compressed_length > length)
+        continue;
+      scenarios.push_back(std::move(scenario));
+    }
+  }
+  return scenarios;
+}
+
+namespace {
+
+void putInt16(string& out, size_t pos, uint32_t value) {
+  out[pos] = static_cast<char>(value);
+  out[pos + 1] = static_cast<char>(value >> 8);
+}
+
+void putInt32(string& out, size_t pos, uint32_t value) {
+  for (int i = 0; i < 4; ++i)
+    out[pos + i] = static_cast<char>(value >> (i * 8));
+}
+
+}  // namespace
+
+void writeTestSeen(const string& path,
+                   int scenario,
+                   const string& bytecode,
+                   const vector<int>& kidoku_table) {
+  // Store everything as literals: groups of a 0xff flag byte and up to eight
+  // bytes, after the eight byte prefix Decompress() skips.
+  string compressed(8, '\0');
+  for (size_t i = 0; i < bytecode.size(); i += 8) {
+    compressed.push_back('\xff');
+    compressed.append(bytecode, i, 8);
+  }
+  for (size_t i = 8; i < compressed.size(); ++i)
+    compressed[i] ^= libreallive::compression::xor_mask[i % 256];
+
+  const size_t kHeaderSize = 0x1d0;
+  const size_t kidoku_offset = kHeaderSize;
+  const size_t data_offset = kidoku_offset + kidoku_table.size() * 4;
+  string data(data_offset, '\0');
+  putInt32(data, 0x00, kHeaderSize);
+  putInt32(data, 0x04, 10002);
+  putInt32(data, 0x08, kidoku_offset);
+  putInt32(data, 0x0c, kidoku_table.size());
+  // No dramatis personae and no RLdev metadata.
+  putInt32(data, 0x14, data_offset);
+  putInt32(data, 0x20, data_offset);
+  putInt32(data, 0x24, bytecode.size());
+  putInt32(data, 0x28, compressed.size());
+  for (size_t i = 0; i < kidoku_table.size(); ++i)
+    putInt32(data, kidoku_offset + i * 4, kidoku_table[i]);
+  data += compressed;
+
+  const size_t kTocSize = 10000 * 8;
+  string seen(kTocSize, '\0');
+  putInt32(seen, scenario * 8, kTocSize);
+  putInt32(seen, scenario * 8 + 4, data.size());
+  seen += data;
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(seen.data(), seen.size());
+}
+
+uint32_t testG00Pixel(int x, int y) {
+  return ((x * 37) & 0xff) << 16 | ((y * 59) & 0xff) << 8 | ((x ^ y) & 0xff);
+}
+
+void writeTestG00(const string& path, int width, int height) {
+  // Type 0 G00s are an LZ stream of 3-byte BGR pixels, eight to a flag byte.
+  string stream;
+  const int pixels = width * height;
+  for (int i = 0; i < pixels; ++i) {
+    if (i % 8 == 0)
+      stream.push_back('\xff');
+    const uint32_t colour = testG00Pixel(i % width, i / width);
+    stream.push_back(static_cast<char>(colour));
+    stream.push_back(static_cast<char>(colour >> 8));
+    stream.push_back(static_cast<char>(colour >> 16));
+  }
+
+  string g00(13, '\0');
+  g00[1] = static_cast<char>(width);
+  g00[2] = static_cast<char>(width >> 8);
+  g00[3] = static_cast<char>(height);
+  g00[4] = static_cast<char>(height >> 8);
+  g00 += stream;
+  putInt32(g00, 5, g00.size() - 5);
+  putInt32(g00, 9, pixels * 3);
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(g00.data(), g00.size());
+}
+
+// -----------------------------------------------------------------------
+
+int16_t testVoiceSample(int koe_num, int i) {
+  return static_cast<int16_t>((koe_num * 131 + i * 7) & 0xffff);
+}
+
+void writeTestVoiceArchive(const string& path,
+                           int entry_length,
+                           const vector<std::pair<int, string>>& files) {
+  string archive(4 + files.size() * entry_length, '\0');
+  putInt32(archive, 0, files.size());
+  for (size_t i = 0; i < files.size(); ++i) {
+    const size_t entry = 4 + i * entry_length;
+    putInt32(archive, entry, files[i].second.size());
+    putInt32(archive, entry + 4, archive.size());
+    putInt32(archive, entry + 8, files[i].first);
+    archive += files[i].second;
+  }
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(archive.data(), archive.size());
+}
+
+void writeTestNWK(const string& path,
+                  const std::vector<int>& koe_nums,
+                  int frames,
+                  int rate) {
+  const size_t kNwaHeaderSize = 0x2c;
+
+  vector<std::pair<int, string>> files;
+  for (int koe_num : koe_nums) {
+    // An NWA header with a compression level of -1 is followed by raw PCM.
+    string nwa(kNwaHeaderSize, '\0');
+    nwa[0x00] = 1;   // channels
+    nwa[0x02] = 16;  // bits per sample
+    putInt32(nwa, 0x04, rate);
+    putInt32(nwa, 0x08, 0xffffffff);
+    putInt32(nwa, 0x14, frames * 2);
+    putInt32(nwa, 0x18, kNwaHeaderSize + frames * 2);
+    putInt32(nwa, 0x1c, frames);
+    for (int j = 0; j < frames; ++j) {
+      const uint16_t sample = testVoiceSample(koe_num, j);
+      nwa.push_back(static_cast<char>(sample));
+      nwa.push_back(static_cast<char>(sample >> 8));
+    }
+    files.emplace_back(koe_num, nwa);
+  }
+
+  writeTestVoiceArchive(path, 12, files);
+}
+
+namespace {
+
+// Packs values least significant bit first, the order NWADecode() reads
+// them in.
+class BitWriter {
+ public:
+  void Put(int value, int bits) {
+    for (int i = 0; i < bits; ++i, ++count_) {
+      if (count_ % 8 == 0)
+        out_.push_back('\0');
+      if ((value >> i) & 1)
+        out_.back() |= static_cast<char>(1 << (count_ % 8));
+    }
+  }
+
+  const string& out() const { return out_; }
+
+ private:
+  string out_;
+  size_t count_ = 0;
+};
+
+// A code that moves one channel by |delta|: a 3 bit |type|, then for types 1
+// to 7 a |bits| wide |mantissa| whose top bit is the sign. Type 7 has a
+// flag bit before the mantissa, which is 0 here.
+struct NwaCode {
+  int type;
+  int bits;
+  int mantissa;
+  int delta;
+};
+
+// The code that takes |current| closest to |target| at compression |level|,
+// without leaving the 16-bit range. Ties go to the lower type.
+NwaCode nearestNwaCode(int level, int current, int target) {
+  NwaCode best = {0, 0, 0, 0};
+  for (int type = 1; type <= 7; ++type) {
+    int bits, shift;
+    if (type == 7) {
+      bits = level >= 3 ? 8 : 8 - level;
+      shift = level >= 3 ? 9 : 9 + level;
+    } else {
+      bits = level >= 3 ? level + 3 : 5 - level;
+      shift = level >= 3 ? 1 + type : 2 + type + level;
+    }
+    const int sign = 1 << (bits - 1);
+    for (int magnitude = 1; magnitude < sign; ++magnitude) {
+      for (int negative = 0; negative < 2; ++negative) {
+        const int delta = negative ? -(magnitude << shift) : magnitude << shift;
+        if (current + delta < -32768 || current + delta > 32767)
+          continue;
+        if (std::abs(target - current - delta) <
+            std::abs(target - current - best.delta)) {
+          best = {type, bits, magnitude | (negative ? sign : 0), delta};
+        }
+      }
+    }
+  }
+  return best;
+}
+
+}  // namespace
+
+string makeTestNWA(const vector<int16_t>& samples,
+                   int channels,
+                   int rate,
+                   int level,
+                   bool run_length,
+                   int block_size,
+                   vector<int16_t>* decoded) {
+  const size_t kNwaHeaderSize = 0x2c;
+  const int blocks = (samples.size() + block_size - 1) / block_size;
+
+  string nwa(kNwaHeaderSize + blocks * 4, '\0');
+  putInt16(nwa, 0x00, channels);
+  putInt16(nwa, 0x02, 16);
+  putInt32(nwa, 0x04, rate);
+  putInt32(nwa, 0x08, level);
+  putInt32(nwa, 0x0c, run_length);
+  putInt32(nwa, 0x10, blocks);
+  putInt32(nwa, 0x14, samples.size() * 2);
+  putInt32(nwa, 0x1c, samples.size());
+  putInt32(nwa, 0x20, block_size);
+  putInt32(nwa, 0x24, samples.size() - (blocks - 1) * block_size);
+
+  decoded->clear();
+  for (int block = 0; block < blocks; ++block) {
+    const size_t begin = block * block_size;
+    const size_t end = std::min(samples.size(), begin + block_size);
+    putInt32(nwa, kNwaHeaderSize + block * 4, nwa.size());
+
+    // Each block starts from its first frame, stored raw.
+    int current[2];
+    for (int channel = 0; channel < channels; ++channel) {
+      current[channel] = samples[begin + channel];
+      nwa.resize(nwa.size() + 2);
+      putInt16(nwa, nwa.size() - 2, current[channel]);
+    }
+
+    BitWriter stream;
+    for (size_t i = begin; i < end;) {
+      NwaCode code =
+          nearestNwaCode(level, current[(i - begin) % channels], samples[i]);
+      stream.Put(code.type, 3);
+      if (code.type == 0 && run_length) {
+        // Samples after this one that would be left alone anyway join it.
+        int run = 0;
+        for (size_t j = i + 1; run < 255 && j < end; ++j, ++run) {
+          const int channel = (j - begin) % channels;
+          if (nearestNwaCode(level, current[channel], samples[j]).type != 0)
+            break;
+        }
+        if (run == 0) {
+          stream.Put(0, 1);
+        } else {
+          stream.Put(1, 1);
+          stream.Put(std::min(run, 3), 2);
+          if (run >= 3)
+            stream.Put(run, 8);
+        }
+        for (int j = 0; j <= run; ++j, ++i)
+          decoded->push_back(current[(i - begin) % channels]);
+        continue;
+      }
+
+      if (code.type == 7)
+        stream.Put(0, 1);
+      stream.Put(code.mantissa, code.bits);
+      current[(i - begin) % channels] += code.delta;
+      decoded->push_back(current[(i - begin) % channels]);
+      ++i;
+    }
+    nwa += stream.out();
+  }
+
+  putInt32(nwa, 0x18, nwa.size());
+  return nwa;
+}
+
+// -----------------------------------------------------------------------
+
+namespace {
+
+// How one of the xclannad LZ77 variants packs its tokens. Counts and
+// distances are in units of |unit| input bytes.
+struct LzScheme {
+  bool lsb_first;
+  size_t unit;
+  int min_count, max_count;
+  int max_distance;
+
+  // If not empty, the only distances a reference can use (PDT11).
+  vector<int> distance_table;
+
+  // Appends a reference token.
+  std::function<void(string&, int distance, int count)> put_reference;
+};
+
+// Greedy LZ77 encoder. Tries every short distance plus one and two rows up,
+// which is where the repetition in makeTestImage()'s pictures is.
+string lzEncode(const string& input, const LzScheme& scheme, int row_units) {
+  vector<int> candidates = scheme.distance_table;
+  if (candidates.empty()) {
+    for (int d = 1; d <= std::min(48, scheme.max_distance); ++d)
+      candidates.push_back(d);
+    for (int d : {row_units, row_units * 2}) {
+      if (d > 48 && d <= scheme.max_distance)
+        candidates.push_back(d);
+    }
+  }
+
+  const size_t unit = scheme.unit;
+  const int units = input.size() / unit;
+  auto same = [&](int a, int b) {
+    return input.compare(a * unit, unit, input, b * unit, unit) == 0;
+  };
+
+  string out;
+  size_t flag_pos = 0;
+  int token = 0;
+  for (int i = 0; i < units;) {
+    if (token % 8 == 0) {
+      flag_pos = out.size();
+      out.push_back('\0');
+    }
+
+    int best_count = 0, best_distance = 0;
+    for (int d : candidates) {
+      if (d <= 0 || d > i)
+        continue;
+      int count = 0;
+      while (count < scheme.max_count && i + count < units &&
+             same(i + count, i + count - d))
+        ++count;
+      if (count > best_count) {
+        best_count = count;
+        best_distance = d;
+      }
+    }
+
+    if (best_count >= scheme.min_count) {
+      scheme.put_reference(out, best_distance, best_count);
+      i += best_count;
+    } else {
+      int bit = scheme.lsb_first ? token % 8 : 7 - token % 8;
+      out[flag_pos] |= static_cast<char>(1 << bit);
+      out.append(input, i * unit, unit);
+      ++i;
+    }
+    ++token;
+  }
+  return out;
+}
+
+LzScheme g00Type0Scheme() {
+  return {true, 3, 1, 16, 4095, {}, [](string& out, int d, int c) {
+            out.push_back(static_cast<char>((d << 4) | (c - 1)));
+            out.push_back(static_cast<char>(d >> 4));
+          }};
+}
+
+LzScheme pdt10Scheme() {
+  return {false, 3, 1, 16, 4096, {}, [](string& out, int d, int c) {
+            int v = ((d - 1) << 4) | (c - 1);
+            out.push_back(static_cast<char>(v));
+            out.push_back(static_cast<char>(v >> 8));
+          }};
+}
+
+LzScheme scn2kScheme() {
+  return {true, 1, 2, 17, 4095, {}, [](string& out, int d, int c) {
+            int v = (d << 4) | (c - 2);
+            out.push_back(static_cast<char>(v));
+            out.push_back(static_cast<char>(v >> 8));
+          }};
+}
+
+LzScheme maskScheme() {
+  return {false, 1, 2, 257, 256, {}, [](string& out, int d, int c) {
+            out.push_back(static_cast<char>(c - 2));
+            out.push_back(static_cast<char>(d - 1));
+          }};
+}
+
+LzScheme pdt11Scheme(const vector<int>& distances) {
+  return {false, 1, 2, 17, 0, distances, [distances](string& out, int d, int c) {
+            int index = std::find(distances.begin(), distances.end(), d) -
+                        distances.begin();
+            out.push_back(static_cast<char>(((c - 2) << 4) | index));
+          }};
+}
+
+// A |width| x |height| picture of values below |limit|: runs of one value,
+// runs copied from the row above, and noise.
+vector<uint32_t> testPicture(int width, int height, uint32_t limit,
+                             std::mt19937& rng) {
+  vector<uint32_t> picture(width * height);
+  for (int i = 0; i < width * height;) {
+    int run = std::min<int>(1 + rng() % 40, width * height - i);
+    int kind = rng() % 3;
+    uint32_t value = rng() % limit;
+    for (int j = 0; j < run; ++j, ++i) {
+      if (kind == 0)
+        picture[i] = value;
+      else if (kind == 1 && i >= width)
+        picture[i] = picture[i - width];
+      else
+        picture[i] = rng() % limit;
+    }
+  }
+  return picture;
+}
+
+string packedBGR(const vector<uint32_t>& picture) {
+  string out;
+  for (uint32_t colour : picture) {
+    out.push_back(static_cast<char>(colour));
+    out.push_back(static_cast<char>(colour >> 8));
+    out.push_back(static_cast<char>(colour >> 16));
+  }
+  return out;
+}
+
+string g00Header(int type, int width, int height) {
+  string g00(type == 2 ? 9 : 13, '\0');
+  g00[0] = static_cast<char>(type);
+  putInt16(g00, 1, width);
+  putInt16(g00, 3, height);
+  return g00;
+}
+
+string makeG00Type2(int width, int height, std::mt19937& rng, bool with_alpha) {
+  vector<uint32_t> picture = testPicture(width, height, 0x1000000, rng);
+  for (uint32_t& pixel : picture) {
+    uint32_t alpha = 0xff;
+    if (with_alpha && rng() % 4 == 0)
+      alpha = rng() % 0x100;
+    pixel |= alpha << 24;
+  }
+
+  // Two regions side by side, each cut into blocks of up to 16 rows.
+  struct Region {
+    int x1, x2;
+  };
+  const int split = std::max(1, width / 2);
+  vector<Region> regions = {{0, split - 1}};
+  if (split < width)
+    regions.push_back({split, width - 1});
+
+  const size_t table_size = 4 + regions.size() * 8;
+  string raw(table_size, '\0');
+  putInt32(raw, 0, regions.size());
+  for (size_t r = 0; r < regions.size(); ++r) {
+    const size_t offset = raw.size();
+    raw.append(0x74, '\0');
+    const int w = regions[r].x2 - regions[r].x1 + 1;
+    for (int y = 0, strip = 0; y < height; y += 16, ++strip) {
+      const int h = std::min(16, height - y);
+      if (with_alpha && r == 1 && strip == 1)
+        continue;
+      string block(0x5c, '\0');
+      putInt16(block, 0, 0);
+      putInt16(block, 2, y);
+      putInt16(block, 6, w);
+      putInt16(block, 8, h);
+      for (int row = y; row < y + h; ++row) {
+        for (int x = regions[r].x1; x <= regions[r].x2; ++x) {
+          string pixel(4, '\0');
+          putInt32(pixel, 0, picture[row * width + x]);
+          block += pixel;
+        }
+      }
+      raw += block;
+    }
+    putInt32(raw, 4 + r * 8, offset);
+    putInt32(raw, 8 + r * 8, raw.size() - offset);
+  }
+
+  string g00 = g00Header(2, width, height);
+  putInt32(g00, 5, regions.size());
+  for (const Region& region : regions) {
+    string entry(24, '\0');
+    putInt32(entry, 0, region.x1);
+    putInt32(entry, 4, 0);
+    putInt32(entry, 8, region.x2);
+    putInt32(entry, 12, height - 1);
+    g00 += entry;
+  }
+  const string stream = lzEncode(raw, scn2kScheme(), width * 4);
+  string data_head(8, '\0');
+  putInt32(data_head, 0, 8 + stream.size());
+  putInt32(data_head, 4, raw.size());
+  return g00 + data_head + stream;
+}
+
+string makePDT(bool pdt11, int width, int height, std::mt19937& rng,
+               bool with_alpha) {
+  const size_t header_size = pdt11 ? 0x460 : 0x20;
+  string pdt(header_size, '\0');
+  pdt.replace(0, 5, pdt11 ? "PDT11" : "PDT10");
+  putInt32(pdt, 0x0c, width);
+  putInt32(pdt, 0x10, height);
+
+  if (pdt11) {
+    for (int i = 0; i < 256; ++i)
+      putInt32(pdt, 0x20 + i * 4, rng() % 0x1000000);
+    const vector<int> distances = {1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 24, 32,
+                                   64, 128, width, width * 2};
+    for (int i = 0; i < 16; ++i)
+      putInt32(pdt, 0x420 + i * 4, distances[i]);
+    string indices;
+    for (uint32_t index : testPicture(width, height, 256, rng))
+      indices.push_back(static_cast<char>(index));
+    pdt += lzEncode(indices, pdt11Scheme(distances), width);
+  } else {
+    pdt += lzEncode(packedBGR(testPicture(width, height, 0x1000000, rng)),
+                    pdt10Scheme(), width);
+  }
+
+  if (with_alpha) {
+    putInt32(pdt, 0x1c, pdt.size());
+    string mask;
+    for (uint32_t alpha : testPicture(width, height, 512, rng))
+      mask.push_back(static_cast<char>(std::min<uint32_t>(alpha, 0xff)));
+    pdt += lzEncode(mask, maskScheme(), width);
+  }
+  putInt32(pdt, 0x08, pdt.size());
+  return pdt;
+}
+
+}  // namespace
+
+string makeTestImage(TestImageFormat format,
+                     int width,
+                     int height,
+                     unsigned int seed,
+                     bool with_alpha) {
+  std::mt19937 rng(seed);
+  switch (format) {
+    case TEST_G00_TYPE0: {
+      const string raw =
+          packedBGR(testPicture(width, height, 0x1000000, rng));
+      string g00 = g00Header(0, width, height);
+      g00 += lzEncode(raw, g00Type0Scheme(), width);
+      putInt32(g00, 5, g00.size() - 5);
+      putInt32(g00, 9, raw.size());
+      return g00;
+    }
+    case TEST_G00_TYPE1: {
+      const int colours = 1 + rng() % 256;
+      string raw(2 + colours * 4, '\0');
+      putInt16(raw, 0, colours);
+      for (int i = 0; i < colours; ++i)
+        putInt32(raw, 2 + i * 4, rng());
+      for (uint32_t index : testPicture(width, height, colours, rng))
+        raw.push_back(static_cast<char>(index));
+      string g00 = g00Header(1, width, height);
+      g00 += lzEncode(raw, scn2kScheme(), width);
+      putInt32(g00, 5, g00.size() - 5);
+      putInt32(g00, 9, raw.size() - 1);
+      return g00;
+    }
+    case TEST_G00_TYPE2:
+      return makeG00Type2(width, height, rng, with_alpha);
+    case TEST_PDT10:
+    case TEST_PDT11:
+      return makePDT(format == TEST_PDT11, width, height, rng, with_alpha);
+  }
+  return string();
+}
+
+string makeG00Type2WithIndexEntry(int width,
+                                  int height,
+                                  int32_t offset,
+                                  int32_t length) {
+  // One region, drawn by one opaque block.
+  string raw(12, '\0');
+  putInt32(raw, 0, 1);
+  putInt32(raw, 4, offset);
+  putInt32(raw, 8, length);
+  raw.append(0x74, '\0');
+  string block(0x5c, '\0');
+  putInt16(block, 6, width);
+  putInt16(block, 8, height);
+  raw += block;
+  raw.append(static_cast<size_t>(width) * height * 4, '\xff');
+
+  string g00 = g00Header(2, width, height);
+  putInt32(g00, 5, 1);
+  string entry(24, '\0');
+  putInt32(entry, 8, width - 1);
+  putInt32(entry, 12, height - 1);
+  g00 += entry;
+  const string stream = lzEncode(raw, scn2kScheme(), width * 4);
+  string data_head(8, '\0');
+  putInt32(data_head, 0, 8 + stream.size());
+  putInt32(data_head, 4, raw.size());
+  return g00 + data_head + stream;
+}
+
+// -----------------------------------------------------------------------
+
+void forEachKernelSet(const std::function<void()>& body) {
+  {
+    SCOPED_TRACE("vector kernels");
+    body();
+  }
+  {
+    SCOPED_TRACE("scalar kernels");
+    ScopedScalarKernels scalar;
+    body();
+  }
+}
+
+void expectSameOnFourBlitThreads(
+    const std::function<vector<uint32_t>()>& render) {
+  const vector<uint32_t> expected = render();
+  SetBlitThreadCount(4);
+  const vector<uint32_t> actual = render();
+  SetBlitThreadCount(1);
+  EXPECT_EQ(expected, actual);
+}
+
 // -----------------------------------------------------------------------
 
 FullSystemTest::FullSystemTest()
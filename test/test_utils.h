@@ -28,7 +28,11 @@
 #ifndef TEST_TESTUTILS_HPP_
 #define TEST_TESTUTILS_HPP_
 
+#include <cstdint>
+#include <functional>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "gtest/gtest.h"
 #include "libreallive/archive.h"
@@ -38,6 +42,108 @@
 // Locates a test file in the test/ directory.
 std::string locateTestCase(const std::string& baseName);
 
+// One still compressed scenario out of a test SEEN file.
+struct CompressedScenario {
+  // "Module_Jmp_SEEN/fibonacci.TXT:1"
+  std::string name;
+
+  // The whole scenario, header included.
+  std::string data;
+
+  // The compressed bytecode within |data|, and its decompressed size.
+  size_t compressed_offset;
+  size_t compressed_length;
+  size_t decompressed_length;
+};
+
+// Reads every scenario out of every SEEN file in the test/*_SEEN/
+// directories.
+std::vector<CompressedScenario> loadAllTestScenarios();
+
+// Writes a SEEN.TXT to |path| holding a single scenario, number |scenario|,
+// built from the raw |bytecode| and |kidoku_table|. Lets tests run bytecode
+// that has no kepago source.
+void writeTestSeen(const std::string& path,
+                   int scenario,
+                   const std::string& bytecode,
+                   const std::vector<int>& kidoku_table);
+
+// Writes a type 0 (24-bit, opaque) G00 image to |path|, with every pixel
+// stored as a literal. Pixel (x, y) has the colour testG00Pixel(x, y).
+void writeTestG00(const std::string& path, int width, int height);
+
+// The 0xRRGGBB colour writeTestG00() gives the pixel at (x, y).
+uint32_t testG00Pixel(int x, int y);
+
+// Writes an NWK voice archive to |path| with an uncompressed 16-bit mono NWA
+// file of |frames| samples at |rate| for each of |koe_nums|. Sample i of
+// voice koe_num is testVoiceSample(koe_num, i).
+void writeTestNWK(const std::string& path,
+                  const std::vector<int>& koe_nums,
+                  int frames,
+                  int rate);
+
+// The sample writeTestNWK() stores at |i| in voice |koe_num|.
+int16_t testVoiceSample(int koe_num, int i);
+
+// Writes a voice archive to |path|: a table of |entry_length| byte entries
+// (12 for NWK, 16 for OVK) followed by each of |files|, a koe number and the
+// file stored under it.
+void writeTestVoiceArchive(
+    const std::string& path,
+    int entry_length,
+    const std::vector<std::pair<int, std::string>>& files);
+
+// Encodes |samples|, 16-bit and interleaved across |channels|, as an NWA file
+// compressed at |level| (0 to 5) in blocks of |block_size| samples. With
+// |run_length|, repeated samples are stored as counts. The compression is
+// lossy; |decoded| receives exactly what a decoder has to produce.
+std::string makeTestNWA(const std::vector<int16_t>& samples,
+                        int channels,
+                        int rate,
+                        int level,
+                        bool run_length,
+                        int block_size,
+                        std::vector<int16_t>* decoded);
+
+// Image formats makeTestImage() can encode.
+enum TestImageFormat {
+  TEST_G00_TYPE0,
+  TEST_G00_TYPE1,
+  TEST_G00_TYPE2,
+  TEST_PDT10,
+  TEST_PDT11
+};
+
+// Encodes a |width| x |height| image as a G00 or PDT file. The picture mixes
+// flat runs, rows repeated from above and noise chosen from |seed|, so the LZ
+// streams have back references of every length as well as literals. With
+// |with_alpha|, PDTs get an alpha mask and G00 type 2 images get translucent
+// pixels and a strip no block covers; without it every pixel is opaque.
+std::string makeTestImage(TestImageFormat format,
+                          int width,
+                          int height,
+                          unsigned int seed,
+                          bool with_alpha);
+
+// Encodes a white, opaque |width| x |height| G00 type 2 image whose one
+// region's entry in the compressed index claims its blocks are |length|
+// bytes at |offset|. The image decodes fully when that is 12 and the rest of
+// the stream.
+std::string makeG00Type2WithIndexEntry(int width,
+                                       int height,
+                                       int32_t offset,
+                                       int32_t length);
+
+// Runs |body| with the kernels this CPU dispatches to and again with the
+// scalar fallback, so one test covers both.
+void forEachKernelSet(const std::function<void()>& body);
+
+// Expects |render| to produce the same pixels when its blits and colour
+// transforms split their rows across four threads as when they run on one.
+void expectSameOnFourBlitThreads(
+    const std::function<std::vector<uint32_t>()>& render);
+
 // A base class for all tests that instantiate an archive, a System and a
 // Machine.
 class FullSystemTest : public ::testing::Test {
@@ -0,0 +1,296 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#include "gtest/gtest.h"
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "systems/base/koepac_voice_archive.h"
+#include "systems/base/nwk_voice_archive.h"
+#include "systems/base/ovk_voice_archive.h"
+#include "systems/base/ovk_voice_sample.h"
+#include "systems/base/voice_archive.h"
+#include "test_utils.h"
+#include "utilities/exception.h"
+#include "xclannad/endian.hpp"
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+const int kFrames = 1000;
+const int kRate = 22050;
+
+class VoiceArchiveTest : public ::testing::Test {
+ protected:
+  VoiceArchiveTest() : dir_(fs::temp_directory_path() / fs::unique_path()) {
+    fs::create_directories(dir_);
+  }
+  ~VoiceArchiveTest() { fs::remove_all(dir_); }
+
+  // Checks that |data| and |length| from Decode() hold |channels| channels
+  // of |samples|.
+  void ExpectSamples(const std::vector<int16_t>& samples,
+                     int channels,
+                     const char* data,
+                     int length) {
+    ASSERT_EQ(static_cast<int>(samples.size()) * 2, length);
+    EXPECT_EQ(0, memcmp(data, "RIFF", 4));
+    EXPECT_EQ(length, read_little_endian_int(data + 0x28));
+    EXPECT_EQ(channels, read_little_endian_short(data + 0x16));
+    EXPECT_EQ(kRate, read_little_endian_int(data + 0x18));
+    for (size_t i = 0; i < samples.size(); ++i) {
+      ASSERT_EQ(samples[i],
+                static_cast<int16_t>(read_little_endian_short(
+                    data + WAV_HEADER_SIZE + i * 2)))
+          << "at " << i;
+    }
+  }
+
+  // Checks that |data| and |length| from Decode() hold voice |koe_num|.
+  void ExpectVoice(int koe_num, const char* data, int length) {
+    std::vector<int16_t> samples;
+    for (int i = 0; i < kFrames; ++i)
+      samples.push_back(testVoiceSample(koe_num, i));
+    ExpectSamples(samples, 1, data, length);
+  }
+
+  fs::path dir_;
+};
+
+}  // namespace
+
+TEST_F(VoiceArchiveTest, DecodesNWKSamples) {
+  const fs::path path = dir_ / "z0001.nwk";
+  writeTestNWK(path.string(), {30, 10, 20}, kFrames, kRate);
+  NWKVoiceArchive archive(path, 1);
+
+  for (int koe_num : {10, 20, 30}) {
+    int length = 0;
+    std::unique_ptr<char[]> data(archive.FindSample(koe_num)->Decode(&length));
+    ExpectVoice(koe_num, data.get(), length);
+  }
+}
+
+// Compressed NWA files are decoded a block at a time, each block starting
+// from a raw frame and continuing as a bit stream of differences.
+TEST_F(VoiceArchiveTest, DecodesCompressedNWKSamples) {
+  // A tone that fades in and out between two stretches of silence, which run
+  // length coding stores as counts.
+  std::vector<int16_t> mono(kFrames);
+  std::vector<int16_t> stereo(kFrames * 2);
+  for (int i = 100; i < kFrames - 100; ++i) {
+    const double fade = std::sin(M_PI * (i - 100) / (kFrames - 200));
+    mono[i] = static_cast<int16_t>(12000 * fade * std::sin(i * 0.05));
+    stereo[i * 2] = mono[i];
+    stereo[i * 2 + 1] = -mono[i] / 2;
+  }
+
+  // Every level, with and without runs, and the stereo 16-bit level 2 case
+  // that has its own decoder. 256 samples to a block leaves the last one
+  // short.
+  struct Voice {
+    int koe_num;
+    int level;
+    bool run_length;
+    int channels;
+  };
+  const Voice kVoices[] = {{10, 0, false, 1},
+                           {11, 1, true, 1},
+                           {12, 2, false, 1},
+                           {13, 3, false, 1},
+                           {14, 4, true, 1},
+                           {15, 5, true, 1},
+                           {16, 2, false, 2},
+                           {17, 5, true, 2}};
+  std::vector<std::pair<int, std::string>> files;
+  std::map<int, std::vector<int16_t>> expected;
+  for (const Voice& voice : kVoices) {
+    files.emplace_back(
+        voice.koe_num,
+        makeTestNWA(voice.channels == 1 ? mono : stereo, voice.channels, kRate,
+                    voice.level, voice.run_length, 256,
+                    &expected[voice.koe_num]));
+  }
+  const fs::path path = dir_ / "z0001.nwk";
+  writeTestVoiceArchive(path.string(), 12, files);
+  NWKVoiceArchive archive(path, 1);
+
+  for (const Voice& voice : kVoices) {
+    SCOPED_TRACE(voice.koe_num);
+    const std::vector<int16_t>& source = voice.channels == 1 ? mono : stereo;
+    for (size_t i = 0; i < source.size(); ++i)
+      ASSERT_NEAR(source[i], expected[voice.koe_num][i], 256) << "at " << i;
+
+    int length = 0;
+    std::unique_ptr<char[]> data(
+        archive.FindSample(voice.koe_num)->Decode(&length));
+    ExpectSamples(expected[voice.koe_num], voice.channels, data.get(), length);
+  }
+}
+
+TEST_F(VoiceArchiveTest, MissingSamplesThrow) {
+  const fs::path path = dir_ / "z0001.nwk";
+  writeTestNWK(path.string(), {10, 20}, kFrames, kRate);
+  NWKVoiceArchive archive(path, 1);
+
+  // Ids between, before and after the ones in the archive.
+  EXPECT_THROW(archive.FindSample(15), rlvm::Exception);
+  EXPECT_THROW(archive.FindSample(5), rlvm::Exception);
+  EXPECT_THROW(archive.FindSample(25), rlvm::Exception);
+}
+
+TEST_F(VoiceArchiveTest, SamplesOutliveTheirArchive) {
+  const fs::path path = dir_ / "z0001.nwk";
+  writeTestNWK(path.string(), {10}, kFrames, kRate);
+  std::unique_ptr<NWKVoiceArchive> archive(new NWKVoiceArchive(path, 1));
+  std::shared_ptr<VoiceSample> sample = archive->FindSample(10);
+  archive.reset();
+
+  int length = 0;
+  std::unique_ptr<char[]> data(sample->Decode(&length));
+  ExpectVoice(10, data.get(), length);
+}
+
+TEST_F(VoiceArchiveTest, TruncatedArchivesThrow) {
+  const fs::path path = dir_ / "z0001.nwk";
+  std::ofstream file(path.string(), std::ios::binary);
+  file.write("\x10\0\0\0", 4);
+  file.close();
+
+  EXPECT_THROW(NWKVoiceArchive(path, 1), rlvm::Exception);
+  EXPECT_THROW(NWKVoiceArchive(dir_ / "missing.nwk", 1), rlvm::Exception);
+
+  // 0x15555556 entries of 12 bytes wraps around to 8 bytes in an int.
+  const fs::path wrapping = dir_ / "z0002.nwk";
+  std::ofstream wrapping_file(wrapping.string(), std::ios::binary);
+  wrapping_file.write("VUU", 4);
+  wrapping_file.write(std::string(8, '\0').data(), 8);
+  wrapping_file.close();
+
+  EXPECT_THROW(NWKVoiceArchive(wrapping, 2), rlvm::Exception);
+}
+
+TEST_F(VoiceArchiveTest, InvalidNWAFilesThrow) {
+  const fs::path path = dir_ / "z0001.nwk";
+  writeTestVoiceArchive(path.string(), 12, {{10, std::string(0x40, '\0')}});
+  NWKVoiceArchive archive(path, 1);
+
+  int length = 0;
+  EXPECT_THROW(archive.FindSample(10)->Decode(&length), rlvm::Exception);
+}
+
+TEST_F(VoiceArchiveTest, DecodesKOEPACSamples) {
+  // One sample of one table coded block: 0x400 bytes that each become a
+  // stereo frame.
+  std::string koe(0x20, '\0');
+  koe.replace(0, 6, "KOEPAC");
+  koe[0x10] = 1;
+  write_little_endian_int(&koe[0x18], kRate);
+  std::string entry(8, '\0');
+  write_little_endian_short(&entry[0], 7);
+  write_little_endian_short(&entry[2], 1);
+  write_little_endian_int(&entry[4], 0x28);
+  koe += entry;
+  koe += std::string("\x00\x04", 2);
+  for (int i = 0; i < 0x400; ++i)
+    koe.push_back(i & 1 ? '\x81' : '\x80');
+
+  const fs::path path = dir_ / "z0001.koe";
+  std::ofstream file(path.string(), std::ios::binary);
+  file.write(koe.data(), koe.size());
+  file.close();
+
+  KOEPACVoiceArchive archive(path, 1);
+  int length = 0;
+  std::unique_ptr<char[]> data(archive.FindSample(7)->Decode(&length));
+  EXPECT_EQ(0x400 * 4, length);
+  EXPECT_EQ(length, read_little_endian_int(data.get() + 0x28));
+  EXPECT_EQ(kRate, read_little_endian_int(data.get() + 0x18));
+
+  // The samples follow the header directly; 0x80 is silence and 0x81 the
+  // smallest positive step.
+  const char* pcm = data.get() + WAV_HEADER_SIZE;
+  EXPECT_EQ(0x0000, read_little_endian_short(pcm + 0));
+  EXPECT_EQ(0x0000, read_little_endian_short(pcm + 2));
+  EXPECT_EQ(0x0001, read_little_endian_short(pcm + 4));
+  EXPECT_EQ(0x0001, read_little_endian_short(pcm + 6));
+}
+
+// OVK archives are Ogg Vorbis files back to back. Each sample reads, seeks
+// and tells within its own slice of the mapping, so it must decode the same
+// as the file on its own, however often it's decoded and whatever follows
+// it.
+TEST_F(VoiceArchiveTest, DecodesOVKSamples) {
+  const std::string ogg_path = locateTestCase("Gameroot/ogg/tone.ogg");
+  std::ifstream ogg_file(ogg_path, std::ios::binary);
+  const std::string ogg((std::istreambuf_iterator<char>(ogg_file)),
+                        std::istreambuf_iterator<char>());
+
+  // 0.1 seconds of a 440Hz tone at half volume.
+  int length = 0;
+  std::unique_ptr<char[]> whole(OVKVoiceSample(ogg_path).Decode(&length));
+  const int data_size = read_little_endian_int(whole.get() + 0x28);
+  EXPECT_EQ(2205 * 2, data_size);
+  EXPECT_EQ(data_size, length);
+  EXPECT_EQ(1, read_little_endian_short(whole.get() + 0x16));
+  EXPECT_EQ(kRate, read_little_endian_int(whole.get() + 0x18));
+  int peak = 0;
+  for (int i = 0; i < data_size; i += 2) {
+    peak = std::max(peak,
+                    std::abs(static_cast<int16_t>(read_little_endian_short(
+                        whole.get() + WAV_HEADER_SIZE + i))));
+  }
+  EXPECT_GT(peak, 12000);
+
+  const fs::path path = dir_ / "z0001.ovk";
+  writeTestVoiceArchive(path.string(), 16,
+                        {{5, ogg}, {6, "not an ogg stream"}, {7, ogg}});
+  OVKVoiceArchive archive(path, 1);
+  for (int koe_num : {5, 7}) {
+    std::shared_ptr<VoiceSample> sample = archive.FindSample(koe_num);
+    for (int pass = 0; pass < 2; ++pass) {
+      std::unique_ptr<char[]> data(sample->Decode(&length));
+      EXPECT_EQ(data_size, length);
+      EXPECT_EQ(0, memcmp(whole.get(), data.get(), WAV_HEADER_SIZE + data_size))
+          << "voice " << koe_num << ", pass " << pass;
+    }
+  }
+
+  EXPECT_THROW(archive.FindSample(6)->Decode(&length), std::runtime_error);
+}
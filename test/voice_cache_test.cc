@@ -0,0 +1,379 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+
+#include "gtest/gtest.h"
+
+#include <boost/filesystem.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "libreallive/archive.h"
+#include "libreallive/elements/command.h"
+#include "libreallive/scenario.h"
+#include "machine/rlmachine.h"
+#include "systems/base/audio_mixer.h"
+#include "systems/base/script_lookahead.h"
+#include "systems/base/voice_archive.h"
+#include "systems/base/voice_cache.h"
+#include "test_system/test_system.h"
+#include "test_utils.h"
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+// A stereo clip of |frames| frames, every sample |fill|.
+std::shared_ptr<AudioClip> MakeClip(size_t frames, float fill) {
+  return std::make_shared<AudioClip>(std::vector<float>(frames * 2, fill));
+}
+
+size_t ClipBytes(size_t frames) { return frames * 2 * sizeof(float); }
+
+// A VoiceCache::ClipLoader that records which voices it loads and on which
+// thread, and can be held up to keep the worker busy.
+class ProbeLoader {
+ public:
+  VoiceCache::ClipLoader loader() {
+    return [this](const char* data, size_t size) { return Load(data, size); };
+  }
+
+  // Makes loads wait until Release().
+  void Hold() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    held_ = true;
+  }
+
+  void Release() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      held_ = false;
+    }
+    changed_.notify_all();
+  }
+
+  // Waits for |count| loads to have started.
+  void WaitForLoads(size_t count) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    changed_.wait(lock, [&] { return koe_nums_.size() >= count; });
+  }
+
+  std::vector<int> koe_nums() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return koe_nums_;
+  }
+
+  std::vector<std::thread::id> threads() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return threads_;
+  }
+
+ private:
+  // Reads writeTestNWK()'s 16-bit mono voices, telling them apart by their
+  // first sample.
+  std::shared_ptr<AudioClip> Load(const char* data, size_t size) {
+    const int16_t* pcm =
+        reinterpret_cast<const int16_t*>(data + WAV_HEADER_SIZE);
+    size_t frames = (size - WAV_HEADER_SIZE) / 2;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    koe_nums_.push_back(pcm[0] / testVoiceSample(1, 0));
+    threads_.push_back(std::this_thread::get_id());
+    changed_.notify_all();
+    changed_.wait(lock, [&] { return !held_; });
+    return AudioClip::FromPCM16(pcm, frames, 1);
+  }
+
+  std::mutex mutex_;
+  std::condition_variable changed_;
+  bool held_ = false;
+  std::vector<int> koe_nums_;
+  std::vector<std::thread::id> threads_;
+};
+
+// Voices 100001 to 100003 in an archive on disk, played through a VoiceCache
+// that loads them with a ProbeLoader.
+class VoiceCachePrefetchTest : public ::testing::Test {
+ protected:
+  static const int kFrames = 480;
+
+  VoiceCachePrefetchTest()
+      : dir_(fs::temp_directory_path() / fs::unique_path()) {
+    fs::create_directories(dir_ / "KOE");
+    writeTestNWK((dir_ / "KOE" / "z0001.nwk").string(), {1, 2, 3}, kFrames,
+                 22050);
+    system_.gameexe()("__GAMEPATH") = dir_.string() + "/";
+    system_.gameexe()("FOLDNAME.KOE") = "KOE";
+
+    cache_.reset(new VoiceCache(system_.sound()));
+    cache_->SetClipLoader(probe_.loader());
+  }
+
+  ~VoiceCachePrefetchTest() {
+    probe_.Release();
+    cache_.reset();
+    fs::remove_all(dir_);
+  }
+
+  // Waits for the worker to have stored |count| clips.
+  void WaitForStored(int count) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (cache_->prefetch_stats().stored < count &&
+           std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_EQ(count, cache_->prefetch_stats().stored);
+  }
+
+  fs::path dir_;
+  TestSystem system_;
+  ProbeLoader probe_;
+  std::unique_ptr<VoiceCache> cache_;
+};
+
+const int VoiceCachePrefetchTest::kFrames;
+
+// Bytecode for a command with the given parameters.
+std::string Command(int modtype, int module, int opcode,
+                    const std::vector<std::string>& params) {
+  std::string repr(8, 0);
+  repr[0] = '#';
+  repr[1] = modtype;
+  repr[2] = module;
+  repr[3] = opcode & 0xff;
+  repr[4] = opcode >> 8;
+  repr[5] = params.size();
+  repr += "(";
+  for (size_t i = 0; i < params.size(); ++i)
+    repr += (i ? "," : "") + params[i];
+  return repr + ")";
+}
+
+// The bytecode for the integer constant |value|.
+std::string IntConstant(int value) {
+  std::string repr("$\xff", 2);
+  for (int i = 0; i < 4; ++i)
+    repr += static_cast<char>((value >> (i * 8)) & 0xff);
+  return repr;
+}
+
+// The ids FindVoiceId() reads out of every command in |scenario|.
+std::vector<int> VoiceIdsIn(const libreallive::Scenario& scenario) {
+  std::vector<int> ids;
+  for (auto it = scenario.begin(); it != scenario.end(); ++it) {
+    auto* command = dynamic_cast<const libreallive::CommandElement*>(*it);
+    int id;
+    if (command && FindVoiceId(*command, &id))
+      ids.push_back(id);
+  }
+  return ids;
+}
+
+}  // namespace
+
+TEST(DecodedVoiceCacheTest, HandsOverEachClipOnce) {
+  DecodedVoiceCache cache(1024 * 1024);
+  std::shared_ptr<AudioClip> clip = MakeClip(100, 0.5f);
+  cache.Insert(500001, clip);
+  EXPECT_TRUE(cache.Contains(500001));
+  EXPECT_EQ(ClipBytes(100), cache.bytes());
+
+  EXPECT_EQ(clip, cache.Take(500001));
+  EXPECT_FALSE(cache.Contains(500001));
+  EXPECT_EQ(nullptr, cache.Take(500001));
+  EXPECT_EQ(0u, cache.bytes());
+
+  cache.RecordMiss();
+  EXPECT_EQ(1, cache.stats().hits);
+  EXPECT_EQ(1, cache.stats().misses);
+  EXPECT_EQ(1, cache.stats().stored);
+}
+
+TEST(DecodedVoiceCacheTest, EvictsOldestPastTheBudget) {
+  const size_t kFrames = 1000;
+  DecodedVoiceCache cache(2 * ClipBytes(kFrames));
+  cache.Insert(1, MakeClip(kFrames, 0.1f));
+  cache.Insert(2, MakeClip(kFrames, 0.2f));
+  EXPECT_EQ(0, cache.stats().evicted);
+
+  cache.Insert(3, MakeClip(kFrames, 0.3f));
+  EXPECT_FALSE(cache.Contains(1));
+  EXPECT_TRUE(cache.Contains(2));
+  EXPECT_TRUE(cache.Contains(3));
+  EXPECT_EQ(1, cache.stats().evicted);
+  EXPECT_EQ(2 * ClipBytes(kFrames), cache.bytes());
+
+  // Replacing a clip doesn't count it twice.
+  cache.Insert(3, MakeClip(kFrames, 0.4f));
+  EXPECT_TRUE(cache.Contains(2));
+  EXPECT_EQ(2 * ClipBytes(kFrames), cache.bytes());
+  EXPECT_EQ(0.4f, cache.Take(3)->samples()[0]);
+}
+
+TEST(DecodedVoiceCacheTest, KeepsAClipLargerThanTheBudget) {
+  DecodedVoiceCache cache(16);
+  cache.Insert(7, MakeClip(100, 0.0f));
+  EXPECT_TRUE(cache.Contains(7));
+}
+
+// A prefetched voice is decoded and loaded on the worker, and LoadClip() only
+// picks up the result.
+TEST_F(VoiceCachePrefetchTest, PrefetchedClipIsLoadedOnTheWorker) {
+  cache_->Prefetch(100002);
+  WaitForStored(1);
+
+  std::shared_ptr<AudioClip> clip = cache_->LoadClip(100002);
+  ASSERT_TRUE(clip);
+  ASSERT_EQ(static_cast<size_t>(kFrames), clip->frames());
+  EXPECT_FLOAT_EQ(testVoiceSample(2, 5) / 32768.0f, clip->samples()[10]);
+
+  EXPECT_EQ(std::vector<int>{2}, probe_.koe_nums());
+  ASSERT_EQ(1u, probe_.threads().size());
+  EXPECT_NE(std::this_thread::get_id(), probe_.threads()[0]);
+  EXPECT_EQ(1, cache_->prefetch_stats().hits);
+  EXPECT_EQ(0, cache_->prefetch_stats().misses);
+}
+
+// Asking for the voice the worker is loading waits for it rather than
+// loading it a second time.
+TEST_F(VoiceCachePrefetchTest, WaitsForTheVoiceInProgress) {
+  probe_.Hold();
+  cache_->Prefetch(100001);
+  probe_.WaitForLoads(1);
+
+  std::future<std::shared_ptr<AudioClip>> clip = std::async(
+      std::launch::async, [this] { return cache_->LoadClip(100001); });
+  EXPECT_EQ(std::future_status::timeout,
+            clip.wait_for(std::chrono::milliseconds(50)));
+
+  probe_.Release();
+  EXPECT_TRUE(clip.get());
+  EXPECT_EQ(std::vector<int>{1}, probe_.koe_nums());
+  EXPECT_EQ(1, cache_->prefetch_stats().hits);
+}
+
+// A voice still waiting in the queue is loaded on the spot and dropped from
+// the queue, so the worker doesn't load it again.
+TEST_F(VoiceCachePrefetchTest, MissDropsTheQueuedJob) {
+  probe_.Hold();
+  cache_->Prefetch(100001);
+  probe_.WaitForLoads(1);
+  cache_->Prefetch(100003);
+
+  // The load blocks on the held loader, so it runs on another thread.
+  std::future<std::shared_ptr<AudioClip>> clip = std::async(
+      std::launch::async, [this] { return cache_->LoadClip(100003); });
+  probe_.WaitForLoads(2);
+  probe_.Release();
+  EXPECT_TRUE(clip.get());
+  WaitForStored(1);
+
+  // Prefetching 100002 afterwards shows the worker has finished with the
+  // queue ahead of it.
+  cache_->Prefetch(100002);
+  WaitForStored(2);
+  EXPECT_EQ((std::vector<int>{1, 3, 2}), probe_.koe_nums());
+  EXPECT_EQ(1, cache_->prefetch_stats().misses);
+  EXPECT_EQ(0, cache_->prefetch_stats().hits);
+}
+
+TEST(VoiceCacheTest, FindsVoiceIdsInVoiceCommands) {
+  const std::string int_var = std::string("$\x0b[$\xff\0\0\0\0]", 10);
+  std::string bytecode =
+      // koePlay(id) and koePlay(id, chara).
+      Command(1, 23, 0, {IntConstant(100023)}) +
+      Command(1, 23, 1, {IntConstant(100042), IntConstant(3)}) +
+      // koeWait and a module that isn't Koe.
+      Command(1, 23, 3, {IntConstant(5)}) +
+      Command(1, 33, 0, {IntConstant(6)}) +
+      // koeDoPlay with an id held in memory can't be known ahead of time.
+      Command(1, 23, 8, {int_var}) +
+      Command(1, 23, 8, {IntConstant(100023)}) +
+      Command(1, 23, 10, {IntConstant(2500001)});
+  const fs::path seen = fs::temp_directory_path() / fs::unique_path();
+  writeTestSeen(seen.string(), 1, bytecode, {});
+
+  libreallive::Archive arc(seen.string());
+  TestSystem system;
+  RLMachine rlmachine(system, arc);
+  const libreallive::Scenario& scenario = rlmachine.Scenario();
+
+  EXPECT_EQ((std::vector<int>{100023, 100042, 100023, 2500001}),
+            VoiceIdsIn(scenario));
+
+  fs::remove(seen);
+}
+
+// Each command is visited once as the instruction pointer moves through the
+// window, and again after a jump back or a Reset().
+TEST(ScriptLookaheadTest, VisitsEachCommandOnceAsTheScriptRuns) {
+  std::string bytecode;
+  for (int id = 0; id < 10; ++id)
+    bytecode += Command(1, 23, 0, {IntConstant(id)});
+  const fs::path seen = fs::temp_directory_path() / fs::unique_path();
+  writeTestSeen(seen.string(), 1, bytecode, {});
+
+  libreallive::Archive arc(seen.string());
+  const libreallive::Scenario& scenario = *arc.GetFirstScenario();
+  ASSERT_EQ(10, std::distance(scenario.begin(), scenario.end()));
+
+  ScriptLookahead lookahead(4);
+  std::vector<int> visited;
+  auto scan = [&](int position) {
+    visited.clear();
+    lookahead.Scan(scenario, scenario.begin() + position,
+                   [&](const libreallive::CommandElement& f) {
+                     int id;
+                     if (FindVoiceId(f, &id))
+                       visited.push_back(id);
+                   });
+    return visited;
+  };
+
+  EXPECT_EQ((std::vector<int>{0, 1, 2, 3}), scan(0));
+  // Still more than half the window scanned ahead.
+  EXPECT_EQ((std::vector<int>{}), scan(1));
+  EXPECT_EQ((std::vector<int>{4, 5}), scan(2));
+  EXPECT_EQ((std::vector<int>{6, 7, 8}), scan(5));
+  // Stops at the end of the scenario.
+  EXPECT_EQ((std::vector<int>{9}), scan(8));
+  // Jumping back starts over.
+  EXPECT_EQ((std::vector<int>{0, 1, 2, 3}), scan(0));
+
+  lookahead.Reset();
+  EXPECT_EQ((std::vector<int>{0, 1, 2, 3}), scan(0));
+
+  fs::remove(seen);
+}